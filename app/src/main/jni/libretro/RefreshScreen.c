@@ -7,7 +7,7 @@ static const char* vertex_shader =
 "#version 300 es \n"
 "layout(location = 0) in vec3 vertexPosition_modelspace;           \n"
 "                                                                  \n"
-"out lowp vec2 UV;                                                 \n"
+"out highp vec2 UV;                                                \n"
 "                                                                  \n"
 "void main(){                                                      \n"
 "	gl_Position = vec4(vertexPosition_modelspace,1);               \n"
@@ -17,14 +17,15 @@ static const char* vertex_shader =
 
 static const char* fragment_shader =
 "#version 300 es \n"
-"in lowp vec2 UV;                                                 \n"
+"in highp vec2 UV;                                                \n"
 "                                                                 \n"
 "layout(location = 0) out lowp vec4 color;                        \n"
 "                                                                 \n"
 "uniform sampler2D renderedTexture;                               \n"
+"uniform highp vec2 uvScale;                                      \n"
 "                                                                 \n"
 "void main(){                                                     \n"
-"    color = texture( renderedTexture, vec2(UV.x, 1.0 - UV.y)).bgra;    \n"
+"    color = texture( renderedTexture, vec2(UV.x, 1.0 - UV.y) * uvScale).bgra;    \n"
 "}                                                                \n"
 ;
 
@@ -50,11 +51,14 @@ bool isGLError(const char* test)
 	return false;
 }
 
-GLuint gPBO = 0;
+// Two pixel buffers used in turn, so a frame is written while the previous one uploads
+GLuint gPBO[2] = {0, 0};
+unsigned gPBOIndex = 0;
 GLuint gFBO = 0;
 GLenum gDrawBuffers[1] = {GL_COLOR_ATTACHMENT0};
 GLuint gProgramId = 0;
 GLuint gTexID = 0;
+GLuint gUVScaleID = 0;
 GLuint gQuad_vertexbuffer;
 
 struct CachedTexture
@@ -142,8 +146,13 @@ void RefreshScreenInit(void)
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 
-	// Generate Pixel Buffer Object
-	glGenBuffers(1, &gPBO);
+	// Generate Pixel Buffer Objects
+	glGenBuffers(2, gPBO);
+	for (int i = 0; i < 2; i++) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gPBO[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, gTexture.textureBytes, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	glGenFramebuffers(1, &gFBO);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gFBO);
 
@@ -152,6 +161,7 @@ void RefreshScreenInit(void)
 
     glUseProgram(gProgramId);
     gTexID = glGetUniformLocation(gProgramId, "renderedTexture");
+    gUVScaleID = glGetUniformLocation(gProgramId, "uvScale");
 
     //Setup vertexes
     glGenBuffers(1, &gQuad_vertexbuffer);
@@ -163,9 +173,9 @@ void RefreshScreenDestroy(void)
 {
 	glDeleteTextures( 1, &gTexture.glName );
 
-	if (gPBO != 0) {
-		glDeleteBuffers(1, &gPBO);
-		gPBO = 0;
+	if (gPBO[0] != 0) {
+		glDeleteBuffers(2, gPBO);
+		gPBO[0] = gPBO[1] = 0;
 	}
 
 	if (gFBO != 0) {
@@ -180,12 +190,15 @@ void RefreshScreen(const void *data, unsigned width, unsigned height, size_t pit
 	gTexture.width = width;
 	gTexture.height = height;
 	const uint32_t dataSize = width*height * 4;
-	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gPBO);
-	glBufferData(GL_PIXEL_UNPACK_BUFFER, dataSize, NULL, GL_DYNAMIC_DRAW);
-	GLubyte* ptr = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, dataSize, GL_MAP_WRITE_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gPBO[gPBOIndex]);
+	gPBOIndex ^= 1;
+	GLubyte* ptr = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, dataSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
 
-	if (ptr == NULL)
+	if (ptr == NULL) {
+	    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	    return;
+	}
 
 	uint32_t* dst = (uint32_t*)ptr;
 
@@ -199,6 +212,11 @@ void RefreshScreen(const void *data, unsigned width, unsigned height, size_t pit
 	// Set clamping modes
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// Compacted 240p frames only fill the top half of the texture, nearest
+	// sampling doubles their lines as the core would have done
+	const GLint filter = (height < gTexture.realHeight) ? GL_NEAREST : GL_LINEAR;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
 	//glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gFBO);
 	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
@@ -219,6 +237,7 @@ void RefreshScreen(const void *data, unsigned width, unsigned height, size_t pit
 	glBindTexture(GL_TEXTURE_2D, gTexture.glName);
 	// Set our "renderedTexture" sampler to user Texture Unit 0
 	glUniform1i(gTexID, 0);
+	glUniform2f(gUVScaleID, (GLfloat)width / gTexture.realWidth, (GLfloat)height / gTexture.realHeight);
 
     //Draw the vertices
     glEnableVertexAttribArray(0);
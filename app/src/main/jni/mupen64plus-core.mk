@@ -34,6 +34,7 @@ LOCAL_SRC_FILES :=                                              \
     $(SRCDIR)/main/cheat.c                                      \
     $(SRCDIR)/device/device.c                                   \
     $(SRCDIR)/main/eventloop.c                                  \
+    $(SRCDIR)/main/input_latency.c                              \
     $(SRCDIR)/main/main.c                                       \
     $(SRCDIR)/main/md5.c                                        \
     $(SRCDIR)/main/profile.c                                    \
@@ -65,13 +66,16 @@ LOCAL_SRC_FILES :=                                              \
     $(SRCDIR)/plugin/get_time_using_time_plus_delta.c           \
     $(SRCDIR)/plugin/plugin.c                                   \
     $(SRCDIR)/plugin/rumble_via_input_plugin.c                  \
+    $(SRCDIR)/device/r4300/block_profiler.c                     \
     $(SRCDIR)/device/r4300/cached_interp.c                      \
     $(SRCDIR)/device/r4300/cp0.c                                \
     $(SRCDIR)/device/r4300/cp1.c                                \
     $(SRCDIR)/device/r4300/empty_dynarec.c                      \
     $(SRCDIR)/device/r4300/exception.c                          \
+    $(SRCDIR)/device/r4300/exec_trace.c                         \
     $(SRCDIR)/device/r4300/instr_counters.c                     \
     $(SRCDIR)/device/r4300/interrupt.c                          \
+    $(SRCDIR)/device/r4300/lockstep.c                           \
     $(SRCDIR)/device/r4300/mi_controller.c                      \
     $(SRCDIR)/device/r4300/pure_interp.c                        \
     $(SRCDIR)/device/r4300/r4300_core.c                         \
@@ -35,6 +35,7 @@
 #include "debugger/dbg_types.h"
 #include "device/device.h"
 #include "device/memory/memory.h"
+#include "device/r4300/block_profiler.h"
 #include "device/r4300/r4300_core.h"
 #include "m64p_debugger.h"
 #include "m64p_types.h"
@@ -389,3 +390,35 @@ EXPORT int CALL DebugBreakpointCommand(m64p_dbg_bkp_command command, unsigned in
 #endif
 }
 
+
+EXPORT int CALL DebugProfilerCommand(m64p_dbg_prof_command command, unsigned int index, void *ptr)
+{
+    struct block_profiler* prof = &g_dev.r4300.profiler;
+
+    switch (command)
+    {
+        case M64P_PROF_CMD_START:
+            block_profiler_start(prof, index);
+            return 0;
+        case M64P_PROF_CMD_STOP:
+            block_profiler_stop(prof);
+            return 0;
+        case M64P_PROF_CMD_RESET:
+            block_profiler_reset(prof);
+            return 0;
+        case M64P_PROF_CMD_GET_HOT_BLOCKS:
+            return block_profiler_get_hot_blocks(prof, (m64p_hot_block*)ptr, index);
+        case M64P_PROF_CMD_GET_STATS:
+            if (ptr == NULL)
+                return -1;
+            block_profiler_get_stats(prof, (m64p_profiler_stats*)ptr);
+            return 0;
+        case M64P_PROF_CMD_WRITE_REPORT:
+            if (ptr == NULL)
+                return -1;
+            return block_profiler_write_report(prof, (const char*)ptr);
+        default:
+            DebugMessage(M64MSG_ERROR, "Bug: DebugProfilerCommand() called with invalid input m64p_dbg_prof_command");
+            return -1;
+    }
+}
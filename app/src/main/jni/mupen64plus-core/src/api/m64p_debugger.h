@@ -194,6 +194,22 @@ typedef int (*ptr_DebugBreakpointCommand)(m64p_dbg_bkp_command, unsigned int, m6
 EXPORT int CALL DebugBreakpointCommand(m64p_dbg_bkp_command, unsigned int, m64p_breakpoint *);
 #endif
 
+/* DebugProfilerCommand()
+ *
+ * This function controls the r4300 hot-block sampling profiler, which is
+ * available in all Core builds. For M64P_PROF_CMD_START the index parameter
+ * is the sampling period in count cycles (0 selects the default). For
+ * M64P_PROF_CMD_GET_HOT_BLOCKS, ptr points to an array of index
+ * m64p_hot_block structs which is filled with the hottest blocks first, and
+ * the number of blocks written is returned. For M64P_PROF_CMD_GET_STATS, ptr
+ * points to a m64p_profiler_stats struct. For M64P_PROF_CMD_WRITE_REPORT, ptr
+ * is the filename of the text report to write.
+ */
+typedef int (*ptr_DebugProfilerCommand)(m64p_dbg_prof_command, unsigned int, void *);
+#if defined(M64P_CORE_PROTOTYPES)
+EXPORT int CALL DebugProfilerCommand(m64p_dbg_prof_command, unsigned int, void *);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
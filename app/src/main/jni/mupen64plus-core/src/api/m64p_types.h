@@ -316,6 +316,35 @@ typedef struct {
   unsigned int flags;
 } m64p_breakpoint;
 
+typedef enum {
+  M64P_PROF_CMD_START = 1,
+  M64P_PROF_CMD_STOP,
+  M64P_PROF_CMD_RESET,
+  M64P_PROF_CMD_GET_HOT_BLOCKS,
+  M64P_PROF_CMD_GET_STATS,
+  M64P_PROF_CMD_WRITE_REPORT
+} m64p_dbg_prof_command;
+
+typedef enum {
+  M64P_PROF_MODE_DYNAREC = 0,
+  M64P_PROF_MODE_INTERPRETER,
+  M64P_PROF_MODE_HELPER, /* dynarec falling back to interpreted code */
+  M64P_PROF_MODE_COUNT
+} m64p_dbg_prof_mode;
+
+typedef struct {
+  uint32_t     address;
+  unsigned int samples[M64P_PROF_MODE_COUNT];
+} m64p_hot_block;
+
+typedef struct {
+  unsigned int       samples[M64P_PROF_MODE_COUNT];
+  unsigned int       blocks;
+  unsigned int       dropped;
+  unsigned long long mem_accesses;
+  unsigned long long mem_ns; /* estimated from timed accesses */
+} m64p_profiler_stats;
+
 /* ------------------------------------------------- */
 /* Structures and Types for Core Video Extension API */
 /* ------------------------------------------------- */
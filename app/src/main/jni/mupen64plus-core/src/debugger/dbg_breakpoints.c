@@ -36,76 +36,65 @@ m64p_breakpoint g_Breakpoints[BREAKPOINTS_MAX_NUMBER];
 
 int add_breakpoint( uint32 address )
 {
+    int bpt;
+
     if( g_NumBreakpoints == BREAKPOINTS_MAX_NUMBER ) {
         DebugMessage(M64MSG_ERROR, "BREAKPOINTS_MAX_NUMBER have been reached.");
         return -1;
     }
-    g_Breakpoints[g_NumBreakpoints].address=address;
-    g_Breakpoints[g_NumBreakpoints].endaddr=address;
-    BPT_SET_FLAG(g_Breakpoints[g_NumBreakpoints], M64P_BKP_FLAG_EXEC);
+    bpt = g_NumBreakpoints++;
+    g_Breakpoints[bpt].address=address;
+    g_Breakpoints[bpt].endaddr=address;
+    BPT_SET_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_EXEC);
 
-    enable_breakpoint(g_NumBreakpoints);
+    /* counted first: the watched pages are recomputed through lookup_breakpoint() */
+    enable_breakpoint(bpt);
 
-    return g_NumBreakpoints++;
+    return bpt;
 }
 
 int add_breakpoint_struct(m64p_breakpoint *newbp)
 {
+     int bpt;
+
      if( g_NumBreakpoints == BREAKPOINTS_MAX_NUMBER ) {
         DebugMessage(M64MSG_ERROR, "BREAKPOINTS_MAX_NUMBER have been reached.");
         return -1;
     }
 
-    memcpy(&g_Breakpoints[g_NumBreakpoints], newbp, sizeof(m64p_breakpoint));
+    bpt = g_NumBreakpoints++;
+    memcpy(&g_Breakpoints[bpt], newbp, sizeof(m64p_breakpoint));
 
-    if (BPT_CHECK_FLAG(g_Breakpoints[g_NumBreakpoints], M64P_BKP_FLAG_ENABLED)) {
-        BPT_CLEAR_FLAG(g_Breakpoints[g_NumBreakpoints], M64P_BKP_FLAG_ENABLED);
-        enable_breakpoint( g_NumBreakpoints );
+    if (BPT_CHECK_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED)) {
+        BPT_CLEAR_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
+        enable_breakpoint( bpt );
     }
     
-    return g_NumBreakpoints++;
+    return bpt;
 }
 
-void enable_breakpoint( int bpt)
+/* Refresh the watched pages of every region covered by a read/write breakpoint */
+static void update_breakpoint_watch(const m64p_breakpoint *bpt)
 {
-    m64p_breakpoint *curBpt = g_Breakpoints + bpt;
     uint64 bptAddr;
-    
-    if (BPT_CHECK_FLAG((*curBpt), M64P_BKP_FLAG_READ)) {
-        for (bptAddr = curBpt->address; bptAddr <= (curBpt->endaddr | 0xFFFF); bptAddr+=0x10000)
-            if (lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ) == -1)
-                activate_memory_break_read(&g_dev.mem, (uint32) bptAddr);
-    }
 
-    if (BPT_CHECK_FLAG((*curBpt), M64P_BKP_FLAG_WRITE)) {
-        for (bptAddr = curBpt->address; bptAddr <= (curBpt->endaddr | 0xFFFF); bptAddr+=0x10000)
-            if (lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE) == -1)
-                activate_memory_break_write(&g_dev.mem, (uint32) bptAddr);
-    }
-    
+    if (!BPT_CHECK_FLAG((*bpt), M64P_BKP_FLAG_READ) && !BPT_CHECK_FLAG((*bpt), M64P_BKP_FLAG_WRITE))
+        return;
+
+    for (bptAddr = bpt->address; bptAddr <= ((unsigned long)(bpt->endaddr | 0xFFFF)); bptAddr+=0x10000)
+        update_memory_watch(&g_dev.mem, (uint32) bptAddr);
+}
+
+void enable_breakpoint( int bpt)
+{
     BPT_SET_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
+    update_breakpoint_watch(g_Breakpoints + bpt);
 }
 
 void disable_breakpoint( int bpt )
 {
-    m64p_breakpoint *curBpt = g_Breakpoints + bpt;
-    uint64 bptAddr;
-
-    BPT_CLEAR_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
-
-    if (BPT_CHECK_FLAG((*curBpt), M64P_BKP_FLAG_READ)) {
-        for (bptAddr = curBpt->address; bptAddr <= ((unsigned long)(curBpt->endaddr | 0xFFFF)); bptAddr+=0x10000)
-            if (lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ) == -1)
-                deactivate_memory_break_read(&g_dev.mem, (uint32) bptAddr);
-    }
-
-    if (BPT_CHECK_FLAG((*curBpt), M64P_BKP_FLAG_WRITE)) {
-        for (bptAddr = curBpt->address; bptAddr <= ((unsigned long)(curBpt->endaddr | 0xFFFF)); bptAddr+=0x10000)
-            if (lookup_breakpoint((uint32) bptAddr & 0xFFFF0000, 0x10000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE) == -1)
-                deactivate_memory_break_write(&g_dev.mem, (uint32) bptAddr);
-    }
-
     BPT_CLEAR_FLAG(g_Breakpoints[bpt], M64P_BKP_FLAG_ENABLED);
+    update_breakpoint_watch(g_Breakpoints + bpt);
 }
 
 void remove_breakpoint_by_num( int bpt )
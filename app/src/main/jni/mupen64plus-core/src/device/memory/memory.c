@@ -35,6 +35,7 @@
 #include "main/main.h"
 
 #ifdef DBG
+#include <stdlib.h>
 #include <string.h>
 
 #include "debugger/dbg_breakpoints.h"
@@ -1023,136 +1024,243 @@ static void write_ddd(void)
 }
 
 #ifdef DBG
+static struct watched_region* find_watched_region(struct memory* mem, uint16_t region)
+{
+    size_t lo = 0;
+    size_t hi = mem->watched_count;
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+
+        if (mem->watched[mid].region == region)
+            return &mem->watched[mid];
+        else if (mem->watched[mid].region < region)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return NULL;
+}
+
+static int is_page_watched(const uint16_t* watch, uint32_t address)
+{
+    return (watch[address >> 16] >> ((address >> 12) & 0xf)) & 1;
+}
+
+/* Only accesses to a watched page pay for the breakpoint lookup, other pages
+ * of the region go straight to the original handler. The handler is fetched
+ * before checking breakpoints because the debugger may unhook the region
+ * while paused. */
 static void readmemb_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 1,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->read[0];
 
-    g_dev.mem.saved_readmemb[*memory_address()>>16]();
+    if (is_page_watched(g_dev.mem.watch_read, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 1,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+
+    handler();
 }
 
 static void readmemh_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 2,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->read[1];
+
+    if (is_page_watched(g_dev.mem.watch_read, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 2,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
 
-    g_dev.mem.saved_readmemh[*memory_address()>>16]();
+    handler();
 }
 
 static void readmem_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 4,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->read[2];
 
-    g_dev.mem.saved_readmem[*memory_address()>>16]();
+    if (is_page_watched(g_dev.mem.watch_read, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 4,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+
+    handler();
 }
 
 static void readmemd_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 8,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->read[3];
+
+    if (is_page_watched(g_dev.mem.watch_read, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 8,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
 
-    g_dev.mem.saved_readmemd[*memory_address()>>16]();
+    handler();
 }
 
 static void writememb_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 1,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->write[0];
 
-    return g_dev.mem.saved_writememb[*memory_address()>>16]();
+    if (is_page_watched(g_dev.mem.watch_write, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 1,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+
+    handler();
 }
 
 static void writememh_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 2,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->write[1];
+
+    if (is_page_watched(g_dev.mem.watch_write, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 2,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
 
-    return g_dev.mem.saved_writememh[*memory_address()>>16]();
+    handler();
 }
 
 static void writemem_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 4,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->write[2];
 
-    return g_dev.mem.saved_writemem[*memory_address()>>16]();
+    if (is_page_watched(g_dev.mem.watch_write, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 4,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+
+    handler();
 }
 
 static void writememd_with_bp_checks(void)
 {
-    check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 8,
-            M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+    void (*handler)(void) = find_watched_region(&g_dev.mem, *memory_address() >> 16)->write[3];
+
+    if (is_page_watched(g_dev.mem.watch_write, *memory_address()))
+        check_breakpoints_on_mem_access(*r4300_pc()-0x4, *memory_address(), 8,
+                M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
 
-    return g_dev.mem.saved_writememd[*memory_address()>>16]();
+    handler();
 }
 
-void activate_memory_break_read(struct memory* mem, uint32_t address)
+static uint16_t compute_watched_pages(uint16_t region, uint32_t flags)
 {
-    uint16_t region = address >> 16;
+    uint16_t pages = 0;
+    unsigned int i;
 
-    if (mem->saved_readmem[region] == NULL)
+    for (i = 0; i < 16; ++i)
     {
-        mem->saved_readmemb[region] = mem->readmemb[region];
-        mem->saved_readmemh[region] = mem->readmemh[region];
-        mem->saved_readmem [region] = mem->readmem [region];
-        mem->saved_readmemd[region] = mem->readmemd[region];
-        mem->readmemb[region] = readmemb_with_bp_checks;
-        mem->readmemh[region] = readmemh_with_bp_checks;
-        mem->readmem [region] = readmem_with_bp_checks;
-        mem->readmemd[region] = readmemd_with_bp_checks;
+        if (lookup_breakpoint(((uint32_t)region << 16) | (i << 12), 0x1000, flags) != -1)
+            pages |= (1 << i);
     }
+
+    return pages;
 }
 
-void deactivate_memory_break_read(struct memory* mem, uint32_t address)
+static struct watched_region* add_watched_region(struct memory* mem, uint16_t region)
 {
-    uint16_t region = address >> 16;
+    struct watched_region* w;
+    size_t i;
 
-    if (mem->saved_readmem[region] != NULL)
+    if (mem->watched_count == mem->watched_capacity)
     {
-        mem->readmemb[region] = mem->saved_readmemb[region];
-        mem->readmemh[region] = mem->saved_readmemh[region];
-        mem->readmem [region] = mem->saved_readmem [region];
-        mem->readmemd[region] = mem->saved_readmemd[region];
-        mem->saved_readmemb[region] = NULL;
-        mem->saved_readmemh[region] = NULL;
-        mem->saved_readmem [region] = NULL;
-        mem->saved_readmemd[region] = NULL;
+        size_t capacity = (mem->watched_capacity == 0) ? 16 : 2 * mem->watched_capacity;
+        w = realloc(mem->watched, capacity * sizeof(*w));
+        if (w == NULL)
+        {
+            DebugMessage(M64MSG_ERROR, "Failed to allocate watched memory region");
+            return NULL;
+        }
+        mem->watched = w;
+        mem->watched_capacity = capacity;
     }
+
+    for (i = mem->watched_count; i > 0 && mem->watched[i-1].region > region; --i)
+        mem->watched[i] = mem->watched[i-1];
+    ++mem->watched_count;
+
+    w = &mem->watched[i];
+    w->region = region;
+    w->read[0] = mem->readmemb[region];
+    w->read[1] = mem->readmemh[region];
+    w->read[2] = mem->readmem [region];
+    w->read[3] = mem->readmemd[region];
+    w->write[0] = mem->writememb[region];
+    w->write[1] = mem->writememh[region];
+    w->write[2] = mem->writemem [region];
+    w->write[3] = mem->writememd[region];
+
+    return w;
 }
 
-void activate_memory_break_write(struct memory* mem, uint32_t address)
+static void remove_watched_region(struct memory* mem, struct watched_region* w)
 {
-    uint16_t region = address >> 16;
+    size_t i;
+
+    for (i = w - mem->watched; i + 1 < mem->watched_count; ++i)
+        mem->watched[i] = mem->watched[i+1];
+    --mem->watched_count;
+}
+
+static void hook_watched_region(struct memory* mem, const struct watched_region* w)
+{
+    uint16_t region = w->region;
+
+    if (mem->watch_read[region] != 0)
+    {
+        mem->readmemb[region] = readmemb_with_bp_checks;
+        mem->readmemh[region] = readmemh_with_bp_checks;
+        mem->readmem [region] = readmem_with_bp_checks;
+        mem->readmemd[region] = readmemd_with_bp_checks;
+    }
+    else
+    {
+        mem->readmemb[region] = w->read[0];
+        mem->readmemh[region] = w->read[1];
+        mem->readmem [region] = w->read[2];
+        mem->readmemd[region] = w->read[3];
+    }
 
-    if (mem->saved_writemem[region] == NULL)
+    if (mem->watch_write[region] != 0)
     {
-        mem->saved_writememb[region] = mem->writememb[region];
-        mem->saved_writememh[region] = mem->writememh[region];
-        mem->saved_writemem [region] = mem->writemem [region];
-        mem->saved_writememd[region] = mem->writememd[region];
         mem->writememb[region] = writememb_with_bp_checks;
         mem->writememh[region] = writememh_with_bp_checks;
         mem->writemem [region] = writemem_with_bp_checks;
         mem->writememd[region] = writememd_with_bp_checks;
     }
+    else
+    {
+        mem->writememb[region] = w->write[0];
+        mem->writememh[region] = w->write[1];
+        mem->writemem [region] = w->write[2];
+        mem->writememd[region] = w->write[3];
+    }
 }
 
-void deactivate_memory_break_write(struct memory* mem, uint32_t address)
+void update_memory_watch(struct memory* mem, uint32_t address)
 {
     uint16_t region = address >> 16;
+    struct watched_region* w = find_watched_region(mem, region);
+
+    mem->watch_read[region] = compute_watched_pages(region, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
+    mem->watch_write[region] = compute_watched_pages(region, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
+
+    if (mem->watch_read[region] == 0 && mem->watch_write[region] == 0)
+    {
+        if (w != NULL)
+        {
+            hook_watched_region(mem, w);
+            remove_watched_region(mem, w);
+        }
+        return;
+    }
 
-    if (mem->saved_writemem[region] != NULL)
+    if (w == NULL)
     {
-        mem->writememb[region] = mem->saved_writememb[region];
-        mem->writememh[region] = mem->saved_writememh[region];
-        mem->writemem [region] = mem->saved_writemem [region];
-        mem->writememd[region] = mem->saved_writememd[region];
-        mem->saved_writememb[region] = NULL;
-        mem->saved_writememh[region] = NULL;
-        mem->saved_writemem [region] = NULL;
-        mem->saved_writememd[region] = NULL;
+        w = add_watched_region(mem, region);
+        if (w == NULL)
+            return;
     }
+
+    hook_watched_region(mem, w);
 }
 
 int get_memory_type(struct memory* mem, uint32_t address)
@@ -1170,8 +1278,9 @@ void poweron_memory(struct memory* mem)
     int i;
 
 #ifdef DBG
-    memset(mem->saved_readmem, 0, 0x10000*sizeof(mem->saved_readmem[0]));
-    memset(mem->saved_writemem, 0, 0x10000*sizeof(mem->saved_writemem[0]));
+    memset(mem->watch_read, 0, 0x10000*sizeof(mem->watch_read[0]));
+    memset(mem->watch_write, 0, 0x10000*sizeof(mem->watch_write[0]));
+    mem->watched_count = 0;
 #endif
 
     /* clear mappings */
@@ -1361,17 +1470,14 @@ static void map_region_r(struct memory* mem,
         void (*read64)(void))
 {
 #ifdef DBG
-    if (lookup_breakpoint(((uint32_t)region << 16), 0x10000,
-                          M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ) != -1)
+    struct watched_region* w = find_watched_region(mem, region);
+    if (w != NULL)
     {
-        mem->saved_readmemb[region] = read8;
-        mem->saved_readmemh[region] = read16;
-        mem->saved_readmem [region] = read32;
-        mem->saved_readmemd[region] = read64;
-        mem->readmemb[region] = readmemb_with_bp_checks;
-        mem->readmemh[region] = readmemh_with_bp_checks;
-        mem->readmem [region] = readmem_with_bp_checks;
-        mem->readmemd[region] = readmemd_with_bp_checks;
+        w->read[0] = read8;
+        w->read[1] = read16;
+        w->read[2] = read32;
+        w->read[3] = read64;
+        hook_watched_region(mem, w);
     }
     else
 #endif
@@ -1391,17 +1497,14 @@ static void map_region_w(struct memory* mem,
         void (*write64)(void))
 {
 #ifdef DBG
-    if (lookup_breakpoint(((uint32_t)region << 16), 0x10000,
-                          M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE) != -1)
+    struct watched_region* w = find_watched_region(mem, region);
+    if (w != NULL)
     {
-        mem->saved_writememb[region] = write8;
-        mem->saved_writememh[region] = write16;
-        mem->saved_writemem [region] = write32;
-        mem->saved_writememd[region] = write64;
-        mem->writememb[region] = writememb_with_bp_checks;
-        mem->writememh[region] = writememh_with_bp_checks;
-        mem->writemem [region] = writemem_with_bp_checks;
-        mem->writememd[region] = writememd_with_bp_checks;
+        w->write[0] = write8;
+        w->write[1] = write16;
+        w->write[2] = write32;
+        w->write[3] = write64;
+        hook_watched_region(mem, w);
     }
     else
 #endif
@@ -1428,6 +1531,16 @@ void map_region(struct memory* mem,
     map_region_t(mem, region, type);
     map_region_r(mem, region, read8, read16, read32, read64);
     map_region_w(mem, region, write8, write16, write32, write64);
+
+#ifdef DBG
+    /* watch regions with breakpoints set before they were mapped */
+    if (find_watched_region(mem, region) == NULL
+     && (lookup_breakpoint(((uint32_t)region << 16), 0x10000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ) != -1
+      || lookup_breakpoint(((uint32_t)region << 16), 0x10000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE) != -1))
+    {
+        update_memory_watch(mem, (uint32_t)region << 16);
+    }
+#endif
 }
 
 uint32_t *fast_mem_access(uint32_t address)
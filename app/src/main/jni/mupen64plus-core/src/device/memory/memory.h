@@ -53,17 +53,27 @@ struct memory
 
 #ifdef DBG
     int memtype[0x10000];
-    void (*saved_readmemb[0x10000])(void);
-    void (*saved_readmemh[0x10000])(void);
-    void (*saved_readmem [0x10000])(void);
-    void (*saved_readmemd[0x10000])(void);
-    void (*saved_writememb[0x10000])(void);
-    void (*saved_writememh[0x10000])(void);
-    void (*saved_writemem [0x10000])(void);
-    void (*saved_writememd[0x10000])(void);
+
+    /* per-region bitmask of 4KB pages holding a read/write watchpoint */
+    uint16_t watch_read[0x10000];
+    uint16_t watch_write[0x10000];
+
+    /* original handlers of watched regions, sorted by region */
+    struct watched_region* watched;
+    size_t watched_count;
+    size_t watched_capacity;
 #endif
 };
 
+#ifdef DBG
+struct watched_region
+{
+    uint16_t region;
+    void (*read[4])(void);  /* 8, 16, 32, 64 bits */
+    void (*write[4])(void);
+};
+#endif
+
 uint32_t* memory_address();
 uint8_t*  memory_wbyte();
 uint16_t* memory_whword();
@@ -73,14 +83,36 @@ uint64_t* memory_wdword();
 /* struct memory definition is required prior including this */
 #include "main/main.h"
 
-#define read_word_in_memory() g_dev.mem.readmem[*memory_address()>>16]()
-#define read_byte_in_memory() g_dev.mem.readmemb[*memory_address()>>16]()
-#define read_hword_in_memory() g_dev.mem.readmemh[*memory_address()>>16]()
-#define read_dword_in_memory() g_dev.mem.readmemd[*memory_address()>>16]()
-#define write_word_in_memory() g_dev.mem.writemem[*memory_address()>>16]()
-#define write_byte_in_memory() g_dev.mem.writememb[*memory_address() >>16]()
-#define write_hword_in_memory() g_dev.mem.writememh[*memory_address() >>16]()
-#define write_dword_in_memory() g_dev.mem.writememd[*memory_address() >>16]()
+/* memory handlers are timed by the block profiler when it is enabled,
+ * and filtered by the lockstep checker while its shadow interpreter runs */
+#if defined(LOCKSTEP_R4300)
+#define call_memory_handler(handler) \
+    do { \
+        if (g_dev.r4300.lockstep.shadow) \
+            lockstep_mem_handler(&g_dev.r4300.lockstep, (handler)); \
+        else if (g_dev.r4300.profiler.enabled) \
+            block_profiler_mem_handler(&g_dev.r4300.profiler, (handler)); \
+        else \
+            (handler)(); \
+    } while(0)
+#else
+#define call_memory_handler(handler) \
+    do { \
+        if (g_dev.r4300.profiler.enabled) \
+            block_profiler_mem_handler(&g_dev.r4300.profiler, (handler)); \
+        else \
+            (handler)(); \
+    } while(0)
+#endif
+
+#define read_word_in_memory() call_memory_handler(g_dev.mem.readmem[*memory_address()>>16])
+#define read_byte_in_memory() call_memory_handler(g_dev.mem.readmemb[*memory_address()>>16])
+#define read_hword_in_memory() call_memory_handler(g_dev.mem.readmemh[*memory_address()>>16])
+#define read_dword_in_memory() call_memory_handler(g_dev.mem.readmemd[*memory_address()>>16])
+#define write_word_in_memory() call_memory_handler(g_dev.mem.writemem[*memory_address()>>16])
+#define write_byte_in_memory() call_memory_handler(g_dev.mem.writememb[*memory_address() >>16])
+#define write_hword_in_memory() call_memory_handler(g_dev.mem.writememh[*memory_address() >>16])
+#define write_dword_in_memory() call_memory_handler(g_dev.mem.writememd[*memory_address() >>16])
 
 #ifndef M64P_BIG_ENDIAN
 #if defined(__GNUC__) && (__GNUC__ > 4  || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
@@ -150,10 +182,11 @@ void write_rdramFBd(void);
 uint32_t *fast_mem_access(uint32_t address);
 
 #ifdef DBG
-void activate_memory_break_read(struct memory* mem, uint32_t address);
-void deactivate_memory_break_read(struct memory* mem, uint32_t address);
-void activate_memory_break_write(struct memory* mem, uint32_t address);
-void deactivate_memory_break_write(struct memory* mem, uint32_t address);
+/* Recompute the watched pages of the region containing address from the
+ * enabled breakpoints, and hook or unhook the region handlers accordingly.
+ * Must be called whenever a read/write breakpoint is added, removed,
+ * enabled or disabled. */
+void update_memory_watch(struct memory* mem, uint32_t address);
 int get_memory_type(struct memory* mem, uint32_t address);
 #endif
 
@@ -0,0 +1,283 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - block_profiler.c                                        *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "block_profiler.h"
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "interrupt.h"
+#include "r4300_core.h"
+
+void block_profiler_start(struct block_profiler* prof, unsigned int period)
+{
+    prof->period = (period != 0) ? period : BLOCK_PROFILER_DEFAULT_PERIOD;
+    if (prof->jitter == 0) {
+        prof->jitter = 0xace1u;
+    }
+    prof->enabled = 1;
+}
+
+void block_profiler_stop(struct block_profiler* prof)
+{
+    prof->enabled = 0;
+}
+
+void block_profiler_reset(struct block_profiler* prof)
+{
+    prof->used = 0;
+    prof->dropped = 0;
+    memset(prof->total_samples, 0, sizeof(prof->total_samples));
+    memset(prof->blocks, 0, sizeof(prof->blocks));
+
+    prof->mem_accesses = 0;
+    prof->mem_timed_accesses = 0;
+    prof->mem_timed_ns = 0;
+}
+
+
+/* Galois LFSR used to randomize the sampling period a little, so that
+ * samples don't alias with loops whose length divides the period. */
+static unsigned int next_delay(struct block_profiler* prof)
+{
+    uint32_t lfsr = prof->jitter;
+    lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xb400u);
+    prof->jitter = lfsr;
+
+    return prof->period - (prof->period >> 3) + (lfsr % ((prof->period >> 2) + 1));
+}
+
+void block_profiler_arm(struct r4300_core* r4300)
+{
+    struct block_profiler* prof = &r4300->profiler;
+
+    /* the interrupt queue may have been cleared (reset, savestate load) */
+    if (prof->armed && get_event(&r4300->cp0.q, PROFILE_INT) == 0) {
+        prof->armed = 0;
+    }
+
+    if (prof->enabled && !prof->armed)
+    {
+        add_interrupt_event(&r4300->cp0, PROFILE_INT, next_delay(prof));
+        prof->armed = 1;
+    }
+}
+
+static struct hot_block_entry* lookup_block(struct block_profiler* prof, uint32_t address)
+{
+    unsigned int i = ((address >> 2) * UINT32_C(2654435761)) & (BLOCK_PROFILER_TABLE_SIZE - 1);
+    unsigned int n;
+
+    for (n = 0; n < BLOCK_PROFILER_TABLE_SIZE; ++n)
+    {
+        struct hot_block_entry* e = &prof->blocks[i];
+
+        if (e->address == address && (e->samples[0] | e->samples[1] | e->samples[2]) != 0) {
+            return e;
+        }
+
+        if ((e->samples[0] | e->samples[1] | e->samples[2]) == 0)
+        {
+            /* keep the table at most 3/4 full to bound probe length */
+            if (prof->used >= (BLOCK_PROFILER_TABLE_SIZE / 4) * 3) {
+                return NULL;
+            }
+            e->address = address;
+            ++prof->used;
+            return e;
+        }
+
+        i = (i + 1) & (BLOCK_PROFILER_TABLE_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+static m64p_dbg_prof_mode current_mode(const struct r4300_core* r4300)
+{
+    if (r4300->emumode != EMUMODE_DYNAREC) {
+        return M64P_PROF_MODE_INTERPRETER;
+    }
+
+    return (r4300->dyna_interp)
+        ? M64P_PROF_MODE_HELPER
+        : M64P_PROF_MODE_DYNAREC;
+}
+
+void block_profiler_int_handler(struct r4300_core* r4300)
+{
+    struct block_profiler* prof = &r4300->profiler;
+    struct hot_block_entry* e;
+    m64p_dbg_prof_mode mode;
+
+    prof->armed = 0;
+
+    if (!prof->enabled) {
+        return;
+    }
+
+    mode = current_mode(r4300);
+    e = lookup_block(prof, *r4300_pc());
+
+    if (e != NULL) {
+        ++e->samples[mode];
+    }
+    else {
+        ++prof->dropped;
+    }
+    ++prof->total_samples[mode];
+
+    block_profiler_arm(r4300);
+}
+
+void block_profiler_mem_handler(struct block_profiler* prof, void (*handler)(void))
+{
+    uint64_t start;
+
+    if ((prof->mem_accesses++ & ((1 << BLOCK_PROFILER_MEM_TIMING_SHIFT) - 1)) != 0)
+    {
+        handler();
+        return;
+    }
+
+    start = SDL_GetPerformanceCounter();
+    handler();
+    prof->mem_timed_ns += (SDL_GetPerformanceCounter() - start) * 1000000000ull / SDL_GetPerformanceFrequency();
+    ++prof->mem_timed_accesses;
+}
+
+
+static unsigned int block_total(const struct hot_block_entry* e)
+{
+    return e->samples[0] + e->samples[1] + e->samples[2];
+}
+
+static int compare_hot_blocks(const void* a, const void* b)
+{
+    const m64p_hot_block* ba = (const m64p_hot_block*)a;
+    const m64p_hot_block* bb = (const m64p_hot_block*)b;
+    unsigned int ta = ba->samples[0] + ba->samples[1] + ba->samples[2];
+    unsigned int tb = bb->samples[0] + bb->samples[1] + bb->samples[2];
+
+    if (ta != tb) {
+        return (ta < tb) ? 1 : -1;
+    }
+
+    return (ba->address < bb->address) ? -1 : (ba->address > bb->address);
+}
+
+int block_profiler_get_hot_blocks(const struct block_profiler* prof, m64p_hot_block* blocks, unsigned int max_blocks)
+{
+    m64p_hot_block* all;
+    unsigned int i, n = 0;
+
+    if (blocks == NULL || max_blocks == 0) {
+        return prof->used;
+    }
+
+    all = malloc(prof->used * sizeof(*all) + 1);
+    if (all == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < BLOCK_PROFILER_TABLE_SIZE && n < prof->used; ++i)
+    {
+        const struct hot_block_entry* e = &prof->blocks[i];
+        if (block_total(e) == 0) {
+            continue;
+        }
+
+        all[n].address = e->address;
+        memcpy(all[n].samples, e->samples, sizeof(all[n].samples));
+        ++n;
+    }
+
+    qsort(all, n, sizeof(*all), compare_hot_blocks);
+
+    if (n > max_blocks) {
+        n = max_blocks;
+    }
+    memcpy(blocks, all, n * sizeof(*all));
+    free(all);
+
+    return n;
+}
+
+void block_profiler_get_stats(const struct block_profiler* prof, m64p_profiler_stats* stats)
+{
+    memcpy(stats->samples, prof->total_samples, sizeof(stats->samples));
+    stats->blocks = prof->used;
+    stats->dropped = prof->dropped;
+    stats->mem_accesses = prof->mem_accesses;
+    stats->mem_ns = (prof->mem_timed_accesses == 0)
+        ? 0
+        : prof->mem_timed_ns * prof->mem_accesses / prof->mem_timed_accesses;
+}
+
+int block_profiler_write_report(const struct block_profiler* prof, const char* filename)
+{
+    static const char* mode_names[M64P_PROF_MODE_COUNT] = { "dynarec", "interp", "helper" };
+
+    m64p_profiler_stats stats;
+    m64p_hot_block* blocks;
+    unsigned int total, i;
+    int n;
+    FILE* f;
+
+    blocks = malloc(BLOCK_PROFILER_TABLE_SIZE * sizeof(*blocks));
+    if (blocks == NULL) {
+        return -1;
+    }
+
+    f = fopen(filename, "w");
+    if (f == NULL)
+    {
+        DebugMessage(M64MSG_ERROR, "Couldn't open profiler report file: %s", filename);
+        free(blocks);
+        return -1;
+    }
+
+    block_profiler_get_stats(prof, &stats);
+    n = block_profiler_get_hot_blocks(prof, blocks, BLOCK_PROFILER_TABLE_SIZE);
+    total = stats.samples[0] + stats.samples[1] + stats.samples[2];
+
+    fprintf(f, "# r4300 hot blocks: %u samples (%u dynarec, %u interp, %u helper), %u blocks, %u dropped\n",
+            total, stats.samples[M64P_PROF_MODE_DYNAREC], stats.samples[M64P_PROF_MODE_INTERPRETER],
+            stats.samples[M64P_PROF_MODE_HELPER], stats.blocks, stats.dropped);
+    fprintf(f, "# memory handlers: %llu accesses, ~%llu ns\n", stats.mem_accesses, stats.mem_ns);
+    fprintf(f, "# address   percent  %8s %8s %8s\n", mode_names[0], mode_names[1], mode_names[2]);
+
+    for (i = 0; n > 0 && i < (unsigned int)n; ++i)
+    {
+        unsigned int t = blocks[i].samples[0] + blocks[i].samples[1] + blocks[i].samples[2];
+        fprintf(f, "%08x  %6.2f%%  %8u %8u %8u\n",
+                blocks[i].address, (total != 0) ? 100.0 * t / total : 0.0,
+                blocks[i].samples[0], blocks[i].samples[1], blocks[i].samples[2]);
+    }
+
+    fclose(f);
+    free(blocks);
+
+    return n;
+}
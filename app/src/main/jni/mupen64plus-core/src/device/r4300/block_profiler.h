@@ -0,0 +1,84 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - block_profiler.h                                        *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_DEVICE_R4300_BLOCK_PROFILER_H
+#define M64P_DEVICE_R4300_BLOCK_PROFILER_H
+
+#include <stdint.h>
+
+#include "api/m64p_types.h"
+
+struct r4300_core;
+
+/* Sampling profiler for the r4300 core.
+ *
+ * When enabled, a PROFILE_INT event is kept in the interrupt queue and every
+ * time it fires the current PC and emulation mode are recorded. Samples are
+ * aggregated per address in a small open-addressing table. Time spent in memory handlers dispatched through the
+ * *_in_memory() macros is measured on a subset of accesses.
+ */
+
+enum { BLOCK_PROFILER_TABLE_SIZE = 4096 };      /* must be a power of 2 */
+enum { BLOCK_PROFILER_DEFAULT_PERIOD = 10000 }; /* in count cycles */
+enum { BLOCK_PROFILER_MEM_TIMING_SHIFT = 6 };   /* time 1 access out of 64 */
+
+struct hot_block_entry
+{
+    uint32_t address;
+    unsigned int samples[M64P_PROF_MODE_COUNT];
+};
+
+struct block_profiler
+{
+    /* set by the front-end, polled by the emulation thread */
+    volatile int enabled;
+    int armed;
+
+    unsigned int period;
+    uint32_t jitter;
+
+    unsigned int used;
+    unsigned int dropped;
+    unsigned int total_samples[M64P_PROF_MODE_COUNT];
+    struct hot_block_entry blocks[BLOCK_PROFILER_TABLE_SIZE];
+
+    unsigned long long mem_accesses;
+    unsigned long long mem_timed_accesses;
+    unsigned long long mem_timed_ns;
+};
+
+void block_profiler_start(struct block_profiler* prof, unsigned int period);
+void block_profiler_stop(struct block_profiler* prof);
+void block_profiler_reset(struct block_profiler* prof);
+
+/* Called from gen_interrupt to (re)schedule the PROFILE_INT event */
+void block_profiler_arm(struct r4300_core* r4300);
+
+/* PROFILE_INT handler */
+void block_profiler_int_handler(struct r4300_core* r4300);
+
+/* Run a memory handler, measuring its host time on a subset of calls */
+void block_profiler_mem_handler(struct block_profiler* prof, void (*handler)(void));
+
+int block_profiler_get_hot_blocks(const struct block_profiler* prof, m64p_hot_block* blocks, unsigned int max_blocks);
+void block_profiler_get_stats(const struct block_profiler* prof, m64p_profiler_stats* stats);
+int block_profiler_write_report(const struct block_profiler* prof, const char* filename);
+
+#endif /* M64P_DEVICE_R4300_BLOCK_PROFILER_H */
@@ -32,6 +32,8 @@
 #include "device/memory/memory.h"
 #include "device/r4300/cached_interp.h"
 #include "device/r4300/exception.h"
+#include "device/r4300/exec_trace.h"
+#include "device/r4300/lockstep.h"
 #include "device/r4300/interrupt.h"
 #include "device/r4300/macros.h"
 #include "device/r4300/ops.h"
@@ -63,6 +65,8 @@
       const int take_jump = (condition); \
       const uint32_t jump_target = (destination); \
       int64_t *link_register = (link); \
+      TRACE_JUMP_DECLARE(); \
+      LOCKSTEP_BLOCK_END(); \
       if (cop1 && check_cop1_unusable(&g_dev.r4300)) return; \
       if (link_register != &r4300_regs()[0]) \
       { \
@@ -87,13 +91,17 @@
          cp0_update_count(); \
       } \
       g_dev.r4300.cp0.last_addr = *r4300_pc(); \
+      TRACE_JUMP(take_jump); \
       if (*r4300_cp0_next_interrupt() <= r4300_cp0_regs()[CP0_COUNT_REG]) gen_interrupt(); \
+      LOCKSTEP_BLOCK_START(); \
    } \
    static void name##_OUT(void) \
    { \
       const int take_jump = (condition); \
       const uint32_t jump_target = (destination); \
       int64_t *link_register = (link); \
+      TRACE_JUMP_DECLARE(); \
+      LOCKSTEP_BLOCK_END(); \
       if (cop1 && check_cop1_unusable(&g_dev.r4300)) return; \
       if (link_register != &r4300_regs()[0]) \
       { \
@@ -118,7 +126,9 @@
          cp0_update_count(); \
       } \
       g_dev.r4300.cp0.last_addr = *r4300_pc(); \
+      TRACE_JUMP(take_jump); \
       if (*r4300_cp0_next_interrupt() <= r4300_cp0_regs()[CP0_COUNT_REG]) gen_interrupt(); \
+      LOCKSTEP_BLOCK_START(); \
    } \
    static void name##_IDLE(void) \
    { \
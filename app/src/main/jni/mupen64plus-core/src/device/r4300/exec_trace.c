@@ -0,0 +1,303 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - exec_trace.c                                            *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "exec_trace.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "cp0.h"
+#include "device/memory/memory.h"
+#include "r4300_core.h"
+
+#if !defined(O_BINARY)
+#define O_BINARY 0
+#endif
+
+static const int crash_signals[] = {
+    SIGSEGV, SIGILL, SIGFPE, SIGABRT,
+#if defined(SIGBUS)
+    SIGBUS,
+#endif
+};
+
+/* trace flushed by the crash and exit hooks */
+static const struct exec_trace* crash_trace;
+static void (*previous_handlers[sizeof(crash_signals) / sizeof(crash_signals[0])])(int);
+static int exit_hook_installed;
+
+static uint8_t* put_varint(uint8_t* p, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+
+    return p;
+}
+
+static uint8_t* put_u32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+
+    return p + 4;
+}
+
+static uint8_t* put_u64(uint8_t* p, uint64_t value)
+{
+    unsigned int i;
+
+    for (i = 0; i < 8; ++i)
+    {
+        *p++ = (uint8_t)value;
+        value >>= 8;
+    }
+
+    return p;
+}
+
+static uint8_t* current_chunk(const struct exec_trace* trace)
+{
+    return trace->buffer + (size_t)(trace->sequence % trace->chunk_count) * EXEC_TRACE_CHUNK_SIZE;
+}
+
+static void start_chunk(struct exec_trace* trace)
+{
+    struct exec_trace_chunk_header header;
+    uint8_t* chunk;
+
+    ++trace->sequence;
+    chunk = current_chunk(trace);
+
+    /* zero the whole chunk so that stale records read as EXEC_TRACE_TAG_END */
+    memset(chunk, 0, EXEC_TRACE_CHUNK_SIZE);
+
+    header.sequence = trace->sequence;
+    header.pc = trace->block_pc;
+    header.count = trace->count;
+    memcpy(chunk, &header, sizeof(header));
+
+    trace->pos = sizeof(header);
+}
+
+/* Only uses lseek() and write() so that it can run from crash_handler. */
+static int write_chunks(const struct exec_trace* trace, uint32_t* written)
+{
+    uint32_t header[2];
+    uint32_t chunks;
+    uint64_t first, seq;
+
+    if (trace->buffer == NULL || trace->fd < 0 || trace->sequence == UINT64_C(0xffffffffffffffff))
+        return -1;
+
+    first = (trace->sequence + 1 > trace->chunk_count)
+        ? trace->sequence + 1 - trace->chunk_count
+        : 0;
+    chunks = (uint32_t)(trace->sequence + 1 - first);
+
+    header[0] = EXEC_TRACE_CHUNK_SIZE;
+    header[1] = chunks;
+
+    /* the file only grows (chunks never decreases) so rewriting it in place
+     * needs no truncation */
+    if (lseek(trace->fd, 0, SEEK_SET) != 0
+     || write(trace->fd, EXEC_TRACE_MAGIC, 8) != 8
+     || write(trace->fd, header, sizeof(header)) != (int)sizeof(header))
+        return -1;
+
+    for (seq = first; seq <= trace->sequence; ++seq)
+    {
+        if (write(trace->fd, trace->buffer + (size_t)(seq % trace->chunk_count) * EXEC_TRACE_CHUNK_SIZE,
+                  EXEC_TRACE_CHUNK_SIZE) != EXEC_TRACE_CHUNK_SIZE)
+            return -1;
+    }
+
+    if (written != NULL)
+        *written = chunks;
+
+    return 0;
+}
+
+static void crash_handler(int sig)
+{
+    unsigned int i;
+
+    if (crash_trace != NULL)
+        write_chunks(crash_trace, NULL);
+
+    /* hand the signal over to whoever handled it before us */
+    for (i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++i)
+    {
+        if (crash_signals[i] == sig)
+            signal(sig, previous_handlers[i]);
+    }
+    raise(sig);
+}
+
+static void exit_handler(void)
+{
+    if (crash_trace != NULL)
+        write_chunks(crash_trace, NULL);
+}
+
+int exec_trace_init(struct exec_trace* trace, size_t chunk_count, int with_regs, const char* filename)
+{
+    unsigned int i;
+
+    memset(trace, 0, sizeof(*trace));
+    trace->fd = -1;
+
+    trace->buffer = malloc(chunk_count * EXEC_TRACE_CHUNK_SIZE);
+    if (trace->buffer == NULL)
+    {
+        DebugMessage(M64MSG_ERROR, "Failed to allocate execution trace buffer");
+        return -1;
+    }
+
+    /* opened now so that the trace can still be written after a crash */
+    trace->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (trace->fd < 0)
+    {
+        DebugMessage(M64MSG_ERROR, "Couldn't open execution trace file: %s", filename);
+        exec_trace_release(trace);
+        return -1;
+    }
+
+    trace->filename = filename;
+    trace->chunk_count = chunk_count;
+    trace->with_regs = with_regs;
+    trace->sequence = UINT64_C(0xffffffffffffffff);
+    trace->pos = EXEC_TRACE_CHUNK_SIZE;
+
+    /* the trace is most useful when emulation dies, which skips
+     * exec_trace_write: flush it on fatal signals and on exit() too */
+    crash_trace = trace;
+    for (i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++i)
+        previous_handlers[i] = signal(crash_signals[i], crash_handler);
+
+    if (!exit_hook_installed)
+        exit_hook_installed = (atexit(exit_handler) == 0);
+
+    return 0;
+}
+
+void exec_trace_release(struct exec_trace* trace)
+{
+    unsigned int i;
+
+    if (crash_trace == trace)
+    {
+        crash_trace = NULL;
+        for (i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++i)
+            signal(crash_signals[i], previous_handlers[i]);
+    }
+
+    if (trace->fd >= 0)
+        close(trace->fd);
+    trace->fd = -1;
+
+    free(trace->buffer);
+    trace->buffer = NULL;
+}
+
+void exec_trace_jump(struct exec_trace* trace, uint32_t pc, int taken, uint32_t target)
+{
+    uint32_t count = r4300_cp0_regs()[CP0_COUNT_REG];
+    const uint32_t* op;
+    int32_t target_delta = (int32_t)(target - (pc + 8)) >> 2;
+    uint8_t* p;
+    uint8_t* tag;
+
+    if (trace->buffer == NULL)
+        return;
+
+    if (trace->pos + EXEC_TRACE_MAX_RECORD > EXEC_TRACE_CHUNK_SIZE)
+        start_chunk(trace);
+
+    p = current_chunk(trace) + trace->pos;
+    tag = p++;
+    *tag = EXEC_TRACE_TAG_JUMP | (taken ? EXEC_TRACE_FLAG_TAKEN : 0);
+
+    p = put_varint(p, (pc - trace->block_pc) >> 2);
+    op = fast_mem_access(pc);
+    p = put_u32(p, (op != NULL) ? *op : 0);
+    p = put_varint(p, ((uint32_t)target_delta << 1) ^ (uint32_t)(target_delta >> 31));
+    p = put_varint(p, count - trace->count);
+
+    if (trace->with_regs)
+    {
+        const int64_t* regs = r4300_regs();
+        uint32_t mask = 0;
+        unsigned int i;
+
+        for (i = 1; i < 32; ++i)
+        {
+            if (regs[i] != trace->regs[i])
+                mask |= (UINT32_C(1) << i);
+        }
+
+        if (mask != 0)
+        {
+            *tag |= EXEC_TRACE_FLAG_REGS;
+            p = put_varint(p, mask);
+            for (i = 1; i < 32; ++i)
+            {
+                if (mask & (UINT32_C(1) << i))
+                {
+                    p = put_u64(p, (uint64_t)regs[i]);
+                    trace->regs[i] = regs[i];
+                }
+            }
+        }
+    }
+
+    trace->pos = p - current_chunk(trace);
+    trace->block_pc = target;
+    trace->count = count;
+}
+
+int exec_trace_write(const struct exec_trace* trace)
+{
+    uint32_t chunks;
+
+    if (write_chunks(trace, &chunks) != 0)
+    {
+        if (trace->fd >= 0 && trace->sequence != UINT64_C(0xffffffffffffffff))
+            DebugMessage(M64MSG_ERROR, "Couldn't write execution trace file: %s", trace->filename);
+        return -1;
+    }
+
+    DebugMessage(M64MSG_INFO, "Wrote %u execution trace chunks to %s", chunks, trace->filename);
+    return 0;
+}
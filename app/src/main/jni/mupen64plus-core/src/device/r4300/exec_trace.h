@@ -0,0 +1,103 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - exec_trace.h                                            *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_DEVICE_R4300_EXEC_TRACE_H
+#define M64P_DEVICE_R4300_EXEC_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Execution trace recorder.
+ *
+ * Every jump/branch executed by the interpreters appends a record to a ring
+ * of fixed-size chunks. Each chunk starts with an absolute header so it can
+ * be decoded on its own, and records inside it are delta/varint encoded:
+ *
+ *   tag      : 1 byte, EXEC_TRACE_TAG_JUMP | EXEC_TRACE_FLAG_*
+ *   offset   : varint, (branch pc - block entry pc) / 4
+ *   opcode   : 4 bytes little endian, the branch instruction
+ *   target   : zigzag varint, (target - (branch pc + 8)) / 4
+ *   count    : varint, count register delta since previous record
+ *   [regmask : varint, bitmask of GPRs changed since previous record
+ *    values  : 8 bytes little endian per changed GPR]
+ *
+ * The trace is written to a file as a EXEC_TRACE_MAGIC header followed by
+ * the chunks, oldest first. tools/tracedecode.c decodes and compares them.
+ * The file is opened by exec_trace_init and rewritten when emulation stops,
+ * on exit() and on fatal signals (SIGSEGV, SIGABRT, ...).
+ *
+ * Only the pure and cached interpreters record jumps: code compiled by the
+ * dynamic recompilers is not traced.
+ */
+
+#define EXEC_TRACE_MAGIC "M64PTRC1"
+
+enum
+{
+    EXEC_TRACE_CHUNK_SIZE   = 4096,
+    EXEC_TRACE_CHUNK_COUNT  = 256,
+    /* tag + 3 varints + opcode + regmask + 32 registers */
+    EXEC_TRACE_MAX_RECORD   = 1 + 3*5 + 4 + 5 + 32*8,
+
+    EXEC_TRACE_TAG_END      = 0x00,
+    EXEC_TRACE_TAG_JUMP     = 0x01,
+    EXEC_TRACE_FLAG_TAKEN   = 0x10,
+    EXEC_TRACE_FLAG_REGS    = 0x20
+};
+
+struct exec_trace_chunk_header
+{
+    uint64_t sequence;
+    uint32_t pc;        /* block entry pc */
+    uint32_t count;     /* count register */
+};
+
+struct exec_trace
+{
+    int fd;
+    const char* filename;
+
+    uint8_t* buffer;
+    size_t chunk_count;
+    uint64_t sequence;  /* sequence number of the current chunk */
+    size_t pos;         /* write position in the current chunk */
+
+    int with_regs;
+    uint32_t block_pc;
+    uint32_t count;
+    int64_t regs[32];
+};
+
+int exec_trace_init(struct exec_trace* trace, size_t chunk_count, int with_regs, const char* filename);
+void exec_trace_release(struct exec_trace* trace);
+
+void exec_trace_jump(struct exec_trace* trace, uint32_t pc, int taken, uint32_t target);
+
+int exec_trace_write(const struct exec_trace* trace);
+
+#if defined(TRACE_R4300)
+#define TRACE_JUMP_DECLARE() const uint32_t trace_pc = PCADDR
+#define TRACE_JUMP(taken) exec_trace_jump(&g_dev.r4300.trace, trace_pc, (taken), PCADDR)
+#else
+#define TRACE_JUMP_DECLARE()
+#define TRACE_JUMP(taken) do { } while(0)
+#endif
+
+#endif /* M64P_DEVICE_R4300_EXEC_TRACE_H */
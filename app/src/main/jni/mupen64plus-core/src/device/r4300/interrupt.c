@@ -32,6 +32,7 @@
 #include "device/ai/ai_controller.h"
 #include "device/pi/pi_controller.h"
 #include "device/pifbootrom/pifbootrom.h"
+#include "device/r4300/block_profiler.h"
 #include "device/r4300/cached_interp.h"
 #include "device/r4300/exception.h"
 #include "device/r4300/mi_controller.h"
@@ -42,6 +43,7 @@
 #include "device/rsp/rsp_core.h"
 #include "device/si/si_controller.h"
 #include "device/vi/vi_controller.h"
+#include "main/input_latency.h"
 #include "main/main.h"
 #include "main/savestates.h"
 
@@ -299,6 +301,10 @@ int save_eventqueue_infos(struct cp0* cp0, char *buf)
 
     for (e = cp0->q.first; e != NULL; e = e->next)
     {
+        /* profiler events are host-side only */
+        if (e->data.type == PROFILE_INT)
+            continue;
+
         memcpy(buf + len    , &e->data.type , 4);
         memcpy(buf + len + 4, &e->data.count, 4);
         len += 8;
@@ -539,7 +545,7 @@ void gen_interrupt(void)
         dyna_stop();
     }
 
-    if (!r4300->cp0.interrupt_unsafe_state)
+    if (!r4300->cp0.interrupt_unsafe_state && !input_latency_emulating_ahead())
     {
         if (savestates_get_job() == savestates_job_load)
         {
@@ -569,6 +575,9 @@ void gen_interrupt(void)
         return;
     }
 
+    if (r4300->profiler.enabled)
+        block_profiler_arm(r4300);
+
     switch (r4300->cp0.q.first->data.type)
     {
         case SPECIAL_INT:
@@ -622,6 +631,11 @@ void gen_interrupt(void)
             nmi_int_handler(&g_dev);
             break;
 
+        case PROFILE_INT:
+            remove_interrupt_event(&r4300->cp0);
+            block_profiler_int_handler(r4300);
+            break;
+
         default:
             DebugMessage(M64MSG_ERROR, "Unknown interrupt queue event type %.8X.", r4300->cp0.q.first->data.type);
             remove_interrupt_event(&r4300->cp0);
@@ -631,7 +645,9 @@ void gen_interrupt(void)
 
     if (!r4300->cp0.interrupt_unsafe_state)
     {
-        if (savestates_get_job() == savestates_job_save)
+        input_latency_snapshot();
+
+        if (!input_latency_emulating_ahead() && savestates_get_job() == savestates_job_save)
         {
             savestates_save();
             return;
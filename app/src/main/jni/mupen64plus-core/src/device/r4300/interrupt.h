@@ -56,5 +56,6 @@ void load_eventqueue_infos(struct cp0* cp0, const char *buf);
 #define DP_INT      0x100
 #define HW2_INT     0x200
 #define NMI_INT     0x400
+#define PROFILE_INT 0x800
 
 #endif /* M64P_DEVICE_R4300_INTERRUPT_H */
@@ -0,0 +1,421 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - lockstep.c                                              *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "lockstep.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "cp0.h"
+#include "cp1.h"
+#include "device/memory/memory.h"
+#include "device/ri/rdram.h"
+#include "main/main.h"
+#include "pure_interp.h"
+#include "r4300_core.h"
+
+enum
+{
+    LOCKSTEP_OP_PLAIN,
+    LOCKSTEP_OP_JUMP,
+    LOCKSTEP_OP_UNSUPPORTED
+};
+
+static const char* gpr_names[32] =
+{
+    "r0", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "s8", "ra"
+};
+
+static void save_state(struct lockstep_state* s)
+{
+    memcpy(s->regs, r4300_regs(), sizeof(s->regs));
+    s->hi = *r4300_mult_hi();
+    s->lo = *r4300_mult_lo();
+    s->llbit = *r4300_llbit();
+    memcpy(s->fpr, r4300_cp1_regs(), sizeof(s->fpr));
+    s->fcr31 = *r4300_cp1_fcr31();
+}
+
+static void load_state(const struct lockstep_state* s)
+{
+    memcpy(r4300_regs(), s->regs, sizeof(s->regs));
+    *r4300_mult_hi() = s->hi;
+    *r4300_mult_lo() = s->lo;
+    *r4300_llbit() = s->llbit;
+    memcpy(r4300_cp1_regs(), s->fpr, sizeof(s->fpr));
+    *r4300_cp1_fcr31() = s->fcr31;
+}
+
+static int64_t state_slot(const struct lockstep_state* s, unsigned int slot)
+{
+    if (slot < 32) { return s->regs[slot]; }
+    if (slot == 32) { return s->hi; }
+    if (slot == 33) { return s->lo; }
+    if (slot == 34) { return s->llbit; }
+    if (slot < 67) { return s->fpr[slot - 35]; }
+    return s->fcr31;
+}
+
+static const char* slot_name(unsigned int slot, char* buf)
+{
+    static const char* names[] = { "hi", "lo", "llbit" };
+
+    if (slot < 32) { return gpr_names[slot]; }
+    if (slot < 35) { return names[slot - 32]; }
+    if (slot < 67)
+    {
+        sprintf(buf, "f%u", slot - 35);
+        return buf;
+    }
+    return "fcr31";
+}
+
+static int classify_op(uint32_t op)
+{
+    uint32_t funct = op & 0x3f;
+    uint32_t rt = (op >> 16) & 0x1f;
+
+    switch (op >> 26)
+    {
+    case 0: /* SPECIAL */
+        if (funct == 8 || funct == 9) { return LOCKSTEP_OP_JUMP; }         /* JR, JALR */
+        if (funct == 12 || funct == 13) { return LOCKSTEP_OP_UNSUPPORTED; } /* SYSCALL, BREAK */
+        if (funct >= 48 && funct <= 54) { return LOCKSTEP_OP_UNSUPPORTED; } /* traps */
+        return LOCKSTEP_OP_PLAIN;
+    case 1: /* REGIMM: branches or traps */
+        return ((rt & 0x0c) == 0) ? LOCKSTEP_OP_JUMP : LOCKSTEP_OP_UNSUPPORTED;
+    case 2: case 3: case 4: case 5: case 6: case 7:
+    case 20: case 21: case 22: case 23:
+        return LOCKSTEP_OP_JUMP;
+    case 17: /* COP1 */
+        if (((op >> 21) & 0x1f) == 8) { return LOCKSTEP_OP_JUMP; }         /* BC1 */
+        /* fallthrough */
+    case 49: case 53: case 57: case 61: /* LWC1, LDC1, SWC1, SDC1 */
+        /* the coprocessor unusable exception is left to the dynarec */
+        return (r4300_cp0_regs()[CP0_STATUS_REG] & CP0_STATUS_CU1)
+            ? LOCKSTEP_OP_PLAIN
+            : LOCKSTEP_OP_UNSUPPORTED;
+    case 16: /* COP0 */
+    case 18: case 19: case 28: case 29: case 30: case 31:
+    case 47: /* CACHE */
+    case 50: case 51: case 52: case 54: case 58: case 59: case 60: case 62:
+        return LOCKSTEP_OP_UNSUPPORTED;
+    default:
+        return LOCKSTEP_OP_PLAIN;
+    }
+}
+
+/* Runs the block starting at ls->start_pc on the pure interpreter, up to
+ * and excluding the next jump. If diverged is not NULL, every instruction
+ * is logged with the registers it changes, and last_writer receives for
+ * each slot the pc of the last instruction which wrote it. */
+static void run_shadow(struct r4300_core* r4300, struct lockstep* ls,
+                       const struct lockstep_state* diverged, uint32_t* last_writer)
+{
+    struct precomp_instr* saved_pc = *r4300_pc_struct();
+    uint32_t saved_last_addr = r4300->cp0.last_addr;
+    struct lockstep_state before, after;
+    unsigned int n, slot;
+    char buf[8];
+
+    *r4300_pc_struct() = &r4300->interp_PC;
+    r4300->interp_PC.addr = ls->start_pc;
+    ls->shadow = 1;
+    ls->aborted = 0;
+    ls->write_count = 0;
+
+    for (n = 0; n < LOCKSTEP_MAX_BLOCK_LENGTH; ++n)
+    {
+        uint32_t pc = r4300->interp_PC.addr;
+        const uint32_t* op = fast_mem_access(pc);
+        int kind;
+
+        if (op == NULL)
+        {
+            ls->aborted = 1;
+            break;
+        }
+
+        kind = classify_op(*op);
+        if (kind == LOCKSTEP_OP_JUMP) {
+            break;
+        }
+        if (kind == LOCKSTEP_OP_UNSUPPORTED)
+        {
+            ls->aborted = 1;
+            break;
+        }
+
+        if (diverged != NULL) {
+            save_state(&before);
+        }
+
+        ls->current_pc = pc;
+        pure_interpreter_step();
+
+        if (ls->aborted || r4300->interp_PC.addr != pc + 4)
+        {
+            ls->aborted = 1;
+            break;
+        }
+
+        if (diverged == NULL) {
+            continue;
+        }
+
+        save_state(&after);
+        for (slot = 1; slot < LOCKSTEP_SLOTS; ++slot)
+        {
+            int64_t value = state_slot(&after, slot);
+
+            if (value == state_slot(&before, slot)) {
+                continue;
+            }
+
+            last_writer[slot] = pc;
+            DebugMessage(M64MSG_INFO, "  %08x: %08x  %-5s <- %016llx%s",
+                         pc, *op, slot_name(slot, buf), (unsigned long long)value,
+                         (value != state_slot(diverged, slot)) ? "  (dynarec differs)" : "");
+        }
+    }
+
+    if (n == LOCKSTEP_MAX_BLOCK_LENGTH) {
+        ls->aborted = 1;
+    }
+
+    ls->end_pc = r4300->interp_PC.addr;
+    ls->length = n;
+    ls->shadow = 0;
+
+    *r4300_pc_struct() = saved_pc;
+    r4300->cp0.last_addr = saved_last_addr;
+}
+
+static void undo_writes(struct lockstep* ls)
+{
+    uint32_t* dram = g_dev.ri.rdram.dram;
+    unsigned int i;
+
+    for (i = 0; i < ls->write_count; ++i) {
+        ls->writes[i].new_value = dram[ls->writes[i].index];
+    }
+
+    for (i = ls->write_count; i-- > 0; ) {
+        dram[ls->writes[i].index] = ls->writes[i].old_value;
+    }
+}
+
+static void report_divergence(struct r4300_core* r4300, struct lockstep* ls,
+                              const struct lockstep_state* current)
+{
+    const uint32_t* dram = g_dev.ri.rdram.dram;
+    struct lockstep_write expected_writes[LOCKSTEP_MAX_WRITES];
+    uint32_t last_writer[LOCKSTEP_SLOTS];
+    uint32_t suspect = 0;
+    unsigned int slot, i, write_count = ls->write_count;
+    char buf[8];
+
+    memcpy(expected_writes, ls->writes, write_count * sizeof(expected_writes[0]));
+    memset(last_writer, 0, sizeof(last_writer));
+
+    DebugMessage(M64MSG_ERROR, "Lockstep: dynarec diverges from interpreter in block %08x-%08x (count %08x)",
+                 ls->start_pc, ls->end_pc, r4300_cp0_regs()[CP0_COUNT_REG]);
+
+    /* narrow down to the instruction: replay the block one instruction at
+     * a time from its entry state, then put the dynarec state back */
+    load_state(&ls->entry);
+    run_shadow(r4300, ls, current, last_writer);
+    undo_writes(ls);
+    load_state(current);
+
+    for (slot = 1; slot < LOCKSTEP_SLOTS; ++slot)
+    {
+        if (state_slot(current, slot) == state_slot(&ls->expected, slot)) {
+            continue;
+        }
+
+        DebugMessage(M64MSG_ERROR, "  %-5s: dynarec %016llx, interpreter %016llx, last written at %08x",
+                     slot_name(slot, buf),
+                     (unsigned long long)state_slot(current, slot),
+                     (unsigned long long)state_slot(&ls->expected, slot),
+                     last_writer[slot]);
+
+        if (last_writer[slot] != 0 && (suspect == 0 || last_writer[slot] < suspect)) {
+            suspect = last_writer[slot];
+        }
+    }
+
+    for (i = 0; i < write_count; ++i)
+    {
+        const struct lockstep_write* w = &expected_writes[i];
+
+        if (dram[w->index] == w->new_value) {
+            continue;
+        }
+
+        DebugMessage(M64MSG_ERROR, "  rdram[%08x]: dynarec %08x, interpreter %08x, written at %08x",
+                     w->index << 2, dram[w->index], w->new_value, w->pc);
+
+        if (suspect == 0 || w->pc < suspect) {
+            suspect = w->pc;
+        }
+    }
+
+    if (suspect != 0) {
+        DebugMessage(M64MSG_ERROR, "Lockstep: first diverging instruction at %08x", suspect);
+    }
+}
+
+static int same_result(const struct lockstep* ls, const struct lockstep_state* current)
+{
+    const uint32_t* dram = g_dev.ri.rdram.dram;
+    unsigned int i;
+
+    if (memcmp(current->regs + 1, ls->expected.regs + 1, 31 * sizeof(current->regs[0])) != 0
+     || current->hi != ls->expected.hi
+     || current->lo != ls->expected.lo
+     || current->llbit != ls->expected.llbit
+     || memcmp(current->fpr, ls->expected.fpr, sizeof(current->fpr)) != 0
+     || current->fcr31 != ls->expected.fcr31) {
+        return 0;
+    }
+
+    for (i = 0; i < ls->write_count; ++i)
+    {
+        if (dram[ls->writes[i].index] != ls->writes[i].new_value) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+void lockstep_init(struct lockstep* ls)
+{
+    memset(ls, 0, sizeof(*ls));
+    ls->enabled = 1;
+}
+
+void lockstep_report(const struct lockstep* ls)
+{
+    DebugMessage(M64MSG_INFO, "Lockstep: %u blocks compared, %u skipped, %u divergences",
+                 ls->compared, ls->skipped, ls->divergences);
+}
+
+void lockstep_block_end(struct lockstep* ls, struct r4300_core* r4300)
+{
+    struct lockstep_state current;
+
+    if (!ls->pending) {
+        return;
+    }
+    ls->pending = 0;
+
+    /* the dynarec left the block through an exception */
+    if (*r4300_pc() != ls->end_pc)
+    {
+        ++ls->skipped;
+        return;
+    }
+
+    ++ls->compared;
+    save_state(&current);
+    if (same_result(ls, &current)) {
+        return;
+    }
+
+    ++ls->divergences;
+    report_divergence(r4300, ls, &current);
+
+    /* stop at the first divergence, the following state is meaningless */
+    ls->enabled = 0;
+    *r4300_stop() = 1;
+}
+
+void lockstep_block_start(struct lockstep* ls, struct r4300_core* r4300)
+{
+    ls->pending = 0;
+    if (!ls->enabled || r4300->emumode != EMUMODE_DYNAREC || *r4300_stop()) {
+        return;
+    }
+
+    ls->start_pc = *r4300_pc();
+    save_state(&ls->entry);
+    run_shadow(r4300, ls, NULL, NULL);
+    save_state(&ls->expected);
+    undo_writes(ls);
+    load_state(&ls->entry);
+
+    if (ls->aborted)
+    {
+        ++ls->skipped;
+        return;
+    }
+
+    ls->pending = 1;
+}
+
+void lockstep_mem_handler(struct lockstep* ls, void (*handler)(void))
+{
+    uint32_t index = rdram_dram_address(*memory_address());
+    unsigned int words, i;
+
+    if (handler == read_rdram || handler == read_rdramb
+     || handler == read_rdramh || handler == read_rdramd)
+    {
+        handler();
+        return;
+    }
+
+    if (handler == write_rdram || handler == write_rdramb || handler == write_rdramh) {
+        words = 1;
+    }
+    else if (handler == write_rdramd) {
+        words = 2;
+    }
+    else
+    {
+        /* not RDRAM: side effects can't be undone */
+        ls->aborted = 1;
+        return;
+    }
+
+    if (ls->write_count + words > LOCKSTEP_MAX_WRITES)
+    {
+        ls->aborted = 1;
+        return;
+    }
+
+    for (i = 0; i < words; ++i)
+    {
+        struct lockstep_write* w = &ls->writes[ls->write_count++];
+        w->index = index + i;
+        w->old_value = g_dev.ri.rdram.dram[index + i];
+        w->pc = ls->current_pc;
+    }
+
+    handler();
+}
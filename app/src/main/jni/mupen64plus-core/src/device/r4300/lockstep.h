@@ -0,0 +1,109 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - lockstep.h                                              *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_DEVICE_R4300_LOCKSTEP_H
+#define M64P_DEVICE_R4300_LOCKSTEP_H
+
+#include <stdint.h>
+
+struct r4300_core;
+
+/* In-process lockstep checker for the dynarec.
+ *
+ * With jumps forced through the interpreter (NoCompiledJump), every jump
+ * is a block boundary where C code runs. When a jump completes, the pure
+ * interpreter runs the following straight-line block as a shadow core,
+ * with its RDRAM writes journaled and undone, and the register state at
+ * the next jump is recorded. The state is then restored and the dynarec
+ * runs the same block. When it reaches that next jump, both results are
+ * compared. On a mismatch the block is replayed one instruction at a time
+ * to point at the first instruction producing a diverging value.
+ *
+ * Blocks touching COP0, anything but RDRAM, or raising exceptions are
+ * not shadowed.
+ */
+
+enum
+{
+    LOCKSTEP_MAX_BLOCK_LENGTH = 1024,
+    LOCKSTEP_MAX_WRITES       = 2 * LOCKSTEP_MAX_BLOCK_LENGTH,
+
+    /* GPRs, hi, lo, llbit, FPRs, fcr31 */
+    LOCKSTEP_SLOTS            = 32 + 3 + 32 + 1
+};
+
+struct lockstep_state
+{
+    int64_t regs[32];
+    int64_t hi;
+    int64_t lo;
+    unsigned int llbit;
+    int64_t fpr[32];
+    uint32_t fcr31;
+};
+
+struct lockstep_write
+{
+    uint32_t index;     /* RDRAM word index */
+    uint32_t old_value;
+    uint32_t new_value;
+    uint32_t pc;        /* instruction doing the write */
+};
+
+struct lockstep
+{
+    int enabled;
+    int shadow;         /* set while the shadow interpreter runs */
+    int aborted;        /* shadow hit something it can't replay */
+    int pending;        /* a shadow result waits for the dynarec */
+
+    uint32_t start_pc;
+    uint32_t end_pc;
+    uint32_t current_pc;
+    unsigned int length;
+
+    struct lockstep_state entry;
+    struct lockstep_state expected;
+
+    struct lockstep_write writes[LOCKSTEP_MAX_WRITES];
+    unsigned int write_count;
+
+    unsigned int compared;
+    unsigned int skipped;
+    unsigned int divergences;
+};
+
+void lockstep_init(struct lockstep* ls);
+void lockstep_report(const struct lockstep* ls);
+
+void lockstep_block_end(struct lockstep* ls, struct r4300_core* r4300);
+void lockstep_block_start(struct lockstep* ls, struct r4300_core* r4300);
+
+void lockstep_mem_handler(struct lockstep* ls, void (*handler)(void));
+
+#if defined(LOCKSTEP_R4300)
+#define LOCKSTEP_BLOCK_END() lockstep_block_end(&g_dev.r4300.lockstep, &g_dev.r4300)
+#define LOCKSTEP_BLOCK_START() lockstep_block_start(&g_dev.r4300.lockstep, &g_dev.r4300)
+#else
+#define LOCKSTEP_BLOCK_END() do { } while(0)
+#define LOCKSTEP_BLOCK_START() do { } while(0)
+#endif
+
+#endif /* M64P_DEVICE_R4300_LOCKSTEP_H */
@@ -33,6 +33,7 @@
 #include "device/r4300/cached_interp.h"
 #include "device/r4300/cp1.h"
 #include "device/r4300/exception.h"
+#include "device/r4300/exec_trace.h"
 #include "device/r4300/interrupt.h"
 #include "device/r4300/tlb.h"
 #include "main/main.h"
@@ -55,6 +56,7 @@ static void InterpretOpcode(void);
       const int take_jump = (condition); \
       const uint32_t jump_target = (destination); \
       int64_t *link_register = (link); \
+      TRACE_JUMP_DECLARE(); \
       if (cop1 && check_cop1_unusable(&g_dev.r4300)) return; \
       if (link_register != &r4300_regs()[0]) \
       { \
@@ -78,6 +80,7 @@ static void InterpretOpcode(void);
          cp0_update_count(); \
       } \
       g_dev.r4300.cp0.last_addr = g_dev.r4300.interp_PC.addr; \
+      TRACE_JUMP(take_jump); \
       if (*r4300_cp0_next_interrupt() <= r4300_cp0_regs()[CP0_COUNT_REG]) gen_interrupt(); \
    } \
    static void name##_IDLE(uint32_t op) \
@@ -720,6 +723,11 @@ void InterpretOpcode()
 	} /* switch ((op >> 26) & 0x3F) */
 }
 
+void pure_interpreter_step(void)
+{
+   InterpretOpcode();
+}
+
 void run_pure_interpreter(struct r4300_core* r4300)
 {
    *r4300_stop() = 0;
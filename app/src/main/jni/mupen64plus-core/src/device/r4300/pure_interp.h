@@ -26,4 +26,7 @@ struct r4300_core;
 
 void run_pure_interpreter(struct r4300_core* r4300);
 
+/* Executes the single instruction at interp_PC, for the lockstep checker */
+void pure_interpreter_step(void);
+
 #endif /* M64P_DEVICE_R4300_PURE_INTERP_H */
@@ -138,6 +138,10 @@ void run_r4300(struct r4300_core* r4300)
     memset(instr_count, 0, 131*sizeof(instr_count[0]));
 #endif
 
+#if defined(TRACE_R4300)
+    exec_trace_init(&r4300->trace, EXEC_TRACE_CHUNK_COUNT, TRACE_R4300 >= 2, "r4300trace.bin");
+#endif
+
     /* XXX: might go to r4300_poweron / soft_reset ? */
     r4300->cp0.last_addr = 0xa4000040;
     *r4300_cp0_next_interrupt() = 624999;
@@ -161,9 +165,18 @@ void run_r4300(struct r4300_core* r4300)
         new_dyna_start();
         new_dynarec_cleanup();
 #else
+#if defined(LOCKSTEP_R4300)
+        /* blocks are compared at jumps, which must go through the interpreter */
+        DebugMessage(M64MSG_INFO, "Lockstep checking against the pure interpreter enabled");
+        r4300->recomp.no_compiled_jump = 1;
+        lockstep_init(&r4300->lockstep);
+#endif
         dyna_start(dynarec_setup_code);
         (*r4300_pc_struct())++;
 #endif
+#if defined(LOCKSTEP_R4300)
+        lockstep_report(&r4300->lockstep);
+#endif
 #if defined(PROFILE_R4300)
         profile_write_end_of_code_blocks(r4300);
 #endif
@@ -191,6 +204,11 @@ void run_r4300(struct r4300_core* r4300)
 
     DebugMessage(M64MSG_INFO, "R4300 emulator finished.");
 
+#if defined(TRACE_R4300)
+    exec_trace_write(&r4300->trace);
+    exec_trace_release(&r4300->trace);
+#endif
+
     /* print instruction counts */
 #if defined(COUNT_INSTR)
     if (r4300->emumode == EMUMODE_DYNAREC)
@@ -328,3 +346,20 @@ void savestates_load_set_pc(struct r4300_core* r4300, uint32_t pc)
         invalidate_r4300_cached_code(r4300, 0, 0);
     }
 }
+
+/* Like savestates_load_set_pc, but keeps the cached code: the caller
+ * invalidates whatever it changed. */
+void snapshot_load_set_pc(struct r4300_core* r4300, uint32_t pc)
+{
+#ifdef NEW_DYNAREC
+    if (r4300->emumode == EMUMODE_DYNAREC)
+    {
+        pcaddr = pc;
+        pending_exception = 1;
+    }
+    else
+#endif
+    {
+        generic_jump_to(r4300, pc);
+    }
+}
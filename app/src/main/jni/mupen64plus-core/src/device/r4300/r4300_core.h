@@ -29,8 +29,11 @@
 #include <stdio.h>
 #endif
 
+#include "block_profiler.h"
 #include "cp0.h"
 #include "cp1.h"
+#include "exec_trace.h"
+#include "lockstep.h"
 #include "mi_controller.h"
 
 #include "ops.h" /* for cpu_instruction_table */
@@ -166,6 +169,16 @@ struct r4300_core
     struct cp1 cp1;
 
     struct mi_controller mi;
+
+    struct block_profiler profiler;
+
+#if defined(TRACE_R4300)
+    struct exec_trace trace;
+#endif
+
+#if defined(LOCKSTEP_R4300)
+    struct lockstep lockstep;
+#endif
 };
 
 void init_r4300(struct r4300_core* r4300, unsigned int emumode, unsigned int count_per_op, int no_compiled_jump);
@@ -197,5 +210,6 @@ void invalidate_r4300_cached_code(struct r4300_core* r4300, uint32_t address, si
 void generic_jump_to(struct r4300_core* r4300, unsigned int address);
 
 void savestates_load_set_pc(struct r4300_core* r4300, uint32_t pc);
+void snapshot_load_set_pc(struct r4300_core* r4300, uint32_t pc);
 
 #endif
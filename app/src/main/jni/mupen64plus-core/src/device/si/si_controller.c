@@ -28,6 +28,7 @@
 #include "device/memory/memory.h"
 #include "device/r4300/r4300_core.h"
 #include "device/ri/ri_controller.h"
+#include "main/input_latency.h"
 #include "main/main.h"
 
 enum
@@ -73,6 +74,8 @@ static void dma_si_read(struct si_controller* si)
         return;
     }
 
+    input_latency_pif_read();
+
     update_pif_read(si);
 
     for (i = 0; i < PIF_RAM_SIZE; i += 4)
@@ -26,6 +26,7 @@
 #include "api/m64p_types.h"
 #include "device/memory/memory.h"
 #include "device/r4300/r4300_core.h"
+#include "main/input_latency.h"
 #include "main/main.h"
 #include "plugin/plugin.h"
 
@@ -138,7 +139,8 @@ int write_vi_regs(void* opaque, uint32_t address, uint32_t value, uint32_t mask)
 
 void vi_vertical_interrupt_event(struct vi_controller* vi)
 {
-    gfx.updateScreen();
+    if (input_latency_present_frame())
+        gfx.updateScreen();
 
     /* allow main module to do things on VI event */
     new_vi();
@@ -0,0 +1,390 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - input_latency.c                                         *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "input_latency.h"
+
+#include <SDL.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "device/ai/ai_controller.h"
+#include "device/pi/pi_controller.h"
+#include "device/r4300/cp0.h"
+#include "device/r4300/cp1.h"
+#include "device/r4300/mi_controller.h"
+#include "device/r4300/new_dynarec/new_dynarec.h"
+#include "device/r4300/r4300_core.h"
+#include "device/r4300/tlb.h"
+#include "device/rdp/rdp_core.h"
+#include "device/ri/ri_controller.h"
+#include "device/rsp/rsp_core.h"
+#include "device/si/si_controller.h"
+#include "device/vi/vi_controller.h"
+#include "main.h"
+
+enum { REPORT_INTERVAL = 300 };
+enum { SNAPSHOT_PAGE_SIZE = 0x1000 };
+
+enum run_ahead_phase
+{
+    PHASE_REAL,
+    PHASE_AHEAD
+};
+
+static int l_late_polling = 0;
+static int l_run_ahead_frames = 0;
+static int l_report = 0;
+
+/* Device state rolled back by run-ahead. It is restored into the same
+ * g_dev it was taken from, so the pointers the structs hold stay valid. */
+struct run_ahead_snapshot
+{
+    struct ai_controller ai;
+    struct pi_controller pi;
+    struct ri_controller ri;
+    struct si_controller si;
+    struct vi_controller vi;
+    struct rsp_core sp;
+    struct mi_controller mi;
+    uint32_t dpc_regs[DPC_REGS_COUNT];
+    uint32_t dps_regs[DPS_REGS_COUNT];
+
+    int64_t regs[32];
+    int64_t hi;
+    int64_t lo;
+    unsigned int llbit;
+    uint32_t pc;
+    uint32_t cp0_regs[CP0_REGS_COUNT];
+    unsigned int next_interrupt;
+    struct interrupt_queue q;
+    int special_done;
+    int64_t cp1_regs[32];
+    uint32_t fcr0;
+    uint32_t fcr31;
+#ifdef NEW_DYNAREC
+    unsigned int using_tlb;
+#endif
+
+    /* the LUTs are only copied when the TLB entries change */
+    int tlb_saved;
+    struct tlb tlb;
+
+    /* RDRAM is copied and restored page by page, only where it differs */
+    uint32_t dram[RDRAM_MAX_SIZE/4];
+};
+
+static struct run_ahead_snapshot *l_snapshot = NULL;
+static enum run_ahead_phase l_phase = PHASE_REAL;
+static int l_ahead_left = 0;
+static int l_save_pending = 0;
+static int l_load_pending = 0;
+
+/* metrics */
+static Uint64 l_last_poll = 0;
+static unsigned int l_polls = 0;
+static unsigned int l_frame_polls = 0;
+static unsigned int l_frames = 0;
+static double l_total_ms = 0.0;
+static double l_max_ms = 0.0;
+static unsigned int l_total_polls = 0;
+
+static void invalidate_dram_page(struct r4300_core* r4300, const struct tlb* tlb, uint32_t addr)
+{
+    size_t i;
+
+    invalidate_r4300_cached_code(r4300, 0x80000000 + addr, SNAPSHOT_PAGE_SIZE);
+    invalidate_r4300_cached_code(r4300, 0xa0000000 + addr, SNAPSHOT_PAGE_SIZE);
+
+    /* the page may also hold code run through a TLB mapping */
+    for (i = 0; i < 32; ++i)
+    {
+        const struct tlb_entry* e = &tlb->entries[i];
+
+        if (e->v_even && addr >= e->phys_even && addr - e->phys_even <= e->end_even - e->start_even)
+            invalidate_r4300_cached_code(r4300, e->start_even + (addr - e->phys_even), SNAPSHOT_PAGE_SIZE);
+        if (e->v_odd && addr >= e->phys_odd && addr - e->phys_odd <= e->end_odd - e->start_odd)
+            invalidate_r4300_cached_code(r4300, e->start_odd + (addr - e->phys_odd), SNAPSHOT_PAGE_SIZE);
+    }
+}
+
+static void save_snapshot(struct run_ahead_snapshot* s)
+{
+    struct device* dev = &g_dev;
+    struct cp0* cp0 = &dev->r4300.cp0;
+    const unsigned char* dram = (const unsigned char*)dev->ri.rdram.dram;
+    unsigned char* saved_dram = (unsigned char*)s->dram;
+    size_t addr;
+
+    s->ai = dev->ai;
+    s->pi = dev->pi;
+    s->ri = dev->ri;
+    s->si = dev->si;
+    s->vi = dev->vi;
+    s->sp = dev->sp;
+    s->mi = dev->r4300.mi;
+    memcpy(s->dpc_regs, dev->dp.dpc_regs, sizeof(s->dpc_regs));
+    memcpy(s->dps_regs, dev->dp.dps_regs, sizeof(s->dps_regs));
+
+    memcpy(s->regs, r4300_regs(), sizeof(s->regs));
+    s->hi = *r4300_mult_hi();
+    s->lo = *r4300_mult_lo();
+    s->llbit = *r4300_llbit();
+    s->pc = *r4300_pc();
+    memcpy(s->cp0_regs, r4300_cp0_regs(), sizeof(s->cp0_regs));
+    s->next_interrupt = *r4300_cp0_next_interrupt();
+    s->q = cp0->q;
+    s->special_done = cp0->special_done;
+    memcpy(s->cp1_regs, r4300_cp1_regs(), sizeof(s->cp1_regs));
+    s->fcr0 = *r4300_cp1_fcr0();
+    s->fcr31 = *r4300_cp1_fcr31();
+#ifdef NEW_DYNAREC
+    s->using_tlb = using_tlb;
+#endif
+
+    if (!s->tlb_saved || memcmp(s->tlb.entries, cp0->tlb.entries, sizeof(s->tlb.entries)) != 0)
+    {
+        s->tlb = cp0->tlb;
+        s->tlb_saved = 1;
+    }
+
+    for (addr = 0; addr < dev->ri.rdram.dram_size; addr += SNAPSHOT_PAGE_SIZE)
+    {
+        if (memcmp(saved_dram + addr, dram + addr, SNAPSHOT_PAGE_SIZE) != 0)
+            memcpy(saved_dram + addr, dram + addr, SNAPSHOT_PAGE_SIZE);
+    }
+}
+
+static void load_snapshot(const struct run_ahead_snapshot* s)
+{
+    struct device* dev = &g_dev;
+    struct cp0* cp0 = &dev->r4300.cp0;
+    unsigned char* dram = (unsigned char*)dev->ri.rdram.dram;
+    const unsigned char* saved_dram = (const unsigned char*)s->dram;
+    int tlb_changed = (memcmp(s->tlb.entries, cp0->tlb.entries, sizeof(s->tlb.entries)) != 0);
+    size_t addr;
+
+    dev->ai = s->ai;
+    dev->pi = s->pi;
+    dev->ri = s->ri;
+    dev->si = s->si;
+    dev->vi = s->vi;
+    dev->sp = s->sp;
+    dev->r4300.mi = s->mi;
+    memcpy(dev->dp.dpc_regs, s->dpc_regs, sizeof(s->dpc_regs));
+    memcpy(dev->dp.dps_regs, s->dps_regs, sizeof(s->dps_regs));
+
+    memcpy(r4300_regs(), s->regs, sizeof(s->regs));
+    *r4300_mult_hi() = s->hi;
+    *r4300_mult_lo() = s->lo;
+    *r4300_llbit() = s->llbit;
+    memcpy(r4300_cp0_regs(), s->cp0_regs, sizeof(s->cp0_regs));
+    *r4300_cp0_next_interrupt() = s->next_interrupt;
+    cp0->q = s->q;
+    cp0->special_done = s->special_done;
+    /* the registers are kept in their live layout, no shuffle needed */
+    memcpy(r4300_cp1_regs(), s->cp1_regs, sizeof(s->cp1_regs));
+    set_fpr_pointers(s->cp0_regs[CP0_STATUS_REG]);
+    *r4300_cp1_fcr0() = s->fcr0;
+    *r4300_cp1_fcr31() = s->fcr31;
+    update_x86_rounding_mode(s->fcr31);
+#ifdef NEW_DYNAREC
+    using_tlb = s->using_tlb;
+#endif
+
+    if (tlb_changed)
+        cp0->tlb = s->tlb;
+
+    for (addr = 0; addr < dev->ri.rdram.dram_size; addr += SNAPSHOT_PAGE_SIZE)
+    {
+        if (memcmp(dram + addr, saved_dram + addr, SNAPSHOT_PAGE_SIZE) == 0)
+            continue;
+
+        memcpy(dram + addr, saved_dram + addr, SNAPSHOT_PAGE_SIZE);
+        if (!tlb_changed)
+            invalidate_dram_page(&dev->r4300, &cp0->tlb, (uint32_t)addr);
+    }
+
+    /* code translated through the old mappings is stale, drop all of it */
+    if (tlb_changed)
+        savestates_load_set_pc(&dev->r4300, s->pc);
+    else
+        snapshot_load_set_pc(&dev->r4300, s->pc);
+
+    *r4300_cp0_last_addr() = *r4300_pc();
+}
+
+static void record_poll(void)
+{
+    l_last_poll = SDL_GetPerformanceCounter();
+    ++l_polls;
+}
+
+static void record_present(void)
+{
+    double ms;
+
+    if (!l_report)
+        return;
+
+    ms = (l_last_poll == 0) ? 0.0
+        : (double)(SDL_GetPerformanceCounter() - l_last_poll) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+    DebugMessage(M64MSG_VERBOSE, "Input latency: %.2f ms from last poll to present (%u polls, %d frames ahead)",
+                 ms, l_frame_polls, l_run_ahead_frames);
+
+    l_total_ms += ms;
+    if (ms > l_max_ms)
+        l_max_ms = ms;
+    l_total_polls += l_frame_polls;
+
+    if (++l_frames == REPORT_INTERVAL)
+    {
+        DebugMessage(M64MSG_INFO, "Input latency over %u frames: avg %.2f ms, max %.2f ms, %.2f polls/frame, %d frames ahead",
+                     l_frames, l_total_ms / l_frames, l_max_ms, (double)l_total_polls / l_frames, l_run_ahead_frames);
+        l_frames = 0;
+        l_total_ms = 0.0;
+        l_max_ms = 0.0;
+        l_total_polls = 0;
+    }
+}
+
+void input_latency_init(int late_polling, int run_ahead_frames, int report)
+{
+    l_late_polling = late_polling;
+    l_run_ahead_frames = (run_ahead_frames > 0) ? run_ahead_frames : 0;
+    l_report = report;
+
+    l_phase = PHASE_REAL;
+    l_ahead_left = 0;
+    l_save_pending = 0;
+    l_load_pending = 0;
+
+    l_last_poll = 0;
+    l_polls = 0;
+    l_frame_polls = 0;
+    l_frames = 0;
+    l_total_ms = 0.0;
+    l_max_ms = 0.0;
+    l_total_polls = 0;
+
+    if (l_run_ahead_frames > 0)
+    {
+        l_snapshot = calloc(1, sizeof(*l_snapshot));
+        if (l_snapshot == NULL)
+        {
+            DebugMessage(M64MSG_ERROR, "Failed to allocate run-ahead snapshot, run-ahead disabled");
+            l_run_ahead_frames = 0;
+        }
+        else
+        {
+            DebugMessage(M64MSG_INFO, "Running %d frames ahead", l_run_ahead_frames);
+        }
+    }
+
+    if (l_late_polling)
+        DebugMessage(M64MSG_INFO, "Late input polling enabled");
+}
+
+void input_latency_deinit(void)
+{
+    free(l_snapshot);
+    l_snapshot = NULL;
+    l_run_ahead_frames = 0;
+    l_phase = PHASE_REAL;
+}
+
+void input_latency_pif_read(void)
+{
+    /* frames emulated ahead replay the inputs of the real frame */
+    if (l_phase == PHASE_AHEAD)
+        return;
+
+    if (l_late_polling)
+    {
+        main_check_inputs();
+        record_poll();
+    }
+}
+
+int input_latency_present_frame(void)
+{
+    if (l_run_ahead_frames == 0)
+        return 1;
+
+    return (l_phase == PHASE_AHEAD && l_ahead_left == 1);
+}
+
+int input_latency_new_vi(void)
+{
+    if (l_run_ahead_frames == 0)
+    {
+        record_present();
+        l_frame_polls = l_polls;
+        l_polls = 0;
+        if (!l_late_polling)
+            record_poll();
+        return 0;
+    }
+
+    if (l_phase == PHASE_REAL)
+    {
+        /* the real frame is over, the caller polls input for the next ones */
+        l_frame_polls = l_polls;
+        l_polls = 0;
+        if (!l_late_polling)
+            record_poll();
+
+        l_save_pending = 1;
+        l_phase = PHASE_AHEAD;
+        l_ahead_left = l_run_ahead_frames;
+        return 0;
+    }
+
+    if (--l_ahead_left == 0)
+    {
+        record_present();
+        l_load_pending = 1;
+    }
+
+    return 1;
+}
+
+int input_latency_emulating_ahead(void)
+{
+    return (l_phase == PHASE_AHEAD);
+}
+
+void input_latency_snapshot(void)
+{
+    if (l_save_pending)
+    {
+        save_snapshot(l_snapshot);
+        l_save_pending = 0;
+    }
+    else if (l_load_pending)
+    {
+        load_snapshot(l_snapshot);
+        l_load_pending = 0;
+        l_phase = PHASE_REAL;
+    }
+}
@@ -0,0 +1,54 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - input_latency.h                                         *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_MAIN_INPUT_LATENCY_H
+#define M64P_MAIN_INPUT_LATENCY_H
+
+/* Input latency reduction.
+ *
+ * Late polling pumps host input right before the PIF RAM is handed to the
+ * game instead of only once per VI.
+ *
+ * Run-ahead emulates N frames past each real frame with the inputs of the
+ * real frame, presents the last of them and then rewinds to an in-memory
+ * snapshot taken after the real frame. The snapshot copies the device
+ * structs and only the RDRAM pages that changed, and a rewind invalidates
+ * only the recompiled code of those pages. Only real frames produce audio,
+ * poll input and go through the speed limiter.
+ */
+
+void input_latency_init(int late_polling, int run_ahead_frames, int report);
+void input_latency_deinit(void);
+
+/* called when the game reads the PIF RAM */
+void input_latency_pif_read(void);
+
+/* called on VI, returns non-zero if the frame has to be presented */
+int input_latency_present_frame(void);
+
+/* called on VI after presentation, returns non-zero while emulating ahead */
+int input_latency_new_vi(void);
+
+int input_latency_emulating_ahead(void);
+
+/* saves or restores the run-ahead snapshot, at the end of gen_interrupt */
+void input_latency_snapshot(void);
+
+#endif
@@ -53,6 +53,7 @@
 #include "device/gb/gb_cart.h"
 #include "device/pifbootrom/pifbootrom.h"
 #include "eventloop.h"
+#include "input_latency.h"
 #include "main.h"
 #include "osal/files.h"
 #include "osal/preproc.h"
@@ -279,6 +280,9 @@ int main_set_core_defaults(void)
     ConfigSetDefaultInt(g_CoreConfig, "ViTiming", -1, "Use alternate VI timing (-1=Game default, 0=Don't use alternate timing, 1=Use alternate timing)");
     ConfigSetDefaultInt(g_CoreConfig, "CountPerScanline", -1, "Modify the default count per scanline(-1 or 0=Game default)");
     ConfigSetDefaultBool(g_CoreConfig, "DisableSpecRecomp", 1, "Disable speculative precompilation in new dynarec");
+    ConfigSetDefaultBool(g_CoreConfig, "LateInputPolling", 0, "Poll host input right before the game reads the controllers instead of once per frame");
+    ConfigSetDefaultInt(g_CoreConfig, "RunAheadFrames", 0, "Number of frames to emulate ahead of the displayed one to hide game input lag (0=disabled)");
+    ConfigSetDefaultBool(g_CoreConfig, "ReportInputLatency", 0, "Log input-to-present latency metrics");
 
     /* handle upgrades */
     if (bUpgrade)
@@ -852,6 +856,10 @@ void new_vi(void)
 {
     gs_apply_cheats();
 
+    /* frames emulated ahead only need cheats */
+    if (input_latency_new_vi())
+        return;
+
     main_check_inputs();
 
     timed_sections_refresh();
@@ -1105,6 +1113,10 @@ m64p_error main_run(void)
         init_debugger();
 #endif
 
+    input_latency_init(ConfigGetParamBool(g_CoreConfig, "LateInputPolling"),
+                       ConfigGetParamInt(g_CoreConfig, "RunAheadFrames"),
+                       ConfigGetParamBool(g_CoreConfig, "ReportInputLatency"));
+
     /* Startup message on the OSD */
     osd_new_message(OSD_MIDDLE_CENTER, "Mupen64Plus Started...");
 
@@ -1115,6 +1127,8 @@ m64p_error main_run(void)
     pifbootrom_hle_execute(&g_dev);
     run_device(&g_dev);
 
+    input_latency_deinit();
+
     /* now begin to shut down */
 #ifdef WITH_LIRC
     lircStop();
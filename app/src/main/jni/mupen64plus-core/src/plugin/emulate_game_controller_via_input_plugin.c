@@ -22,6 +22,7 @@
 #include "emulate_game_controller_via_input_plugin.h"
 
 #include "api/m64p_plugin.h"
+#include "main/input_latency.h"
 #include "main/main.h"
 #include "plugin.h"
 #include "device/si/game_controller.h"
@@ -55,12 +56,18 @@ int egcvip_is_connected(void* opaque, enum pak_type* pak)
 
 uint32_t egcvip_get_input(void* opaque)
 {
+    /* frames emulated ahead replay the keys of the real frame */
+    static uint32_t last_keys[GAME_CONTROLLERS_COUNT];
     BUTTONS keys = { 0 };
     int channel = *(int*)opaque;
 
+    if (input_latency_emulating_ahead())
+        return last_keys[channel];
+
     if (input.getKeys)
         input.getKeys(channel, &keys);
 
+    last_keys[channel] = keys.Value;
     return keys.Value;
 
 }
@@ -26,6 +26,7 @@
 #include "device/ai/ai_controller.h"
 #include "device/ri/ri_controller.h"
 #include "device/vi/vi_controller.h"
+#include "main/input_latency.h"
 #include "main/rom.h"
 #include "plugin/plugin.h"
 
@@ -51,6 +52,10 @@ void push_audio_samples_via_audio_plugin(void* user_data, const void* buffer, si
     uint32_t saved_ai_length = ai->regs[AI_LEN_REG];
     uint32_t saved_ai_dram = ai->regs[AI_DRAM_ADDR_REG];
 
+    /* frames emulated ahead are rewound, don't play them */
+    if (input_latency_emulating_ahead())
+        return;
+
     /* exploit the fact that buffer points in g_dev.ri.rdram.dram to retreive dram_addr_reg value */
     ai->regs[AI_DRAM_ADDR_REG] = (uint8_t*)buffer - (uint8_t*)ai->ri->rdram.dram;
     ai->regs[AI_LEN_REG] = size;
@@ -0,0 +1,316 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - tracedecode.c                                           *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Decoder for the r4300 execution traces written by a core built with
+ * DBG_TRACE=1 (see src/device/r4300/exec_trace.h for the format).
+ *
+ * Build with:
+ *   gcc -o tracedecode tracedecode.c ../src/debugger/dbg_decoder.c -I../src
+ *
+ * Usage:
+ *   tracedecode r4300trace.bin              print every recorded jump
+ *   tracedecode -c good.bin bad.bin         report the first divergence
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugger/dbg_decoder.h"
+#include "device/r4300/exec_trace.h"
+
+struct trace_event
+{
+    uint32_t block_pc;
+    uint32_t pc;
+    uint32_t op;
+    uint32_t target;
+    uint32_t count;
+    int taken;
+    uint32_t regmask;
+    int64_t regs[32];
+};
+
+struct trace_file
+{
+    uint8_t* data;
+    uint32_t chunk_size;
+    uint32_t chunks;
+    struct trace_event* events;
+    size_t event_count;
+};
+
+static const char* reg_names[32] =
+{
+    "r0", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "s8", "ra"
+};
+
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint32_t* value)
+{
+    unsigned int shift = 0;
+
+    *value = 0;
+    while (p < end)
+    {
+        *value |= (uint32_t)(*p & 0x7f) << shift;
+        if ((*p++ & 0x80) == 0)
+            return p;
+        shift += 7;
+    }
+
+    return NULL;
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+    return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static int add_event(struct trace_file* t, size_t* capacity, const struct trace_event* e)
+{
+    if (t->event_count == *capacity)
+    {
+        size_t n = (*capacity == 0) ? 65536 : 2 * *capacity;
+        struct trace_event* events = realloc(t->events, n * sizeof(*events));
+        if (events == NULL)
+            return -1;
+        t->events = events;
+        *capacity = n;
+    }
+
+    t->events[t->event_count++] = *e;
+    return 0;
+}
+
+static int decode_chunk(struct trace_file* t, const uint8_t* chunk, size_t* capacity)
+{
+    struct exec_trace_chunk_header header;
+    const uint8_t* p = chunk + sizeof(header);
+    const uint8_t* end = chunk + t->chunk_size;
+    struct trace_event e;
+
+    memcpy(&header, chunk, sizeof(header));
+    memset(&e, 0, sizeof(e));
+    e.target = header.pc;
+    e.count = header.count;
+
+    while (p < end && *p != EXEC_TRACE_TAG_END)
+    {
+        uint8_t tag = *p++;
+        uint32_t offset, target, count;
+
+        if ((tag & 0x0f) != EXEC_TRACE_TAG_JUMP)
+            return -1;
+
+        e.block_pc = e.target;
+        if ((p = get_varint(p, end, &offset)) == NULL || p + 4 > end)
+            return -1;
+        e.pc = e.block_pc + (offset << 2);
+        e.op = get_u32(p);
+        p += 4;
+        if ((p = get_varint(p, end, &target)) == NULL)
+            return -1;
+        e.target = e.pc + 8 + (uint32_t)(((int32_t)(target >> 1) ^ -(int32_t)(target & 1)) << 2);
+        if ((p = get_varint(p, end, &count)) == NULL)
+            return -1;
+        e.count += count;
+        e.taken = (tag & EXEC_TRACE_FLAG_TAKEN) != 0;
+        e.regmask = 0;
+
+        if (tag & EXEC_TRACE_FLAG_REGS)
+        {
+            unsigned int i;
+
+            if ((p = get_varint(p, end, &e.regmask)) == NULL)
+                return -1;
+            for (i = 1; i < 32; ++i)
+            {
+                if (e.regmask & (UINT32_C(1) << i))
+                {
+                    if (p + 8 > end)
+                        return -1;
+                    e.regs[i] = (int64_t)get_u64(p);
+                    p += 8;
+                }
+            }
+        }
+
+        if (add_event(t, capacity, &e) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int load_trace(struct trace_file* t, const char* filename)
+{
+    char magic[8];
+    size_t capacity = 0;
+    uint32_t i;
+    FILE* f;
+
+    memset(t, 0, sizeof(*t));
+
+    f = fopen(filename, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Couldn't open trace file '%s'\n", filename);
+        return -1;
+    }
+
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, EXEC_TRACE_MAGIC, 8) != 0
+     || fread(&t->chunk_size, sizeof(t->chunk_size), 1, f) != 1
+     || fread(&t->chunks, sizeof(t->chunks), 1, f) != 1)
+    {
+        fprintf(stderr, "'%s' is not an r4300 execution trace\n", filename);
+        fclose(f);
+        return -1;
+    }
+
+    t->data = malloc((size_t)t->chunk_size * t->chunks);
+    if (t->data == NULL || fread(t->data, t->chunk_size, t->chunks, f) != t->chunks)
+    {
+        fprintf(stderr, "Couldn't read %u chunks from '%s'\n", t->chunks, filename);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    for (i = 0; i < t->chunks; ++i)
+    {
+        if (decode_chunk(t, t->data + (size_t)i * t->chunk_size, &capacity) != 0)
+        {
+            fprintf(stderr, "Corrupted chunk %u in '%s'\n", i, filename);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void print_event(const char* prefix, const struct trace_event* e)
+{
+    char op[64], args[64];
+    unsigned int i;
+
+    r4300_decode_op(e->op, op, args, e->pc);
+    printf("%s%08x  count=%08x  %08x: %-8s %-24s %s -> %08x\n",
+           prefix, e->block_pc, e->count, e->pc, op, args,
+           e->taken ? "taken    " : "not taken", e->target);
+
+    for (i = 1; i < 32; ++i)
+    {
+        if (e->regmask & (UINT32_C(1) << i))
+            printf("%s    %s = %016llx\n", prefix, reg_names[i], (unsigned long long)e->regs[i]);
+    }
+}
+
+static int same_event(const struct trace_event* a, const struct trace_event* b)
+{
+    unsigned int i;
+
+    if (a->pc != b->pc || a->target != b->target || a->taken != b->taken
+     || a->count != b->count || a->regmask != b->regmask)
+        return 0;
+
+    for (i = 1; i < 32; ++i)
+    {
+        if ((a->regmask & (UINT32_C(1) << i)) && a->regs[i] != b->regs[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+static int compare_traces(const struct trace_file* a, const struct trace_file* b)
+{
+    size_t i, j, k, start;
+
+    /* the ring buffers may start at different points, align on the first
+     * event of the shorter history */
+    for (i = 0, j = 0; i < a->event_count && j < b->event_count; )
+    {
+        if (a->events[i].count == b->events[j].count && a->events[i].pc == b->events[j].pc)
+            break;
+        if ((int32_t)(a->events[i].count - b->events[j].count) < 0)
+            ++i;
+        else
+            ++j;
+    }
+
+    if (i == a->event_count || j == b->event_count)
+    {
+        printf("Traces have no common history\n");
+        return 2;
+    }
+
+    for (start = i; i < a->event_count && j < b->event_count; ++i, ++j)
+    {
+        if (same_event(&a->events[i], &b->events[j]))
+            continue;
+
+        printf("Traces diverge after %lu common jumps\n", (unsigned long)(i - start));
+        for (k = (i > start + 4) ? i - 4 : start; k < i; ++k)
+            print_event("  ", &a->events[k]);
+        print_event("< ", &a->events[i]);
+        print_event("> ", &b->events[j]);
+        return 1;
+    }
+
+    printf("Traces are identical over %lu jumps\n", (unsigned long)(i - start));
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    struct trace_file a, b;
+    size_t i;
+
+    if (argc == 2)
+    {
+        if (load_trace(&a, argv[1]) != 0)
+            return 3;
+
+        for (i = 0; i < a.event_count; ++i)
+            print_event("", &a.events[i]);
+        return 0;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "-c") == 0)
+    {
+        if (load_trace(&a, argv[2]) != 0 || load_trace(&b, argv[3]) != 0)
+            return 3;
+
+        return compare_traces(&a, &b);
+    }
+
+    fprintf(stderr, "Usage: %s <trace.bin>\n"
+                    "       %s -c <reference.bin> <test.bin>\n", argv[0], argv[0]);
+    return 3;
+}
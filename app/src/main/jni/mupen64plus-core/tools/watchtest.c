@@ -0,0 +1,165 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - watchtest.c                                             *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Checks that read/write watchpoints hook the memory handlers of the pages
+ * they cover, and unhook them again when disabled or removed.
+ *
+ * Run with "make test" from projects/unix, or build with:
+ *   gcc -DDBG -o watchtest watchtest.c ../src/debugger/dbg_breakpoints.c \
+ *       ../src/device/memory/memory.c -I../src -I../src/api $(sdl2-config --cflags)
+ *
+ * Exits with a non-zero status on the first failed check.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "api/m64p_types.h"
+#include "debugger/dbg_breakpoints.h"
+#include "debugger/dbg_debugger.h"
+#include "device/device.h"
+#include "device/memory/memory.h"
+#include "main/main.h"
+
+struct device g_dev;
+m64p_dbg_runstate g_dbg_runstate;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures; \
+        } \
+    } while (0)
+
+static int page_watched(const uint16_t* watch, uint32_t address)
+{
+    return (watch[address >> 16] >> ((address >> 12) & 0xf)) & 1;
+}
+
+static void test_enabled_watchpoint(void)
+{
+    const uint32_t address = 0x80001000;
+    const uint16_t region = address >> 16;
+    void (*readmem)(void) = g_dev.mem.readmem[region];
+    void (*writemem)(void) = g_dev.mem.writemem[region];
+    m64p_breakpoint bp = { address, address + 3, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ };
+    int bpt;
+
+    bpt = add_breakpoint_struct(&bp);
+    CHECK(bpt == 0);
+    CHECK(page_watched(g_dev.mem.watch_read, address));
+    CHECK(!page_watched(g_dev.mem.watch_read, address + 0x1000));
+    CHECK(!page_watched(g_dev.mem.watch_write, address));
+    CHECK(g_dev.mem.readmem[region] != readmem);
+    CHECK(g_dev.mem.writemem[region] == writemem);
+
+    disable_breakpoint(bpt);
+    CHECK(g_dev.mem.watch_read[region] == 0);
+    CHECK(g_dev.mem.readmem[region] == readmem);
+
+    enable_breakpoint(bpt);
+    CHECK(page_watched(g_dev.mem.watch_read, address));
+    CHECK(g_dev.mem.readmem[region] != readmem);
+
+    remove_breakpoint_by_num(bpt);
+    CHECK(g_NumBreakpoints == 0);
+    CHECK(g_dev.mem.watch_read[region] == 0);
+    CHECK(g_dev.mem.readmem[region] == readmem);
+}
+
+static void test_second_watchpoint_same_region(void)
+{
+    const uint32_t address = 0xa0002000;
+    const uint16_t region = address >> 16;
+    void (*writemem)(void) = g_dev.mem.writemem[region];
+    m64p_breakpoint first = { address, address, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE };
+    m64p_breakpoint second = { address + 0x3000, address + 0x3000, M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE };
+    int a, b;
+
+    a = add_breakpoint_struct(&first);
+    b = add_breakpoint_struct(&second);
+    CHECK(page_watched(g_dev.mem.watch_write, address));
+    CHECK(page_watched(g_dev.mem.watch_write, address + 0x3000));
+    CHECK(g_dev.mem.writemem[region] != writemem);
+
+    /* removing one keeps the region hooked for the other */
+    remove_breakpoint_by_num(a);
+    b = a; /* the later entries move down */
+    CHECK(!page_watched(g_dev.mem.watch_write, address));
+    CHECK(page_watched(g_dev.mem.watch_write, address + 0x3000));
+    CHECK(g_dev.mem.writemem[region] != writemem);
+
+    remove_breakpoint_by_num(b);
+    CHECK(g_dev.mem.watch_write[region] == 0);
+    CHECK(g_dev.mem.writemem[region] == writemem);
+}
+
+int main(void)
+{
+    poweron_memory(&g_dev.mem);
+
+    test_enabled_watchpoint();
+    test_second_watchpoint_same_region();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("watchpoint hooks ok\n");
+    return EXIT_SUCCESS;
+}
+
+/* The rest of the core is not linked in: only the handler addresses matter. */
+
+void DebugMessage(int level, const char *message, ...) { (void)level; (void)message; }
+void update_debugger(uint32 pc) { (void)pc; }
+uint32_t* r4300_pc(void) { static uint32_t pc; return &pc; }
+uint32_t virtual_to_physical_address(struct r4300_core* r4300, uint32_t address, int w) { (void)r4300; (void)w; return address; }
+void invalidate_r4300_cached_code(struct r4300_core* r4300, uint32_t address, size_t size) { (void)r4300; (void)address; (void)size; }
+void block_profiler_mem_handler(struct block_profiler* prof, void (*handler)(void)) { (void)prof; handler(); }
+
+#define STUB_RW(name) \
+    int read_##name(void* opaque, uint32_t address, uint32_t* value) { (void)opaque; (void)address; *value = 0; return 0; } \
+    int write_##name(void* opaque, uint32_t address, uint32_t value, uint32_t mask) { (void)opaque; (void)address; (void)value; (void)mask; return 0; }
+
+STUB_RW(ai_regs)
+STUB_RW(cart_rom)
+STUB_RW(dpc_regs)
+STUB_RW(dps_regs)
+STUB_RW(mi_regs)
+STUB_RW(pi_regs)
+STUB_RW(pif_ram)
+STUB_RW(rdram_dram)
+STUB_RW(rdram_fb)
+STUB_RW(rdram_regs)
+STUB_RW(ri_regs)
+STUB_RW(rsp_mem)
+STUB_RW(rsp_regs)
+STUB_RW(rsp_regs2)
+STUB_RW(si_regs)
+STUB_RW(vi_regs)
+
+int read_flashram_status(void* opaque, uint32_t address, uint32_t* value) { (void)opaque; (void)address; *value = 0; return 0; }
+int write_flashram_command(void* opaque, uint32_t address, uint32_t value, uint32_t mask) { (void)opaque; (void)address; (void)value; (void)mask; return 0; }
@@ -14,10 +14,11 @@ LOCAL_C_INCLUDES := $(M64P_API_INCLUDES)
 ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
     MY_LOCAL_CFLAGS += -DUSE_SSE2NEON -D__ARM_NEON__ -mfpu=neon
 else ifeq ($(TARGET_ARCH_ABI), x86)
-    MY_LOCAL_CFLAGS += -ARCH_MIN_SSE2
+    MY_LOCAL_CFLAGS += -DARCH_MIN_SSE2
 endif
 
 LOCAL_SRC_FILES := \
+    $(SRCDIR)/jit.c \
     $(SRCDIR)/module.c \
     $(SRCDIR)/su.c \
     $(SRCDIR)/osal_dynamiclib_unix.c \
@@ -0,0 +1,1013 @@
+/******************************************************************************\
+* Project:  Dynamic Recompiler for Scalar and Vector Unit Operations           *
+* License:  CC0 Public Domain Dedication                                       *
+*                                                                              *
+* To the extent possible under law, the author(s) have dedicated all copyright *
+* and related and neighboring rights to this software to the public domain     *
+* worldwide. This software is distributed without any warranty.                *
+*                                                                              *
+* You should have received a copy of the CC0 Public Domain Dedication along    *
+* with this software.                                                          *
+* If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
+\******************************************************************************/
+
+#include "jit.h"
+
+#ifdef USE_DYNAREC
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "module.h"
+
+/*
+ * Blocks of straight-line code start at any IMEM address and run up to and
+ * including the delay slot of the first branch or jump, a COP0 or BREAK
+ * instruction (either one may halt the RSP or rewrite IMEM), or at most
+ * JIT_MAX_BLOCK instructions.
+ *
+ * Every block is a native function `u32 block(u32* SR, u8* DMEM)` returning
+ * the IMEM address to continue from, or'd with one of the flags below.
+ */
+#define JIT_MAX_BLOCK       64
+#define JIT_MAX_WORDS       (JIT_MAX_BLOCK + 1)
+
+#define JIT_HALT            0x00010000u
+#define JIT_DELAY           0x00020000u
+
+/*
+ * Compiled blocks are kept for as long as the code buffer lasts, indexed by
+ * the hash of the instructions they came from, so that switching back and
+ * forth between micro-codes (graphics, audio) doesn't recompile anything.
+ */
+#define JIT_CODE_SIZE       (8 << 20)
+#define JIT_BLOCKS          16384
+#define JIT_BUCKETS         4096
+#define JIT_MAX_BYTES(n)    (256*(n) + 64)
+
+typedef u32 (*jit_code)(u32* sr, u8* dmem);
+
+typedef struct jit_block {
+    struct jit_block* next;
+    jit_code code;
+    u32 pc;
+    u32 count;
+    u32 hash;
+    u32 words[JIT_MAX_WORDS];
+} jit_block;
+
+int jit_imem_dirty;
+
+static u8* code_buffer;
+static u8* code_ptr;
+static jit_block* blocks;
+static unsigned int blocks_used;
+static int jit_failed;
+
+static jit_block* buckets[JIT_BUCKETS];
+static jit_block* block_map[0x1000 / 4];
+
+/* last seen contents of IMEM, to find which blocks a DMA invalidated */
+static u32 imem_shadow[0x1000 / 4];
+
+#define IMEM_WORD(addr)     (*(pu32)(IMEM + FIT_IMEM(addr)))
+
+/*** code emitter ***/
+
+enum {
+    EAX = 0, ECX = 1, EDX = 2, EBX = 3, ESP = 4, EBP = 5, ESI = 6, EDI = 7
+};
+
+enum {
+    CC_B  = 0x2, CC_AE = 0x3, CC_E  = 0x4, CC_NE = 0x5,
+    CC_L  = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G  = 0xF
+};
+
+static void emit8(u8 byte)
+{
+    *code_ptr++ = byte;
+}
+static void emit32(u32 word)
+{
+    memcpy(code_ptr, &word, 4);
+    code_ptr += 4;
+}
+static void emit64(const void* pointer)
+{
+    memcpy(code_ptr, &pointer, 8);
+    code_ptr += 8;
+}
+
+/* mov reg, SR[gpr] (0 for $zero) */
+static void emit_load_sr(int reg, unsigned int gpr)
+{
+    if (gpr == zero) {
+        emit8(0x31);
+        emit8(0xC0 | reg << 3 | reg);
+        return;
+    }
+    emit8(0x8B);
+    emit8(0x43 | reg << 3);
+    emit8(4 * gpr);
+}
+
+/* mov SR[gpr], reg (writes to $zero are dropped) */
+static void emit_store_sr(int reg, unsigned int gpr)
+{
+    if (gpr == zero)
+        return;
+    emit8(0x89);
+    emit8(0x43 | reg << 3);
+    emit8(4 * gpr);
+}
+static void emit_store_sr_imm(unsigned int gpr, u32 imm)
+{
+    if (gpr == zero)
+        return;
+    emit8(0xC7);
+    emit8(0x43);
+    emit8(4 * gpr);
+    emit32(imm);
+}
+
+static void emit_mov_imm(int reg, u32 imm)
+{
+    emit8(0xB8 + reg);
+    emit32(imm);
+}
+static void emit_mov_ptr(const void* pointer)
+{ /* movabs rax, pointer */
+    emit8(0x48);
+    emit8(0xB8);
+    emit64(pointer);
+}
+
+/* 32-bit ALU operation `opcode dst, src`, e.g. 0x01 for ADD */
+static void emit_alu(u8 opcode, int dst, int src)
+{
+    emit8(opcode);
+    emit8(0xC0 | src << 3 | dst);
+}
+/* group 1 immediate operation, e.g. 0 for ADD and 7 for CMP */
+static void emit_alu_imm(int ext, int reg, u32 imm)
+{
+    emit8(0x81);
+    emit8(0xC0 | ext << 3 | reg);
+    emit32(imm);
+}
+/* group 2 shift by an immediate (or by CL, if sa < 0) */
+static void emit_shift(int ext, int reg, int sa)
+{
+    emit8(sa < 0 ? 0xD3 : 0xC1);
+    emit8(0xC0 | ext << 3 | reg);
+    if (sa >= 0)
+        emit8(sa & 31);
+}
+/* setcc al; movzx eax, al */
+static void emit_setcc(int cc)
+{
+    emit8(0x0F);
+    emit8(0x90 + cc);
+    emit8(0xC0);
+    emit8(0x0F);
+    emit8(0xB6);
+    emit8(0xC0);
+}
+
+static u8* emit_jcc(int cc)
+{
+    emit8(0x0F);
+    emit8(0x80 + cc);
+    emit32(0);
+    return (code_ptr - 4);
+}
+static u8* emit_jmp(void)
+{
+    emit8(0xE9);
+    emit32(0);
+    return (code_ptr - 4);
+}
+static void patch_jump(u8* rel32)
+{
+    const i32 offset = (i32)(code_ptr - (rel32 + 4));
+
+    memcpy(rel32, &offset, 4);
+}
+
+static void emit_call(const void* function)
+{
+    emit_mov_ptr(function);
+    emit8(0xFF);
+    emit8(0xD0);
+}
+
+static void emit_prologue(void)
+{
+    emit8(0x55); /* push rbp */
+    emit8(0x53); /* push rbx */
+    emit8(0x41); /* push r12 */
+    emit8(0x54);
+    emit8(0x48); /* mov rbx, rdi */
+    emit8(0x89);
+    emit8(0xFB);
+    emit8(0x49); /* mov r12, rsi */
+    emit8(0x89);
+    emit8(0xF4);
+}
+static void emit_epilogue(void)
+{
+    emit8(0x41); /* pop r12 */
+    emit8(0x5C);
+    emit8(0x5B); /* pop rbx */
+    emit8(0x5D); /* pop rbp */
+    emit8(0xC3);
+}
+static void emit_exit(u32 status)
+{
+    emit_mov_imm(EAX, status);
+    emit_epilogue();
+}
+
+/*
+ * Blocks go straight on to the next one, past its prologue, as long as it is
+ * still mapped to IMEM.  Only COP0 can DMA over IMEM or stop the RSP, and the
+ * blocks ending with it always return to the dispatcher to check for that.
+ */
+#define PROLOGUE_SIZE   10
+
+static void emit_chain(void)
+{
+    emit8(0x48); /* test rax, rax */
+    emit8(0x85);
+    emit8(0xC0);
+    emit8(0x74); /* jz past the jump */
+    emit8(0x0A);
+    emit8(0x48); /* mov rax, [rax + code] */
+    emit8(0x8B);
+    emit8(0x40);
+    emit8(offsetof(jit_block, code));
+    emit8(0x48); /* add rax, PROLOGUE_SIZE */
+    emit8(0x83);
+    emit8(0xC0);
+    emit8(PROLOGUE_SIZE);
+    emit8(0xFF); /* jmp rax */
+    emit8(0xE0);
+}
+static void emit_jump(u32 target)
+{
+    emit_mov_ptr(&block_map[target / 4]);
+    emit8(0x48); /* mov rax, [rax] */
+    emit8(0x8B);
+    emit8(0x00);
+    emit_chain();
+    emit_exit(target);
+}
+static void emit_jump_dynamic(void)
+{
+    emit_mov_ptr(&block_map[0]);
+    emit8(0x89); /* mov ecx, ebp */
+    emit8(0xE9);
+    emit8(0x48); /* mov rax, [rax + 2*rcx] */
+    emit8(0x8B);
+    emit8(0x04);
+    emit8(0x48);
+    emit_chain();
+    emit8(0x89); /* mov eax, ebp */
+    emit8(0xE8);
+    emit_epilogue();
+}
+
+/*
+ * The PC that an instruction sees is either known at compile time or, in
+ * the delay slot of JR and JALR, only at run time, kept in EBP.
+ */
+#define PC_DYNAMIC      0xFFFFFFFFu
+
+/*** instruction fallbacks ***/
+
+static u32 jit_execute(u32 inst, u32 PC)
+{
+    register int status;
+
+    status = step_SP(inst, PC);
+    if (status == 0)
+        return 0;
+    return (status < 0 ? JIT_HALT : JIT_DELAY) | FIT_IMEM(PC);
+}
+
+/*
+ * Interprets one instruction and leaves the block if it halted the RSP or
+ * branched (an unknown REGIMM branches to its delay slot in the interpreter).
+ */
+static void emit_interpreted(u32 inst, u32 PC)
+{
+    emit_mov_imm(EDI, inst);
+    if (PC == PC_DYNAMIC) {
+        emit8(0x89); /* mov esi, ebp */
+        emit8(0xEE);
+    } else {
+        emit_mov_imm(ESI, FIT_IMEM(PC));
+    }
+    emit_call(jit_execute);
+    emit8(0x85); /* test eax, eax */
+    emit8(0xC0);
+    emit8(0x74); /* jz past the epilogue */
+    emit8(0x05);
+    emit_epilogue();
+}
+
+/*** instruction translation ***/
+
+/* ecx = SR[base] + offset */
+static void emit_address(unsigned int base, u32 inst)
+{
+    emit_load_sr(ECX, base);
+    if ((s16)inst != 0)
+        emit_alu_imm(0, ECX, (u32)(s32)(s16)inst);
+}
+
+/* [r12 + rcx] addressing, with the given prefix and opcode bytes */
+static void emit_dmem_access(const u8* opcode, int length, int reg)
+{
+    emit8(0x41);
+    while (length-- > 0)
+        emit8(*opcode++);
+    emit8(0x04 | reg << 3);
+    emit8(0x0C);
+}
+
+static void emit_load_store(u32 inst, u32 PC)
+{
+    static const u8 movzx8[2] = { 0x0F, 0xB6 }, movsx8[2] = { 0x0F, 0xBE };
+    static const u8 movzx16[2] = { 0x0F, 0xB7 }, movsx16[2] = { 0x0F, 0xBF };
+    static const u8 mov32[1] = { 0x8B }, store8[1] = { 0x88 };
+    static const u8 store32[1] = { 0x89 };
+    const unsigned int op   = inst >> 26;
+    const unsigned int base = (inst >> 21) % (1 << 5);
+    const unsigned int rt   = (inst >> 16) % (1 << 5);
+    u8* slow_path;
+    u8* done;
+    int alignment;
+
+    if (op < 050 && rt == zero)
+        return; /* DMEM loads have no side effects. */
+    alignment = op & 3; /* 0 for bytes, 1 for halfwords and 3 for words */
+    emit_address(base, inst);
+    slow_path = NULL;
+    if (alignment != 0) {
+        emit8(0xF7); /* test ecx, alignment */
+        emit8(0xC1);
+        emit32(alignment);
+        slow_path = emit_jcc(CC_NE);
+    }
+    if (alignment != 3) {
+        emit8(0x83); /* xor ecx, BES(0) or HES(0) */
+        emit8(0xF1);
+        emit8(alignment == 0 ? 3 : 2);
+    }
+    emit_alu_imm(4, ECX, 0x00000FFFul);
+
+    switch (op) {
+    case 040: /* LB */
+        emit_dmem_access(movsx8, 2, EAX);
+        break;
+    case 044: /* LBU */
+        emit_dmem_access(movzx8, 2, EAX);
+        break;
+    case 041: /* LH */
+        emit_dmem_access(movsx16, 2, EAX);
+        break;
+    case 045: /* LHU */
+        emit_dmem_access(movzx16, 2, EAX);
+        break;
+    case 043: /* LW */
+        emit_dmem_access(mov32, 1, EAX);
+        break;
+    case 050: /* SB */
+        emit_load_sr(EAX, rt);
+        emit_dmem_access(store8, 1, EAX);
+        break;
+    case 051: /* SH */
+        emit_load_sr(EAX, rt);
+        emit8(0x66);
+        emit_dmem_access(store32, 1, EAX);
+        break;
+    case 053: /* SW */
+        emit_load_sr(EAX, rt);
+        emit_dmem_access(store32, 1, EAX);
+        break;
+    }
+    if (op < 050)
+        emit_store_sr(EAX, rt);
+    if (slow_path == NULL)
+        return;
+
+ /* Unaligned accesses are rare enough to just interpret. */
+    done = emit_jmp();
+    patch_jump(slow_path);
+    emit_interpreted(inst, PC);
+    patch_jump(done);
+}
+
+static int emit_special(u32 inst)
+{
+    const unsigned int rs = SPECIAL_DECODE_RS(inst) % (1 << 5);
+    const unsigned int rt = (inst >> 16) % (1 << 5);
+    const unsigned int rd = IW_RD(inst) % (1 << 5);
+    const unsigned int sa = (inst >>  6) % (1 << 5);
+
+    switch (inst % 64) {
+    case 000: /* SLL */
+    case 002: /* SRL */
+    case 003: /* SRA */
+        if (rd == zero)
+            return 1;
+        emit_load_sr(EAX, rt);
+        emit_shift((inst % 64 == 000) ? 4 : (inst % 64 == 002) ? 5 : 7, EAX, sa);
+        break;
+    case 004: /* SLLV */
+    case 006: /* SRLV */
+    case 007: /* SRAV */
+        if (rd == zero)
+            return 1;
+        emit_load_sr(ECX, rs);
+        emit_load_sr(EAX, rt);
+        emit_shift((inst % 64 == 004) ? 4 : (inst % 64 == 006) ? 5 : 7, EAX, -1);
+        break;
+    case 040: /* ADD */
+    case 041: /* ADDU */
+    case 042: /* SUB */
+    case 043: /* SUBU */
+    case 044: /* AND */
+    case 045: /* OR */
+    case 046: /* XOR */
+    case 047: /* NOR */
+    case 052: /* SLT */
+    case 053: /* SLTU */
+        if (rd == zero)
+            return 1;
+        emit_load_sr(EAX, rs);
+        emit_load_sr(ECX, rt);
+        switch (inst % 64) {
+        case 040:
+        case 041:
+            emit_alu(0x01, EAX, ECX);
+            break;
+        case 042:
+        case 043:
+            emit_alu(0x29, EAX, ECX);
+            break;
+        case 044:
+            emit_alu(0x21, EAX, ECX);
+            break;
+        case 045:
+            emit_alu(0x09, EAX, ECX);
+            break;
+        case 046:
+            emit_alu(0x31, EAX, ECX);
+            break;
+        case 047:
+            emit_alu(0x09, EAX, ECX);
+            emit8(0xF7); /* not eax */
+            emit8(0xD0);
+            break;
+        case 052:
+            emit_alu(0x39, EAX, ECX);
+            emit_setcc(CC_L);
+            break;
+        case 053:
+            emit_alu(0x39, EAX, ECX);
+            emit_setcc(CC_B);
+            break;
+        }
+        break;
+    default:
+        return 0;
+    }
+    emit_store_sr(EAX, rd);
+    return 1;
+}
+
+static int emit_immediate(u32 inst)
+{
+    const u32 immediate = inst & 0x0000FFFFu;
+    const unsigned int rs = (inst >> 21) % (1 << 5);
+    const unsigned int rt = (inst >> 16) % (1 << 5);
+
+    if (rt == zero)
+        return 1;
+    if (inst >> 26 == 017) { /* LUI */
+        emit_store_sr_imm(rt, immediate << 16);
+        return 1;
+    }
+    emit_load_sr(EAX, rs);
+    switch (inst >> 26) {
+    case 010: /* ADDI */
+    case 011: /* ADDIU */
+        emit_alu_imm(0, EAX, (u32)(s32)(s16)immediate);
+        break;
+    case 012: /* SLTI */
+        emit_alu_imm(7, EAX, (u32)(s32)(s16)immediate);
+        emit_setcc(CC_L);
+        break;
+    case 013: /* SLTIU */
+        emit_alu_imm(7, EAX, (u32)(s32)(s16)immediate);
+        emit_setcc(CC_B);
+        break;
+    case 014: /* ANDI */
+        emit_alu_imm(4, EAX, immediate);
+        break;
+    case 015: /* ORI */
+        emit_alu_imm(1, EAX, immediate);
+        break;
+    case 016: /* XORI */
+        emit_alu_imm(6, EAX, immediate);
+        break;
+    }
+    emit_store_sr(EAX, rt);
+    return 1;
+}
+
+/*
+ * Vector operations call the same VU implementations as the interpreter,
+ * with the operands passed in XMM0 and the element-shuffled target in XMM1.
+ */
+static int emit_cop2(u32 inst)
+{
+    const unsigned int op = (inst >> 21) % (1 << 5);
+    const unsigned int vt = (inst >> 16) % (1 << 5);
+    const unsigned int vs = IW_RD(inst) % (1 << 5);
+    const unsigned int vd = (inst >>  6) % (1 << 5);
+    const unsigned int e  = op & 0xF;
+
+    switch (op) {
+    case 000:
+        emit_mov_imm(EDI, vt);
+        emit_mov_imm(ESI, vs);
+        emit_mov_imm(EDX, vd >> 1);
+        emit_call(MFC2);
+        return 1;
+    case 002:
+        emit_mov_imm(EDI, vt);
+        emit_mov_imm(ESI, vs);
+        emit_call(CFC2);
+        return 1;
+    case 004:
+        emit_mov_imm(EDI, vt);
+        emit_mov_imm(ESI, vs);
+        emit_mov_imm(EDX, vd >> 1);
+        emit_call(MTC2);
+        return 1;
+    case 006:
+        emit_mov_imm(EDI, vt);
+        emit_mov_imm(ESI, vs);
+        emit_call(CTC2);
+        return 1;
+    }
+    if (op < 020)
+        return 0;
+
+    emit_mov_ptr(&inst_word); /* for VRCP and friends, and VSAW */
+    emit8(0xC7);
+    emit8(0x00);
+    emit32(inst);
+    emit_mov_ptr(&VR[vs][0]);
+    emit8(0x66); /* movdqa xmm0, [rax] */
+    emit8(0x0F);
+    emit8(0x6F);
+    emit8(0x00);
+    emit_mov_ptr(&VR[vt][0]);
+    emit8(0x66); /* movdqa xmm1, [rax] */
+    emit8(0x0F);
+    emit8(0x6F);
+    emit8(0x08);
+    if (e >= 2) {
+        u8 lo, hi, unpack;
+
+        unpack = 0x00;
+        if (e < 4) {
+            lo = hi = (e & 1) ? 0xF5 : 0xA0; /* (3, 3, 1, 1) or (2, 2, 0, 0) */
+        } else if (e < 8) {
+            lo = hi = 0x55 * (e - 4);
+        } else if (e < 12) {
+            lo = 0x55 * (e - 8);
+            hi = 0x00;
+            unpack = 0x6C; /* punpcklqdq */
+        } else {
+            lo = 0x00;
+            hi = 0x55 * (e - 12);
+            unpack = 0x6D; /* punpckhqdq */
+        }
+        if (e < 12) {
+            emit8(0xF2); /* pshuflw xmm1, xmm1, lo */
+            emit8(0x0F);
+            emit8(0x70);
+            emit8(0xC9);
+            emit8(lo);
+        }
+        if (e < 8 || e >= 12) {
+            emit8(0xF3); /* pshufhw xmm1, xmm1, hi */
+            emit8(0x0F);
+            emit8(0x70);
+            emit8(0xC9);
+            emit8(hi);
+        }
+        if (unpack != 0x00) {
+            emit8(0x66);
+            emit8(0x0F);
+            emit8(unpack);
+            emit8(0xC9);
+        }
+    }
+    emit_call(COP2_C2[inst % 64]);
+    emit_mov_ptr(&VR[vd][0]);
+    emit8(0x66); /* movdqa [rax], xmm0 */
+    emit8(0x0F);
+    emit8(0x7F);
+    emit8(0x00);
+    return 1;
+}
+
+static int emit_mwc2(u32 inst)
+{
+    mwc2_func function;
+    const unsigned int base    = (inst >> 21) % (1 << 5);
+    const unsigned int vt      = (inst >> 16) % (1 << 5);
+    const unsigned int element = (inst >>  7) % (1 << 4);
+    const signed int offset    = (signed int)(inst % 64) - ((inst & 64) ? 64 : 0);
+
+    function = (inst >> 26 == 062 ? LWC2 : SWC2)[IW_RD(inst) % (1 << 5)];
+    if (function == res_lsw)
+        return 0; /* It needs inst_word for its message. */
+    emit_mov_imm(EDI, vt);
+    emit_mov_imm(ESI, element);
+    emit_mov_imm(EDX, (u32)offset);
+    emit_mov_imm(ECX, base);
+    emit_call(function);
+    return 1;
+}
+
+/* anything that neither branches nor could end the block */
+static void emit_instruction(u32 inst, u32 PC)
+{
+    int translated;
+
+    switch (inst >> 26) {
+    case 000:
+        translated = emit_special(inst);
+        break;
+    case 010:
+    case 011:
+    case 012:
+    case 013:
+    case 014:
+    case 015:
+    case 016:
+    case 017:
+        translated = emit_immediate(inst);
+        break;
+    case 022:
+        translated = emit_cop2(inst);
+        break;
+    case 040:
+    case 041:
+    case 043:
+    case 044:
+    case 045:
+    case 050:
+    case 051:
+    case 053:
+        emit_load_store(inst, PC);
+        translated = 1;
+        break;
+    case 062:
+    case 072:
+        translated = emit_mwc2(inst);
+        break;
+    default:
+        translated = 0;
+    }
+    if (translated == 0)
+        emit_interpreted(inst, PC);
+}
+
+static int is_branch(u32 inst)
+{
+    switch (inst >> 26) {
+    case 000:
+        return (inst % 64 == 010 || inst % 64 == 011);
+    case 001:
+    case 002:
+    case 003:
+    case 004:
+    case 005:
+    case 006:
+    case 007:
+        return 1;
+    }
+    return 0;
+}
+static int ends_block(u32 inst)
+{
+    if (inst >> 26 == 020)
+        return 1; /* COP0 */
+    return (inst >> 26 == 000 && inst % 64 == 015); /* BREAK */
+}
+
+/*
+ * The delay slot gets compiled into both the taken and the not-taken path,
+ * unless it is one of the instructions that have to end a block.  Those go
+ * back to the dispatcher, which interprets the slot from temp_PC as usual.
+ */
+static void emit_branch(u32 inst, u32 addr)
+{
+    u8* not_taken;
+    u32 slot, target;
+    const unsigned int rs = (inst >> 21) % (1 << 5);
+    const unsigned int rt = (inst >> 16) % (1 << 5);
+    const u32 slot_addr = FIT_IMEM(addr + 4);
+    const u32 link = FIT_IMEM(addr + 8);
+    const int inline_slot = !is_branch(IMEM_WORD(slot_addr))
+                         && !ends_block(IMEM_WORD(slot_addr));
+
+    slot = IMEM_WORD(slot_addr);
+    target = FIT_IMEM(addr + 4 + 4*inst);
+    not_taken = NULL;
+    switch (inst >> 26) {
+    case 000: /* JR and JALR */
+        if (inst % 64 == 011)
+            emit_store_sr_imm(IW_RD(inst) % (1 << 5), link);
+        emit_load_sr(EAX, rs);
+        emit_alu_imm(4, EAX, 0x00000FFCul);
+        emit8(0x89); /* mov ebp, eax */
+        emit8(0xC5);
+        target = PC_DYNAMIC;
+        break;
+    case 001: /* BLTZ, BGEZ, BLTZAL and BGEZAL */
+        if (rt & 020)
+            emit_store_sr_imm(ra, link);
+        emit_load_sr(EAX, rs);
+        emit8(0x85); /* test eax, eax */
+        emit8(0xC0);
+        not_taken = emit_jcc((rt & 1) ? CC_L : CC_GE);
+        break;
+    case 003: /* JAL */
+        emit_store_sr_imm(ra, link);
+    /* Fall through. */
+    case 002: /* J */
+        target = FIT_IMEM(4 * inst);
+        break;
+    case 004: /* BEQ */
+    case 005: /* BNE */
+        emit_load_sr(EAX, rs);
+        emit_load_sr(ECX, rt);
+        emit_alu(0x39, EAX, ECX);
+        not_taken = emit_jcc((inst >> 26 == 004) ? CC_NE : CC_E);
+        break;
+    case 006: /* BLEZ */
+    case 007: /* BGTZ */
+        emit_load_sr(EAX, rs);
+        emit8(0x85); /* test eax, eax */
+        emit8(0xC0);
+        not_taken = emit_jcc((inst >> 26 == 006) ? CC_G : CC_LE);
+        break;
+    }
+
+    if (inline_slot) {
+        emit_instruction(slot, target);
+        if (target == PC_DYNAMIC)
+            emit_jump_dynamic();
+        else
+            emit_jump(target);
+    } else {
+        emit_mov_ptr(&temp_PC);
+        if (target == PC_DYNAMIC) {
+            emit8(0x8D); /* lea ecx, [rbp + 0x04001000] */
+            emit8(0x8D);
+            emit32(0x04001000);
+            emit8(0x89); /* mov [rax], ecx */
+            emit8(0x08);
+        } else {
+            emit8(0xC7);
+            emit8(0x00);
+            emit32(0x04001000 + target);
+        }
+        emit_exit(JIT_DELAY | slot_addr);
+    }
+    if (not_taken == NULL)
+        return;
+    patch_jump(not_taken);
+    if (inline_slot) {
+        emit_instruction(slot, link);
+        emit_jump(link);
+    } else {
+        emit_jump(slot_addr);
+    }
+}
+
+/*** block management ***/
+
+static int known_branch(u32 inst)
+{
+    if (inst >> 26 != 001)
+        return 1;
+    switch ((inst >> 16) % (1 << 5)) {
+    case 000:
+    case 001:
+    case 020:
+    case 021:
+        return 1;
+    }
+    return 0;
+}
+
+static u32 block_length(u32 pc)
+{
+    register u32 count;
+
+    for (count = 1; count < JIT_MAX_BLOCK; count++, pc = FIT_IMEM(pc + 4)) {
+        if (is_branch(IMEM_WORD(pc)))
+            return (count + 1);
+        if (ends_block(IMEM_WORD(pc)) || pc == 0xFFC)
+            break;
+    }
+    return (count + is_branch(IMEM_WORD(pc)));
+}
+
+static u32 hash_words(u32 pc, u32 count)
+{
+    register u32 hash;
+    register u32 i;
+
+    hash = 2166136261u ^ pc;
+    for (i = 0; i < count; i++)
+        hash = (hash ^ IMEM_WORD(pc + 4*i)) * 16777619u;
+    return (hash);
+}
+
+static void flush_blocks(void)
+{
+    code_ptr = code_buffer;
+    blocks_used = 0;
+    memset(buckets, 0, sizeof(buckets));
+    memset(block_map, 0, sizeof(block_map));
+}
+
+static jit_code compile_block(u32 pc)
+{
+    jit_code code;
+    register u32 i;
+
+    code = (jit_code)code_ptr;
+    emit_prologue();
+    for (i = 0; i < JIT_MAX_BLOCK; i++) {
+        const u32 inst = IMEM_WORD(pc);
+
+        if (is_branch(inst) && known_branch(inst)) {
+            emit_branch(inst, pc);
+            return (code);
+        }
+        if (is_branch(inst) || ends_block(inst)) {
+            emit_interpreted(inst, pc + 4);
+            emit_exit(FIT_IMEM(pc + 4));
+            return (code);
+        }
+        emit_instruction(inst, pc + 4);
+        if (pc == 0xFFC)
+            break;
+        pc = FIT_IMEM(pc + 4);
+    }
+    emit_jump(FIT_IMEM(pc + 4));
+    return (code);
+}
+
+static jit_block* find_block(u32 pc)
+{
+    jit_block* block;
+    const u32 count = block_length(pc);
+    const u32 hash = hash_words(pc, count);
+    jit_block** bucket = &buckets[hash % JIT_BUCKETS];
+    register u32 i;
+
+    for (block = *bucket; block != NULL; block = block->next) {
+        if (block->pc != pc || block->count != count || block->hash != hash)
+            continue;
+        for (i = 0; i < count; i++)
+            if (block->words[i] != IMEM_WORD(pc + 4*i))
+                break;
+        if (i == count)
+            return (block_map[pc / 4] = block);
+    }
+
+    if (blocks_used >= JIT_BLOCKS
+     || code_ptr + JIT_MAX_BYTES(count) > code_buffer + JIT_CODE_SIZE) {
+        flush_blocks();
+        bucket = &buckets[hash % JIT_BUCKETS];
+    }
+    block = &blocks[blocks_used++];
+    block->pc = pc;
+    block->count = count;
+    block->hash = hash;
+    for (i = 0; i < count; i++)
+        block->words[i] = IMEM_WORD(pc + 4*i);
+    block->code = compile_block(pc);
+    block->next = *bucket;
+    *bucket = block;
+    return (block_map[pc / 4] = block);
+}
+
+/*
+ * Unmaps every block overlapping the range of IMEM words which changed since
+ * last time.  The blocks themselves stay in the hash table for when the same
+ * code comes back, so unmapping a few unchanged ones along the way is cheap.
+ */
+static void sync_imem(void)
+{
+    register u32 i, first, last, span;
+
+    jit_imem_dirty = 0;
+    if (memcmp(imem_shadow, IMEM, sizeof(imem_shadow)) == 0)
+        return;
+    for (first = 0; imem_shadow[first] == *(pu32)(IMEM + 4*first); first++);
+    for (last = 0x1000/4 - 1; imem_shadow[last] == *(pu32)(IMEM + 4*last); last--);
+    span = last - first + JIT_MAX_WORDS;
+    for (i = 0; i < span && i < 0x1000/4; i++) { /* any block reaching first */
+        const u32 start = (first - JIT_MAX_WORDS + 1 + i) % (0x1000/4);
+
+        if (block_map[start] == NULL)
+            continue;
+        if ((first - start) % (0x1000/4) < block_map[start]->count
+         || (start - first) % (0x1000/4) <= last - first)
+            block_map[start] = NULL;
+    }
+    memcpy(&imem_shadow[first], IMEM + 4*first, 4*(last - first + 1));
+}
+
+static int jit_init(void)
+{
+    void* buffer;
+
+    if (code_buffer != NULL)
+        return 1;
+    if (jit_failed != 0)
+        return 0;
+    jit_failed = 1;
+    blocks = my_calloc(JIT_BLOCKS, sizeof(jit_block));
+    if (blocks == NULL)
+        return 0;
+    buffer = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        message("Could not allocate the recompiler's code buffer.");
+        my_free(blocks);
+        blocks = NULL;
+        return 0;
+    }
+    code_buffer = (u8*)buffer;
+    jit_failed = 0;
+    flush_blocks();
+    memset(imem_shadow, 0, sizeof(imem_shadow));
+    return 1;
+}
+
+NOINLINE int jit_run_task(void)
+{
+    register u32 PC;
+
+    if (jit_init() == 0)
+        return 0;
+    sync_imem();
+    PC = FIT_IMEM(GET_RCP_REG(SP_PC_REG));
+    for (;;) {
+        register u32 status;
+        jit_block* block;
+
+        block = block_map[PC / 4];
+        if (block == NULL)
+            block = find_block(PC);
+        status = block->code(SR, DMEM);
+        if (jit_imem_dirty != 0)
+            sync_imem();
+        PC = status & 0x00000FFFul;
+        if (status & JIT_HALT)
+            break;
+        if (status & JIT_DELAY) {
+            register int taken;
+
+            do { /* the same as set_branch_delay in run_task() */
+                inst_word = IMEM_WORD(PC);
+                PC = FIT_IMEM(temp_PC);
+                taken = step_SP(inst_word, PC);
+            } while (taken > 0);
+            if (jit_imem_dirty != 0)
+                sync_imem();
+            if (taken < 0)
+                break;
+        }
+    }
+    GET_RCP_REG(SP_PC_REG) = 0x04001000 | FIT_IMEM(PC);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,44 @@
+/******************************************************************************\
+* Project:  Dynamic Recompiler for Scalar and Vector Unit Operations           *
+* License:  CC0 Public Domain Dedication                                       *
+*                                                                              *
+* To the extent possible under law, the author(s) have dedicated all copyright *
+* and related and neighboring rights to this software to the public domain     *
+* worldwide. This software is distributed without any warranty.                *
+*                                                                              *
+* You should have received a copy of the CC0 Public Domain Dedication along    *
+* with this software.                                                          *
+* If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
+\******************************************************************************/
+
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include "su.h"
+
+/*
+ * The recompiler only emits x86-64 (System V calling convention) machine
+ * code.  Everywhere else, and whenever the interpreter has to trace every
+ * step (SP_EXECUTE_LOG), run_task() just keeps interpreting.
+ */
+#if defined(__x86_64__) && defined(ARCH_MIN_SSE2) && !defined(SSE2NEON)
+#if !defined(_WIN32) && defined(EMULATE_STATIC_PC) && !defined(SP_EXECUTE_LOG)
+#define USE_DYNAREC
+#endif
+#endif
+
+#ifdef USE_DYNAREC
+/*
+ * Set whenever an SP DMA writes to IMEM, so that the recompiled blocks of
+ * the overwritten instructions are thrown out before they execute again.
+ */
+extern int jit_imem_dirty;
+
+/*
+ * Runs the task from SP_PC_REG until the RSP halts, like run_task().
+ * Returns 0 without executing anything if no code buffer is available.
+ */
+NOINLINE extern int jit_run_task(void);
+#endif
+
+#endif
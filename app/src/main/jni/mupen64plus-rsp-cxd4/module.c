@@ -60,6 +60,7 @@ NOINLINE void update_conf(const char* source)
     CFG_HLE_AUD = ConfigGetParamBool(l_ConfigRsp, "AudioListToAudioPlugin");
     CFG_WAIT_FOR_CPU_HOST = ConfigGetParamBool(l_ConfigRsp, "WaitForCPUHost");
     CFG_MEND_SEMAPHORE_LOCK = ConfigGetParamBool(l_ConfigRsp, "SupportCPUSemaphoreLock");
+    CFG_DYNAREC = ConfigGetParamBool(l_ConfigRsp, "DynamicRecompiler");
 }
 
 static void DebugMessage(int level, const char *message, ...)
@@ -165,6 +166,7 @@ EXPORT m64p_error CALL PluginStartup(m64p_dynlib_handle CoreLibHandle, void *Con
     ConfigSetDefaultBool(l_ConfigRsp, "AudioListToAudioPlugin", 0, "Send audio lists to the audio plugin");
     ConfigSetDefaultBool(l_ConfigRsp, "WaitForCPUHost", 0, "Force CPU-RSP signals synchronization");
     ConfigSetDefaultBool(l_ConfigRsp, "SupportCPUSemaphoreLock", 0, "Support CPU-RSP semaphore lock");
+    ConfigSetDefaultBool(l_ConfigRsp, "DynamicRecompiler", 1, "Recompile RSP code to native code where supported");
 
     if (bSaveConfig && ConfigAPIVersion >= 0x020100)
         ConfigSaveSection("rsp-cxd4");
@@ -337,6 +339,7 @@ EXPORT unsigned int CALL DoRspCycles(unsigned int cycles)
 #ifdef WAIT_FOR_CPU_HOST
     for (i = 0; i < 32; i++)
         MFC0_count[i] = 0;
+    MF_SP_STATUS_TIMEOUT = (CFG_WAIT_FOR_CPU_HOST != 0) ? 16 : 32767;
 #endif
     run_task();
 
@@ -357,8 +360,8 @@ EXPORT unsigned int CALL DoRspCycles(unsigned int cycles)
     else if (*CR[0x7] != 0x00000000) /* semaphore lock fixes */
         {}
 #ifdef WAIT_FOR_CPU_HOST
-    else
-        MF_SP_STATUS_TIMEOUT = 16; /* From now on, wait 16 times, not 32767. */
+    else /* wait loop:  yielding to the CPU, to resume where it left off */
+        {}
 #else
     else { /* ??? unknown, possibly external intervention from CPU memory map */
         message("SP_SET_HALT");
@@ -421,7 +424,6 @@ EXPORT void CALL InitiateRSP(RSP_INFO Rsp_Info, pu32 CycleCount)
     CR[0xE] = &GET_RCP_REG(DPC_PIPEBUSY_REG);
     CR[0xF] = &GET_RCP_REG(DPC_TMEM_REG);
 
-    MF_SP_STATUS_TIMEOUT = 32767;
 #if 1
     GET_RCP_REG(SP_PC_REG) &= 0x00000FFFu; /* hack to fix Mupen64 */
 #endif
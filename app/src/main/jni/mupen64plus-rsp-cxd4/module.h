@@ -64,6 +64,11 @@ typedef enum {
 #define CFG_MEND_SEMAPHORE_LOCK     (*(pi32)(conf + 0x14))
 #define CFG_TRACE_RSP_REGISTERS     (*(pi32)(conf + 0x18))
 
+/*
+ * Run tasks through the dynamic recompiler (see jit.h) where it is built.
+ */
+#define CFG_DYNAREC                 (*(pi32)(conf + 0x1C))
+
 /*
  * Update RSP configuration memory from local file resource.
  */
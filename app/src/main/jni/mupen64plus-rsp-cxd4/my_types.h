@@ -35,6 +35,7 @@
 #if defined(USE_SSE2NEON) && defined(__ARM_NEON__)
 #include "sse2neon/SSE2NEON.h"
 #define ARCH_MIN_SSE2
+#undef FORCE_INLINE /* SSE2NEON.h's own; ours is defined further below. */
 #endif
 
 /*
@@ -394,14 +395,17 @@ typedef void(*p_func)(void);
 #define INLINE      __inline
 #define NOINLINE    __declspec(noinline)
 #define ALIGNED     _declspec(align(16))
+#define FORCE_INLINE    __forceinline
 #elif defined(__GNUC__)
 #define INLINE      inline
 #define NOINLINE    __attribute__((noinline))
 #define ALIGNED     __attribute__((aligned(16)))
+#define FORCE_INLINE    inline __attribute__((always_inline))
 #else
 #define INLINE
 #define NOINLINE
 #define ALIGNED
+#define FORCE_INLINE
 #endif
 
 /*
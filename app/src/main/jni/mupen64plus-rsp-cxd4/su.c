@@ -13,6 +13,8 @@
 * If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
 \******************************************************************************/
 
+#include <string.h>
+
 #include "su.h"
 
 /*
@@ -21,6 +23,8 @@
  */
 #include "module.h"
 
+#include "jit.h"
+
 u32 inst_word;
 
 u32 SR[32];
@@ -72,6 +76,125 @@ void SP_CP0_MF(unsigned int rt, unsigned int rd)
     return;
 }
 
+#ifdef WAIT_FOR_CPU_HOST
+/*
+ * Nothing the RSP can read out of the COP0 registers changes while the RSP
+ * is running, until either the RSP writes to them or the CPU host runs.  So
+ * once a loop which only reads them and does scalar arithmetic comes back
+ * around to the same instruction with all of the scalar registers the same
+ * as the last time, it is going to keep doing that forever.
+ *
+ * This follows the instructions from PC on a copy of the scalar registers,
+ * giving up at the first one with any other effect, to see if that happens.
+ */
+#define WAIT_LOOP_MAX_STEPS     64
+
+static int wait_loop_spins(u32 PC)
+{
+    u32 GPR[32];
+    u32 inst, result, target;
+    const u32 start = FIT_IMEM(PC);
+    register unsigned int rs, rt, rd, sa;
+    register int steps, taken, delay_slot;
+
+    memcpy(GPR, SR, sizeof(GPR));
+    PC = start;
+    target = 0x000;
+    delay_slot = 0;
+    for (steps = 0; steps < WAIT_LOOP_MAX_STEPS; steps++) {
+        inst = *(pu32)(IMEM + PC);
+        rs = (inst >> 21) % (1 << 5);
+        rt = (inst >> 16) % (1 << 5);
+        rd = (inst >> 11) % (1 << 5);
+        sa = (inst >>  6) % (1 << 5);
+        result = GPR[rt];
+        taken = -1; /* not a branch */
+
+        switch (inst >> 26) {
+        case 000: /* SPECIAL */
+            switch (inst % 64) {
+            case 000: result = GPR[rt] << sa;                   break;
+            case 002: result = GPR[rt] >> sa;                   break;
+            case 003: result = (s32)GPR[rt] >> sa;              break;
+            case 004: result = GPR[rt] << (GPR[rs] & 31);       break;
+            case 006: result = GPR[rt] >> (GPR[rs] & 31);       break;
+            case 007: result = (s32)GPR[rt] >> (GPR[rs] & 31);  break;
+            case 040:
+            case 041: result = GPR[rs] + GPR[rt];               break;
+            case 042:
+            case 043: result = GPR[rs] - GPR[rt];               break;
+            case 044: result = GPR[rs] & GPR[rt];               break;
+            case 045: result = GPR[rs] | GPR[rt];               break;
+            case 046: result = GPR[rs] ^ GPR[rt];               break;
+            case 047: result = ~(GPR[rs] | GPR[rt]);            break;
+            case 052: result = (s32)GPR[rs] < (s32)GPR[rt];     break;
+            case 053: result = GPR[rs] < GPR[rt];               break;
+            default:
+                return 0;
+            }
+            rt = rd;
+            break;
+        case 001: /* REGIMM:  Only BLTZ and BGEZ are free of side effects. */
+            if (rt == 000)
+                taken = ((s32)GPR[rs] <  0);
+            else if (rt == 001)
+                taken = ((s32)GPR[rs] >= 0);
+            else
+                return 0;
+            rt = 0;
+            break;
+        case 002: /* J */
+            taken = 1;
+            rt = 0;
+            break;
+        case 004: taken = (GPR[rs] == GPR[rt]);  rt = 0;  break;
+        case 005: taken = (GPR[rs] != GPR[rt]);  rt = 0;  break;
+        case 006: taken = ((s32)GPR[rs] <= 0);  rt = 0;  break;
+        case 007: taken = ((s32)GPR[rs] >  0);  rt = 0;  break;
+        case 010:
+        case 011: result = GPR[rs] + (s16)inst;                 break;
+        case 012: result = (s32)GPR[rs] < (s16)inst;            break;
+        case 013: result = GPR[rs] < (u32)(s32)(s16)inst;       break;
+        case 014: result = GPR[rs] & (u16)inst;                 break;
+        case 015: result = GPR[rs] | (u16)inst;                 break;
+        case 016: result = GPR[rs] ^ (u16)inst;                 break;
+        case 017: result = (u32)(u16)inst << 16;                break;
+        case 020: /* COP0:  MFC0 only, and not of the semaphore if it locks */
+            if (rs != 000)
+                return 0;
+            rd %= NUMBER_OF_CP0_REGISTERS;
+            if (rd == 0x7 && CFG_MEND_SEMAPHORE_LOCK != 0)
+                return 0;
+            result = *(CR[rd]);
+            break;
+        default:
+            return 0;
+        }
+        GPR[rt] = result;
+        GPR[zero] = 0x00000000;
+
+        if (delay_slot != 0) {
+            if (taken >= 0)
+                return 0; /* branch in a branch delay slot */
+            delay_slot = 0;
+            PC = target;
+        } else {
+            if (taken > 0) {
+                delay_slot = 1;
+                target = (inst >> 26 == 002)
+                  ? FIT_IMEM(4 * inst)
+                  : FIT_IMEM(PC + 4 + 4*(s16)inst);
+            }
+            PC = FIT_IMEM(PC + 4);
+        }
+        if (PC == start && delay_slot == 0)
+            if (memcmp(GPR, SR, sizeof(GPR)) == 0)
+                return 1;
+    }
+    return 0;
+}
+#endif
+
 static void MT_DMA_CACHE(unsigned int rt)
 {
     *CR[0x0] = SR[rt] & 0xFFFFFFF8ul; /* & 0x00001FF8 */
@@ -203,9 +326,14 @@ MT_CMD_START       ,MT_CMD_END         ,MT_READ_ONLY       ,MT_CMD_STATUS,
 MT_CMD_CLOCK       ,MT_READ_ONLY       ,MT_READ_ONLY       ,MT_READ_ONLY
 };
 
+#ifdef PREDECODE_IMEM
+static void refresh_decoded_IMEM(void);
+#endif
+
 void SP_DMA_READ(void)
 {
     unsigned int offC, offD; /* SP cache and dynamic DMA pointers */
+    unsigned int last; /* SP cache end address, not wrapped around */
     register unsigned int length;
     register unsigned int count;
     register unsigned int skip;
@@ -219,6 +347,7 @@ void SP_DMA_READ(void)
     ++length;
     ++count;
     skip += length;
+    last = (*CR[0x0] & 0x00001FF8ul) + count*length - 1;
     do {
         register unsigned int i;
 
@@ -237,6 +366,14 @@ void SP_DMA_READ(void)
 
     if ((*CR[0x0] & 0x1000) ^ (offC & 0x1000))
         message("DMA over the DMEM-to-IMEM gap.");
+    if (last >= 0x1000) { /* The DMA reached into IMEM. */
+#ifdef USE_DYNAREC
+        jit_imem_dirty = 1;
+#endif
+#ifdef PREDECODE_IMEM
+        refresh_decoded_IMEM();
+#endif
+    }
     GET_RCP_REG(SP_DMA_BUSY_REG)  =  0x00000000;
     GET_RCP_REG(SP_STATUS_REG)   &= ~SP_STATUS_DMA_BUSY;
     return;
@@ -1851,15 +1988,39 @@ PROFILE_MODE void MWC2_store(u32 inst)
     SWC2[IW_RD(inst)](vt, element, offset, base);
 }
 
-PROFILE_MODE void COP0(u32 inst)
+PROFILE_MODE void COP0(u32 inst, u32 PC)
 {
     const unsigned int rd = IW_RD(inst);
     const unsigned int rs = (inst >> 21) % (1 << 5);
     const unsigned int rt = (inst >> 16) % (1 << 5);
+#ifdef WAIT_FOR_CPU_HOST
+    static u32 last_MF_value;
+    static unsigned int last_MF_reg;
+    static u32 not_waiting_at = ~0u; /* last PC a wait loop was ruled out */
+#endif
 
     switch (rs) {
     case 000:
         SP_CP0_MF(rt, rd);
+#ifdef WAIT_FOR_CPU_HOST
+/*
+ * Only a read repeating the last one is worth checking for a wait loop, and
+ * not again at the same PC until the value read changes, so that loops with
+ * a time-out counter of their own only get checked once.  If the loop never
+ * ends, the RSP yields to the CPU right away, at PC with its registers as
+ * they are now, rather than after MF_SP_STATUS_TIMEOUT.
+ */
+        if (rd % NUMBER_OF_CP0_REGISTERS != last_MF_reg || SR[rt] != last_MF_value) {
+            last_MF_reg = rd % NUMBER_OF_CP0_REGISTERS;
+            last_MF_value = SR[rt];
+            not_waiting_at = ~0u;
+        } else if (FIT_IMEM(PC) != not_waiting_at) {
+            if (wait_loop_spins(PC))
+                GET_RCP_REG(SP_STATUS_REG) |= SP_STATUS_HALT;
+            else
+                not_waiting_at = FIT_IMEM(PC);
+        }
+#endif
         break;
     case 004:
         SP_CP0_MT[rd % NUMBER_OF_CP0_REGISTERS](rt);
@@ -1869,93 +2030,122 @@ PROFILE_MODE void COP0(u32 inst)
     }
 }
 
-PROFILE_MODE void COP2(u32 inst)
+/*
+ * Runs the vector computational op `operation` for VU op-code element `e`
+ * (the low four bits of inst.R.rs), selecting the VR[vt] lanes to use.
+ */
+PROFILE_MODE void COP2_vector(
+    p_vector_func operation,
+    unsigned int vd, unsigned int vs, unsigned int vt, unsigned int e)
 {
-    const unsigned int op = (inst >> 21) % (1 << 5); /* inst.R.rs */
-    const unsigned int vt = (inst >> 16) % (1 << 5); /* inst.R.rt */
-    const unsigned int vs = IW_RD(inst);
-    const unsigned int vd = (inst >>  6) % (1 << 5); /* inst.R.sa */
-    const unsigned int func = inst % (1 << 6);
-#ifndef ARCH_MIN_SSE2
-    const unsigned int e  = op & 0xF; /* With Intel, LEA offsets beat ANDing. */
-#endif
-
-    switch (op) {
 #ifdef ARCH_MIN_SSE2
-        v16 target;
+    v16 target;
 #else
-        register unsigned int i;
+    register unsigned int i;
 #endif
 
-    case 000:
-        MFC2(vt, vs, vd >> 1);
-        break;
-    case 002:
-        CFC2(vt, vs);
-        break;
-    case 004:
-        MTC2(vt, vs, vd >> 1);
-        break;
-    case 006:
-        CTC2(vt, vs);
-        break;
-    case 020:
-    case 021:
+    switch (e) {
+    case 0x0:
+    case 0x1:
 #ifdef ARCH_MIN_SSE2
-        *(v16 *)(VR[vd]) = COP2_C2[func](*(v16 *)VR[vs], *(v16 *)VR[vt]);
+        *(v16 *)(VR[vd]) = operation(*(v16 *)VR[vs], *(v16 *)VR[vt]);
 #else
-        COP2_C2[func](&VR[vs][0], &VR[vt][0]);
+        operation(&VR[vs][0], &VR[vt][0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
-    case 022:
-    case 023:
+    case 0x2:
+    case 0x3:
 #ifdef ARCH_MIN_SSE2
 #ifdef __ARM_NEON__
-        target = (v16)vld1q_u16(&VR[vt][0 + op - 0x12]);
+        target = (v16)vld1q_u16(&VR[vt][0 + e - 0x2]);
         target = (v16)vshlq_n_u32((uint32x4_t)target, 16);
         target = (v16)vorrq_u16((uint16x8_t)target,
                                 (uint16x8_t)vshrq_n_u32((uint32x4_t)target, 16));
 #else
-        shuffle_temporary[0] = VR[vt][0 + op - 0x12];
-        shuffle_temporary[2] = VR[vt][2 + op - 0x12];
-        shuffle_temporary[4] = VR[vt][4 + op - 0x12];
-        shuffle_temporary[6] = VR[vt][6 + op - 0x12];
+        shuffle_temporary[0] = VR[vt][0 + e - 0x2];
+        shuffle_temporary[2] = VR[vt][2 + e - 0x2];
+        shuffle_temporary[4] = VR[vt][4 + e - 0x2];
+        shuffle_temporary[6] = VR[vt][6 + e - 0x2];
         target = *(v16 *)(&shuffle_temporary[0]);
         target = _mm_shufflehi_epi16(target, _MM_SHUFFLE(2, 2, 0, 0));
         target = _mm_shufflelo_epi16(target, _MM_SHUFFLE(2, 2, 0, 0));
 #endif
-        *(v16 *)(VR[vd]) = COP2_C2[func](*(v16 *)VR[vs], target);
+        *(v16 *)(VR[vd]) = operation(*(v16 *)VR[vs], target);
 #else
         for (i = 0; i < N; i++)
             shuffle_temporary[i] = VR[vt][(i & 0xE) + (e & 0x1)];
-        COP2_C2[func](&VR[vs][0], &shuffle_temporary[0]);
+        operation(&VR[vs][0], &shuffle_temporary[0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
-    case 024:
-    case 025:
-    case 026:
-    case 027:
+    case 0x4:
+    case 0x5:
+    case 0x6:
+    case 0x7:
 #ifdef ARCH_MIN_SSE2
 #ifdef __ARM_NEON__
-        target = (v16)vcombine_s16(vdup_n_s16(VR[vt][0 + op - 0x14]),
-                                   vdup_n_s16(VR[vt][4 + op - 0x14]));
+        target = (v16)vcombine_s16(vdup_n_s16(VR[vt][0 + e - 0x4]),
+                                   vdup_n_s16(VR[vt][4 + e - 0x4]));
 #else
         target = _mm_setzero_si128();
-        target = _mm_insert_epi16(target, VR[vt][0 + op - 0x14], 0);
-        target = _mm_insert_epi16(target, VR[vt][4 + op - 0x14], 4);
+        target = _mm_insert_epi16(target, VR[vt][0 + e - 0x4], 0);
+        target = _mm_insert_epi16(target, VR[vt][4 + e - 0x4], 4);
         target = _mm_shufflehi_epi16(target, _MM_SHUFFLE(0, 0, 0, 0));
         target = _mm_shufflelo_epi16(target, _MM_SHUFFLE(0, 0, 0, 0));
 #endif
-        *(v16 *)(VR[vd]) = COP2_C2[func](*(v16 *)VR[vs], target);
+        *(v16 *)(VR[vd]) = operation(*(v16 *)VR[vs], target);
 #else
         for (i = 0; i < N; i++)
             shuffle_temporary[i] = VR[vt][(i & 0xC) + (e & 0x3)];
-        COP2_C2[func](&VR[vs][0], &shuffle_temporary[0]);
+        operation(&VR[vs][0], &shuffle_temporary[0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
+    default:
+#ifdef ARCH_MIN_SSE2
+        *(v16 *)(VR[vd]) = operation(
+            *(v16 *)VR[vs],
+            _mm_set1_epi16(VR[vt][e - 0x8])
+        );
+#else
+        for (i = 0; i < N; i++)
+            shuffle_temporary[i] = VR[vt][e % N];
+        operation(&VR[vs][0], &shuffle_temporary[0]);
+        vector_copy(&VR[vd][0], &V_result[0]);
+#endif
+    }
+}
+
+PROFILE_MODE void COP2(u32 inst)
+{
+    const unsigned int op = (inst >> 21) % (1 << 5); /* inst.R.rs */
+    const unsigned int vt = (inst >> 16) % (1 << 5); /* inst.R.rt */
+    const unsigned int vs = IW_RD(inst);
+    const unsigned int vd = (inst >>  6) % (1 << 5); /* inst.R.sa */
+    const unsigned int func = inst % (1 << 6);
+
+    switch (op) {
+    case 000:
+        MFC2(vt, vs, vd >> 1);
+        break;
+    case 002:
+        CFC2(vt, vs);
+        break;
+    case 004:
+        MTC2(vt, vs, vd >> 1);
+        break;
+    case 006:
+        CTC2(vt, vs);
+        break;
+    case 020:
+    case 021:
+    case 022:
+    case 023:
+    case 024:
+    case 025:
+    case 026:
+    case 027:
     case 030:
     case 031:
     case 032:
@@ -1964,30 +2154,639 @@ PROFILE_MODE void COP2(u32 inst)
     case 035:
     case 036:
     case 037:
-#ifdef ARCH_MIN_SSE2
-        *(v16 *)(VR[vd]) = COP2_C2[func](
-            *(v16 *)VR[vs],
-            _mm_set1_epi16(VR[vt][op - 0x18])
-        );
-#else
-        for (i = 0; i < N; i++)
-            shuffle_temporary[i] = VR[vt][e % N];
-        COP2_C2[func](&VR[vs][0], &shuffle_temporary[0]);
-        vector_copy(&VR[vd][0], &V_result[0]);
+        COP2_vector(COP2_C2[func], vd, vs, vt, op & 0xF);
+        break;
+    default:
+        res_S();
+    }
+}
+
+/*
+ * Executes one instruction word with PC already pointing past it (or at the
+ * branch target, for the delay slot of a taken branch).
+ *
+ * Returns -1 if the RSP halted, +1 if a branch or jump was taken (temp_PC
+ * holds the target, the delay slot is to execute next), and 0 otherwise.
+ */
+PROFILE_MODE int execute(u32 inst, u32 PC)
+{
+#if (0 != 0)
+    if (GET_RCP_REG(SP_STATUS_REG) & SP_STATUS_HALT)
+        return -1; /* Only BREAK and COP0 set this. */
+    SR[zero] = 0x00000000; /* already handled on per-instruction basis */
 #endif
+    switch (inst >> 26) {
+    case 000: /* SPECIAL */
+        return SPECIAL(inst, PC);
+    case 001: /* REGIMM */
+        return REGIMM(inst, PC);
+    case 002:
+        J(inst);
+        return 1;
+    case 003:
+        JAL(inst, PC);
+        return 1;
+    case 004:
+        return BEQ(inst, PC);
+    case 005:
+        return BNE(inst, PC);
+    case 006:
+        return BLEZ(inst, PC);
+    case 007:
+        return BGTZ(inst, PC);
+    case 010: /* ADDI:  Traps don't exist on the RCP. */
+    case 011:
+        ADDIU(inst);
+        break;
+    case 012:
+        SLTI(inst);
+        break;
+    case 013:
+        SLTIU(inst);
+        break;
+    case 014:
+        ANDI(inst);
+        break;
+    case 015:
+        ORI(inst);
+        break;
+    case 016:
+        XORI(inst);
+        break;
+    case 017:
+        LUI(inst);
+        break;
+    case 020:
+        COP0(inst, PC);
+        if (GET_RCP_REG(SP_STATUS_REG) & SP_STATUS_HALT)
+            return -1;
+        break;
+    case 022:
+        COP2(inst);
+        break;
+    case 040:
+        LB(inst);
+        break;
+    case 041:
+        LH(inst);
+        break;
+    case 043:
+        LW(inst);
+        break;
+    case 044:
+        LBU(inst);
+        break;
+    case 045:
+        LHU(inst);
+        break;
+    case 050:
+        SB(inst);
+        break;
+    case 051:
+        SH(inst);
+        break;
+    case 053:
+        SW(inst);
+        break;
+    case 062: /* LWC2 */
+        MWC2_load(inst);
+        break;
+    case 072: /* SWC2 */
+        MWC2_store(inst);
         break;
     default:
         res_S();
     }
+    return 0;
+}
+
+int step_SP(u32 inst, u32 PC)
+{
+    inst_word = inst;
+    return execute(inst, PC);
+}
+
+#ifdef PREDECODE_IMEM
+/*
+ * IMEM decoded ahead of time:  one entry per instruction word, holding the
+ * handler to dispatch to and the op-code fields already shifted into place.
+ *
+ * Entries are decoded a page at a time, the first time any instruction in
+ * the page runs.  Pages whose words changed since they were decoded are
+ * reset to decode_page() again at the start of every task and after every
+ * SP DMA into IMEM, which are the only ways IMEM can be overwritten.
+ */
+typedef struct decoded_op decoded_op;
+typedef int (*p_decoded_func)(const decoded_op * op, u32 PC);
+
+struct decoded_op {
+    p_decoded_func handler;
+    union {
+        p_vector_func vector;
+        mwc2_func transfer;
+    } call;
+    u32 word;
+    u32 imm; /* extended immediate, branch displacement or jump target */
+    u8 rs, rt, rd, sa; /* or (base, vt, vs, element) for MWC2 and COP2 */
+};
+
+#define DECODED_PAGE_SIZE       32 /* instruction words per page */
+#define DECODED_PAGES           (1024 / DECODED_PAGE_SIZE)
+
+static decoded_op decoded_IMEM[1024];
+static u32 decoded_words[1024]; /* IMEM as it was when last decoded */
+static int decoded_IMEM_valid;
+
+/*
+ * Everything which has no faster handler of its own:  COP0, BREAK and the
+ * reserved op-codes.  Runs the interpreter's own op-code switch on it.
+ */
+static int op_execute(const decoded_op * op, u32 PC)
+{
+    return step_SP(op->word, PC);
+}
+
+static int op_NOP(const decoded_op * op, u32 PC)
+{
+    return 0;
+}
+
+static int op_SLL(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rt] << op->sa;
+    return 0;
+}
+static int op_SRL(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = (u32)(SR[op->rt]) >> op->sa;
+    return 0;
+}
+static int op_SRA(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = (s32)(SR[op->rt]) >> op->sa;
+    return 0;
+}
+static int op_SLLV(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rt] << MASK_SA(SR[op->rs]);
+    return 0;
+}
+static int op_SRLV(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = (u32)(SR[op->rt]) >> MASK_SA(SR[op->rs]);
+    return 0;
+}
+static int op_SRAV(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = (s32)(SR[op->rt]) >> MASK_SA(SR[op->rs]);
+    return 0;
+}
+static int op_JR(const decoded_op * op, u32 PC)
+{
+    set_PC(SR[op->rs]);
+    return 1;
+}
+static int op_JALR(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = FIT_IMEM(PC + LINK_OFF);
+    SR[zero] = 0x00000000;
+    set_PC(SR[op->rs]);
+    return 1;
+}
+static int op_ADDU(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rs] + SR[op->rt];
+    return 0;
+}
+static int op_SUBU(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rs] - SR[op->rt];
+    return 0;
+}
+static int op_AND(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rs] & SR[op->rt];
+    return 0;
+}
+static int op_OR(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rs] | SR[op->rt];
+    return 0;
+}
+static int op_XOR(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = SR[op->rs] ^ SR[op->rt];
+    return 0;
+}
+static int op_NOR(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = ~(SR[op->rs] | SR[op->rt]);
+    return 0;
+}
+static int op_SLT(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = ((s32)(SR[op->rs]) < (s32)(SR[op->rt]));
+    return 0;
+}
+static int op_SLTU(const decoded_op * op, u32 PC)
+{
+    SR[op->rd] = ((u32)(SR[op->rs]) < (u32)(SR[op->rt]));
+    return 0;
+}
+
+static int op_BLTZ(const decoded_op * op, u32 PC)
+{
+    if (!((s32)SR[op->rs] < 0))
+        return 0;
+    set_PC(PC + op->imm);
+    return 1;
+}
+static int op_BGEZ(const decoded_op * op, u32 PC)
+{
+    if (!((s32)SR[op->rs] >= 0))
+        return 0;
+    set_PC(PC + op->imm);
+    return 1;
+}
+static int op_BLTZAL(const decoded_op * op, u32 PC)
+{
+    SR[ra] = FIT_IMEM(PC + LINK_OFF);
+    return op_BLTZ(op, PC);
+}
+static int op_BGEZAL(const decoded_op * op, u32 PC)
+{
+    SR[ra] = FIT_IMEM(PC + LINK_OFF);
+    return op_BGEZ(op, PC);
+}
+static int op_J(const decoded_op * op, u32 PC)
+{
+    set_PC(op->imm);
+    return 1;
+}
+static int op_JAL(const decoded_op * op, u32 PC)
+{
+    SR[ra] = FIT_IMEM(PC + LINK_OFF);
+    set_PC(op->imm);
+    return 1;
+}
+static int op_BEQ(const decoded_op * op, u32 PC)
+{
+    if (!(SR[op->rs] == SR[op->rt]))
+        return 0;
+    set_PC(PC + op->imm);
+    return 1;
+}
+static int op_BNE(const decoded_op * op, u32 PC)
+{
+    if (!(SR[op->rs] != SR[op->rt]))
+        return 0;
+    set_PC(PC + op->imm);
+    return 1;
+}
+static int op_BLEZ(const decoded_op * op, u32 PC)
+{
+    if (!((s32)SR[op->rs] <= 0))
+        return 0;
+    set_PC(PC + op->imm);
+    return 1;
+}
+static int op_BGTZ(const decoded_op * op, u32 PC)
+{
+    if (!((s32)SR[op->rs] >  0))
+        return 0;
+    set_PC(PC + op->imm);
+    return 1;
+}
+
+/*
+ * The immediate was sign- or zero-extended (or shifted, for LUI) already,
+ * so every one of ADDIU, ANDI, ORI, XORI and LUI collapses to one of these.
+ */
+static int op_ADDI(const decoded_op * op, u32 PC)
+{
+    SR[op->rt] = SR[op->rs] + op->imm;
+    return 0;
+}
+static int op_SLTI(const decoded_op * op, u32 PC)
+{
+    SR[op->rt] = ((s32)(SR[op->rs]) < (s32)(op->imm)) ? 1 : 0;
+    return 0;
+}
+static int op_SLTIU(const decoded_op * op, u32 PC)
+{
+    SR[op->rt] = ((u32)(SR[op->rs]) < (u32)(op->imm)) ? 1 : 0;
+    return 0;
+}
+static int op_ANDI(const decoded_op * op, u32 PC)
+{
+    SR[op->rt] = SR[op->rs] & op->imm;
+    return 0;
+}
+static int op_ORI(const decoded_op * op, u32 PC)
+{
+    SR[op->rt] = SR[op->rs] | op->imm;
+    return 0;
+}
+static int op_XORI(const decoded_op * op, u32 PC)
+{
+    SR[op->rt] = SR[op->rs] ^ op->imm;
+    return 0;
+}
+
+static int op_LB(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+
+    SR[op->rt] = (s8)DMEM[BES(addr) & 0x00000FFFul];
+    return 0;
+}
+static int op_LBU(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+
+    SR[op->rt] = DMEM[BES(addr) & 0x00000FFFul];
+    return 0;
+}
+static int op_LH(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+
+    SR[op->rt] = (s16)(0x00000000
+      | DMEM[BES(addr + 0) & 0x00000FFFul] <<  8
+      | DMEM[BES(addr + 1) & 0x00000FFFul] <<  0
+    );
+    return 0;
+}
+static int op_LHU(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+
+    SR[op->rt] = 0x00000000
+      | DMEM[BES(addr + 0) & 0x00000FFFul] <<  8
+      | DMEM[BES(addr + 1) & 0x00000FFFul] <<  0
+    ;
+    return 0;
+}
+static int op_LW(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+    const unsigned int rt = op->rt;
+
+    if (addr % 4 == 0) { /* DMEM words are stored in native byte order. */
+        SR[rt] = *(pi32)(DMEM + (addr & 0x00000FFFul));
+        return 0;
+    }
+    SR_B(rt, 0) = DMEM[BES(addr + 0) & 0x00000FFFul];
+    SR_B(rt, 1) = DMEM[BES(addr + 1) & 0x00000FFFul];
+    SR_B(rt, 2) = DMEM[BES(addr + 2) & 0x00000FFFul];
+    SR_B(rt, 3) = DMEM[BES(addr + 3) & 0x00000FFFul];
+    return 0;
+}
+static int op_SB(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+
+    DMEM[BES(addr) & 0x00000FFFul] = (u8)(SR[op->rt] & 0xFFu);
+    return 0;
+}
+static int op_SH(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+    const unsigned int rt = op->rt;
+
+    DMEM[BES(addr + 0) & 0x00000FFFul] = SR_B(rt, 2);
+    DMEM[BES(addr + 1) & 0x00000FFFul] = SR_B(rt, 3);
+    return 0;
+}
+static int op_SW(const decoded_op * op, u32 PC)
+{
+    const u32 addr = SR[op->rs] + op->imm;
+    const unsigned int rt = op->rt;
+
+    if (addr % 4 == 0) {
+        *(pi32)(DMEM + (addr & 0x00000FFFul)) = SR[rt];
+        return 0;
+    }
+    DMEM[BES(addr + 0) & 0x00000FFFul] = SR_B(rt, 0);
+    DMEM[BES(addr + 1) & 0x00000FFFul] = SR_B(rt, 1);
+    DMEM[BES(addr + 2) & 0x00000FFFul] = SR_B(rt, 2);
+    DMEM[BES(addr + 3) & 0x00000FFFul] = SR_B(rt, 3);
+    return 0;
+}
+
+static int op_MFC2(const decoded_op * op, u32 PC)
+{
+    MFC2(op->rt, op->rd, op->sa);
+    return 0;
+}
+static int op_CFC2(const decoded_op * op, u32 PC)
+{
+    CFC2(op->rt, op->rd);
+    return 0;
+}
+static int op_MTC2(const decoded_op * op, u32 PC)
+{
+    MTC2(op->rt, op->rd, op->sa);
+    return 0;
+}
+static int op_CTC2(const decoded_op * op, u32 PC)
+{
+    CTC2(op->rt, op->rd);
+    return 0;
+}
+static int op_VECTOR(const decoded_op * op, u32 PC)
+{
+    inst_word = op->word; /* The divides and VSAR decode their own fields. */
+    COP2_vector(op->call.vector, op->sa, op->rd, op->rt, op->rs);
+    return 0;
+}
+static int op_VECTOR_V(const decoded_op * op, u32 PC)
+{
+    inst_word = op->word; /* element 0 or 1:  all of VR[vt], unshuffled */
+    COP2_vector(op->call.vector, op->sa, op->rd, op->rt, 0x0);
+    return 0;
+}
+static int op_MWC2(const decoded_op * op, u32 PC)
+{
+    op->call.transfer(op->rt, op->sa, (s32)op->imm, op->rs);
+    return 0;
+}
+
+/*
+ * Fills in the handler and pre-shifted operands for one instruction word.
+ * Writes to $zero that have no other side effects are decoded as no-ops.
+ */
+static void decode_op(decoded_op * op, u32 inst)
+{
+    const unsigned int rs = (inst >> 21) % (1 << 5);
+    const unsigned int rt = (inst >> 16) % (1 << 5);
+    const unsigned int rd = (inst >> 11) % (1 << 5);
+    const unsigned int sa = (inst >>  6) % (1 << 5);
+    static const p_decoded_func SPECIAL_ops[64] = {
+        op_SLL    ,op_execute,op_SRL    ,op_SRA    ,
+        op_SLLV   ,op_execute,op_SRLV   ,op_SRAV   ,
+        op_JR     ,op_JALR   ,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_ADDU   ,op_ADDU   ,op_SUBU   ,op_SUBU   ,
+        op_AND    ,op_OR     ,op_XOR    ,op_NOR    ,
+        op_execute,op_execute,op_SLT    ,op_SLTU   ,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+    };
+    static const p_decoded_func primary_ops[64] = {
+        op_execute,op_execute,op_J      ,op_JAL    ,
+        op_BEQ    ,op_BNE    ,op_BLEZ   ,op_BGTZ   ,
+        op_ADDI   ,op_ADDI   ,op_SLTI   ,op_SLTIU  ,
+        op_ANDI   ,op_ORI    ,op_XORI   ,op_ADDI   , /* LUI:  $0 + imm << 16 */
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_LB     ,op_LH     ,op_execute,op_LW     ,
+        op_LBU    ,op_LHU    ,op_execute,op_execute,
+        op_SB     ,op_SH     ,op_execute,op_SW     ,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_MWC2   ,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+        op_execute,op_execute,op_MWC2   ,op_execute,
+        op_execute,op_execute,op_execute,op_execute,
+    };
+
+    op->word = inst;
+    op->rs = rs;
+    op->rt = rt;
+    op->rd = rd;
+    op->sa = sa;
+    op->imm = (u32)(s16)(inst & 0x0000FFFFu);
+    op->handler = primary_ops[inst >> 26];
+    switch (inst >> 26) {
+    case 000: /* SPECIAL */
+        op->handler = SPECIAL_ops[inst % 64];
+        if (rd == zero && op->handler != op_execute)
+            if (inst % 64 < 010 || inst % 64 >= 040) /* not JR or JALR */
+                op->handler = op_NOP; /* also the real NOP, SLL $0, $0, 0 */
+        return;
+    case 001: /* REGIMM */
+        op->imm = 4*inst + SLOT_OFF;
+        switch (rt) {
+        case 000:  op->handler = op_BLTZ;    return;
+        case 001:  op->handler = op_BGEZ;    return;
+        case 020:  op->handler = op_BLTZAL;  return;
+        case 021:  op->handler = op_BGEZAL;  return;
+        }
+        op->handler = op_execute;
+        return;
+    case 002: /* J */
+    case 003: /* JAL */
+        op->imm = 4*inst;
+        return;
+    case 004: /* BEQ */
+    case 005: /* BNE */
+    case 006: /* BLEZ */
+    case 007: /* BGTZ */
+        op->imm = 4*inst + SLOT_OFF;
+        return;
+    case 014: /* ANDI */
+    case 015: /* ORI */
+    case 016: /* XORI */
+        op->imm = inst & 0x0000FFFFu;
+        break;
+    case 017: /* LUI */
+        op->imm = (inst & 0x0000FFFFu) << 16;
+        op->rs = zero;
+        break;
+    case 022: /* COP2 */
+        switch (rs) {
+        case 000:  op->handler = op_MFC2;  break;
+        case 002:  op->handler = op_CFC2;  break;
+        case 004:  op->handler = op_MTC2;  break;
+        case 006:  op->handler = op_CTC2;  break;
+        }
+        op->sa = (inst >> 7) % (1 << 4); /* element of MFC2 and MTC2 */
+        if (rs & 020) {
+            op->handler = (rs & 0xE) ? op_VECTOR : op_VECTOR_V;
+            op->call.vector = COP2_C2[inst % 64];
+            op->rs = rs & 0xF; /* element */
+            op->sa = sa; /* vd */
+        }
+        return;
+    case 062: /* LWC2 */
+    case 072: /* SWC2 */
+        op->call.transfer = (inst >> 26 == 062 ? LWC2 : SWC2)[rd];
+        op->sa = (inst >> 7) % (1 << 4);
+        op->imm = (u32)((signed int)(inst % 64) - ((inst & 64) ? 64 : 0));
+        return;
+    }
+    if (rt == zero && op->handler != op_execute && inst >> 26 < 050)
+        op->handler = op_NOP; /* loads and ALU ops without a destination */
 }
 
+/*
+ * Stands in for every instruction whose word changed since it was decoded:
+ * decodes all such words in its page, then runs the instruction itself.
+ */
+static int decode_page(const decoded_op * op, u32 PC)
+{
+    register unsigned int i;
+    const unsigned int first = (unsigned int)(op - &decoded_IMEM[0])
+                             & ~(DECODED_PAGE_SIZE - 1);
+
+    for (i = first; i < first + DECODED_PAGE_SIZE; i++) {
+        if (decoded_IMEM[i].handler != decode_page)
+            continue;
+        decoded_words[i] = *(pi32)(IMEM + 4*i);
+        decode_op(&decoded_IMEM[i], decoded_words[i]);
+    }
+    return op->handler(op, PC);
+}
+
+static void refresh_decoded_IMEM(void)
+{
+    register unsigned int page, i;
+
+    for (page = 0; page < DECODED_PAGES; page++) {
+        const unsigned int first = page * DECODED_PAGE_SIZE;
+
+        if (decoded_IMEM_valid && memcmp(
+                IMEM + 4*first, &decoded_words[first], 4*DECODED_PAGE_SIZE
+            ) == 0)
+            continue;
+        for (i = first; i < first + DECODED_PAGE_SIZE; i++)
+            if (*(pi32)(IMEM + 4*i) != decoded_words[i] || !decoded_IMEM_valid)
+                decoded_IMEM[i].handler = decode_page;
+    }
+    decoded_IMEM_valid = 1;
+}
+#endif
+
 NOINLINE void run_task(void)
 {
     register u32 PC;
+#ifdef PREDECODE_IMEM
+    register const decoded_op * op;
+#endif
 
+#ifdef USE_DYNAREC
+    if (CFG_DYNAREC != 0 && jit_run_task() != 0)
+        return;
+#endif
+#ifdef PREDECODE_IMEM
+    refresh_decoded_IMEM();
+#endif
     PC = FIT_IMEM(GET_RCP_REG(SP_PC_REG));
     for (;;) {
+#ifdef PREDECODE_IMEM
+        op = &decoded_IMEM[FIT_IMEM(PC) / 4];
+#else
         inst_word = *(pi32)(IMEM + FIT_IMEM(PC));
+#endif
 #ifdef EMULATE_STATIC_PC
         PC = (PC + 0x004);
 EX:
@@ -1995,109 +2794,15 @@ EX:
 #ifdef SP_EXECUTE_LOG
         step_SP_commands(inst_word);
 #endif
-
-#if (0 != 0)
-        if (GET_RCP_REG(SP_STATUS_REG) & SP_STATUS_HALT)
-            goto RSP_halted_CPU_exit_point; /* Only BREAK and COP0 set this. */
-        SR[zero] = 0x00000000; /* already handled on per-instruction basis */
+#ifdef PREDECODE_IMEM
+        switch (op->handler(op, PC)) {
+#else
+        switch (execute(inst_word, PC)) {
 #endif
-        switch (inst_word >> 26) {
-        case 000: /* SPECIAL */
-            switch (SPECIAL(inst_word, PC)) {
-            case -1: /* BREAK */
-                goto RSP_halted_CPU_exit_point;
-            case +1: /* JR and JALR */
-                JUMP;
-            }
-            break;
-        case 001: /* REGIMM */
-            if (REGIMM(inst_word, PC) != 0)
-                JUMP;
-            break;
-        case 002:
-            J(inst_word);
-            JUMP;
-        case 003:
-            JAL(inst_word, PC);
+        case -1: /* BREAK, or COP0 halted the RSP */
+            goto RSP_halted_CPU_exit_point;
+        case +1: /* taken branches and jumps */
             JUMP;
-        case 004:
-            if (BEQ(inst_word, PC) != 0)
-                JUMP;
-            break;
-        case 005:
-            if (BNE(inst_word, PC) != 0)
-                JUMP;
-            break;
-        case 006:
-            if (BLEZ(inst_word, PC) != 0)
-                JUMP;
-            break;
-        case 007:
-            if (BGTZ(inst_word, PC) != 0)
-                JUMP;
-            break;
-        case 010: /* ADDI:  Traps don't exist on the RCP. */
-        case 011:
-            ADDIU(inst_word);
-            break;
-        case 012:
-            SLTI(inst_word);
-            break;
-        case 013:
-            SLTIU(inst_word);
-            break;
-        case 014:
-            ANDI(inst_word);
-            break;
-        case 015:
-            ORI(inst_word);
-            break;
-        case 016:
-            XORI(inst_word);
-            break;
-        case 017:
-            LUI(inst_word);
-            break;
-        case 020:
-            COP0(inst_word);
-            if (GET_RCP_REG(SP_STATUS_REG) & SP_STATUS_HALT)
-                goto RSP_halted_CPU_exit_point;
-            break;
-        case 022:
-            COP2(inst_word);
-            break;
-        case 040:
-            LB(inst_word);
-            break;
-        case 041:
-            LH(inst_word);
-            break;
-        case 043:
-            LW(inst_word);
-            break;
-        case 044:
-            LBU(inst_word);
-            break;
-        case 045:
-            LHU(inst_word);
-            break;
-        case 050:
-            SB(inst_word);
-            break;
-        case 051:
-            SH(inst_word);
-            break;
-        case 053:
-            SW(inst_word);
-            break;
-        case 062: /* LWC2 */
-            MWC2_load(inst_word);
-            break;
-        case 072: /* SWC2 */
-            MWC2_store(inst_word);
-            break;
-        default:
-            res_S();
         }
 
 #ifndef EMULATE_STATIC_PC
@@ -2113,7 +2818,11 @@ EX:
 #else
         continue;
 set_branch_delay:
+#ifdef PREDECODE_IMEM
+        op = &decoded_IMEM[FIT_IMEM(PC) / 4];
+#else
         inst_word = *(pi32)(IMEM + FIT_IMEM(PC));
+#endif
         PC = FIT_IMEM(temp_PC);
         goto EX;
 #endif
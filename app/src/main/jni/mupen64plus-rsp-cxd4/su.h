@@ -71,10 +71,25 @@
 #define EMULATE_STATIC_PC
 #endif
 
+/*
+ * Enabled:
+ *     Each IMEM word is decoded once, into a handler and its operand fields,
+ *     and run_task() dispatches from that table until IMEM is overwritten.
+ * Disabled:
+ *     The op-code fields are extracted again on every instruction executed.
+ */
+#if defined(EMULATE_STATIC_PC) && !defined(SP_EXECUTE_LOG)
+#define PREDECODE_IMEM
+#endif
+
+/*
+ * The op-code handlers are expanded both in run_task() and in step_SP(), so
+ * plain `inline` is no longer enough to keep them inside the interpreter loop.
+ */
 #if (0 != 0)
 #define PROFILE_MODE    static NOINLINE
 #else
-#define PROFILE_MODE    static INLINE
+#define PROFILE_MODE    static FORCE_INLINE
 #endif
 
 typedef enum {
@@ -163,8 +178,10 @@ extern short MFC0_count[32];
  * The number of times to tolerate executing `MFC0    $at, $c4`.
  * Replace $at with any register--the timeout limit is per each.
  *
- * Set to a higher value to avoid prematurely quitting the interpreter.
- * Set to a lower value for speed...you could get away with 10 sometimes.
+ * Wait loops that provably never end are yielded from at their second read
+ * already (see COP0), so this only limits the ones that could not be told
+ * apart from work that happens to read the status:  32767 reads per task,
+ * or 16 with the WaitForCPUHost setting to force syncing with the CPU.
  */
 extern int MF_SP_STATUS_TIMEOUT;
 
@@ -367,6 +384,12 @@ extern void LTV(unsigned vt, unsigned element, signed offset, unsigned base);
 extern void SWV(unsigned vt, unsigned element, signed offset, unsigned base);
 extern void STV(unsigned vt, unsigned element, signed offset, unsigned base);
 
+/*
+ * Executes a single instruction word for run_task() or the recompiler.
+ * Returns -1 if the RSP halted, or +1 if a branch was taken to temp_PC.
+ */
+extern int step_SP(u32 inst, u32 PC);
+
 NOINLINE extern void run_task(void);
 
 #endif
@@ -0,0 +1,512 @@
+/******************************************************************************\
+* Project:  RSP Task Benchmark (Interpreter versus Dynamic Recompiler)         *
+* License:  CC0 Public Domain Dedication                                       *
+*                                                                              *
+* To the extent possible under law, the author(s) have dedicated all copyright *
+* and related and neighboring rights to this software to the public domain     *
+* worldwide. This software is distributed without any warranty.                *
+*                                                                              *
+* You should have received a copy of the CC0 Public Domain Dedication along    *
+* with this software.                                                          *
+* If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
+\******************************************************************************/
+
+/*
+ * Runs the same RSP tasks through run_task() with the recompiler off and on,
+ * checks that both leave the exact same machine state behind and reports the
+ * time spent per task.
+ *
+ * Build with:
+ *     cc -O2 -o rspbench rspbench.c ../jit.c ../module.c ../su.c \
+ *         ../vu/add.c ../vu/divide.c ../vu/logical.c ../vu/multiply.c \
+ *         ../vu/select.c ../vu/vu.c ../osal_dynamiclib_unix.c -I.. \
+ *         -I../../mupen64plus-core/src/api -DM64P_PLUGIN_API -DARCH_MIN_SSE2 -ldl
+ *
+ * Usage:
+ *     rspbench [-r repeat] [-f programs] [imem.bin dmem.bin]
+ *
+ *     -r repeat    number of timed runs of each task (default 2000)
+ *     -f programs  also check that many random instruction streams
+ *
+ * The built-in task streams DMEM through a few vector and scalar loops and
+ * DMAs the results back out.  Dumps of IMEM and DMEM (big-endian, as saved
+ * by DllConfig()) replace it with a task taken from a real game.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "su.h"
+#include "module.h"
+#include "m64p_config.h"
+
+extern ptr_ConfigGetParamBool ConfigGetParamBool;
+extern EXPORT unsigned int CALL DoRspCycles(unsigned int cycles);
+extern EXPORT void CALL InitiateRSP(RSP_INFO Rsp_Info, pu32 CycleCount);
+
+#define RDRAM_SIZE      0x00800000ul
+
+static u8* rdram;
+static ALIGNED u8 sp_mem[0x2000];
+static unsigned int registers[32];
+
+static u8* initial_rdram;
+static u8 initial_sp_mem[0x2000];
+
+typedef struct {
+    u32 SR[32];
+    i16 VR[32][N];
+    i16 VACC[3][N];
+    i16 flags[5][N];
+    u8 sp_mem[0x2000];
+    u32 pc, status;
+    u32 rdram_sum;
+} machine_state;
+
+static int CALL get_param_bool(m64p_handle handle, const char* name)
+{
+    return 0 * (handle != NULL) * (name != NULL);
+}
+static void check_interrupts(void)
+{
+    return;
+}
+
+/*** instruction encoding ***/
+
+#define OP_R(rs, rt, rd, sa, f) ((rs) << 21 | (rt) << 16 | (rd) << 11 | (sa) << 6 | (f))
+#define OP_I(op, rs, rt, imm)   ((op) << 26 | (rs) << 21 | (rt) << 16 | ((imm) & 0xFFFFu))
+#define OP_J(op, target)        ((op) << 26 | ((target) >> 2 & 0x03FFFFFFu))
+#define OP_V(f, vd, vs, vt, e)  (022u << 26 | 1 << 25 | (e) << 21 | (vt) << 16 | (vs) << 11 | (vd) << 6 | (f))
+#define OP_C2(op, rt, rd, e)    (022u << 26 | (op) << 21 | (rt) << 16 | (rd) << 11 | (e) << 7)
+#define OP_C0(op, rt, rd)       (020u << 26 | (op) << 21 | (rt) << 16 | (rd) << 11)
+#define OP_MWC2(op, f, vt, e, offset, base) \
+    ((op) << 26 | (base) << 21 | (vt) << 16 | (f) << 11 | (e) << 7 | ((offset) & 0x7F))
+#define OP_BREAK                0x0000000Du
+
+enum { t0 = 8, t1, t2, t3, t4, t5, t6, t7, s0, s1, s2, s3, t8 = 24, t9 };
+
+static u32 program[0x1000 / 4];
+static unsigned int emitted;
+
+static unsigned int emit(u32 inst)
+{
+    program[emitted] = inst;
+    return (emitted++);
+}
+static void patch_branch(unsigned int at, unsigned int target)
+{
+    program[at] |= (target - at - 1) & 0xFFFFu;
+}
+
+static void build_task(void)
+{
+    unsigned int loop, branch, call, sub;
+
+    memset(program, 0, sizeof(program));
+    emitted = 0;
+    emit(OP_I(015, zero, t0, 0x000));
+    emit(OP_C0(4, t0, 0));
+    emit(OP_I(017, zero, t1, 0x0010));
+    emit(OP_C0(4, t1, 1));
+    emit(OP_I(015, zero, t2, 0x7FF));
+    emit(OP_C0(4, t2, 2)); /* DMA 2 KiB from 0x00100000 to DMEM */
+
+    emit(OP_I(015, zero, s0, 0x000));
+    emit(OP_I(015, zero, s1, 0x800));
+    loop = emit(OP_MWC2(062u, 4, 1, 0, 0, s0)); /* LQV */
+    emit(OP_MWC2(062u, 4, 2, 0, 1, s0));
+    emit(OP_V(000, 3, 1, 2, 0));  /* VMULF */
+    emit(OP_V(010, 3, 1, 2, 3));  /* VMACF $v2[1q] */
+    emit(OP_V(006, 4, 1, 2, 8));  /* VMUDN $v2[0] */
+    emit(OP_V(017, 4, 2, 1, 5));  /* VMADH $v1[1h] */
+    emit(OP_V(020, 5, 3, 4, 0));  /* VADD */
+    emit(OP_V(021, 6, 3, 4, 13)); /* VSUB $v4[5] */
+    emit(OP_V(045, 7, 5, 6, 0));  /* VCH */
+    emit(OP_V(047, 8, 5, 6, 2));  /* VMRG $v6[0q] */
+    emit(OP_V(050, 9, 8, 7, 0));  /* VAND */
+    emit(OP_V(035, 10, 0, 0, 9)); /* VSAW, middle slice */
+    emit(OP_MWC2(072u, 4, 9, 0, 0, s0)); /* SQV */
+    emit(OP_MWC2(072u, 4, 10, 0, 1, s0));
+    emit(OP_I(011, s0, s0, 32));
+    branch = emit(OP_I(005, s0, s1, 0)); /* BNE */
+    emit(OP_I(011, s2, s2, 1));
+    patch_branch(branch, loop);
+
+    emit(OP_I(015, zero, s0, 0x000));
+    loop = emit(OP_I(043, s0, t0, 0)); /* LW */
+    emit(OP_I(041, s0, t1, 4)); /* LH */
+    emit(OP_I(044, s0, t2, 7)); /* LBU */
+    emit(OP_R(s3, t0, s3, 0, 041)); /* ADDU */
+    emit(OP_R(s3, t1, s3, 0, 046)); /* XOR */
+    emit(OP_R(0, s3, t3, 3, 000)); /* SLL */
+    emit(OP_R(0, s3, t4, 29, 002)); /* SRL */
+    emit(OP_R(t3, t4, s3, 0, 045)); /* OR */
+    emit(OP_R(t0, t1, t5, 0, 052)); /* SLT */
+    emit(OP_R(s3, t5, s3, 0, 041));
+    emit(OP_R(s3, t2, s3, 0, 043)); /* SUBU */
+    emit(OP_I(053, s0, s3, 0x800)); /* SW */
+    emit(OP_I(051, s0, t2, 0x806)); /* SH */
+    emit(OP_I(011, s0, s0, 8));
+    branch = emit(OP_I(005, s0, s1, 0));
+    emit(OP_I(043, s0, t6, 4)); /* LW in the delay slot */
+    patch_branch(branch, loop);
+    emit(OP_I(043, s3, t6, 1)); /* unaligned LW */
+
+    call = emit(OP_J(003u, 0)); /* JAL */
+    emit(0x00000000);
+
+    emit(OP_J(003u, 0x800)); /* an overlay, replaced by DMA and called again */
+    emit(0x00000000);
+    emit(OP_I(015, zero, t0, 0x1800));
+    emit(OP_C0(4, t0, 0));
+    emit(OP_I(017, zero, t1, 0x0030));
+    emit(OP_C0(4, t1, 1));
+    emit(OP_I(015, zero, t2, 0x007));
+    emit(OP_C0(4, t2, 2));
+    emit(OP_J(003u, 0x800));
+    emit(0x00000000);
+
+    emit(OP_I(015, zero, t0, 0x000));
+    emit(OP_C0(4, t0, 0));
+    emit(OP_I(017, zero, t1, 0x0020));
+    emit(OP_C0(4, t1, 1));
+    emit(OP_I(015, zero, t2, 0xFFF));
+    emit(OP_C0(4, t2, 3)); /* DMA all of DMEM out to 0x00200000 */
+    emit(OP_I(053, zero, s3, 0xFF8));
+    emit(OP_BREAK);
+
+    sub = emit(OP_C2(000, t7, 9, 2)); /* MFC2 */
+    program[call] |= sub;
+    emit(OP_C2(004, t7, 11, 4)); /* MTC2 */
+    emit(OP_C2(002, t8, 0, 0)); /* CFC2 $vco */
+    emit(OP_C2(006, t8, 1, 0)); /* CTC2 $vcc */
+    branch = emit(OP_I(001, t7, 1, 0)); /* BGEZ */
+    emit(OP_C0(0, t9, 4)); /* MFC0 in the delay slot, ends the block */
+    emit(OP_I(017, zero, t9, 0x1234));
+    patch_branch(branch, emitted);
+    emit(OP_R(ra, 0, 0, 0, 010)); /* JR */
+    emit(OP_I(011, t9, t9, 1));
+
+    program[0x800 / 4 + 0] = OP_I(011, s3, s3, 0x0001);
+    program[0x800 / 4 + 1] = OP_R(ra, 0, 0, 0, 010);
+    *(pu32)(initial_rdram + 0x00300000) = OP_I(011, s3, s3, 0x0077);
+    *(pu32)(initial_rdram + 0x00300004) = OP_R(ra, 0, 0, 0, 010);
+    emitted = 0x800 / 4 + 3;
+    return;
+}
+
+/*
+ * Random, forward-only control flow over most of the instruction set.
+ * Every program starts with VRCP to reset the divide unit's hidden state.
+ */
+static u32 random_instruction(unsigned int at, unsigned int length)
+{
+    static const unsigned char vector_ops[] = {
+        000, 001, 004, 005, 006, 007, 010, 011, 014, 015, 016, 017,
+        020, 021, 023, 024, 025, 035, 040, 041, 042, 043, 044, 045, 046,
+        047, 050, 051, 052, 053, 054, 055, 060, 061, 062, 063, 064, 065,
+        066, 067,
+    };
+    static const unsigned char special[] = {
+        000, 002, 003, 004, 006, 007, 040, 041, 042, 043, 044, 045, 046,
+        047, 052, 053,
+    };
+    const unsigned int rs = rand() % 32, rt = rand() % 32, rd = rand() % 32;
+    const unsigned int forward = at + 2 + rand() % 8;
+    const unsigned int skip = forward < length ? forward - at - 1 : 1;
+
+    switch (rand() % 16) {
+    case 0:
+    case 1:
+        return OP_R(rs, rt, rd, rand() % 32, special[rand() % sizeof(special)]);
+    case 2:
+    case 3:
+        return OP_I(010 + rand() % 8, rs, rt, rand());
+    case 4:
+        return OP_I("\40\41\43\44\45\50\51\53"[rand() % 8], rs, rt, rand() % 0x1000);
+    case 5:
+    case 6:
+    case 7:
+        return OP_V(vector_ops[rand() % sizeof(vector_ops)], rd, rs, rt, rand() % 16);
+    case 8:
+        return (rand() % 2)
+          ? OP_C2("\0\4"[rand() % 2], rt, rd, rand() % 16)
+          : OP_C2("\2\6"[rand() % 2], rt, rd % 4, 0);
+    case 9: /* There is no LWV. */
+        return OP_MWC2(062u, "\0\1\2\3\4\5\6\7\10\11\13"[rand() % 11], rt, rand() % 16, rand(), rs);
+    case 10:
+        return OP_MWC2(072u, rand() % 12, rt, rand() % 16, rand(), rs);
+    case 11:
+        return OP_I(004 + rand() % 4, rs, rt, skip);
+    case 12:
+        return OP_I(001, rs, "\0\1\20\21"[rand() % 4], skip);
+    case 13:
+        return (rand() % 4) ? OP_C0(0, rt, 4 + rand() % 4) : 0x00000000;
+    }
+    return OP_R(rs, rt, rd, 0, 041);
+}
+
+static int is_branch(u32 inst)
+{
+    if (inst >> 26 == 000)
+        return (inst % 64 == 010 || inst % 64 == 011);
+    return (inst >> 26 >= 001 && inst >> 26 <= 007);
+}
+
+static int is_jump_register(u32 inst)
+{
+    return (inst >> 26 == 000 && (inst % 64 == 010 || inst % 64 == 011));
+}
+
+static void build_random_task(unsigned int length, unsigned int start)
+{
+    register unsigned int i;
+
+    for (i = 0; i < 0x1000 / 4; i++)
+        program[i] = OP_BREAK;
+    program[0] = OP_V(060, 0, 0, 0, 0);
+    for (i = 1; i < length; i++) {
+        const u32 previous = program[i - 1];
+
+        program[i] = random_instruction(i, length);
+        if (is_branch(previous)) { /* no branches in delay slots */
+            while (is_branch(program[i]))
+                program[i] = random_instruction(i, length);
+        } else if (rand() % 32 == 0 && i + 1 < length) { /* computed jumps */
+            program[i] = OP_I(015, zero, t9, 4*(start + i + 2 + rand() % 4));
+            program[++i] = OP_R(t9, 0, (rand() % 2) ? ra : 0, 0, (rand() % 2) ? 010 : 011);
+        } else if (rand() % 32 == 0) {
+            program[i] = OP_J(002u + rand() % 2, 4*(start + i + 2));
+        }
+    }
+
+/*
+ * Anything landing right on a JR could find a stale, backward target in the
+ * register, so move such targets to the delay slot of the JR instead.
+ */
+    for (i = 0; i < length; i++) {
+        const u32 inst = program[i];
+        unsigned int target;
+
+        if (inst >> 26 == 001 || (inst >> 26 >= 004 && inst >> 26 <= 007)) {
+            target = i + 1 + (inst & 0xFFFFu);
+            program[i] += is_jump_register(program[target % 1024]);
+        } else if (inst >> 26 == 002 || inst >> 26 == 003) {
+            target = (inst & 0x3FFu) - start;
+            program[i] += is_jump_register(program[target % 1024]);
+        } else if (inst >> 26 == 015 && is_jump_register(program[i + 1])) {
+            target = (inst & 0xFFFFu) / 4 - start;
+            program[i] += 4*is_jump_register(program[target % 1024]);
+        }
+    }
+    emitted = 0x1000 / 4;
+    return;
+}
+
+/*** machine state ***/
+
+static void reset_machine(u32 start)
+{
+    register unsigned int i;
+
+    memcpy(rdram, initial_rdram, RDRAM_SIZE);
+    memcpy(sp_mem, initial_sp_mem, sizeof(sp_mem));
+    memset(registers, 0, sizeof(registers));
+    memset(SR, 0, sizeof(SR));
+    memset(VR, 0, sizeof(VR));
+    memset(VACC, 0, sizeof(VACC));
+    memset(cf_ne, 0, sizeof(cf_ne));
+    memset(cf_co, 0, sizeof(cf_co));
+    memset(cf_clip, 0, sizeof(cf_clip));
+    memset(cf_comp, 0, sizeof(cf_comp));
+    memset(cf_vce, 0, sizeof(cf_vce));
+    for (i = 0; i < 32; i++)
+        VR[i][i % N] = (i16)(0x1234 * i + 0x0FED);
+    *CR[0x4] = SP_STATUS_INTR_BREAK;
+    GET_RCP_REG(SP_PC_REG) = start;
+    return;
+}
+
+static void save_machine(machine_state* state)
+{
+    register u32 i, sum;
+
+    memcpy(state->SR, SR, sizeof(state->SR));
+    for (i = 0; i < 32; i++)
+        memcpy(state->VR[i], VR[i], sizeof(state->VR[i]));
+    memcpy(state->VACC, VACC, sizeof(VACC));
+    memcpy(state->flags[0], cf_ne, sizeof(cf_ne));
+    memcpy(state->flags[1], cf_co, sizeof(cf_co));
+    memcpy(state->flags[2], cf_clip, sizeof(cf_clip));
+    memcpy(state->flags[3], cf_comp, sizeof(cf_comp));
+    memcpy(state->flags[4], cf_vce, sizeof(cf_vce));
+    memcpy(state->sp_mem, sp_mem, sizeof(sp_mem));
+    state->pc = GET_RCP_REG(SP_PC_REG);
+    state->status = *CR[0x4];
+    sum = 0;
+    for (i = 0; i < RDRAM_SIZE; i += 4)
+        sum = (sum ^ *(pu32)(rdram + i)) * 16777619u;
+    state->rdram_sum = sum;
+    return;
+}
+
+static double run(int dynarec, u32 start, unsigned int repeat, machine_state* state)
+{
+    struct timespec t0, t1;
+    double best;
+    register unsigned int i;
+
+    CFG_DYNAREC = dynarec;
+    best = 1e30;
+    for (i = 0; i < repeat; i++) {
+        double elapsed;
+
+        reset_machine(start);
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        DoRspCycles(0x100);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        elapsed = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        if (elapsed < best)
+            best = elapsed;
+    }
+    save_machine(state);
+    return (best);
+}
+
+static int compare(const machine_state* a, const machine_state* b, const char* name)
+{
+    static const char* parts[] = {
+        "SR", "VR", "VACC", "flags", "DMEM/IMEM", "PC", "SP_STATUS", "RDRAM",
+    };
+    const int part = 0
+      | (memcmp(a->SR, b->SR, sizeof(a->SR)) != 0) << 0
+      | (memcmp(a->VR, b->VR, sizeof(a->VR)) != 0) << 1
+      | (memcmp(a->VACC, b->VACC, sizeof(a->VACC)) != 0) << 2
+      | (memcmp(a->flags, b->flags, sizeof(a->flags)) != 0) << 3
+      | (memcmp(a->sp_mem, b->sp_mem, sizeof(a->sp_mem)) != 0) << 4
+      | (a->pc != b->pc) << 5
+      | (a->status != b->status) << 6
+      | (a->rdram_sum != b->rdram_sum) << 7
+    ;
+    register int i;
+
+    if (part == 0)
+        return 0;
+    printf("%s: mismatch in", name);
+    for (i = 0; i < 8; i++)
+        if (part & (1 << i))
+            printf(" %s", parts[i]);
+    printf("\n");
+    return 1;
+}
+
+static int load_dump(const char* path, u8* memory)
+{
+    FILE* stream;
+    u8 bytes[0x1000];
+    register unsigned int i;
+
+    stream = fopen(path, "rb");
+    if (stream == NULL || fread(bytes, 1, sizeof(bytes), stream) != sizeof(bytes)) {
+        fprintf(stderr, "Could not read 4 KiB from %s.\n", path);
+        if (stream != NULL)
+            fclose(stream);
+        return 0;
+    }
+    fclose(stream);
+    for (i = 0; i < 0x1000; i++)
+        memory[BES(i)] = bytes[i];
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    static machine_state interpreted, recompiled;
+    RSP_INFO info;
+    double ns_interpreted, ns_recompiled;
+    unsigned int repeat, programs, failures;
+    register unsigned int i;
+    int arg;
+
+    repeat = 2000;
+    programs = 0;
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+        if (argv[arg][1] == 'r' && arg + 1 < argc)
+            repeat = atoi(argv[++arg]);
+        else if (argv[arg][1] == 'f' && arg + 1 < argc)
+            programs = atoi(argv[++arg]);
+
+    rdram = calloc(RDRAM_SIZE, 1);
+    initial_rdram = malloc(RDRAM_SIZE);
+    srand(1);
+    for (i = 0; i < RDRAM_SIZE; i += 2)
+        *(pu16)(rdram + i) = (u16)rand();
+    memcpy(initial_rdram, rdram, RDRAM_SIZE);
+
+    ConfigGetParamBool = get_param_bool;
+    memset(&info, 0, sizeof(info));
+    info.RDRAM = rdram;
+    info.DMEM = sp_mem;
+    info.IMEM = sp_mem + 0x1000;
+    info.MI_INTR_REG = &registers[0];
+    info.SP_MEM_ADDR_REG = &registers[1];
+    info.SP_DRAM_ADDR_REG = &registers[2];
+    info.SP_RD_LEN_REG = &registers[3];
+    info.SP_WR_LEN_REG = &registers[4];
+    info.SP_STATUS_REG = &registers[5];
+    info.SP_DMA_FULL_REG = &registers[6];
+    info.SP_DMA_BUSY_REG = &registers[7];
+    info.SP_PC_REG = &registers[8];
+    info.SP_SEMAPHORE_REG = &registers[9];
+    info.DPC_START_REG = &registers[10];
+    info.DPC_END_REG = &registers[11];
+    info.DPC_CURRENT_REG = &registers[12];
+    info.DPC_STATUS_REG = &registers[13];
+    info.DPC_CLOCK_REG = &registers[14];
+    info.DPC_BUFBUSY_REG = &registers[15];
+    info.DPC_PIPEBUSY_REG = &registers[16];
+    info.DPC_TMEM_REG = &registers[17];
+    info.CheckInterrupts = check_interrupts;
+    InitiateRSP(info, NULL);
+
+    failures = 0;
+    for (i = 0; i < programs; i++) {
+        char name[32];
+        const u32 start = (rand() % 2) ? 0x000 : 0xE00;
+        register unsigned int j;
+
+        build_random_task(64 + rand() % 448, start / 4);
+        for (j = 0; j < 0x1000 / 4; j++)
+            *(pu32)(initial_sp_mem + 0x1000 + FIT_IMEM(start + 4*j)) = program[j];
+        for (j = 0; j < 0x1000; j += 2)
+            *(pu16)(initial_sp_mem + j) = (u16)rand();
+        *(pu32)(initial_sp_mem + 0xFC0) = 0;
+        run(0, start, 1, &interpreted);
+        run(1, start, 1, &recompiled);
+        sprintf(name, "program %u", i);
+        failures += compare(&interpreted, &recompiled, name);
+    }
+    if (programs != 0)
+        printf("%u of %u random programs mismatched\n", failures, programs);
+
+    memset(initial_sp_mem, 0, sizeof(initial_sp_mem));
+    if (arg + 1 < argc) {
+        if (!load_dump(argv[arg], initial_sp_mem + 0x1000)
+         || !load_dump(argv[arg + 1], initial_sp_mem))
+            return 1;
+    } else {
+        build_task();
+        memcpy(initial_sp_mem + 0x1000, program, 4 * emitted);
+    }
+    ns_interpreted = run(0, 0x000, repeat, &interpreted);
+    ns_recompiled = run(1, 0x000, repeat, &recompiled);
+    failures += compare(&interpreted, &recompiled, "task");
+    printf("interpreter: %10.0f ns/task\n", ns_interpreted);
+    printf("recompiler:  %10.0f ns/task (%.2fx)\n",
+           ns_recompiled, ns_interpreted / ns_recompiled);
+    printf("state hash:  %08X\n", (unsigned int)interpreted.rdram_sum);
+    return (failures != 0);
+}
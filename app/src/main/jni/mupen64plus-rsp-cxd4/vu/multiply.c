@@ -16,28 +16,74 @@
 #include "multiply.h"
 
 #ifdef ARCH_MIN_SSE2
-#define _mm_cmple_epu16(dst, src) \
-    _mm_cmpeq_epi16(_mm_subs_epu16(dst, src), _mm_setzero_si128())
-#define _mm_cmpgt_epu16(dst, src) \
-    _mm_andnot_si128(_mm_cmpeq_epi16(dst, src), _mm_cmple_epu16(src, dst))
-#define _mm_cmplt_epu16(dst, src) \
-    _mm_cmpgt_epu16(src, dst)
-
 #define _mm_mullo_epu16(dst, src) \
     _mm_mullo_epi16(dst, src)
 
-static INLINE void SIGNED_CLAMP_AM(pi16 VD)
-{ /* typical sign-clamp of accumulator-mid (bits 31:16) */
-    v16 dst, src;
-    v16 pvd, pvs;
+/*
+ * The unsigned clamp of VMACU, and the clamp of accumulator bits 15..0 that
+ * VMADL and VMADN return, are both just extra steps added after the signed
+ * clamp of accumulator bits 47..16.
+ */
+static INLINE v16 clamp_acc_unsigned(v16 md, v16 hi)
+{
+    v16 clamped, overflow;
+
+    clamped = clamp_acc_md(md, hi);
+    overflow = _mm_cmpgt_epi16(clamped, md); /* VD |= -(ACC47..16 > +32767) */
+    md = _mm_srai_epi16(clamped, 15);
+    clamped = _mm_andnot_si128(md, clamped); /* Only this clamp is unsigned. */
+    return _mm_or_si128(clamped, overflow);
+}
+
+static INLINE v16 clamp_acc_lo(v16 lo, v16 md, v16 hi)
+{
+    v16 clamped, unclamped;
+
+    clamped = clamp_acc_md(md, hi);
+    unclamped = _mm_cmpeq_epi16(clamped, md); /* result_clamped == raw ? */
+    clamped = _mm_xor_si128(clamped, _mm_set1_epi16(-32768)); /* 0000:FFFF */
+    return _mm_select_si128(unclamped, lo, clamped);
+}
+
+/*
+ * VMACF and VMACU:  acc += (VS * VT) << 1, where the doubled product of two
+ * signed halfwords, before the sign-extension to 48 bits, needs 32 bits.
+ */
+static INLINE void do_macf(v16 vs, v16 vt)
+{
+    v16 acc_hi, acc_md, acc_lo;
+    v16 prod_hi, prod_lo, sign;
+    v16 carry, overflow;
+
+    prod_lo = _mm_mullo_epi16(vs, vt);
+    prod_hi = _mm_mulhi_epi16(vs, vt);
+    sign = _mm_srai_epi16(prod_hi, 15); /* -(product < 0), not of product<<1 */
+    prod_hi = _mm_add_epi16(prod_hi, prod_hi);
+    prod_hi = _mm_or_si128(prod_hi, _mm_srli_epi16(prod_lo, 15));
+    prod_lo = _mm_add_epi16(prod_lo, prod_lo);
+
+    acc_lo = *(v16 *)VACC_L;
+    acc_md = *(v16 *)VACC_M;
+    acc_hi = *(v16 *)VACC_H;
+
+    acc_lo = _mm_add_epi16(acc_lo, prod_lo);
+    *(v16 *)VACC_L = acc_lo;
+    carry = _mm_cmplt_epu16(acc_lo, prod_lo); /* overflow:  (x + y < y) */
 
-    pvs = _mm_load_si128((v16 *)VACC_H);
-    pvd = _mm_load_si128((v16 *)VACC_M);
-    dst = _mm_unpacklo_epi16(pvd, pvs);
-    src = _mm_unpackhi_epi16(pvd, pvs);
+/*
+ * Unlike in VMADM or VMADN, prod_hi can be 0xFFFF with a carry coming in, so
+ * the carry out of the middle word has to be detected for both additions.
+ */
+    acc_md = _mm_add_epi16(acc_md, prod_hi);
+    overflow = _mm_cmplt_epu16(acc_md, prod_hi);
+    acc_md = _mm_sub_epi16(acc_md, carry);
+    carry = _mm_and_si128(carry, _mm_cmpeq_epi16(acc_md, _mm_setzero_si128()));
+    *(v16 *)VACC_M = acc_md;
 
-    dst = _mm_packs_epi32(dst, src);
-    _mm_store_si128((v16 *)VD, dst);
+    acc_hi = _mm_add_epi16(acc_hi, sign);
+    acc_hi = _mm_sub_epi16(acc_hi, overflow);
+    acc_hi = _mm_sub_epi16(acc_hi, carry);
+    *(v16 *)VACC_H = acc_hi;
     return;
 }
 #else
@@ -63,7 +109,6 @@ static INLINE void SIGNED_CLAMP_AM(pi16 VD)
         VD[i] ^= 0x8000 * (hi[i] | lo[i]);
     return;
 }
-#endif
 
 static INLINE void UNSIGNED_CLAMP(pi16 VD)
 { /* sign-zero hybrid clamp of accumulator-mid (bits 31:16) */
@@ -152,6 +197,7 @@ INLINE static void do_macu(pi16 VD, pi16 VS, pi16 VT)
     UNSIGNED_CLAMP(VD);
     return;
 }
+#endif
 
 VECTOR_OPERATION VMULF(v16 vs, v16 vt)
 {
@@ -392,7 +438,23 @@ VECTOR_OPERATION VMUDN(v16 vs, v16 vt)
 
 VECTOR_OPERATION VMUDH(v16 vs, v16 vt)
 {
-#ifdef ARCH_MIN_SSE2
+#if defined(ARCH_MIN_SSE2) && defined(__ARM_NEON__)
+    int32x4_t prod_lo, prod_hi;
+    int16x8x2_t acc;
+
+/*
+ * NEON has the widening multiply that SSE2 has to split into a MULLO and a
+ * MULHI and then unpack, and the narrowing saturation that SSE2 has to pack.
+ */
+    prod_lo = vmull_s16(vget_low_s16((int16x8_t)vs), vget_low_s16((int16x8_t)vt));
+    prod_hi = vmull_s16(vget_high_s16((int16x8_t)vs), vget_high_s16((int16x8_t)vt));
+    acc = vuzpq_s16((int16x8_t)prod_lo, (int16x8_t)prod_hi);
+
+    *(v16 *)VACC_L = _mm_setzero_si128();
+    *(v16 *)VACC_M = (v16)acc.val[0]; /* acc 31..16 storing (VS*VT)15..0 */
+    *(v16 *)VACC_H = (v16)acc.val[1]; /* acc 47..32 storing (VS*VT)31..16 */
+    return (v16)vcombine_s16(vqmovn_s32(prod_lo), vqmovn_s32(prod_hi));
+#elif defined(ARCH_MIN_SSE2)
     v16 prod_high;
 
     prod_high = _mm_mulhi_epi16(vs, vt);
@@ -402,19 +464,11 @@ VECTOR_OPERATION VMUDH(v16 vs, v16 vt)
     *(v16 *)VACC_M = vs; /* acc 31..16 storing (VS*VT)15..0 */
     *(v16 *)VACC_H = prod_high; /* acc 47..32 storing (VS*VT)31..16 */
 
-/*
- * "Unpack" the low 16 bits and the high 16 bits of each 32-bit product to a
- * couple xmm registers, re-storing them as 2 32-bit products each.
- */
-    vt = _mm_unpackhi_epi16(vs, prod_high);
-    vs = _mm_unpacklo_epi16(vs, prod_high);
-
 /*
  * Re-interleave or pack both 32-bit products in both xmm registers with
  * signed saturation:  prod < -32768 to -32768 and prod > +32767 to +32767.
  */
-    vs = _mm_packs_epi32(vs, vt);
-    return (vs);
+    return clamp_acc_md(vs, prod_high);
 #else
     word_32 product[N];
     register unsigned int i;
@@ -433,24 +487,13 @@ VECTOR_OPERATION VMUDH(v16 vs, v16 vt)
 
 VECTOR_OPERATION VMACF(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
-
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
+    do_macf(vs, vt);
+    return clamp_acc_md(*(v16 *)VACC_M, *(v16 *)VACC_H);
 #else
-    v16 VS, VT;
+    ALIGNED i16 VD[N];
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_macf(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
-    return (vs);
-#else
+    do_macf(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -458,24 +501,13 @@ VECTOR_OPERATION VMACF(v16 vs, v16 vt)
 
 VECTOR_OPERATION VMACU(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
-
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
+    do_macf(vs, vt);
+    return clamp_acc_unsigned(*(v16 *)VACC_M, *(v16 *)VACC_H);
 #else
-    v16 VS, VT;
+    ALIGNED i16 VD[N];
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_macu(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
-    return (vs);
-#else
+    do_macu(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -519,20 +551,7 @@ VECTOR_OPERATION VMADL(v16 vs, v16 vt)
  * So it is based on the standard signed clamping logic for VM?DM, VM?DH,
  * except that extra steps must be concatenated to that definition.
  */
-    vt = _mm_unpackhi_epi16(acc_md, acc_hi);
-    vs = _mm_unpacklo_epi16(acc_md, acc_hi);
-    vs = _mm_packs_epi32(vs, vt);
-
-    acc_md = _mm_cmpeq_epi16(acc_md, vs); /* (unclamped == clamped) ... */
-    acc_lo = _mm_and_si128(acc_lo, acc_md); /* ... ? low : mid */
-    vt = _mm_cmpeq_epi16(vt, vt);
-    acc_md = _mm_xor_si128(acc_md, vt); /* (unclamped != clamped) ... */
-
-    vs = _mm_and_si128(vs, acc_md); /* ... ? VS_clamped : 0x0000 */
-    vs = _mm_or_si128(vs, acc_lo); /*                   : acc_lo */
-    acc_md = _mm_slli_epi16(acc_md, 15); /* ... ? ^ 0x8000 : ^ 0x0000 */
-    vs = _mm_xor_si128(vs, acc_md); /* Stupid unsigned-clamp-ish adjustment. */
-    return (vs);
+    return clamp_acc_lo(acc_lo, acc_md, acc_hi);
 #else
     word_32 product[N], addend[N];
     register unsigned int i;
@@ -591,11 +610,7 @@ VECTOR_OPERATION VMADM(v16 vs, v16 vt)
     acc_hi = _mm_add_epi16(acc_hi, prod_hi);
     acc_hi = _mm_sub_epi16(acc_hi, overflow);
     *(v16 *)VACC_H = acc_hi;
-
-    vt = _mm_unpackhi_epi16(acc_md, acc_hi);
-    vs = _mm_unpacklo_epi16(acc_md, acc_hi);
-    vs = _mm_packs_epi32(vs, vt);
-    return (vs);
+    return clamp_acc_md(acc_md, acc_hi);
 #else
     word_32 product[N], addend[N];
     register unsigned int i;
@@ -663,20 +678,7 @@ VECTOR_OPERATION VMADN(v16 vs, v16 vt)
  * So it is based on the standard signed clamping logic for VM?DM, VM?DH,
  * except that extra steps must be concatenated to that definition.
  */
-    vt = _mm_unpackhi_epi16(acc_md, acc_hi);
-    vs = _mm_unpacklo_epi16(acc_md, acc_hi);
-    vs = _mm_packs_epi32(vs, vt);
-
-    acc_md = _mm_cmpeq_epi16(acc_md, vs); /* (unclamped == clamped) ... */
-    acc_lo = _mm_and_si128(acc_lo, acc_md); /* ... ? low : mid */
-    vt = _mm_cmpeq_epi16(vt, vt);
-    acc_md = _mm_xor_si128(acc_md, vt); /* (unclamped != clamped) ... */
-
-    vs = _mm_and_si128(vs, acc_md); /* ... ? VS_clamped : 0x0000 */
-    vs = _mm_or_si128(vs, acc_lo); /*                   : acc_lo */
-    acc_md = _mm_slli_epi16(acc_md, 15); /* ... ? ^ 0x8000 : ^ 0x0000 */
-    vs = _mm_xor_si128(vs, acc_md); /* Stupid unsigned-clamp-ish adjustment. */
-    return (vs);
+    return clamp_acc_lo(acc_lo, acc_md, acc_hi);
 #else
     word_32 product[N], addend[N];
     register unsigned int i;
@@ -702,7 +704,25 @@ VECTOR_OPERATION VMADN(v16 vs, v16 vt)
 
 VECTOR_OPERATION VMADH(v16 vs, v16 vt)
 {
-#ifdef ARCH_MIN_SSE2
+#if defined(ARCH_MIN_SSE2) && defined(__ARM_NEON__)
+    int32x4_t acc_lo, acc_hi;
+    int16x8x2_t acc;
+
+/*
+ * Accumulator bits 47..16 are exactly 32 bits wide, so adding the 32-bit
+ * product to them with wrap-around (VMLAL) needs no carry detection at all.
+ */
+    acc = vzipq_s16(*(int16x8_t *)VACC_M, *(int16x8_t *)VACC_H);
+    acc_lo = vmlal_s16((int32x4_t)acc.val[0],
+        vget_low_s16((int16x8_t)vs), vget_low_s16((int16x8_t)vt));
+    acc_hi = vmlal_s16((int32x4_t)acc.val[1],
+        vget_high_s16((int16x8_t)vs), vget_high_s16((int16x8_t)vt));
+    acc = vuzpq_s16((int16x8_t)acc_lo, (int16x8_t)acc_hi);
+
+    *(v16 *)VACC_M = (v16)acc.val[0];
+    *(v16 *)VACC_H = (v16)acc.val[1];
+    return (v16)vcombine_s16(vqmovn_s32(acc_lo), vqmovn_s32(acc_hi));
+#elif defined(ARCH_MIN_SSE2)
     v16 acc_mid;
     v16 prod_high;
 
@@ -732,10 +752,7 @@ VECTOR_OPERATION VMADH(v16 vs, v16 vt)
     *(v16 *)VACC_H = vt;
 
     vs = *(v16 *)VACC_M;
-    prod_high = _mm_unpackhi_epi16(vs, vt);
-    vs        = _mm_unpacklo_epi16(vs, vt);
-    vs = _mm_packs_epi32(vs, prod_high);
-    return (vs);
+    return clamp_acc_md(vs, vt);
 #else
     word_32 product[N], addend[N];
     register unsigned int i;
@@ -15,6 +15,25 @@
 
 #include "select.h"
 
+#ifdef ARCH_MIN_SSE2
+/*
+ * The VCO, VCC and VCE flags are kept as 0 or 1 in each i16, so that the
+ * scalar build can use them as multipliers.  SIMD selects want masks.
+ */
+static INLINE v16 flag_mask(pi16 flags)
+{
+    return _mm_sub_epi16(_mm_setzero_si128(), *(v16 *)flags);
+}
+static INLINE void store_flags(pi16 flags, v16 mask)
+{
+    *(v16 *)flags = _mm_srli_epi16(mask, 15);
+    return;
+}
+static INLINE v16 mask_not(v16 mask)
+{
+    return _mm_xor_si128(mask, _mm_cmpeq_epi16(mask, mask));
+}
+#else
 /*
  * vector select merge (`VMRG`) formula
  *
@@ -321,6 +340,8 @@ INLINE static void do_cr(pi16 VD, pi16 VS, pi16 VT)
 #endif
     for (i = 0; i < N; i++)
         VC[i] ^= sn[i]; /* if (sn == ~0) {VT = ~VT;} else {VT =  VT;} */
+    for (i = 0; i < N; i++)
+        sn[i] &= 1; /* merge() multiplies by its condition:  ~0 to 1, 0 to 0 */
     merge(cmp, sn, le, ge);
     merge(VACC_L, cmp, VC, VS);
     vector_copy(VD, VACC_L);
@@ -343,27 +364,32 @@ INLINE static void do_mrg(pi16 VD, pi16 VS, pi16 VT)
     vector_copy(VD, VACC_L);
     return;
 }
+#endif
 
 VECTOR_OPERATION VLT(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
+    v16 eq, lt;
 
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
+    eq = _mm_cmpeq_epi16(vs, vt);
+    eq = _mm_and_si128(eq, _mm_and_si128(flag_mask(cf_ne), flag_mask(cf_co)));
+    lt = _mm_cmplt_epi16(vs, vt); /* less than */
+    lt = _mm_or_si128(lt, eq); /* ... or equal (uncommonly) */
+    store_flags(cf_comp, lt);
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_lt(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+    vs = _mm_select_si128(lt, vs, vt);
+    *(v16 *)VACC_L = vs;
+
+ /* CTC2    $0, $vco # zeroing RSP flags VCF[0] */
+    vector_wipe(cf_ne);
+    vector_wipe(cf_co);
+
+    vector_wipe(cf_clip);
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_lt(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -371,24 +397,24 @@ VECTOR_OPERATION VLT(v16 vs, v16 vt)
 
 VECTOR_OPERATION VEQ(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
+    v16 eq;
 
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
+    eq = _mm_cmpeq_epi16(vs, vt);
+    eq = _mm_andnot_si128(flag_mask(cf_ne), eq);
+    store_flags(cf_comp, eq);
+    *(v16 *)VACC_L = vt; /* merge(VACC_L, cf_comp, VS, VT) is redundant. */
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_eq(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
-    return (vs);
+ /* CTC2    $0, $vco # zeroing RSP flags VCF[0] */
+    vector_wipe(cf_ne);
+    vector_wipe(cf_co);
+
+    vector_wipe(cf_clip);
+    return (vt);
 #else
+    ALIGNED i16 VD[N];
+
+    do_eq(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -396,24 +422,24 @@ VECTOR_OPERATION VEQ(v16 vs, v16 vt)
 
 VECTOR_OPERATION VNE(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
+    v16 ne;
 
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
+    ne = mask_not(_mm_cmpeq_epi16(vs, vt));
+    ne = _mm_or_si128(ne, flag_mask(cf_ne));
+    store_flags(cf_comp, ne);
+    *(v16 *)VACC_L = vs; /* merge(VACC_L, cf_comp, VS, VT) is redundant. */
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_ne(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+ /* CTC2    $0, $vco # zeroing RSP flags VCF[0] */
+    vector_wipe(cf_ne);
+    vector_wipe(cf_co);
+
+    vector_wipe(cf_clip);
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_ne(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -421,24 +447,29 @@ VECTOR_OPERATION VNE(v16 vs, v16 vt)
 
 VECTOR_OPERATION VGE(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
+    v16 eq, ge;
 
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
+    eq = _mm_cmpeq_epi16(vs, vt);
+    eq = _mm_andnot_si128(
+        _mm_and_si128(flag_mask(cf_ne), flag_mask(cf_co)), eq);
+    ge = _mm_cmpgt_epi16(vs, vt); /* greater than */
+    ge = _mm_or_si128(ge, eq); /* ... or equal (commonly) */
+    store_flags(cf_comp, ge);
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_ge(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+    vs = _mm_select_si128(ge, vs, vt);
+    *(v16 *)VACC_L = vs;
+
+ /* CTC2    $0, $vco # zeroing RSP flags VCF[0] */
+    vector_wipe(cf_ne);
+    vector_wipe(cf_co);
+
+    vector_wipe(cf_clip);
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_ge(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -446,24 +477,43 @@ VECTOR_OPERATION VGE(v16 vs, v16 vt)
 
 VECTOR_OPERATION VCL(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
+    v16 eq, sn, vce;
+    v16 vc, lz, uz;
+    v16 ge, le;
 
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
+    eq = mask_not(flag_mask(cf_ne));
+    sn = flag_mask(cf_co);
+    vce = flag_mask(cf_vce);
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_cl(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+    vc = _mm_xor_si128(vt, sn);
+    vc = _mm_sub_epi16(vc, sn); /* conditional negation, if sn */
+    lz = _mm_cmpeq_epi16(vs, vc);
+    uz = _mm_cmple_epu16(vs, _mm_add_epi16(vs, vt)); /* VS + VT < 65536 */
+
+    le = _mm_select_si128(vce,
+        _mm_or_si128(lz, uz), _mm_and_si128(lz, uz));
+    le = _mm_select_si128(_mm_and_si128(eq, sn), le, flag_mask(cf_comp));
+    ge = _mm_cmple_epu16(vc, vs);
+    ge = _mm_select_si128(_mm_andnot_si128(sn, eq), ge, flag_mask(cf_clip));
+
+    vs = _mm_select_si128(_mm_select_si128(sn, le, ge), vc, vs);
+    *(v16 *)VACC_L = vs;
+
+ /* CTC2    $0, $vco # zeroing RSP flags VCF[0] */
+    vector_wipe(cf_ne);
+    vector_wipe(cf_co);
+
+    store_flags(cf_clip, ge);
+    store_flags(cf_comp, le);
+
+ /* CTC2    $0, $vce # zeroing RSP flags VCF[2] */
+    vector_wipe(cf_vce);
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_cl(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -471,24 +521,39 @@ VECTOR_OPERATION VCL(v16 vs, v16 vt)
 
 VECTOR_OPERATION VCH(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
-
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
-
-    VS = vs;
-    VT = vt;
-#endif
-    do_ch(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+    v16 eq, sn, vce, cch;
+    v16 vc, diff;
+    v16 ge, le;
+
+    cch = _mm_cmpeq_epi16(vt, _mm_set1_epi16(-32768)); /* -(-32768) < 0 */
+    sn = _mm_srai_epi16(_mm_xor_si128(vs, vt), 15);
+    vc = _mm_xor_si128(vt, sn); /* if (sn == ~0) {VT = ~VT;} else {VT =  VT;} */
+    vce = _mm_and_si128(_mm_cmpeq_epi16(vs, vc), sn);
+    vc = _mm_sub_epi16(vc, _mm_and_si128(sn, cch)); /* ~(VT) into -(VT) */
+    eq = _mm_andnot_si128(cch, _mm_cmpeq_epi16(vs, vc));
+    eq = _mm_or_si128(eq, vce);
+
+    diff = _mm_or_si128(sn, vs);
+    ge = mask_not(_mm_cmplt_epi16(diff, vt));
+    diff = _mm_sub_epi16(vc, vs);
+    diff = mask_not(_mm_srai_epi16(diff, 15));
+    le = _mm_srai_epi16(vt, 15);
+    le = _mm_select_si128(sn, diff, le);
+
+    vs = _mm_select_si128(_mm_select_si128(sn, le, ge), vc, vs);
+    *(v16 *)VACC_L = vs;
+
+    store_flags(cf_clip, ge);
+    store_flags(cf_comp, le);
+    store_flags(cf_ne, mask_not(eq));
+    store_flags(cf_co, sn);
+    store_flags(cf_vce, vce);
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_ch(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -496,24 +561,32 @@ VECTOR_OPERATION VCH(v16 vs, v16 vt)
 
 VECTOR_OPERATION VCR(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
+    v16 sn, vc;
+    v16 ge, le;
 
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
+    sn = _mm_srai_epi16(_mm_xor_si128(vs, vt), 15);
+    le = mask_not(_mm_cmpgt_epi16(vt, mask_not(_mm_and_si128(vs, sn))));
+    ge = mask_not(_mm_cmpgt_epi16(vt, _mm_or_si128(vs, sn)));
+    vc = _mm_xor_si128(vt, sn); /* if (sn == ~0) {VT = ~VT;} else {VT =  VT;} */
 
-    VS = vs;
-    VT = vt;
-#endif
-    do_cr(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+    vs = _mm_select_si128(_mm_select_si128(sn, le, ge), vc, vs);
+    *(v16 *)VACC_L = vs;
+
+ /* CTC2    $0, $vco # zeroing RSP flags VCF[0] */
+    vector_wipe(cf_ne);
+    vector_wipe(cf_co);
+
+    store_flags(cf_clip, ge);
+    store_flags(cf_comp, le);
+
+ /* CTC2    $0, $vce # zeroing RSP flags VCF[2] */
+    vector_wipe(cf_vce);
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_cr(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -521,24 +594,14 @@ VECTOR_OPERATION VCR(v16 vs, v16 vt)
 
 VECTOR_OPERATION VMRG(v16 vs, v16 vt)
 {
-    ALIGNED i16 VD[N];
 #ifdef ARCH_MIN_SSE2
-    ALIGNED i16 VS[N], VT[N];
-
-    *(v16 *)VS = vs;
-    *(v16 *)VT = vt;
-#else
-    v16 VS, VT;
-
-    VS = vs;
-    VT = vt;
-#endif
-    do_mrg(VD, VS, VT);
-#ifdef ARCH_MIN_SSE2
-    COMPILER_FENCE();
-    vs = *(v16 *)VD;
+    vs = _mm_select_si128(flag_mask(cf_comp), vs, vt);
+    *(v16 *)VACC_L = vs;
     return (vs);
 #else
+    ALIGNED i16 VD[N];
+
+    do_mrg(VD, vs, vt);
     vector_copy(V_result, VD);
     return;
 #endif
@@ -148,6 +148,35 @@ u8 get_VCE(void)
     vce = result & 0xFF;
     return (vce); /* Big endian becomes little. */
 }
+#elif defined(__ARM_NEON__)
+/*
+ * NEON has no PMOVMSKB, and SSE2NEON.h's emulation of it costs more than the
+ * whole scalar version.  Shifting each Boolean to its own bit position and
+ * summing the lanes pairwise gets the same result in a handful of ops.
+ */
+static INLINE unsigned int pack_flags(pi16 flags)
+{
+    static const int16_t lane_shifts[N] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint16x8_t bits;
+    uint64x2_t sums;
+
+    bits = vshlq_u16(vld1q_u16((const u16 *)flags), vld1q_s16(lane_shifts));
+    sums = vpaddlq_u32(vpaddlq_u16(bits));
+    return (unsigned int)(vgetq_lane_u64(sums, 0) | vgetq_lane_u64(sums, 1));
+}
+
+u16 get_VCO(void)
+{
+    return (u16)(pack_flags(cf_ne) << 8 | pack_flags(cf_co));
+}
+u16 get_VCC(void)
+{
+    return (u16)(pack_flags(cf_clip) << 8 | pack_flags(cf_comp));
+}
+u8 get_VCE(void)
+{
+    return (u8)pack_flags(cf_vce);
+}
 #else
 u16 get_VCO(void)
 {
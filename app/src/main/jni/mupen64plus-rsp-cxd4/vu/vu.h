@@ -15,7 +15,9 @@
 #ifndef _VU_H_
 #define _VU_H_
 
-#if defined(ARCH_MIN_SSE2) && !defined(SSE2NEON)
+#if defined(ARCH_MIN_AVX2) && !defined(SSE2NEON)
+#include <immintrin.h>
+#elif defined(ARCH_MIN_SSE2) && !defined(SSE2NEON)
 #include <emmintrin.h>
 #endif
 
@@ -132,6 +134,61 @@ VECTOR_EXTERN (*COP2_C2[8*7 + 8])(v16, v16);
 #define vector_cmpgt(vd, vs) { \
     *(v16 *)&(vd) = _mm_cmpgt_epi16(*(v16 *)&(vd), *(v16 *)&(vs)); }
 
+/*
+ * SSE2 has no unsigned 16-bit compares and no bit-wise select, so it needs
+ * two to four instructions for each of these.  Going through SSE2NEON.h on
+ * ARM, that emulation is emulated again; NEON does each of them natively,
+ * and so does the SSE4.1 subset of instructions every AVX2 CPU has.
+ *
+ * _mm_select_si128(mask, pass, fail):  (pass & mask) | (fail & ~mask)
+ */
+#if defined(__ARM_NEON__)
+#define _mm_cmple_epu16(dst, src) \
+    (v16)vcleq_u16((uint16x8_t)(dst), (uint16x8_t)(src))
+#define _mm_cmpgt_epu16(dst, src) \
+    (v16)vcgtq_u16((uint16x8_t)(dst), (uint16x8_t)(src))
+#define _mm_select_si128(mask, pass, fail) \
+    (v16)vbslq_u16((uint16x8_t)(mask), (uint16x8_t)(pass), (uint16x8_t)(fail))
+#elif defined(ARCH_MIN_AVX2)
+#define _mm_cmple_epu16(dst, src) \
+    _mm_cmpeq_epi16(_mm_min_epu16(dst, src), dst)
+#define _mm_cmpgt_epu16(dst, src) _mm_cmpgt_epi16( \
+    _mm_xor_si128(dst, _mm_set1_epi16(-32768)), \
+    _mm_xor_si128(src, _mm_set1_epi16(-32768)))
+#define _mm_select_si128(mask, pass, fail) \
+    _mm_blendv_epi8(fail, pass, mask)
+#else
+#define _mm_cmple_epu16(dst, src) \
+    _mm_cmpeq_epi16(_mm_subs_epu16(dst, src), _mm_setzero_si128())
+#define _mm_cmpgt_epu16(dst, src) \
+    _mm_andnot_si128(_mm_cmpeq_epi16(dst, src), _mm_cmple_epu16(src, dst))
+#define _mm_select_si128(mask, pass, fail) \
+    _mm_or_si128(_mm_and_si128(mask, pass), _mm_andnot_si128(mask, fail))
+#endif
+#define _mm_cmplt_epu16(dst, src) \
+    _mm_cmpgt_epu16(src, dst)
+
+/*
+ * the signed clamp of accumulator bits 47..16 to 16 bits that most of the
+ * multiplies end on:  each (hi << 16 | md) saturated to -32768..+32767
+ */
+static INLINE v16 clamp_acc_md(v16 md, v16 hi)
+{
+#if defined(__ARM_NEON__)
+    const int16x8x2_t acc = vzipq_s16((int16x8_t)md, (int16x8_t)hi);
+
+    return (v16)vcombine_s16(
+        vqmovn_s32((int32x4_t)acc.val[0]),
+        vqmovn_s32((int32x4_t)acc.val[1])
+    );
+#else
+    return _mm_packs_epi32(
+        _mm_unpacklo_epi16(md, hi),
+        _mm_unpackhi_epi16(md, hi)
+    );
+#endif
+}
+
 #else
 
 #define vector_copy(vd, vs) { \
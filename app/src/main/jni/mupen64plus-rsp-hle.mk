@@ -10,21 +10,29 @@ LOCAL_ARM_MODE := arm
 
 LOCAL_C_INCLUDES := $(M64P_API_INCLUDES)
 
-LOCAL_SRC_FILES :=           \
-    $(SRCDIR)/alist.c        \
-    $(SRCDIR)/alist_audio.c  \
-    $(SRCDIR)/alist_naudio.c \
-    $(SRCDIR)/alist_nead.c   \
-    $(SRCDIR)/audio.c        \
-    $(SRCDIR)/cicx105.c      \
-    $(SRCDIR)/hle.c          \
-    $(SRCDIR)/jpeg.c         \
-    $(SRCDIR)/memory.c       \
-    $(SRCDIR)/mp3.c          \
-    $(SRCDIR)/musyx.c        \
-    $(SRCDIR)/plugin.c       \
-
-LOCAL_CFLAGS := $(COMMON_CFLAGS)
+MY_LOCAL_CFLAGS := $(COMMON_CFLAGS)
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+    MY_LOCAL_CFLAGS += -mfpu=neon
+endif
+
+LOCAL_SRC_FILES :=            \
+    $(SRCDIR)/alist.c         \
+    $(SRCDIR)/alist_audio.c   \
+    $(SRCDIR)/alist_capture.c \
+    $(SRCDIR)/alist_kernels.c \
+    $(SRCDIR)/alist_naudio.c  \
+    $(SRCDIR)/alist_nead.c    \
+    $(SRCDIR)/audio.c         \
+    $(SRCDIR)/cicx105.c       \
+    $(SRCDIR)/hle.c           \
+    $(SRCDIR)/jpeg.c          \
+    $(SRCDIR)/memory.c        \
+    $(SRCDIR)/mp3.c           \
+    $(SRCDIR)/musyx.c         \
+    $(SRCDIR)/plugin.c        \
+
+LOCAL_CFLAGS := $(MY_LOCAL_CFLAGS)
 
 LOCAL_CPPFLAGS := $(COMMON_CPPFLAGS)
 
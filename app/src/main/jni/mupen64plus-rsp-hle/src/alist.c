@@ -27,12 +27,15 @@
 #include <string.h>
 
 #include "alist.h"
+#include "alist_kernels.h"
 #include "arithmetics.h"
 #include "audio.h"
 #include "hle_external.h"
 #include "hle_internal.h"
 #include "memory.h"
 
+enum { ENVMIX_CHUNK = 64, RESAMPLE_BATCH = 8 };
+
 struct ramp_t
 {
     int64_t value;
@@ -40,6 +43,21 @@ struct ramp_t
     int64_t target;
 };
 
+struct envmix_t
+{
+    const struct alist_kernels* kernels;
+    bool vectorize;
+
+    size_t n;
+    int16_t* dst[4];
+    const int16_t* in;
+
+    /* pending chunk of samples, gains are stored in DMEM order */
+    unsigned pos;
+    unsigned count;
+    int16_t gains[4][ENVMIX_CHUNK];
+};
+
 /* local functions */
 static void swap(int16_t **a, int16_t **b)
 {
@@ -48,9 +66,10 @@ static void swap(int16_t **a, int16_t **b)
     *a = tmp;
 }
 
+/* pos is in samples, which wrap around the 0x800 samples of the buffer */
 static int16_t* sample(struct hle_t* hle, unsigned pos)
 {
-    return (int16_t*)hle->alist_buffer + ((pos ^ S) & 0xfff);
+    return (int16_t*)hle->alist_buffer + ((pos ^ S) & 0x7ff);
 }
 
 static uint8_t* alist_u8(struct hle_t* hle, uint16_t dmem)
@@ -64,17 +83,94 @@ static int16_t* alist_s16(struct hle_t* hle, uint16_t dmem)
 }
 
 
+/* buffers share some samples without being the same */
+static bool partial_overlap(const int16_t* a, const int16_t* b, size_t n)
+{
+    return (a != b) && (a < b + n) && (b < a + n);
+}
+
+/* ranges of samples may share a DMEM location, taking wrap around into account */
+static bool sample_ranges_overlap(unsigned a, unsigned na, unsigned b, unsigned nb)
+{
+    unsigned a_lo = a & ~1u;
+    unsigned b_lo = b & ~1u;
+    unsigned a_span = ((a + na - 1) | 1) - a_lo;
+    unsigned b_span = ((b + nb - 1) | 1) - b_lo;
+
+    return (((b_lo - a_lo) & 0x7ff) <= a_span) || (((a_lo - b_lo) & 0x7ff) <= b_span);
+}
+
 static void sample_mix(int16_t* dst, int16_t src, int16_t gain)
 {
     *dst = clamp_s16(*dst + ((src * gain) >> 15));
 }
 
-static void alist_envmix_mix(size_t n, int16_t** dst, const int16_t* gains, int16_t src)
+static void envmix_init(struct envmix_t* mixer, struct hle_t* hle, size_t n,
+        int16_t* dl, int16_t* dr, int16_t* wl, int16_t* wr,
+        const int16_t* in, unsigned count)
+{
+    size_t i, j;
+
+    mixer->kernels = hle->alist_kernels;
+    mixer->n = n;
+    mixer->dst[0] = dl;
+    mixer->dst[1] = dr;
+    mixer->dst[2] = wl;
+    mixer->dst[3] = wr;
+    mixer->in = in;
+    mixer->pos = 0;
+    mixer->count = 0;
+
+    /* mixing a whole buffer at a time only works if no sample is read
+     * after being mixed to, and gives the same accumulation order */
+    mixer->vectorize = ((count & 1) == 0) || (S == 0);
+
+    for(i = 0; i < n; ++i) {
+        if (in < mixer->dst[i] + count && mixer->dst[i] < in + count)
+            mixer->vectorize = false;
+
+        for(j = 0; j < i; ++j) {
+            if (partial_overlap(mixer->dst[i], mixer->dst[j], count))
+                mixer->vectorize = false;
+        }
+    }
+}
+
+static void envmix_flush(struct envmix_t* mixer)
 {
     size_t i;
+    unsigned k;
 
-    for(i = 0; i < n; ++i)
-        sample_mix(dst[i], src, gains[i]);
+    if (mixer->vectorize) {
+        for(i = 0; i < mixer->n; ++i)
+            mixer->kernels->mix_gains(mixer->dst[i] + mixer->pos, mixer->in + mixer->pos,
+                                      mixer->gains[i], mixer->count);
+    }
+    else {
+        for(k = 0; k < mixer->count; ++k) {
+            unsigned ptr = k ^ S;
+            int16_t src = mixer->in[mixer->pos + ptr];
+
+            for(i = 0; i < mixer->n; ++i)
+                sample_mix(mixer->dst[i] + mixer->pos + ptr, src, mixer->gains[i][ptr]);
+        }
+    }
+
+    mixer->pos += mixer->count;
+    mixer->count = 0;
+}
+
+static void envmix_push(struct envmix_t* mixer, int16_t l_vol, int16_t r_vol, int16_t dry, int16_t wet)
+{
+    unsigned ptr = mixer->count ^ S;
+
+    mixer->gains[0][ptr] = clamp_s16((l_vol * dry + 0x4000) >> 15);
+    mixer->gains[1][ptr] = clamp_s16((r_vol * dry + 0x4000) >> 15);
+    mixer->gains[2][ptr] = clamp_s16((l_vol * wet + 0x4000) >> 15);
+    mixer->gains[3][ptr] = clamp_s16((r_vol * wet + 0x4000) >> 15);
+
+    if (++mixer->count == ENVMIX_CHUNK)
+        envmix_flush(mixer);
 }
 
 static int16_t ramp_step(struct ramp_t* ramp)
@@ -277,8 +373,8 @@ void alist_envmix_exp(
     struct ramp_t ramps[2];
     int32_t exp_seq[2];
     int32_t exp_rates[2];
+    struct envmix_t mixer;
 
-    uint32_t ptr = 0;
     int x, y;
     short save_buffer[40];
 
@@ -309,6 +405,8 @@ void alist_envmix_exp(
     ramps[0].step = ramps[0].target - ramps[0].value;
     ramps[1].step = ramps[1].target - ramps[1].value;
 
+    envmix_init(&mixer, hle, n, dl, dr, wl, wr, in, align(count, 16) >> 1);
+
     for (y = 0; y < count; y += 16) {
 
         if (ramps[0].step != 0)
@@ -324,26 +422,15 @@ void alist_envmix_exp(
         }
 
         for (x = 0; x < 8; ++x) {
-            int16_t  gains[4];
-            int16_t* buffers[4];
             int16_t l_vol = ramp_step(&ramps[0]);
             int16_t r_vol = ramp_step(&ramps[1]);
 
-            buffers[0] = dl + (ptr^S);
-            buffers[1] = dr + (ptr^S);
-            buffers[2] = wl + (ptr^S);
-            buffers[3] = wr + (ptr^S);
-
-            gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
-            gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
-            gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
-            gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
-
-            alist_envmix_mix(n, buffers, gains, in[ptr^S]);
-            ++ptr;
+            envmix_push(&mixer, l_vol, r_vol, dry, wet);
         }
     }
 
+    envmix_flush(&mixer);
+
     *(int16_t *)(save_buffer +  0) = wet;               /* 0-1 */
     *(int16_t *)(save_buffer +  2) = dry;               /* 2-3 */
     *(int32_t *)(save_buffer +  4) = (int32_t)ramps[0].target;   /* 4-5 */
@@ -380,6 +467,7 @@ void alist_envmix_ge(
     int16_t* const wr = (int16_t*)(hle->alist_buffer + dmem_wr);
 
     struct ramp_t ramps[2];
+    struct envmix_t mixer;
     short save_buffer[40];
 
     memcpy((uint8_t *)save_buffer, (hle->dram + address), 80);
@@ -404,25 +492,17 @@ void alist_envmix_ge(
     }
 
     count >>= 1;
+    envmix_init(&mixer, hle, n, dl, dr, wl, wr, in, count);
+
     for (k = 0; k < count; ++k) {
-        int16_t  gains[4];
-        int16_t* buffers[4];
         int16_t l_vol = ramp_step(&ramps[0]);
         int16_t r_vol = ramp_step(&ramps[1]);
 
-        buffers[0] = dl + (k^S);
-        buffers[1] = dr + (k^S);
-        buffers[2] = wl + (k^S);
-        buffers[3] = wr + (k^S);
-
-        gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
-        gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
-        gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
-        gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
-
-        alist_envmix_mix(n, buffers, gains, in[k^S]);
+        envmix_push(&mixer, l_vol, r_vol, dry, wet);
     }
 
+    envmix_flush(&mixer);
+
     *(int16_t *)(save_buffer +  0) = wet;               /* 0-1 */
     *(int16_t *)(save_buffer +  2) = dry;               /* 2-3 */
     *(int32_t *)(save_buffer +  4) = (int32_t)ramps[0].target;   /* 4-5 */
@@ -450,6 +530,7 @@ void alist_envmix_lin(
 {
     size_t k;
     struct ramp_t ramps[2];
+    struct envmix_t mixer;
     int16_t save_buffer[40];
 
     const int16_t * const in = (int16_t*)(hle->alist_buffer + dmemi);
@@ -479,25 +560,17 @@ void alist_envmix_lin(
     }
 
     count >>= 1;
+    envmix_init(&mixer, hle, 4, dl, dr, wl, wr, in, count);
+
     for(k = 0; k < count; ++k) {
-        int16_t  gains[4];
-        int16_t* buffers[4];
         int16_t l_vol = ramp_step(&ramps[0]);
         int16_t r_vol = ramp_step(&ramps[1]);
 
-        buffers[0] = dl + (k^S);
-        buffers[1] = dr + (k^S);
-        buffers[2] = wl + (k^S);
-        buffers[3] = wr + (k^S);
-
-        gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
-        gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
-        gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
-        gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
-
-        alist_envmix_mix(4, buffers, gains, in[k^S]);
+        envmix_push(&mixer, l_vol, r_vol, dry, wet);
     }
 
+    envmix_flush(&mixer);
+
     *(int16_t *)(save_buffer +  0) = wet;            /* 0-1 */
     *(int16_t *)(save_buffer +  2) = dry;            /* 2-3 */
     *(int16_t *)(save_buffer +  4) = (int16_t)(ramps[0].target >> 16); /* 4-5 */
@@ -534,6 +607,15 @@ void alist_envmix_nead(
     if (swap_wet_LR)
         swap(&wl, &wr);
 
+    if (!partial_overlap(in, dl, count) && !partial_overlap(in, dr, count)
+     && !partial_overlap(in, wl, count) && !partial_overlap(in, wr, count)
+     && !partial_overlap(dl, dr, count) && !partial_overlap(dl, wl, count)
+     && !partial_overlap(dl, wr, count) && !partial_overlap(dr, wl, count)
+     && !partial_overlap(dr, wr, count) && !partial_overlap(wl, wr, count)) {
+        hle->alist_kernels->envmix_nead(dl, dr, wl, wr, in, count, env_values, env_steps, xors);
+        return;
+    }
+
     while (count != 0) {
         size_t i;
         for(i = 0; i < 8; ++i) {
@@ -569,6 +651,12 @@ void alist_mix(struct hle_t* hle, uint16_t dmemo, uint16_t dmemi, uint16_t count
 
     count >>= 1;
 
+    /* in place mixing must read sources before they are mixed to */
+    if (dst <= src || dst >= src + count) {
+        hle->alist_kernels->mix(dst, src, count, gain);
+        return;
+    }
+
     while(count != 0) {
         sample_mix(dst, *src, gain);
 
@@ -582,14 +670,7 @@ void alist_multQ44(struct hle_t* hle, uint16_t dmem, uint16_t count, int8_t gain
 {
     int16_t *dst = (int16_t*)(hle->alist_buffer + dmem);
 
-    count >>= 1;
-
-    while(count != 0) {
-        *dst = clamp_s16(*dst * gain >> 4);
-
-        ++dst;
-        --count;
-    }
+    hle->alist_kernels->mult_q44(dst, count >> 1, gain);
 }
 
 void alist_add(struct hle_t* hle, uint16_t dmemo, uint16_t dmemi, uint16_t count)
@@ -599,6 +680,11 @@ void alist_add(struct hle_t* hle, uint16_t dmemo, uint16_t dmemi, uint16_t count
 
     count >>= 1;
 
+    if (dst <= src || dst >= src + count) {
+        hle->alist_kernels->add(dst, src, count);
+        return;
+    }
+
     while(count != 0) {
         *dst = clamp_s16(*dst + *src);
 
@@ -664,18 +750,56 @@ void alist_resample(
         alist_resample_load(hle, address, ipos, &pitch_accu);
 
     while (count != 0) {
-        const int16_t* lut = RESAMPLE_LUT + ((pitch_accu & 0xfc00) >> 8);
+        int16_t taps[4 * RESAMPLE_BATCH];
+        int16_t coefs[4 * RESAMPLE_BATCH];
+        int16_t out[RESAMPLE_BATCH];
+        unsigned n = (count < RESAMPLE_BATCH) ? count : RESAMPLE_BATCH;
+        uint16_t first_ipos = ipos;
+        uint16_t last_ipos = ipos;
+        uint32_t first_pitch_accu = pitch_accu;
+        unsigned k, t;
+
+        for(k = 0; k < n; ++k) {
+            const int16_t* lut = RESAMPLE_LUT + ((pitch_accu & 0xfc00) >> 8);
+
+            for(t = 0; t < 4; ++t) {
+                taps[4*k + t] = *sample(hle, ipos + t);
+                coefs[4*k + t] = lut[t];
+            }
+
+            last_ipos = ipos;
+            pitch_accu += pitch;
+            ipos += (pitch_accu >> 16);
+            pitch_accu &= 0xffff;
+        }
 
-        *sample(hle, opos++) = clamp_s16( (
-            (*sample(hle, ipos    ) * lut[0]) +
-            (*sample(hle, ipos + 1) * lut[1]) +
-            (*sample(hle, ipos + 2) * lut[2]) +
-            (*sample(hle, ipos + 3) * lut[3]) ) >> 15);
+        if (!sample_ranges_overlap(opos, n, first_ipos, (uint16_t)(last_ipos - first_ipos) + 4)) {
+            hle->alist_kernels->resample(out, taps, coefs, n);
 
-        pitch_accu += pitch;
-        ipos += (pitch_accu >> 16);
-        pitch_accu &= 0xffff;
-        --count;
+            for(k = 0; k < n; ++k)
+                *sample(hle, opos++) = out[k];
+        }
+        else {
+            /* output samples are read back by this batch */
+            ipos = first_ipos;
+            pitch_accu = first_pitch_accu;
+
+            for(k = 0; k < n; ++k) {
+                const int16_t* lut = RESAMPLE_LUT + ((pitch_accu & 0xfc00) >> 8);
+
+                *sample(hle, opos++) = clamp_s16( (
+                    (*sample(hle, ipos    ) * lut[0]) +
+                    (*sample(hle, ipos + 1) * lut[1]) +
+                    (*sample(hle, ipos + 2) * lut[2]) +
+                    (*sample(hle, ipos + 3) * lut[3]) ) >> 15);
+
+                pitch_accu += pitch;
+                ipos += (pitch_accu >> 16);
+                pitch_accu &= 0xffff;
+            }
+        }
+
+        count -= n;
     }
 
     alist_resample_save(hle, address, ipos, pitch_accu);
@@ -815,88 +939,8 @@ void alist_filter(
     }
 
     for (x = 0; x < count; x += 16) {
-        int32_t v[8];
-
-        v[1] =  in1[0] * lutt6[6];
-        v[1] += in1[3] * lutt6[7];
-        v[1] += in1[2] * lutt6[4];
-        v[1] += in1[5] * lutt6[5];
-        v[1] += in1[4] * lutt6[2];
-        v[1] += in1[7] * lutt6[3];
-        v[1] += in1[6] * lutt6[0];
-        v[1] += in2[1] * lutt6[1]; /* 1 */
-
-        v[0] =  in1[3] * lutt6[6];
-        v[0] += in1[2] * lutt6[7];
-        v[0] += in1[5] * lutt6[4];
-        v[0] += in1[4] * lutt6[5];
-        v[0] += in1[7] * lutt6[2];
-        v[0] += in1[6] * lutt6[3];
-        v[0] += in2[1] * lutt6[0];
-        v[0] += in2[0] * lutt6[1];
-
-        v[3] =  in1[2] * lutt6[6];
-        v[3] += in1[5] * lutt6[7];
-        v[3] += in1[4] * lutt6[4];
-        v[3] += in1[7] * lutt6[5];
-        v[3] += in1[6] * lutt6[2];
-        v[3] += in2[1] * lutt6[3];
-        v[3] += in2[0] * lutt6[0];
-        v[3] += in2[3] * lutt6[1];
-
-        v[2] =  in1[5] * lutt6[6];
-        v[2] += in1[4] * lutt6[7];
-        v[2] += in1[7] * lutt6[4];
-        v[2] += in1[6] * lutt6[5];
-        v[2] += in2[1] * lutt6[2];
-        v[2] += in2[0] * lutt6[3];
-        v[2] += in2[3] * lutt6[0];
-        v[2] += in2[2] * lutt6[1];
-
-        v[5] =  in1[4] * lutt6[6];
-        v[5] += in1[7] * lutt6[7];
-        v[5] += in1[6] * lutt6[4];
-        v[5] += in2[1] * lutt6[5];
-        v[5] += in2[0] * lutt6[2];
-        v[5] += in2[3] * lutt6[3];
-        v[5] += in2[2] * lutt6[0];
-        v[5] += in2[5] * lutt6[1];
-
-        v[4] =  in1[7] * lutt6[6];
-        v[4] += in1[6] * lutt6[7];
-        v[4] += in2[1] * lutt6[4];
-        v[4] += in2[0] * lutt6[5];
-        v[4] += in2[3] * lutt6[2];
-        v[4] += in2[2] * lutt6[3];
-        v[4] += in2[5] * lutt6[0];
-        v[4] += in2[4] * lutt6[1];
-
-        v[7] =  in1[6] * lutt6[6];
-        v[7] += in2[1] * lutt6[7];
-        v[7] += in2[0] * lutt6[4];
-        v[7] += in2[3] * lutt6[5];
-        v[7] += in2[2] * lutt6[2];
-        v[7] += in2[5] * lutt6[3];
-        v[7] += in2[4] * lutt6[0];
-        v[7] += in2[7] * lutt6[1];
-
-        v[6] =  in2[1] * lutt6[6];
-        v[6] += in2[0] * lutt6[7];
-        v[6] += in2[3] * lutt6[4];
-        v[6] += in2[2] * lutt6[5];
-        v[6] += in2[5] * lutt6[2];
-        v[6] += in2[4] * lutt6[3];
-        v[6] += in2[7] * lutt6[0];
-        v[6] += in2[6] * lutt6[1];
-
-        outp[1] = ((v[1] + 0x4000) >> 15);
-        outp[0] = ((v[0] + 0x4000) >> 15);
-        outp[3] = ((v[3] + 0x4000) >> 15);
-        outp[2] = ((v[2] + 0x4000) >> 15);
-        outp[5] = ((v[5] + 0x4000) >> 15);
-        outp[4] = ((v[4] + 0x4000) >> 15);
-        outp[7] = ((v[7] + 0x4000) >> 15);
-        outp[6] = ((v[6] + 0x4000) >> 15);
+        hle->alist_kernels->filter(outp, in1, in2, lutt6);
+
         in1 = in2;
         in2 += 8;
         outp += 8;
@@ -921,9 +965,9 @@ void alist_polef(
     const int16_t* const h1 = table;
           int16_t* const h2 = table + 8;
 
-    unsigned i;
+    unsigned i, k;
     int16_t l1, l2;
-    int16_t h2_before[8];
+    struct alist_polef_coefs coefs;
 
     count = align(count, 16);
 
@@ -937,25 +981,33 @@ void alist_polef(
     }
 
     for(i = 0; i < 8; ++i) {
-        h2_before[i] = h2[i];
+        coefs.h1[i] = h1[i];
+        coefs.h2[i] = h2[i];
         h2[i] = (((int32_t)h2[i] * gain) >> 14);
     }
 
+    /* rdot(i, h2, frame) as a matrix product */
+    for(i = 0; i < 8; ++i) {
+        for(k = 0; k < 8; ++k)
+            coefs.rows[i][k] = (k < i) ? h2[i - 1 - k] : 0;
+    }
+    coefs.gain = gain;
+
     do
     {
         int16_t frame[8];
+        int16_t out[8];
 
         for(i = 0; i < 8; ++i, dmemi += 2)
             frame[i] = *alist_s16(hle, dmemi);
 
-        for(i = 0; i < 8; ++i) {
-            int32_t accu = frame[i] * gain;
-            accu += h1[i]*l1 + h2_before[i]*l2 + rdot(i, h2, frame);
-            dst[i^S] = clamp_s16(accu >> 14);
-        }
+        hle->alist_kernels->polef(out, frame, &coefs, l1, l2);
+
+        for(i = 0; i < 8; ++i)
+            dst[i^S] = out[i];
 
-        l1 = dst[6^S];
-        l2 = dst[7^S];
+        l1 = out[6];
+        l2 = out[7];
 
         dst += 8;
         count -= 16;
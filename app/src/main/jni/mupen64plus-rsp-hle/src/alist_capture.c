@@ -0,0 +1,156 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-rsp-hle - alist_capture.c                                 *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alist_capture.h"
+#include "hle_external.h"
+#include "hle_internal.h"
+
+/* local variables */
+static FILE* l_file = NULL;
+static bool l_failed = false;
+
+/* RDRAM as of the last record */
+static unsigned char* l_shadow = NULL;
+
+/* local functions */
+static void put_u32(uint32_t value)
+{
+    fwrite(&value, sizeof(value), 1, l_file);
+}
+
+static bool open_capture(struct hle_t* hle)
+{
+    void* fields[ALIST_CAPTURE_STATE_FIELDS];
+    size_t sizes[ALIST_CAPTURE_STATE_FIELDS];
+    size_t i, state_size = 0;
+
+    if (l_file != NULL)
+        return true;
+
+    if (l_failed)
+        return false;
+
+    l_shadow = calloc(1, ALIST_CAPTURE_RDRAM_SIZE);
+    l_file = fopen(ALIST_CAPTURE_FILENAME, "wb");
+
+    if (l_shadow == NULL || l_file == NULL) {
+        HleErrorMessage(hle->user_defined, "Can't start audio task capture to %s", ALIST_CAPTURE_FILENAME);
+        alist_capture_close();
+        l_failed = true;
+        return false;
+    }
+
+    alist_capture_state(hle, fields, sizes);
+    for(i = 0; i < ALIST_CAPTURE_STATE_FIELDS; ++i)
+        state_size += sizes[i];
+
+    fwrite(ALIST_CAPTURE_MAGIC, 8, 1, l_file);
+    put_u32(ALIST_CAPTURE_BYTE_ORDER);
+    put_u32(ALIST_CAPTURE_RDRAM_SIZE);
+    put_u32(ALIST_CAPTURE_PAGE_SIZE);
+    put_u32((uint32_t)state_size);
+
+    HleVerboseMessage(hle->user_defined, "Capturing audio tasks to %s", ALIST_CAPTURE_FILENAME);
+    return true;
+}
+
+static void write_pages(struct hle_t* hle)
+{
+    uint32_t page, count = 0;
+    long count_pos = ftell(l_file);
+
+    put_u32(0);
+
+    for(page = 0; page < ALIST_CAPTURE_RDRAM_SIZE / ALIST_CAPTURE_PAGE_SIZE; ++page) {
+        const unsigned char* src = hle->dram + page * ALIST_CAPTURE_PAGE_SIZE;
+        unsigned char* shadow = l_shadow + page * ALIST_CAPTURE_PAGE_SIZE;
+
+        if (memcmp(src, shadow, ALIST_CAPTURE_PAGE_SIZE) == 0)
+            continue;
+
+        memcpy(shadow, src, ALIST_CAPTURE_PAGE_SIZE);
+        put_u32(page);
+        fwrite(shadow, ALIST_CAPTURE_PAGE_SIZE, 1, l_file);
+        ++count;
+    }
+
+    /* patch the page count */
+    fseek(l_file, count_pos, SEEK_SET);
+    put_u32(count);
+    fseek(l_file, 0, SEEK_END);
+}
+
+static void write_record(struct hle_t* hle)
+{
+    void* fields[ALIST_CAPTURE_STATE_FIELDS];
+    size_t sizes[ALIST_CAPTURE_STATE_FIELDS];
+    size_t i;
+
+    fwrite(hle->dmem, ALIST_CAPTURE_DMEM_SIZE, 1, l_file);
+
+    alist_capture_state(hle, fields, sizes);
+    for(i = 0; i < ALIST_CAPTURE_STATE_FIELDS; ++i)
+        fwrite(fields[i], sizes[i], 1, l_file);
+
+    write_pages(hle);
+}
+
+/* Global functions */
+void alist_capture_begin(struct hle_t* hle)
+{
+    if (!open_capture(hle))
+        return;
+
+    put_u32(ALIST_CAPTURE_TAG_INPUT);
+    write_record(hle);
+}
+
+void alist_capture_end(struct hle_t* hle, bool handled)
+{
+    if (l_file == NULL)
+        return;
+
+    put_u32(ALIST_CAPTURE_TAG_OUTPUT);
+    put_u32(handled ? 1 : 0);
+    write_record(hle);
+
+    if (ferror(l_file)) {
+        HleErrorMessage(hle->user_defined, "Error while writing %s, audio task capture stopped", ALIST_CAPTURE_FILENAME);
+        alist_capture_close();
+        l_failed = true;
+    }
+}
+
+void alist_capture_close(void)
+{
+    if (l_file != NULL) {
+        fclose(l_file);
+        l_file = NULL;
+    }
+
+    free(l_shadow);
+    l_shadow = NULL;
+}
@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-rsp-hle - alist_capture.h                                 *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ALIST_CAPTURE_H
+#define ALIST_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hle_internal.h"
+
+/* Audio task capture.
+ *
+ * When built with ENABLE_ALIST_CAPTURE, every audio task is recorded to
+ * ALIST_CAPTURE_FILENAME so it can be replayed offline by
+ * tools/alistreplay.c. The file starts with a header:
+ *
+ *   magic      : ALIST_CAPTURE_MAGIC (8 bytes)
+ *   byte_order : ALIST_CAPTURE_BYTE_ORDER
+ *   rdram_size : ALIST_CAPTURE_RDRAM_SIZE
+ *   page_size  : ALIST_CAPTURE_PAGE_SIZE
+ *   state_size : size of the persistent hle state
+ *
+ * followed by one input and one output record per task:
+ *
+ *   tag        : ALIST_CAPTURE_TAG_INPUT or ALIST_CAPTURE_TAG_OUTPUT
+ *   [handled   : output only, task was recognized by the fast dispatcher]
+ *   dmem       : 0x1000 bytes
+ *   state      : alist_buffer, alist_audio, alist_naudio, alist_nead,
+ *                mp3_buffer
+ *   page_count : number of RDRAM pages which follow
+ *   pages      : page index and page_size bytes each
+ *
+ * Input pages are the RDRAM pages modified since the previous record,
+ * output pages are the ones modified by the task itself, so RDRAM can be
+ * rebuilt from zero by applying every record in order. All values are in
+ * host byte order: a capture has to be replayed on a host of the same
+ * endianness.
+ */
+
+#define ALIST_CAPTURE_MAGIC "HLEALST2"
+#define ALIST_CAPTURE_FILENAME "alist_capture.bin"
+
+enum
+{
+    ALIST_CAPTURE_BYTE_ORDER  = 0x01020304,
+    ALIST_CAPTURE_RDRAM_SIZE  = 0x800000,
+    ALIST_CAPTURE_PAGE_SIZE   = 0x1000,
+    ALIST_CAPTURE_DMEM_SIZE   = 0x1000,
+
+    ALIST_CAPTURE_TAG_INPUT   = 1,
+    ALIST_CAPTURE_TAG_OUTPUT  = 2,
+
+    ALIST_CAPTURE_STATE_FIELDS = 5
+};
+
+/* persistent hle state carried from one audio task to the next */
+static inline void alist_capture_state(struct hle_t* hle,
+        void* fields[ALIST_CAPTURE_STATE_FIELDS], size_t sizes[ALIST_CAPTURE_STATE_FIELDS])
+{
+    fields[0] = hle->alist_buffer;  sizes[0] = sizeof(hle->alist_buffer);
+    fields[1] = &hle->alist_audio;  sizes[1] = sizeof(hle->alist_audio);
+    fields[2] = &hle->alist_naudio; sizes[2] = sizeof(hle->alist_naudio);
+    fields[3] = &hle->alist_nead;   sizes[3] = sizeof(hle->alist_nead);
+    fields[4] = hle->mp3_buffer;    sizes[4] = sizeof(hle->mp3_buffer);
+}
+
+void alist_capture_begin(struct hle_t* hle);
+void alist_capture_end(struct hle_t* hle, bool handled);
+void alist_capture_close(void);
+
+#endif
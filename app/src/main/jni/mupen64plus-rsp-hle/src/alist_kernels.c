@@ -0,0 +1,1306 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-rsp-hle - alist_kernels.c                                 *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alist_kernels.h"
+#include "arithmetics.h"
+#include "audio.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALIST_KERNELS_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ALIST_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define ALIST_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+
+/* generic implementation */
+static void mix_generic(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i)
+        dst[i] = clamp_s16(dst[i] + ((src[i] * gain) >> 15));
+}
+
+static void mix_gains_generic(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i)
+        dst[i] = clamp_s16(dst[i] + ((src[i] * gains[i]) >> 15));
+}
+
+static void mult_q44_generic(int16_t* dst, size_t n, int8_t gain)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i)
+        dst[i] = clamp_s16(dst[i] * gain >> 4);
+}
+
+static void add_generic(int16_t* dst, const int16_t* src, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i)
+        dst[i] = clamp_s16(dst[i] + src[i]);
+}
+
+static void resample_generic(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i, taps += 4, coefs += 4) {
+        dst[i] = clamp_s16( (
+            (taps[0] * coefs[0]) +
+            (taps[1] * coefs[1]) +
+            (taps[2] * coefs[2]) +
+            (taps[3] * coefs[3]) ) >> 15);
+    }
+}
+
+static void envmix_nead_generic(int16_t* dl, int16_t* dr, int16_t* wl, int16_t* wr,
+                                const int16_t* in, size_t n,
+                                uint16_t* env_values, const uint16_t* env_steps, const int16_t* xors)
+{
+    while (n != 0) {
+        size_t i;
+        for(i = 0; i < 8; ++i) {
+            int16_t l  = (((int32_t)in[i] * (uint32_t)env_values[0]) >> 16) ^ xors[0];
+            int16_t r  = (((int32_t)in[i] * (uint32_t)env_values[1]) >> 16) ^ xors[1];
+            int16_t l2 = (((int32_t)l * (uint32_t)env_values[2]) >> 16) ^ xors[2];
+            int16_t r2 = (((int32_t)r * (uint32_t)env_values[2]) >> 16) ^ xors[3];
+
+            dl[i] = clamp_s16(dl[i] + l);
+            dr[i] = clamp_s16(dr[i] + r);
+            wl[i] = clamp_s16(wl[i] + l2);
+            wr[i] = clamp_s16(wr[i] + r2);
+        }
+
+        env_values[0] += env_steps[0];
+        env_values[1] += env_steps[1];
+        env_values[2] += env_steps[2];
+
+        dl += 8;
+        dr += 8;
+        wl += 8;
+        wr += 8;
+        in += 8;
+        n -= 8;
+    }
+}
+
+static void polef_generic(int16_t* dst, const int16_t* frame, const struct alist_polef_coefs* coefs,
+                          int16_t l1, int16_t l2)
+{
+    size_t i, k;
+
+    for(i = 0; i < 8; ++i) {
+        int32_t accu = frame[i] * coefs->gain;
+        accu += coefs->h1[i]*l1 + coefs->h2[i]*l2;
+        for(k = 0; k < i; ++k)
+            accu += coefs->rows[i][k] * frame[k];
+        dst[i] = clamp_s16(accu >> 14);
+    }
+}
+
+static void filter_generic(int16_t* dst, const int16_t* in1, const int16_t* in2, const int16_t* lut)
+{
+    int32_t v[8];
+
+    v[1] =  in1[0] * lut[6];
+    v[1] += in1[3] * lut[7];
+    v[1] += in1[2] * lut[4];
+    v[1] += in1[5] * lut[5];
+    v[1] += in1[4] * lut[2];
+    v[1] += in1[7] * lut[3];
+    v[1] += in1[6] * lut[0];
+    v[1] += in2[1] * lut[1]; /* 1 */
+
+    v[0] =  in1[3] * lut[6];
+    v[0] += in1[2] * lut[7];
+    v[0] += in1[5] * lut[4];
+    v[0] += in1[4] * lut[5];
+    v[0] += in1[7] * lut[2];
+    v[0] += in1[6] * lut[3];
+    v[0] += in2[1] * lut[0];
+    v[0] += in2[0] * lut[1];
+
+    v[3] =  in1[2] * lut[6];
+    v[3] += in1[5] * lut[7];
+    v[3] += in1[4] * lut[4];
+    v[3] += in1[7] * lut[5];
+    v[3] += in1[6] * lut[2];
+    v[3] += in2[1] * lut[3];
+    v[3] += in2[0] * lut[0];
+    v[3] += in2[3] * lut[1];
+
+    v[2] =  in1[5] * lut[6];
+    v[2] += in1[4] * lut[7];
+    v[2] += in1[7] * lut[4];
+    v[2] += in1[6] * lut[5];
+    v[2] += in2[1] * lut[2];
+    v[2] += in2[0] * lut[3];
+    v[2] += in2[3] * lut[0];
+    v[2] += in2[2] * lut[1];
+
+    v[5] =  in1[4] * lut[6];
+    v[5] += in1[7] * lut[7];
+    v[5] += in1[6] * lut[4];
+    v[5] += in2[1] * lut[5];
+    v[5] += in2[0] * lut[2];
+    v[5] += in2[3] * lut[3];
+    v[5] += in2[2] * lut[0];
+    v[5] += in2[5] * lut[1];
+
+    v[4] =  in1[7] * lut[6];
+    v[4] += in1[6] * lut[7];
+    v[4] += in2[1] * lut[4];
+    v[4] += in2[0] * lut[5];
+    v[4] += in2[3] * lut[2];
+    v[4] += in2[2] * lut[3];
+    v[4] += in2[5] * lut[0];
+    v[4] += in2[4] * lut[1];
+
+    v[7] =  in1[6] * lut[6];
+    v[7] += in2[1] * lut[7];
+    v[7] += in2[0] * lut[4];
+    v[7] += in2[3] * lut[5];
+    v[7] += in2[2] * lut[2];
+    v[7] += in2[5] * lut[3];
+    v[7] += in2[4] * lut[0];
+    v[7] += in2[7] * lut[1];
+
+    v[6] =  in2[1] * lut[6];
+    v[6] += in2[0] * lut[7];
+    v[6] += in2[3] * lut[4];
+    v[6] += in2[2] * lut[5];
+    v[6] += in2[5] * lut[2];
+    v[6] += in2[4] * lut[3];
+    v[6] += in2[7] * lut[0];
+    v[6] += in2[6] * lut[1];
+
+    dst[1] = ((v[1] + 0x4000) >> 15);
+    dst[0] = ((v[0] + 0x4000) >> 15);
+    dst[3] = ((v[3] + 0x4000) >> 15);
+    dst[2] = ((v[2] + 0x4000) >> 15);
+    dst[5] = ((v[5] + 0x4000) >> 15);
+    dst[4] = ((v[4] + 0x4000) >> 15);
+    dst[7] = ((v[7] + 0x4000) >> 15);
+    dst[6] = ((v[6] + 0x4000) >> 15);
+}
+
+static void mix_round_generic(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i)
+        dst[i] = clamp_s16(dst[i] + ((src[i] * gain + 0x4000) >> 15));
+}
+
+static void mix_ramp_generic(int16_t* dst, const int16_t* src, size_t n, int32_t env, int32_t step)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i) {
+        dst[i] = clamp_s16(dst[i] + ((src[i] * (env >> 16)) >> 15));
+        env = (int32_t)((uint32_t)env + (uint32_t)step);
+    }
+}
+
+static void scale_u16_generic(int16_t* dst, const int16_t* src, size_t n, uint16_t gain)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i)
+        dst[i] = (int32_t)(src[i] * gain) >> 16;
+}
+
+static void fir4_generic(int16_t* dst, const int16_t* src, size_t n, int16_t hgain, const int16_t* hcoeffs)
+{
+    size_t i;
+    int32_t h[4];
+
+    h[0] = (hgain * hcoeffs[0]) >> 15;
+    h[1] = (hgain * hcoeffs[1]) >> 15;
+    h[2] = (hgain * hcoeffs[2]) >> 15;
+    h[3] = (hgain * hcoeffs[3]) >> 15;
+
+    for (i = 0; i < n; ++i) {
+        int32_t v = (h[0] * src[i] + h[1] * src[i + 1] + h[2] * src[i + 2] + h[3] * src[i + 3]) >> 15;
+        dst[i] = clamp_s16(dst[i] + v);
+    }
+}
+
+static void resample_sat_generic(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n)
+{
+    size_t i, k;
+
+    for(i = 0; i < n; ++i) {
+        int32_t accu = 0;
+
+        for(k = 0; k < 4; ++k)
+            accu = clamp_s16(accu + ((taps[k*n + i] * coefs[k*n + i]) >> 15));
+
+        dst[i] = accu;
+    }
+}
+
+static void adpcm_predict_generic(int16_t* dst, const uint8_t* nibbles, size_t n, unsigned int rshift)
+{
+    size_t i;
+
+    for(i = 0; i < n; ++i) {
+        *(dst++) = adpcm_predict_sample(nibbles[i], 0xf0,  8, rshift);
+        *(dst++) = adpcm_predict_sample(nibbles[i], 0x0f, 12, rshift);
+    }
+}
+
+static void adpcm_residuals_generic(int16_t* dst, const int16_t* src, const int16_t* book,
+                                    const int16_t* last, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i < n; i += 8) {
+        adpcm_compute_residuals(dst + i, src + i, book, last, 8);
+        last = dst + i + 6;
+    }
+}
+
+static void dewindow_generic(int32_t* dst, const int16_t* x0, const int16_t* x1, ptrdiff_t xstep,
+                             const int16_t* w, int alternate)
+{
+    size_t r, i;
+
+    for(r = 0; r < 8; ++r) {
+        int32_t s0 = 0;
+        int32_t s1 = 0;
+
+        for(i = 0; i < 16; ++i) {
+            int32_t p0 = (x0[i] * w[i] + 0x4000) >> 15;
+            int32_t p1 = (x1[i] * w[32 + i] + 0x4000) >> 15;
+
+            if (alternate && (i & 1)) {
+                s0 -= p0;
+                s1 -= p1;
+            } else {
+                s0 += p0;
+                s1 += p1;
+            }
+        }
+
+        dst[2 * r] = s0;
+        dst[2 * r + 1] = s1;
+
+        x0 += xstep;
+        x1 += xstep;
+        w += 64;
+    }
+}
+
+const struct alist_kernels alist_kernels_generic =
+{
+    "generic",
+    mix_generic,
+    mix_gains_generic,
+    mult_q44_generic,
+    add_generic,
+    resample_generic,
+    envmix_nead_generic,
+    polef_generic,
+    filter_generic,
+    mix_round_generic,
+    mix_ramp_generic,
+    scale_u16_generic,
+    fir4_generic,
+    resample_sat_generic,
+    adpcm_predict_generic,
+    adpcm_residuals_generic,
+    dewindow_generic
+};
+
+
+/* The filter computes out[p^1] = sum(x[p+1+k] * c[7-k]) with x and c the
+ * input and lut with their 16bit pairs swapped. */
+
+#if defined(ALIST_KERNELS_SSE2)
+/* bits 16..31 of the product of signed a and unsigned b */
+static inline __m128i mulhi_su16_sse2(__m128i a, uint16_t b)
+{
+    __m128i hi = _mm_mulhi_epi16(a, _mm_set1_epi16((int16_t)b));
+    return (b & 0x8000) ? _mm_add_epi16(hi, a) : hi;
+}
+
+/* {sum(a), sum(b), sum(c), sum(d)} */
+static inline __m128i hsum4_sse2(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    __m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+    __m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+    return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+static inline __m128i swap_pairs_sse2(__m128i x)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1);
+}
+
+/* (x * g) >> shift added to d, with saturation */
+static inline __m128i mix8_sse2(__m128i d, __m128i x, __m128i g)
+{
+    __m128i lo = _mm_mullo_epi16(x, g);
+    __m128i hi = _mm_mulhi_epi16(x, g);
+    __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+    __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+    __m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16);
+    __m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16);
+
+    return _mm_packs_epi32(_mm_add_epi32(d0, p0), _mm_add_epi32(d1, p1));
+}
+
+static void mix_sse2(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    const __m128i g = _mm_set1_epi16(gain);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), mix8_sse2(d, x, g));
+    }
+
+    mix_generic(dst + i, src + i, n - i, gain);
+}
+
+static void mix_gains_sse2(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i g = _mm_loadu_si128((const __m128i*)(gains + i));
+        _mm_storeu_si128((__m128i*)(dst + i), mix8_sse2(d, x, g));
+    }
+
+    mix_gains_generic(dst + i, src + i, gains + i, n - i);
+}
+
+static void mult_q44_sse2(int16_t* dst, size_t n, int8_t gain)
+{
+    const __m128i g = _mm_set1_epi16(gain);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_mullo_epi16(d, g);
+        __m128i hi = _mm_mulhi_epi16(d, g);
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 4);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 4);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(p0, p1));
+    }
+
+    mult_q44_generic(dst + i, n - i, gain);
+}
+
+static void add_sse2(int16_t* dst, const int16_t* src, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epi16(d, x));
+    }
+
+    add_generic(dst + i, src + i, n - i);
+}
+
+static void resample_sse2(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 4 <= n; i += 4, taps += 16, coefs += 16) {
+        __m128i v0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(taps + 0)),
+                                    _mm_loadu_si128((const __m128i*)(coefs + 0)));
+        __m128i v1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(taps + 8)),
+                                    _mm_loadu_si128((const __m128i*)(coefs + 8)));
+        __m128 f0 = _mm_castsi128_ps(v0);
+        __m128 f1 = _mm_castsi128_ps(v1);
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(f0, f1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd  = _mm_castps_si128(_mm_shuffle_ps(f0, f1, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i v = _mm_srai_epi32(_mm_add_epi32(even, odd), 15);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packs_epi32(v, v));
+    }
+
+    resample_generic(dst + i, taps, coefs, n - i);
+}
+
+static void envmix_nead_sse2(int16_t* dl, int16_t* dr, int16_t* wl, int16_t* wr,
+                             const int16_t* in, size_t n,
+                             uint16_t* env_values, const uint16_t* env_steps, const int16_t* xors)
+{
+    const __m128i x0 = _mm_set1_epi16(xors[0]);
+    const __m128i x1 = _mm_set1_epi16(xors[1]);
+    const __m128i x2 = _mm_set1_epi16(xors[2]);
+    const __m128i x3 = _mm_set1_epi16(xors[3]);
+    size_t i;
+
+    for(i = 0; i < n; i += 8) {
+        __m128i x  = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i l  = _mm_xor_si128(mulhi_su16_sse2(x, env_values[0]), x0);
+        __m128i r  = _mm_xor_si128(mulhi_su16_sse2(x, env_values[1]), x1);
+        __m128i l2 = _mm_xor_si128(mulhi_su16_sse2(l, env_values[2]), x2);
+        __m128i r2 = _mm_xor_si128(mulhi_su16_sse2(r, env_values[2]), x3);
+
+        _mm_storeu_si128((__m128i*)(dl + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(dl + i)), l));
+        _mm_storeu_si128((__m128i*)(dr + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(dr + i)), r));
+        _mm_storeu_si128((__m128i*)(wl + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(wl + i)), l2));
+        _mm_storeu_si128((__m128i*)(wr + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(wr + i)), r2));
+
+        env_values[0] += env_steps[0];
+        env_values[1] += env_steps[1];
+        env_values[2] += env_steps[2];
+    }
+}
+
+static void polef_sse2(int16_t* dst, const int16_t* frame, const struct alist_polef_coefs* coefs,
+                       int16_t l1, int16_t l2)
+{
+    const __m128i x = _mm_loadu_si128((const __m128i*)frame);
+    const __m128i h1 = _mm_loadu_si128((const __m128i*)coefs->h1);
+    const __m128i h2 = _mm_loadu_si128((const __m128i*)coefs->h2);
+    const __m128i l = _mm_set1_epi32((uint16_t)l1 | ((uint32_t)(uint16_t)l2 << 16));
+    __m128i glo = _mm_mullo_epi16(x, _mm_set1_epi16((int16_t)coefs->gain));
+    __m128i ghi = mulhi_su16_sse2(x, coefs->gain);
+    __m128i v[8];
+    __m128i a0, a1;
+    unsigned int i;
+
+    for(i = 0; i < 8; ++i)
+        v[i] = _mm_madd_epi16(x, _mm_loadu_si128((const __m128i*)coefs->rows[i]));
+
+    a0 = _mm_add_epi32(hsum4_sse2(v[0], v[1], v[2], v[3]), _mm_unpacklo_epi16(glo, ghi));
+    a1 = _mm_add_epi32(hsum4_sse2(v[4], v[5], v[6], v[7]), _mm_unpackhi_epi16(glo, ghi));
+    a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi16(h1, h2), l));
+    a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi16(h1, h2), l));
+
+    _mm_storeu_si128((__m128i*)dst, _mm_packs_epi32(_mm_srai_epi32(a0, 14), _mm_srai_epi32(a1, 14)));
+}
+
+#define FILTER_TAP_SSE2(s) \
+    _mm_madd_epi16(_mm_or_si128(_mm_srli_si128(xlo, 2*(s)), _mm_slli_si128(xhi, 16-2*(s))), c)
+
+static void filter_sse2(int16_t* dst, const int16_t* in1, const int16_t* in2, const int16_t* lut)
+{
+    const __m128i xlo = swap_pairs_sse2(_mm_loadu_si128((const __m128i*)in1));
+    const __m128i xhi = swap_pairs_sse2(_mm_loadu_si128((const __m128i*)in2));
+    /* lut with pairs swapped then reversed */
+    const __m128i c = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)lut), _MM_SHUFFLE(0, 1, 2, 3));
+    const __m128i round = _mm_set1_epi32(0x4000);
+    __m128i a0, a1;
+
+    a0 = hsum4_sse2(FILTER_TAP_SSE2(1), FILTER_TAP_SSE2(2), FILTER_TAP_SSE2(3), FILTER_TAP_SSE2(4));
+    a1 = hsum4_sse2(FILTER_TAP_SSE2(5), FILTER_TAP_SSE2(6), FILTER_TAP_SSE2(7), _mm_madd_epi16(xhi, c));
+
+    /* truncate to 16 bits */
+    a0 = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(_mm_add_epi32(a0, round), 15), 16), 16);
+    a1 = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(_mm_add_epi32(a1, round), 15), 16), 16);
+
+    _mm_storeu_si128((__m128i*)dst, swap_pairs_sse2(_mm_packs_epi32(a0, a1)));
+}
+
+#undef FILTER_TAP_SSE2
+
+static void mix_round_sse2(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    const __m128i g = _mm_set1_epi16(gain);
+    const __m128i round = _mm_set1_epi32(0x4000);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_mullo_epi16(x, g);
+        __m128i hi = _mm_mulhi_epi16(x, g);
+        __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15);
+        __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15);
+        __m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16);
+        __m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16);
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(_mm_add_epi32(d0, p0), _mm_add_epi32(d1, p1)));
+    }
+
+    mix_round_generic(dst + i, src + i, n - i, gain);
+}
+
+static void mix_ramp_sse2(int16_t* dst, const int16_t* src, size_t n, int32_t env, int32_t step)
+{
+    const __m128i step8 = _mm_set1_epi32((int32_t)((uint32_t)step * 8));
+    __m128i e0, e1;
+    size_t i;
+
+    /* env + {0..7} * step, wrapping like the scalar code */
+    e0 = _mm_set_epi32((int32_t)((uint32_t)env + 3u * (uint32_t)step),
+                       (int32_t)((uint32_t)env + 2u * (uint32_t)step),
+                       (int32_t)((uint32_t)env + (uint32_t)step),
+                       env);
+    e1 = _mm_add_epi32(e0, _mm_set1_epi32((int32_t)((uint32_t)step * 4)));
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i g = _mm_packs_epi32(_mm_srai_epi32(e0, 16), _mm_srai_epi32(e1, 16));
+
+        _mm_storeu_si128((__m128i*)(dst + i), mix8_sse2(d, x, g));
+
+        e0 = _mm_add_epi32(e0, step8);
+        e1 = _mm_add_epi32(e1, step8);
+    }
+
+    mix_ramp_generic(dst + i, src + i, n - i, _mm_cvtsi128_si32(e0), step);
+}
+
+static void scale_u16_sse2(int16_t* dst, const int16_t* src, size_t n, uint16_t gain)
+{
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+        _mm_storeu_si128((__m128i*)(dst + i), mulhi_su16_sse2(_mm_loadu_si128((const __m128i*)(src + i)), gain));
+
+    scale_u16_generic(dst + i, src + i, n - i, gain);
+}
+
+static void fir4_sse2(int16_t* dst, const int16_t* src, size_t n, int16_t hgain, const int16_t* hcoeffs)
+{
+    int32_t h[4];
+    __m128i h01, h23;
+    size_t i;
+
+    h[0] = (hgain * hcoeffs[0]) >> 15;
+    h[1] = (hgain * hcoeffs[1]) >> 15;
+    h[2] = (hgain * hcoeffs[2]) >> 15;
+    h[3] = (hgain * hcoeffs[3]) >> 15;
+
+    /* only -32768 * -32768 doesn't fit */
+    if (h[0] > 0x7fff || h[1] > 0x7fff || h[2] > 0x7fff || h[3] > 0x7fff) {
+        fir4_generic(dst, src, n, hgain, hcoeffs);
+        return;
+    }
+
+    h01 = _mm_set1_epi32((uint16_t)h[0] | ((uint32_t)(uint16_t)h[1] << 16));
+    h23 = _mm_set1_epi32((uint16_t)h[2] | ((uint32_t)(uint16_t)h[3] << 16));
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i x0 = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i x1 = _mm_loadu_si128((const __m128i*)(src + i + 1));
+        __m128i x2 = _mm_loadu_si128((const __m128i*)(src + i + 2));
+        __m128i x3 = _mm_loadu_si128((const __m128i*)(src + i + 3));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i v0 = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), h01),
+                                   _mm_madd_epi16(_mm_unpacklo_epi16(x2, x3), h23));
+        __m128i v1 = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), h01),
+                                   _mm_madd_epi16(_mm_unpackhi_epi16(x2, x3), h23));
+        __m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16);
+        __m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16);
+
+        _mm_storeu_si128((__m128i*)(dst + i),
+                         _mm_packs_epi32(_mm_add_epi32(d0, _mm_srai_epi32(v0, 15)),
+                                         _mm_add_epi32(d1, _mm_srai_epi32(v1, 15))));
+    }
+
+    fir4_generic(dst + i, src + i, n - i, hgain, hcoeffs);
+}
+
+static void resample_sat_sse2(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n)
+{
+    size_t i, k;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        __m128i accu = _mm_setzero_si128();
+
+        for(k = 0; k < 4; ++k)
+            accu = mix8_sse2(accu, _mm_loadu_si128((const __m128i*)(taps + k*n + i)),
+                                   _mm_loadu_si128((const __m128i*)(coefs + k*n + i)));
+
+        _mm_storeu_si128((__m128i*)(dst + i), accu);
+    }
+
+    for(; i < n; ++i) {
+        int32_t accu = 0;
+
+        for(k = 0; k < 4; ++k)
+            accu = clamp_s16(accu + ((taps[k*n + i] * coefs[k*n + i]) >> 15));
+
+        dst[i] = accu;
+    }
+}
+
+static void adpcm_predict_sse2(int16_t* dst, const uint8_t* nibbles, size_t n, unsigned int rshift)
+{
+    const __m128i mask = _mm_set1_epi16((int16_t)0xf000);
+    const __m128i shift = _mm_cvtsi32_si128(rshift);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        /* bytes in the high half of each lane */
+        __m128i x = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_loadl_epi64((const __m128i*)(nibbles + i)));
+        __m128i hi = _mm_sra_epi16(_mm_and_si128(x, mask), shift);
+        __m128i lo = _mm_sra_epi16(_mm_slli_epi16(x, 4), shift);
+
+        _mm_storeu_si128((__m128i*)(dst + 2*i), _mm_unpacklo_epi16(hi, lo));
+        _mm_storeu_si128((__m128i*)(dst + 2*i + 8), _mm_unpackhi_epi16(hi, lo));
+    }
+
+    adpcm_predict_generic(dst + 2*i, nibbles + i, n - i, rshift);
+}
+
+static void adpcm_residuals_sse2(int16_t* dst, const int16_t* src, const int16_t* book,
+                                 const int16_t* last, size_t n)
+{
+    const __m128i book1 = _mm_loadu_si128((const __m128i*)book);
+    const __m128i book2 = _mm_loadu_si128((const __m128i*)(book + 8));
+    /* column k of the book2 matrix, applied to sample k of the group */
+    const __m128i c0 = _mm_slli_si128(book2, 2);
+    const __m128i c1 = _mm_slli_si128(book2, 4);
+    const __m128i c2 = _mm_slli_si128(book2, 6);
+    const __m128i c3 = _mm_slli_si128(book2, 8);
+    const __m128i c4 = _mm_slli_si128(book2, 10);
+    const __m128i c5 = _mm_slli_si128(book2, 12);
+    const __m128i c6 = _mm_slli_si128(book2, 14);
+    const __m128i p0lo = _mm_unpacklo_epi16(c0, c1), p0hi = _mm_unpackhi_epi16(c0, c1);
+    const __m128i p1lo = _mm_unpacklo_epi16(c2, c3), p1hi = _mm_unpackhi_epi16(c2, c3);
+    const __m128i p2lo = _mm_unpacklo_epi16(c4, c5), p2hi = _mm_unpackhi_epi16(c4, c5);
+    const __m128i p3lo = _mm_unpacklo_epi16(c6, _mm_setzero_si128());
+    const __m128i p3hi = _mm_unpackhi_epi16(c6, _mm_setzero_si128());
+    const __m128i blo = _mm_unpacklo_epi16(book1, book2);
+    const __m128i bhi = _mm_unpackhi_epi16(book1, book2);
+    uint32_t l = (uint16_t)last[0] | ((uint32_t)(uint16_t)last[1] << 16);
+    size_t i;
+
+    for(i = 0; i < n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i l12 = _mm_set1_epi32((int32_t)l);
+        __m128i s, a0, a1;
+
+        a0 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16), 11);
+        a1 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16), 11);
+        a0 = _mm_add_epi32(a0, _mm_madd_epi16(blo, l12));
+        a1 = _mm_add_epi32(a1, _mm_madd_epi16(bhi, l12));
+
+        /* samples 2k and 2k+1 */
+        s = _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 0, 0, 0));
+        a0 = _mm_add_epi32(a0, _mm_madd_epi16(p0lo, s));
+        a1 = _mm_add_epi32(a1, _mm_madd_epi16(p0hi, s));
+        s = _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 1, 1, 1));
+        a0 = _mm_add_epi32(a0, _mm_madd_epi16(p1lo, s));
+        a1 = _mm_add_epi32(a1, _mm_madd_epi16(p1hi, s));
+        s = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 2, 2, 2));
+        a0 = _mm_add_epi32(a0, _mm_madd_epi16(p2lo, s));
+        a1 = _mm_add_epi32(a1, _mm_madd_epi16(p2hi, s));
+        s = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        a0 = _mm_add_epi32(a0, _mm_madd_epi16(p3lo, s));
+        a1 = _mm_add_epi32(a1, _mm_madd_epi16(p3hi, s));
+
+        s = _mm_packs_epi32(_mm_srai_epi32(a0, 11), _mm_srai_epi32(a1, 11));
+        _mm_storeu_si128((__m128i*)(dst + i), s);
+
+        l = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(s, 12));
+    }
+}
+
+/* sum of the 8 products (x * w + 0x4000) >> 15, negated where sign is set, in 4 lanes */
+static inline __m128i dot8_round_sse2(__m128i x, __m128i w, __m128i sign)
+{
+    const __m128i round = _mm_set1_epi32(0x4000);
+    __m128i lo = _mm_mullo_epi16(x, w);
+    __m128i hi = _mm_mulhi_epi16(x, w);
+    __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15);
+    __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15);
+
+    p0 = _mm_sub_epi32(_mm_xor_si128(p0, sign), sign);
+    p1 = _mm_sub_epi32(_mm_xor_si128(p1, sign), sign);
+
+    return _mm_add_epi32(p0, p1);
+}
+
+static inline __m128i dot16_round_sse2(const int16_t* x, const int16_t* w, __m128i sign)
+{
+    return _mm_add_epi32(
+            dot8_round_sse2(_mm_loadu_si128((const __m128i*)x),
+                            _mm_loadu_si128((const __m128i*)w), sign),
+            dot8_round_sse2(_mm_loadu_si128((const __m128i*)(x + 8)),
+                            _mm_loadu_si128((const __m128i*)(w + 8)), sign));
+}
+
+static void dewindow_sse2(int32_t* dst, const int16_t* x0, const int16_t* x1, ptrdiff_t xstep,
+                          const int16_t* w, int alternate)
+{
+    const __m128i sign = alternate ? _mm_set_epi32(-1, 0, -1, 0) : _mm_setzero_si128();
+    size_t r;
+
+    for(r = 0; r < 8; r += 2) {
+        __m128i a = dot16_round_sse2(x0, w, sign);
+        __m128i b = dot16_round_sse2(x1, w + 32, sign);
+        __m128i c = dot16_round_sse2(x0 + xstep, w + 64, sign);
+        __m128i d = dot16_round_sse2(x1 + xstep, w + 96, sign);
+
+        _mm_storeu_si128((__m128i*)(dst + 2 * r), hsum4_sse2(a, b, c, d));
+
+        x0 += 2 * xstep;
+        x1 += 2 * xstep;
+        w += 128;
+    }
+}
+
+static const struct alist_kernels alist_kernels_sse2 =
+{
+    "SSE2",
+    mix_sse2,
+    mix_gains_sse2,
+    mult_q44_sse2,
+    add_sse2,
+    resample_sse2,
+    envmix_nead_sse2,
+    polef_sse2,
+    filter_sse2,
+    mix_round_sse2,
+    mix_ramp_sse2,
+    scale_u16_sse2,
+    fir4_sse2,
+    resample_sat_sse2,
+    adpcm_predict_sse2,
+    adpcm_residuals_sse2,
+    dewindow_sse2
+};
+#endif
+
+
+#if defined(ALIST_KERNELS_AVX2)
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static inline __m256i mix16_avx2(__m256i d, __m256i x, __m256i g)
+{
+    __m256i lo = _mm256_mullo_epi16(x, g);
+    __m256i hi = _mm256_mulhi_epi16(x, g);
+    __m256i p0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 15);
+    __m256i p1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 15);
+    __m256i d0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(d, d), 16);
+    __m256i d1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(d, d), 16);
+
+    return _mm256_packs_epi32(_mm256_add_epi32(d0, p0), _mm256_add_epi32(d1, p1));
+}
+
+AVX2_TARGET static void mix_avx2(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    const __m256i g = _mm256_set1_epi16(gain);
+    size_t i;
+
+    for(i = 0; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), mix16_avx2(d, x, g));
+    }
+
+    mix_sse2(dst + i, src + i, n - i, gain);
+}
+
+AVX2_TARGET static void mix_gains_avx2(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i g = _mm256_loadu_si256((const __m256i*)(gains + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), mix16_avx2(d, x, g));
+    }
+
+    mix_gains_sse2(dst + i, src + i, gains + i, n - i);
+}
+
+AVX2_TARGET static void mult_q44_avx2(int16_t* dst, size_t n, int8_t gain)
+{
+    const __m256i g = _mm256_set1_epi16(gain);
+    size_t i;
+
+    for(i = 0; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = _mm256_mullo_epi16(d, g);
+        __m256i hi = _mm256_mulhi_epi16(d, g);
+        __m256i p0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 4);
+        __m256i p1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 4);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packs_epi32(p0, p1));
+    }
+
+    mult_q44_sse2(dst + i, n - i, gain);
+}
+
+AVX2_TARGET static void add_avx2(int16_t* dst, const int16_t* src, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epi16(d, x));
+    }
+
+    add_sse2(dst + i, src + i, n - i);
+}
+
+#undef AVX2_TARGET
+
+/* only the streaming kernels gain from wider vectors */
+static const struct alist_kernels alist_kernels_avx2 =
+{
+    "AVX2",
+    mix_avx2,
+    mix_gains_avx2,
+    mult_q44_avx2,
+    add_avx2,
+    resample_sse2,
+    envmix_nead_sse2,
+    polef_sse2,
+    filter_sse2,
+    mix_round_sse2,
+    mix_ramp_sse2,
+    scale_u16_sse2,
+    fir4_sse2,
+    resample_sat_sse2,
+    adpcm_predict_sse2,
+    adpcm_residuals_sse2,
+    dewindow_sse2
+};
+#endif
+
+
+#if defined(ALIST_KERNELS_NEON)
+/* {sum(a), sum(b), sum(c), sum(d)} */
+static inline int32x4_t hsum4_neon(int32x4_t a, int32x4_t b, int32x4_t c, int32x4_t d)
+{
+    int32x2_t ab = vpadd_s32(vadd_s32(vget_low_s32(a), vget_high_s32(a)),
+                             vadd_s32(vget_low_s32(b), vget_high_s32(b)));
+    int32x2_t cd = vpadd_s32(vadd_s32(vget_low_s32(c), vget_high_s32(c)),
+                             vadd_s32(vget_low_s32(d), vget_high_s32(d)));
+    return vcombine_s32(ab, cd);
+}
+
+static inline int32x4_t dot8_neon(int16x8_t x, int16x8_t y)
+{
+    return vmlal_s16(vmull_s16(vget_low_s16(x), vget_low_s16(y)), vget_high_s16(x), vget_high_s16(y));
+}
+
+/* bits 16..31 of the product of signed a and unsigned b */
+static inline int16x8_t mulhi_su16_neon(int16x8_t a, uint16_t b)
+{
+    const int32x4_t g = vdupq_n_s32(b);
+    return vcombine_s16(vshrn_n_s32(vmulq_s32(vmovl_s16(vget_low_s16(a)), g), 16),
+                        vshrn_n_s32(vmulq_s32(vmovl_s16(vget_high_s16(a)), g), 16));
+}
+
+static inline int16x8_t mix8_neon(int16x8_t d, int16x8_t x, int16x8_t g)
+{
+    int32x4_t p0 = vshrq_n_s32(vmull_s16(vget_low_s16(x), vget_low_s16(g)), 15);
+    int32x4_t p1 = vshrq_n_s32(vmull_s16(vget_high_s16(x), vget_high_s16(g)), 15);
+
+    return vcombine_s16(vqmovn_s32(vaddw_s16(p0, vget_low_s16(d))),
+                        vqmovn_s32(vaddw_s16(p1, vget_high_s16(d))));
+}
+
+static void mix_neon(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    const int16x8_t g = vdupq_n_s16(gain);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+        vst1q_s16(dst + i, mix8_neon(vld1q_s16(dst + i), vld1q_s16(src + i), g));
+
+    mix_generic(dst + i, src + i, n - i, gain);
+}
+
+static void mix_gains_neon(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+        vst1q_s16(dst + i, mix8_neon(vld1q_s16(dst + i), vld1q_s16(src + i), vld1q_s16(gains + i)));
+
+    mix_gains_generic(dst + i, src + i, gains + i, n - i);
+}
+
+static void mult_q44_neon(int16_t* dst, size_t n, int8_t gain)
+{
+    const int16x4_t g = vdup_n_s16(gain);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        int16x8_t d = vld1q_s16(dst + i);
+        int32x4_t p0 = vshrq_n_s32(vmull_s16(vget_low_s16(d), g), 4);
+        int32x4_t p1 = vshrq_n_s32(vmull_s16(vget_high_s16(d), g), 4);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+
+    mult_q44_generic(dst + i, n - i, gain);
+}
+
+static void add_neon(int16_t* dst, const int16_t* src, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vld1q_s16(src + i)));
+
+    add_generic(dst + i, src + i, n - i);
+}
+
+static void resample_neon(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n)
+{
+    size_t i;
+
+    for(i = 0; i + 4 <= n; i += 4, taps += 16, coefs += 16) {
+        int32x4_t v = hsum4_neon(vmull_s16(vld1_s16(taps +  0), vld1_s16(coefs +  0)),
+                                 vmull_s16(vld1_s16(taps +  4), vld1_s16(coefs +  4)),
+                                 vmull_s16(vld1_s16(taps +  8), vld1_s16(coefs +  8)),
+                                 vmull_s16(vld1_s16(taps + 12), vld1_s16(coefs + 12)));
+        vst1_s16(dst + i, vqshrn_n_s32(v, 15));
+    }
+
+    resample_generic(dst + i, taps, coefs, n - i);
+}
+
+static void envmix_nead_neon(int16_t* dl, int16_t* dr, int16_t* wl, int16_t* wr,
+                             const int16_t* in, size_t n,
+                             uint16_t* env_values, const uint16_t* env_steps, const int16_t* xors)
+{
+    const int16x8_t x0 = vdupq_n_s16(xors[0]);
+    const int16x8_t x1 = vdupq_n_s16(xors[1]);
+    const int16x8_t x2 = vdupq_n_s16(xors[2]);
+    const int16x8_t x3 = vdupq_n_s16(xors[3]);
+    size_t i;
+
+    for(i = 0; i < n; i += 8) {
+        int16x8_t x  = vld1q_s16(in + i);
+        int16x8_t l  = veorq_s16(mulhi_su16_neon(x, env_values[0]), x0);
+        int16x8_t r  = veorq_s16(mulhi_su16_neon(x, env_values[1]), x1);
+        int16x8_t l2 = veorq_s16(mulhi_su16_neon(l, env_values[2]), x2);
+        int16x8_t r2 = veorq_s16(mulhi_su16_neon(r, env_values[2]), x3);
+
+        vst1q_s16(dl + i, vqaddq_s16(vld1q_s16(dl + i), l));
+        vst1q_s16(dr + i, vqaddq_s16(vld1q_s16(dr + i), r));
+        vst1q_s16(wl + i, vqaddq_s16(vld1q_s16(wl + i), l2));
+        vst1q_s16(wr + i, vqaddq_s16(vld1q_s16(wr + i), r2));
+
+        env_values[0] += env_steps[0];
+        env_values[1] += env_steps[1];
+        env_values[2] += env_steps[2];
+    }
+}
+
+static void polef_neon(int16_t* dst, const int16_t* frame, const struct alist_polef_coefs* coefs,
+                       int16_t l1, int16_t l2)
+{
+    const int16x8_t x = vld1q_s16(frame);
+    const int16x8_t h1 = vld1q_s16(coefs->h1);
+    const int16x8_t h2 = vld1q_s16(coefs->h2);
+    const int32x4_t g = vdupq_n_s32(coefs->gain);
+    int32x4_t a0, a1;
+
+    a0 = hsum4_neon(dot8_neon(x, vld1q_s16(coefs->rows[0])), dot8_neon(x, vld1q_s16(coefs->rows[1])),
+                    dot8_neon(x, vld1q_s16(coefs->rows[2])), dot8_neon(x, vld1q_s16(coefs->rows[3])));
+    a1 = hsum4_neon(dot8_neon(x, vld1q_s16(coefs->rows[4])), dot8_neon(x, vld1q_s16(coefs->rows[5])),
+                    dot8_neon(x, vld1q_s16(coefs->rows[6])), dot8_neon(x, vld1q_s16(coefs->rows[7])));
+
+    a0 = vmlaq_s32(a0, vmovl_s16(vget_low_s16(x)), g);
+    a1 = vmlaq_s32(a1, vmovl_s16(vget_high_s16(x)), g);
+    a0 = vmlal_n_s16(vmlal_n_s16(a0, vget_low_s16(h1), l1), vget_low_s16(h2), l2);
+    a1 = vmlal_n_s16(vmlal_n_s16(a1, vget_high_s16(h1), l1), vget_high_s16(h2), l2);
+
+    vst1q_s16(dst, vcombine_s16(vqshrn_n_s32(a0, 14), vqshrn_n_s32(a1, 14)));
+}
+
+static void filter_neon(int16_t* dst, const int16_t* in1, const int16_t* in2, const int16_t* lut)
+{
+    const int16x8_t xlo = vrev32q_s16(vld1q_s16(in1));
+    const int16x8_t xhi = vrev32q_s16(vld1q_s16(in2));
+    /* lut with pairs swapped then reversed */
+    const int16x8_t r = vrev64q_s16(vrev32q_s16(vld1q_s16(lut)));
+    const int16x8_t c = vcombine_s16(vget_high_s16(r), vget_low_s16(r));
+    const int32x4_t round = vdupq_n_s32(0x4000);
+    int32x4_t a0, a1;
+
+    a0 = hsum4_neon(dot8_neon(vextq_s16(xlo, xhi, 1), c), dot8_neon(vextq_s16(xlo, xhi, 2), c),
+                    dot8_neon(vextq_s16(xlo, xhi, 3), c), dot8_neon(vextq_s16(xlo, xhi, 4), c));
+    a1 = hsum4_neon(dot8_neon(vextq_s16(xlo, xhi, 5), c), dot8_neon(vextq_s16(xlo, xhi, 6), c),
+                    dot8_neon(vextq_s16(xlo, xhi, 7), c), dot8_neon(xhi, c));
+
+    /* truncate to 16 bits */
+    vst1q_s16(dst, vrev32q_s16(vcombine_s16(vmovn_s32(vshrq_n_s32(vaddq_s32(a0, round), 15)),
+                                            vmovn_s32(vshrq_n_s32(vaddq_s32(a1, round), 15)))));
+}
+
+static void mix_round_neon(int16_t* dst, const int16_t* src, size_t n, int16_t gain)
+{
+    const int16x4_t g = vdup_n_s16(gain);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        int16x8_t d = vld1q_s16(dst + i);
+        int16x8_t x = vld1q_s16(src + i);
+        int32x4_t p0 = vrshrq_n_s32(vmull_s16(vget_low_s16(x), g), 15);
+        int32x4_t p1 = vrshrq_n_s32(vmull_s16(vget_high_s16(x), g), 15);
+
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vaddw_s16(p0, vget_low_s16(d))),
+                                        vqmovn_s32(vaddw_s16(p1, vget_high_s16(d)))));
+    }
+
+    mix_round_generic(dst + i, src + i, n - i, gain);
+}
+
+static void mix_ramp_neon(int16_t* dst, const int16_t* src, size_t n, int32_t env, int32_t step)
+{
+    const int32x4_t step8 = vdupq_n_s32((int32_t)((uint32_t)step * 8));
+    int32_t e[8];
+    int32x4_t e0, e1;
+    size_t i;
+
+    /* env + {0..7} * step, wrapping like the scalar code */
+    for(i = 0; i < 8; ++i)
+        e[i] = (int32_t)((uint32_t)env + (uint32_t)i * (uint32_t)step);
+
+    e0 = vld1q_s32(e);
+    e1 = vld1q_s32(e + 4);
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        int16x8_t g = vcombine_s16(vshrn_n_s32(e0, 16), vshrn_n_s32(e1, 16));
+
+        vst1q_s16(dst + i, mix8_neon(vld1q_s16(dst + i), vld1q_s16(src + i), g));
+
+        e0 = vaddq_s32(e0, step8);
+        e1 = vaddq_s32(e1, step8);
+    }
+
+    mix_ramp_generic(dst + i, src + i, n - i, (int32_t)((uint32_t)env + (uint32_t)i * (uint32_t)step), step);
+}
+
+static void scale_u16_neon(int16_t* dst, const int16_t* src, size_t n, uint16_t gain)
+{
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+        vst1q_s16(dst + i, mulhi_su16_neon(vld1q_s16(src + i), gain));
+
+    scale_u16_generic(dst + i, src + i, n - i, gain);
+}
+
+static void fir4_neon(int16_t* dst, const int16_t* src, size_t n, int16_t hgain, const int16_t* hcoeffs)
+{
+    int32_t h[4];
+    size_t i;
+
+    h[0] = (hgain * hcoeffs[0]) >> 15;
+    h[1] = (hgain * hcoeffs[1]) >> 15;
+    h[2] = (hgain * hcoeffs[2]) >> 15;
+    h[3] = (hgain * hcoeffs[3]) >> 15;
+
+    /* only -32768 * -32768 doesn't fit */
+    if (h[0] > 0x7fff || h[1] > 0x7fff || h[2] > 0x7fff || h[3] > 0x7fff) {
+        fir4_generic(dst, src, n, hgain, hcoeffs);
+        return;
+    }
+
+    for(i = 0; i + 4 <= n; i += 4) {
+        int32x4_t v = vmull_n_s16(vld1_s16(src + i), h[0]);
+        v = vmlal_n_s16(v, vld1_s16(src + i + 1), h[1]);
+        v = vmlal_n_s16(v, vld1_s16(src + i + 2), h[2]);
+        v = vmlal_n_s16(v, vld1_s16(src + i + 3), h[3]);
+
+        vst1_s16(dst + i, vqmovn_s32(vaddw_s16(vshrq_n_s32(v, 15), vld1_s16(dst + i))));
+    }
+
+    fir4_generic(dst + i, src + i, n - i, hgain, hcoeffs);
+}
+
+static void resample_sat_neon(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n)
+{
+    size_t i, k;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        int16x8_t accu = vdupq_n_s16(0);
+
+        for(k = 0; k < 4; ++k)
+            accu = mix8_neon(accu, vld1q_s16(taps + k*n + i), vld1q_s16(coefs + k*n + i));
+
+        vst1q_s16(dst + i, accu);
+    }
+
+    for(; i < n; ++i) {
+        int32_t accu = 0;
+
+        for(k = 0; k < 4; ++k)
+            accu = clamp_s16(accu + ((taps[k*n + i] * coefs[k*n + i]) >> 15));
+
+        dst[i] = accu;
+    }
+}
+
+static void adpcm_predict_neon(int16_t* dst, const uint8_t* nibbles, size_t n, unsigned int rshift)
+{
+    const int16x8_t shift = vdupq_n_s16(-(int16_t)rshift);
+    size_t i;
+
+    for(i = 0; i + 8 <= n; i += 8) {
+        /* bytes in the high half of each lane */
+        uint16x8_t x = vshll_n_u8(vld1_u8(nibbles + i), 8);
+        int16x8x2_t v;
+
+        v.val[0] = vshlq_s16(vreinterpretq_s16_u16(vandq_u16(x, vdupq_n_u16(0xf000))), shift);
+        v.val[1] = vshlq_s16(vreinterpretq_s16_u16(vshlq_n_u16(x, 4)), shift);
+        vst2q_s16(dst + 2*i, v);
+    }
+
+    adpcm_predict_generic(dst + 2*i, nibbles + i, n - i, rshift);
+}
+
+#define ADPCM_COLUMN_NEON(k) \
+    c = vextq_s16(zero, book2, 7 - (k)); \
+    a0 = vmlal_n_s16(a0, vget_low_s16(c), src[i + (k)]); \
+    a1 = vmlal_n_s16(a1, vget_high_s16(c), src[i + (k)])
+
+static void adpcm_residuals_neon(int16_t* dst, const int16_t* src, const int16_t* book,
+                                 const int16_t* last, size_t n)
+{
+    const int16x8_t zero = vdupq_n_s16(0);
+    const int16x8_t book1 = vld1q_s16(book);
+    const int16x8_t book2 = vld1q_s16(book + 8);
+    int16_t l1 = last[0];
+    int16_t l2 = last[1];
+    size_t i;
+
+    for(i = 0; i < n; i += 8) {
+        const int16x8_t x = vld1q_s16(src + i);
+        int32x4_t a0 = vshlq_n_s32(vmovl_s16(vget_low_s16(x)), 11);
+        int32x4_t a1 = vshlq_n_s32(vmovl_s16(vget_high_s16(x)), 11);
+        int16x8_t c;
+
+        a0 = vmlal_n_s16(vmlal_n_s16(a0, vget_low_s16(book1), l1), vget_low_s16(book2), l2);
+        a1 = vmlal_n_s16(vmlal_n_s16(a1, vget_high_s16(book1), l1), vget_high_s16(book2), l2);
+
+        /* column k of the book2 matrix, applied to sample k of the group */
+        ADPCM_COLUMN_NEON(0);
+        ADPCM_COLUMN_NEON(1);
+        ADPCM_COLUMN_NEON(2);
+        ADPCM_COLUMN_NEON(3);
+        ADPCM_COLUMN_NEON(4);
+        ADPCM_COLUMN_NEON(5);
+        ADPCM_COLUMN_NEON(6);
+
+        vst1q_s16(dst + i, vcombine_s16(vqshrn_n_s32(a0, 11), vqshrn_n_s32(a1, 11)));
+
+        l1 = dst[i + 6];
+        l2 = dst[i + 7];
+    }
+}
+
+#undef ADPCM_COLUMN_NEON
+
+/* sum of the 16 products (x * w + 0x4000) >> 15, negated where sign is set, in 4 lanes */
+static inline int32x4_t dot16_round_neon(const int16_t* x, const int16_t* w, int32x4_t sign)
+{
+    int16x8_t xa = vld1q_s16(x);
+    int16x8_t xb = vld1q_s16(x + 8);
+    int16x8_t wa = vld1q_s16(w);
+    int16x8_t wb = vld1q_s16(w + 8);
+    int32x4_t p0 = vrshrq_n_s32(vmull_s16(vget_low_s16(xa), vget_low_s16(wa)), 15);
+    int32x4_t p1 = vrshrq_n_s32(vmull_s16(vget_high_s16(xa), vget_high_s16(wa)), 15);
+    int32x4_t p2 = vrshrq_n_s32(vmull_s16(vget_low_s16(xb), vget_low_s16(wb)), 15);
+    int32x4_t p3 = vrshrq_n_s32(vmull_s16(vget_high_s16(xb), vget_high_s16(wb)), 15);
+    int32x4_t s = vaddq_s32(vaddq_s32(p0, p1), vaddq_s32(p2, p3));
+
+    return vsubq_s32(veorq_s32(s, sign), sign);
+}
+
+static void dewindow_neon(int32_t* dst, const int16_t* x0, const int16_t* x1, ptrdiff_t xstep,
+                          const int16_t* w, int alternate)
+{
+    static const int32_t odd[4] = { 0, -1, 0, -1 };
+    const int32x4_t sign = alternate ? vld1q_s32(odd) : vdupq_n_s32(0);
+    size_t r;
+
+    for(r = 0; r < 8; r += 2) {
+        int32x4_t a = dot16_round_neon(x0, w, sign);
+        int32x4_t b = dot16_round_neon(x1, w + 32, sign);
+        int32x4_t c = dot16_round_neon(x0 + xstep, w + 64, sign);
+        int32x4_t d = dot16_round_neon(x1 + xstep, w + 96, sign);
+
+        vst1q_s32(dst + 2 * r, hsum4_neon(a, b, c, d));
+
+        x0 += 2 * xstep;
+        x1 += 2 * xstep;
+        w += 128;
+    }
+}
+
+static const struct alist_kernels alist_kernels_neon =
+{
+    "NEON",
+    mix_neon,
+    mix_gains_neon,
+    mult_q44_neon,
+    add_neon,
+    resample_neon,
+    envmix_nead_neon,
+    polef_neon,
+    filter_neon,
+    mix_round_neon,
+    mix_ramp_neon,
+    scale_u16_neon,
+    fir4_neon,
+    resample_sat_neon,
+    adpcm_predict_neon,
+    adpcm_residuals_neon,
+    dewindow_neon
+};
+#endif
+
+
+const struct alist_kernels* alist_kernels_select(void)
+{
+#if defined(ALIST_KERNELS_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return &alist_kernels_avx2;
+#endif
+
+#if defined(ALIST_KERNELS_SSE2)
+    return &alist_kernels_sse2;
+#elif defined(ALIST_KERNELS_NEON)
+    return &alist_kernels_neon;
+#else
+    return &alist_kernels_generic;
+#endif
+}
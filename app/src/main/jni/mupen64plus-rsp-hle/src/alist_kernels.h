@@ -0,0 +1,110 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-rsp-hle - alist_kernels.h                                 *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ALIST_KERNELS_H
+#define ALIST_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct alist_polef_coefs
+{
+    int16_t rows[8][8]; /* rows[i][k] = h2[i-1-k] for k < i, 0 otherwise */
+    int16_t h1[8];
+    int16_t h2[8];      /* unscaled h2, applied to the second last sample */
+    uint16_t gain;
+};
+
+/* Sample processing loops of the alist commands.
+ *
+ * Every implementation must give the exact same results as the generic
+ * one. Kernels work on plain host arrays: callers take care of the
+ * DMEM swizzling and only use them on buffers which don't partially
+ * overlap.
+ */
+struct alist_kernels
+{
+    const char* name;
+
+    /* dst[i] = clamp(dst[i] + (src[i] * gain) >> 15) */
+    void (*mix)(int16_t* dst, const int16_t* src, size_t n, int16_t gain);
+
+    /* dst[i] = clamp(dst[i] + (src[i] * gains[i]) >> 15) */
+    void (*mix_gains)(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n);
+
+    /* dst[i] = clamp(dst[i] * gain >> 4) */
+    void (*mult_q44)(int16_t* dst, size_t n, int8_t gain);
+
+    /* dst[i] = clamp(dst[i] + src[i]) */
+    void (*add)(int16_t* dst, const int16_t* src, size_t n);
+
+    /* dst[i] = clamp(dot(taps[4i..4i+3], coefs[4i..4i+3]) >> 15) */
+    void (*resample)(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n);
+
+    /* nead envelope mixer, n is a multiple of 8, envelopes step every 8 samples */
+    void (*envmix_nead)(int16_t* dl, int16_t* dr, int16_t* wl, int16_t* wr,
+                        const int16_t* in, size_t n,
+                        uint16_t* env_values, const uint16_t* env_steps, const int16_t* xors);
+
+    /* one 8 samples frame of the pole filter, l1 and l2 are the last two outputs */
+    void (*polef)(int16_t* dst, const int16_t* frame, const struct alist_polef_coefs* coefs,
+                  int16_t l1, int16_t l2);
+
+    /* one 8 samples frame of the nead filter, in1 is the previous input frame */
+    void (*filter)(int16_t* dst, const int16_t* in1, const int16_t* in2, const int16_t* lut);
+
+    /* dst[i] = clamp(dst[i] + (src[i] * gain + 0x4000) >> 15) */
+    void (*mix_round)(int16_t* dst, const int16_t* src, size_t n, int16_t gain);
+
+    /* dst[i] = clamp(dst[i] + (src[i] * ((env + i*step) >> 16)) >> 15) */
+    void (*mix_ramp)(int16_t* dst, const int16_t* src, size_t n, int32_t env, int32_t step);
+
+    /* dst[i] = (src[i] * gain) >> 16 */
+    void (*scale_u16)(int16_t* dst, const int16_t* src, size_t n, uint16_t gain);
+
+    /* dst[i] = clamp(dst[i] + dot(src[i..i+3], h) >> 15), h[k] = (hgain * hcoeffs[k]) >> 15 */
+    void (*fir4)(int16_t* dst, const int16_t* src, size_t n, int16_t hgain, const int16_t* hcoeffs);
+
+    /* dot4 of taps and coefs clamped after each tap, both hold 4 planes of n values */
+    void (*resample_sat)(int16_t* dst, const int16_t* taps, const int16_t* coefs, size_t n);
+
+    /* 4 bits adpcm samples, high nibble first, n bytes give 2n samples */
+    void (*adpcm_predict)(int16_t* dst, const uint8_t* nibbles, size_t n, unsigned int rshift);
+
+    /* adpcm residuals of n samples (a multiple of 8) decoded by groups of 8,
+     * the first group is predicted from last[0..1], the next ones from the
+     * last two samples of the previous group */
+    void (*adpcm_residuals)(int16_t* dst, const int16_t* src, const int16_t* book,
+                            const int16_t* last, size_t n);
+
+    /* mp3 polyphase window over 8 rows, every product rounded on its own:
+     * dst[2r] = sum((x0[i] * w[i] + 0x4000) >> 15) for i < 16 and dst[2r+1]
+     * the same with x1 and w[32..47]. x0 and x1 move by xstep and w by 64
+     * from one row to the next, odd products are subtracted if alternate */
+    void (*dewindow)(int32_t* dst, const int16_t* x0, const int16_t* x1, ptrdiff_t xstep,
+                     const int16_t* w, int alternate);
+};
+
+extern const struct alist_kernels alist_kernels_generic;
+
+/* best implementation supported by the host */
+const struct alist_kernels* alist_kernels_select(void);
+
+#endif
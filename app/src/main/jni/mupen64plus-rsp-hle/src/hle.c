@@ -28,6 +28,10 @@
 #include <stdio.h>
 #endif
 
+#ifdef ENABLE_ALIST_CAPTURE
+#include "alist_capture.h"
+#endif
+#include "alist_kernels.h"
 #include "hle_external.h"
 #include "hle_internal.h"
 #include "memory.h"
@@ -54,6 +58,7 @@ static bool is_task(struct hle_t* hle);
 static void rsp_break(struct hle_t* hle, unsigned int setbits);
 static void forward_gfx_task(struct hle_t* hle);
 static bool try_fast_audio_dispatching(struct hle_t* hle);
+static bool audio_task_dispatching(struct hle_t* hle);
 static bool try_fast_task_dispatching(struct hle_t* hle);
 static void normal_task_dispatching(struct hle_t* hle);
 static void non_task_dispatching(struct hle_t* hle);
@@ -116,6 +121,9 @@ void hle_init(struct hle_t* hle,
     hle->dpc_pipebusy = dpc_pipebusy;
     hle->dpc_tmem     = dpc_tmem;
     hle->user_defined = user_defined;
+
+    hle->alist_kernels = alist_kernels_select();
+    HleVerboseMessage(hle->user_defined, "Using %s audio kernels", hle->alist_kernels->name);
 }
 
 void hle_execute(struct hle_t* hle)
@@ -253,6 +261,21 @@ static bool try_fast_audio_dispatching(struct hle_t* hle)
     return false;
 }
 
+static bool audio_task_dispatching(struct hle_t* hle)
+{
+#ifdef ENABLE_ALIST_CAPTURE
+    bool handled;
+
+    alist_capture_begin(hle);
+    handled = try_fast_audio_dispatching(hle);
+    alist_capture_end(hle, handled);
+
+    return handled;
+#else
+    return try_fast_audio_dispatching(hle);
+#endif
+}
+
 static bool try_fast_task_dispatching(struct hle_t* hle)
 {
     /* identify task ucode by its type */
@@ -268,7 +291,7 @@ static bool try_fast_task_dispatching(struct hle_t* hle)
         if (FORWARD_AUDIO) {
             HleProcessAlistList(hle->user_defined);
             return true;
-        } else if (try_fast_audio_dispatching(hle))
+        } else if (audio_task_dispatching(hle))
             return true;
         break;
 
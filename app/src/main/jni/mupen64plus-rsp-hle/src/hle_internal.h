@@ -26,6 +26,8 @@
 
 #include "ucodes.h"
 
+struct alist_kernels;
+
 /* rsp hle internal state - internal usage only */
 struct hle_t
 {
@@ -58,7 +60,9 @@ struct hle_t
     void* user_defined;
 
 
-    /* alist.c */
+    /* alist.c, the kernels pointer stays ahead of the buffer: commands
+     * addressing it with raw DMEM offsets and counts can run past its end */
+    const struct alist_kernels* alist_kernels;
     uint8_t alist_buffer[0x1000];
 
     /* alist_audio.c */
@@ -30,6 +30,24 @@
 #include "hle_internal.h"
 #include "memory.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JPEG_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define JPEG_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(JPEG_SSE2) || defined(JPEG_NEON)
+#define JPEG_SIMD
+#endif
+
+/* -ffast-math lets the compiler reorder the scalar IDCT but not the
+ * intrinsics, so the vector IDCT is only bit exact without it */
+#if defined(JPEG_SIMD) && !defined(__FAST_MATH__)
+#define JPEG_SIMD_IDCT
+#endif
+
 #define SUBBLOCK_SIZE 64
 
 typedef void (*tile_line_emitter_t)(struct hle_t* hle, const int16_t *y, const int16_t *u, uint32_t address);
@@ -43,13 +61,20 @@ static void jpeg_decode_std(struct hle_t* hle,
                             const tile_line_emitter_t emit_line);
 
 /* helper functions */
+#ifndef JPEG_SIMD
 static uint8_t clamp_u8(int16_t x);
+#endif
 static int16_t clamp_s12(int16_t x);
 static uint16_t clamp_RGBA_component(int16_t x);
 
 /* pixel conversion & formatting */
+#ifndef JPEG_SIMD
 static uint32_t GetUYVY(int16_t y1, int16_t y2, int16_t u, int16_t v);
+#endif
 static uint16_t GetRGBA(int16_t y, int16_t u, int16_t v);
+#ifdef JPEG_SIMD
+static int GetRGBA8(uint16_t *rgba, const int16_t *y, const int16_t *u, const int16_t *v);
+#endif
 
 /* tile line emitters */
 static void EmitYUVTileLine(struct hle_t* hle, const int16_t *y, const int16_t *u, uint32_t address);
@@ -72,7 +97,11 @@ static void ReorderSubBlock(int16_t *dst, const int16_t *src, const unsigned int
 static void MultSubBlocks(int16_t *dst, const int16_t *src1, const int16_t *src2, unsigned int shift);
 static void ScaleSubBlock(int16_t *dst, const int16_t *src, int16_t scale);
 static void RShiftSubBlock(int16_t *dst, const int16_t *src, unsigned int shift);
+#ifdef JPEG_SIMD
+static void InverseDCT1D_x4(const float *x, float *dst);
+#else
 static void InverseDCT1D(const float *const x, float *dst, unsigned int stride);
+#endif
 static void InverseDCTSubBlock(int16_t *dst, const int16_t *src);
 static void RescaleYSubBlock(int16_t *dst, const int16_t *src);
 static void RescaleUVSubBlock(int16_t *dst, const int16_t *src);
@@ -265,10 +294,12 @@ static void jpeg_decode_std(struct hle_t* hle,
     }
 }
 
+#ifndef JPEG_SIMD
 static uint8_t clamp_u8(int16_t x)
 {
     return (x & (0xff00)) ? ((-x) >> 15) & 0xff : x;
 }
+#endif
 
 static int16_t clamp_s12(int16_t x)
 {
@@ -288,6 +319,7 @@ static uint16_t clamp_RGBA_component(int16_t x)
     return (x & 0xf80);
 }
 
+#ifndef JPEG_SIMD
 static uint32_t GetUYVY(int16_t y1, int16_t y2, int16_t u, int16_t v)
 {
     return (uint32_t)clamp_u8(u)  << 24 |
@@ -295,6 +327,7 @@ static uint32_t GetUYVY(int16_t y1, int16_t y2, int16_t u, int16_t v)
            (uint32_t)clamp_u8(v)  << 8 |
            (uint32_t)clamp_u8(y2);
 }
+#endif
 
 static uint16_t GetRGBA(int16_t y, int16_t u, int16_t v)
 {
@@ -309,6 +342,119 @@ static uint16_t GetRGBA(int16_t y, int16_t u, int16_t v)
     return (r << 4) | (g >> 1) | (b >> 6) | 1;
 }
 
+#ifdef JPEG_SIMD
+/* Integer version of GetRGBA for 8 pixels, each u and v being shared by 2
+ * pixels. For y, u and v in [-4096, 4095] (the range of decoded samples),
+ * a 5-bit component is floor(n / 1280000) clamped to [0, 31], with
+ * n = 10000 * (y + 2048) + ku * u + kv * v. This matches the floating point
+ * formula, except when green falls exactly on a component step, where the
+ * rounding of the doubles can go either way: 0 is returned in that case,
+ * and the caller has to use GetRGBA instead. Red and blue have a single
+ * chroma term and never hit this case, so only green reports its steps. */
+#if defined(JPEG_SSE2)
+static __m128i GetRGBAComponent8(__m128i n_lo, __m128i n_hi, __m128i *on_step)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low_bits = _mm_set1_epi32(0x7ff);
+    __m128i q, c;
+
+    /* floor(n / 1280000) = floor(floor(n / 2048) / 625) */
+    q = _mm_packs_epi32(_mm_srai_epi32(n_lo, 11), _mm_srai_epi32(n_hi, 11));
+    q = _mm_min_epi16(_mm_max_epi16(q, zero), _mm_set1_epi16(19999));
+    c = _mm_srli_epi16(_mm_mulhi_epu16(q, _mm_set1_epi16((int16_t)53688)), 9);
+
+    if (on_step != NULL)
+        *on_step = _mm_and_si128(
+                _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(n_lo, low_bits), zero),
+                                _mm_cmpeq_epi32(_mm_and_si128(n_hi, low_bits), zero)),
+                _mm_and_si128(_mm_cmpeq_epi16(q, _mm_mullo_epi16(c, _mm_set1_epi16(625))),
+                              _mm_cmpgt_epi16(c, zero)));
+
+    return c;
+}
+
+static int GetRGBA8(uint16_t *rgba, const int16_t *y, const int16_t *u, const int16_t *v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yy = _mm_add_epi16(_mm_loadu_si128((const __m128i *)y), _mm_set1_epi16(2048));
+    const __m128i u4 = _mm_loadl_epi64((const __m128i *)u);
+    const __m128i v4 = _mm_loadl_epi64((const __m128i *)v);
+    const __m128i uu = _mm_unpacklo_epi16(u4, u4);
+    const __m128i vv = _mm_unpacklo_epi16(v4, v4);
+    const __m128i kr = _mm_set_epi16(14025, 10000, 14025, 10000, 14025, 10000, 14025, 10000);
+    const __m128i kg = _mm_set_epi16(-3443, 10000, -3443, 10000, -3443, 10000, -3443, 10000);
+    const __m128i kgv = _mm_set_epi16(0, -7144, 0, -7144, 0, -7144, 0, -7144);
+    const __m128i kb = _mm_set_epi16(17729, 10000, 17729, 10000, 17729, 10000, 17729, 10000);
+    __m128i r, g, b, on_step;
+
+    r = GetRGBAComponent8(_mm_madd_epi16(_mm_unpacklo_epi16(yy, vv), kr),
+                          _mm_madd_epi16(_mm_unpackhi_epi16(yy, vv), kr), NULL);
+    b = GetRGBAComponent8(_mm_madd_epi16(_mm_unpacklo_epi16(yy, uu), kb),
+                          _mm_madd_epi16(_mm_unpackhi_epi16(yy, uu), kb), NULL);
+    g = GetRGBAComponent8(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(yy, uu), kg),
+                                        _mm_madd_epi16(_mm_unpacklo_epi16(vv, zero), kgv)),
+                          _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(yy, uu), kg),
+                                        _mm_madd_epi16(_mm_unpackhi_epi16(vv, zero), kgv)), &on_step);
+
+    if (_mm_movemask_epi8(on_step) != 0)
+        return 0;
+
+    _mm_storeu_si128((__m128i *)rgba,
+            _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 6)),
+                         _mm_or_si128(_mm_slli_epi16(b, 1), _mm_set1_epi16(1))));
+    return 1;
+}
+#elif defined(JPEG_NEON)
+static uint16x8_t GetRGBAComponent8(int32x4_t n_lo, int32x4_t n_hi, uint16x8_t *on_step)
+{
+    const int32x4_t low_bits = vdupq_n_s32(0x7ff);
+    int16x8_t q;
+    uint16x8_t c;
+
+    /* floor(n / 1280000) = floor(floor(n / 2048) / 625) */
+    q = vcombine_s16(vqmovn_s32(vshrq_n_s32(n_lo, 11)), vqmovn_s32(vshrq_n_s32(n_hi, 11)));
+    q = vminq_s16(vmaxq_s16(q, vdupq_n_s16(0)), vdupq_n_s16(19999));
+    c = vcombine_u16(vmovn_u32(vshrq_n_u32(vmull_n_u16(vget_low_u16(vreinterpretq_u16_s16(q)), 53688), 25)),
+                     vmovn_u32(vshrq_n_u32(vmull_n_u16(vget_high_u16(vreinterpretq_u16_s16(q)), 53688), 25)));
+
+    if (on_step != NULL)
+        *on_step = vandq_u16(
+                vcombine_u16(vmovn_u32(vceqq_s32(vandq_s32(n_lo, low_bits), vdupq_n_s32(0))),
+                             vmovn_u32(vceqq_s32(vandq_s32(n_hi, low_bits), vdupq_n_s32(0)))),
+                vandq_u16(vceqq_u16(vreinterpretq_u16_s16(q), vmulq_n_u16(c, 625)),
+                          vcgtq_u16(c, vdupq_n_u16(0))));
+
+    return c;
+}
+
+static int GetRGBA8(uint16_t *rgba, const int16_t *y, const int16_t *u, const int16_t *v)
+{
+    const int16x8_t yy = vaddq_s16(vld1q_s16(y), vdupq_n_s16(2048));
+    const int16x4x2_t uu = vzip_s16(vld1_s16(u), vld1_s16(u));
+    const int16x4x2_t vv = vzip_s16(vld1_s16(v), vld1_s16(v));
+    const int32x4_t y_lo = vmull_n_s16(vget_low_s16(yy), 10000);
+    const int32x4_t y_hi = vmull_n_s16(vget_high_s16(yy), 10000);
+    uint16x8_t r, g, b, on_step;
+    uint64x1_t any;
+
+    r = GetRGBAComponent8(vmlal_n_s16(y_lo, vv.val[0], 14025),
+                          vmlal_n_s16(y_hi, vv.val[1], 14025), NULL);
+    b = GetRGBAComponent8(vmlal_n_s16(y_lo, uu.val[0], 17729),
+                          vmlal_n_s16(y_hi, uu.val[1], 17729), NULL);
+    g = GetRGBAComponent8(vmlal_n_s16(vmlal_n_s16(y_lo, uu.val[0], -3443), vv.val[0], -7144),
+                          vmlal_n_s16(vmlal_n_s16(y_hi, uu.val[1], -3443), vv.val[1], -7144), &on_step);
+
+    any = vreinterpret_u64_u16(vorr_u16(vget_low_u16(on_step), vget_high_u16(on_step)));
+    if (vget_lane_u64(any, 0) != 0)
+        return 0;
+
+    vst1q_u16(rgba, vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 6)),
+                              vorrq_u16(vshlq_n_u16(b, 1), vdupq_n_u16(1))));
+    return 1;
+}
+#endif
+#endif
+
 static void EmitYUVTileLine(struct hle_t* hle, const int16_t *y, const int16_t *u, uint32_t address)
 {
     uint32_t uyvy[8];
@@ -316,6 +462,34 @@ static void EmitYUVTileLine(struct hle_t* hle, const int16_t *y, const int16_t *
     const int16_t *const v  = u + SUBBLOCK_SIZE;
     const int16_t *const y2 = y + SUBBLOCK_SIZE;
 
+#if defined(JPEG_SSE2)
+    /* packs saturation matches clamp_u8 for the [-4096, 4095] range of
+     * the decoded samples */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yy = _mm_packus_epi16(_mm_loadu_si128((const __m128i *)y),
+                                        _mm_loadu_si128((const __m128i *)y2));
+    const __m128i uu = _mm_unpacklo_epi8(_mm_packus_epi16(_mm_loadu_si128((const __m128i *)u), zero), zero);
+    const __m128i vv = _mm_unpacklo_epi8(_mm_packus_epi16(_mm_loadu_si128((const __m128i *)v), zero), zero);
+
+    /* y1 | u << 8 in the high half of each word, y2 | v << 8 in the low half */
+    const __m128i hi = _mm_or_si128(_mm_and_si128(yy, _mm_set1_epi16(0xff)), _mm_slli_epi16(uu, 8));
+    const __m128i lo = _mm_or_si128(_mm_srli_epi16(yy, 8), _mm_slli_epi16(vv, 8));
+
+    _mm_storeu_si128((__m128i *)&uyvy[0], _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i *)&uyvy[4], _mm_unpackhi_epi16(lo, hi));
+#elif defined(JPEG_NEON)
+    /* same saturation as clamp_u8 for the decoded samples range */
+    const uint8x16_t yy = vcombine_u8(vqmovun_s16(vld1q_s16(y)), vqmovun_s16(vld1q_s16(y2)));
+    const uint8x8x2_t yp = vuzp_u8(vget_low_u8(yy), vget_high_u8(yy));
+    uint8x8x4_t bytes;
+
+    /* byte 0 is y2, then v, y1 and u */
+    bytes.val[0] = yp.val[1];
+    bytes.val[1] = vqmovun_s16(vld1q_s16(v));
+    bytes.val[2] = yp.val[0];
+    bytes.val[3] = vqmovun_s16(vld1q_s16(u));
+    vst4_u8((uint8_t *)uyvy, bytes);
+#else
     uyvy[0] = GetUYVY(y[0],  y[1],  u[0], v[0]);
     uyvy[1] = GetUYVY(y[2],  y[3],  u[1], v[1]);
     uyvy[2] = GetUYVY(y[4],  y[5],  u[2], v[2]);
@@ -324,6 +498,7 @@ static void EmitYUVTileLine(struct hle_t* hle, const int16_t *y, const int16_t *
     uyvy[5] = GetUYVY(y2[2], y2[3], u[5], v[5]);
     uyvy[6] = GetUYVY(y2[4], y2[5], u[6], v[6]);
     uyvy[7] = GetUYVY(y2[6], y2[7], u[7], v[7]);
+#endif
 
     dram_store_u32(hle, uyvy, address, 8);
 }
@@ -335,6 +510,13 @@ static void EmitRGBATileLine(struct hle_t* hle, const int16_t *y, const int16_t
     const int16_t *const v  = u + SUBBLOCK_SIZE;
     const int16_t *const y2 = y + SUBBLOCK_SIZE;
 
+#ifdef JPEG_SIMD
+    if (GetRGBA8(&rgba[0], y, u, v) && GetRGBA8(&rgba[8], y2, u + 4, v + 4)) {
+        dram_store_u16(hle, rgba, address, 16);
+        return;
+    }
+#endif
+
     rgba[0]  = GetRGBA(y[0],  u[0], v[0]);
     rgba[1]  = GetRGBA(y[1],  u[0], v[0]);
     rgba[2]  = GetRGBA(y[2],  u[1], v[1]);
@@ -482,10 +664,35 @@ static void MultSubBlocks(int16_t *dst, const int16_t *src1, const int16_t *src2
 {
     unsigned int i;
 
+#if defined(JPEG_SSE2)
+    const __m128i count = _mm_cvtsi32_si128(shift);
+
+    for (i = 0; i < SUBBLOCK_SIZE; i += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(src1 + i));
+        const __m128i b = _mm_loadu_si128((const __m128i *)(src2 + i));
+        const __m128i lo = _mm_mullo_epi16(a, b);
+        const __m128i hi = _mm_mulhi_epi16(a, b);
+        const __m128i v = _mm_packs_epi32(_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi));
+
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_sll_epi16(v, count));
+    }
+#elif defined(JPEG_NEON)
+    const int16x8_t count = vdupq_n_s16(shift);
+
+    for (i = 0; i < SUBBLOCK_SIZE; i += 8) {
+        const int16x8_t a = vld1q_s16(src1 + i);
+        const int16x8_t b = vld1q_s16(src2 + i);
+        const int16x8_t v = vcombine_s16(vqmovn_s32(vmull_s16(vget_low_s16(a), vget_low_s16(b))),
+                                         vqmovn_s32(vmull_s16(vget_high_s16(a), vget_high_s16(b))));
+
+        vst1q_s16(dst + i, vshlq_s16(v, count));
+    }
+#else
     for (i = 0; i < SUBBLOCK_SIZE; ++i) {
         int32_t v = src1[i] * src2[i];
         dst[i] = clamp_s16(v) << shift;
     }
+#endif
 }
 
 static void ScaleSubBlock(int16_t *dst, const int16_t *src, int16_t scale)
@@ -512,6 +719,110 @@ static void RShiftSubBlock(int16_t *dst, const int16_t *src, unsigned int shift)
  * Implementation based on Wikipedia :
  * http://fr.wikipedia.org/wiki/Transform%C3%A9e_en_cosinus_discr%C3%A8te
  **************************************************************************/
+#ifdef JPEG_SIMD_IDCT
+#if defined(JPEG_SSE2)
+typedef __m128 idct_vec_t;
+#define idct_load(p)        _mm_loadu_ps(p)
+#define idct_store(p, a)    _mm_storeu_ps(p, a)
+#define idct_add(a, b)      _mm_add_ps(a, b)
+#define idct_sub(a, b)      _mm_sub_ps(a, b)
+#define idct_mul(k, a)      _mm_mul_ps(_mm_set1_ps(k), a)
+#elif defined(JPEG_NEON)
+typedef float32x4_t idct_vec_t;
+#define idct_load(p)        vld1q_f32(p)
+#define idct_store(p, a)    vst1q_f32(p, a)
+#define idct_add(a, b)      vaddq_f32(a, b)
+#define idct_sub(a, b)      vsubq_f32(a, b)
+#define idct_mul(k, a)      vmulq_n_f32(a, k)
+#endif
+
+/* InverseDCT1D of 4 interleaved vectors: element j of the 4 vectors is
+ * x[8 * j .. 8 * j + 3], element k of the results goes to dst[8 * k ..].
+ * Operations are done in the same order to give the same results as
+ * InverseDCT1D. */
+static void InverseDCT1D_x4(const float *x, float *dst)
+{
+    idct_vec_t e[4];
+    idct_vec_t f[4];
+    idct_vec_t x26, x1357, x15, x37, x17, x35;
+
+    const idct_vec_t x0 = idct_load(x +  0);
+    const idct_vec_t x1 = idct_load(x +  8);
+    const idct_vec_t x2 = idct_load(x + 16);
+    const idct_vec_t x3 = idct_load(x + 24);
+    const idct_vec_t x4 = idct_load(x + 32);
+    const idct_vec_t x5 = idct_load(x + 40);
+    const idct_vec_t x6 = idct_load(x + 48);
+    const idct_vec_t x7 = idct_load(x + 56);
+
+    x15   = idct_mul(IDCT_K[2], idct_add(x1, x5));
+    x37   = idct_mul(IDCT_K[3], idct_add(x3, x7));
+    x17   = idct_mul(IDCT_K[8], idct_add(x1, x7));
+    x35   = idct_mul(IDCT_K[9], idct_add(x3, x5));
+    x1357 = idct_mul(IDCT_C3,   idct_add(idct_add(idct_add(x1, x3), x5), x7));
+    x26   = idct_mul(IDCT_C6,   idct_add(x2, x6));
+
+    f[0] = idct_add(x0, x4);
+    f[1] = idct_sub(x0, x4);
+    f[2] = idct_add(x26, idct_mul(IDCT_K[0], x2));
+    f[3] = idct_add(x26, idct_mul(IDCT_K[1], x6));
+
+    e[0] = idct_add(idct_add(idct_add(x1357, x15), idct_mul(IDCT_K[4], x1)), x17);
+    e[1] = idct_add(idct_add(idct_add(x1357, x37), idct_mul(IDCT_K[6], x3)), x35);
+    e[2] = idct_add(idct_add(idct_add(x1357, x15), idct_mul(IDCT_K[5], x5)), x35);
+    e[3] = idct_add(idct_add(idct_add(x1357, x37), idct_mul(IDCT_K[7], x7)), x17);
+
+    idct_store(dst +  0, idct_add(idct_add(f[0], f[2]), e[0]));
+    idct_store(dst +  8, idct_add(idct_add(f[1], f[3]), e[1]));
+    idct_store(dst + 16, idct_add(idct_sub(f[1], f[3]), e[2]));
+    idct_store(dst + 24, idct_add(idct_sub(f[0], f[2]), e[3]));
+    idct_store(dst + 32, idct_sub(idct_sub(f[0], f[2]), e[3]));
+    idct_store(dst + 40, idct_sub(idct_sub(f[1], f[3]), e[2]));
+    idct_store(dst + 48, idct_sub(idct_add(f[1], f[3]), e[1]));
+    idct_store(dst + 56, idct_sub(idct_add(f[0], f[2]), e[0]));
+}
+
+static void InverseDCTSubBlock(int16_t *dst, const int16_t *src)
+{
+    float t[SUBBLOCK_SIZE];
+    float block[SUBBLOCK_SIZE];
+    unsigned int i, j;
+
+    /* idct 1d on rows (+transposition), 4 rows at a time */
+    for (i = 0; i < 8; ++i)
+        for (j = 0; j < 8; ++j)
+            t[j * 8 + i] = (float)src[i * 8 + j];
+
+    InverseDCT1D_x4(&t[0], &block[0]);
+    InverseDCT1D_x4(&t[4], &block[4]);
+
+    /* idct 1d on columns, 4 columns at a time */
+    for (i = 0; i < 8; ++i)
+        for (j = 0; j < 8; ++j)
+            t[j * 8 + i] = block[i * 8 + j];
+
+    InverseDCT1D_x4(&t[0], &block[0]);
+    InverseDCT1D_x4(&t[4], &block[4]);
+
+    /* C4 = 1 normalization implies a division by 8 */
+    for (j = 0; j < 8; ++j) {
+#if defined(JPEG_SSE2)
+        /* truncate to 32 bits, then wrap to 16 bits like the (int16_t) cast */
+        __m128i lo = _mm_cvttps_epi32(_mm_loadu_ps(&block[j * 8]));
+        __m128i hi = _mm_cvttps_epi32(_mm_loadu_ps(&block[j * 8 + 4]));
+
+        lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+        hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+        _mm_storeu_si128((__m128i *)&dst[j * 8], _mm_srai_epi16(_mm_packs_epi32(lo, hi), 3));
+#elif defined(JPEG_NEON)
+        const int16x8_t v = vcombine_s16(vmovn_s32(vcvtq_s32_f32(vld1q_f32(&block[j * 8]))),
+                                         vmovn_s32(vcvtq_s32_f32(vld1q_f32(&block[j * 8 + 4]))));
+
+        vst1q_s16(&dst[j * 8], vshrq_n_s16(v, 3));
+#endif
+    }
+}
+#else
 static void InverseDCT1D(const float *const x, float *dst, unsigned int stride)
 {
     float e[4];
@@ -575,6 +886,7 @@ static void InverseDCTSubBlock(int16_t *dst, const int16_t *src)
             dst[i + j * 8] = (int16_t)x[j] >> 3;
     }
 }
+#endif
 
 static void RescaleYSubBlock(int16_t *dst, const int16_t *src)
 {
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "alist_kernels.h"
 #include "arithmetics.h"
 #include "hle_internal.h"
 #include "memory.h"
@@ -271,7 +272,7 @@ static void InnerLoop(struct hle_t* hle,
     uint32_t t1;
     uint32_t t2;
     uint32_t t3;
-    int32_t v2 = 0, v4 = 0, v6 = 0, v8 = 0;
+    int32_t v2 = 0, v4 = 0;
     uint32_t offset;
     uint32_t addptr;
     int x;
@@ -282,6 +283,8 @@ static void InnerLoop(struct hle_t* hle,
     int32_t hi1;
     int32_t vt;
     int32_t v[32];
+    int32_t sums[16];
+    const int16_t *window = (const int16_t *)DeWindowLUT;
 
     v[0] = *(int16_t *)(hle->mp3_buffer + inPtr + (0x00 ^ S16));
     v[31] = *(int16_t *)(hle->mp3_buffer + inPtr + (0x3E ^ S16));
@@ -575,31 +578,20 @@ static void InnerLoop(struct hle_t* hle,
 
     addptr = t6 & 0xFFE0;
 
-    offset = 0x10 - (t4 >> 1);
+    hle->alist_kernels->dewindow(sums,
+            (const int16_t *)(hle->mp3_buffer + addptr),
+            (const int16_t *)(hle->mp3_buffer + addptr + 0x20), 0x20,
+            window + 0x10 - (t4 >> 1), 0);
+
     for (x = 0; x < 8; x++) {
-        int32_t v0;
-        int32_t v18;
-        v2 = v4 = v6 = v8 = 0;
-
-        for (i = 7; i >= 0; i--) {
-            v2 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x00) * (short)DeWindowLUT[offset + 0x00] + 0x4000) >> 0xF;
-            v4 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x10) * (short)DeWindowLUT[offset + 0x08] + 0x4000) >> 0xF;
-            v6 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x20) * (short)DeWindowLUT[offset + 0x20] + 0x4000) >> 0xF;
-            v8 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x30) * (short)DeWindowLUT[offset + 0x28] + 0x4000) >> 0xF;
-            addptr += 2;
-            offset++;
-        }
-        v0  = v2 + v4;
-        v18 = v6 + v8;
         /* Clamp(v0); */
         /* Clamp(v18); */
         /* clamp??? */
-        *(int16_t *)(hle->mp3_buffer + (outPtr ^ S16)) = v0;
-        *(int16_t *)(hle->mp3_buffer + ((outPtr + 2)^S16)) = v18;
+        *(int16_t *)(hle->mp3_buffer + (outPtr ^ S16)) = sums[2 * x];
+        *(int16_t *)(hle->mp3_buffer + ((outPtr + 2)^S16)) = sums[2 * x + 1];
         outPtr += 4;
-        addptr += 0x30;
-        offset += 0x38;
     }
+    addptr += 8 * 0x40;
 
     offset = 0x10 - (t4 >> 1) + 8 * 0x40;
     v2 = v4 = 0;
@@ -625,34 +617,18 @@ static void InnerLoop(struct hle_t* hle,
     }
     addptr -= 0x50;
 
+    hle->alist_kernels->dewindow(sums,
+            (const int16_t *)(hle->mp3_buffer + addptr + 0x20),
+            (const int16_t *)(hle->mp3_buffer + addptr), -0x20,
+            window + 0x22F - (t4 >> 1), 1);
+
     for (x = 0; x < 8; x++) {
-        int32_t v0;
-        int32_t v18;
-        v2 = v4 = v6 = v8 = 0;
-
-        offset = (0x22F - (t4 >> 1) + x * 0x40);
-
-        for (i = 0; i < 4; i++) {
-            v2 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x20) * (short)DeWindowLUT[offset + 0x00] + 0x4000) >> 0xF;
-            v2 -= ((int) * (int16_t *)(hle->mp3_buffer + ((addptr + 2)) + 0x20) * (short)DeWindowLUT[offset + 0x01] + 0x4000) >> 0xF;
-            v4 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x30) * (short)DeWindowLUT[offset + 0x08] + 0x4000) >> 0xF;
-            v4 -= ((int) * (int16_t *)(hle->mp3_buffer + ((addptr + 2)) + 0x30) * (short)DeWindowLUT[offset + 0x09] + 0x4000) >> 0xF;
-            v6 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x00) * (short)DeWindowLUT[offset + 0x20] + 0x4000) >> 0xF;
-            v6 -= ((int) * (int16_t *)(hle->mp3_buffer + ((addptr + 2)) + 0x00) * (short)DeWindowLUT[offset + 0x21] + 0x4000) >> 0xF;
-            v8 += ((int) * (int16_t *)(hle->mp3_buffer + (addptr) + 0x10) * (short)DeWindowLUT[offset + 0x28] + 0x4000) >> 0xF;
-            v8 -= ((int) * (int16_t *)(hle->mp3_buffer + ((addptr + 2)) + 0x10) * (short)DeWindowLUT[offset + 0x29] + 0x4000) >> 0xF;
-            addptr += 4;
-            offset += 2;
-        }
-        v0  = v2 + v4;
-        v18 = v6 + v8;
         /* Clamp(v0); */
         /* Clamp(v18); */
         /* clamp??? */
-        *(int16_t *)(hle->mp3_buffer + ((outPtr + 2)^S16)) = v0;
-        *(int16_t *)(hle->mp3_buffer + ((outPtr + 4)^S16)) = v18;
+        *(int16_t *)(hle->mp3_buffer + ((outPtr + 2)^S16)) = sums[2 * x];
+        *(int16_t *)(hle->mp3_buffer + ((outPtr + 4)^S16)) = sums[2 * x + 1];
         outPtr += 4;
-        addptr -= 0x50;
     }
 
     tmp = outPtr;
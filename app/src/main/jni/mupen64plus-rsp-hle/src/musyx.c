@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "alist_kernels.h"
 #include "arithmetics.h"
 #include "audio.h"
 #include "common.h"
@@ -37,6 +38,8 @@ enum { MAX_VOICES = 32 };
 
 enum { SAMPLE_BUFFER_SIZE = 0x200 };
 
+enum { ADPCM_BATCH = 8 };
+
 
 enum {
     SFD_VOICE_COUNT     = 0x0,
@@ -126,6 +129,8 @@ typedef struct {
 
     /* */
     int16_t subframe_740_last4[4];
+
+    const struct alist_kernels* kernels;
 } musyx_t;
 
 typedef void (*mix_sfx_with_main_subframes_t)(musyx_t *musyx, const int16_t *subframe,
@@ -157,10 +162,6 @@ static void adpcm_decode_frames(struct hle_t* hle,
                                 const int16_t *table, uint8_t count,
                                 uint8_t skip_samples);
 
-static void adpcm_predict_frame(int16_t *dst, const uint8_t *src,
-                                const uint8_t *nibbles,
-                                unsigned int rshift);
-
 static void mix_voice_samples(struct hle_t* hle, musyx_t *musyx,
                               uint32_t voice_ptr, const int16_t *samples,
                               unsigned segbase, unsigned offset, uint32_t last_sample_ptr);
@@ -174,10 +175,6 @@ static void mix_sfx_with_main_subframes_v1(musyx_t *musyx, const int16_t *subfra
 static void mix_sfx_with_main_subframes_v2(musyx_t *musyx, const int16_t *subframe,
                                            const uint16_t* gains);
 
-static void mix_samples(int16_t *y, int16_t x, int16_t hgain);
-static void mix_subframes(int16_t *y, const int16_t *x, int16_t hgain);
-static void mix_fir4(int16_t *y, const int16_t *x, int16_t hgain, const int16_t *hcoeffs);
-
 
 static void interleave_stage_v1(struct hle_t* hle, musyx_t *musyx,
                                 uint32_t output_ptr);
@@ -186,17 +183,6 @@ static void interleave_stage_v2(struct hle_t* hle, musyx_t *musyx,
                                 uint16_t mask_16, uint32_t ptr_18,
                                 uint32_t ptr_1c, uint32_t output_ptr);
 
-static int32_t dot4(const int16_t *x, const int16_t *y)
-{
-    size_t i;
-    int32_t accu = 0;
-
-    for (i = 0; i < 4; ++i)
-        accu = clamp_s16(accu + (((int32_t)x[i] * (int32_t)y[i]) >> 15));
-
-    return accu;
-}
-
 /**************************************************************************
  * MusyX v1 audio ucode
  **************************************************************************/
@@ -212,6 +198,7 @@ void musyx_v1_task(struct hle_t* hle)
                       sfd_ptr,
                       sfd_count);
 
+    musyx.kernels = hle->alist_kernels;
     state_ptr = *dram_u32(hle, sfd_ptr + SFD_STATE_PTR);
 
     /* load initial state */
@@ -272,6 +259,8 @@ void musyx_v2_task(struct hle_t* hle)
                       sfd_ptr,
                       sfd_count);
 
+    musyx.kernels = hle->alist_kernels;
+
     for (;;) {
         /* parse SFD structure */
         uint16_t sfx_index       = *dram_u16(hle, sfd_ptr + SFD_SFX_INDEX);
@@ -605,7 +594,8 @@ static void adpcm_decode_frames(struct hle_t* hle,
                                 const int16_t *table, uint8_t count,
                                 uint8_t skip_samples)
 {
-    int16_t frame[32];
+    int16_t frames[ADPCM_BATCH][32];
+    const int16_t *books[ADPCM_BATCH];
     const uint8_t *nibbles = src + 8;
     unsigned i;
     bool jump_gap = false;
@@ -620,46 +610,42 @@ static void adpcm_decode_frames(struct hle_t* hle,
         src += 4;
     }
 
-    for (i = 0; i < count; ++i) {
-        uint8_t c2 = nibbles[0];
+    while (count != 0) {
+        unsigned n = (count < ADPCM_BATCH) ? count : ADPCM_BATCH;
 
-        const int16_t *book = (c2 & 0xf0) + table;
-        unsigned int rshift = (c2 & 0x0f);
+        /* predict a batch of frames */
+        for (i = 0; i < n; ++i) {
+            uint8_t c2 = nibbles[0];
 
-        adpcm_predict_frame(frame, src, nibbles, rshift);
+            books[i] = (c2 & 0xf0) + table;
 
-        memcpy(dst, frame, 2 * sizeof(frame[0]));
-        adpcm_compute_residuals(dst +  2, frame +  2, book, dst     , 6);
-        adpcm_compute_residuals(dst +  8, frame +  8, book, dst +  6, 8);
-        adpcm_compute_residuals(dst + 16, frame + 16, book, dst + 14, 8);
-        adpcm_compute_residuals(dst + 24, frame + 24, book, dst + 22, 8);
+            /* samples predicted from the scale byte are replaced by the header */
+            hle->alist_kernels->adpcm_predict(frames[i], nibbles, 16, c2 & 0x0f);
+            frames[i][0] = (src[0] << 8) | src[1];
+            frames[i][1] = (src[2] << 8) | src[3];
 
-        if (jump_gap) {
-            nibbles += 8;
-            src += 32;
-        }
+            if (jump_gap) {
+                nibbles += 8;
+                src += 32;
+            }
 
-        jump_gap = !jump_gap;
-        nibbles += 16;
-        src += 4;
-        dst += 32;
-    }
-}
+            jump_gap = !jump_gap;
+            nibbles += 16;
+            src += 4;
+        }
 
-static void adpcm_predict_frame(int16_t *dst, const uint8_t *src,
-                                const uint8_t *nibbles,
-                                unsigned int rshift)
-{
-    unsigned int i;
+        /* then compute their residuals, 8 samples at a time */
+        for (i = 0; i < n; ++i) {
+            memcpy(dst, frames[i], 2 * sizeof(frames[i][0]));
 
-    *(dst++) = (src[0] << 8) | src[1];
-    *(dst++) = (src[2] << 8) | src[3];
+            /* only the first 6 samples of this group are kept */
+            hle->alist_kernels->adpcm_residuals(dst + 2, frames[i] + 2, books[i], dst, 8);
+            hle->alist_kernels->adpcm_residuals(dst + 8, frames[i] + 8, books[i], dst + 6, 24);
 
-    for (i = 1; i < 16; ++i) {
-        uint8_t byte = nibbles[i];
+            dst += 32;
+        }
 
-        *(dst++) = adpcm_predict_sample(byte, 0xf0,  8, rshift);
-        *(dst++) = adpcm_predict_sample(byte, 0x0f, 12, rshift);
+        count -= n;
     }
 }
 
@@ -693,6 +679,10 @@ static void mix_voice_samples(struct hle_t* hle, musyx_t *musyx,
     int16_t *v4_dst[4];
     int16_t  v4[4];
 
+    int16_t taps[4 * SUBFRAME_SIZE];
+    int16_t coefs[4 * SUBFRAME_SIZE];
+    int16_t v[SUBFRAME_SIZE];
+
     dram_load_u32(hle, (uint32_t *)v4_env,      voice_ptr + VOICE_ENV_BEGIN, 4);
     dram_load_u32(hle, (uint32_t *)v4_env_step, voice_ptr + VOICE_ENV_STEP,  4);
 
@@ -719,7 +709,6 @@ static void mix_voice_samples(struct hle_t* hle, musyx_t *musyx,
         /* update sample and lut pointers and then pitch_accu */
         const int16_t *lut = (RESAMPLE_LUT + ((pitch_accu & 0xfc00) >> 8));
         int dist;
-        int16_t v;
 
         sample += (pitch_accu >> 16);
         pitch_accu &= 0xffff;
@@ -730,21 +719,24 @@ static void mix_voice_samples(struct hle_t* hle, musyx_t *musyx,
         if (dist >= 0)
             sample = sample_restart + dist;
 
-        /* apply resample filter */
-        v = clamp_s16(dot4(sample, lut));
-
+        /* gather resample filter inputs */
         for (k = 0; k < 4; ++k) {
-            /* envmix */
-            int32_t accu = (v * (v4_env[k] >> 16)) >> 15;
-            v4[k] = clamp_s16(accu);
-            *(v4_dst[k]) = clamp_s16(accu + *(v4_dst[k]));
-
-            /* update envelopes and dst pointers */
-            ++(v4_dst[k]);
-            v4_env[k] += v4_env_step[k];
+            taps[k * SUBFRAME_SIZE + i]  = sample[k];
+            coefs[k * SUBFRAME_SIZE + i] = lut[k];
         }
     }
 
+    /* apply resample filter */
+    musyx->kernels->resample_sat(v, taps, coefs, SUBFRAME_SIZE);
+
+    for (k = 0; k < 4; ++k) {
+        /* envmix */
+        int32_t env_last = (int32_t)((uint32_t)v4_env[k] + (SUBFRAME_SIZE - 1) * (uint32_t)v4_env_step[k]);
+
+        musyx->kernels->mix_ramp(v4_dst[k], v, SUBFRAME_SIZE, v4_env[k], v4_env_step[k]);
+        v4[k] = clamp_s16((v[SUBFRAME_SIZE - 1] * (env_last >> 16)) >> 15);
+    }
+
     /* save last resampled sample */
     dram_store_u16(hle, (uint16_t *)v4, last_sample_ptr, 4);
 
@@ -834,7 +826,7 @@ static void sfx_stage(struct hle_t* hle, mix_sfx_with_main_subframes_t mix_sfx_w
 
         dram_load_u16(hle, (uint16_t *)delayed, cbuffer_ptr + dpos * 2, dlength);
 
-        mix_subframes(subframe, delayed, tap_gains[i]);
+        musyx->kernels->mix_round(subframe, delayed, SUBFRAME_SIZE, tap_gains[i]);
     }
 
     /* add resulting subframe to main subframes */
@@ -843,65 +835,28 @@ static void sfx_stage(struct hle_t* hle, mix_sfx_with_main_subframes_t mix_sfx_w
     /* apply FIR4 filter and writeback filtered result */
     memcpy(buffer, musyx->subframe_740_last4, 4 * sizeof(int16_t));
     memcpy(musyx->subframe_740_last4, subframe + SUBFRAME_SIZE - 4, 4 * sizeof(int16_t));
-    mix_fir4(musyx->e50, buffer + 1, fir4_hgain, fir4_hcoeffs);
+    musyx->kernels->fir4(musyx->e50, buffer + 1, SUBFRAME_SIZE, fir4_hgain, fir4_hcoeffs);
     dram_store_u16(hle, (uint16_t *)musyx->e50, cbuffer_ptr + pos * 2, SUBFRAME_SIZE);
 }
 
 static void mix_sfx_with_main_subframes_v1(musyx_t *musyx, const int16_t *subframe,
                                            const uint16_t* UNUSED(gains))
 {
-    unsigned i;
-
-    for (i = 0; i < SUBFRAME_SIZE; ++i) {
-        int16_t v = subframe[i];
-        musyx->left[i]  = clamp_s16(musyx->left[i]  + v);
-        musyx->right[i] = clamp_s16(musyx->right[i] + v);
-    }
+    musyx->kernels->add(musyx->left,  subframe, SUBFRAME_SIZE);
+    musyx->kernels->add(musyx->right, subframe, SUBFRAME_SIZE);
 }
 
 static void mix_sfx_with_main_subframes_v2(musyx_t *musyx, const int16_t *subframe,
                                            const uint16_t* gains)
 {
-    unsigned i;
-
-    for (i = 0; i < SUBFRAME_SIZE; ++i) {
-        int16_t v = subframe[i];
-        int16_t v1 = (int32_t)(v * gains[0]) >> 16;
-        int16_t v2 = (int32_t)(v * gains[1]) >> 16;
-
-        musyx->left[i]  = clamp_s16(musyx->left[i]  + v1);
-        musyx->right[i] = clamp_s16(musyx->right[i] + v1);
-        musyx->cc0[i]   = clamp_s16(musyx->cc0[i]   + v2);
-    }
-}
-
-static void mix_samples(int16_t *y, int16_t x, int16_t hgain)
-{
-    *y = clamp_s16(*y + ((x * hgain + 0x4000) >> 15));
-}
+    int16_t v[SUBFRAME_SIZE];
 
-static void mix_subframes(int16_t *y, const int16_t *x, int16_t hgain)
-{
-    unsigned int i;
+    musyx->kernels->scale_u16(v, subframe, SUBFRAME_SIZE, gains[0]);
+    musyx->kernels->add(musyx->left,  v, SUBFRAME_SIZE);
+    musyx->kernels->add(musyx->right, v, SUBFRAME_SIZE);
 
-    for (i = 0; i < SUBFRAME_SIZE; ++i)
-        mix_samples(&y[i], x[i], hgain);
-}
-
-static void mix_fir4(int16_t *y, const int16_t *x, int16_t hgain, const int16_t *hcoeffs)
-{
-    unsigned int i;
-    int32_t h[4];
-
-    h[0] = (hgain * hcoeffs[0]) >> 15;
-    h[1] = (hgain * hcoeffs[1]) >> 15;
-    h[2] = (hgain * hcoeffs[2]) >> 15;
-    h[3] = (hgain * hcoeffs[3]) >> 15;
-
-    for (i = 0; i < SUBFRAME_SIZE; ++i) {
-        int32_t v = (h[0] * x[i] + h[1] * x[i + 1] + h[2] * x[i + 2] + h[3] * x[i + 3]) >> 15;
-        y[i] = clamp_s16(y[i] + v);
-    }
+    musyx->kernels->scale_u16(v, subframe, SUBFRAME_SIZE, gains[1]);
+    musyx->kernels->add(musyx->cc0,   v, SUBFRAME_SIZE);
 }
 
 static void interleave_stage_v1(struct hle_t* hle, musyx_t *musyx, uint32_t output_ptr)
@@ -938,6 +893,7 @@ static void interleave_stage_v2(struct hle_t* hle, musyx_t *musyx,
 {
     unsigned i, k;
     int16_t subframe[SUBFRAME_SIZE];
+    int16_t samples[3 * SUBFRAME_SIZE];
     uint32_t *dst;
     uint16_t mask;
 
@@ -964,11 +920,11 @@ static void interleave_stage_v2(struct hle_t* hle, musyx_t *musyx,
         address = *dram_u32(hle, ptr_18);
         hgain   = *dram_u16(hle, ptr_18 + 4);
 
-        for(i = 0; i < SUBFRAME_SIZE; ++i, address += 2) {
-            mix_samples(&musyx->left[i],  *dram_u16(hle, address), hgain);
-            mix_samples(&musyx->right[i], *dram_u16(hle, address + 2*SUBFRAME_SIZE), hgain);
-            mix_samples(&subframe[i],     *dram_u16(hle, address + 4*SUBFRAME_SIZE), hgain);
-        }
+        dram_load_u16(hle, (uint16_t*)samples, address, 3 * SUBFRAME_SIZE);
+
+        musyx->kernels->mix_round(musyx->left,  samples                  , SUBFRAME_SIZE, hgain);
+        musyx->kernels->mix_round(musyx->right, samples +   SUBFRAME_SIZE, SUBFRAME_SIZE, hgain);
+        musyx->kernels->mix_round(subframe,     samples + 2*SUBFRAME_SIZE, SUBFRAME_SIZE, hgain);
     }
 
     /* interleave L_total and R_total */
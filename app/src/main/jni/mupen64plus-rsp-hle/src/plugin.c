@@ -24,6 +24,9 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+#ifdef ENABLE_ALIST_CAPTURE
+#include "alist_capture.h"
+#endif
 #include "common.h"
 #include "hle.h"
 #include "hle_internal.h"
@@ -218,5 +221,7 @@ EXPORT void CALL InitiateRSP(RSP_INFO Rsp_Info, unsigned int* UNUSED(CycleCount)
 
 EXPORT void CALL RomClosed(void)
 {
-    /* do nothing */
+#ifdef ENABLE_ALIST_CAPTURE
+    alist_capture_close();
+#endif
 }
@@ -0,0 +1,460 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-rsp-hle - alistreplay.c                                   *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Replays the audio tasks captured by a plugin built with CAPTURE=1
+ * (see src/alist_capture.h for the format) through the hle audio code,
+ * checks the results against the capture and reports the time spent per
+ * task.
+ *
+ * Build with:
+ *   cc -O2 -o alistreplay alistreplay.c ../src/alist*.c ../src/audio.c ../src/cicx105.c \
+ *      ../src/hle.c ../src/jpeg.c ../src/memory.c ../src/mp3.c ../src/musyx.c -I../src
+ *
+ * Usage:
+ *   alistreplay [-g] [-r repeat] [-v] alist_capture.bin
+ *
+ *   -g         use the generic kernels instead of the best ones for the host
+ *   -r repeat  run each task repeat times, the fastest run is reported
+ *   -v         print a line per task
+ *
+ * The checksum covers DMEM, the hle audio buffer and the RDRAM pages
+ * modified by each task. It is computed on the replayed results and on
+ * the captured ones, which match when the replay is bit exact.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alist_capture.h"
+#include "alist_kernels.h"
+#include "hle.h"
+#include "hle_internal.h"
+#include "memory.h"
+
+struct replay
+{
+    FILE* f;
+    size_t state_size;
+
+    struct hle_t hle;
+    unsigned char* rdram;
+    unsigned char* expected;    /* RDRAM according to the capture */
+    unsigned char dmem[ALIST_CAPTURE_DMEM_SIZE];
+    unsigned char imem[0x1000];
+    unsigned int regs[18];
+
+    unsigned char input_dmem[ALIST_CAPTURE_DMEM_SIZE];
+    unsigned char* input_state;
+    unsigned char* state;
+    uint32_t ucode_data;
+
+    unsigned int repeat;
+    bool verbose;
+
+    /* results */
+    unsigned int tasks;
+    unsigned int unhandled;
+    unsigned int mismatches;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t replay_sum;
+    uint64_t capture_sum;
+};
+
+/* Global functions needed by HLE core */
+void HleVerboseMessage(void* user_defined, const char *message, ...) { (void)user_defined; (void)message; }
+void HleErrorMessage(void* user_defined, const char *message, ...) { (void)user_defined; (void)message; }
+void HleWarnMessage(void* user_defined, const char *message, ...) { (void)user_defined; (void)message; }
+
+void HleCheckInterrupts(void* user_defined) { (void)user_defined; }
+void HleProcessDlistList(void* user_defined) { (void)user_defined; }
+void HleProcessAlistList(void* user_defined) { (void)user_defined; }
+void HleProcessRdpList(void* user_defined) { (void)user_defined; }
+void HleShowCFB(void* user_defined) { (void)user_defined; }
+
+/* local functions */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* FNV-1a */
+static uint64_t hash(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* p = data;
+
+    while (size-- != 0) {
+        h ^= *p++;
+        h *= UINT64_C(0x100000001b3);
+    }
+
+    return h;
+}
+
+static bool get(struct replay* r, void* data, size_t size)
+{
+    return fread(data, 1, size, r->f) == size;
+}
+
+static bool get_u32(struct replay* r, uint32_t* value)
+{
+    return get(r, value, sizeof(*value));
+}
+
+static void get_state(struct replay* r, unsigned char* dst)
+{
+    void* fields[ALIST_CAPTURE_STATE_FIELDS];
+    size_t sizes[ALIST_CAPTURE_STATE_FIELDS];
+    size_t i;
+
+    alist_capture_state(&r->hle, fields, sizes);
+    for(i = 0; i < ALIST_CAPTURE_STATE_FIELDS; ++i) {
+        memcpy(dst, fields[i], sizes[i]);
+        dst += sizes[i];
+    }
+}
+
+static void set_state(struct replay* r, const unsigned char* src)
+{
+    void* fields[ALIST_CAPTURE_STATE_FIELDS];
+    size_t sizes[ALIST_CAPTURE_STATE_FIELDS];
+    size_t i;
+
+    alist_capture_state(&r->hle, fields, sizes);
+    for(i = 0; i < ALIST_CAPTURE_STATE_FIELDS; ++i) {
+        memcpy(fields[i], src, sizes[i]);
+        src += sizes[i];
+    }
+}
+
+static bool read_header(struct replay* r)
+{
+    char magic[8];
+    uint32_t byte_order, rdram_size, page_size, state_size;
+
+    if (!get(r, magic, 8) || memcmp(magic, ALIST_CAPTURE_MAGIC, 8) != 0) {
+        fprintf(stderr, "not an audio task capture\n");
+        return false;
+    }
+
+    if (!get_u32(r, &byte_order) || !get_u32(r, &rdram_size)
+     || !get_u32(r, &page_size) || !get_u32(r, &state_size))
+        return false;
+
+    if (byte_order != ALIST_CAPTURE_BYTE_ORDER) {
+        fprintf(stderr, "capture was made on a host of different endianness\n");
+        return false;
+    }
+
+    if (rdram_size != ALIST_CAPTURE_RDRAM_SIZE || page_size != ALIST_CAPTURE_PAGE_SIZE
+     || state_size != r->state_size) {
+        fprintf(stderr, "capture layout doesn't match this build (state size %u, expected %u)\n",
+                state_size, (unsigned int)r->state_size);
+        return false;
+    }
+
+    return true;
+}
+
+/* reads a page list into expected and adds it to the checksum */
+static bool read_pages(struct replay* r, uint64_t* sum)
+{
+    uint32_t count, page;
+
+    if (!get_u32(r, &count))
+        return false;
+
+    while (count-- != 0) {
+        unsigned char* dst;
+
+        if (!get_u32(r, &page) || page >= ALIST_CAPTURE_RDRAM_SIZE / ALIST_CAPTURE_PAGE_SIZE)
+            return false;
+
+        dst = r->expected + page * ALIST_CAPTURE_PAGE_SIZE;
+        if (!get(r, dst, ALIST_CAPTURE_PAGE_SIZE))
+            return false;
+
+        *sum = hash(*sum, &page, sizeof(page));
+        *sum = hash(*sum, dst, ALIST_CAPTURE_PAGE_SIZE);
+    }
+
+    return true;
+}
+
+static bool read_input(struct replay* r)
+{
+    uint64_t sum = 0;
+    uint32_t page;
+
+    if (!get(r, r->input_dmem, ALIST_CAPTURE_DMEM_SIZE)
+     || !get(r, r->input_state, r->state_size)
+     || !read_pages(r, &sum))
+        return false;
+
+    r->ucode_data = *u32(r->input_dmem, TASK_UCODE_DATA);
+
+    /* RDRAM changed by the game since the previous task */
+    for(page = 0; page < ALIST_CAPTURE_RDRAM_SIZE / ALIST_CAPTURE_PAGE_SIZE; ++page) {
+        size_t offset = page * ALIST_CAPTURE_PAGE_SIZE;
+
+        if (memcmp(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE) != 0)
+            memcpy(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE);
+    }
+
+    return true;
+}
+
+static uint64_t run_task(struct replay* r)
+{
+    uint64_t best = UINT64_MAX;
+    unsigned int i;
+    uint32_t page;
+
+    for(i = 0; i < r->repeat; ++i) {
+        uint64_t start, ns;
+
+        if (i != 0) {
+            /* undo the previous run */
+            for(page = 0; page < ALIST_CAPTURE_RDRAM_SIZE / ALIST_CAPTURE_PAGE_SIZE; ++page) {
+                size_t offset = page * ALIST_CAPTURE_PAGE_SIZE;
+
+                if (memcmp(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE) != 0)
+                    memcpy(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE);
+            }
+        }
+
+        memcpy(r->dmem, r->input_dmem, ALIST_CAPTURE_DMEM_SIZE);
+        set_state(r, r->input_state);
+        memset(r->regs, 0, sizeof(r->regs));
+
+        start = now_ns();
+        hle_execute(&r->hle);
+        ns = now_ns() - start;
+
+        if (ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+static bool read_output(struct replay* r, uint64_t ns)
+{
+    uint32_t handled, page;
+    uint64_t replay_sum = 0, capture_sum = 0;
+    unsigned int bad_pages = 0;
+    bool dmem_ok, state_ok;
+
+    /* checksum the pages the replay modified, before expected moves on */
+    for(page = 0; page < ALIST_CAPTURE_RDRAM_SIZE / ALIST_CAPTURE_PAGE_SIZE; ++page) {
+        size_t offset = page * ALIST_CAPTURE_PAGE_SIZE;
+
+        if (memcmp(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE) != 0) {
+            replay_sum = hash(replay_sum, &page, sizeof(page));
+            replay_sum = hash(replay_sum, r->rdram + offset, ALIST_CAPTURE_PAGE_SIZE);
+        }
+    }
+
+    get_state(r, r->state);
+    replay_sum = hash(replay_sum, r->dmem, ALIST_CAPTURE_DMEM_SIZE);
+    replay_sum = hash(replay_sum, r->hle.alist_buffer, sizeof(r->hle.alist_buffer));
+
+    if (!get_u32(r, &handled)
+     || !get(r, r->input_dmem, ALIST_CAPTURE_DMEM_SIZE)
+     || !get(r, r->input_state, r->state_size)
+     || !read_pages(r, &capture_sum))
+        return false;
+
+    capture_sum = hash(capture_sum, r->input_dmem, ALIST_CAPTURE_DMEM_SIZE);
+    capture_sum = hash(capture_sum, r->input_state, sizeof(r->hle.alist_buffer));
+
+    dmem_ok = (memcmp(r->dmem, r->input_dmem, ALIST_CAPTURE_DMEM_SIZE) == 0);
+    state_ok = (memcmp(r->state, r->input_state, r->state_size) == 0);
+
+    /* compare and resync RDRAM so a divergence doesn't leak into the next tasks */
+    for(page = 0; page < ALIST_CAPTURE_RDRAM_SIZE / ALIST_CAPTURE_PAGE_SIZE; ++page) {
+        size_t offset = page * ALIST_CAPTURE_PAGE_SIZE;
+
+        if (memcmp(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE) != 0) {
+            memcpy(r->rdram + offset, r->expected + offset, ALIST_CAPTURE_PAGE_SIZE);
+            ++bad_pages;
+        }
+    }
+
+    if (!handled)
+        ++r->unhandled;
+
+    if (!dmem_ok || !state_ok || bad_pages != 0) {
+        ++r->mismatches;
+        printf("task %u: mismatch (%s%s%u RDRAM pages)\n", r->tasks,
+               dmem_ok ? "" : "DMEM, ", state_ok ? "" : "hle state, ", bad_pages);
+    }
+
+    if (r->verbose)
+        printf("task %u: ucode_data %08x, %llu ns%s\n", r->tasks,
+               r->ucode_data,
+               (unsigned long long)ns, handled ? "" : " (not handled)");
+
+    r->replay_sum = hash(r->replay_sum, &replay_sum, sizeof(replay_sum));
+    r->capture_sum = hash(r->capture_sum, &capture_sum, sizeof(capture_sum));
+
+    r->total_ns += ns;
+    if (ns < r->min_ns)
+        r->min_ns = ns;
+    if (ns > r->max_ns)
+        r->max_ns = ns;
+    ++r->tasks;
+
+    return true;
+}
+
+static bool replay(struct replay* r)
+{
+    uint32_t tag;
+    uint64_t ns = 0;
+    bool pending = false;
+
+    while (get_u32(r, &tag)) {
+        switch (tag) {
+        case ALIST_CAPTURE_TAG_INPUT:
+            if (!read_input(r))
+                return false;
+            ns = run_task(r);
+            pending = true;
+            break;
+
+        case ALIST_CAPTURE_TAG_OUTPUT:
+            if (!pending || !read_output(r, ns))
+                return false;
+            pending = false;
+            break;
+
+        default:
+            fprintf(stderr, "unknown record %u\n", tag);
+            return false;
+        }
+    }
+
+    /* an interrupted capture may end with an input record */
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: alistreplay [-g] [-r repeat] [-v] alist_capture.bin\n");
+}
+
+int main(int argc, char** argv)
+{
+    struct replay r;
+    void* fields[ALIST_CAPTURE_STATE_FIELDS];
+    size_t sizes[ALIST_CAPTURE_STATE_FIELDS];
+    const char* filename = NULL;
+    bool generic = false;
+    bool ok;
+    int i;
+
+    memset(&r, 0, sizeof(r));
+    r.repeat = 1;
+    r.min_ns = UINT64_MAX;
+
+    for(i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-g") == 0)
+            generic = true;
+        else if (strcmp(argv[i], "-v") == 0)
+            r.verbose = true;
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            r.repeat = (unsigned int)atoi(argv[++i]);
+        else if (filename == NULL && argv[i][0] != '-')
+            filename = argv[i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (filename == NULL || r.repeat == 0) {
+        usage();
+        return 1;
+    }
+
+    r.rdram = calloc(1, ALIST_CAPTURE_RDRAM_SIZE);
+    r.expected = calloc(1, ALIST_CAPTURE_RDRAM_SIZE);
+
+    hle_init(&r.hle, r.rdram, r.dmem, r.imem,
+             &r.regs[0], &r.regs[1], &r.regs[2], &r.regs[3], &r.regs[4],
+             &r.regs[5], &r.regs[6], &r.regs[7], &r.regs[8], &r.regs[9],
+             &r.regs[10], &r.regs[11], &r.regs[12], &r.regs[13], &r.regs[14],
+             &r.regs[15], &r.regs[16], &r.regs[17],
+             NULL);
+
+    if (generic)
+        r.hle.alist_kernels = &alist_kernels_generic;
+
+    alist_capture_state(&r.hle, fields, sizes);
+    for(i = 0; i < ALIST_CAPTURE_STATE_FIELDS; ++i)
+        r.state_size += sizes[i];
+
+    r.input_state = malloc(r.state_size);
+    r.state = malloc(r.state_size);
+
+    r.f = fopen(filename, "rb");
+    if (r.rdram == NULL || r.expected == NULL || r.input_state == NULL || r.state == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (r.f == NULL) {
+        perror(filename);
+        return 1;
+    }
+
+    ok = read_header(&r) && replay(&r);
+    fclose(r.f);
+
+    if (!ok) {
+        fprintf(stderr, "%s: truncated or corrupted capture after %u tasks\n", filename, r.tasks);
+        return 1;
+    }
+
+    printf("%u tasks (%u not handled), %s kernels, %u runs per task\n",
+           r.tasks, r.unhandled, r.hle.alist_kernels->name, r.repeat);
+    if (r.tasks != 0)
+        printf("time per task: avg %llu ns, min %llu ns, max %llu ns\n",
+               (unsigned long long)(r.total_ns / r.tasks),
+               (unsigned long long)r.min_ns, (unsigned long long)r.max_ns);
+    printf("checksum: replay %016llx, capture %016llx\n",
+           (unsigned long long)r.replay_sum, (unsigned long long)r.capture_sum);
+    printf("%s: %u of %u tasks differ from the capture\n",
+           r.mismatches == 0 ? "bit exact" : "MISMATCH", r.mismatches, r.tasks);
+
+    free(r.rdram);
+    free(r.expected);
+    free(r.input_state);
+    free(r.state);
+
+    return (r.mismatches == 0) ? 0 : 2;
+}
@@ -0,0 +1,394 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-rsp-hle - kerneltest.c                                    *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Runs every audio kernel of the SSE2, AVX2 or NEON sets built for the host
+ * on random operands and checks the results hash the same as the generic
+ * kernels on the same operands.
+ *
+ * Build with:
+ *   cc -O2 -o kerneltest kerneltest.c ../src/audio.c -I../src
+ * or run "make test" from projects/unix.
+ *
+ * Usage:
+ *   kerneltest [iterations]
+ *
+ * Exits with a non-zero status when a kernel differs from the generic one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the host kernel sets are static */
+#include "../src/alist_kernels.c"
+
+enum { MAX_N = 256 };
+
+static uint32_t rng_state;
+
+static uint32_t rnd32(void)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static unsigned rnd(unsigned n)
+{
+    return rnd32() % n;
+}
+
+/* mostly full range values, with saturation corner cases and small ones */
+static int16_t rnd_s16(void)
+{
+    switch (rnd(6)) {
+    case 0: return -32768;
+    case 1: return 32767;
+    case 2: return (int16_t)rnd(64) - 32;
+    default: return (int16_t)rnd32();
+    }
+}
+
+static void rnd_fill(int16_t* dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+        dst[i] = rnd_s16();
+}
+
+/* FNV-1a */
+static uint32_t hash_bytes(uint32_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    while (size-- != 0)
+        hash = (hash ^ *bytes++) * 0x01000193;
+
+    return hash;
+}
+
+/* Each test draws its operands from the seeded generator, so two kernel
+ * sets see the same operands, and returns the hash of the results. */
+typedef uint32_t (*kernel_test_t)(const struct alist_kernels* k);
+
+static uint32_t test_mix(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+    int16_t gain = rnd_s16();
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    k->mix(dst, src, n, gain);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_mix_gains(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N], gains[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    rnd_fill(gains, sizeof(gains) / sizeof(gains[0]));
+    k->mix_gains(dst, src, gains, n);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_mult_q44(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+    int8_t gain = (int8_t)rnd(256);
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    k->mult_q44(dst, n, gain);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_add(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    k->add(dst, src, n);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_resample(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], taps[4 * MAX_N], coefs[4 * MAX_N];
+    size_t n = rnd(MAX_N + 1);
+
+    rnd_fill(taps, sizeof(taps) / sizeof(taps[0]));
+    rnd_fill(coefs, sizeof(coefs) / sizeof(coefs[0]));
+    k->resample(dst, taps, coefs, n);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_envmix_nead(const struct alist_kernels* k)
+{
+    int16_t dl[MAX_N], dr[MAX_N], wl[MAX_N], wr[MAX_N], in[MAX_N];
+    uint16_t env_values[3], env_steps[3];
+    int16_t xors[4];
+    size_t n = 8 * rnd(MAX_N / 8 + 1);
+    uint32_t hash = 0x811c9dc5;
+    unsigned i;
+
+    rnd_fill(dl, sizeof(dl) / sizeof(dl[0]));
+    rnd_fill(dr, sizeof(dr) / sizeof(dr[0]));
+    rnd_fill(wl, sizeof(wl) / sizeof(wl[0]));
+    rnd_fill(wr, sizeof(wr) / sizeof(wr[0]));
+    rnd_fill(in, sizeof(in) / sizeof(in[0]));
+    for (i = 0; i < 3; ++i) {
+        env_values[i] = (uint16_t)rnd32();
+        env_steps[i] = (uint16_t)rnd32();
+    }
+    for (i = 0; i < 4; ++i)
+        xors[i] = rnd(2) ? 0 : -1;
+
+    k->envmix_nead(dl, dr, wl, wr, in, n, env_values, env_steps, xors);
+
+    hash = hash_bytes(hash, dl, n * sizeof(dl[0]));
+    hash = hash_bytes(hash, dr, n * sizeof(dr[0]));
+    hash = hash_bytes(hash, wl, n * sizeof(wl[0]));
+    hash = hash_bytes(hash, wr, n * sizeof(wr[0]));
+    return hash_bytes(hash, env_values, sizeof(env_values));
+}
+
+static uint32_t test_polef(const struct alist_kernels* k)
+{
+    struct alist_polef_coefs coefs;
+    int16_t dst[8], frame[8], h2[8];
+    int16_t gain = rnd_s16();
+    int16_t l1 = rnd_s16();
+    int16_t l2 = rnd_s16();
+    unsigned i, j;
+
+    /* built as alist_polef does */
+    rnd_fill(coefs.h1, 8);
+    rnd_fill(coefs.h2, 8);
+    for (i = 0; i < 8; ++i)
+        h2[i] = ((int32_t)coefs.h2[i] * gain) >> 14;
+    for (i = 0; i < 8; ++i) {
+        for (j = 0; j < 8; ++j)
+            coefs.rows[i][j] = (j < i) ? h2[i - 1 - j] : 0;
+    }
+    coefs.gain = gain;
+    rnd_fill(frame, 8);
+
+    k->polef(dst, frame, &coefs, l1, l2);
+    return hash_bytes(0x811c9dc5, dst, sizeof(dst));
+}
+
+static uint32_t test_filter(const struct alist_kernels* k)
+{
+    int16_t dst[8], in1[8], in2[8], lut[8];
+
+    rnd_fill(in1, 8);
+    rnd_fill(in2, 8);
+    rnd_fill(lut, 8);
+    k->filter(dst, in1, in2, lut);
+    return hash_bytes(0x811c9dc5, dst, sizeof(dst));
+}
+
+static uint32_t test_mix_round(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+    int16_t gain = rnd_s16();
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    k->mix_round(dst, src, n, gain);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_mix_ramp(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+    int32_t env = (int32_t)rnd32();
+    int32_t step = rnd(2) ? (int32_t)rnd32() : (int32_t)rnd(0x20000) - 0x10000;
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    k->mix_ramp(dst, src, n, env, step);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_scale_u16(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+    uint16_t gain = (uint16_t)rnd32();
+
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    k->scale_u16(dst, src, n, gain);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_fir4(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N + 3], hcoeffs[4];
+    size_t n = rnd(MAX_N + 1);
+    int16_t hgain = rnd_s16();
+
+    rnd_fill(dst, sizeof(dst) / sizeof(dst[0]));
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    rnd_fill(hcoeffs, 4);
+    k->fir4(dst, src, n, hgain, hcoeffs);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_resample_sat(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], taps[4 * MAX_N], coefs[4 * MAX_N];
+    size_t n = rnd(MAX_N + 1);
+
+    rnd_fill(taps, sizeof(taps) / sizeof(taps[0]));
+    rnd_fill(coefs, sizeof(coefs) / sizeof(coefs[0]));
+    k->resample_sat(dst, taps, coefs, n);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_adpcm_predict(const struct alist_kernels* k)
+{
+    int16_t dst[2 * MAX_N];
+    uint8_t nibbles[MAX_N];
+    size_t n = rnd(MAX_N + 1);
+    unsigned int rshift = rnd(16);
+    size_t i;
+
+    for (i = 0; i < sizeof(nibbles); ++i)
+        nibbles[i] = (uint8_t)rnd32();
+
+    k->adpcm_predict(dst, nibbles, n, rshift);
+    return hash_bytes(0x811c9dc5, dst, 2 * n * sizeof(dst[0]));
+}
+
+static uint32_t test_adpcm_residuals(const struct alist_kernels* k)
+{
+    int16_t dst[MAX_N], src[MAX_N], book[16], last[2];
+    size_t n = 8 * rnd(MAX_N / 8 + 1);
+
+    rnd_fill(src, sizeof(src) / sizeof(src[0]));
+    rnd_fill(book, 16);
+    rnd_fill(last, 2);
+    k->adpcm_residuals(dst, src, book, last, n);
+    return hash_bytes(0x811c9dc5, dst, n * sizeof(dst[0]));
+}
+
+static uint32_t test_dewindow(const struct alist_kernels* k)
+{
+    /* 8 rows of x0 and x1 in either direction, and 8 rows of 64 window values */
+    int16_t x[2 * 8 * 32 + 64], w[8 * 64];
+    int32_t dst[16];
+    ptrdiff_t xstep = rnd(2) ? 32 : -32;
+    int alternate = rnd(2);
+    const int16_t* x0 = x + 8 * 32 + rnd(16);
+    const int16_t* x1 = x + 8 * 32 + rnd(16);
+
+    rnd_fill(x, sizeof(x) / sizeof(x[0]));
+    rnd_fill(w, sizeof(w) / sizeof(w[0]));
+    k->dewindow(dst, x0, x1, xstep, w, alternate);
+    return hash_bytes(0x811c9dc5, dst, sizeof(dst));
+}
+
+static const struct
+{
+    const char* name;
+    kernel_test_t test;
+} kernel_tests[] =
+{
+    { "mix",             test_mix },
+    { "mix_gains",       test_mix_gains },
+    { "mult_q44",        test_mult_q44 },
+    { "add",             test_add },
+    { "resample",        test_resample },
+    { "envmix_nead",     test_envmix_nead },
+    { "polef",           test_polef },
+    { "filter",          test_filter },
+    { "mix_round",       test_mix_round },
+    { "mix_ramp",        test_mix_ramp },
+    { "scale_u16",       test_scale_u16 },
+    { "fir4",            test_fir4 },
+    { "resample_sat",    test_resample_sat },
+    { "adpcm_predict",   test_adpcm_predict },
+    { "adpcm_residuals", test_adpcm_residuals },
+    { "dewindow",        test_dewindow }
+};
+
+int main(int argc, char** argv)
+{
+    const struct alist_kernels* sets[3];
+    size_t set_count = 0;
+    long iterations = (argc > 1) ? atol(argv[1]) : 5000;
+    size_t s, t;
+    long i;
+    int failures = 0;
+
+#if defined(ALIST_KERNELS_SSE2)
+    sets[set_count++] = &alist_kernels_sse2;
+#endif
+#if defined(ALIST_KERNELS_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        sets[set_count++] = &alist_kernels_avx2;
+#endif
+#if defined(ALIST_KERNELS_NEON)
+    sets[set_count++] = &alist_kernels_neon;
+#endif
+
+    if (set_count == 0) {
+        printf("only the generic kernels are built for this host\n");
+        return EXIT_SUCCESS;
+    }
+
+    for (s = 0; s < set_count; ++s) {
+        for (t = 0; t < sizeof(kernel_tests) / sizeof(kernel_tests[0]); ++t) {
+            for (i = 0; i < iterations; ++i) {
+                uint32_t seed = (uint32_t)(i * 2654435761u + t + 1);
+                uint32_t expected, actual;
+
+                rng_state = seed;
+                expected = kernel_tests[t].test(&alist_kernels_generic);
+                rng_state = seed;
+                actual = kernel_tests[t].test(sets[s]);
+
+                if (actual != expected) {
+                    printf("%s %s: hash %08x instead of %08x (seed %08x)\n",
+                           sets[s]->name, kernel_tests[t].name, actual, expected, seed);
+                    ++failures;
+                    break;
+                }
+            }
+        }
+
+        printf("%s kernels checked against generic ones\n", sets[s]->name);
+    }
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -22,7 +22,9 @@ endif
 
 LOCAL_SRC_FILES := \
     $(SRCDIR)/src/n64video.c \
+    $(SRCDIR)/src/n64video_capture.c \
     $(SRCDIR)/src/n64video_main.c \
+    $(SRCDIR)/src/n64video_parallel.c \
     $(SRCDIR)/src/n64video_vi.c \
     $(SRCDIR)/osal_dynamiclib_unix.c \
     $(SRCDIR)/main.c \
@@ -55,6 +55,9 @@ void InitializeConfigFunctions(m64p_dynlib_handle CoreLibHandle)
    }
 
    ConfigSetDefaultBool(l_ConfigAngrylion, "VIOverlay", 0, "Enable VI overlay filter");
+   ConfigSetDefaultInt(l_ConfigAngrylion, "NumWorkers", 0, "Number of rasterizer threads (0 = one per CPU core)");
+   ConfigSetDefaultBool(l_ConfigAngrylion, "RDPThread", 1, "Draw DP lists on a separate thread from the emulated CPU");
+   ConfigSetDefaultBool(l_ConfigAngrylion, "Compact240p", 0, "Hand 240p frames to the frontend as 640x240 instead of doubling their lines to 640x480");
 }
 
 //Ignore the handle, we have our own
@@ -74,3 +77,15 @@ EXPORT m64p_error CALL ConfigSetDefaultBool(m64p_handle handle, const char * par
 {
    return myConfigSetDefaultBool(l_ConfigAngrylion, param, defaultValue, description);
 }
+
+//Ignore the handle, we have our own
+EXPORT int CALL ConfigGetParamInt(m64p_handle handle, const char * string)
+{
+   return myConfigGetParamInt(l_ConfigAngrylion, string);
+}
+
+//Ignore the handle, we have our own
+EXPORT m64p_error CALL ConfigSetDefaultInt(m64p_handle handle, const char * param, int defaultValue, const char * description)
+{
+   return myConfigSetDefaultInt(l_ConfigAngrylion, param, defaultValue, description);
+}
@@ -0,0 +1,69 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-video-angrylion - capture.h                               *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This file is part of the angrylion RDP plugin, whose code comes       *
+ *   under the MAME license.  See "MAME License.txt" and CREDITS.txt       *
+ *   in the plugin's src directory for the terms and credits.              *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * RDP command stream capture, replayed headless by tools/angrylion-replay.c.
+ *
+ * A capture file is a capture_header followed by records, each one a
+ * uint32_t type, a uint32_t payload size in bytes and the payload.  All
+ * fields are in host byte order.
+ *
+ * CAPTURE_SNAPSHOT     RDRAM, hidden_bits (packed, see z64.h) and TMEM as
+ *                      the first DP list saw them; always the first record.
+ * CAPTURE_RDRAM        uint32_t offset, then the bytes the CPU changed there
+ *                      since the previous DP list.
+ * CAPTURE_COMMANDS     the complete commands of one DP list, as DP_FIFO words.
+ * CAPTURE_VI           the VI registers at scanout (CAPTURE_VI_REGS words)
+ *                      and the capture_hash() of the frame rdp_update() drew.
+ *
+ * Capturing starts from rdp_init(), so the replay never needs the rest of
+ * the RDP state.
+ */
+#define CAPTURE_MAGIC       0x50445241 /* "ARDP" */
+#define CAPTURE_VERSION     3
+
+enum {
+    CAPTURE_SNAPSHOT = 1,
+    CAPTURE_RDRAM,
+    CAPTURE_COMMANDS,
+    CAPTURE_VI
+};
+
+#define CAPTURE_VI_REGS     14
+
+struct capture_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rdram_size;
+    uint32_t overlay;
+    uint32_t compact_240p;
+};
+
+extern int capture_active;
+
+extern int capture_open(const char *path);
+extern void capture_close(void);
+
+extern void capture_begin_list(void);
+extern void capture_command(const void *words, int length);
+extern void capture_end_list(void);
+extern void capture_vi(void);
+
+/* VI_STATUS_REG through VI_Y_SCALE_REG, in GFX_INFO order */
+extern void capture_vi_registers(uint32_t *regs[CAPTURE_VI_REGS]);
+extern uint32_t capture_hash(const void *data, size_t size);
+
+#endif
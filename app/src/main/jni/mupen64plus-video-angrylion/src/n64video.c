@@ -1,5 +1,6 @@
 #include <stdarg.h>
 #include <string.h>
+#include <pthread.h>
 
 
 #include "z64.h"
@@ -7,6 +8,8 @@
 #include "tctables.h"
 #include "vi.h"
 #include "rdp.h"
+#include "parallel.h"
+#include "capture.h"
 
 #if 0
 #define EXTRALOGGING
@@ -129,62 +132,144 @@ typedef struct {
     uint8_t size;
 } TILE;
 
+struct rdp_state
+{
+    uint32_t worker_id;
+    uint32_t worker_num;
+    int cmd_cur;
+
+    int8_t get_dither_noise_type;
+    int scfield;
+    int sckeepodd;
+
+    int ti_format;
+    int ti_size;
+    int ti_width;
+    uint32_t ti_address;
+
+    int fb_format;
+    int fb_size;
+    int fb_width;
+    uint32_t fb_address;
+    uint32_t zb_address;
+
+    uint32_t max_level;
+    int32_t min_level;
+    int16_t primitive_lod_frac;
+
+    uint32_t primitive_z;
+    uint16_t primitive_delta_z;
+
+    uint32_t fill_color;
+
+    int16_t *combiner_rgbsub_a_r[2];
+    int16_t *combiner_rgbsub_a_g[2];
+    int16_t *combiner_rgbsub_a_b[2];
+    int16_t *combiner_rgbsub_b_r[2];
+    int16_t *combiner_rgbsub_b_g[2];
+    int16_t *combiner_rgbsub_b_b[2];
+    int16_t *combiner_rgbmul_r[2];
+    int16_t *combiner_rgbmul_g[2];
+    int16_t *combiner_rgbmul_b[2];
+    int16_t *combiner_rgbadd_r[2];
+    int16_t *combiner_rgbadd_g[2];
+    int16_t *combiner_rgbadd_b[2];
+
+    int16_t *combiner_alphasub_a[2];
+    int16_t *combiner_alphasub_b[2];
+    int16_t *combiner_alphamul[2];
+    int16_t *combiner_alphaadd[2];
+
+    int16_t *blender1a_r[2];
+    int16_t *blender1a_g[2];
+    int16_t *blender1a_b[2];
+    int16_t *blender1b_a[2];
+    int16_t *blender2a_r[2];
+    int16_t *blender2a_g[2];
+    int16_t *blender2a_b[2];
+    int16_t *blender2b_a[2];
+
+    int32_t k0_tf, k1_tf, k2_tf, k3_tf;
+    int16_t k4, k5;
+
+    TILE tile[8];
+
+    OTHER_MODES other_modes;
+    COMBINE_MODES combine;
+
+    COLOR key_width;
+    COLOR key_scale;
+    COLOR key_center;
+    COLOR fog_color;
+    COLOR blend_color;
+    COLOR prim_color;
+    COLOR env_color;
+
+    RECTANGLE __clip;
+
+    void (*fbread1_ptr)(struct rdp_state *, uint32_t, uint32_t*);
+    void (*fbread2_ptr)(struct rdp_state *, uint32_t, uint32_t*);
+    void (*fbwrite_ptr)(struct rdp_state *,
+        uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+    void (*render_spans_1cycle_ptr)(struct rdp_state *, int, int, int, int);
+    void (*render_spans_2cycle_ptr)(struct rdp_state *, int, int, int, int);
+
+    int blshifta, blshiftb, pastblshifta, pastblshiftb;
+    int32_t pastrawdzmem;
+    int32_t iseed;
+
+    /* scanlines split between workers, see span_lines_split() */
+    uint32_t span_rand;
+    int span_rand_shift;
+    int span_flip;
+    uint32_t carry_worker;
+
+    /* primitive left for worker 0 to draw alone, see rdp_flush_batch() */
+    int deferred;
+    int deferred_start, deferred_end, deferred_tilenum, deferred_flip;
+    int batch_resume;
+
+    /* edgewalker carries between subscanlines (and primitives) */
+    int minmax[2];
+    int maxxmx, minxhx;
+
+    ALIGNED SPAN span[1024];
+    uint8_t cvgbuf[1024];
+
+    ALIGNED int32_t spans_d_rgba[4];
+    ALIGNED int32_t spans_d_stwz[4];
+    uint16_t spans_dzpix;
+
+    ALIGNED int32_t spans_d_rgba_dy[4];
+    ALIGNED int32_t spans_cd_rgba[4];
+    int spans_cdz;
+
+    ALIGNED int32_t spans_d_stwz_dy[4];
+
+    COLOR combined_color;
+    COLOR texel0_color;
+    COLOR texel1_color;
+    COLOR nexttexel_color;
+    COLOR shade_color;
+    int16_t noise;
+
+    COLOR pixel_color;
+    COLOR inv_pixel_color;
+    COLOR blended_pixel_color;
+    COLOR memory_color;
+    COLOR pre_memory_color;
+
+    int16_t lod_frac;
+
+    uint8_t __TMEM[0x1000];
+};
+
 #ifdef _DEBUG
 static int render_cycle_mode_counts[4];
 #endif
 
-STRICTINLINE int32_t irand(void);
-
-static int8_t get_dither_noise_type;
-static int scfield;
-static int sckeepodd;
-
-static int ti_format;
-static int ti_size;
-static int ti_width;
-static uint32_t ti_address;
-
-static int fb_format;
-static int fb_size;
-static int fb_width;
-static uint32_t fb_address;
-static uint32_t zb_address;
-
-static uint32_t max_level;
-static int32_t min_level;
-static int16_t primitive_lod_frac;
-
-static uint32_t primitive_z;
-static uint16_t primitive_delta_z;
-
-static uint32_t fill_color;
-
-static int16_t *combiner_rgbsub_a_r[2];
-static int16_t *combiner_rgbsub_a_g[2];
-static int16_t *combiner_rgbsub_a_b[2];
-static int16_t *combiner_rgbsub_b_r[2];
-static int16_t *combiner_rgbsub_b_g[2];
-static int16_t *combiner_rgbsub_b_b[2];
-static int16_t *combiner_rgbmul_r[2];
-static int16_t *combiner_rgbmul_g[2];
-static int16_t *combiner_rgbmul_b[2];
-static int16_t *combiner_rgbadd_r[2];
-static int16_t *combiner_rgbadd_g[2];
-static int16_t *combiner_rgbadd_b[2];
-
-static int16_t *combiner_alphasub_a[2];
-static int16_t *combiner_alphasub_b[2];
-static int16_t *combiner_alphamul[2];
-static int16_t *combiner_alphaadd[2];
-
-static int16_t *blender1a_r[2];
-static int16_t *blender1a_g[2];
-static int16_t *blender1a_b[2];
-static int16_t *blender1b_a[2];
-static int16_t *blender2a_r[2];
-static int16_t *blender2a_g[2];
-static int16_t *blender2a_b[2];
-static int16_t *blender2b_a[2];
+static STRICTINLINE int32_t irand(struct rdp_state *rdp);
+static STRICTINLINE void irand_skip(struct rdp_state *rdp, uint32_t count);
 
 #define COLOR_RED(val)       (val.col[0])
 #define COLOR_GREEN(val)     (val.col[1])
@@ -200,61 +285,71 @@ static int16_t *blender2b_a[2];
 #define TRELATIVE(x, y)     ((x) - ((y) << 3));
 #define UPPER ((sfrac + tfrac) & 0x20)
 
-static int32_t k0_tf = 0, k1_tf = 0, k2_tf = 0, k3_tf = 0;
-static int16_t k4 = 0, k5 = 0;
-
-static TILE tile[8];
-
-static OTHER_MODES other_modes;
-static COMBINE_MODES combine;
-
-static COLOR key_width;
-static COLOR key_scale;
-static COLOR key_center;
-static COLOR fog_color;
-static COLOR blend_color;
-static COLOR prim_color;
-static COLOR env_color;
-
 static int rdp_pipeline_crashed;
 
-static RECTANGLE __clip = {
-    0, 0, 0x2000, 0x2000
-};
-
-static void fbread_4(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread_8(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread_16(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread_32(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_4(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_8(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_16(uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_32(uint32_t num, uint32_t* curpixel_memcvg);
-
-static void (*fbread_func[4])(uint32_t, uint32_t*) = {
+/*
+ * one complete copy of the RDP state per rasterizer worker:  every worker
+ * replays the whole command stream but only draws the scanlines it owns
+ */
+static struct rdp_state rdp_states[PARALLEL_MAX_WORKERS];
+static uint32_t rdp_num_workers = 1;
+
+int rdp_fifo_threaded = 1;
+static void rdp_fifo_open(void);
+static void rdp_fifo_close(void);
+
+static void fbread_4(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread_8(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread_16(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread_32(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread2_4(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread2_8(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread2_16(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+static void fbread2_32(struct rdp_state *rdp, uint32_t num, uint32_t* curpixel_memcvg);
+
+static void (*fbread_func[4])(struct rdp_state *, uint32_t, uint32_t*) = {
     fbread_4, fbread_8, fbread_16, fbread_32
 };
-static void (*fbread2_func[4])(uint32_t, uint32_t*) = {
+static void (*fbread2_func[4])(struct rdp_state *, uint32_t, uint32_t*) = {
     fbread2_4, fbread2_8, fbread2_16, fbread2_32
 };
 
-void (*fbread1_ptr)(uint32_t, uint32_t*);
-void (*fbread2_ptr)(uint32_t, uint32_t*);
-void (*fbwrite_ptr)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+/*
+ * Stores the hidden bits selected by mask in hidden_bits[index].  Adjacent
+ * scanlines can belong to different workers and still share a byte, so with
+ * more than one worker the update has to be atomic.
+ */
+static STRICTINLINE void hidden_bits_store(uint32_t index, uint32_t hval, uint32_t mask)
+{
+    uint8_t *const bits = &hidden_bits[index];
+    uint8_t old = __atomic_load_n(bits, __ATOMIC_RELAXED);
+
+    if ((old & mask) == hval)
+        return;
+    if (rdp_num_workers == 1)
+        *bits = (old & ~mask) | hval;
+    else
+        while (!__atomic_compare_exchange_n(bits, &old, (old & ~mask) | hval,
+            1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
 
 #define PAIRWRITE16(in, rval, hval) {            \
    (in) &= (RDRAM_MASK >> 1);	                   \
     if ((in) <= idxlim16) {                      \
         rdram_16[(in) ^ WORD_ADDR_XOR] = (rval); \
-        hidden_bits[(in)] = (hval);              \
+        hidden_bits_store((in) >> 2,             \
+            (hval) << HIDDEN_BITS_SHIFT(in),     \
+            3 << HIDDEN_BITS_SHIFT(in));         \
     }                                            \
 }
 #define PAIRWRITE32(in, rval, hval0, hval1) {    \
    (in) &= (RDRAM_MASK >> 2);                    \
     if ((in) <= idxlim32) {                      \
         rdram[(in)] = (rval);                    \
-        hidden_bits[(in) << 1] = (hval0);        \
-        hidden_bits[((in) << 1) + 1] = (hval1);  \
+        hidden_bits_store((in) >> 1,             \
+            ((hval0) | (hval1) << 2)             \
+                << HIDDEN_BITS_SHIFT((in) << 1), \
+            15 << HIDDEN_BITS_SHIFT((in) << 1)); \
     }                                            \
 }
 #define PAIRWRITE8(in, rval, hval) {             \
@@ -262,7 +357,9 @@ void (*fbwrite_ptr)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
     if ((in) <= plim) {                          \
         rdram_8[(in) ^ BYTE_ADDR_XOR] = (rval);  \
         if ((in) & 1)                            \
-            hidden_bits[(in) >> 1] = (hval);     \
+            hidden_bits_store((in) >> 3,         \
+                (hval) << HIDDEN_BITS_SHIFT((in) >> 1), \
+                3 << HIDDEN_BITS_SHIFT((in) >> 1)); \
     }                                            \
 }
 
@@ -270,22 +367,6 @@ uint32_t internal_vi_v_current_line = 0;
 uint32_t old_vi_origin = 0;
 uint32_t oldhstart = 0;
 uint32_t oldsomething = 0;
-int blshifta = 0, blshiftb = 0, pastblshifta = 0, pastblshiftb = 0;
-int32_t pastrawdzmem = 0;
-int32_t iseed = 1;
-
-static SPAN span[1024];
-uint8_t cvgbuf[1024];
-
-static int32_t spans_d_rgba[4];
-static int32_t spans_d_stwz[4];
-static uint16_t spans_dzpix;
-
-static int32_t spans_d_rgba_dy[4];
-static int32_t spans_cd_rgba[4];
-static int spans_cdz;
-
-static int32_t spans_d_stwz_dy[4];
 
 typedef struct
 {
@@ -308,28 +389,14 @@ typedef struct
 #define ZMODE_TRANSPARENT        2
 #define ZMODE_DECAL                3
 
-COLOR combined_color;
-COLOR texel0_color;
-COLOR texel1_color;
-COLOR nexttexel_color;
-COLOR shade_color;
-static int16_t noise = 0;
 static int16_t one_color = 0x100;
 static int16_t zero_color = 0x00;
 
 static int16_t blenderone    = 0xff;
 
-COLOR pixel_color;
-COLOR inv_pixel_color;
-COLOR blended_pixel_color;
-COLOR memory_color;
-COLOR pre_memory_color;
-
 int oldscyl = 0;
 
-uint8_t __TMEM[0x1000]; 
-
-#define tlut ((uint16_t*)(&__TMEM[0x800]))
+#define tlut ((uint16_t*)(&rdp->__TMEM[0x800]))
 
 #define PIXELS_TO_BYTES(pix, siz) (((pix) << (siz)) >> 1)
 
@@ -343,7 +410,6 @@ typedef struct{
     int onelessthanmid;
 }SPANSIGS;
 
-static int16_t lod_frac = 0;
 struct {uint32_t shift; uint32_t add;} z_dec_table[8] = {
      6, 0x00000,
      5, 0x20000,
@@ -355,81 +421,75 @@ struct {uint32_t shift; uint32_t add;} z_dec_table[8] = {
      0, 0x3f800,
 };
 
-static void render_spans_1cycle_complete(int start, int end, int tilenum, int flip);
-static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int flip);
-static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip);
+static void render_spans_1cycle_complete(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
+static void render_spans_1cycle_notexel1(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
+static void render_spans_1cycle_notex(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
 
-static void (*render_spans_1cycle_func[3])(int, int, int, int) =
+static void (*render_spans_1cycle_func[3])(struct rdp_state *, int, int, int, int) =
 {
     render_spans_1cycle_notex, render_spans_1cycle_notexel1, render_spans_1cycle_complete
 };
 
-static void render_spans_2cycle_complete(int start, int end, int tilenum, int flip);
-static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int flip);
-static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int flip);
-static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip);
+static void render_spans_2cycle_complete(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
+static void render_spans_2cycle_notexelnext(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
+static void render_spans_2cycle_notexel1(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
+static void render_spans_2cycle_notex(struct rdp_state *rdp, int start, int end, int tilenum, int flip);
 
-static void (*render_spans_2cycle_func[4])(int, int, int, int) =
+static void (*render_spans_2cycle_func[4])(struct rdp_state *, int, int, int, int) =
 {
     render_spans_2cycle_notex, render_spans_2cycle_notexel1, render_spans_2cycle_notexelnext, render_spans_2cycle_complete
 };
 
-static void (*render_spans_1cycle_ptr)(int, int, int, int);
-
-static void (*render_spans_2cycle_ptr)(int start, int end, int tilenum, int flip);
-
-uint16_t z_com_table[0x40000];
-uint32_t z_complete_dec_table[0x4000];
+uint8_t z_com_table[0x80];
 uint8_t replicated_rgba[32];
 uint8_t special_9bit_clamptable[512];
 int16_t special_9bit_exttable[512];
 int8_t log2table[256];
 int32_t tcdiv_table[0x8000];
 uint8_t bldiv_hwaccurate_table[0x8000];
-uint16_t deltaz_comparator_lut[0x10000];
 
-static STRICTINLINE void tcmask(int32_t* S, int32_t* T, int32_t num)
+static STRICTINLINE void tcmask(struct rdp_state *rdp, int32_t* S, int32_t* T, int32_t num)
 {
     int32_t wrap;
     
     
 
-    if (tile[num].mask_s)
+    if (rdp->tile[num].mask_s)
     {
-        if (tile[num].ms)
+        if (rdp->tile[num].ms)
         {
-            wrap = *S >> tile[num].f.masksclamped;
+            wrap = *S >> rdp->tile[num].f.masksclamped;
             wrap &= 1;
             *S ^= (-wrap);
         }
-        *S &= tile[num].mask_s_maskbits;
+        *S &= rdp->tile[num].mask_s_maskbits;
     }
 
-    if (tile[num].mask_t)
+    if (rdp->tile[num].mask_t)
     {
-        if (tile[num].mt)
+        if (rdp->tile[num].mt)
         {
-            wrap = *T >> tile[num].f.masktclamped;
+            wrap = *T >> rdp->tile[num].f.masktclamped;
             wrap &= 1;
             *T ^= (-wrap);
         }
         
-        *T &= tile[num].mask_t_maskbits;
+        *T &= rdp->tile[num].mask_t_maskbits;
     }
 }
 
-static STRICTINLINE void tcmask_coupled(int32_t* S, int32_t* S1, int32_t* T, int32_t* T1, int32_t num)
+static STRICTINLINE void tcmask_coupled(struct rdp_state *rdp, int32_t* S, int32_t* S1, int32_t* T, int32_t* T1, int32_t num)
 {
     int32_t wrap;
     int32_t maskbits; 
     int32_t wrapthreshold; 
 
 
-    if (tile[num].mask_s)
+    if (rdp->tile[num].mask_s)
     {
-        if (tile[num].ms)
+        if (rdp->tile[num].ms)
         {
-            wrapthreshold = tile[num].f.masksclamped;
+            wrapthreshold = rdp->tile[num].f.masksclamped;
 
             wrap = (*S >> wrapthreshold) & 1;
             *S ^= (-wrap);
@@ -438,16 +498,16 @@ static STRICTINLINE void tcmask_coupled(int32_t* S, int32_t* S1, int32_t* T, int
             *S1 ^= (-wrap);
         }
 
-        maskbits = tile[num].mask_s_maskbits;
+        maskbits = rdp->tile[num].mask_s_maskbits;
         *S &= maskbits;
         *S1 &= maskbits;
     }
 
-    if (tile[num].mask_t)
+    if (rdp->tile[num].mask_t)
     {
-        if (tile[num].mt)
+        if (rdp->tile[num].mt)
         {
-            wrapthreshold = tile[num].f.masktclamped;
+            wrapthreshold = rdp->tile[num].f.masktclamped;
 
             wrap = (*T >> wrapthreshold) & 1;
             *T ^= (-wrap);
@@ -455,23 +515,23 @@ static STRICTINLINE void tcmask_coupled(int32_t* S, int32_t* S1, int32_t* T, int
             wrap = (*T1 >> wrapthreshold) & 1;
             *T1 ^= (-wrap);
         }
-        maskbits = tile[num].mask_t_maskbits;
+        maskbits = rdp->tile[num].mask_t_maskbits;
         *T &= maskbits;
         *T1 &= maskbits;
     }
 }
 
-static STRICTINLINE void tcmask_copy(int32_t* S, int32_t* S1, int32_t* S2, int32_t* S3, int32_t* T, int32_t num)
+static STRICTINLINE void tcmask_copy(struct rdp_state *rdp, int32_t* S, int32_t* S1, int32_t* S2, int32_t* S3, int32_t* T, int32_t num)
 {
     int32_t wrap;
     int32_t maskbits_s; 
     int32_t swrapthreshold; 
 
-    if (tile[num].mask_s)
+    if (rdp->tile[num].mask_s)
     {
-        if (tile[num].ms)
+        if (rdp->tile[num].ms)
         {
-            swrapthreshold = tile[num].f.masksclamped;
+            swrapthreshold = rdp->tile[num].f.masksclamped;
 
             wrap = (*S >> swrapthreshold) & 1;
             *S ^= (-wrap);
@@ -486,34 +546,34 @@ static STRICTINLINE void tcmask_copy(int32_t* S, int32_t* S1, int32_t* S2, int32
             *S3 ^= (-wrap);
         }
 
-        maskbits_s = tile[num].mask_s_maskbits;
+        maskbits_s = rdp->tile[num].mask_s_maskbits;
         *S &= maskbits_s;
         *S1 &= maskbits_s;
         *S2 &= maskbits_s;
         *S3 &= maskbits_s;
     }
 
-    if (tile[num].mask_t)
+    if (rdp->tile[num].mask_t)
     {
-        if (tile[num].mt)
+        if (rdp->tile[num].mt)
         {
-            wrap = *T >> tile[num].f.masktclamped; 
+            wrap = *T >> rdp->tile[num].f.masktclamped; 
             wrap &= 1;
             *T ^= (-wrap);
         }
 
-        *T &= tile[num].mask_t_maskbits;
+        *T &= rdp->tile[num].mask_t_maskbits;
     }
 }
 
 
-STRICTINLINE void tcshift_cycle(int32_t* S, int32_t* T, int32_t* maxs, int32_t* maxt, uint32_t num)
+STRICTINLINE void tcshift_cycle(struct rdp_state *rdp, int32_t* S, int32_t* T, int32_t* maxs, int32_t* maxt, uint32_t num)
 {
 
 
 
     int32_t coord = *S;
-    int32_t shifter = tile[num].shift_s;
+    int32_t shifter = rdp->tile[num].shift_s;
 
     if (shifter < 11)
     {
@@ -530,12 +590,12 @@ STRICTINLINE void tcshift_cycle(int32_t* S, int32_t* T, int32_t* maxs, int32_t*
     
 
     
-    *maxs = ((coord >> 3) >= tile[num].sh);
+    *maxs = ((coord >> 3) >= rdp->tile[num].sh);
     
     
 
     coord = *T;
-    shifter = tile[num].shift_t;
+    shifter = rdp->tile[num].shift_t;
 
     if (shifter < 11)
     {
@@ -548,14 +608,14 @@ STRICTINLINE void tcshift_cycle(int32_t* S, int32_t* T, int32_t* maxs, int32_t*
         coord = SIGN16(coord);
     }
     *T = coord; 
-    *maxt = ((coord >> 3) >= tile[num].th);
+    *maxt = ((coord >> 3) >= rdp->tile[num].th);
 }    
 
 
-STRICTINLINE void tcshift_copy(int32_t* S, int32_t* T, uint32_t num)
+STRICTINLINE void tcshift_copy(struct rdp_state *rdp, int32_t* S, int32_t* T, uint32_t num)
 {
     int32_t coord = *S;
-    int32_t shifter = tile[num].shift_s;
+    int32_t shifter = rdp->tile[num].shift_s;
 
     if (shifter < 11)
     {
@@ -570,7 +630,7 @@ STRICTINLINE void tcshift_copy(int32_t* S, int32_t* T, uint32_t num)
     *S = coord; 
 
     coord = *T;
-    shifter = tile[num].shift_t;
+    shifter = rdp->tile[num].shift_t;
 
     if (shifter < 11)
     {
@@ -586,11 +646,11 @@ STRICTINLINE void tcshift_copy(int32_t* S, int32_t* T, uint32_t num)
     
 }
 
-static STRICTINLINE void tcclamp_cycle(int32_t* S, int32_t* T, int32_t* SFRAC, int32_t* TFRAC, int32_t maxs, int32_t maxt, int32_t num)
+static STRICTINLINE void tcclamp_cycle(struct rdp_state *rdp, int32_t* S, int32_t* T, int32_t* SFRAC, int32_t* TFRAC, int32_t maxs, int32_t maxt, int32_t num)
 {
 
     int32_t locs = *S, loct = *T;
-    if (tile[num].f.clampens)
+    if (rdp->tile[num].f.clampens)
     {
         if (!(locs & 0x10000))
         {
@@ -598,7 +658,7 @@ static STRICTINLINE void tcclamp_cycle(int32_t* S, int32_t* T, int32_t* SFRAC, i
                 *S = (locs >> 5);
             else
             {
-                *S = tile[num].f.clampdiffs;
+                *S = rdp->tile[num].f.clampdiffs;
                 *SFRAC = 0;
             }
         }
@@ -611,7 +671,7 @@ static STRICTINLINE void tcclamp_cycle(int32_t* S, int32_t* T, int32_t* SFRAC, i
     else
         *S = (locs >> 5);
 
-    if (tile[num].f.clampent)
+    if (rdp->tile[num].f.clampent)
     {
         if (!(loct & 0x10000))
         {
@@ -619,7 +679,7 @@ static STRICTINLINE void tcclamp_cycle(int32_t* S, int32_t* T, int32_t* SFRAC, i
                 *T = (loct >> 5);
             else
             {
-                *T = tile[num].f.clampdifft;
+                *T = rdp->tile[num].f.clampdifft;
                 *TFRAC = 0;
             }
         }
@@ -633,17 +693,17 @@ static STRICTINLINE void tcclamp_cycle(int32_t* S, int32_t* T, int32_t* SFRAC, i
         *T = (loct >> 5);
 }
 
-static STRICTINLINE void tcclamp_cycle_light(int32_t* S, int32_t* T, int32_t maxs, int32_t maxt, int32_t num)
+static STRICTINLINE void tcclamp_cycle_light(struct rdp_state *rdp, int32_t* S, int32_t* T, int32_t maxs, int32_t maxt, int32_t num)
 {
     int32_t locs = *S, loct = *T;
-    if (tile[num].f.clampens)
+    if (rdp->tile[num].f.clampens)
     {
         if (!(locs & 0x10000))
         {
             if (!maxs)
                 *S = (locs >> 5);
             else
-                *S = tile[num].f.clampdiffs;
+                *S = rdp->tile[num].f.clampdiffs;
         }
         else
             *S = 0;
@@ -651,14 +711,14 @@ static STRICTINLINE void tcclamp_cycle_light(int32_t* S, int32_t* T, int32_t max
     else
         *S = (locs >> 5);
 
-    if (tile[num].f.clampent)
+    if (rdp->tile[num].f.clampent)
     {
         if (!(loct & 0x10000))
         {
             if (!maxt)
                 *T = (loct >> 5);
             else
-                *T = tile[num].f.clampdifft;
+                *T = rdp->tile[num].f.clampdifft;
         }
         else
             *T = 0;
@@ -667,24 +727,24 @@ static STRICTINLINE void tcclamp_cycle_light(int32_t* S, int32_t* T, int32_t max
         *T = (loct >> 5);
 }
 
-static void fbwrite_4(
+static void fbwrite_4(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbwrite_8(
+static void fbwrite_8(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbwrite_16(
+static void fbwrite_16(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbwrite_32(
+static void fbwrite_32(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void (*fbwrite_func[4])(
+static void (*fbwrite_func[4])(struct rdp_state *,
     uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t) = {
     fbwrite_4, fbwrite_8, fbwrite_16, fbwrite_32
 };
 
-static INLINE void SET_BLENDER_INPUT(int cycle, int which, int16_t **input_r, int16_t **input_g, int16_t **input_b, int16_t **input_a, int a, int b)
+static INLINE void SET_BLENDER_INPUT(struct rdp_state *rdp, int cycle, int which, int16_t **input_r, int16_t **input_g, int16_t **input_b, int16_t **input_a, int a, int b)
 {
 
     switch (a & 0x3)
@@ -693,40 +753,40 @@ static INLINE void SET_BLENDER_INPUT(int cycle, int which, int16_t **input_r, in
         {
             if (cycle == 0)
             {
-                *input_r = &COLOR_RED(pixel_color);
-                *input_g = &COLOR_GREEN(pixel_color);
-                *input_b = &COLOR_BLUE(pixel_color);
+                *input_r = &COLOR_RED(rdp->pixel_color);
+                *input_g = &COLOR_GREEN(rdp->pixel_color);
+                *input_b = &COLOR_BLUE(rdp->pixel_color);
             }
             else
             {
-                *input_r = &COLOR_RED(blended_pixel_color);
-                *input_g = &COLOR_GREEN(blended_pixel_color);
-                *input_b = &COLOR_BLUE(blended_pixel_color);
+                *input_r = &COLOR_RED(rdp->blended_pixel_color);
+                *input_g = &COLOR_GREEN(rdp->blended_pixel_color);
+                *input_b = &COLOR_BLUE(rdp->blended_pixel_color);
             }
             break;
         }
 
         case 1:
         {
-            *input_r = &COLOR_RED(memory_color);
-            *input_g = &COLOR_GREEN(memory_color);
-            *input_b = &COLOR_BLUE(memory_color);
+            *input_r = &COLOR_RED(rdp->memory_color);
+            *input_g = &COLOR_GREEN(rdp->memory_color);
+            *input_b = &COLOR_BLUE(rdp->memory_color);
             break;
         }
 
         case 2:
         {
-            *input_r = &COLOR_RED(blend_color);
-            *input_g = &COLOR_GREEN(blend_color);
-            *input_b = &COLOR_BLUE(blend_color);
+            *input_r = &COLOR_RED(rdp->blend_color);
+            *input_g = &COLOR_GREEN(rdp->blend_color);
+            *input_b = &COLOR_BLUE(rdp->blend_color);
             break;
         }
 
         case 3:
         {
-            *input_r = &COLOR_RED(fog_color);
-            *input_g = &COLOR_GREEN(fog_color);
-            *input_b = &COLOR_BLUE(fog_color);
+            *input_r = &COLOR_RED(rdp->fog_color);
+            *input_g = &COLOR_GREEN(rdp->fog_color);
+            *input_b = &COLOR_BLUE(rdp->fog_color);
             break;
         }
     }
@@ -736,13 +796,13 @@ static INLINE void SET_BLENDER_INPUT(int cycle, int which, int16_t **input_r, in
         switch (b & 0x3)
         {
            case 0:       
-              *input_a = &COLOR_ALPHA(pixel_color);
+              *input_a = &COLOR_ALPHA(rdp->pixel_color);
               break;
            case 1:
-              *input_a = &COLOR_ALPHA(fog_color);
+              *input_a = &COLOR_ALPHA(rdp->fog_color);
               break;
            case 2:
-              *input_a = &COLOR_ALPHA(shade_color);
+              *input_a = &COLOR_ALPHA(rdp->shade_color);
               break;
            case 3:
               *input_a = &zero_color;
@@ -754,10 +814,10 @@ static INLINE void SET_BLENDER_INPUT(int cycle, int which, int16_t **input_r, in
         switch (b & 0x3)
         {
             case 0: 
-               *input_a = &COLOR_ALPHA(inv_pixel_color);
+               *input_a = &COLOR_ALPHA(rdp->inv_pixel_color);
                break;
             case 1:
-               *input_a = &COLOR_ALPHA(memory_color);
+               *input_a = &COLOR_ALPHA(rdp->memory_color);
                break;
             case 2:
                *input_a = &blenderone;
@@ -769,182 +829,39 @@ static INLINE void SET_BLENDER_INPUT(int cycle, int which, int16_t **input_r, in
     }
 }
 
-static INLINE void calculate_clamp_diffs(uint32_t i)
+static INLINE void calculate_clamp_diffs(struct rdp_state *rdp, uint32_t i)
 {
-    tile[i].f.clampdiffs = ((tile[i].sh >> 2) - (tile[i].sl >> 2)) & 0x3ff;
-    tile[i].f.clampdifft = ((tile[i].th >> 2) - (tile[i].tl >> 2)) & 0x3ff;
+    rdp->tile[i].f.clampdiffs = ((rdp->tile[i].sh >> 2) - (rdp->tile[i].sl >> 2)) & 0x3ff;
+    rdp->tile[i].f.clampdifft = ((rdp->tile[i].th >> 2) - (rdp->tile[i].tl >> 2)) & 0x3ff;
 }
 
 
-static INLINE void calculate_tile_derivs(uint32_t i)
+static INLINE void calculate_tile_derivs(struct rdp_state *rdp, uint32_t i)
 {
-    tile[i].f.clampens = tile[i].cs || !tile[i].mask_s;
-    tile[i].f.clampent = tile[i].ct || !tile[i].mask_t;
-    tile[i].f.masksclamped = tile[i].mask_s <= 10 ? tile[i].mask_s : 10;
-    tile[i].f.masktclamped = tile[i].mask_t <= 10 ? tile[i].mask_t : 10;
-    tile[i].f.notlutswitch = (tile[i].format << 2) | tile[i].size;
-    tile[i].f.tlutswitch = (tile[i].size << 2) | ((tile[i].format + 2) & 3);
+    rdp->tile[i].f.clampens = rdp->tile[i].cs || !rdp->tile[i].mask_s;
+    rdp->tile[i].f.clampent = rdp->tile[i].ct || !rdp->tile[i].mask_t;
+    rdp->tile[i].f.masksclamped = rdp->tile[i].mask_s <= 10 ? rdp->tile[i].mask_s : 10;
+    rdp->tile[i].f.masktclamped = rdp->tile[i].mask_t <= 10 ? rdp->tile[i].mask_t : 10;
+    rdp->tile[i].f.notlutswitch = (rdp->tile[i].format << 2) | rdp->tile[i].size;
+    rdp->tile[i].f.tlutswitch = (rdp->tile[i].size << 2) | ((rdp->tile[i].format + 2) & 3);
 }
 
+/*
+ * Z values are stored as a 3-bit exponent, the count of leading ones in the
+ * top 7 bits of the 18-bit depth, over an 11-bit mantissa.  Only the exponent
+ * needs a table; the mantissa is a shift by z_dec_table[exponent].shift.
+ */
 static INLINE void z_build_com_table(void)
 {
-   int z;
-   uint16_t altmem = 0;
+   int i;
 
-   for (z = 0; z < 0x40000; z++)
+   for (i = 0; i < 0x80; i++)
    {
-      switch((z >> 11) & 0x7f)
-      {
-         case 0x00:
-         case 0x01:
-         case 0x02:
-         case 0x03:
-         case 0x04:
-         case 0x05:
-         case 0x06:
-         case 0x07:
-         case 0x08:
-         case 0x09:
-         case 0x0a:
-         case 0x0b:
-         case 0x0c:
-         case 0x0d:
-         case 0x0e:
-         case 0x0f:
-         case 0x10:
-         case 0x11:
-         case 0x12:
-         case 0x13:
-         case 0x14:
-         case 0x15:
-         case 0x16:
-         case 0x17:
-         case 0x18:
-         case 0x19:
-         case 0x1a:
-         case 0x1b:
-         case 0x1c:
-         case 0x1d:
-         case 0x1e:
-         case 0x1f:
-         case 0x20:
-         case 0x21:
-         case 0x22:
-         case 0x23:
-         case 0x24:
-         case 0x25:
-         case 0x26:
-         case 0x27:
-         case 0x28:
-         case 0x29:
-         case 0x2a:
-         case 0x2b:
-         case 0x2c:
-         case 0x2d:
-         case 0x2e:
-         case 0x2f:
-         case 0x30:
-         case 0x31:
-         case 0x32:
-         case 0x33:
-         case 0x34:
-         case 0x35:
-         case 0x36:
-         case 0x37:
-         case 0x38:
-         case 0x39:
-         case 0x3a:
-         case 0x3b:
-         case 0x3c:
-         case 0x3d:
-         case 0x3e:
-         case 0x3f:
-            altmem = (z >> 4) & 0x1ffc;
-            break;
-         case 0x40:
-         case 0x41:
-         case 0x42:
-         case 0x43:
-         case 0x44:
-         case 0x45:
-         case 0x46:
-         case 0x47:
-         case 0x48:
-         case 0x49:
-         case 0x4a:
-         case 0x4b:
-         case 0x4c:
-         case 0x4d:
-         case 0x4e:
-         case 0x4f:
-         case 0x50:
-         case 0x51:
-         case 0x52:
-         case 0x53:
-         case 0x54:
-         case 0x55:
-         case 0x56:
-         case 0x57:
-         case 0x58:
-         case 0x59:
-         case 0x5a:
-         case 0x5b:
-         case 0x5c:
-         case 0x5d:
-         case 0x5e:
-         case 0x5f:
-            altmem = ((z >> 3) & 0x1ffc) | 0x2000;
-            break;
-         case 0x60:
-         case 0x61:
-         case 0x62:
-         case 0x63:
-         case 0x64:
-         case 0x65:
-         case 0x66:
-         case 0x67:
-         case 0x68:
-         case 0x69:
-         case 0x6a:
-         case 0x6b:
-         case 0x6c:
-         case 0x6d:
-         case 0x6e:
-         case 0x6f:
-            altmem = ((z >> 2) & 0x1ffc) | 0x4000;
-            break;
-         case 0x70:
-         case 0x71:
-         case 0x72:
-         case 0x73:
-         case 0x74:
-         case 0x75:
-         case 0x76:
-         case 0x77:
-            altmem = ((z >> 1) & 0x1ffc) | 0x6000;
-            break;
-         case 0x78:
-         case 0x79:
-         case 0x7a:
-         case 0x7b:
-            altmem = (z & 0x1ffc) | 0x8000;
-            break;
-         case 0x7c:
-         case 0x7d:
-            altmem = ((z << 1) & 0x1ffc) | 0xa000;
-            break;
-         case 0x7e:
-            altmem = ((z << 2) & 0x1ffc) | 0xc000;
-            break;
-         case 0x7f:
-            altmem = ((z << 2) & 0x1ffc) | 0xe000;
-            break;
-         default:
-            DisplayError("z_build_com_table failed");
-            break;
-      }
+      int exponent = 0;
 
-      z_com_table[z] = altmem;
+      while (exponent < 7 && ((i << exponent) & 0x40))
+         exponent++;
+      z_com_table[i] = exponent;
    }
 }
 
@@ -971,8 +888,6 @@ static uint32_t vi_integer_sqrt(uint32_t a)
 static void precalculate_everything(void)
 {
     int ps[9];
-    uint32_t exponent;
-    uint32_t mantissa;
     int temppoint, tempslope; 
     int normout;
     int wnorm;
@@ -993,13 +908,6 @@ static void precalculate_everything(void)
 
     z_build_com_table();
 
-    for (i = 0; i < 0x4000; i++)
-    {
-        exponent = (i >> 11) & 7;
-        mantissa = i & 0x7ff;
-        z_complete_dec_table[i] = ((mantissa << z_dec_table[exponent].shift) + z_dec_table[exponent].add) & 0x3ffff;
-    }
-
     precalc_cvmask_derivatives();
 
     i = 0;
@@ -1092,75 +1000,77 @@ static void precalculate_everything(void)
         }
         bldiv_hwaccurate_table[i] = res;
     }
-
-    deltaz_comparator_lut[0] = 0;
-    for (i = 1; i < 0x10000; i++)
-    {
-       for (k = 15; k >= 0; k--)
-       {
-          if (i & (1 << k))
-          {
-             deltaz_comparator_lut[i] = 1 << k;
-             break;
-          }
-       }
-    }
 }
 
-void rdp_init(void)
+static void rdp_state_init(struct rdp_state *rdp, uint32_t worker_id, uint32_t worker_num)
 {
     int i;
 
-    fbread1_ptr = fbread_func[0];
-    fbread2_ptr = fbread2_func[0];
-    fbwrite_ptr = fbwrite_func[0];
-    render_spans_1cycle_ptr = render_spans_1cycle_func[2];
-    render_spans_2cycle_ptr = render_spans_2cycle_func[1];
-
-    combiner_rgbsub_a_r[0] = combiner_rgbsub_a_r[1] = &one_color;
-    combiner_rgbsub_a_g[0] = combiner_rgbsub_a_g[1] = &one_color;
-    combiner_rgbsub_a_b[0] = combiner_rgbsub_a_b[1] = &one_color;
-    combiner_rgbsub_b_r[0] = combiner_rgbsub_b_r[1] = &one_color;
-    combiner_rgbsub_b_g[0] = combiner_rgbsub_b_g[1] = &one_color;
-    combiner_rgbsub_b_b[0] = combiner_rgbsub_b_b[1] = &one_color;
-    combiner_rgbmul_r[0] = combiner_rgbmul_r[1] = &one_color;
-    combiner_rgbmul_g[0] = combiner_rgbmul_g[1] = &one_color;
-    combiner_rgbmul_b[0] = combiner_rgbmul_b[1] = &one_color;
-    combiner_rgbadd_r[0] = combiner_rgbadd_r[1] = &one_color;
-    combiner_rgbadd_g[0] = combiner_rgbadd_g[1] = &one_color;
-    combiner_rgbadd_b[0] = combiner_rgbadd_b[1] = &one_color;
-
-    combiner_alphasub_a[0] = combiner_alphasub_a[1] = &one_color;
-    combiner_alphasub_b[0] = combiner_alphasub_b[1] = &one_color;
-    combiner_alphamul[0] = combiner_alphamul[1] = &one_color;
-    combiner_alphaadd[0] = combiner_alphaadd[1] = &one_color;
-
-    SET_BLENDER_INPUT(0, 0, &blender1a_r[0], &blender1a_g[0], &blender1a_b[0],
-                      &blender1b_a[0], 0, 0);
-    SET_BLENDER_INPUT(0, 1, &blender2a_r[0], &blender2a_g[0], &blender2a_b[0],
-                      &blender2b_a[0], 0, 0);
-    SET_BLENDER_INPUT(1, 0, &blender1a_r[1], &blender1a_g[1], &blender1a_b[1],
-                      &blender1b_a[1], 0, 0);
-    SET_BLENDER_INPUT(1, 1, &blender2a_r[1], &blender2a_g[1], &blender2a_b[1],
-                      &blender2b_a[1], 0, 0);
-    other_modes.f.stalederivs = 1;
-    memset(__TMEM, 0, 0x1000);
-
-    for (i = 0; i < sizeof(hidden_bits); i++)
-        hidden_bits[i] = 0x03;
-
-    memset(tile, 0, sizeof(tile));
+    memset(rdp, 0, sizeof(*rdp));
+    rdp->worker_id = worker_id;
+    rdp->worker_num = worker_num;
+    rdp->__clip.xh = 0x2000;
+    rdp->__clip.yh = 0x2000;
+    rdp->iseed = 1;
+
+    rdp->fbread1_ptr = fbread_func[0];
+    rdp->fbread2_ptr = fbread2_func[0];
+    rdp->fbwrite_ptr = fbwrite_func[0];
+    rdp->render_spans_1cycle_ptr = render_spans_1cycle_func[2];
+    rdp->render_spans_2cycle_ptr = render_spans_2cycle_func[1];
+
+    rdp->combiner_rgbsub_a_r[0] = rdp->combiner_rgbsub_a_r[1] = &one_color;
+    rdp->combiner_rgbsub_a_g[0] = rdp->combiner_rgbsub_a_g[1] = &one_color;
+    rdp->combiner_rgbsub_a_b[0] = rdp->combiner_rgbsub_a_b[1] = &one_color;
+    rdp->combiner_rgbsub_b_r[0] = rdp->combiner_rgbsub_b_r[1] = &one_color;
+    rdp->combiner_rgbsub_b_g[0] = rdp->combiner_rgbsub_b_g[1] = &one_color;
+    rdp->combiner_rgbsub_b_b[0] = rdp->combiner_rgbsub_b_b[1] = &one_color;
+    rdp->combiner_rgbmul_r[0] = rdp->combiner_rgbmul_r[1] = &one_color;
+    rdp->combiner_rgbmul_g[0] = rdp->combiner_rgbmul_g[1] = &one_color;
+    rdp->combiner_rgbmul_b[0] = rdp->combiner_rgbmul_b[1] = &one_color;
+    rdp->combiner_rgbadd_r[0] = rdp->combiner_rgbadd_r[1] = &one_color;
+    rdp->combiner_rgbadd_g[0] = rdp->combiner_rgbadd_g[1] = &one_color;
+    rdp->combiner_rgbadd_b[0] = rdp->combiner_rgbadd_b[1] = &one_color;
+
+    rdp->combiner_alphasub_a[0] = rdp->combiner_alphasub_a[1] = &one_color;
+    rdp->combiner_alphasub_b[0] = rdp->combiner_alphasub_b[1] = &one_color;
+    rdp->combiner_alphamul[0] = rdp->combiner_alphamul[1] = &one_color;
+    rdp->combiner_alphaadd[0] = rdp->combiner_alphaadd[1] = &one_color;
+
+    SET_BLENDER_INPUT(rdp, 0, 0, &rdp->blender1a_r[0], &rdp->blender1a_g[0], &rdp->blender1a_b[0],
+                      &rdp->blender1b_a[0], 0, 0);
+    SET_BLENDER_INPUT(rdp, 0, 1, &rdp->blender2a_r[0], &rdp->blender2a_g[0], &rdp->blender2a_b[0],
+                      &rdp->blender2b_a[0], 0, 0);
+    SET_BLENDER_INPUT(rdp, 1, 0, &rdp->blender1a_r[1], &rdp->blender1a_g[1], &rdp->blender1a_b[1],
+                      &rdp->blender1b_a[1], 0, 0);
+    SET_BLENDER_INPUT(rdp, 1, 1, &rdp->blender2a_r[1], &rdp->blender2a_g[1], &rdp->blender2a_b[1],
+                      &rdp->blender2b_a[1], 0, 0);
+    rdp->other_modes.f.stalederivs = 1;
+    memset(rdp->__TMEM, 0, 0x1000);
+
+    memset(rdp->tile, 0, sizeof(rdp->tile));
     for (i = 0; i < 8; i++)
     {
-        calculate_tile_derivs(i);
-        calculate_clamp_diffs(i);
+        calculate_tile_derivs(rdp, i);
+        calculate_clamp_diffs(rdp, i);
     }
 
-    memset(&combined_color, 0, sizeof(COLOR));
-    memset(&prim_color, 0, sizeof(COLOR));
-    memset(&env_color, 0, sizeof(COLOR));
-    memset(&key_scale, 0, sizeof(COLOR));
-    memset(&key_center, 0, sizeof(COLOR));
+    memset(&rdp->combined_color, 0, sizeof(COLOR));
+    memset(&rdp->prim_color, 0, sizeof(COLOR));
+    memset(&rdp->env_color, 0, sizeof(COLOR));
+    memset(&rdp->key_scale, 0, sizeof(COLOR));
+    memset(&rdp->key_center, 0, sizeof(COLOR));
+}
+
+void rdp_init(void)
+{
+    uint32_t i;
+
+    rdp_num_workers = parallel_num_workers();
+    for (i = 0; i < rdp_num_workers; i++)
+        rdp_state_init(&rdp_states[i], i, rdp_num_workers);
+
+    memset(hidden_bits, 0xFF, sizeof(hidden_bits));
 
     rdp_pipeline_crashed = 0;
     memset(&onetimewarnings, 0, sizeof(onetimewarnings));
@@ -1182,41 +1092,43 @@ void rdp_init(void)
 
     rdram_8 = (uint8_t*)gfx_info.RDRAM;
     rdram_16 = (uint16_t*)gfx_info.RDRAM;
+
+    rdp_fifo_open();
 }
 
-static INLINE void SET_SUBA_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
+static INLINE void SET_SUBA_RGB_INPUT(struct rdp_state *rdp, int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
 {
     switch (code & 0xf)
     {
        case 0:
-          *input_r = &COLOR_RED(combined_color);
-          *input_g = &COLOR_GREEN(combined_color);
-          *input_b = &COLOR_BLUE(combined_color);
+          *input_r = &COLOR_RED(rdp->combined_color);
+          *input_g = &COLOR_GREEN(rdp->combined_color);
+          *input_b = &COLOR_BLUE(rdp->combined_color);
           break;
        case 1:
-          *input_r = &COLOR_RED(texel0_color);
-          *input_g = &COLOR_GREEN(texel0_color);
-          *input_b = &COLOR_BLUE(texel0_color);
+          *input_r = &COLOR_RED(rdp->texel0_color);
+          *input_g = &COLOR_GREEN(rdp->texel0_color);
+          *input_b = &COLOR_BLUE(rdp->texel0_color);
           break;
        case 2:
-          *input_r = &COLOR_RED(texel1_color);
-          *input_g = &COLOR_GREEN(texel1_color);
-          *input_b = &COLOR_BLUE(texel1_color);
+          *input_r = &COLOR_RED(rdp->texel1_color);
+          *input_g = &COLOR_GREEN(rdp->texel1_color);
+          *input_b = &COLOR_BLUE(rdp->texel1_color);
           break;
        case 3:
-          *input_r = &COLOR_RED(prim_color);
-          *input_g = &COLOR_GREEN(prim_color);
-          *input_b = &COLOR_BLUE(prim_color);
+          *input_r = &COLOR_RED(rdp->prim_color);
+          *input_g = &COLOR_GREEN(rdp->prim_color);
+          *input_b = &COLOR_BLUE(rdp->prim_color);
           break;
        case 4:
-          *input_r = &COLOR_RED(shade_color);
-          *input_g = &COLOR_GREEN(shade_color);
-          *input_b = &COLOR_BLUE(shade_color);
+          *input_r = &COLOR_RED(rdp->shade_color);
+          *input_g = &COLOR_GREEN(rdp->shade_color);
+          *input_b = &COLOR_BLUE(rdp->shade_color);
           break;
        case 5:
-          *input_r = &COLOR_RED(env_color);
-          *input_g = &COLOR_GREEN(env_color);
-          *input_b = &COLOR_BLUE(env_color);
+          *input_r = &COLOR_RED(rdp->env_color);
+          *input_g = &COLOR_GREEN(rdp->env_color);
+          *input_b = &COLOR_BLUE(rdp->env_color);
           break;
        case 6:
           *input_r = &one_color;
@@ -1224,9 +1136,9 @@ static INLINE void SET_SUBA_RGB_INPUT(int16_t **input_r, int16_t **input_g, int1
           *input_b = &one_color;
           break;
        case 7:
-          *input_r = &noise;
-          *input_g = &noise;
-          *input_b = &noise;
+          *input_r = &rdp->noise;
+          *input_g = &rdp->noise;
+          *input_b = &rdp->noise;
           break;
        case 8:
        case 9:
@@ -1243,49 +1155,49 @@ static INLINE void SET_SUBA_RGB_INPUT(int16_t **input_r, int16_t **input_g, int1
     }
 }
 
-static INLINE void SET_SUBB_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
+static INLINE void SET_SUBB_RGB_INPUT(struct rdp_state *rdp, int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
 {
     switch (code & 0xf)
     {
        case 0:
-          *input_r = &COLOR_RED(combined_color);
-          *input_g = &COLOR_GREEN(combined_color);
-          *input_b = &COLOR_BLUE(combined_color);
+          *input_r = &COLOR_RED(rdp->combined_color);
+          *input_g = &COLOR_GREEN(rdp->combined_color);
+          *input_b = &COLOR_BLUE(rdp->combined_color);
           break;
        case 1:
-          *input_r = &COLOR_RED(texel0_color);
-          *input_g = &COLOR_GREEN(texel0_color);
-          *input_b = &COLOR_BLUE(texel0_color);
+          *input_r = &COLOR_RED(rdp->texel0_color);
+          *input_g = &COLOR_GREEN(rdp->texel0_color);
+          *input_b = &COLOR_BLUE(rdp->texel0_color);
           break;
        case 2:
-          *input_r = &COLOR_RED(texel1_color);
-          *input_g = &COLOR_GREEN(texel1_color);
-          *input_b = &COLOR_BLUE(texel1_color);
+          *input_r = &COLOR_RED(rdp->texel1_color);
+          *input_g = &COLOR_GREEN(rdp->texel1_color);
+          *input_b = &COLOR_BLUE(rdp->texel1_color);
           break;
        case 3:
-          *input_r = &COLOR_RED(prim_color);
-          *input_g = &COLOR_GREEN(prim_color);
-          *input_b = &COLOR_BLUE(prim_color);
+          *input_r = &COLOR_RED(rdp->prim_color);
+          *input_g = &COLOR_GREEN(rdp->prim_color);
+          *input_b = &COLOR_BLUE(rdp->prim_color);
           break;
        case 4:
-          *input_r = &COLOR_RED(shade_color);
-          *input_g = &COLOR_GREEN(shade_color);
-          *input_b = &COLOR_BLUE(shade_color);
+          *input_r = &COLOR_RED(rdp->shade_color);
+          *input_g = &COLOR_GREEN(rdp->shade_color);
+          *input_b = &COLOR_BLUE(rdp->shade_color);
           break;
        case 5:
-          *input_r = &COLOR_RED(env_color);
-          *input_g = &COLOR_GREEN(env_color);
-          *input_b = &COLOR_BLUE(env_color);
+          *input_r = &COLOR_RED(rdp->env_color);
+          *input_g = &COLOR_GREEN(rdp->env_color);
+          *input_b = &COLOR_BLUE(rdp->env_color);
           break;
        case 6:
-          *input_r = &COLOR_RED(key_center);
-          *input_g = &COLOR_GREEN(key_center);
-          *input_b = &COLOR_BLUE(key_center);
+          *input_r = &COLOR_RED(rdp->key_center);
+          *input_g = &COLOR_GREEN(rdp->key_center);
+          *input_b = &COLOR_BLUE(rdp->key_center);
           break;
        case 7:
-          *input_r = &k4;
-          *input_g = &k4;
-          *input_b = &k4;
+          *input_r = &rdp->k4;
+          *input_g = &rdp->k4;
+          *input_b = &rdp->k4;
           break;
        case 8:
        case 9:
@@ -1302,89 +1214,89 @@ static INLINE void SET_SUBB_RGB_INPUT(int16_t **input_r, int16_t **input_g, int1
     }
 }
 
-static INLINE void SET_MUL_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
+static INLINE void SET_MUL_RGB_INPUT(struct rdp_state *rdp, int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
 {
     switch (code & 0x1f)
     {
        case 0:
-          *input_r = &COLOR_RED(combined_color);
-          *input_g = &COLOR_GREEN(combined_color);
-          *input_b = &COLOR_BLUE(combined_color);
+          *input_r = &COLOR_RED(rdp->combined_color);
+          *input_g = &COLOR_GREEN(rdp->combined_color);
+          *input_b = &COLOR_BLUE(rdp->combined_color);
           break;
        case 1:
-          *input_r = &COLOR_RED(texel0_color);
-          *input_g = &COLOR_GREEN(texel0_color);
-          *input_b = &COLOR_BLUE(texel0_color);
+          *input_r = &COLOR_RED(rdp->texel0_color);
+          *input_g = &COLOR_GREEN(rdp->texel0_color);
+          *input_b = &COLOR_BLUE(rdp->texel0_color);
           break;
        case 2:
-          *input_r = &COLOR_RED(texel1_color);
-          *input_g = &COLOR_GREEN(texel1_color);
-          *input_b = &COLOR_BLUE(texel1_color);
+          *input_r = &COLOR_RED(rdp->texel1_color);
+          *input_g = &COLOR_GREEN(rdp->texel1_color);
+          *input_b = &COLOR_BLUE(rdp->texel1_color);
           break;
        case 3:
-          *input_r = &COLOR_RED(prim_color);
-          *input_g = &COLOR_GREEN(prim_color);
-          *input_b = &COLOR_BLUE(prim_color);
+          *input_r = &COLOR_RED(rdp->prim_color);
+          *input_g = &COLOR_GREEN(rdp->prim_color);
+          *input_b = &COLOR_BLUE(rdp->prim_color);
           break;
        case 4:
-          *input_r = &COLOR_RED(shade_color);
-          *input_g = &COLOR_GREEN(shade_color);
-          *input_b = &COLOR_BLUE(shade_color);
+          *input_r = &COLOR_RED(rdp->shade_color);
+          *input_g = &COLOR_GREEN(rdp->shade_color);
+          *input_b = &COLOR_BLUE(rdp->shade_color);
           break;
        case 5:
-          *input_r = &COLOR_RED(env_color);
-          *input_g = &COLOR_GREEN(env_color);
-          *input_b = &COLOR_BLUE(env_color);
+          *input_r = &COLOR_RED(rdp->env_color);
+          *input_g = &COLOR_GREEN(rdp->env_color);
+          *input_b = &COLOR_BLUE(rdp->env_color);
           break;
        case 6:
-          *input_r = &COLOR_RED(key_scale);
-          *input_g = &COLOR_GREEN(key_scale);
-          *input_b = &COLOR_BLUE(key_scale);
+          *input_r = &COLOR_RED(rdp->key_scale);
+          *input_g = &COLOR_GREEN(rdp->key_scale);
+          *input_b = &COLOR_BLUE(rdp->key_scale);
           break;
        case 7:
-          *input_r = &COLOR_ALPHA(combined_color);
-          *input_g = &COLOR_ALPHA(combined_color);
-          *input_b = &COLOR_ALPHA(combined_color);
+          *input_r = &COLOR_ALPHA(rdp->combined_color);
+          *input_g = &COLOR_ALPHA(rdp->combined_color);
+          *input_b = &COLOR_ALPHA(rdp->combined_color);
           break;
        case 8:
-          *input_r = &COLOR_ALPHA(texel0_color);
-          *input_g = &COLOR_ALPHA(texel0_color);
-          *input_b = &COLOR_ALPHA(texel0_color);
+          *input_r = &COLOR_ALPHA(rdp->texel0_color);
+          *input_g = &COLOR_ALPHA(rdp->texel0_color);
+          *input_b = &COLOR_ALPHA(rdp->texel0_color);
           break;
        case 9:
-          *input_r = &COLOR_ALPHA(texel1_color);
-          *input_g = &COLOR_ALPHA(texel1_color);
-          *input_b = &COLOR_ALPHA(texel1_color);
+          *input_r = &COLOR_ALPHA(rdp->texel1_color);
+          *input_g = &COLOR_ALPHA(rdp->texel1_color);
+          *input_b = &COLOR_ALPHA(rdp->texel1_color);
           break;
        case 10:
-          *input_r = &COLOR_ALPHA(prim_color);
-          *input_g = &COLOR_ALPHA(prim_color);
-          *input_b = &COLOR_ALPHA(prim_color); 
+          *input_r = &COLOR_ALPHA(rdp->prim_color);
+          *input_g = &COLOR_ALPHA(rdp->prim_color);
+          *input_b = &COLOR_ALPHA(rdp->prim_color); 
           break;
        case 11:
-          *input_r = &COLOR_ALPHA(shade_color);
-          *input_g = &COLOR_ALPHA(shade_color);
-          *input_b = &COLOR_ALPHA(shade_color);
+          *input_r = &COLOR_ALPHA(rdp->shade_color);
+          *input_g = &COLOR_ALPHA(rdp->shade_color);
+          *input_b = &COLOR_ALPHA(rdp->shade_color);
           break;
        case 12:
-          *input_r = &COLOR_ALPHA(env_color);
-          *input_g = &COLOR_ALPHA(env_color);
-          *input_b = &COLOR_ALPHA(env_color);
+          *input_r = &COLOR_ALPHA(rdp->env_color);
+          *input_g = &COLOR_ALPHA(rdp->env_color);
+          *input_b = &COLOR_ALPHA(rdp->env_color);
           break;
        case 13:
-          *input_r = &lod_frac;
-          *input_g = &lod_frac;
-          *input_b = &lod_frac;
+          *input_r = &rdp->lod_frac;
+          *input_g = &rdp->lod_frac;
+          *input_b = &rdp->lod_frac;
           break;
        case 14:
-          *input_r = &primitive_lod_frac;
-          *input_g = &primitive_lod_frac;
-          *input_b = &primitive_lod_frac;
+          *input_r = &rdp->primitive_lod_frac;
+          *input_g = &rdp->primitive_lod_frac;
+          *input_b = &rdp->primitive_lod_frac;
           break;
        case 15:
-          *input_r = &k5;
-          *input_g = &k5;
-          *input_b = &k5;
+          *input_r = &rdp->k5;
+          *input_g = &rdp->k5;
+          *input_b = &rdp->k5;
           break;
        case 16:
        case 17:
@@ -1409,39 +1321,39 @@ static INLINE void SET_MUL_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16
     }
 }
 
-static INLINE void SET_ADD_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
+static INLINE void SET_ADD_RGB_INPUT(struct rdp_state *rdp, int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
 {
    switch (code & 0x7)
    {
       case 0:
-         *input_r = &COLOR_RED(combined_color);
-         *input_g = &COLOR_GREEN(combined_color);
-         *input_b = &COLOR_BLUE(combined_color);
+         *input_r = &COLOR_RED(rdp->combined_color);
+         *input_g = &COLOR_GREEN(rdp->combined_color);
+         *input_b = &COLOR_BLUE(rdp->combined_color);
          break;
       case 1:
-         *input_r = &COLOR_RED(texel0_color);
-         *input_g = &COLOR_GREEN(texel0_color);
-         *input_b = &COLOR_BLUE(texel0_color);
+         *input_r = &COLOR_RED(rdp->texel0_color);
+         *input_g = &COLOR_GREEN(rdp->texel0_color);
+         *input_b = &COLOR_BLUE(rdp->texel0_color);
          break;
       case 2:
-         *input_r = &COLOR_RED(texel1_color);
-         *input_g = &COLOR_GREEN(texel1_color);
-         *input_b = &COLOR_BLUE(texel1_color);
+         *input_r = &COLOR_RED(rdp->texel1_color);
+         *input_g = &COLOR_GREEN(rdp->texel1_color);
+         *input_b = &COLOR_BLUE(rdp->texel1_color);
          break;
       case 3:
-         *input_r = &COLOR_RED(prim_color);
-         *input_g = &COLOR_GREEN(prim_color);
-         *input_b = &COLOR_BLUE(prim_color);
+         *input_r = &COLOR_RED(rdp->prim_color);
+         *input_g = &COLOR_GREEN(rdp->prim_color);
+         *input_b = &COLOR_BLUE(rdp->prim_color);
          break;
       case 4:
-         *input_r = &COLOR_RED(shade_color);
-         *input_g = &COLOR_GREEN(shade_color);
-         *input_b = &COLOR_BLUE(shade_color);
+         *input_r = &COLOR_RED(rdp->shade_color);
+         *input_g = &COLOR_GREEN(rdp->shade_color);
+         *input_b = &COLOR_BLUE(rdp->shade_color);
          break;
       case 5:
-         *input_r = &COLOR_RED(env_color);
-         *input_g = &COLOR_GREEN(env_color);
-         *input_b = &COLOR_BLUE(env_color);
+         *input_r = &COLOR_RED(rdp->env_color);
+         *input_g = &COLOR_GREEN(rdp->env_color);
+         *input_b = &COLOR_BLUE(rdp->env_color);
          break;
       case 6:
          *input_r = &one_color;
@@ -1456,45 +1368,45 @@ static INLINE void SET_ADD_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16
    }
 }
 
-static INLINE void SET_SUB_ALPHA_INPUT(int16_t **input, int code)
+static INLINE void SET_SUB_ALPHA_INPUT(struct rdp_state *rdp, int16_t **input, int code)
 {
     switch (code & 0x7)
     {
-        case 0:        *input = &COLOR_ALPHA(combined_color); break;
-        case 1:        *input = &COLOR_ALPHA(texel0_color); break;
-        case 2:        *input = &COLOR_ALPHA(texel1_color); break;
-        case 3:        *input = &COLOR_ALPHA(prim_color); break;
-        case 4:        *input = &COLOR_ALPHA(shade_color); break;
-        case 5:        *input = &COLOR_ALPHA(env_color); break;
+        case 0:        *input = &COLOR_ALPHA(rdp->combined_color); break;
+        case 1:        *input = &COLOR_ALPHA(rdp->texel0_color); break;
+        case 2:        *input = &COLOR_ALPHA(rdp->texel1_color); break;
+        case 3:        *input = &COLOR_ALPHA(rdp->prim_color); break;
+        case 4:        *input = &COLOR_ALPHA(rdp->shade_color); break;
+        case 5:        *input = &COLOR_ALPHA(rdp->env_color); break;
         case 6:        *input = &one_color; break;
         case 7:        *input = &zero_color; break;
     }
 }
 
-static INLINE void SET_MUL_ALPHA_INPUT(int16_t **input, int code)
+static INLINE void SET_MUL_ALPHA_INPUT(struct rdp_state *rdp, int16_t **input, int code)
 {
     switch (code & 0x7)
     {
        case 0:
-          *input = &lod_frac;
+          *input = &rdp->lod_frac;
           break;
        case 1:
-          *input = &COLOR_ALPHA(texel0_color);
+          *input = &COLOR_ALPHA(rdp->texel0_color);
           break;
        case 2:
-          *input = &COLOR_ALPHA(texel1_color);
+          *input = &COLOR_ALPHA(rdp->texel1_color);
           break;
        case 3:
-          *input = &COLOR_ALPHA(prim_color);
+          *input = &COLOR_ALPHA(rdp->prim_color);
           break;
        case 4:
-          *input = &COLOR_ALPHA(shade_color);
+          *input = &COLOR_ALPHA(rdp->shade_color);
           break;
        case 5:
-          *input = &COLOR_ALPHA(env_color);
+          *input = &COLOR_ALPHA(rdp->env_color);
           break;
        case 6:
-          *input = &primitive_lod_frac;
+          *input = &rdp->primitive_lod_frac;
           break;
        case 7:
           *input = &zero_color;
@@ -1502,18 +1414,18 @@ static INLINE void SET_MUL_ALPHA_INPUT(int16_t **input, int code)
     }
 }
 
-static STRICTINLINE int alpha_compare(int32_t comb_alpha)
+static STRICTINLINE int alpha_compare(struct rdp_state *rdp, int32_t comb_alpha)
 {
     int32_t threshold;
 
-    if (!other_modes.alpha_compare_en)
+    if (!rdp->other_modes.alpha_compare_en)
         return 1;
     else
     {
-        if (!other_modes.dither_alpha_en)
-            threshold = COLOR_ALPHA(blend_color);
+        if (!rdp->other_modes.dither_alpha_en)
+            threshold = COLOR_ALPHA(rdp->blend_color);
         else
-            threshold = irand() & 0xff;
+            threshold = irand(rdp) & 0xff;
         if (comb_alpha >= threshold)
             return 1;
         else
@@ -1550,156 +1462,156 @@ static STRICTINLINE int32_t CLIP(int32_t value,int32_t min,int32_t max)
     return value;
 }
 
-static void combiner_1cycle(int adseed, uint32_t* curpixel_cvg)
+static void combiner_1cycle(struct rdp_state *rdp, int adseed, uint32_t* curpixel_cvg)
 {
     int32_t temp_combined_color[3];
     int32_t redkey, greenkey, bluekey, temp;
-    COLOR chromabypass;
-    int32_t keyalpha;
+    COLOR chromabypass = {{ 0 }};
+    int32_t keyalpha = 0;
 
-    if (other_modes.key_en)
+    if (rdp->other_modes.key_en)
     {
-       COLOR_RED(chromabypass)   = *combiner_rgbsub_a_r[1];
-       COLOR_GREEN(chromabypass) = *combiner_rgbsub_a_g[1];
-       COLOR_BLUE(chromabypass)  = *combiner_rgbsub_a_b[1];
+       COLOR_RED(chromabypass)   = *rdp->combiner_rgbsub_a_r[1];
+       COLOR_GREEN(chromabypass) = *rdp->combiner_rgbsub_a_g[1];
+       COLOR_BLUE(chromabypass)  = *rdp->combiner_rgbsub_a_b[1];
     }
     
-    temp_combined_color[0] = color_combiner_equation(*combiner_rgbsub_a_r[1],*combiner_rgbsub_b_r[1],*combiner_rgbmul_r[1],*combiner_rgbadd_r[1]);
-    temp_combined_color[1] = color_combiner_equation(*combiner_rgbsub_a_g[1],*combiner_rgbsub_b_g[1],*combiner_rgbmul_g[1],*combiner_rgbadd_g[1]);
-    temp_combined_color[2] = color_combiner_equation(*combiner_rgbsub_a_b[1],*combiner_rgbsub_b_b[1],*combiner_rgbmul_b[1],*combiner_rgbadd_b[1]);
-    COLOR_ALPHA(combined_color) = alpha_combiner_equation(*combiner_alphasub_a[1],*combiner_alphasub_b[1],*combiner_alphamul[1],*combiner_alphaadd[1]);
+    temp_combined_color[0] = color_combiner_equation(*rdp->combiner_rgbsub_a_r[1],*rdp->combiner_rgbsub_b_r[1],*rdp->combiner_rgbmul_r[1],*rdp->combiner_rgbadd_r[1]);
+    temp_combined_color[1] = color_combiner_equation(*rdp->combiner_rgbsub_a_g[1],*rdp->combiner_rgbsub_b_g[1],*rdp->combiner_rgbmul_g[1],*rdp->combiner_rgbadd_g[1]);
+    temp_combined_color[2] = color_combiner_equation(*rdp->combiner_rgbsub_a_b[1],*rdp->combiner_rgbsub_b_b[1],*rdp->combiner_rgbmul_b[1],*rdp->combiner_rgbadd_b[1]);
+    COLOR_ALPHA(rdp->combined_color) = alpha_combiner_equation(*rdp->combiner_alphasub_a[1],*rdp->combiner_alphasub_b[1],*rdp->combiner_alphamul[1],*rdp->combiner_alphaadd[1]);
 
-    COLOR_ALPHA(pixel_color) = special_9bit_clamptable[COLOR_ALPHA(combined_color)];
-    if (COLOR_ALPHA(pixel_color) == 0xff)
-        COLOR_ALPHA(pixel_color) = 0x100;
+    COLOR_ALPHA(rdp->pixel_color) = special_9bit_clamptable[COLOR_ALPHA(rdp->combined_color)];
+    if (COLOR_ALPHA(rdp->pixel_color) == 0xff)
+        COLOR_ALPHA(rdp->pixel_color) = 0x100;
 
-    if (!other_modes.key_en)
+    if (!rdp->other_modes.key_en)
     {
-        COLOR_RED(combined_color)     = temp_combined_color[0] >> 8;
-        COLOR_GREEN(combined_color)   = temp_combined_color[1] >> 8;
-        COLOR_BLUE(combined_color)    = temp_combined_color[2] >> 8;
-        COLOR_RED(pixel_color)        = special_9bit_clamptable[COLOR_RED(combined_color)];
-        COLOR_GREEN(pixel_color)      = special_9bit_clamptable[COLOR_GREEN(combined_color)];
-        COLOR_BLUE(pixel_color)       = special_9bit_clamptable[COLOR_BLUE(combined_color)];
+        COLOR_RED(rdp->combined_color)     = temp_combined_color[0] >> 8;
+        COLOR_GREEN(rdp->combined_color)   = temp_combined_color[1] >> 8;
+        COLOR_BLUE(rdp->combined_color)    = temp_combined_color[2] >> 8;
+        COLOR_RED(rdp->pixel_color)        = special_9bit_clamptable[COLOR_RED(rdp->combined_color)];
+        COLOR_GREEN(rdp->pixel_color)      = special_9bit_clamptable[COLOR_GREEN(rdp->combined_color)];
+        COLOR_BLUE(rdp->pixel_color)       = special_9bit_clamptable[COLOR_BLUE(rdp->combined_color)];
     }
     else
     {
         redkey = SIGN(temp_combined_color[0], 17);
         if (redkey >= 0)
-            redkey = (COLOR_RED(key_width) << 4) - redkey;
+            redkey = (COLOR_RED(rdp->key_width) << 4) - redkey;
         else
-            redkey = (COLOR_RED(key_width) << 4) + redkey;
+            redkey = (COLOR_RED(rdp->key_width) << 4) + redkey;
         greenkey = SIGN(temp_combined_color[1], 17);
         if (greenkey >= 0)
-            greenkey = (COLOR_GREEN(key_width) << 4) - greenkey;
+            greenkey = (COLOR_GREEN(rdp->key_width) << 4) - greenkey;
         else
-            greenkey = (COLOR_GREEN(key_width) << 4) + greenkey;
+            greenkey = (COLOR_GREEN(rdp->key_width) << 4) + greenkey;
         bluekey = SIGN(temp_combined_color[2], 17);
         if (bluekey >= 0)
-            bluekey = (COLOR_BLUE(key_width) << 4) - bluekey;
+            bluekey = (COLOR_BLUE(rdp->key_width) << 4) - bluekey;
         else
-            bluekey = (COLOR_BLUE(key_width) << 4) + bluekey;
+            bluekey = (COLOR_BLUE(rdp->key_width) << 4) + bluekey;
         keyalpha = (redkey < greenkey) ? redkey : greenkey;
         keyalpha = (bluekey < keyalpha) ? bluekey : keyalpha;
         keyalpha = CLIP(keyalpha, 0, 0xff);
 
         
-        COLOR_RED(pixel_color)   = special_9bit_clamptable[COLOR_RED(chromabypass)];
-        COLOR_GREEN(pixel_color) = special_9bit_clamptable[COLOR_GREEN(chromabypass)];
-        COLOR_BLUE(pixel_color)  = special_9bit_clamptable[COLOR_BLUE(chromabypass)];
+        COLOR_RED(rdp->pixel_color)   = special_9bit_clamptable[COLOR_RED(chromabypass)];
+        COLOR_GREEN(rdp->pixel_color) = special_9bit_clamptable[COLOR_GREEN(chromabypass)];
+        COLOR_BLUE(rdp->pixel_color)  = special_9bit_clamptable[COLOR_BLUE(chromabypass)];
 
-        COLOR_RED(combined_color)   = temp_combined_color[0] >> 8;
-        COLOR_GREEN(combined_color) = temp_combined_color[1] >> 8;
-        COLOR_BLUE(combined_color)  = temp_combined_color[2] >> 8;
+        COLOR_RED(rdp->combined_color)   = temp_combined_color[0] >> 8;
+        COLOR_GREEN(rdp->combined_color) = temp_combined_color[1] >> 8;
+        COLOR_BLUE(rdp->combined_color)  = temp_combined_color[2] >> 8;
     }
     
     
-    if (other_modes.cvg_times_alpha)
+    if (rdp->other_modes.cvg_times_alpha)
     {
-        temp = (COLOR_ALPHA(pixel_color) * (*curpixel_cvg) + 4) >> 3;
+        temp = (COLOR_ALPHA(rdp->pixel_color) * (*curpixel_cvg) + 4) >> 3;
         *curpixel_cvg = (temp >> 5) & 0xf;
     }
 
-    if (!other_modes.alpha_cvg_select)
+    if (!rdp->other_modes.alpha_cvg_select)
     {    
-        if (!other_modes.key_en)
+        if (!rdp->other_modes.key_en)
         {
-            COLOR_ALPHA(pixel_color) += adseed;
-            if (COLOR_ALPHA(pixel_color) & 0x100)
-                COLOR_ALPHA(pixel_color) = 0xff;
+            COLOR_ALPHA(rdp->pixel_color) += adseed;
+            if (COLOR_ALPHA(rdp->pixel_color) & 0x100)
+                COLOR_ALPHA(rdp->pixel_color) = 0xff;
         }
         else
-            COLOR_ALPHA(pixel_color) = keyalpha;
+            COLOR_ALPHA(rdp->pixel_color) = keyalpha;
     }
     else
     {
-        if (other_modes.cvg_times_alpha)
-            COLOR_ALPHA(pixel_color) = temp;
+        if (rdp->other_modes.cvg_times_alpha)
+            COLOR_ALPHA(rdp->pixel_color) = temp;
         else
-            COLOR_ALPHA(pixel_color) = (*curpixel_cvg) << 5;
-        if (COLOR_ALPHA(pixel_color) > 0xff)
-            COLOR_ALPHA(pixel_color) = 0xff;
+            COLOR_ALPHA(rdp->pixel_color) = (*curpixel_cvg) << 5;
+        if (COLOR_ALPHA(rdp->pixel_color) > 0xff)
+            COLOR_ALPHA(rdp->pixel_color) = 0xff;
     }
     
-    COLOR_ALPHA(shade_color) += adseed;
-    if (COLOR_ALPHA(shade_color) & 0x100)
-        COLOR_ALPHA(shade_color) = 0xff;
+    COLOR_ALPHA(rdp->shade_color) += adseed;
+    if (COLOR_ALPHA(rdp->shade_color) & 0x100)
+        COLOR_ALPHA(rdp->shade_color) = 0xff;
 }
 
-static void combiner_2cycle(int adseed, uint32_t* curpixel_cvg, int32_t* acalpha)
+static void combiner_2cycle(struct rdp_state *rdp, int adseed, uint32_t* curpixel_cvg, int32_t* acalpha)
 {
     int32_t temp_combined_color[3];
     int32_t redkey, greenkey, bluekey, temp;
-    COLOR chromabypass;
-    int32_t keyalpha;
+    COLOR chromabypass = {{ 0 }};
+    int32_t keyalpha = 0;
 
-    if (other_modes.key_en)
+    if (rdp->other_modes.key_en)
     {
-       COLOR_RED(chromabypass)   = *combiner_rgbsub_a_r[1];
-       COLOR_GREEN(chromabypass) = *combiner_rgbsub_a_g[1];
-       COLOR_BLUE(chromabypass)  = *combiner_rgbsub_a_b[1];
+       COLOR_RED(chromabypass)   = *rdp->combiner_rgbsub_a_r[1];
+       COLOR_GREEN(chromabypass) = *rdp->combiner_rgbsub_a_g[1];
+       COLOR_BLUE(chromabypass)  = *rdp->combiner_rgbsub_a_b[1];
     }
 
-    temp_combined_color[0] = color_combiner_equation(*combiner_rgbsub_a_r[0],*combiner_rgbsub_b_r[0],*combiner_rgbmul_r[0],*combiner_rgbadd_r[0]);
-    temp_combined_color[1] = color_combiner_equation(*combiner_rgbsub_a_g[0],*combiner_rgbsub_b_g[0],*combiner_rgbmul_g[0],*combiner_rgbadd_g[0]);
-    temp_combined_color[2] = color_combiner_equation(*combiner_rgbsub_a_b[0],*combiner_rgbsub_b_b[0],*combiner_rgbmul_b[0],*combiner_rgbadd_b[0]);
-    COLOR_ALPHA(combined_color) = alpha_combiner_equation(*combiner_alphasub_a[0],*combiner_alphasub_b[0],*combiner_alphamul[0],*combiner_alphaadd[0]);
+    temp_combined_color[0] = color_combiner_equation(*rdp->combiner_rgbsub_a_r[0],*rdp->combiner_rgbsub_b_r[0],*rdp->combiner_rgbmul_r[0],*rdp->combiner_rgbadd_r[0]);
+    temp_combined_color[1] = color_combiner_equation(*rdp->combiner_rgbsub_a_g[0],*rdp->combiner_rgbsub_b_g[0],*rdp->combiner_rgbmul_g[0],*rdp->combiner_rgbadd_g[0]);
+    temp_combined_color[2] = color_combiner_equation(*rdp->combiner_rgbsub_a_b[0],*rdp->combiner_rgbsub_b_b[0],*rdp->combiner_rgbmul_b[0],*rdp->combiner_rgbadd_b[0]);
+    COLOR_ALPHA(rdp->combined_color) = alpha_combiner_equation(*rdp->combiner_alphasub_a[0],*rdp->combiner_alphasub_b[0],*rdp->combiner_alphamul[0],*rdp->combiner_alphaadd[0]);
 
-    if (other_modes.alpha_compare_en)
+    if (rdp->other_modes.alpha_compare_en)
     {
         int32_t preacalpha;
-        if (other_modes.key_en)
+        if (rdp->other_modes.key_en)
         {
             redkey = SIGN(temp_combined_color[0], 17);
             if (redkey >= 0)
-                redkey = (COLOR_RED(key_width) << 4) - redkey;
+                redkey = (COLOR_RED(rdp->key_width) << 4) - redkey;
             else
-                redkey = (COLOR_RED(key_width) << 4) + redkey;
+                redkey = (COLOR_RED(rdp->key_width) << 4) + redkey;
             greenkey = SIGN(temp_combined_color[1], 17);
             if (greenkey >= 0)
-                greenkey = (COLOR_GREEN(key_width) << 4) - greenkey;
+                greenkey = (COLOR_GREEN(rdp->key_width) << 4) - greenkey;
             else
-                greenkey = (COLOR_GREEN(key_width) << 4) + greenkey;
+                greenkey = (COLOR_GREEN(rdp->key_width) << 4) + greenkey;
             bluekey = SIGN(temp_combined_color[2], 17);
             if (bluekey >= 0)
-                bluekey = (COLOR_BLUE(key_width) << 4) - bluekey;
+                bluekey = (COLOR_BLUE(rdp->key_width) << 4) - bluekey;
             else
-                bluekey = (COLOR_BLUE(key_width) << 4) + bluekey;
+                bluekey = (COLOR_BLUE(rdp->key_width) << 4) + bluekey;
             keyalpha = (redkey < greenkey) ? redkey : greenkey;
             keyalpha = (bluekey < keyalpha) ? bluekey : keyalpha;
             keyalpha = CLIP(keyalpha, 0, 0xff);
         }
 
-        preacalpha = special_9bit_clamptable[COLOR_ALPHA(combined_color)];
+        preacalpha = special_9bit_clamptable[COLOR_ALPHA(rdp->combined_color)];
         if (preacalpha == 0xff)
             preacalpha = 0x100;
 
-        if (other_modes.cvg_times_alpha)
+        if (rdp->other_modes.cvg_times_alpha)
             temp = (preacalpha * (*curpixel_cvg) + 4) >> 3;
 
-        if (!other_modes.alpha_cvg_select)
+        if (!rdp->other_modes.alpha_cvg_select)
         {
-            if (!other_modes.key_en)
+            if (!rdp->other_modes.key_en)
             {
                 preacalpha += adseed;
                 if (preacalpha & 0x100)
@@ -1710,7 +1622,7 @@ static void combiner_2cycle(int adseed, uint32_t* curpixel_cvg, int32_t* acalpha
         }
         else
         {
-            if (other_modes.cvg_times_alpha)
+            if (rdp->other_modes.cvg_times_alpha)
                 preacalpha = temp;
             else
                 preacalpha = (*curpixel_cvg) << 5;
@@ -1721,96 +1633,96 @@ static void combiner_2cycle(int adseed, uint32_t* curpixel_cvg, int32_t* acalpha
         *acalpha = preacalpha;
     }
 
-    COLOR_RED(combined_color)   = temp_combined_color[0]  >> 8;
-    COLOR_GREEN(combined_color) = temp_combined_color[1]  >> 8;
-    COLOR_BLUE(combined_color)  = temp_combined_color[2]  >> 8;
+    COLOR_RED(rdp->combined_color)   = temp_combined_color[0]  >> 8;
+    COLOR_GREEN(rdp->combined_color) = temp_combined_color[1]  >> 8;
+    COLOR_BLUE(rdp->combined_color)  = temp_combined_color[2]  >> 8;
 
-    COLOR_ASSIGN(texel0_color, texel1_color);
-    COLOR_ASSIGN(texel1_color, nexttexel_color);
+    COLOR_ASSIGN(rdp->texel0_color, rdp->texel1_color);
+    COLOR_ASSIGN(rdp->texel1_color, rdp->nexttexel_color);
 
-    temp_combined_color[0]   = color_combiner_equation(*combiner_rgbsub_a_r[1],*combiner_rgbsub_b_r[1],*combiner_rgbmul_r[1],*combiner_rgbadd_r[1]);
-    temp_combined_color[1] = color_combiner_equation(*combiner_rgbsub_a_g[1],*combiner_rgbsub_b_g[1],*combiner_rgbmul_g[1],*combiner_rgbadd_g[1]);
-    temp_combined_color[2]  = color_combiner_equation(*combiner_rgbsub_a_b[1],*combiner_rgbsub_b_b[1],*combiner_rgbmul_b[1],*combiner_rgbadd_b[1]);
-    COLOR_ALPHA(combined_color) = alpha_combiner_equation(*combiner_alphasub_a[1],*combiner_alphasub_b[1],*combiner_alphamul[1],*combiner_alphaadd[1]);
+    temp_combined_color[0]   = color_combiner_equation(*rdp->combiner_rgbsub_a_r[1],*rdp->combiner_rgbsub_b_r[1],*rdp->combiner_rgbmul_r[1],*rdp->combiner_rgbadd_r[1]);
+    temp_combined_color[1] = color_combiner_equation(*rdp->combiner_rgbsub_a_g[1],*rdp->combiner_rgbsub_b_g[1],*rdp->combiner_rgbmul_g[1],*rdp->combiner_rgbadd_g[1]);
+    temp_combined_color[2]  = color_combiner_equation(*rdp->combiner_rgbsub_a_b[1],*rdp->combiner_rgbsub_b_b[1],*rdp->combiner_rgbmul_b[1],*rdp->combiner_rgbadd_b[1]);
+    COLOR_ALPHA(rdp->combined_color) = alpha_combiner_equation(*rdp->combiner_alphasub_a[1],*rdp->combiner_alphasub_b[1],*rdp->combiner_alphamul[1],*rdp->combiner_alphaadd[1]);
 
-    if (!other_modes.key_en)
+    if (!rdp->other_modes.key_en)
     {
         
-        COLOR_RED(combined_color)   = temp_combined_color[0]   >> 8;
-        COLOR_GREEN(combined_color) = temp_combined_color[1] >> 8;
-        COLOR_BLUE(combined_color)  = temp_combined_color[2] >> 8;
+        COLOR_RED(rdp->combined_color)   = temp_combined_color[0]   >> 8;
+        COLOR_GREEN(rdp->combined_color) = temp_combined_color[1] >> 8;
+        COLOR_BLUE(rdp->combined_color)  = temp_combined_color[2] >> 8;
 
-        COLOR_RED(pixel_color)   = special_9bit_clamptable[COLOR_RED(combined_color)];
-        COLOR_GREEN(pixel_color) = special_9bit_clamptable[COLOR_GREEN(combined_color)];
-        COLOR_BLUE(pixel_color)  = special_9bit_clamptable[COLOR_BLUE(combined_color)];
+        COLOR_RED(rdp->pixel_color)   = special_9bit_clamptable[COLOR_RED(rdp->combined_color)];
+        COLOR_GREEN(rdp->pixel_color) = special_9bit_clamptable[COLOR_GREEN(rdp->combined_color)];
+        COLOR_BLUE(rdp->pixel_color)  = special_9bit_clamptable[COLOR_BLUE(rdp->combined_color)];
     }
     else
     {
         redkey = SIGN(temp_combined_color[0], 17);
         if (redkey >= 0)
-            redkey = (COLOR_RED(key_width) << 4) - redkey;
+            redkey = (COLOR_RED(rdp->key_width) << 4) - redkey;
         else
-            redkey = (COLOR_RED(key_width) << 4) + redkey;
+            redkey = (COLOR_RED(rdp->key_width) << 4) + redkey;
         greenkey = SIGN(temp_combined_color[1], 17);
         if (greenkey >= 0)
-            greenkey = (COLOR_GREEN(key_width) << 4) - greenkey;
+            greenkey = (COLOR_GREEN(rdp->key_width) << 4) - greenkey;
         else
-            greenkey = (COLOR_GREEN(key_width) << 4) + greenkey;
+            greenkey = (COLOR_GREEN(rdp->key_width) << 4) + greenkey;
         bluekey = SIGN(temp_combined_color[2], 17);
         if (bluekey >= 0)
-            bluekey = (COLOR_BLUE(key_width) << 4) - bluekey;
+            bluekey = (COLOR_BLUE(rdp->key_width) << 4) - bluekey;
         else
-            bluekey = (COLOR_BLUE(key_width) << 4) + bluekey;
+            bluekey = (COLOR_BLUE(rdp->key_width) << 4) + bluekey;
         keyalpha = (redkey < greenkey) ? redkey : greenkey;
         keyalpha = (bluekey < keyalpha) ? bluekey : keyalpha;
         keyalpha = CLIP(keyalpha, 0, 0xff);
 
-        COLOR_RED(pixel_color)   = special_9bit_clamptable[COLOR_RED(chromabypass)];
-        COLOR_GREEN(pixel_color) = special_9bit_clamptable[COLOR_GREEN(chromabypass)];
-        COLOR_BLUE(pixel_color)  = special_9bit_clamptable[COLOR_BLUE(chromabypass)];
+        COLOR_RED(rdp->pixel_color)   = special_9bit_clamptable[COLOR_RED(chromabypass)];
+        COLOR_GREEN(rdp->pixel_color) = special_9bit_clamptable[COLOR_GREEN(chromabypass)];
+        COLOR_BLUE(rdp->pixel_color)  = special_9bit_clamptable[COLOR_BLUE(chromabypass)];
         
-        COLOR_RED(combined_color)   = temp_combined_color[0] >> 8;
-        COLOR_GREEN(combined_color) = temp_combined_color[1] >> 8;
-        COLOR_BLUE(combined_color)  = temp_combined_color[2] >> 8;
+        COLOR_RED(rdp->combined_color)   = temp_combined_color[0] >> 8;
+        COLOR_GREEN(rdp->combined_color) = temp_combined_color[1] >> 8;
+        COLOR_BLUE(rdp->combined_color)  = temp_combined_color[2] >> 8;
     }
     
-    COLOR_ALPHA(pixel_color) = special_9bit_clamptable[COLOR_ALPHA(combined_color)];
-    if (COLOR_ALPHA(pixel_color) == 0xff)
-        COLOR_ALPHA(pixel_color) = 0x100;
+    COLOR_ALPHA(rdp->pixel_color) = special_9bit_clamptable[COLOR_ALPHA(rdp->combined_color)];
+    if (COLOR_ALPHA(rdp->pixel_color) == 0xff)
+        COLOR_ALPHA(rdp->pixel_color) = 0x100;
 
     
-    if (other_modes.cvg_times_alpha)
+    if (rdp->other_modes.cvg_times_alpha)
     {
-        temp = (COLOR_ALPHA(pixel_color) * (*curpixel_cvg) + 4) >> 3;
+        temp = (COLOR_ALPHA(rdp->pixel_color) * (*curpixel_cvg) + 4) >> 3;
         *curpixel_cvg = (temp >> 5) & 0xf;
     }
 
-    if (!other_modes.alpha_cvg_select)
+    if (!rdp->other_modes.alpha_cvg_select)
     {
-        if (!other_modes.key_en)
+        if (!rdp->other_modes.key_en)
         {
-            COLOR_ALPHA(pixel_color) += adseed;
-            if (COLOR_ALPHA(pixel_color) & 0x100)
-                COLOR_ALPHA(pixel_color) = 0xff;
+            COLOR_ALPHA(rdp->pixel_color) += adseed;
+            if (COLOR_ALPHA(rdp->pixel_color) & 0x100)
+                COLOR_ALPHA(rdp->pixel_color) = 0xff;
         }
         else
-            COLOR_ALPHA(pixel_color) = keyalpha;
+            COLOR_ALPHA(rdp->pixel_color) = keyalpha;
     }
     else
     {
-        if (other_modes.cvg_times_alpha)
-            COLOR_ALPHA(pixel_color) = temp;
+        if (rdp->other_modes.cvg_times_alpha)
+            COLOR_ALPHA(rdp->pixel_color) = temp;
         else
-            COLOR_ALPHA(pixel_color) = (*curpixel_cvg) << 5;
+            COLOR_ALPHA(rdp->pixel_color) = (*curpixel_cvg) << 5;
 
-        if (COLOR_ALPHA(pixel_color) > 0xff)
-            COLOR_ALPHA(pixel_color) = 0xff;
+        if (COLOR_ALPHA(rdp->pixel_color) > 0xff)
+            COLOR_ALPHA(rdp->pixel_color) = 0xff;
     }
     
 
-    COLOR_ALPHA(shade_color) += adseed;
-    if (COLOR_ALPHA(shade_color) & 0x100)
-        COLOR_ALPHA(shade_color) = 0xff;
+    COLOR_ALPHA(rdp->shade_color) += adseed;
+    if (COLOR_ALPHA(rdp->shade_color) & 0x100)
+        COLOR_ALPHA(rdp->shade_color) = 0xff;
 }
 
 static unsigned char bayer_matrix[16] = {
@@ -1826,7 +1738,7 @@ static unsigned char magic_matrix[16] = {
     07, 01, 06, 00
 };
 
-static void rgb_dither_complete(int* r, int* g, int* b, int dith)
+static void rgb_dither_complete(struct rdp_state *rdp, int* r, int* g, int* b, int dith)
 {
    int32_t replacesign, ditherdiff;
    int32_t newr = *r, newg = *g, newb = *b;
@@ -1846,7 +1758,7 @@ static void rgb_dither_complete(int* r, int* g, int* b, int dith)
 	else
 		newb = (newb & 0xf8) + 8;
 
-	if (other_modes.rgb_dither_sel != 2)
+	if (rdp->other_modes.rgb_dither_sel != 2)
 		gcomp = bcomp = dith;
 	else
 	{
@@ -1868,29 +1780,29 @@ static void rgb_dither_complete(int* r, int* g, int* b, int dith)
 	*b = *b + (ditherdiff & replacesign);
 }
 
-static void blender_equation_cycle0(int* r, int* g, int* b)
+static void blender_equation_cycle0(struct rdp_state *rdp, int* r, int* g, int* b)
 {
     int blend1a, blend2a;
     int blr, blg, blb, sum;
     int mulb;
 
-    blend1a = *blender1b_a[0] >> 3;
-    blend2a = *blender2b_a[0] >> 3;
+    blend1a = *rdp->blender1b_a[0] >> 3;
+    blend2a = *rdp->blender2b_a[0] >> 3;
 
     LOG("blend1a = %d, blend2a = %d\n", blend1a, blend2a);
 
-    if (other_modes.f.special_bsel0)
+    if (rdp->other_modes.f.special_bsel0)
     {
-        blend1a = (blend1a >> blshifta) & 0x3C;
-        blend2a = (blend2a >> blshiftb) | 3;
+        blend1a = (blend1a >> rdp->blshifta) & 0x3C;
+        blend2a = (blend2a >> rdp->blshiftb) | 3;
     }
     mulb = blend2a + 1;
 
-    blr = (*blender1a_r[0]) * blend1a + (*blender2a_r[0]) * mulb;
-    blg = (*blender1a_g[0]) * blend1a + (*blender2a_g[0]) * mulb;
-    blb = (*blender1a_b[0]) * blend1a + (*blender2a_b[0]) * mulb;
+    blr = (*rdp->blender1a_r[0]) * blend1a + (*rdp->blender2a_r[0]) * mulb;
+    blg = (*rdp->blender1a_g[0]) * blend1a + (*rdp->blender2a_g[0]) * mulb;
+    blb = (*rdp->blender1a_b[0]) * blend1a + (*rdp->blender2a_b[0]) * mulb;
 
-    if (!other_modes.force_blend)
+    if (!rdp->other_modes.force_blend)
     {
         sum = ((blend1a & ~3) + (blend2a & ~3) + 4) << 9;
         *r = bldiv_hwaccurate_table[sum | ((blr >> 2) & 0x7ff)];
@@ -1905,43 +1817,43 @@ static void blender_equation_cycle0(int* r, int* g, int* b)
     }    
 }
 
-static STRICTINLINE void blender_equation_cycle0_2(int* r, int* g, int* b)
+static STRICTINLINE void blender_equation_cycle0_2(struct rdp_state *rdp, int* r, int* g, int* b)
 {
     int blend1a, blend2a;
-    blend1a = *blender1b_a[0] >> 3;
-    blend2a = *blender2b_a[0] >> 3;
+    blend1a = *rdp->blender1b_a[0] >> 3;
+    blend2a = *rdp->blender2b_a[0] >> 3;
 
-    if (other_modes.f.special_bsel0)
+    if (rdp->other_modes.f.special_bsel0)
     {
-        blend1a = (blend1a >> pastblshifta) & 0x3C;
-        blend2a = (blend2a >> pastblshiftb) | 3;
+        blend1a = (blend1a >> rdp->pastblshifta) & 0x3C;
+        blend2a = (blend2a >> rdp->pastblshiftb) | 3;
     }
     blend2a += 1;
-    *r = (((*blender1a_r[0]) * blend1a + (*blender2a_r[0]) * blend2a) >> 5) & 0xff;
-    *g = (((*blender1a_g[0]) * blend1a + (*blender2a_g[0]) * blend2a) >> 5) & 0xff;
-    *b = (((*blender1a_b[0]) * blend1a + (*blender2a_b[0]) * blend2a) >> 5) & 0xff;
+    *r = (((*rdp->blender1a_r[0]) * blend1a + (*rdp->blender2a_r[0]) * blend2a) >> 5) & 0xff;
+    *g = (((*rdp->blender1a_g[0]) * blend1a + (*rdp->blender2a_g[0]) * blend2a) >> 5) & 0xff;
+    *b = (((*rdp->blender1a_b[0]) * blend1a + (*rdp->blender2a_b[0]) * blend2a) >> 5) & 0xff;
 }
 
-static void blender_equation_cycle1(int* r, int* g, int* b)
+static void blender_equation_cycle1(struct rdp_state *rdp, int* r, int* g, int* b)
 {
     int blend1a, blend2a;
     int blr, blg, blb, sum;
     int mulb;
 
-    blend1a = *blender1b_a[1] >> 3;
-    blend2a = *blender2b_a[1] >> 3;
+    blend1a = *rdp->blender1b_a[1] >> 3;
+    blend2a = *rdp->blender2b_a[1] >> 3;
 
-    if (other_modes.f.special_bsel1)
+    if (rdp->other_modes.f.special_bsel1)
     {
-        blend1a = (blend1a >> blshifta) & 0x3C;
-        blend2a = (blend2a >> blshiftb) | 3;
+        blend1a = (blend1a >> rdp->blshifta) & 0x3C;
+        blend2a = (blend2a >> rdp->blshiftb) | 3;
     }
     mulb = blend2a + 1;
-    blr = (*blender1a_r[1]) * blend1a + (*blender2a_r[1]) * mulb;
-    blg = (*blender1a_g[1]) * blend1a + (*blender2a_g[1]) * mulb;
-    blb = (*blender1a_b[1]) * blend1a + (*blender2a_b[1]) * mulb;
+    blr = (*rdp->blender1a_r[1]) * blend1a + (*rdp->blender2a_r[1]) * mulb;
+    blg = (*rdp->blender1a_g[1]) * blend1a + (*rdp->blender2a_g[1]) * mulb;
+    blb = (*rdp->blender1a_b[1]) * blend1a + (*rdp->blender2a_b[1]) * mulb;
 
-    if (!other_modes.force_blend)
+    if (!rdp->other_modes.force_blend)
     {
         sum = ((blend1a & ~3) + (blend2a & ~3) + 4) << 9;
         *r = bldiv_hwaccurate_table[sum | ((blr >> 2) & 0x7ff)];
@@ -1956,12 +1868,12 @@ static void blender_equation_cycle1(int* r, int* g, int* b)
     }
 }
 
-static int blender_1cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, uint32_t blend_en, uint32_t prewrap, uint32_t curpixel_cvg, uint32_t curpixel_cvbit)
+static int blender_1cycle(struct rdp_state *rdp, uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, uint32_t blend_en, uint32_t prewrap, uint32_t curpixel_cvg, uint32_t curpixel_cvbit)
 {
     int r, g, b, dontblend;
     
     
-    if (alpha_compare(COLOR_ALPHA(pixel_color)))
+    if (alpha_compare(rdp, COLOR_ALPHA(rdp->pixel_color)))
     {
 
         
@@ -1969,38 +1881,38 @@ static int blender_1cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, ui
         
         
         
-        if (other_modes.antialias_en ? (curpixel_cvg) : (curpixel_cvbit))
+        if (rdp->other_modes.antialias_en ? (curpixel_cvg) : (curpixel_cvbit))
         {
 
-            if (!other_modes.color_on_cvg || prewrap)
+            if (!rdp->other_modes.color_on_cvg || prewrap)
             {
-                dontblend = (other_modes.f.partialreject_1cycle && COLOR_ALPHA(pixel_color) >= 0xff);
+                dontblend = (rdp->other_modes.f.partialreject_1cycle && COLOR_ALPHA(rdp->pixel_color) >= 0xff);
                 if (!blend_en || dontblend)
                 {
-                    r = *blender1a_r[0];
-                    g = *blender1a_g[0];
-                    b = *blender1a_b[0];
+                    r = *rdp->blender1a_r[0];
+                    g = *rdp->blender1a_g[0];
+                    b = *rdp->blender1a_b[0];
                 }
                 else
                 {
-                    COLOR_ALPHA(inv_pixel_color) =  (~(*blender1b_a[0])) & 0xff;
+                    COLOR_ALPHA(rdp->inv_pixel_color) =  (~(*rdp->blender1b_a[0])) & 0xff;
                     
                     
                     
                     
 
-                    blender_equation_cycle0(&r, &g, &b);
+                    blender_equation_cycle0(rdp, &r, &g, &b);
                 }
             }
             else
             {
-                r = *blender2a_r[0];
-                g = *blender2a_g[0];
-                b = *blender2a_b[0];
+                r = *rdp->blender2a_r[0];
+                g = *rdp->blender2a_g[0];
+                b = *rdp->blender2a_b[0];
             }
 
-            if (other_modes.rgb_dither_sel != 3)
-               rgb_dither_complete(&r, &g, &b, dith);
+            if (rdp->other_modes.rgb_dither_sel != 3)
+               rgb_dither_complete(rdp, &r, &g, &b, dith);
 
             *fr = r;
             *fg = g;
@@ -2015,51 +1927,51 @@ static int blender_1cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, ui
         return 0;
 }
 
-int blender_2cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, uint32_t blend_en, uint32_t prewrap, uint32_t curpixel_cvg, uint32_t curpixel_cvbit, int32_t acalpha)
+int blender_2cycle(struct rdp_state *rdp, uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, uint32_t blend_en, uint32_t prewrap, uint32_t curpixel_cvg, uint32_t curpixel_cvbit, int32_t acalpha)
 {
     int r, g, b, dontblend;
 
     
-    if (alpha_compare(acalpha))
+    if (alpha_compare(rdp, acalpha))
     {
-        if (other_modes.antialias_en ? (curpixel_cvg) : (curpixel_cvbit))
+        if (rdp->other_modes.antialias_en ? (curpixel_cvg) : (curpixel_cvbit))
         {
-            COLOR_ALPHA(inv_pixel_color) =  (~(*blender1b_a[0])) & 0xff;
+            COLOR_ALPHA(rdp->inv_pixel_color) =  (~(*rdp->blender1b_a[0])) & 0xff;
 
-            blender_equation_cycle0_2(&r, &g, &b);
+            blender_equation_cycle0_2(rdp, &r, &g, &b);
             
-            COLOR_ASSIGN(memory_color, pre_memory_color);
+            COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
 
-            COLOR_RED(blended_pixel_color)   = r;
-            COLOR_GREEN(blended_pixel_color) = g;
-            COLOR_BLUE(blended_pixel_color)  = b;
-            COLOR_ALPHA(blended_pixel_color) = COLOR_ALPHA(pixel_color);
+            COLOR_RED(rdp->blended_pixel_color)   = r;
+            COLOR_GREEN(rdp->blended_pixel_color) = g;
+            COLOR_BLUE(rdp->blended_pixel_color)  = b;
+            COLOR_ALPHA(rdp->blended_pixel_color) = COLOR_ALPHA(rdp->pixel_color);
 
-            if (!other_modes.color_on_cvg || prewrap)
+            if (!rdp->other_modes.color_on_cvg || prewrap)
             {
-                dontblend = (other_modes.f.partialreject_2cycle && COLOR_ALPHA(pixel_color) >= 0xff);
+                dontblend = (rdp->other_modes.f.partialreject_2cycle && COLOR_ALPHA(rdp->pixel_color) >= 0xff);
                 if (!blend_en || dontblend)
                 {
-                    r = *blender1a_r[1];
-                    g = *blender1a_g[1];
-                    b = *blender1a_b[1];
+                    r = *rdp->blender1a_r[1];
+                    g = *rdp->blender1a_g[1];
+                    b = *rdp->blender1a_b[1];
                 }
                 else
                 {
-                    COLOR_ALPHA(inv_pixel_color) =  (~(*blender1b_a[1])) & 0xff;
-                    blender_equation_cycle1(&r, &g, &b);
+                    COLOR_ALPHA(rdp->inv_pixel_color) =  (~(*rdp->blender1b_a[1])) & 0xff;
+                    blender_equation_cycle1(rdp, &r, &g, &b);
                 }
             }
             else
             {
-                r = *blender2a_r[1];
-                g = *blender2a_g[1];
-                b = *blender2a_b[1];
+                r = *rdp->blender2a_r[1];
+                g = *rdp->blender2a_g[1];
+                b = *rdp->blender2a_b[1];
             }
 
             
-            if (other_modes.rgb_dither_sel != 3)
-               rgb_dither_complete(&r, &g, &b, dith);
+            if (rdp->other_modes.rgb_dither_sel != 3)
+               rgb_dither_complete(rdp, &r, &g, &b, dith);
 
             *fr = r;
             *fg = g;
@@ -2068,23 +1980,23 @@ int blender_2cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, uint32_t
         }
         else 
         {
-           COLOR_ASSIGN(memory_color, pre_memory_color);
+           COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
            return 0;
         }
     }
     else 
     {
-       COLOR_ASSIGN(memory_color, pre_memory_color);
+       COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
         return 0;
     }
 }
 
-static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
+static void fetch_texel(struct rdp_state *rdp, COLOR *color, int s, int t, uint32_t tilenum)
 {
-    uint32_t tbase = tile[tilenum].line * t + tile[tilenum].tmem;
+    uint32_t tbase = rdp->tile[tilenum].line * t + rdp->tile[tilenum].tmem;
     
 
-    uint32_t tpal    = tile[tilenum].palette;
+    uint32_t tpal    = rdp->tile[tilenum].palette;
 
     
     
@@ -2093,14 +2005,14 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
     
     
     
-    uint16_t *tc16 = (uint16_t*)__TMEM;
+    uint16_t *tc16 = (uint16_t*)rdp->__TMEM;
     uint32_t taddr = 0;
 
     
 
     
 
-    switch (tile[tilenum].f.notlutswitch)
+    switch (rdp->tile[tilenum].f.notlutswitch)
     {
     case TEXEL_RGBA4:
         {
@@ -2108,7 +2020,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
             taddr = ((tbase << 4) + s) >> 1;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
 
-            byteval = __TMEM[taddr & 0xfff];
+            byteval = rdp->__TMEM[taddr & 0xfff];
             c = ((s & 1)) ? (byteval & 0xf) : (byteval >> 4);
             c |= (c << 4);
             COLOR_RED_PTR(color) = c;
@@ -2124,7 +2036,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
 
-            p = __TMEM[taddr & 0xfff];
+            p = rdp->__TMEM[taddr & 0xfff];
             COLOR_RED_PTR(color) = p;
             COLOR_GREEN_PTR(color) = p;
             COLOR_BLUE_PTR(color) = p;
@@ -2169,7 +2081,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
                     
-            save = u = __TMEM[taddr & 0x7ff];
+            save = u = rdp->__TMEM[taddr & 0x7ff];
 
             u = (u - 0x80) & 0x1ff;
 
@@ -2189,7 +2101,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
             taddr &= 0x7ff;
 			c = tc16[taddr >> 1];
-            y = __TMEM[taddr + 0x800];
+            y = rdp->__TMEM[taddr + 0x800];
             u = c >> 8;
             v = c & 0xff;
 
@@ -2209,7 +2121,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
             taddr = ((tbase << 4) + s) >> 1;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
 
-            p = __TMEM[taddr & 0xfff];
+            p = rdp->__TMEM[taddr & 0xfff];
             p = (s & 1) ? (p & 0xf) : (p >> 4);
             p = (tpal << 4) | p;
             COLOR_RED_PTR(color) = COLOR_GREEN_PTR(color) = COLOR_BLUE_PTR(color) = COLOR_ALPHA_PTR(color) = p;
@@ -2222,7 +2134,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
 
-            p = __TMEM[taddr & 0xfff];
+            p = rdp->__TMEM[taddr & 0xfff];
             COLOR_RED_PTR(color) = p;
             COLOR_GREEN_PTR(color) = p;
             COLOR_BLUE_PTR(color) = p;
@@ -2262,7 +2174,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
 
             taddr = ((tbase << 4) + s) >> 1;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            p = __TMEM[taddr & 0xfff];
+            p = rdp->__TMEM[taddr & 0xfff];
             p = (s & 1) ? (p & 0xf) : (p >> 4);
             i = p & 0xe;
             i = (i << 4) | (i << 1) | (i >> 2);
@@ -2278,7 +2190,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
 
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            p = __TMEM[taddr & 0xfff];
+            p = rdp->__TMEM[taddr & 0xfff];
             i = p & 0xf0;
             i |= (i >> 4);
             COLOR_RED_PTR(color) = i;
@@ -2317,7 +2229,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
 
             taddr = ((tbase << 4) + s) >> 1;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            byteval = __TMEM[taddr & 0xfff];
+            byteval = rdp->__TMEM[taddr & 0xfff];
             c = (s & 1) ? (byteval & 0xf) : (byteval >> 4);
             c |= (c << 4);
             COLOR_RED_PTR(color) = c;
@@ -2332,7 +2244,7 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
 
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            c = __TMEM[taddr & 0xfff];
+            c = rdp->__TMEM[taddr & 0xfff];
             COLOR_RED_PTR(color) = c;
             COLOR_GREEN_PTR(color) = c;
             COLOR_BLUE_PTR(color) = c;
@@ -2368,17 +2280,17 @@ static void fetch_texel(COLOR *color, int s, int t, uint32_t tilenum)
     }
 }
 
-static void fetch_texel_entlut(COLOR *color, int s, int t, uint32_t tilenum)
+static void fetch_texel_entlut(struct rdp_state *rdp, COLOR *color, int s, int t, uint32_t tilenum)
 {
-    uint32_t tbase = tile[tilenum].line * t + tile[tilenum].tmem;
-    uint32_t tpal    = tile[tilenum].palette << 4;
-    uint16_t *tc16 = (uint16_t*)__TMEM;
+    uint32_t tbase = rdp->tile[tilenum].line * t + rdp->tile[tilenum].tmem;
+    uint32_t tpal    = rdp->tile[tilenum].palette << 4;
+    uint16_t *tc16 = (uint16_t*)rdp->__TMEM;
     uint32_t taddr = 0;
     uint32_t c;
 
     
     
-    switch(tile[tilenum].f.tlutswitch)
+    switch(rdp->tile[tilenum].f.tlutswitch)
     {
     case 0:
     case 1:
@@ -2386,7 +2298,7 @@ static void fetch_texel_entlut(COLOR *color, int s, int t, uint32_t tilenum)
         {
             taddr = ((tbase << 4) + s) >> 1;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            c = __TMEM[taddr & 0x7ff];
+            c = rdp->__TMEM[taddr & 0x7ff];
             c = (s & 1) ? (c & 0xf) : (c >> 4);
 #ifdef EXTRALOGGING
             fprintf(stderr, "TPAL: %u\n", tpal);
@@ -2398,7 +2310,7 @@ static void fetch_texel_entlut(COLOR *color, int s, int t, uint32_t tilenum)
         {
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            c = __TMEM[taddr & 0x7ff];
+            c = rdp->__TMEM[taddr & 0x7ff];
             c = (s & 1) ? (c & 0xf) : (c >> 4);
             c = tlut[((tpal + c) << 2) + WORD_ADDR_XOR];
         }
@@ -2412,7 +2324,7 @@ static void fetch_texel_entlut(COLOR *color, int s, int t, uint32_t tilenum)
         {
             taddr = (tbase << 3) + s;
             taddr ^= ((t & 1) ? BYTE_XOR_DWORD_SWAP : BYTE_ADDR_XOR);
-            c = __TMEM[taddr & 0x7ff];
+            c = rdp->__TMEM[taddr & 0x7ff];
             c = tlut[(c << 2) + WORD_ADDR_XOR];
         }
         break;
@@ -2431,7 +2343,7 @@ static void fetch_texel_entlut(COLOR *color, int s, int t, uint32_t tilenum)
         break;
     }
 
-    if (!other_modes.tlut_type)
+    if (!rdp->other_modes.tlut_type)
     {
         COLOR_RED_PTR(color) = GET_HI_RGBA16_TMEM(c);
         COLOR_GREEN_PTR(color) = GET_MED_RGBA16_TMEM(c);
@@ -2446,40 +2358,95 @@ static void fetch_texel_entlut(COLOR *color, int s, int t, uint32_t tilenum)
 
 }
 
-#define fetch_texel_quadro_rgba16(color0, color1, color2, color3, c0, c1, c2, c3) \
-   COLOR_RED_PTR(color0) = GET_HI_RGBA16_TMEM(c0); \
-   COLOR_GREEN_PTR(color0) = GET_MED_RGBA16_TMEM(c0); \
-   COLOR_BLUE_PTR(color0) = GET_LOW_RGBA16_TMEM(c0); \
-   COLOR_ALPHA_PTR(color0) = (c0 & 1) ? 0xff : 0; \
-   COLOR_RED_PTR(color1) = GET_HI_RGBA16_TMEM(c1); \
-   COLOR_GREEN_PTR(color1) = GET_MED_RGBA16_TMEM(c1); \
-   COLOR_BLUE_PTR(color1) = GET_LOW_RGBA16_TMEM(c1); \
-   COLOR_ALPHA_PTR(color1) = (c1 & 1) ? 0xff : 0; \
-   COLOR_RED_PTR(color2) = GET_HI_RGBA16_TMEM(c2); \
-   COLOR_GREEN_PTR(color2) = GET_MED_RGBA16_TMEM(c2); \
-   COLOR_BLUE_PTR(color2) = GET_LOW_RGBA16_TMEM(c2); \
-   COLOR_ALPHA_PTR(color2) = (c2 & 1) ? 0xff : 0; \
-   COLOR_RED_PTR(color3) = GET_HI_RGBA16_TMEM(c3); \
-   COLOR_GREEN_PTR(color3) = GET_MED_RGBA16_TMEM(c3); \
-   COLOR_BLUE_PTR(color3) = GET_LOW_RGBA16_TMEM(c3); \
-   COLOR_ALPHA_PTR(color3) = (c3 & 1) ? 0xff : 0
+/*
+ * Decodes four 5551 texels at once.  SIMD builds extract the fields of all
+ * four texels in parallel, replicate the top bits of each 5-bit field the way
+ * replicated_rgba[] does, and transpose the R, G, B and A vectors into the
+ * four COLORs.
+ */
+static STRICTINLINE void fetch_texel_quadro_rgba16(COLOR *color0, COLOR *color1, COLOR *color2, COLOR *color3, uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3)
+{
+#if defined(USE_SSE_SUPPORT)
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    __m128i c, r, g, b, a, rg, ba;
+
+    c = _mm_setr_epi16(c0, c1, c2, c3, 0, 0, 0, 0);
+    r = _mm_srli_epi16(c, 11);
+    g = _mm_and_si128(_mm_srli_epi16(c, 6), mask5);
+    b = _mm_and_si128(_mm_srli_epi16(c, 1), mask5);
+    r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+    b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+    a = _mm_and_si128(_mm_sub_epi16(XMM_ZERO, _mm_and_si128(c, _mm_set1_epi16(1))), _mm_set1_epi16(0xff));
+
+    rg = _mm_unpacklo_epi16(r, g);
+    ba = _mm_unpacklo_epi16(b, a);
+    c = _mm_unpacklo_epi32(rg, ba);
+    _mm_storel_epi64((__m128i *)color0, c);
+    _mm_storel_epi64((__m128i *)color1, _mm_srli_si128(c, 8));
+    c = _mm_unpackhi_epi32(rg, ba);
+    _mm_storel_epi64((__m128i *)color2, c);
+    _mm_storel_epi64((__m128i *)color3, _mm_srli_si128(c, 8));
+#elif defined(USE_NEON_SUPPORT)
+    const uint16x4_t mask5 = vdup_n_u16(0x1f);
+    ALIGNED uint16_t texels[4];
+    ALIGNED int16_t colors[16];
+    uint16x4x4_t rgba;
+    uint16x4_t c;
+
+    texels[0] = c0;
+    texels[1] = c1;
+    texels[2] = c2;
+    texels[3] = c3;
+    c = vld1_u16(texels);
+    rgba.val[0] = vshr_n_u16(c, 11);
+    rgba.val[1] = vand_u16(vshr_n_u16(c, 6), mask5);
+    rgba.val[2] = vand_u16(vshr_n_u16(c, 1), mask5);
+    rgba.val[0] = vorr_u16(vshl_n_u16(rgba.val[0], 3), vshr_n_u16(rgba.val[0], 2));
+    rgba.val[1] = vorr_u16(vshl_n_u16(rgba.val[1], 3), vshr_n_u16(rgba.val[1], 2));
+    rgba.val[2] = vorr_u16(vshl_n_u16(rgba.val[2], 3), vshr_n_u16(rgba.val[2], 2));
+    rgba.val[3] = vand_u16(vtst_u16(c, vdup_n_u16(1)), vdup_n_u16(0xff));
+    vst4_u16((uint16_t *)colors, rgba);
+    memcpy(color0, &colors[0], sizeof(COLOR));
+    memcpy(color1, &colors[4], sizeof(COLOR));
+    memcpy(color2, &colors[8], sizeof(COLOR));
+    memcpy(color3, &colors[12], sizeof(COLOR));
+#else
+    COLOR_RED_PTR(color0) = GET_HI_RGBA16_TMEM(c0);
+    COLOR_GREEN_PTR(color0) = GET_MED_RGBA16_TMEM(c0);
+    COLOR_BLUE_PTR(color0) = GET_LOW_RGBA16_TMEM(c0);
+    COLOR_ALPHA_PTR(color0) = (c0 & 1) ? 0xff : 0;
+    COLOR_RED_PTR(color1) = GET_HI_RGBA16_TMEM(c1);
+    COLOR_GREEN_PTR(color1) = GET_MED_RGBA16_TMEM(c1);
+    COLOR_BLUE_PTR(color1) = GET_LOW_RGBA16_TMEM(c1);
+    COLOR_ALPHA_PTR(color1) = (c1 & 1) ? 0xff : 0;
+    COLOR_RED_PTR(color2) = GET_HI_RGBA16_TMEM(c2);
+    COLOR_GREEN_PTR(color2) = GET_MED_RGBA16_TMEM(c2);
+    COLOR_BLUE_PTR(color2) = GET_LOW_RGBA16_TMEM(c2);
+    COLOR_ALPHA_PTR(color2) = (c2 & 1) ? 0xff : 0;
+    COLOR_RED_PTR(color3) = GET_HI_RGBA16_TMEM(c3);
+    COLOR_GREEN_PTR(color3) = GET_MED_RGBA16_TMEM(c3);
+    COLOR_BLUE_PTR(color3) = GET_LOW_RGBA16_TMEM(c3);
+    COLOR_ALPHA_PTR(color3) = (c3 & 1) ? 0xff : 0;
+#endif
+}
 
 
-static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLOR *color3, int s0, int s1, int t0, int t1, uint32_t tilenum)
+static void fetch_texel_quadro(struct rdp_state *rdp, COLOR *color0, COLOR *color1, COLOR *color2, COLOR *color3, int s0, int s1, int t0, int t1, uint32_t tilenum)
 {
 
-    uint32_t tbase0 = tile[tilenum].line * t0 + tile[tilenum].tmem;
-    uint32_t tbase2 = tile[tilenum].line * t1 + tile[tilenum].tmem;
-    uint32_t tpal    = tile[tilenum].palette;
+    uint32_t tbase0 = rdp->tile[tilenum].line * t0 + rdp->tile[tilenum].tmem;
+    uint32_t tbase2 = rdp->tile[tilenum].line * t1 + rdp->tile[tilenum].tmem;
+    uint32_t tpal    = rdp->tile[tilenum].palette;
     uint32_t xort = 0, ands = 0;
 
     
     
 
-    uint16_t *tc16 = (uint16_t*)__TMEM;
+    uint16_t *tc16 = (uint16_t*)rdp->__TMEM;
     uint32_t taddr0 = 0, taddr1 = 0, taddr2 = 0, taddr3 = 0;
 
-    switch (tile[tilenum].f.notlutswitch)
+    switch (rdp->tile[tilenum].f.notlutswitch)
     {
     case TEXEL_RGBA4:
         {
@@ -2500,14 +2467,14 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
             ands = s0 & 1;
-            byteval = __TMEM[taddr0];
+            byteval = rdp->__TMEM[taddr0];
             c = (ands) ? (byteval & 0xf) : (byteval >> 4);
             c |= (c << 4);
             COLOR_RED_PTR(color0) = c;
             COLOR_GREEN_PTR(color0) = c;
             COLOR_BLUE_PTR(color0) = c;
             COLOR_ALPHA_PTR(color0) = c;
-            byteval = __TMEM[taddr2];
+            byteval = rdp->__TMEM[taddr2];
             c = (ands) ? (byteval & 0xf) : (byteval >> 4);
             c |= (c << 4);
             COLOR_RED_PTR(color2) = c;
@@ -2516,14 +2483,14 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             COLOR_ALPHA_PTR(color2) = c;
 
             ands = s1 & 1;
-            byteval = __TMEM[taddr1];
+            byteval = rdp->__TMEM[taddr1];
             c = (ands) ? (byteval & 0xf) : (byteval >> 4);
             c |= (c << 4);
             COLOR_RED_PTR(color1) = c;
             COLOR_GREEN_PTR(color1) = c;
             COLOR_BLUE_PTR(color1) = c;
             COLOR_ALPHA_PTR(color1) = c;
-            byteval = __TMEM[taddr3];
+            byteval = rdp->__TMEM[taddr3];
             c = (ands) ? (byteval & 0xf) : (byteval >> 4);
             c |= (c << 4);
             COLOR_RED_PTR(color3) = c;
@@ -2550,22 +2517,22 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr1 &= 0xfff;
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             COLOR_RED_PTR(color0) = p;
             COLOR_GREEN_PTR(color0) = p;
             COLOR_BLUE_PTR(color0) = p;
             COLOR_ALPHA_PTR(color0) = p;
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             COLOR_RED_PTR(color2) = p;
             COLOR_GREEN_PTR(color2) = p;
             COLOR_BLUE_PTR(color2) = p;
             COLOR_ALPHA_PTR(color2) = p;
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             COLOR_RED_PTR(color1) = p;
             COLOR_GREEN_PTR(color1) = p;
             COLOR_BLUE_PTR(color1) = p;
             COLOR_ALPHA_PTR(color1) = p;
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             COLOR_RED_PTR(color3) = p;
             COLOR_GREEN_PTR(color3) = p;
             COLOR_BLUE_PTR(color3) = p;
@@ -2658,13 +2625,13 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr2 ^= xort;
             taddr3 ^= xort;
 
-            save0 = u0 = __TMEM[taddr0 & 0x7ff];
+            save0 = u0 = rdp->__TMEM[taddr0 & 0x7ff];
             u0 = u0 - 0x80;
-            save1 = u1 = __TMEM[taddr1 & 0x7ff];
+            save1 = u1 = rdp->__TMEM[taddr1 & 0x7ff];
             u1 = u1 - 0x80;
-            save2 = u2 = __TMEM[taddr2 & 0x7ff];
+            save2 = u2 = rdp->__TMEM[taddr2 & 0x7ff];
             u2 = u2 - 0x80;
-            save3 = u3 = __TMEM[taddr3 & 0x7ff];
+            save3 = u3 = rdp->__TMEM[taddr3 & 0x7ff];
             u3 = u3 - 0x80;
 
             COLOR_RED_PTR(color0) = u0;
@@ -2713,16 +2680,16 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             c2 = tc16[taddr2 >> 1];
             c3 = tc16[taddr3 >> 1];                    
             
-            y0 = __TMEM[taddr0 + 0x800];
+            y0 = rdp->__TMEM[taddr0 + 0x800];
             u0 = c0 >> 8;
             v0 = c0 & 0xff;
-            y1 = __TMEM[taddr1 + 0x800];
+            y1 = rdp->__TMEM[taddr1 + 0x800];
             u1 = c1 >> 8;
             v1 = c1 & 0xff;
-            y2 = __TMEM[taddr2 + 0x800];
+            y2 = rdp->__TMEM[taddr2 + 0x800];
             u2 = c2 >> 8;
             v2 = c2 & 0xff;
-            y3 = __TMEM[taddr3 + 0x800];
+            y3 = rdp->__TMEM[taddr3 + 0x800];
             u3 = c3 >> 8;
             v3 = c3 & 0xff;
 
@@ -2772,21 +2739,21 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
             ands = s0 & 1;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             p = (ands) ? (p & 0xf) : (p >> 4);
             p = (tpal << 4) | p;
             COLOR_RED_PTR(color0) = COLOR_GREEN_PTR(color0) = COLOR_BLUE_PTR(color0) = COLOR_ALPHA_PTR(color0) = p;
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             p = (ands) ? (p & 0xf) : (p >> 4);
             p = (tpal << 4) | p;
             COLOR_RED_PTR(color2) = COLOR_GREEN_PTR(color2) = COLOR_BLUE_PTR(color2) = COLOR_ALPHA_PTR(color2) = p;
 
             ands = s1 & 1;
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             p = (ands) ? (p & 0xf) : (p >> 4);
             p = (tpal << 4) | p;
             COLOR_RED_PTR(color1) = COLOR_GREEN_PTR(color1) = COLOR_BLUE_PTR(color1) = COLOR_ALPHA_PTR(color1) = p;
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             p = (ands) ? (p & 0xf) : (p >> 4);
             p = (tpal << 4) | p;
             COLOR_RED_PTR(color3) = COLOR_GREEN_PTR(color3) = COLOR_BLUE_PTR(color3) = COLOR_ALPHA_PTR(color3) = p;
@@ -2811,22 +2778,22 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr1 &= 0xfff;
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             COLOR_RED_PTR(color0) = p;
             COLOR_GREEN_PTR(color0) = p;
             COLOR_BLUE_PTR(color0) = p;
             COLOR_ALPHA_PTR(color0) = p;
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             COLOR_RED_PTR(color2) = p;
             COLOR_GREEN_PTR(color2) = p;
             COLOR_BLUE_PTR(color2) = p;
             COLOR_ALPHA_PTR(color2) = p;
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             COLOR_RED_PTR(color1) = p;
             COLOR_GREEN_PTR(color1) = p;
             COLOR_BLUE_PTR(color1) = p;
             COLOR_ALPHA_PTR(color1) = p;
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             COLOR_RED_PTR(color3) = p;
             COLOR_GREEN_PTR(color3) = p;
             COLOR_BLUE_PTR(color3) = p;
@@ -2932,7 +2899,7 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
             ands = s0 & 1;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             p = ands ? (p & 0xf) : (p >> 4);
             i = p & 0xe;
             i = (i << 4) | (i << 1) | (i >> 2);
@@ -2940,7 +2907,7 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             COLOR_GREEN_PTR(color0) = i;
             COLOR_BLUE_PTR(color0) = i;
             COLOR_ALPHA_PTR(color0) = (p & 0x1) ? 0xff : 0;
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             p = ands ? (p & 0xf) : (p >> 4);
             i = p & 0xe;
             i = (i << 4) | (i << 1) | (i >> 2);
@@ -2950,7 +2917,7 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             COLOR_ALPHA_PTR(color2) = (p & 0x1) ? 0xff : 0;
 
             ands = s1 & 1;
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             p = ands ? (p & 0xf) : (p >> 4);
             i = p & 0xe;
             i = (i << 4) | (i << 1) | (i >> 2);
@@ -2958,7 +2925,7 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             COLOR_GREEN_PTR(color1) = i;
             COLOR_BLUE_PTR(color1) = i;
             COLOR_ALPHA_PTR(color1) = (p & 0x1) ? 0xff : 0;
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             p = ands ? (p & 0xf) : (p >> 4);
             i = p & 0xe;
             i = (i << 4) | (i << 1) | (i >> 2);
@@ -2987,28 +2954,28 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr1 &= 0xfff;
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             i = p & 0xf0;
             i |= (i >> 4);
             COLOR_RED_PTR(color0) = i;
             COLOR_GREEN_PTR(color0) = i;
             COLOR_BLUE_PTR(color0) = i;
             COLOR_ALPHA_PTR(color0) = ((p & 0xf) << 4) | (p & 0xf);
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             i = p & 0xf0;
             i |= (i >> 4);
             COLOR_RED_PTR(color1) = i;
             COLOR_GREEN_PTR(color1) = i;
             COLOR_BLUE_PTR(color1) = i;
             COLOR_ALPHA_PTR(color1) = ((p & 0xf) << 4) | (p & 0xf);
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             i = p & 0xf0;
             i |= (i >> 4);
             COLOR_RED_PTR(color2) = i;
             COLOR_GREEN_PTR(color2) = i;
             COLOR_BLUE_PTR(color2) = i;
             COLOR_ALPHA_PTR(color2) = ((p & 0xf) << 4) | (p & 0xf);
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             i = p & 0xf0;
             i |= (i >> 4);
             COLOR_RED_PTR(color3) = i;
@@ -3108,21 +3075,21 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
             ands = s0 & 1;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             c0 = ands ? (p & 0xf) : (p >> 4);
             c0 |= (c0 << 4);
             COLOR_RED_PTR(color0) = COLOR_GREEN_PTR(color0) = COLOR_BLUE_PTR(color0) = COLOR_ALPHA_PTR(color0) = c0;
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             c2 = ands ? (p & 0xf) : (p >> 4);
             c2 |= (c2 << 4);
             COLOR_RED_PTR(color2) = COLOR_GREEN_PTR(color2) = COLOR_BLUE_PTR(color2) = COLOR_ALPHA_PTR(color2) = c2;
 
             ands = s1 & 1;
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             c1 = ands ? (p & 0xf) : (p >> 4);
             c1 |= (c1 << 4);
             COLOR_RED_PTR(color1) = COLOR_GREEN_PTR(color1) = COLOR_BLUE_PTR(color1) = COLOR_ALPHA_PTR(color1) = c1;
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             c3 = ands ? (p & 0xf) : (p >> 4);
             c3 |= (c3 << 4);
             COLOR_RED_PTR(color3) = COLOR_GREEN_PTR(color3) = COLOR_BLUE_PTR(color3) = COLOR_ALPHA_PTR(color3) = c3;
@@ -3147,22 +3114,22 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
             taddr1 &= 0xfff;
             taddr2 &= 0xfff;
             taddr3 &= 0xfff;
-            p = __TMEM[taddr0];
+            p = rdp->__TMEM[taddr0];
             COLOR_RED_PTR(color0) = p;
             COLOR_GREEN_PTR(color0) = p;
             COLOR_BLUE_PTR(color0) = p;
             COLOR_ALPHA_PTR(color0) = p;
-            p = __TMEM[taddr1];
+            p = rdp->__TMEM[taddr1];
             COLOR_RED_PTR(color1) = p;
             COLOR_GREEN_PTR(color1) = p;
             COLOR_BLUE_PTR(color1) = p;
             COLOR_ALPHA_PTR(color1) = p;
-            p = __TMEM[taddr2];
+            p = rdp->__TMEM[taddr2];
             COLOR_RED_PTR(color2) = p;
             COLOR_GREEN_PTR(color2) = p;
             COLOR_BLUE_PTR(color2) = p;
             COLOR_ALPHA_PTR(color2) = p;
-            p = __TMEM[taddr3];
+            p = rdp->__TMEM[taddr3];
             COLOR_RED_PTR(color3) = p;
             COLOR_GREEN_PTR(color3) = p;
             COLOR_BLUE_PTR(color3) = p;
@@ -3252,20 +3219,20 @@ static void fetch_texel_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLO
     }
 }
 
-static void fetch_texel_entlut_quadro(COLOR *color0, COLOR *color1, COLOR *color2, COLOR *color3, int s0, int s1, int t0, int t1, uint32_t tilenum)
+static void fetch_texel_entlut_quadro(struct rdp_state *rdp, COLOR *color0, COLOR *color1, COLOR *color2, COLOR *color3, int s0, int s1, int t0, int t1, uint32_t tilenum)
 {
-    uint32_t tbase0 = tile[tilenum].line * t0 + tile[tilenum].tmem;
-    uint32_t tbase2 = tile[tilenum].line * t1 + tile[tilenum].tmem;
-    uint32_t tpal    = tile[tilenum].palette << 4;
+    uint32_t tbase0 = rdp->tile[tilenum].line * t0 + rdp->tile[tilenum].tmem;
+    uint32_t tbase2 = rdp->tile[tilenum].line * t1 + rdp->tile[tilenum].tmem;
+    uint32_t tpal    = rdp->tile[tilenum].palette << 4;
     uint32_t xort = 0, ands = 0;
 
-    uint16_t *tc16 = (uint16_t*)__TMEM;
+    uint16_t *tc16 = (uint16_t*)rdp->__TMEM;
     uint32_t taddr0 = 0, taddr1 = 0, taddr2 = 0, taddr3 = 0;
     uint16_t c0, c1, c2, c3;
 
     
     
-    switch(tile[tilenum].f.tlutswitch)
+    switch(rdp->tile[tilenum].f.tlutswitch)
     {
     case 0:
     case 1:
@@ -3287,18 +3254,18 @@ static void fetch_texel_entlut_quadro(COLOR *color0, COLOR *color1, COLOR *color
                fprintf(stderr, "TPAL: %u\n", tpal);
 #endif
             ands = s0 & 1;
-            c0 = __TMEM[taddr0 & 0x7ff];
+            c0 = rdp->__TMEM[taddr0 & 0x7ff];
             c0 = (ands) ? (c0 & 0xf) : (c0 >> 4);
             c0 = tlut[((tpal + c0) << 2) + WORD_ADDR_XOR];
-            c2 = __TMEM[taddr2 & 0x7ff];
+            c2 = rdp->__TMEM[taddr2 & 0x7ff];
             c2 = (ands) ? (c2 & 0xf) : (c2 >> 4);
             c2 = tlut[((tpal + c2) << 2) + WORD_ADDR_XOR];
 
             ands = s1 & 1;
-            c1 = __TMEM[taddr1 & 0x7ff];
+            c1 = rdp->__TMEM[taddr1 & 0x7ff];
             c1 = (ands) ? (c1 & 0xf) : (c1 >> 4);
             c1 = tlut[((tpal + c1) << 2) + WORD_ADDR_XOR];
-            c3 = __TMEM[taddr3 & 0x7ff];
+            c3 = rdp->__TMEM[taddr3 & 0x7ff];
             c3 = (ands) ? (c3 & 0xf) : (c3 >> 4);
             c3 = tlut[((tpal + c3) << 2) + WORD_ADDR_XOR];
         }
@@ -3317,18 +3284,18 @@ static void fetch_texel_entlut_quadro(COLOR *color0, COLOR *color1, COLOR *color
             taddr3 ^= xort;
                                                             
             ands = s0 & 1;
-            c0 = __TMEM[taddr0 & 0x7ff];
+            c0 = rdp->__TMEM[taddr0 & 0x7ff];
             c0 = (ands) ? (c0 & 0xf) : (c0 >> 4);
             c0 = tlut[((tpal + c0) << 2) + WORD_ADDR_XOR];
-            c2 = __TMEM[taddr2 & 0x7ff];
+            c2 = rdp->__TMEM[taddr2 & 0x7ff];
             c2 = (ands) ? (c2 & 0xf) : (c2 >> 4);
             c2 = tlut[((tpal + c2) << 2) + WORD_ADDR_XOR];
 
             ands = s1 & 1;
-            c1 = __TMEM[taddr1 & 0x7ff];
+            c1 = rdp->__TMEM[taddr1 & 0x7ff];
             c1 = (ands) ? (c1 & 0xf) : (c1 >> 4);
             c1 = tlut[((tpal + c1) << 2) + WORD_ADDR_XOR];
-            c3 = __TMEM[taddr3 & 0x7ff];
+            c3 = rdp->__TMEM[taddr3 & 0x7ff];
             c3 = (ands) ? (c3 & 0xf) : (c3 >> 4);
             c3 = tlut[((tpal + c3) << 2) + WORD_ADDR_XOR];
         }
@@ -3351,13 +3318,13 @@ static void fetch_texel_entlut_quadro(COLOR *color0, COLOR *color1, COLOR *color
             taddr2 ^= xort;
             taddr3 ^= xort;
 
-            c0 = __TMEM[taddr0 & 0x7ff];
+            c0 = rdp->__TMEM[taddr0 & 0x7ff];
             c0 = tlut[(c0 << 2) + WORD_ADDR_XOR];
-            c2 = __TMEM[taddr2 & 0x7ff];
+            c2 = rdp->__TMEM[taddr2 & 0x7ff];
             c2 = tlut[(c2 << 2) + WORD_ADDR_XOR];
-            c1 = __TMEM[taddr1 & 0x7ff];
+            c1 = rdp->__TMEM[taddr1 & 0x7ff];
             c1 = tlut[(c1 << 2) + WORD_ADDR_XOR];
-            c3 = __TMEM[taddr3 & 0x7ff];
+            c3 = rdp->__TMEM[taddr3 & 0x7ff];
             c3 = tlut[(c3 << 2) + WORD_ADDR_XOR];
         }
         break;
@@ -3391,7 +3358,7 @@ static void fetch_texel_entlut_quadro(COLOR *color0, COLOR *color1, COLOR *color
         break;
     }
 
-    if (!other_modes.tlut_type)
+    if (!rdp->other_modes.tlut_type)
     {
         fetch_texel_quadro_rgba16(color0, color1, color2, color3, c0, c1, c2, c3);
     }
@@ -3422,7 +3389,7 @@ static void sort_tmem_idx(uint32_t *idx, uint32_t idxa, uint32_t idxb, uint32_t
         *idx = 0;
 }
 
-static void get_tmem_idx(int s, int t, uint32_t tilenum, uint32_t* idx0, uint32_t* idx1, uint32_t* idx2, uint32_t* idx3, uint32_t* bit3flipped, uint32_t* hibit)
+static void get_tmem_idx(struct rdp_state *rdp, int s, int t, uint32_t tilenum, uint32_t* idx0, uint32_t* idx1, uint32_t* idx2, uint32_t* idx3, uint32_t* bit3flipped, uint32_t* hibit)
 {
     uint32_t tbase;
     uint32_t tsize;
@@ -3430,10 +3397,10 @@ static void get_tmem_idx(int s, int t, uint32_t tilenum, uint32_t* idx0, uint32_
     uint32_t sshorts;
     int tidx_a, tidx_b, tidx_c, tidx_d;
 
-    tbase  = (tile[tilenum].line * t) & 0x000001FF;
-    tbase += tile[tilenum].tmem;
-    tsize = tile[tilenum].size;
-    tformat = tile[tilenum].format;
+    tbase  = (rdp->tile[tilenum].line * t) & 0x000001FF;
+    tbase += rdp->tile[tilenum].tmem;
+    tsize = rdp->tile[tilenum].size;
+    tformat = rdp->tile[tilenum].format;
     sshorts = 0;
 
     if (tsize == PIXEL_SIZE_8BIT || tformat == FORMAT_YUV)
@@ -3467,13 +3434,13 @@ static void get_tmem_idx(int s, int t, uint32_t tilenum, uint32_t* idx0, uint32_
     sort_tmem_idx(idx3, tidx_a, tidx_b, tidx_c, tidx_d, 3);
 }
 
-static void compute_color_index(uint32_t* cidx, uint32_t readshort, uint32_t nybbleoffset, uint32_t tilenum)
+static void compute_color_index(struct rdp_state *rdp, uint32_t* cidx, uint32_t readshort, uint32_t nybbleoffset, uint32_t tilenum)
 {
     uint32_t lownib, hinib;
-    if (tile[tilenum].size == PIXEL_SIZE_4BIT)
+    if (rdp->tile[tilenum].size == PIXEL_SIZE_4BIT)
     {
         lownib = (nybbleoffset ^ 3) << 2;
-        hinib = tile[tilenum].palette;
+        hinib = rdp->tile[tilenum].palette;
     }
     else
     {
@@ -3503,7 +3470,7 @@ static void sort_tmem_shorts_lowhalf(uint32_t* bindshort, uint32_t short0, uint3
     }
 }
 
-static void read_tmem_copy(int s, int s1, int s2, int s3, int t, uint32_t tilenum, uint32_t* sortshort, int* hibits, int* lowbits)
+static void read_tmem_copy(struct rdp_state *rdp, int s, int s1, int s2, int s3, int t, uint32_t tilenum, uint32_t* sortshort, int* hibits, int* lowbits)
 {
     uint32_t sortidx[8];
     uint32_t tbase;
@@ -3516,10 +3483,10 @@ static void read_tmem_copy(int s, int s1, int s2, int s3, int t, uint32_t tilenu
     int tidx_a, tidx_blow, tidx_bhi, tidx_c, tidx_dlow, tidx_dhi;
 
     delta = 0;
-    tbase  = (tile[tilenum].line * t) & 0x000001FF;
-    tbase += tile[tilenum].tmem;
-    tsize = tile[tilenum].size;
-    tformat = tile[tilenum].format;
+    tbase  = (rdp->tile[tilenum].line * t) & 0x000001FF;
+    tbase += rdp->tile[tilenum].tmem;
+    tsize = rdp->tile[tilenum].size;
+    tformat = rdp->tile[tilenum].format;
 
     if (tsize == PIXEL_SIZE_8BIT || tformat == FORMAT_YUV)
     {
@@ -3589,7 +3556,7 @@ static void read_tmem_copy(int s, int s1, int s2, int s3, int t, uint32_t tilenu
     lowbits[4] = tidx_dlow & 0xf;
     lowbits[5] = tidx_dhi & 0xf;
 
-    tmem16 = (uint16_t *)__TMEM;
+    tmem16 = (uint16_t *)rdp->__TMEM;
 
     tidx_a >>= 2;
     tidx_blow >>= 2;
@@ -3615,13 +3582,13 @@ static void read_tmem_copy(int s, int s1, int s2, int s3, int t, uint32_t tilenu
     sort_tmem_shorts_lowhalf(&sortshort[2], short0, short1, short2, short3, lowbits[3] >> 2);
     sort_tmem_shorts_lowhalf(&sortshort[3], short0, short1, short2, short3, lowbits[4] >> 2);
 
-    if (other_modes.en_tlut)
+    if (rdp->other_modes.en_tlut)
     {
          
-        compute_color_index(&short0, sortshort[0], lowbits[0] & 3, tilenum);
-        compute_color_index(&short1, sortshort[1], lowbits[1] & 3, tilenum);
-        compute_color_index(&short2, sortshort[2], lowbits[3] & 3, tilenum);
-        compute_color_index(&short3, sortshort[3], lowbits[4] & 3, tilenum);
+        compute_color_index(rdp, &short0, sortshort[0], lowbits[0] & 3, tilenum);
+        compute_color_index(rdp, &short1, sortshort[1], lowbits[1] & 3, tilenum);
+        compute_color_index(rdp, &short2, sortshort[2], lowbits[3] & 3, tilenum);
+        compute_color_index(rdp, &short3, sortshort[3], lowbits[4] & 3, tilenum);
 
         
         sortidx[4] = (short0 << 2);
@@ -3642,7 +3609,7 @@ static void read_tmem_copy(int s, int s1, int s2, int s3, int t, uint32_t tilenu
     short2 = tmem16[(sortidx[6] | 0x400) ^ WORD_ADDR_XOR];
     short3 = tmem16[(sortidx[7] | 0x400) ^ WORD_ADDR_XOR];
 
-    if (other_modes.en_tlut)
+    if (rdp->other_modes.en_tlut)
     {
         sort_tmem_shorts_lowhalf(&sortshort[4], short0, short1, short2, short3, 0);
         sort_tmem_shorts_lowhalf(&sortshort[5], short0, short1, short2, short3, 1);
@@ -3665,7 +3632,7 @@ static void read_tmem_copy(int s, int s1, int s2, int s3, int t, uint32_t tilenu
 
 
 
-static void replicate_for_copy(uint32_t* outbyte, uint32_t inshort, uint32_t nybbleoffset, uint32_t tilenum, uint32_t tformat, uint32_t tsize)
+static void replicate_for_copy(struct rdp_state *rdp, uint32_t* outbyte, uint32_t inshort, uint32_t nybbleoffset, uint32_t tilenum, uint32_t tformat, uint32_t tsize)
 {
     uint32_t lownib, hinib;
     switch(tsize)
@@ -3675,7 +3642,7 @@ static void replicate_for_copy(uint32_t* outbyte, uint32_t inshort, uint32_t nyb
         lownib = hinib = (inshort >> lownib) & 0xf;
         if (tformat == FORMAT_CI)
         {
-            *outbyte = (tile[tilenum].palette << 4) | lownib;
+            *outbyte = (rdp->tile[tilenum].palette << 4) | lownib;
         }
         else if (tformat == FORMAT_IA)
         {
@@ -3705,16 +3672,16 @@ static void replicate_for_copy(uint32_t* outbyte, uint32_t inshort, uint32_t nyb
     }
 }
 
-static void tc_pipeline_copy(int32_t* sss0, int32_t* sss1, int32_t* sss2, int32_t* sss3, int32_t* sst, int tilenum)                                            
+static void tc_pipeline_copy(struct rdp_state *rdp, int32_t* sss0, int32_t* sss1, int32_t* sss2, int32_t* sss3, int32_t* sst, int tilenum)                                            
 {
     int ss0 = *sss0, ss1 = 0, ss2 = 0, ss3 = 0, st = *sst;
 
-    tcshift_copy(&ss0, &st, tilenum);
+    tcshift_copy(rdp, &ss0, &st, tilenum);
     
     
 
-    ss0 = TRELATIVE(ss0, tile[tilenum].sl);
-    st = TRELATIVE(st, tile[tilenum].tl);
+    ss0 = TRELATIVE(ss0, rdp->tile[tilenum].sl);
+    st = TRELATIVE(st, rdp->tile[tilenum].tl);
     ss0 = (ss0 >> 5);
     st = (st >> 5);
 
@@ -3722,7 +3689,7 @@ static void tc_pipeline_copy(int32_t* sss0, int32_t* sss1, int32_t* sss2, int32_
     ss2 = ss0 + 2;
     ss3 = ss0 + 3;
 
-    tcmask_copy(&ss0, &ss1, &ss2, &ss3, &st, tilenum);    
+    tcmask_copy(rdp, &ss0, &ss1, &ss2, &ss3, &st, tilenum);    
 
     *sss0 = ss0;
     *sss1 = ss1;
@@ -3731,7 +3698,7 @@ static void tc_pipeline_copy(int32_t* sss0, int32_t* sss1, int32_t* sss2, int32_
     *sst = st;
 }
 
-static void fetch_qword_copy(uint32_t* hidword, uint32_t* lowdword, int32_t ssss, int32_t ssst, uint32_t tilenum)
+static void fetch_qword_copy(struct rdp_state *rdp, uint32_t* hidword, uint32_t* lowdword, int32_t ssss, int32_t ssst, uint32_t tilenum)
 {
     uint32_t shorta, shortb, shortc, shortd;
     uint32_t sortshort[8];
@@ -3741,23 +3708,23 @@ static void fetch_qword_copy(uint32_t* hidword, uint32_t* lowdword, int32_t ssss
     int largetex = 0;
 
     uint32_t tformat, tsize;
-    if (other_modes.en_tlut)
+    if (rdp->other_modes.en_tlut)
     {
         tsize = PIXEL_SIZE_16BIT;
-        tformat = other_modes.tlut_type ? FORMAT_IA : FORMAT_RGBA;
+        tformat = rdp->other_modes.tlut_type ? FORMAT_IA : FORMAT_RGBA;
     }
     else
     {
-        tsize = tile[tilenum].size;
-        tformat = tile[tilenum].format;
+        tsize = rdp->tile[tilenum].size;
+        tformat = rdp->tile[tilenum].format;
     }
 
-    tc_pipeline_copy(&sss, &sss1, &sss2, &sss3, &sst, tilenum);
-    read_tmem_copy(sss, sss1, sss2, sss3, sst, tilenum, sortshort, hibits, lowbits);
+    tc_pipeline_copy(rdp, &sss, &sss1, &sss2, &sss3, &sst, tilenum);
+    read_tmem_copy(rdp, sss, sss1, sss2, sss3, sst, tilenum, sortshort, hibits, lowbits);
     largetex = (tformat == FORMAT_YUV || (tformat == FORMAT_RGBA && tsize == PIXEL_SIZE_32BIT));
 
     
-    if (other_modes.en_tlut)
+    if (rdp->other_modes.en_tlut)
     {
         shorta = sortshort[4];
         shortb = sortshort[5];
@@ -3785,10 +3752,10 @@ static void fetch_qword_copy(uint32_t* hidword, uint32_t* lowdword, int32_t ssss
         *hidword = (shorta << 16) | shortb;
     else
     {
-        replicate_for_copy(&shorta, shorta, lowbits[0] & 3, tilenum, tformat, tsize);
-        replicate_for_copy(&shortb, shortb, lowbits[1] & 3, tilenum, tformat, tsize);
-        replicate_for_copy(&shortc, shortc, lowbits[3] & 3, tilenum, tformat, tsize);
-        replicate_for_copy(&shortd, shortd, lowbits[4] & 3, tilenum, tformat, tsize);
+        replicate_for_copy(rdp, &shorta, shorta, lowbits[0] & 3, tilenum, tformat, tsize);
+        replicate_for_copy(rdp, &shortb, shortb, lowbits[1] & 3, tilenum, tformat, tsize);
+        replicate_for_copy(rdp, &shortc, shortc, lowbits[3] & 3, tilenum, tformat, tsize);
+        replicate_for_copy(rdp, &shortd, shortd, lowbits[4] & 3, tilenum, tformat, tsize);
         *hidword = (shorta << 24) | (shortb << 16) | (shortc << 8) | shortd;
     }
 }
@@ -3801,34 +3768,95 @@ void angrylion_set_filtering(unsigned filter_type)
 }
 
 
-static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t SST, uint32_t tilenum, uint32_t cycle)                                            
+/*
+ * Every three-point filter variant has the form
+ *     TEX = base + ((fs * (ts - origin) + ft * (tt - origin) + round) >> shift)
+ * with the rounding term replaced by ((~t0 + t3) << 6) + 0xc0 for mid-texel
+ * filtering (`mid` non-NULL).  The four channels are the SIMD lanes.  Texels
+ * are at most 9 bits wide, so the 16-bit differences cannot wrap and
+ * PMADDWD computes both products exactly.
+ */
+static STRICTINLINE void texture_bilerp(COLOR *TEX, const COLOR *origin, const COLOR *ts, const COLOR *tt, int32_t fs, int32_t ft, const COLOR *base, const COLOR *mid, int shift)
 {
-    int32_t maxs, maxt, invt0r, invt0g, invt0b, invt0a;
+#if defined(USE_SSE_SUPPORT)
+    __m128i o, ds, dt, sum, round, b;
+
+    o  = _mm_loadl_epi64((const __m128i *)origin);
+    ds = _mm_sub_epi16(_mm_loadl_epi64((const __m128i *)ts), o);
+    dt = _mm_sub_epi16(_mm_loadl_epi64((const __m128i *)tt), o);
+    sum = _mm_madd_epi16(_mm_unpacklo_epi16(ds, dt),
+        _mm_set1_epi32((ft << 16) | (fs & 0xffff)));
+
+    if (!mid)
+        round = _mm_set1_epi32(1 << (shift - 1));
+    else
+    {
+        __m128i m = _mm_sub_epi16(
+            _mm_loadl_epi64((const __m128i *)mid), _mm_add_epi16(o, _mm_set1_epi16(1)));
+        round = _mm_srai_epi32(_mm_unpacklo_epi16(m, m), 16);
+        round = _mm_add_epi32(_mm_slli_epi32(round, 6), _mm_set1_epi32(0xc0));
+    }
+    sum = _mm_sra_epi32(_mm_add_epi32(sum, round), _mm_cvtsi32_si128(shift));
+
+    b = _mm_loadl_epi64((const __m128i *)base);
+    sum = _mm_add_epi32(sum, _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16));
+    sum = _mm_srai_epi32(_mm_slli_epi32(sum, 16), 16);
+    _mm_storel_epi64((__m128i *)TEX, _mm_packs_epi32(sum, sum));
+#elif defined(USE_NEON_SUPPORT)
+    int16x4_t o = vld1_s16(origin->col);
+    int32x4_t sum, round;
+
+    sum = vmulq_n_s32(vsubl_s16(vld1_s16(ts->col), o), fs);
+    sum = vmlaq_n_s32(sum, vsubl_s16(vld1_s16(tt->col), o), ft);
+    if (!mid)
+        round = vdupq_n_s32(1 << (shift - 1));
+    else
+    {
+        round = vsubl_s16(vld1_s16(mid->col), o);
+        round = vaddq_s32(vshlq_n_s32(vsubq_s32(round, vdupq_n_s32(1)), 6), vdupq_n_s32(0xc0));
+    }
+    sum = vshlq_s32(vaddq_s32(sum, round), vdupq_n_s32(-shift));
+    sum = vaddq_s32(sum, vmovl_s16(vld1_s16(base->col)));
+    vst1_s16(TEX->col, vmovn_s32(sum));
+#else
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        int32_t round = mid ? ((~origin->col[i] + mid->col[i]) << 6) + 0xc0 : 1 << (shift - 1);
+        TEX->col[i] = base->col[i] + (((fs * (ts->col[i] - origin->col[i])) + (ft * (tt->col[i] - origin->col[i])) + round) >> shift);
+    }
+#endif
+}
+
+static void texture_pipeline_cycle(struct rdp_state *rdp, COLOR* TEX, COLOR* prev, int32_t SSS, int32_t SST, uint32_t tilenum, uint32_t cycle)                                            
+{
+    int32_t maxs, maxt;
     int32_t sfrac, tfrac, invsf, invtf;
     int upper = 0;
-    int bilerp = cycle ? other_modes.bi_lerp1 : other_modes.bi_lerp0;
-    int convert = other_modes.convert_one && cycle;
-    COLOR t0, t1, t2, t3;
+    int bilerp = cycle ? rdp->other_modes.bi_lerp1 : rdp->other_modes.bi_lerp0;
+    int convert = rdp->other_modes.convert_one && cycle;
+    COLOR t0, t1, t2, t3, tb;
     int sss1, sst1, sss2, sst2;
 
     sss1 = SSS;
     sst1 = SST;
 
-    tcshift_cycle(&sss1, &sst1, &maxs, &maxt, tilenum);
+    tcshift_cycle(rdp, &sss1, &sst1, &maxs, &maxt, tilenum);
 
-    sss1 = TRELATIVE(sss1, tile[tilenum].sl);
-    sst1 = TRELATIVE(sst1, tile[tilenum].tl);
+    sss1 = TRELATIVE(sss1, rdp->tile[tilenum].sl);
+    sst1 = TRELATIVE(sst1, rdp->tile[tilenum].tl);
 
-    if (other_modes.sample_type 
+    if (rdp->other_modes.sample_type 
           && angrylion_filtering != 2)
     {    
         sfrac = sss1 & 0x1f;
         tfrac = sst1 & 0x1f;
 
-        tcclamp_cycle(&sss1, &sst1, &sfrac, &tfrac, maxs, maxt, tilenum);
+        tcclamp_cycle(rdp, &sss1, &sst1, &sfrac, &tfrac, maxs, maxt, tilenum);
         
     
-        if (tile[tilenum].format != FORMAT_YUV)
+        if (rdp->tile[tilenum].format != FORMAT_YUV)
             sss2 = sss1 + 1;
         else
             sss2 = sss1 + 2;
@@ -3840,7 +3868,7 @@ static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t
         
 
         
-        tcmask_coupled(&sss1, &sss2, &sst1, &sst2, tilenum);
+        tcmask_coupled(rdp, &sss1, &sss2, &sst1, &sst2, tilenum);
         
         
 
@@ -3853,102 +3881,67 @@ static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t
         if (bilerp)
         {
             
-            if (!other_modes.en_tlut)
-                fetch_texel_quadro(&t0, &t1, &t2, &t3, sss1, sss2, sst1, sst2, tilenum);
+            if (!rdp->other_modes.en_tlut)
+                fetch_texel_quadro(rdp, &t0, &t1, &t2, &t3, sss1, sss2, sst1, sst2, tilenum);
             else
-                fetch_texel_entlut_quadro(&t0, &t1, &t2, &t3, sss1, sss2, sst1, sst2, tilenum);
+                fetch_texel_entlut_quadro(rdp, &t0, &t1, &t2, &t3, sss1, sss2, sst1, sst2, tilenum);
+
+            if (convert)
+            {
+                COLOR_RED(tb) = COLOR_GREEN(tb) = COLOR_BLUE(tb) = COLOR_ALPHA(tb) = COLOR_BLUE_PTR(prev);
+            }
 
-            if (!other_modes.mid_texel || sfrac != 0x10 || tfrac != 0x10)
+            if (!rdp->other_modes.mid_texel || sfrac != 0x10 || tfrac != 0x10)
             {
                 if (!convert)
                 {
-
                     if (UPPER)
                     {
-                        
                         invsf = 0x20 - sfrac;
                         invtf = 0x20 - tfrac;
-                        COLOR_RED_PTR(TEX) = COLOR_RED(t3) + ((((invsf * (COLOR_RED(t2) - COLOR_RED(t3))) + (invtf * (COLOR_RED(t1) - COLOR_RED(t3)))) + 0x10) >> 5);    
-                        COLOR_GREEN_PTR(TEX) = COLOR_GREEN(t3) + ((((invsf * (COLOR_GREEN(t2) - COLOR_GREEN(t3))) + (invtf * (COLOR_GREEN(t1) - COLOR_GREEN(t3)))) + 0x10) >> 5);                                                                        
-                        COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t3) + ((((invsf * (COLOR_BLUE(t2) - COLOR_BLUE(t3))) + (invtf * (COLOR_BLUE(t1) - COLOR_BLUE(t3)))) + 0x10) >> 5);                                                                
-                        COLOR_ALPHA_PTR(TEX) = COLOR_ALPHA(t3) + ((((invsf * (COLOR_ALPHA(t2) - COLOR_ALPHA(t3))) + (invtf * (COLOR_ALPHA(t1) - COLOR_ALPHA(t3)))) + 0x10) >> 5);
+                        texture_bilerp(TEX, &t3, &t2, &t1, invsf, invtf, &t3, NULL, 5);
                     }
                     else
-                    {
-                       COLOR_RED_PTR(TEX) = COLOR_RED(t0) + ((((sfrac * (COLOR_RED(t1) - COLOR_RED(t0))) + (tfrac * (COLOR_RED(t2) - COLOR_RED(t0)))) + 0x10) >> 5);                                            
-                       COLOR_GREEN_PTR(TEX) = COLOR_GREEN(t0) + ((((sfrac * (COLOR_GREEN(t1) - COLOR_GREEN(t0))) + (tfrac * (COLOR_GREEN(t2) - COLOR_GREEN(t0)))) + 0x10) >> 5);                                            
-                       COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t0) + ((((sfrac * (COLOR_BLUE(t1) - COLOR_BLUE(t0))) + (tfrac * (COLOR_BLUE(t2) - COLOR_BLUE(t0)))) + 0x10) >> 5);                                    
-                       COLOR_ALPHA_PTR(TEX) = COLOR_ALPHA(t0) + ((((sfrac * (COLOR_ALPHA(t1) - COLOR_ALPHA(t0))) + (tfrac * (COLOR_ALPHA(t2) - COLOR_ALPHA(t0)))) + 0x10) >> 5);
-                    }
+                        texture_bilerp(TEX, &t0, &t1, &t2, sfrac, tfrac, &t0, NULL, 5);
                 }
                 else
                 {
-
                     if (UPPER)
-                    {
-                       COLOR_RED_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_RED(t2) - COLOR_RED(t3))) + (COLOR_GREEN_PTR(prev) * (COLOR_RED(t1) - COLOR_RED(t3)))) + 0x80) >> 8);    
-                       COLOR_GREEN_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_GREEN(t2) - COLOR_GREEN(t3))) + (COLOR_GREEN_PTR(prev) * (COLOR_GREEN(t1) - COLOR_GREEN(t3)))) + 0x80) >> 8);                                                                        
-                       COLOR_BLUE_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_BLUE(t2) - COLOR_BLUE(t3))) + (COLOR_GREEN_PTR(prev) * (COLOR_BLUE(t1) - COLOR_BLUE(t3)))) + 0x80) >> 8);                                                                
-                       COLOR_ALPHA_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_ALPHA(t2) - COLOR_ALPHA(t3))) + (COLOR_GREEN_PTR(prev) * (COLOR_ALPHA(t1) - COLOR_ALPHA(t3)))) + 0x80) >> 8);
-                    }
+                        texture_bilerp(TEX, &t3, &t2, &t1, COLOR_RED_PTR(prev), COLOR_GREEN_PTR(prev), &tb, NULL, 8);
                     else
-                    {
-                        COLOR_RED_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_RED(t1) - COLOR_RED(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_RED(t2) - COLOR_RED(t0)))) + 0x80) >> 8);                                            
-                        COLOR_GREEN_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_GREEN(t1) - COLOR_GREEN(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_GREEN(t2) - COLOR_GREEN(t0)))) + 0x80) >> 8);                                            
-                        COLOR_BLUE_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_BLUE(t1) - COLOR_BLUE(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_BLUE(t2) - COLOR_BLUE(t0)))) + 0x80) >> 8);                                    
-                        COLOR_ALPHA_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_ALPHA(t1) - COLOR_ALPHA(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_ALPHA(t2) - COLOR_ALPHA(t0)))) + 0x80) >> 8);
-                    }    
+                        texture_bilerp(TEX, &t0, &t1, &t2, COLOR_RED_PTR(prev), COLOR_GREEN_PTR(prev), &tb, NULL, 8);
                 }
-                
             }
             else
             {
-               invt0r  = ~COLOR_RED(t0);
-               invt0g  = ~COLOR_GREEN(t0);
-               invt0b  = ~COLOR_BLUE(t0);
-               invt0a  = ~COLOR_ALPHA(t0);
-
                 if (!convert)
-                {
-                    sfrac <<= 2;
-                    tfrac <<= 2;
-
-                    COLOR_RED_PTR(TEX) = COLOR_RED(t0) + ((((sfrac * (COLOR_RED(t1) - COLOR_RED(t0))) + (tfrac * (COLOR_RED(t2) - COLOR_RED(t0)))) + ((invt0r + COLOR_RED(t3)) << 6) + 0xc0) >> 8);                                            
-                    COLOR_GREEN_PTR(TEX) = COLOR_GREEN(t0) + ((((sfrac * (COLOR_GREEN(t1) - COLOR_GREEN(t0))) + (tfrac * (COLOR_GREEN(t2) - COLOR_GREEN(t0)))) + ((invt0g + COLOR_GREEN(t3)) << 6) + 0xc0) >> 8);                                            
-                    COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t0) + ((((sfrac * (COLOR_BLUE(t1) - COLOR_BLUE(t0))) + (tfrac * (COLOR_BLUE(t2) - COLOR_BLUE(t0)))) + ((invt0b + COLOR_BLUE(t3)) << 6) + 0xc0) >> 8);                                    
-                    COLOR_ALPHA_PTR(TEX) = COLOR_ALPHA(t0) + ((((sfrac * (COLOR_ALPHA(t1) - COLOR_ALPHA(t0))) + (tfrac * (COLOR_ALPHA(t2) - COLOR_ALPHA(t0)))) + ((invt0a + COLOR_ALPHA(t3)) << 6) + 0xc0) >> 8);
-                }
+                    texture_bilerp(TEX, &t0, &t1, &t2, sfrac << 2, tfrac << 2, &t0, &t3, 8);
                 else
-                {
-            COLOR_RED_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_RED(t1) - COLOR_RED(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_RED(t2) - COLOR_RED(t0)))) + ((invt0r + COLOR_RED(t3)) << 6) + 0xc0) >> 8);                                            
-            COLOR_GREEN_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_GREEN(t1) - COLOR_GREEN(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_GREEN(t2) - COLOR_GREEN(t0)))) + ((invt0g + COLOR_GREEN(t3)) << 6) + 0xc0) >> 8);                                            
-            COLOR_BLUE_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_BLUE(t1) - COLOR_BLUE(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_BLUE(t2) - COLOR_BLUE(t0)))) + ((invt0b + COLOR_BLUE(t3)) << 6) + 0xc0) >> 8);                                    
-            COLOR_ALPHA_PTR(TEX) = COLOR_BLUE_PTR(prev) + ((((COLOR_RED_PTR(prev) * (COLOR_ALPHA(t1) - COLOR_ALPHA(t0))) + (COLOR_GREEN_PTR(prev) * (COLOR_ALPHA(t2) - COLOR_ALPHA(t0)))) + ((invt0a + COLOR_ALPHA(t3)) << 6) + 0xc0) >> 8);
-                }
+                    texture_bilerp(TEX, &t0, &t1, &t2, COLOR_RED_PTR(prev), COLOR_GREEN_PTR(prev), &tb, &t3, 8);
             }
             
         }
         else
         {
-            if (!other_modes.en_tlut)
-                fetch_texel(&t0, sss1, sst1, tilenum);
+            if (!rdp->other_modes.en_tlut)
+                fetch_texel(rdp, &t0, sss1, sst1, tilenum);
             else
-                fetch_texel_entlut(&t0, sss1, sst1, tilenum);
+                fetch_texel_entlut(rdp, &t0, sss1, sst1, tilenum);
             if (convert)
             {
                 t0 = *prev;
             }
 
-            if (tile[tilenum].format == FORMAT_YUV)
+            if (rdp->tile[tilenum].format == FORMAT_YUV)
             {
                COLOR_RED(t0)   = SIGN(COLOR_RED(t0), 9);
                COLOR_GREEN(t0) = SIGN(COLOR_GREEN(t0), 9);
             }
 
 
-            COLOR_RED_PTR(TEX) = COLOR_BLUE(t0) + ((k0_tf * COLOR_GREEN(t0) + 0x80) >> 8);
-            COLOR_GREEN_PTR(TEX) = COLOR_BLUE(t0) + ((k1_tf * COLOR_RED(t0) + k2_tf * COLOR_GREEN(t0) + 0x80) >> 8);
-            COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t0) + ((k3_tf * COLOR_RED(t0) + 0x80) >> 8);
+            COLOR_RED_PTR(TEX) = COLOR_BLUE(t0) + ((rdp->k0_tf * COLOR_GREEN(t0) + 0x80) >> 8);
+            COLOR_GREEN_PTR(TEX) = COLOR_BLUE(t0) + ((rdp->k1_tf * COLOR_RED(t0) + rdp->k2_tf * COLOR_GREEN(t0) + 0x80) >> 8);
+            COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t0) + ((rdp->k3_tf * COLOR_RED(t0) + 0x80) >> 8);
             COLOR_ALPHA_PTR(TEX) = COLOR_BLUE(t0);
         }
         
@@ -3963,15 +3956,15 @@ static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t
         
         
 
-        tcclamp_cycle_light(&sss1, &sst1, maxs, maxt, tilenum);
+        tcclamp_cycle_light(rdp, &sss1, &sst1, maxs, maxt, tilenum);
         
-        tcmask(&sss1, &sst1, tilenum);    
+        tcmask(rdp, &sss1, &sst1, tilenum);    
                                                                                                         
             
-        if (!other_modes.en_tlut)
-            fetch_texel(&t0, sss1, sst1, tilenum);
+        if (!rdp->other_modes.en_tlut)
+            fetch_texel(rdp, &t0, sss1, sst1, tilenum);
         else
-            fetch_texel_entlut(&t0, sss1, sst1, tilenum);
+            fetch_texel_entlut(rdp, &t0, sss1, sst1, tilenum);
         
         if (bilerp)
         {
@@ -3989,15 +3982,15 @@ static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t
                 t0 = *prev;
             }
             
-            if (tile[tilenum].format == FORMAT_YUV)
+            if (rdp->tile[tilenum].format == FORMAT_YUV)
             {
                COLOR_RED(t0)   = SIGN(COLOR_RED(t0), 9); 
                COLOR_GREEN(t0) = SIGN(COLOR_GREEN(t0), 9);
             }
 
-            COLOR_RED_PTR(TEX) = COLOR_BLUE(t0) + ((k0_tf * COLOR_GREEN(t0) + 0x80) >> 8);
-            COLOR_GREEN_PTR(TEX) = COLOR_BLUE(t0) + ((k1_tf * COLOR_RED(t0) + k2_tf * COLOR_GREEN(t0) + 0x80) >> 8);
-            COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t0) + ((k3_tf * COLOR_RED(t0) + 0x80) >> 8);
+            COLOR_RED_PTR(TEX) = COLOR_BLUE(t0) + ((rdp->k0_tf * COLOR_GREEN(t0) + 0x80) >> 8);
+            COLOR_GREEN_PTR(TEX) = COLOR_BLUE(t0) + ((rdp->k1_tf * COLOR_RED(t0) + rdp->k2_tf * COLOR_GREEN(t0) + 0x80) >> 8);
+            COLOR_BLUE_PTR(TEX) = COLOR_BLUE(t0) + ((rdp->k3_tf * COLOR_RED(t0) + 0x80) >> 8);
             COLOR_ALPHA_PTR(TEX) = COLOR_BLUE(t0);
             COLOR_RED_PTR(TEX) &= 0x1ff;
             COLOR_GREEN_PTR(TEX) &= 0x1ff;
@@ -4009,15 +4002,15 @@ static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t
 }
 
 
-static STRICTINLINE void tc_pipeline_load(int32_t* sss, int32_t* sst, int tilenum, int coord_quad)
+static STRICTINLINE void tc_pipeline_load(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int tilenum, int coord_quad)
 {
     int sss1 = *sss, sst1 = *sst;
     sss1 = SIGN16(sss1);
     sst1 = SIGN16(sst1);
 
     
-    sss1 = TRELATIVE(sss1, tile[tilenum].sl);
-    sst1 = TRELATIVE(sst1, tile[tilenum].tl);
+    sss1 = TRELATIVE(sss1, rdp->tile[tilenum].sl);
+    sst1 = TRELATIVE(sst1, rdp->tile[tilenum].tl);
     
 
     
@@ -4118,9 +4111,9 @@ static INLINE void tcdiv_persp(int32_t ss, int32_t st, int32_t sw, int32_t* sss,
     *sst = (tempt & 0x1ffff) | overunder_t;
 }
 
-static INLINE void tcdiv(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst)
+static INLINE void tcdiv(struct rdp_state *rdp, int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst)
 {
-   if (other_modes.persp_tex_en)
+   if (rdp->other_modes.persp_tex_en)
       tcdiv_persp(ss, st, sw, sss, sst);
    else
       tcdiv_nopersp(ss, st, sw, sss, sst);
@@ -4142,127 +4135,105 @@ static STRICTINLINE uint32_t leftcvghex(uint32_t x, uint32_t fmask)
     return (covered & fmask);
 }
 
-static STRICTINLINE void compute_cvg_flip(int32_t scanline)
-{
-   int i, fmask, maskshift, fmaskshifted;
-   int32_t minorcur, majorcur, minorcurint, majorcurint, samecvg;
-   int32_t purgestart = span[scanline].rx;
-   int32_t   purgeend = span[scanline].lx;
-   int         length = purgeend - purgestart;
-
-   if (length >= 0)
-   {
-
-
-
-
-
-
-      memset(&cvgbuf[purgestart], 0xff, length + 1);
-      for(i = 0; i < 4; i++)
-      {
-         int k;
-         fmask = 0xa >> (i & 1);
-
-
-
-
-         maskshift = (i - 2) & 4;
-         fmaskshifted = fmask << maskshift;
-
-         if (!span[scanline].invalyscan[i])
-         {
-
-            minorcur = span[scanline].minorx[i];
-            majorcur = span[scanline].majorx[i];
-            minorcurint = minorcur >> 3;
-            majorcurint = majorcur >> 3;
-
-
-            for (k = purgestart; k <= majorcurint; k++)
-               cvgbuf[k] &= ~fmaskshifted;
-            for (k = minorcurint; k <= purgeend; k++)
-               cvgbuf[k] &= ~fmaskshifted;
-
+/*
+ * Each of the four subscanlines owns two bits of every cvgbuf byte and
+ * covers one interval of the span, with partial coverage only on its two
+ * edge pixels.  So the row is constant between at most eight interval ends:
+ * fill those runs with memset and patch the edge pixels in afterwards.
+ */
+static STRICTINLINE void compute_cvg(struct rdp_state *rdp, int32_t scanline, int flip)
+{
+    const SPAN *span = &rdp->span[scanline];
+    const int32_t purgestart = flip ? span->rx : span->lx;
+    const int32_t purgeend   = flip ? span->lx : span->rx;
+    int32_t left[4], right[4], inner_start[4], inner_end[4];
+    int32_t edges[10];
+    int num_edges;
+    int i, j;
 
+    if (purgeend < purgestart)
+        return;
 
+    edges[0] = purgestart;
+    edges[1] = purgeend + 1;
+    num_edges = 2;
+    for (i = 0; i < 4; i++)
+    {
+        inner_start[i] = purgeend + 1;
+        inner_end[i] = purgeend;
+        if (span->invalyscan[i])
+        {
+            left[i] = 0;
+            right[i] = -8;
+            continue;
+        }
+        left[i]  = flip ? span->majorx[i] : span->minorx[i];
+        right[i] = flip ? span->minorx[i] : span->majorx[i];
+        if ((right[i] >> 3) - (left[i] >> 3) < 2)
+            continue;
 
+        inner_start[i] = (left[i] >> 3) + 1;
+        inner_end[i] = (right[i] >> 3) - 1;
+        if (inner_start[i] < purgestart)
+            inner_start[i] = purgestart;
+        if (inner_end[i] > purgeend)
+            inner_end[i] = purgeend;
+        if (inner_start[i] > inner_end[i])
+            continue;
+        edges[num_edges++] = inner_start[i];
+        edges[num_edges++] = inner_end[i] + 1;
+    }
 
+    for (i = 1; i < num_edges; i++)
+    {
+        const int32_t edge = edges[i];
 
+        for (j = i; j > 0 && edges[j - 1] > edge; j--)
+            edges[j] = edges[j - 1];
+        edges[j] = edge;
+    }
 
+    for (i = 0; i + 1 < num_edges; i++)
+    {
+        const int32_t start = edges[i];
+        uint8_t fill = 0x00;
 
+        if (edges[i + 1] == start)
+            continue;
+        for (j = 0; j < 4; j++)
+            if (start >= inner_start[j] && start <= inner_end[j])
+                fill |= (0xa >> (j & 1)) << ((j - 2) & 4);
+        memset(&rdp->cvgbuf[start], fill, edges[i + 1] - start);
+    }
 
-            if (minorcurint > majorcurint)
-            {
-               cvgbuf[minorcurint] |= (rightcvghex(minorcur, fmask) << maskshift);
-               cvgbuf[majorcurint] |= (leftcvghex(majorcur, fmask) << maskshift);
-            }
-            else if (minorcurint == majorcurint)
-            {
-               samecvg = rightcvghex(minorcur, fmask) & leftcvghex(majorcur, fmask);
-               cvgbuf[majorcurint] |= (samecvg << maskshift);
-            }
-         }
-         else
-         {
-            for (k = purgestart; k <= purgeend; k++)
-               cvgbuf[k] &= ~fmaskshifted;
-         }
+    for (i = 0; i < 4; i++)
+    {
+        const uint32_t fmask = 0xa >> (i & 1);
+        const int maskshift = (i - 2) & 4;
+        const int32_t leftint = left[i] >> 3;
+        const int32_t rightint = right[i] >> 3;
 
-      }
-   }
+        if (rightint > leftint)
+        {
+            if (leftint >= purgestart && leftint <= purgeend)
+                rdp->cvgbuf[leftint] |= leftcvghex(left[i], fmask) << maskshift;
+            if (rightint >= purgestart && rightint <= purgeend)
+                rdp->cvgbuf[rightint] |= rightcvghex(right[i], fmask) << maskshift;
+        }
+        else if (rightint == leftint && leftint >= purgestart && leftint <= purgeend)
+            rdp->cvgbuf[leftint] |=
+                (leftcvghex(left[i], fmask) & rightcvghex(right[i], fmask)) << maskshift;
+    }
 }
 
-static STRICTINLINE void compute_cvg_noflip(int32_t scanline)
+static STRICTINLINE void compute_cvg_flip(struct rdp_state *rdp, int32_t scanline)
 {
-	int i, fmask, maskshift, fmaskshifted;
-	int32_t minorcur, majorcur, minorcurint, majorcurint, samecvg;
-	int32_t purgestart = span[scanline].lx;
-	int32_t purgeend   = span[scanline].rx;
-	int         length = purgeend - purgestart;
-
-	if (length >= 0)
-	{
-		memset(&cvgbuf[purgestart], 0xff, length + 1);
+    compute_cvg(rdp, scanline, 1);
+}
 
-		for(i = 0; i < 4; i++)
-		{
-         int k;
-
-			fmask = 0xa >> (i & 1);
-			maskshift = (i - 2) & 4;
-			fmaskshifted = fmask << maskshift;
-
-			if (!span[scanline].invalyscan[i])
-			{
-				minorcur = span[scanline].minorx[i];
-				majorcur = span[scanline].majorx[i];
-				minorcurint = minorcur >> 3;
-				majorcurint = majorcur >> 3;
-								
-				for (k = purgestart; k <= minorcurint; k++)
-					cvgbuf[k] &= ~fmaskshifted;
-				for (k = majorcurint; k <= purgeend; k++)
-					cvgbuf[k] &= ~fmaskshifted;
-
-				if (majorcurint > minorcurint)
-				{
-					cvgbuf[minorcurint] |= (leftcvghex(minorcur, fmask) << maskshift);
-					cvgbuf[majorcurint] |= (rightcvghex(majorcur, fmask) << maskshift);
-				}
-				else if (minorcurint == majorcurint)
-				{
-					samecvg = leftcvghex(minorcur, fmask) & rightcvghex(majorcur, fmask);
-					cvgbuf[majorcurint] |= (samecvg << maskshift);
-				}
-			}
-			else
-			{
-				for (k = purgestart; k <= purgeend; k++)
-					cvgbuf[k] &= ~fmaskshifted;
-			}
-		}
-	}
+static STRICTINLINE void compute_cvg_noflip(struct rdp_state *rdp, int32_t scanline)
+{
+    compute_cvg(rdp, scanline, 0);
 }
 
 static STRICTINLINE uint32_t dz_compress(uint32_t value)
@@ -4279,17 +4250,32 @@ static STRICTINLINE uint32_t dz_compress(uint32_t value)
     return j;
 }
 
+/* the index of the highest set bit of a 16-bit delta z */
+static STRICTINLINE uint32_t dz_log2(uint32_t value)
+{
+    return (value & 0xff00) ? 8 + log2table[value >> 8] : log2table[value];
+}
+
+static STRICTINLINE uint32_t z_compress(uint32_t z)
+{
+    const uint32_t exponent = z_com_table[(z >> 11) & 0x7f];
+
+    return (((z << 2) >> z_dec_table[exponent].shift) & 0x1ffc) | (exponent << 13);
+}
+
 static STRICTINLINE void z_store(uint32_t zcurpixel, uint32_t z, int dzpixenc)
 {
-    uint16_t zval = z_com_table[z & 0x3ffff]|(dzpixenc >> 2);
+    uint16_t zval = z_compress(z & 0x3ffff)|(dzpixenc >> 2);
     uint8_t hval = dzpixenc & 3;
     PAIRWRITE16(zcurpixel, zval, hval);
 }
 
 static STRICTINLINE uint32_t z_decompress(uint32_t zb)
 {
-    zb &= 0x0000FFFF;
-    return (z_complete_dec_table[zb >> 2]);
+    const uint32_t exponent = (zb >> 13) & 7;
+    const uint32_t mantissa = (zb >> 2) & 0x7ff;
+
+    return (mantissa << z_dec_table[exponent].shift) + z_dec_table[exponent].add;
 }
 
 static STRICTINLINE uint32_t dz_decompress(uint32_t dz_compressed)
@@ -4297,21 +4283,21 @@ static STRICTINLINE uint32_t dz_decompress(uint32_t dz_compressed)
     return (1 << dz_compressed);
 }
 
-static uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
+static uint32_t z_compare(struct rdp_state *rdp, uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
 {
     int32_t diff;
     int32_t rawdzmem;
     uint32_t oz, dzmem, zval, hval;
     uint32_t nearer, max, infront;
+    uint32_t possibilities[4];
     int cvgcoeff       = 0;
     uint32_t dzenc     = 0;
     int force_coplanar = 0;
 
     sz &= 0x3ffff;
-    if (other_modes.z_compare_en)
+    if (rdp->other_modes.z_compare_en)
     {
         uint32_t dznew;
-        uint32_t dznotshift;
         uint32_t dzmemmodifier;
         uint32_t farther;
         int overflow;
@@ -4322,18 +4308,18 @@ static uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int d
         rawdzmem = ((zval & 3) << 2) | hval;
         dzmem = dz_decompress(rawdzmem);
 
-        if (other_modes.f.realblendershiftersneeded)
+        if (rdp->other_modes.f.realblendershiftersneeded)
         {
-           blshifta = CLIP(dzpixenc - rawdzmem, 0, 4);
-           blshiftb = CLIP(rawdzmem - dzpixenc, 0, 4);
+           rdp->blshifta = CLIP(dzpixenc - rawdzmem, 0, 4);
+           rdp->blshiftb = CLIP(rawdzmem - dzpixenc, 0, 4);
         }
 
-        if (other_modes.f.interpixelblendershiftersneeded)
+        if (rdp->other_modes.f.interpixelblendershiftersneeded)
         {
-           pastblshifta = CLIP(dzpixenc - pastrawdzmem, 0, 4);
-           pastblshiftb = CLIP(pastrawdzmem - dzpixenc, 0, 4);
+           rdp->pastblshifta = CLIP(dzpixenc - rdp->pastrawdzmem, 0, 4);
+           rdp->pastblshiftb = CLIP(rdp->pastrawdzmem - dzpixenc, 0, 4);
         }
-        pastrawdzmem = rawdzmem;
+        rdp->pastrawdzmem = rawdzmem;
 
         precision_factor = (zval >> 13) & 0xf;
 
@@ -4354,110 +4340,83 @@ static uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int d
             
         }
 
-        dznew = (uint32_t)deltaz_comparator_lut[dzpix | dzmem];
-        dznotshift = dznew;
-        dznew <<= 3;
-        
+        dzenc = dz_log2(dzpix | dzmem);
+        dznew = (1 << dzenc) << 3;
+
         LOG("dznew = %d\n", dznew);
 
         farther = force_coplanar || ((sz + dznew) >= oz);
         
         overflow = (curpixel_memcvg + *curpixel_cvg) & 8;
-        *blend_en = other_modes.force_blend || (!overflow && other_modes.antialias_en && farther);
+        *blend_en = rdp->other_modes.force_blend || (!overflow && rdp->other_modes.antialias_en && farther);
 
-        LOG("force_blend = %d\n", other_modes.force_blend);
+        LOG("force_blend = %d\n", rdp->other_modes.force_blend);
         LOG("oz = %d\n", oz);
         LOG("blend_en = %d\n", *blend_en);
         LOG("overflow = %d\n", overflow);
         
         *prewrap = overflow;
 
-        switch(other_modes.z_mode)
+        infront = sz < oz;
+        diff = (int32_t)sz - (int32_t)dznew;
+        nearer = force_coplanar || (diff <= (int32_t)oz);
+        max = (oz == 0x3ffff);
+
+        if (rdp->other_modes.z_mode == ZMODE_INTERPENETRATING
+         && infront && farther && overflow)
         {
-        case ZMODE_OPAQUE: 
-            infront = sz < oz;
-            diff = (int32_t)sz - (int32_t)dznew;
-            nearer = force_coplanar || (diff <= (int32_t)oz);
-            max = (oz == 0x3ffff);
-            LOG("nearer = %d\n", nearer);
-            LOG("opaque\n");
-            return (max || (overflow ? infront : nearer));
-            break;
-        case ZMODE_INTERPENETRATING: 
-            infront = sz < oz;
-            LOG("inter\n");
-            if (!infront || !farther || !overflow)
-            {
-                diff = (int32_t)sz - (int32_t)dznew;
-                nearer = force_coplanar || (diff <= (int32_t)oz);
-                max = (oz == 0x3ffff);
-                return (max || (overflow ? infront : nearer)); 
-            }
-            else
-            {
-                dzenc = dz_compress(dznotshift & 0xffff);
-                cvgcoeff = ((oz >> dzenc) - (sz >> dzenc)) & 0xf;
-                *curpixel_cvg = ((cvgcoeff * (*curpixel_cvg)) >> 3) & 0xf;
-                return 1;
-            }
-            break;
-        case ZMODE_TRANSPARENT: 
-            LOG("trans\n");
-            infront = sz < oz;
-            max = (oz == 0x3ffff);
-            return (infront || max); 
-            break;
-        case ZMODE_DECAL: 
-            LOG("decal\n");
-            diff = (int32_t)sz - (int32_t)dznew;
-            nearer = force_coplanar || (diff <= (int32_t)oz);
-            max = (oz == 0x3ffff);
-            return (farther && nearer && !max); 
-            break;
+            cvgcoeff = ((oz >> dzenc) - (sz >> dzenc)) & 0xf;
+            *curpixel_cvg = ((cvgcoeff * (*curpixel_cvg)) >> 3) & 0xf;
+            return 1;
         }
-        return 0;
+
+        possibilities[ZMODE_OPAQUE] = max | (overflow ? infront : nearer);
+        possibilities[ZMODE_INTERPENETRATING] = possibilities[ZMODE_OPAQUE];
+        possibilities[ZMODE_TRANSPARENT] = infront | max;
+        possibilities[ZMODE_DECAL] = farther & nearer & !max;
+        return possibilities[rdp->other_modes.z_mode];
     }
     else
     {
        int overflow;
 
-       if (other_modes.f.realblendershiftersneeded)
+       if (rdp->other_modes.f.realblendershiftersneeded)
        {
-          blshifta = 0;
+          rdp->blshifta = 0;
           if (dzpixenc < 0xb)
-             blshiftb = 4;
+             rdp->blshiftb = 4;
           else
-             blshiftb = 0xf - dzpixenc;
+             rdp->blshiftb = 0xf - dzpixenc;
        }
 
-       if (other_modes.f.interpixelblendershiftersneeded)
+       if (rdp->other_modes.f.interpixelblendershiftersneeded)
        {
-          pastblshifta = 0;
+          rdp->pastblshifta = 0;
           if (dzpixenc < 0xb)
-             pastblshiftb = 4;
+             rdp->pastblshiftb = 4;
           else
-             pastblshiftb = 0xf - dzpixenc;
+             rdp->pastblshiftb = 0xf - dzpixenc;
        }
-       pastrawdzmem = 0xf;
+       rdp->pastrawdzmem = 0xf;
 
        overflow  = (curpixel_memcvg + *curpixel_cvg) & 8;
-       *blend_en = other_modes.force_blend || (!overflow && other_modes.antialias_en);
+       *blend_en = rdp->other_modes.force_blend || (!overflow && rdp->other_modes.antialias_en);
        *prewrap  = overflow;
 
        return 1;
     }
 }
 
-static void get_dither_noise(int x, int y, int* cdith, int* adith)
+static void get_dither_noise(struct rdp_state *rdp, int x, int y, int* cdith, int* adith)
 {
-   if (get_dither_noise_type < 2)
+   if (rdp->get_dither_noise_type < 2)
    {
       int dithindex = ((y & 3) << 2) | (x & 3);
 
-      if (!get_dither_noise_type)
-         noise = ((irand() & 7) << 6) | 0x20;
+      if (!rdp->get_dither_noise_type)
+         rdp->noise = ((irand(rdp) & 7) << 6) | 0x20;
 
-      switch(other_modes.f.rgb_alpha_dither)
+      switch(rdp->other_modes.f.rgb_alpha_dither)
       {
          case 0:
             *adith = *cdith = magic_matrix[dithindex];
@@ -4468,7 +4427,7 @@ static void get_dither_noise(int x, int y, int* cdith, int* adith)
             break;
          case 2:
             *cdith = magic_matrix[dithindex];
-            *adith = (noise >> 6) & 7;
+            *adith = (rdp->noise >> 6) & 7;
             break;
          case 3:
             *cdith = magic_matrix[dithindex];
@@ -4483,26 +4442,26 @@ static void get_dither_noise(int x, int y, int* cdith, int* adith)
             break;
          case 6:
             *cdith = bayer_matrix[dithindex];
-            *adith = (noise >> 6) & 7;
+            *adith = (rdp->noise >> 6) & 7;
             break;
          case 7:
             *cdith = bayer_matrix[dithindex];
             *adith = 0;
             break;
          case 8:
-            *cdith = irand();
+            *cdith = irand(rdp);
             *adith = magic_matrix[dithindex];
             break;
          case 9:
-            *cdith = irand();
+            *cdith = irand(rdp);
             *adith = (~magic_matrix[dithindex]) & 7;
             break;
          case 10:
-            *cdith = irand();
-            *adith = (noise >> 6) & 7;
+            *cdith = irand(rdp);
+            *adith = (rdp->noise >> 6) & 7;
             break;
          case 11:
-            *cdith = irand();
+            *cdith = irand(rdp);
             *adith = 0;
             break;
          case 12:
@@ -4515,7 +4474,7 @@ static void get_dither_noise(int x, int y, int* cdith, int* adith)
             break;
          case 14:
             *cdith = 7;
-            *adith = (noise >> 6) & 7;
+            *adith = (rdp->noise >> 6) & 7;
             break;
          case 15:
             *cdith = 7;
@@ -4525,11 +4484,11 @@ static void get_dither_noise(int x, int y, int* cdith, int* adith)
    }
 }
 
-static STRICTINLINE void get_texel1_1cycle(int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, SPANSIGS* sigs)
+static STRICTINLINE void get_texel1_1cycle(struct rdp_state *rdp, int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, SPANSIGS* sigs)
 {
     int32_t nexts, nextt, nextsw;
     
-    if (!sigs->endspan || !sigs->longspan || !span[scanline + 1].validline)
+    if (!sigs->endspan || !sigs->longspan || !rdp->span[scanline + 1].validline)
     {
     
     
@@ -4540,16 +4499,16 @@ static STRICTINLINE void get_texel1_1cycle(int32_t* s1, int32_t* t1, int32_t s,
     else
     {
         int32_t nextscan = scanline + 1;
-        ALIGNED int32_t *stwz_ptr = (ALIGNED int32_t*)&span[nextscan].stwz[0];
+        ALIGNED int32_t *stwz_ptr = (ALIGNED int32_t*)&rdp->span[nextscan].stwz[0];
 
         nexts  = stwz_ptr[0] >> 16;
         nextt  = stwz_ptr[1] >> 16;
         nextsw = stwz_ptr[2] >> 16;
     }
-    tcdiv(nexts, nextt, nextsw, s1, t1);
+    tcdiv(rdp, nexts, nextt, nextsw, s1, t1);
 }
 
-STRICTINLINE void lodfrac_lodtile_signals(int lodclamp, int32_t lod, uint32_t* l_tile, uint32_t* magnify, uint32_t* distant)
+STRICTINLINE void lodfrac_lodtile_signals(struct rdp_state *rdp, int lodclamp, int32_t lod, uint32_t* l_tile, uint32_t* magnify, uint32_t* distant)
 {
     uint32_t ltil, dis, mag;
     int32_t lf;
@@ -4557,17 +4516,17 @@ STRICTINLINE void lodfrac_lodtile_signals(int lodclamp, int32_t lod, uint32_t* l
     
     if ((lod & 0x4000) || lodclamp)
         lod = 0x7fff;
-    else if (lod < min_level)
-        lod = min_level;
+    else if (lod < rdp->min_level)
+        lod = rdp->min_level;
                         
     mag = (lod < 32) ? 1: 0;
     ltil=  log2table[(lod >> 5) & 0xff];
-    dis = ((lod & 0x6000) || (ltil >= max_level)) ? 1 : 0;
+    dis = ((lod & 0x6000) || (ltil >= rdp->max_level)) ? 1 : 0;
                         
     lf = ((lod << 3) >> ltil) & 0xff;
 
     
-    if(!other_modes.sharpen_tex_en && !other_modes.detail_tex_en)
+    if(!rdp->other_modes.sharpen_tex_en && !rdp->other_modes.detail_tex_en)
     {
         if (dis)
             lf = 0xff;
@@ -4578,13 +4537,13 @@ STRICTINLINE void lodfrac_lodtile_signals(int lodclamp, int32_t lod, uint32_t* l
     
     
 
-    if(other_modes.sharpen_tex_en && mag)
+    if(rdp->other_modes.sharpen_tex_en && mag)
         lf |= 0x100;
 
     *distant = dis;
     *l_tile = ltil;
     *magnify = mag;
-    lod_frac = lf;
+    rdp->lod_frac = lf;
 }
 
 static STRICTINLINE void tclod_4x17_to_15(int32_t scurr, int32_t snext, int32_t tcurr, int32_t tnext, int32_t previous, int32_t* lod)
@@ -4656,7 +4615,7 @@ static STRICTINLINE void tclod_tcclamp(int32_t* sss, int32_t* sst)
 
 }
 
-static void tclod_1cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int32_t nextt, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, SPANSIGS* sigs)
+static void tclod_1cycle_current(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t nexts, int32_t nextt, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, SPANSIGS* sigs)
 {
 
 
@@ -4674,12 +4633,12 @@ static void tclod_1cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
     
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
         int nextscan = scanline + 1;
 
         
-        if (span[nextscan].validline)
+        if (rdp->span[nextscan].validline)
         {
             if (!sigs->endspan || !sigs->longspan)
             {
@@ -4698,7 +4657,7 @@ static void tclod_1cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
             }
             else
             {
-               ALIGNED int32_t *stwz_ptr = (ALIGNED int32_t*)&span[nextscan].stwz[0];
+               ALIGNED int32_t *stwz_ptr = (ALIGNED int32_t*)&rdp->span[nextscan].stwz[0];
                 fars =  (stwz_ptr[0] + dsinc) >> 16;
                 fart =  (stwz_ptr[1] + dtinc) >> 16;
                 farsw = (stwz_ptr[2] + dwinc) >> 16;
@@ -4711,7 +4670,7 @@ static void tclod_1cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
             fart = (t + (dtinc << 1)) >> 16;
         }
 
-        tcdiv(fars, fart, farsw, &fars, &fart);
+        tcdiv(rdp, fars, fart, farsw, &fars, &fart);
 
         lodclamp = (fart & 0x60000) || (nextt & 0x60000) || (fars & 0x60000) || (nexts & 0x60000);
         
@@ -4720,16 +4679,16 @@ static void tclod_1cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
         
         tclod_4x17_to_15(nexts, fars, nextt, fart, 0, &lod);
 
-        lodfrac_lodtile_signals(lodclamp, lod, &l_tile, &magnify, &distant);
+        lodfrac_lodtile_signals(rdp, lodclamp, lod, &l_tile, &magnify, &distant);
     
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
+                l_tile = rdp->max_level;
 
             
             
-            if (!other_modes.detail_tex_en || magnify)
+            if (!rdp->other_modes.detail_tex_en || magnify)
                 *t1 = (prim_tile + l_tile) & 7;
             else
                 *t1 = (prim_tile + l_tile + 1) & 7;
@@ -4739,7 +4698,7 @@ static void tclod_1cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
 
 
 
-static void tclod_1cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, SPANSIGS* sigs)
+static void tclod_1cycle_current_simple(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, SPANSIGS* sigs)
 {
     int fars, fart, farsw, nexts, nextt, nextsw;
     int lodclamp = 0;
@@ -4748,11 +4707,11 @@ static void tclod_1cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, i
     
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
 
         int nextscan = scanline + 1;
-        if (span[nextscan].validline)
+        if (rdp->span[nextscan].validline)
         {
             if (!sigs->endspan || !sigs->longspan)
             {
@@ -4775,7 +4734,7 @@ static void tclod_1cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, i
             }
             else
             {
-               ALIGNED int32_t *stwz_ptr = (ALIGNED int32_t*)&span[nextscan].stwz[0];
+               ALIGNED int32_t *stwz_ptr = (ALIGNED int32_t*)&rdp->span[nextscan].stwz[0];
 
                 nexts  = stwz_ptr[0] >> 16;
                 nextt  = stwz_ptr[1] >> 16;
@@ -4795,20 +4754,20 @@ static void tclod_1cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, i
             fart = (t + (dtinc << 1)) >> 16;
         }
 
-        tcdiv(nexts, nextt, nextsw, &nexts, &nextt);
-        tcdiv(fars, fart, farsw, &fars, &fart);
+        tcdiv(rdp, nexts, nextt, nextsw, &nexts, &nextt);
+        tcdiv(rdp, fars, fart, farsw, &fars, &fart);
 
         lodclamp = (fart & 0x60000) || (nextt & 0x60000) || (fars & 0x60000) || (nexts & 0x60000);
 
         tclod_4x17_to_15(nexts, fars, nextt, fart, 0, &lod);
 
-        lodfrac_lodtile_signals(lodclamp, lod, &l_tile, &magnify, &distant);
+        lodfrac_lodtile_signals(rdp, lodclamp, lod, &l_tile, &magnify, &distant);
     
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
-            if (!other_modes.detail_tex_en || magnify)
+                l_tile = rdp->max_level;
+            if (!rdp->other_modes.detail_tex_en || magnify)
                 *t1 = (prim_tile + l_tile) & 7;
             else
                 *t1 = (prim_tile + l_tile + 1) & 7;
@@ -4816,7 +4775,7 @@ static void tclod_1cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, i
     }
 }
 
-static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, SPANSIGS* sigs, int32_t* prelodfrac)
+static void tclod_1cycle_next(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, SPANSIGS* sigs, int32_t* prelodfrac)
 {
     int nexts, nextt, nextsw, fars, fart, farsw;
     int lodclamp = 0;
@@ -4825,12 +4784,12 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
     
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
         
         int nextscan = scanline + 1;
         
-        if (span[nextscan].validline)
+        if (rdp->span[nextscan].validline)
         {
             if (!sigs->nextspan)
             {
@@ -4855,9 +4814,9 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
                 }
                 else
                 {
-                    nexts = span[nextscan].stwz[0];
-                    nextt = span[nextscan].stwz[1];
-                    nextsw = span[nextscan].stwz[2];
+                    nexts = rdp->span[nextscan].stwz[0];
+                    nextt = rdp->span[nextscan].stwz[1];
+                    nextsw = rdp->span[nextscan].stwz[2];
                     fart = (nextt + dtinc) >> 16;
                     fars = (nexts + dsinc) >> 16;
                     farsw = (nextsw + dwinc) >> 16;
@@ -4870,9 +4829,9 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
             {
                if (!sigs->onelessthanmid)
                 {
-                    nexts = span[nextscan].stwz[0] + dsinc;
-                    nextt = span[nextscan].stwz[1] + dtinc;
-                    nextsw = span[nextscan].stwz[2] + dwinc;
+                    nexts = rdp->span[nextscan].stwz[0] + dsinc;
+                    nextt = rdp->span[nextscan].stwz[1] + dtinc;
+                    nextsw = rdp->span[nextscan].stwz[2] + dwinc;
                     fart = (nextt + dtinc) >> 16;
                     fars = (nexts + dsinc) >> 16;
                     farsw = (nextsw + dwinc) >> 16;
@@ -4901,8 +4860,8 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
             fart = (t + (dtinc << 1)) >> 16;
         }
 
-        tcdiv(nexts, nextt, nextsw, &nexts, &nextt);
-        tcdiv(fars, fart, farsw, &fars, &fart);
+        tcdiv(rdp, nexts, nextt, nextsw, &nexts, &nextt);
+        tcdiv(rdp, fars, fart, farsw, &fars, &fart);
 
         lodclamp = (fart & 0x60000) || (nextt & 0x60000) || (fars & 0x60000) || (nexts & 0x60000);
         
@@ -4912,17 +4871,17 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
         
         if ((lod & 0x4000) || lodclamp)
             lod = 0x7fff;
-        else if (lod < min_level)
-            lod = min_level;
+        else if (lod < rdp->min_level)
+            lod = rdp->min_level;
                     
         magnify = (lod < 32) ? 1: 0;
         l_tile =  log2table[(lod >> 5) & 0xff];
-        distant = ((lod & 0x6000) || (l_tile >= max_level)) ? 1 : 0;
+        distant = ((lod & 0x6000) || (l_tile >= rdp->max_level)) ? 1 : 0;
 
         *prelodfrac = ((lod << 3) >> l_tile) & 0xff;
 
         
-        if(!other_modes.sharpen_tex_en && !other_modes.detail_tex_en)
+        if(!rdp->other_modes.sharpen_tex_en && !rdp->other_modes.detail_tex_en)
         {
 #ifdef OPTS_ENABLED
            *prelodfrac &= ~magnify;
@@ -4935,14 +4894,14 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
 #endif
         }
 
-        if(other_modes.sharpen_tex_en && magnify)
+        if(rdp->other_modes.sharpen_tex_en && magnify)
             *prelodfrac |= 0x100;
 
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
-            if (!other_modes.detail_tex_en || magnify)
+                l_tile = rdp->max_level;
+            if (!rdp->other_modes.detail_tex_en || magnify)
                 *t1 = (prim_tile + l_tile) & 7;
             else
                 *t1 = (prim_tile + l_tile + 1) & 7;
@@ -4950,7 +4909,7 @@ static void tclod_1cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
     }
 }
 
-static void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, int a,
+static void rgbaz_correct_clip(struct rdp_state *rdp, int offx, int offy, int r, int g, int b, int a,
       int* z, uint32_t curpixel_cvg)
 {
     int summand_r, summand_b, summand_g, summand_a;
@@ -4971,11 +4930,11 @@ static void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, int a,
     }
     else
     {
-        summand_r = offx * spans_cd_rgba[0] + offy * spans_d_rgba_dy[0];
-        summand_g = offx * spans_cd_rgba[1] + offy * spans_d_rgba_dy[1];
-        summand_b = offx * spans_cd_rgba[2] + offy * spans_d_rgba_dy[2];
-        summand_a = offx * spans_cd_rgba[3] + offy * spans_d_rgba_dy[3];
-        summand_z = offx * spans_cdz + offy * spans_d_stwz_dy[3];
+        summand_r = offx * rdp->spans_cd_rgba[0] + offy * rdp->spans_d_rgba_dy[0];
+        summand_g = offx * rdp->spans_cd_rgba[1] + offy * rdp->spans_d_rgba_dy[1];
+        summand_b = offx * rdp->spans_cd_rgba[2] + offy * rdp->spans_d_rgba_dy[2];
+        summand_a = offx * rdp->spans_cd_rgba[3] + offy * rdp->spans_d_rgba_dy[3];
+        summand_z = offx * rdp->spans_cdz + offy * rdp->spans_d_stwz_dy[3];
 
         r = ((r << 2) + summand_r) >> 4;
         g = ((g << 2) + summand_g) >> 4;
@@ -4985,10 +4944,10 @@ static void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, int a,
     }
 
     
-    COLOR_RED(shade_color)   = special_9bit_clamptable[r & 0x1ff];
-    COLOR_GREEN(shade_color) = special_9bit_clamptable[g & 0x1ff];
-    COLOR_BLUE(shade_color)  = special_9bit_clamptable[b & 0x1ff];
-    COLOR_ALPHA(shade_color) = special_9bit_clamptable[a & 0x1ff];
+    COLOR_RED(rdp->shade_color)   = special_9bit_clamptable[r & 0x1ff];
+    COLOR_GREEN(rdp->shade_color) = special_9bit_clamptable[g & 0x1ff];
+    COLOR_BLUE(rdp->shade_color)  = special_9bit_clamptable[b & 0x1ff];
+    COLOR_ALPHA(rdp->shade_color) = special_9bit_clamptable[a & 0x1ff];
     
     
     
@@ -5010,7 +4969,36 @@ static void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, int a,
     *z &= 0x3FFFF;
 }
 
-static void render_spans_1cycle_complete(int start, int end, int tilenum, int flip)
+static STRICTINLINE int span_line_length(struct rdp_state *rdp, int line)
+{
+    return rdp->span_flip
+        ? rdp->span[line].lx - rdp->span[line].rx
+        : rdp->span[line].rx - rdp->span[line].lx;
+}
+
+/*
+ * Called at the start of every scanline a renderer walks; returns 0 for the
+ * lines owned by another worker, after stepping the dither noise past the
+ * values its owner draws there, so that the sequence each pixel sees is the
+ * same as with a single worker.
+ */
+static STRICTINLINE int span_line_begin(struct rdp_state *rdp, int line)
+{
+    int length;
+
+    if ((uint32_t)line % rdp->worker_num == rdp->worker_id)
+        return 1;
+    if (rdp->span_rand != 0)
+    {
+        length = span_line_length(rdp, line);
+        if (length >= 0)
+            irand_skip(rdp,
+                ((uint32_t)(length >> rdp->span_rand_shift) + 1)*rdp->span_rand);
+    }
+    return 0;
+}
+
+static void render_spans_1cycle_complete(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     uint8_t offx, offy;
     SPANSIGS sigs;
@@ -5043,43 +5031,45 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dsinc = spans_d_stwz[0];
-        dtinc = spans_d_stwz[1];
-        dwinc = spans_d_stwz[2];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dsinc = rdp->spans_d_stwz[0];
+        dtinc = rdp->spans_d_stwz[1];
+        dwinc = rdp->spans_d_stwz[2];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dsinc = -spans_d_stwz[0];
-        dtinc = -spans_d_stwz[1];
-        dwinc = -spans_d_stwz[2];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dsinc = -rdp->spans_d_stwz[0];
+        dtinc = -rdp->spans_d_stwz[1];
+        dwinc = -rdp->spans_d_stwz[2];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
 
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
 
     for (i = start; i <= end; i++)
     {
-       SPAN *span_ptr = &span[i];
+       SPAN *span_ptr = &rdp->span[i];
         if (!span_ptr || span_ptr->validline == 0)
             continue;
+        if (!span_line_begin(rdp, i))
+            continue;
         xstart = span_ptr->lx;
         xend   = span_ptr->unscrx;
         xendsc = span_ptr->rx;
@@ -5090,11 +5080,11 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
         s      = span_ptr->stwz[0];
         t      = span_ptr->stwz[1];
         w      = span_ptr->stwz[2];
-        z      = other_modes.z_source_sel ? primitive_z : span_ptr->stwz[3];
+        z      = rdp->other_modes.z_source_sel ? rdp->primitive_z : span_ptr->stwz[3];
 
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -5102,13 +5092,13 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
         sigs.longspan = (length > 7);
         sigs.midspan = (length == 7);
@@ -5141,21 +5131,21 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
             sigs.endspan = (j == length);
             sigs.preendspan = (j == (length - 1));
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            get_texel1_1cycle(&news, &newt, s, t, w, dsinc, dtinc, dwinc, i, &sigs);
+            get_texel1_1cycle(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc, i, &sigs);
 
             if (!sigs.startspan)
             {
-                COLOR_ASSIGN(texel0_color, texel1_color);
-                lod_frac = prelodfrac;
+                COLOR_ASSIGN(rdp->texel0_color, rdp->texel1_color);
+                rdp->lod_frac = prelodfrac;
             }
             else
             {
-                tcdiv(ss, st, sw, &sss, &sst);
+                tcdiv(rdp, ss, st, sw, &sss, &sst);
 
-                tclod_1cycle_current(&sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
-                texture_pipeline_cycle(&texel0_color, &texel0_color, sss, sst, tile1, 0);
+                tclod_1cycle_current(rdp, &sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
+                texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
 
                 sigs.startspan = 0;
             }
@@ -5167,21 +5157,21 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
             t += dtinc;
             w += dwinc;
 
-            tclod_1cycle_next(&news, &newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &newtile, &sigs, &prelodfrac);
+            tclod_1cycle_next(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &newtile, &sigs, &prelodfrac);
 
-            texture_pipeline_cycle(&texel1_color, &texel1_color, news, newt, newtile, 0);
+            texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel1_color, news, newt, newtile, 0);
 
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
             LOG("SZ = %d\n", sz);
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_1cycle(adith, &curpixel_cvg);
-            fbread1_ptr(curpixel, &curpixel_memcvg);
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_1cycle(rdp, adith, &curpixel_cvg);
+            rdp->fbread1_ptr(rdp, curpixel, &curpixel_memcvg);
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
-                if (blender_1cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
+                if (blender_1cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
             }
@@ -5198,7 +5188,7 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
     }
 }
 
-static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int flip)
+static void render_spans_1cycle_notexel1(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int zbcur;
     uint8_t offx, offy;
@@ -5229,43 +5219,45 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dsinc = spans_d_stwz[0];
-        dtinc = spans_d_stwz[1];
-        dwinc = spans_d_stwz[2];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dsinc = rdp->spans_d_stwz[0];
+        dtinc = rdp->spans_d_stwz[1];
+        dwinc = rdp->spans_d_stwz[2];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dsinc = -spans_d_stwz[0];
-        dtinc = -spans_d_stwz[1];
-        dwinc = -spans_d_stwz[2];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dsinc = -rdp->spans_d_stwz[0];
+        dtinc = -rdp->spans_d_stwz[1];
+        dwinc = -rdp->spans_d_stwz[2];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
 
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
                     
     for (i = start; i <= end; i++)
     {
-       SPAN *span_ptr = &span[i];
+       SPAN *span_ptr = &rdp->span[i];
         if (!span_ptr || span_ptr->validline == 0)
             continue;
+        if (!span_line_begin(rdp, i))
+            continue;
         xstart = span_ptr->lx;
         xend   = span_ptr->unscrx;
         xendsc = span_ptr->rx;
@@ -5276,11 +5268,11 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
         s      = span_ptr->stwz[0];
         t      = span_ptr->stwz[1];
         w      = span_ptr->stwz[2];
-        z      = other_modes.z_source_sel ? primitive_z : span_ptr->stwz[3];
+        z      = rdp->other_modes.z_source_sel ? rdp->primitive_z : span_ptr->stwz[3];
         
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -5288,13 +5280,13 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
 
         sigs.longspan = (length > 7);
@@ -5326,36 +5318,36 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
             sigs.endspan = (j == length);
             sigs.preendspan = (j == (length - 1));
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            tcdiv(ss, st, sw, &sss, &sst);
+            tcdiv(rdp, ss, st, sw, &sss, &sst);
 
-            tclod_1cycle_current_simple(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
+            tclod_1cycle_current_simple(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
 
-            texture_pipeline_cycle(&texel0_color, &texel0_color, sss, sst, tile1, 0);
+            texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
 
 #ifdef EXTRALOGGING
             LOG_ENABLE = curpixel == 53 * 320 + 77;
             LOG("Preclip SZ = %d\n", sz >> 3);
 #endif
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
 #ifdef EXTRALOGGING
             LOG("SZ = %d\n", sz);
 #endif
 
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_1cycle(adith, &curpixel_cvg);
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_1cycle(rdp, adith, &curpixel_cvg);
                 
-            fbread1_ptr(curpixel, &curpixel_memcvg);
+            rdp->fbread1_ptr(rdp, curpixel, &curpixel_memcvg);
             LOG("Pre CVG: %d, MEMCVG: %d\n", curpixel_cvg, curpixel_memcvg);
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
                LOG("Z pass\n");
-                if (blender_1cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
+                if (blender_1cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
                    LOG("Blend pass (CVG: %d)\n", curpixel_cvg);
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
             }
@@ -5383,7 +5375,7 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
     }
 }
 
-static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
+static void render_spans_1cycle_notex(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int zbcur;
     uint8_t offx, offy;
@@ -5409,37 +5401,39 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
     
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
                     
     for (i = start; i <= end; i++)
     {
-       SPAN *span_ptr = &span[i];
+       SPAN *span_ptr = &rdp->span[i];
         if (!span_ptr || span_ptr->validline == 0)
             continue;
+        if (!span_line_begin(rdp, i))
+            continue;
         xstart = span_ptr->lx;
         xend   = span_ptr->unscrx;
         xendsc = span_ptr->rx;
@@ -5447,11 +5441,11 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
         g      = span_ptr->rgba[1];
         b      = span_ptr->rgba[2];
         a      = span_ptr->rgba[3];
-        z      = other_modes.z_source_sel ? primitive_z : span_ptr->stwz[3];
+        z      = rdp->other_modes.z_source_sel ? rdp->primitive_z : span_ptr->stwz[3];
 
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -5459,13 +5453,13 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
 
         if (scdiff)
@@ -5485,24 +5479,24 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
             sa = a >> 14;
             sz = (z >> 10) & 0x3fffff;
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
 #ifdef EXTRALOGGING
             LOG_ENABLE = curpixel == 53 * 320 + 77;
             LOG("Preclip SZ = %d\n", sz >> 3);
 #endif
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
             LOG("SZ = %d\n", sz);
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_1cycle(adith, &curpixel_cvg);
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_1cycle(rdp, adith, &curpixel_cvg);
                 
-            fbread1_ptr(curpixel, &curpixel_memcvg);
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            rdp->fbread1_ptr(rdp, curpixel, &curpixel_memcvg);
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
-                if (blender_1cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
+                if (blender_1cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
             }
@@ -5523,17 +5517,17 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
     }
 }
 
-STRICTINLINE void get_nexttexel0_2cycle(int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc)
+STRICTINLINE void get_nexttexel0_2cycle(struct rdp_state *rdp, int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc)
 {
     int32_t nexts, nextt, nextsw;
     nextsw = (w + dwinc) >> 16;
     nexts = (s + dsinc) >> 16;
     nextt = (t + dtinc) >> 16;
 
-    tcdiv(nexts, nextt, nextsw, s1, t1);
+    tcdiv(rdp, nexts, nextt, nextsw, s1, t1);
 }
 
-static void tclod_2cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int32_t nextt, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2)
+static void tclod_2cycle_current(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t nexts, int32_t nextt, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2)
 {
 
 
@@ -5553,7 +5547,7 @@ static void tclod_2cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
 
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
         
         
@@ -5561,11 +5555,11 @@ static void tclod_2cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
         
         
         
-        nextys = (s + spans_d_stwz_dy[0]) >> 16;
-        nextyt = (t + spans_d_stwz_dy[1]) >> 16;
-        nextysw = (w + spans_d_stwz_dy[2]) >> 16;
+        nextys = (s + rdp->spans_d_stwz_dy[0]) >> 16;
+        nextyt = (t + rdp->spans_d_stwz_dy[1]) >> 16;
+        nextysw = (w + rdp->spans_d_stwz_dy[2]) >> 16;
 
-        tcdiv(nextys, nextyt, nextysw, &nextys, &nextyt);
+        tcdiv(rdp, nextys, nextyt, nextysw, &nextys, &nextyt);
 
         lodclamp = (initt & 0x60000) || (nextt & 0x60000) || (inits & 0x60000) || (nexts & 0x60000) || (nextys & 0x60000) || (nextyt & 0x60000);
         
@@ -5575,17 +5569,17 @@ static void tclod_2cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
         tclod_4x17_to_15(inits, nexts, initt, nextt, 0, &lod);
         tclod_4x17_to_15(inits, nextys, initt, nextyt, lod, &lod);
 
-        lodfrac_lodtile_signals(lodclamp, lod, &l_tile, &magnify, &distant);
+        lodfrac_lodtile_signals(rdp, lodclamp, lod, &l_tile, &magnify, &distant);
 
         
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
-            if (!other_modes.detail_tex_en)
+                l_tile = rdp->max_level;
+            if (!rdp->other_modes.detail_tex_en)
             {
                 *t1 = (prim_tile + l_tile) & 7;
-                if (!(distant || (!other_modes.sharpen_tex_en && magnify)))
+                if (!(distant || (!rdp->other_modes.sharpen_tex_en && magnify)))
                     *t2 = (*t1 + 1) & 7;
                 else
                     *t2 = *t1;
@@ -5607,7 +5601,7 @@ static void tclod_2cycle_current(int32_t* sss, int32_t* sst, int32_t nexts, int3
 }
 
 
-static void tclod_2cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2)
+static void tclod_2cycle_current_simple(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2)
 {
     int nextys, nextyt, nextysw, nexts, nextt, nextsw;
     int lodclamp = 0;
@@ -5619,33 +5613,33 @@ static void tclod_2cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, i
 
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
         nextsw = (w + dwinc) >> 16;
         nexts = (s + dsinc) >> 16;
         nextt = (t + dtinc) >> 16;
-        nextys = (s + spans_d_stwz_dy[0]) >> 16;
-        nextyt = (t + spans_d_stwz_dy[1]) >> 16;
-        nextysw = (w + spans_d_stwz_dy[2]) >> 16;
+        nextys = (s + rdp->spans_d_stwz_dy[0]) >> 16;
+        nextyt = (t + rdp->spans_d_stwz_dy[1]) >> 16;
+        nextysw = (w + rdp->spans_d_stwz_dy[2]) >> 16;
 
-        tcdiv(nexts, nextt, nextsw, &nexts, &nextt);
-        tcdiv(nextys, nextyt, nextysw, &nextys, &nextyt);
+        tcdiv(rdp, nexts, nextt, nextsw, &nexts, &nextt);
+        tcdiv(rdp, nextys, nextyt, nextysw, &nextys, &nextyt);
 
         lodclamp = (initt & 0x60000) || (nextt & 0x60000) || (inits & 0x60000) || (nexts & 0x60000) || (nextys & 0x60000) || (nextyt & 0x60000);
 
         tclod_4x17_to_15(inits, nexts, initt, nextt, 0, &lod);
         tclod_4x17_to_15(inits, nextys, initt, nextyt, lod, &lod);
 
-        lodfrac_lodtile_signals(lodclamp, lod, &l_tile, &magnify, &distant);
+        lodfrac_lodtile_signals(rdp, lodclamp, lod, &l_tile, &magnify, &distant);
     
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
-            if (!other_modes.detail_tex_en)
+                l_tile = rdp->max_level;
+            if (!rdp->other_modes.detail_tex_en)
             {
                 *t1 = (prim_tile + l_tile) & 7;
-                if (!(distant || (!other_modes.sharpen_tex_en && magnify)))
+                if (!(distant || (!rdp->other_modes.sharpen_tex_en && magnify)))
                     *t2 = (*t1 + 1) & 7;
                 else
                     *t2 = *t1;
@@ -5667,7 +5661,7 @@ static void tclod_2cycle_current_simple(int32_t* sss, int32_t* sst, int32_t s, i
 }
 
 
-static void tclod_2cycle_current_notexel1(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1)
+static void tclod_2cycle_current_notexel1(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1)
 {
     int nextys, nextyt, nextysw, nexts, nextt, nextsw;
     int lodclamp = 0;
@@ -5679,30 +5673,30 @@ static void tclod_2cycle_current_notexel1(int32_t* sss, int32_t* sst, int32_t s,
 
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
         nextsw = (w + dwinc) >> 16;
         nexts = (s + dsinc) >> 16;
         nextt = (t + dtinc) >> 16;
-        nextys = (s + spans_d_stwz_dy[0]) >> 16;
-        nextyt = (t + spans_d_stwz_dy[1]) >> 16;
-        nextysw = (w + spans_d_stwz_dy[2]) >> 16;
+        nextys = (s + rdp->spans_d_stwz_dy[0]) >> 16;
+        nextyt = (t + rdp->spans_d_stwz_dy[1]) >> 16;
+        nextysw = (w + rdp->spans_d_stwz_dy[2]) >> 16;
 
-        tcdiv(nexts, nextt, nextsw, &nexts, &nextt);
-        tcdiv(nextys, nextyt, nextysw, &nextys, &nextyt);
+        tcdiv(rdp, nexts, nextt, nextsw, &nexts, &nextt);
+        tcdiv(rdp, nextys, nextyt, nextysw, &nextys, &nextyt);
 
         lodclamp = (initt & 0x60000) || (nextt & 0x60000) || (inits & 0x60000) || (nexts & 0x60000) || (nextys & 0x60000) || (nextyt & 0x60000);
 
         tclod_4x17_to_15(inits, nexts, initt, nextt, 0, &lod);
         tclod_4x17_to_15(inits, nextys, initt, nextyt, lod, &lod);
 
-        lodfrac_lodtile_signals(lodclamp, lod, &l_tile, &magnify, &distant);
+        lodfrac_lodtile_signals(rdp, lodclamp, lod, &l_tile, &magnify, &distant);
     
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
-            if (!other_modes.detail_tex_en || magnify)
+                l_tile = rdp->max_level;
+            if (!rdp->other_modes.detail_tex_en || magnify)
                 *t1 = (prim_tile + l_tile) & 7;
             else
                 *t1 = (prim_tile + l_tile + 1) & 7;
@@ -5711,7 +5705,7 @@ static void tclod_2cycle_current_notexel1(int32_t* sss, int32_t* sst, int32_t s,
     }
 }
 
-static void tclod_2cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w,
+static void tclod_2cycle_next(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w,
       int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2, int32_t* prelodfrac)
 {
     int nexts, nextt, nextsw, nextys, nextyt, nextysw;
@@ -5724,17 +5718,17 @@ static void tclod_2cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
 
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.f.dolod)
+    if (rdp->other_modes.f.dolod)
     {
         nextsw = (w + dwinc) >> 16;
         nexts = (s + dsinc) >> 16;
         nextt = (t + dtinc) >> 16;
-        nextys = (s + spans_d_stwz_dy[0]) >> 16;
-        nextyt = (t + spans_d_stwz_dy[1]) >> 16;
-        nextysw = (w + spans_d_stwz_dy[2]) >> 16;
+        nextys = (s + rdp->spans_d_stwz_dy[0]) >> 16;
+        nextyt = (t + rdp->spans_d_stwz_dy[1]) >> 16;
+        nextysw = (w + rdp->spans_d_stwz_dy[2]) >> 16;
 
-        tcdiv(nexts, nextt, nextsw, &nexts, &nextt);
-        tcdiv(nextys, nextyt, nextysw, &nextys, &nextyt);
+        tcdiv(rdp, nexts, nextt, nextsw, &nexts, &nextt);
+        tcdiv(rdp, nextys, nextyt, nextysw, &nextys, &nextyt);
     
         lodclamp = (initt & 0x60000) || (nextt & 0x60000) || (inits & 0x60000) || (nexts & 0x60000) || (nextys & 0x60000) || (nextyt & 0x60000);
 
@@ -5744,17 +5738,17 @@ static void tclod_2cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
         
         if ((lod & 0x4000) || lodclamp)
             lod = 0x7fff;
-        else if (lod < min_level)
-            lod = min_level;
+        else if (lod < rdp->min_level)
+            lod = rdp->min_level;
                         
         magnify = (lod < 32) ? 1: 0;
         l_tile =  log2table[(lod >> 5) & 0xff];
-        distant = ((lod & 0x6000) || (l_tile >= max_level)) ? 1 : 0;
+        distant = ((lod & 0x6000) || (l_tile >= rdp->max_level)) ? 1 : 0;
 
         *prelodfrac = ((lod << 3) >> l_tile) & 0xff;
 
         
-        if(!other_modes.sharpen_tex_en && !other_modes.detail_tex_en)
+        if(!rdp->other_modes.sharpen_tex_en && !rdp->other_modes.detail_tex_en)
         {
 #ifdef OPTS_ENABLED
            *prelodfrac &= ~magnify;
@@ -5770,17 +5764,17 @@ static void tclod_2cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
         
         
 
-        if(other_modes.sharpen_tex_en && magnify)
+        if(rdp->other_modes.sharpen_tex_en && magnify)
             *prelodfrac |= 0x100;
 
-        if (other_modes.tex_lod_en)
+        if (rdp->other_modes.tex_lod_en)
         {
             if (distant)
-                l_tile = max_level;
-            if (!other_modes.detail_tex_en)
+                l_tile = rdp->max_level;
+            if (!rdp->other_modes.detail_tex_en)
             {
                 *t1 = (prim_tile + l_tile) & 7;
-                if (!(distant || (!other_modes.sharpen_tex_en && magnify)))
+                if (!(distant || (!rdp->other_modes.sharpen_tex_en && magnify)))
                     *t2 = (*t1 + 1) & 7;
                 else
                     *t2 = *t1;
@@ -5801,7 +5795,7 @@ static void tclod_2cycle_next(int32_t* sss, int32_t* sst, int32_t s, int32_t t,
     }
 }
 
-static void render_spans_2cycle_complete(int start, int end, int tilenum, int flip)
+static void render_spans_2cycle_complete(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int zbcur;
     uint8_t offx, offy;
@@ -5841,57 +5835,59 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dsinc = spans_d_stwz[0];
-        dtinc = spans_d_stwz[1];
-        dwinc = spans_d_stwz[2];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dsinc = rdp->spans_d_stwz[0];
+        dtinc = rdp->spans_d_stwz[1];
+        dwinc = rdp->spans_d_stwz[2];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dsinc = -spans_d_stwz[0];
-        dtinc = -spans_d_stwz[1];
-        dwinc = -spans_d_stwz[2];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dsinc = -rdp->spans_d_stwz[0];
+        dtinc = -rdp->spans_d_stwz[1];
+        dwinc = -rdp->spans_d_stwz[2];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
 
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (rdp->span[i].validline == 0)
+            continue;
+        if (!span_line_begin(rdp, i))
             continue;
-        xstart = span[i].lx;
-        xend = span[i].unscrx;
-        xendsc = span[i].rx;
-        r = span[i].rgba[0];
-        g = span[i].rgba[1];
-        b = span[i].rgba[2];
-        a = span[i].rgba[3];
-        s = span[i].stwz[0];
-        t = span[i].stwz[1];
-        w = span[i].stwz[2];
-        z = other_modes.z_source_sel ? primitive_z : span[i].stwz[3];
+        xstart = rdp->span[i].lx;
+        xend = rdp->span[i].unscrx;
+        xendsc = rdp->span[i].rx;
+        r = rdp->span[i].rgba[0];
+        g = rdp->span[i].rgba[1];
+        b = rdp->span[i].rgba[2];
+        a = rdp->span[i].rgba[3];
+        s = rdp->span[i].stwz[0];
+        t = rdp->span[i].stwz[1];
+        w = rdp->span[i].stwz[2];
+        z = rdp->other_modes.z_source_sel ? rdp->primitive_z : rdp->span[i].stwz[3];
 
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -5899,13 +5895,13 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
 
         if (scdiff)
@@ -5932,23 +5928,23 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
             sw = w >> 16;
             sz = (z >> 10) & 0x3fffff;
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            get_nexttexel0_2cycle(&news, &newt, s, t, w, dsinc, dtinc, dwinc);
+            get_nexttexel0_2cycle(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc);
             if (!sigs.startspan)
             {
-                lod_frac = prelodfrac;
-                COLOR_ASSIGN(texel0_color, nexttexel_color);
-                COLOR_ASSIGN(texel1_color, nexttexel1_color);
+                rdp->lod_frac = prelodfrac;
+                COLOR_ASSIGN(rdp->texel0_color, rdp->nexttexel_color);
+                COLOR_ASSIGN(rdp->texel1_color, nexttexel1_color);
             }
             else
             {
-                tcdiv(ss, st, sw, &sss, &sst);
+                tcdiv(rdp, ss, st, sw, &sss, &sst);
 
-                tclod_2cycle_current(&sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2);
+                tclod_2cycle_current(rdp, &sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2);
 
-                texture_pipeline_cycle(&texel0_color, &texel0_color, sss, sst, tile1, 0);
-                texture_pipeline_cycle(&texel1_color, &texel0_color, sss, sst, tile2, 1);
+                texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
+                texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel0_color, sss, sst, tile2, 1);
 
                 sigs.startspan = 0;
             }
@@ -5957,28 +5953,28 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
             t += dtinc;
             w += dwinc;
 
-            tclod_2cycle_next(&news, &newt, s, t, w, dsinc, dtinc, dwinc, prim_tile, &newtile1, &newtile2, &prelodfrac);
+            tclod_2cycle_next(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc, prim_tile, &newtile1, &newtile2, &prelodfrac);
 
-            texture_pipeline_cycle(&nexttexel_color, &nexttexel_color, news, newt, newtile1, 0);
-            texture_pipeline_cycle(&nexttexel1_color, &nexttexel_color, news, newt, newtile2, 1);
+            texture_pipeline_cycle(rdp, &rdp->nexttexel_color, &rdp->nexttexel_color, news, newt, newtile1, 0);
+            texture_pipeline_cycle(rdp, &nexttexel1_color, &rdp->nexttexel_color, news, newt, newtile2, 1);
 
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_2cycle(adith, &curpixel_cvg, &acalpha);
-            fbread2_ptr(curpixel, &curpixel_memcvg);
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_2cycle(rdp, adith, &curpixel_cvg, &acalpha);
+            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
-                if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
+                if (blender_2cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                     
                 }
             }
             else
             {
-               COLOR_ASSIGN(memory_color, pre_memory_color);
+               COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
             }
 
             r += drinc;
@@ -5995,7 +5991,7 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
     }
 }
 
-static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int flip)
+static void render_spans_2cycle_notexelnext(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int zbcur;
     uint8_t offx, offy;
@@ -6028,57 +6024,59 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dsinc = spans_d_stwz[0];
-        dtinc = spans_d_stwz[1];
-        dwinc = spans_d_stwz[2];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dsinc = rdp->spans_d_stwz[0];
+        dtinc = rdp->spans_d_stwz[1];
+        dwinc = rdp->spans_d_stwz[2];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dsinc = -spans_d_stwz[0];
-        dtinc = -spans_d_stwz[1];
-        dwinc = -spans_d_stwz[2];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dsinc = -rdp->spans_d_stwz[0];
+        dtinc = -rdp->spans_d_stwz[1];
+        dwinc = -rdp->spans_d_stwz[2];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
 
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (rdp->span[i].validline == 0)
             continue;
-        xstart = span[i].lx;
-        xend = span[i].unscrx;
-        xendsc = span[i].rx;
-        r = span[i].rgba[0];
-        g = span[i].rgba[1];
-        b = span[i].rgba[2];
-        a = span[i].rgba[3];
-        s = span[i].stwz[0];
-        t = span[i].stwz[1];
-        w = span[i].stwz[2];
-        z = other_modes.z_source_sel ? primitive_z : span[i].stwz[3];
+        if (!span_line_begin(rdp, i))
+            continue;
+        xstart = rdp->span[i].lx;
+        xend = rdp->span[i].unscrx;
+        xendsc = rdp->span[i].rx;
+        r = rdp->span[i].rgba[0];
+        g = rdp->span[i].rgba[1];
+        b = rdp->span[i].rgba[2];
+        a = rdp->span[i].rgba[3];
+        s = rdp->span[i].stwz[0];
+        t = rdp->span[i].stwz[1];
+        w = rdp->span[i].stwz[2];
+        z = rdp->other_modes.z_source_sel ? rdp->primitive_z : rdp->span[i].stwz[3];
 
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -6086,13 +6084,13 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
 
         if (scdiff)
@@ -6118,39 +6116,39 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
             sw = w >> 16;
             sz = (z >> 10) & 0x3fffff;
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
             
-            tcdiv(ss, st, sw, &sss, &sst);
+            tcdiv(rdp, ss, st, sw, &sss, &sst);
 
-            tclod_2cycle_current_simple(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2);
+            tclod_2cycle_current_simple(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2);
                 
-            texture_pipeline_cycle(&texel0_color, &texel0_color, sss, sst, tile1, 0);
-            texture_pipeline_cycle(&texel1_color, &texel0_color, sss, sst, tile2, 1);
+            texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
+            texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel0_color, sss, sst, tile2, 1);
 
 #ifdef EXTRALOGGING
             LOG_ENABLE = curpixel == 53 * 320 + 77;
             LOG("Preclip SZ = %d\n", sz >> 3);
 #endif
 
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
                     
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_2cycle(adith, &curpixel_cvg, &acalpha);
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_2cycle(rdp, adith, &curpixel_cvg, &acalpha);
                 
-            fbread2_ptr(curpixel, &curpixel_memcvg);
+            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
-                if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
+                if (blender_2cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
             }
             else
             {
-               COLOR_ASSIGN(memory_color, pre_memory_color);
+               COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
             }
 
             s += dsinc;
@@ -6177,7 +6175,7 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
 void breakme(void)
 {}
 
-static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int flip)
+static void render_spans_2cycle_notexel1(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int zbcur;
     uint8_t offx, offy;
@@ -6209,57 +6207,59 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dsinc = spans_d_stwz[0];
-        dtinc = spans_d_stwz[1];
-        dwinc = spans_d_stwz[2];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dsinc = rdp->spans_d_stwz[0];
+        dtinc = rdp->spans_d_stwz[1];
+        dwinc = rdp->spans_d_stwz[2];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dsinc = -spans_d_stwz[0];
-        dtinc = -spans_d_stwz[1];
-        dwinc = -spans_d_stwz[2];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dsinc = -rdp->spans_d_stwz[0];
+        dtinc = -rdp->spans_d_stwz[1];
+        dwinc = -rdp->spans_d_stwz[2];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
 
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (rdp->span[i].validline == 0)
+            continue;
+        if (!span_line_begin(rdp, i))
             continue;
-        xstart = span[i].lx;
-        xend = span[i].unscrx;
-        xendsc = span[i].rx;
-        r = span[i].rgba[0];
-        g = span[i].rgba[1];
-        b = span[i].rgba[2];
-        a = span[i].rgba[3];
-        s = span[i].stwz[0];
-        t = span[i].stwz[1];
-        w = span[i].stwz[2];
-        z = other_modes.z_source_sel ? primitive_z : span[i].stwz[3];
+        xstart = rdp->span[i].lx;
+        xend = rdp->span[i].unscrx;
+        xendsc = rdp->span[i].rx;
+        r = rdp->span[i].rgba[0];
+        g = rdp->span[i].rgba[1];
+        b = rdp->span[i].rgba[2];
+        a = rdp->span[i].rgba[3];
+        s = rdp->span[i].stwz[0];
+        t = rdp->span[i].stwz[1];
+        w = rdp->span[i].stwz[2];
+        z = rdp->other_modes.z_source_sel ? rdp->primitive_z : rdp->span[i].stwz[3];
 
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -6267,13 +6267,13 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
 
         if (scdiff)
@@ -6299,14 +6299,14 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
             sw = w >> 16;
             sz = (z >> 10) & 0x3fffff;
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
             
-            tcdiv(ss, st, sw, &sss, &sst);
+            tcdiv(rdp, ss, st, sw, &sss, &sst);
 
-            tclod_2cycle_current_notexel1(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
+            tclod_2cycle_current_notexel1(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
             
             
-            texture_pipeline_cycle(&texel0_color, &texel0_color, sss, sst, tile1, 0);
+            texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
 
 #ifdef EXTRALOGGING
             LOG_ENABLE = curpixel == 53 * 320 + 77;
@@ -6314,17 +6314,17 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
                breakme();
             LOG("Preclip SZ = %d\n", sz >> 3);
 #endif
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
             LOG("SZ = %d\n", sz);
                     
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_2cycle(adith, &curpixel_cvg, &acalpha);
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_2cycle(rdp, adith, &curpixel_cvg, &acalpha);
                 
-            fbread2_ptr(curpixel, &curpixel_memcvg);
+            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
-                if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
+                if (blender_2cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
 #ifdef EXTRALOGGING
                    if (LOG_ENABLE)
@@ -6334,14 +6334,14 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
                       fib = 0x00;
                    }
 #endif
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
             }
             else
             {
-               COLOR_ASSIGN(memory_color, pre_memory_color);
+               COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
             }
 
             s += dsinc;
@@ -6364,7 +6364,7 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
     }
 }
 
-static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
+static void render_spans_2cycle_notex(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int zbcur;
     uint8_t offx, offy;
@@ -6391,48 +6391,50 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 
     if (flip)
     {
-        drinc = spans_d_rgba[0];
-        dginc = spans_d_rgba[1];
-        dbinc = spans_d_rgba[2];
-        dainc = spans_d_rgba[3];
-        dzinc = spans_d_stwz[3];
+        drinc = rdp->spans_d_rgba[0];
+        dginc = rdp->spans_d_rgba[1];
+        dbinc = rdp->spans_d_rgba[2];
+        dainc = rdp->spans_d_rgba[3];
+        dzinc = rdp->spans_d_stwz[3];
         xinc = 1;
     }
     else
     {
-        drinc = -spans_d_rgba[0];
-        dginc = -spans_d_rgba[1];
-        dbinc = -spans_d_rgba[2];
-        dainc = -spans_d_rgba[3];
-        dzinc = -spans_d_stwz[3];
+        drinc = -rdp->spans_d_rgba[0];
+        dginc = -rdp->spans_d_rgba[1];
+        dbinc = -rdp->spans_d_rgba[2];
+        dainc = -rdp->spans_d_rgba[3];
+        dzinc = -rdp->spans_d_stwz[3];
         xinc = -1;
     }
 
-    if (!other_modes.z_source_sel)
-        dzpix = spans_dzpix;
+    if (!rdp->other_modes.z_source_sel)
+        dzpix = rdp->spans_dzpix;
     else
     {
-        dzpix = primitive_delta_z;
-        dzinc = spans_cdz = spans_d_stwz_dy[3] = 0;
+        dzpix = rdp->primitive_delta_z;
+        dzinc = rdp->spans_cdz = rdp->spans_d_stwz_dy[3] = 0;
     }
     dzpixenc = dz_compress(dzpix);
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (rdp->span[i].validline == 0)
+            continue;
+        if (!span_line_begin(rdp, i))
             continue;
-        xstart = span[i].lx;
-        xend = span[i].unscrx;
-        xendsc = span[i].rx;
-        r = span[i].rgba[0];
-        g = span[i].rgba[1];
-        b = span[i].rgba[2];
-        a = span[i].rgba[3];
-        z = other_modes.z_source_sel ? primitive_z : span[i].stwz[3];
+        xstart = rdp->span[i].lx;
+        xend = rdp->span[i].unscrx;
+        xendsc = rdp->span[i].rx;
+        r = rdp->span[i].rgba[0];
+        g = rdp->span[i].rgba[1];
+        b = rdp->span[i].rgba[2];
+        a = rdp->span[i].rgba[3];
+        z = rdp->other_modes.z_source_sel ? rdp->primitive_z : rdp->span[i].stwz[3];
 
         x = xendsc;
-        curpixel = fb_width * i + x;
-        zbcur  = zb_address + 2*curpixel;
+        curpixel = rdp->fb_width * i + x;
+        zbcur  = rdp->zb_address + 2*curpixel;
         zbcur &= 0x00FFFFFF;
         zbcur  = zbcur >> 1;
 
@@ -6440,13 +6442,13 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
         {
             length = xendsc - xstart;
             scdiff = xend - xendsc;
-            compute_cvg_noflip(i);
+            compute_cvg_noflip(rdp, i);
         }
         else
         {
             length = xstart - xendsc;
             scdiff = xendsc - xend;
-            compute_cvg_flip(i);
+            compute_cvg_flip(rdp, i);
         }
 
         if (scdiff)
@@ -6466,27 +6468,27 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
             sa = a >> 14;
             sz = (z >> 10) & 0x3fffff;
 
-            lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            rgbaz_correct_clip(offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
+            rgbaz_correct_clip(rdp, offx, offy, sr, sg, sb, sa, &sz, curpixel_cvg);
                     
-            get_dither_noise(x, i, &cdith, &adith);
-            combiner_2cycle(adith, &curpixel_cvg, &acalpha);
+            get_dither_noise(rdp, x, i, &cdith, &adith);
+            combiner_2cycle(rdp, adith, &curpixel_cvg, &acalpha);
                 
-            fbread2_ptr(curpixel, &curpixel_memcvg);
+            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
             {
-                if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
+                if (blender_2cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (other_modes.z_update_en)
+                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
+                    if (rdp->other_modes.z_update_en)
                         z_store(zbcur, sz, dzpixenc);
                 }
             }
             else
             {
-               COLOR_ASSIGN(memory_color, pre_memory_color);
+               COLOR_ASSIGN(rdp->memory_color, rdp->pre_memory_color);
             }
 
             r += drinc;
@@ -6509,16 +6511,16 @@ static void render_spans_fill_4(int start, int end, int flip)
     rdp_pipeline_crashed = 1;
 }
 
-static void render_spans_fill_8(int start, int end, int flip)
+static void render_spans_fill_8(struct rdp_state *rdp, int start, int end, int flip)
 {
    int i, j;
    int x, length;
    uint32_t fb;
    int prevxstart;
    const int fastkillbits
-      = other_modes.image_read_en | other_modes.z_compare_en;
+      = rdp->other_modes.image_read_en | rdp->other_modes.z_compare_en;
    const int slowkillbits
-      = other_modes.z_update_en & ~other_modes.z_source_sel & ~fastkillbits;
+      = rdp->other_modes.z_update_en & ~rdp->other_modes.z_source_sel & ~fastkillbits;
    const int xinc = (flip & 1) ? +1 : -1;
    int xstart = 0, xendsc;
    int curpixel = 0;
@@ -6527,7 +6529,7 @@ static void render_spans_fill_8(int start, int end, int flip)
    { /* branch very unlikely */
       for (i = start; i <= end; i++)
 	  {
-         length = span[i].rx - span[i].lx; /* end - start */
+         length = rdp->span[i].rx - rdp->span[i].lx; /* end - start */
          length ^= flip;
          length -= flip;
          if (length < 0)
@@ -6546,35 +6548,37 @@ static void render_spans_fill_8(int start, int end, int flip)
    for (i = start; i <= end; i++)
    {
       prevxstart = xstart;
-      xstart     = span[i].lx;
-      xendsc     = span[i].rx;
+      xstart     = rdp->span[i].lx;
+      xendsc     = rdp->span[i].rx;
 
       x          = xendsc;
-      curpixel   = fb_width * i + x;
+      curpixel   = rdp->fb_width * i + x;
       length      = flip ? (xstart - xendsc) : (xendsc - xstart);
 
-      if (!span[i].validline)
+      if (!rdp->span[i].validline)
+         continue;
+      if (!span_line_begin(rdp, i))
          continue;
 
-      for (j = 0, fb = fb_address + curpixel; j <= length; j++, fb += xinc)
+      for (j = 0, fb = rdp->fb_address + curpixel; j <= length; j++, fb += xinc)
       {
-         uint32_t val = (fill_color >> (((fb & 3) ^ 3) << 3)) & 0xff;
+         uint32_t val = (rdp->fill_color >> (((fb & 3) ^ 3) << 3)) & 0xff;
          uint8_t hval = ((val & 1) << 1) | (val & 1);
          PAIRWRITE8(fb, val, hval);
       }
    }
 }
 
-static void render_spans_fill_16(int start, int end, int flip)
+static void render_spans_fill_16(struct rdp_state *rdp, int start, int end, int flip)
 {
    int i, j;
    int x, length;
    uint32_t fb;
    int prevxstart;
    const int fastkillbits
-      = other_modes.image_read_en | other_modes.z_compare_en;
+      = rdp->other_modes.image_read_en | rdp->other_modes.z_compare_en;
    const int slowkillbits
-      = other_modes.z_update_en & ~other_modes.z_source_sel & ~fastkillbits;
+      = rdp->other_modes.z_update_en & ~rdp->other_modes.z_source_sel & ~fastkillbits;
    const int xinc = (flip & 1) ? +1 : -1;
    int xstart = 0, xendsc;
    int curpixel = 0;
@@ -6583,7 +6587,7 @@ static void render_spans_fill_16(int start, int end, int flip)
    { /* branch very unlikely */
       for (i = start; i <= end; i++)
       {
-         length = span[i].rx - span[i].lx; /* end - start */
+         length = rdp->span[i].rx - rdp->span[i].lx; /* end - start */
          length ^= flip;
          length -= flip;
          if (length < 0)
@@ -6604,19 +6608,21 @@ static void render_spans_fill_16(int start, int end, int flip)
       uint16_t val;
       uint8_t hval;
       prevxstart = xstart;
-      xstart     = span[i].lx;
-      xendsc     = span[i].rx;
+      xstart     = rdp->span[i].lx;
+      xendsc     = rdp->span[i].rx;
 
       x          = xendsc;
-      curpixel   = fb_width * i + x;
+      curpixel   = rdp->fb_width * i + x;
       length     = flip ? (xstart - xendsc) : (xendsc - xstart);
 
-      if (!span[i].validline)
+      if (!rdp->span[i].validline)
+         continue;
+      if (!span_line_begin(rdp, i))
          continue;
 
-      for (j = 0, fb = (fb_address >> 1) + curpixel; j <= length; j++, fb += xinc)
+      for (j = 0, fb = (rdp->fb_address >> 1) + curpixel; j <= length; j++, fb += xinc)
       {
-         val   = (fb & 1 ? fill_color : fill_color >> 16) & 0xffff;
+         val   = (fb & 1 ? rdp->fill_color : rdp->fill_color >> 16) & 0xffff;
          hval  = (val & 1);
          hval += hval << 1; /* hval = (val & 1) * 3; # lea(%hval, %hval, 2), %hval */
          PAIRWRITE16(fb, val, hval);
@@ -6624,16 +6630,16 @@ static void render_spans_fill_16(int start, int end, int flip)
    }
 }
 
-static void render_spans_fill_32(int start, int end, int flip)
+static void render_spans_fill_32(struct rdp_state *rdp, int start, int end, int flip)
 {
    int i, j;
    int x, length;
    uint32_t fb;
    int prevxstart;
    const int fastkillbits
-      = other_modes.image_read_en | other_modes.z_compare_en;
+      = rdp->other_modes.image_read_en | rdp->other_modes.z_compare_en;
    const int slowkillbits
-      = other_modes.z_update_en & ~other_modes.z_source_sel & ~fastkillbits;
+      = rdp->other_modes.z_update_en & ~rdp->other_modes.z_source_sel & ~fastkillbits;
    const int xinc = (flip & 1) ? +1 : -1;
    int xstart = 0, xendsc;
    int curpixel = 0;
@@ -6642,7 +6648,7 @@ static void render_spans_fill_32(int start, int end, int flip)
    { /* branch very unlikely */
       for (i = start; i <= end; i++)
       {
-         length = span[i].rx - span[i].lx; /* end - start */
+         length = rdp->span[i].rx - rdp->span[i].lx; /* end - start */
          length ^= flip;
          length -= flip;
          if (length < 0)
@@ -6661,43 +6667,45 @@ static void render_spans_fill_32(int start, int end, int flip)
    for (i = start; i <= end; i++)
    {
       prevxstart = xstart;
-      xstart     = span[i].lx;
-      xendsc     = span[i].rx;
+      xstart     = rdp->span[i].lx;
+      xendsc     = rdp->span[i].rx;
 
       x          = xendsc;
-      curpixel   = fb_width * i + x;
+      curpixel   = rdp->fb_width * i + x;
       length     = flip ? (xstart - xendsc) : (xendsc - xstart);
 
-      if (!span[i].validline)
+      if (!rdp->span[i].validline)
+         continue;
+      if (!span_line_begin(rdp, i))
          continue;
 
-      for (j = 0, fb = (fb_address >> 2) + curpixel; j <= length; j++, fb += xinc)
+      for (j = 0, fb = (rdp->fb_address >> 2) + curpixel; j <= length; j++, fb += xinc)
       {
-         PAIRWRITE32(fb, fill_color, (fill_color & 0x10000) ? 3 : 0, (fill_color & 0x1) ? 3 : 0);
+         PAIRWRITE32(fb, rdp->fill_color, (rdp->fill_color & 0x10000) ? 3 : 0, (rdp->fill_color & 0x1) ? 3 : 0);
       }
    }
 }
 
-static void render_spans_fill(int start, int end, int flip)
+static void render_spans_fill(struct rdp_state *rdp, int start, int end, int flip)
 {
-   switch (fb_size)
+   switch (rdp->fb_size)
    {
       case PIXEL_SIZE_4BIT:
          render_spans_fill_4(start, end, flip);
          break;
       case PIXEL_SIZE_8BIT:
-         render_spans_fill_8(start, end, flip);
+         render_spans_fill_8(rdp, start, end, flip);
          break;
       case PIXEL_SIZE_16BIT:
-         render_spans_fill_16(start, end, flip);
+         render_spans_fill_16(rdp, start, end, flip);
          break;
       case PIXEL_SIZE_32BIT:
-         render_spans_fill_32(start, end, flip);
+         render_spans_fill_32(rdp, start, end, flip);
          break;
    }
 }
 
-static void tclod_copy(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1)
+static void tclod_copy(struct rdp_state *rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1)
 {
 
 
@@ -6710,7 +6718,7 @@ static void tclod_copy(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t
 
     tclod_tcclamp(sss, sst);
 
-    if (other_modes.tex_lod_en)
+    if (rdp->other_modes.tex_lod_en)
     {
         
         
@@ -6722,8 +6730,8 @@ static void tclod_copy(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t
         fars = (s + (dsinc << 1)) >> 16;
         fart = (t + (dtinc << 1)) >> 16;
     
-        tcdiv(nexts, nextt, nextsw, &nexts, &nextt);
-        tcdiv(fars, fart, farsw, &fars, &fart);
+        tcdiv(rdp, nexts, nextt, nextsw, &nexts, &nextt);
+        tcdiv(rdp, fars, fart, farsw, &fars, &fart);
 
         lodclamp = (fart & 0x60000) || (nextt & 0x60000) || (fars & 0x60000) || (nexts & 0x60000);
 
@@ -6731,17 +6739,17 @@ static void tclod_copy(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t
 
         if ((lod & 0x4000) || lodclamp)
             lod = 0x7fff;
-        else if (lod < min_level)
-            lod = min_level;
+        else if (lod < rdp->min_level)
+            lod = rdp->min_level;
                         
         magnify = (lod < 32) ? 1: 0;
         l_tile =  log2table[(lod >> 5) & 0xff];
-        distant = ((lod & 0x6000) || (l_tile >= max_level)) ? 1 : 0;
+        distant = ((lod & 0x6000) || (l_tile >= rdp->max_level)) ? 1 : 0;
 
         if (distant)
-            l_tile = max_level;
+            l_tile = rdp->max_level;
     
-        if (!other_modes.detail_tex_en || magnify)
+        if (!rdp->other_modes.detail_tex_en || magnify)
             *t1 = (prim_tile + l_tile) & 7;
         else
             *t1 = (prim_tile + l_tile + 1) & 7;
@@ -6749,7 +6757,7 @@ static void tclod_copy(int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t
 
 }
 
-static void render_spans_copy(int start, int end, int tilenum, int flip)
+static void render_spans_copy(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
 {
     int i, j, k;
     
@@ -6766,17 +6774,17 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
 
     uint32_t hidword = 0, lowdword = 0;
     uint32_t hidword1 = 0, lowdword1 = 0;
-    int fbadvance = (fb_size == PIXEL_SIZE_4BIT) ? 8 : 16 >> fb_size;
+    int fbadvance = (rdp->fb_size == PIXEL_SIZE_4BIT) ? 8 : 16 >> rdp->fb_size;
     uint32_t fbptr = 0;
     int fbptr_advance = flip ? 8 : -8;
     uint64_t copyqword = 0;
     uint32_t tempdword = 0, tempbyte = 0;
     int copywmask = 0, alphamask = 0;
-    int bytesperpixel = (fb_size == PIXEL_SIZE_4BIT) ? 1 : (1 << (fb_size - 1));
+    int bytesperpixel = (rdp->fb_size == PIXEL_SIZE_4BIT) ? 1 : (1 << (rdp->fb_size - 1));
     uint32_t fbendptr = 0;
     int32_t threshold, currthreshold;
 
-    if (fb_size == PIXEL_SIZE_32BIT)
+    if (rdp->fb_size == PIXEL_SIZE_32BIT)
     {
         rdp_pipeline_crashed = 1;
         return;
@@ -6784,16 +6792,16 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
 
     if (flip)
     {
-        dsinc = spans_d_stwz[0];
-        dtinc = spans_d_stwz[1];
-        dwinc = spans_d_stwz[2];
+        dsinc = rdp->spans_d_stwz[0];
+        dtinc = rdp->spans_d_stwz[1];
+        dwinc = rdp->spans_d_stwz[2];
         xinc = 1;
     }
     else
     {
-        dsinc = -spans_d_stwz[0];
-        dtinc = -spans_d_stwz[1];
-        dwinc = -spans_d_stwz[2];
+        dsinc = -rdp->spans_d_stwz[0];
+        dtinc = -rdp->spans_d_stwz[1];
+        dwinc = -rdp->spans_d_stwz[2];
         xinc = -1;
     }
 
@@ -6801,18 +6809,20 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (rdp->span[i].validline == 0)
             continue;
-        s = span[i].stwz[0];
-        t = span[i].stwz[1];
-        w = span[i].stwz[2];
+        if (!span_line_begin(rdp, i))
+            continue;
+        s = rdp->span[i].stwz[0];
+        t = rdp->span[i].stwz[1];
+        w = rdp->span[i].stwz[2];
         
-        xstart = span[i].lx;
-        xendsc = span[i].rx;
+        xstart = rdp->span[i].lx;
+        xendsc = rdp->span[i].rx;
 
-        fb_index = fb_width * i + xendsc;
-        fbptr = fb_address + PIXELS_TO_BYTES_SPECIAL4(fb_index, fb_size);
-        fbendptr = fb_address + PIXELS_TO_BYTES_SPECIAL4((fb_width * i + xstart), fb_size);
+        fb_index = rdp->fb_width * i + xendsc;
+        fbptr = rdp->fb_address + PIXELS_TO_BYTES_SPECIAL4(fb_index, rdp->fb_size);
+        fbendptr = rdp->fb_address + PIXELS_TO_BYTES_SPECIAL4((rdp->fb_width * i + xstart), rdp->fb_size);
         fbptr &= 0x00FFFFFF;
         fbendptr &= 0x00FFFFFF;
         length = flip ? (xstart - xendsc) : (xendsc - xstart);
@@ -6823,17 +6833,17 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
             st = t >> 16;
             sw = w >> 16;
 
-            tcdiv(ss, st, sw, &sss, &sst);
-            tclod_copy(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
-            fetch_qword_copy(&hidword, &lowdword, sss, sst, tile1);
+            tcdiv(rdp, ss, st, sw, &sss, &sst);
+            tclod_copy(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
+            fetch_qword_copy(rdp, &hidword, &lowdword, sss, sst, tile1);
 
-            if (fb_size == PIXEL_SIZE_16BIT || fb_size == PIXEL_SIZE_8BIT)
+            if (rdp->fb_size == PIXEL_SIZE_16BIT || rdp->fb_size == PIXEL_SIZE_8BIT)
                 copyqword = ((uint64_t)hidword << 32) | ((uint64_t)lowdword);
             else
                 copyqword = 0;
-            if (!other_modes.alpha_compare_en)
+            if (!rdp->other_modes.alpha_compare_en)
                 alphamask = 0xff;
-            else if (fb_size == PIXEL_SIZE_16BIT)
+            else if (rdp->fb_size == PIXEL_SIZE_16BIT)
             {
                 alphamask = 0;
                 alphamask |= (((copyqword >> 48) & 1) ? 0xC0 : 0);
@@ -6841,11 +6851,11 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
                 alphamask |= (((copyqword >> 16) & 1) ? 0xC : 0);
                 alphamask |= ((copyqword & 1) ? 0x3 : 0);
             }
-            else if (fb_size == PIXEL_SIZE_8BIT)
+            else if (rdp->fb_size == PIXEL_SIZE_8BIT)
             {
                 alphamask = 0;
-                threshold = (other_modes.dither_alpha_en) ? (irand() & 0xff) : COLOR_ALPHA(blend_color);
-                if (other_modes.dither_alpha_en)
+                threshold = (rdp->other_modes.dither_alpha_en) ? (irand(rdp) & 0xff) : COLOR_ALPHA(rdp->blend_color);
+                if (rdp->other_modes.dither_alpha_en)
                 {
                     currthreshold = threshold;
                     alphamask |= (((copyqword >> 24) & 0xff) >= currthreshold ? 0xC0 : 0);
@@ -6895,116 +6905,220 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
     }
 }
 
-static void deduce_derivatives(void)
+static void deduce_derivatives(struct rdp_state *rdp)
 {
     int texel1_used_in_cc1 = 0, texel0_used_in_cc1 = 0, texel0_used_in_cc0 = 0, texel1_used_in_cc0 = 0;
     int texels_in_cc0 = 0, texels_in_cc1 = 0;
     int lod_frac_used_in_cc1 = 0, lod_frac_used_in_cc0 = 0;
     int lodfracused = 0;
 
-    other_modes.f.partialreject_1cycle = (blender2b_a[0] == &COLOR_ALPHA(inv_pixel_color) && blender1b_a[0] == &COLOR_ALPHA(pixel_color));
-    other_modes.f.partialreject_2cycle = (blender2b_a[1] == &COLOR_ALPHA(inv_pixel_color) && blender1b_a[1] == &COLOR_ALPHA(pixel_color));
+    rdp->other_modes.f.partialreject_1cycle = (rdp->blender2b_a[0] == &COLOR_ALPHA(rdp->inv_pixel_color) && rdp->blender1b_a[0] == &COLOR_ALPHA(rdp->pixel_color));
+    rdp->other_modes.f.partialreject_2cycle = (rdp->blender2b_a[1] == &COLOR_ALPHA(rdp->inv_pixel_color) && rdp->blender1b_a[1] == &COLOR_ALPHA(rdp->pixel_color));
 
-    other_modes.f.special_bsel0 = (blender2b_a[0] == &COLOR_ALPHA(memory_color));
-    other_modes.f.special_bsel1 = (blender2b_a[1] == &COLOR_ALPHA(memory_color));
+    rdp->other_modes.f.special_bsel0 = (rdp->blender2b_a[0] == &COLOR_ALPHA(rdp->memory_color));
+    rdp->other_modes.f.special_bsel1 = (rdp->blender2b_a[1] == &COLOR_ALPHA(rdp->memory_color));
 
-    other_modes.f.realblendershiftersneeded = (other_modes.f.special_bsel0 && other_modes.cycle_type == CYCLE_TYPE_1) || (other_modes.f.special_bsel1 && other_modes.cycle_type == CYCLE_TYPE_2);
-    other_modes.f.interpixelblendershiftersneeded = (other_modes.f.special_bsel0 && other_modes.cycle_type == CYCLE_TYPE_2);
+    rdp->other_modes.f.realblendershiftersneeded = (rdp->other_modes.f.special_bsel0 && rdp->other_modes.cycle_type == CYCLE_TYPE_1) || (rdp->other_modes.f.special_bsel1 && rdp->other_modes.cycle_type == CYCLE_TYPE_2);
+    rdp->other_modes.f.interpixelblendershiftersneeded = (rdp->other_modes.f.special_bsel0 && rdp->other_modes.cycle_type == CYCLE_TYPE_2);
 
-    other_modes.f.rgb_alpha_dither = (other_modes.rgb_dither_sel << 2) | other_modes.alpha_dither_sel;
+    rdp->other_modes.f.rgb_alpha_dither = (rdp->other_modes.rgb_dither_sel << 2) | rdp->other_modes.alpha_dither_sel;
 
-    if ((combiner_rgbmul_r[1] == &lod_frac) || (combiner_alphamul[1] == &lod_frac))
+    if ((rdp->combiner_rgbmul_r[1] == &rdp->lod_frac) || (rdp->combiner_alphamul[1] == &rdp->lod_frac))
         lod_frac_used_in_cc1 = 1;
-    if ((combiner_rgbmul_r[0] == &lod_frac) || (combiner_alphamul[0] == &lod_frac))
+    if ((rdp->combiner_rgbmul_r[0] == &rdp->lod_frac) || (rdp->combiner_alphamul[0] == &rdp->lod_frac))
         lod_frac_used_in_cc0 = 1;
 
-    if (combiner_rgbmul_r[1] == &COLOR_RED(texel1_color) || combiner_rgbsub_a_r[1] == &COLOR_RED(texel1_color) || combiner_rgbsub_b_r[1] == &COLOR_RED(texel1_color) || combiner_rgbadd_r[1] == &COLOR_RED(texel1_color) ||
-        combiner_alphamul[1] == &COLOR_ALPHA(texel1_color) || combiner_alphasub_a[1] == &COLOR_ALPHA(texel1_color) || combiner_alphasub_b[1] == &COLOR_ALPHA(texel1_color) || combiner_alphaadd[1] == &COLOR_ALPHA(texel1_color) || 
-        combiner_rgbmul_r[1] == &COLOR_ALPHA(texel1_color))
+    if (rdp->combiner_rgbmul_r[1] == &COLOR_RED(rdp->texel1_color) || rdp->combiner_rgbsub_a_r[1] == &COLOR_RED(rdp->texel1_color) || rdp->combiner_rgbsub_b_r[1] == &COLOR_RED(rdp->texel1_color) || rdp->combiner_rgbadd_r[1] == &COLOR_RED(rdp->texel1_color) ||
+        rdp->combiner_alphamul[1] == &COLOR_ALPHA(rdp->texel1_color) || rdp->combiner_alphasub_a[1] == &COLOR_ALPHA(rdp->texel1_color) || rdp->combiner_alphasub_b[1] == &COLOR_ALPHA(rdp->texel1_color) || rdp->combiner_alphaadd[1] == &COLOR_ALPHA(rdp->texel1_color) || 
+        rdp->combiner_rgbmul_r[1] == &COLOR_ALPHA(rdp->texel1_color))
         texel1_used_in_cc1 = 1;
-    if (combiner_rgbmul_r[1] == &COLOR_RED(texel0_color) || combiner_rgbsub_a_r[1] == &COLOR_RED(texel0_color) || combiner_rgbsub_b_r[1] == &COLOR_RED(texel0_color) || combiner_rgbadd_r[1] == &COLOR_RED(texel0_color) || 
-        combiner_alphamul[1] == &COLOR_ALPHA(texel0_color) || combiner_alphasub_a[1] == &COLOR_ALPHA(texel0_color) || combiner_alphasub_b[1] == &COLOR_ALPHA(texel0_color) || combiner_alphaadd[1] == &COLOR_ALPHA(texel0_color) || 
-        combiner_rgbmul_r[1] == &COLOR_ALPHA(texel0_color))
+    if (rdp->combiner_rgbmul_r[1] == &COLOR_RED(rdp->texel0_color) || rdp->combiner_rgbsub_a_r[1] == &COLOR_RED(rdp->texel0_color) || rdp->combiner_rgbsub_b_r[1] == &COLOR_RED(rdp->texel0_color) || rdp->combiner_rgbadd_r[1] == &COLOR_RED(rdp->texel0_color) || 
+        rdp->combiner_alphamul[1] == &COLOR_ALPHA(rdp->texel0_color) || rdp->combiner_alphasub_a[1] == &COLOR_ALPHA(rdp->texel0_color) || rdp->combiner_alphasub_b[1] == &COLOR_ALPHA(rdp->texel0_color) || rdp->combiner_alphaadd[1] == &COLOR_ALPHA(rdp->texel0_color) || 
+        rdp->combiner_rgbmul_r[1] == &COLOR_ALPHA(rdp->texel0_color))
         texel0_used_in_cc1 = 1;
-    if (combiner_rgbmul_r[0] == &COLOR_RED(texel1_color) || combiner_rgbsub_a_r[0] == &COLOR_RED(texel1_color) || combiner_rgbsub_b_r[0] == &COLOR_RED(texel1_color) || combiner_rgbadd_r[0] == &COLOR_RED(texel1_color) || 
-        combiner_alphamul[0] == &COLOR_ALPHA(texel1_color) || combiner_alphasub_a[0] == &COLOR_ALPHA(texel1_color) || combiner_alphasub_b[0] == &COLOR_ALPHA(texel1_color) || combiner_alphaadd[0] == &COLOR_ALPHA(texel1_color) ||
-        combiner_rgbmul_r[0] == &COLOR_ALPHA(texel1_color))
+    if (rdp->combiner_rgbmul_r[0] == &COLOR_RED(rdp->texel1_color) || rdp->combiner_rgbsub_a_r[0] == &COLOR_RED(rdp->texel1_color) || rdp->combiner_rgbsub_b_r[0] == &COLOR_RED(rdp->texel1_color) || rdp->combiner_rgbadd_r[0] == &COLOR_RED(rdp->texel1_color) || 
+        rdp->combiner_alphamul[0] == &COLOR_ALPHA(rdp->texel1_color) || rdp->combiner_alphasub_a[0] == &COLOR_ALPHA(rdp->texel1_color) || rdp->combiner_alphasub_b[0] == &COLOR_ALPHA(rdp->texel1_color) || rdp->combiner_alphaadd[0] == &COLOR_ALPHA(rdp->texel1_color) ||
+        rdp->combiner_rgbmul_r[0] == &COLOR_ALPHA(rdp->texel1_color))
         texel1_used_in_cc0 = 1;
-    if (combiner_rgbmul_r[0] == &COLOR_RED(texel0_color) || combiner_rgbsub_a_r[0] == &COLOR_RED(texel0_color) || combiner_rgbsub_b_r[0] == &COLOR_RED(texel0_color) || combiner_rgbadd_r[0] == &COLOR_RED(texel0_color) || 
-        combiner_alphamul[0] == &COLOR_ALPHA(texel0_color) || combiner_alphasub_a[0] == &COLOR_ALPHA(texel0_color) || combiner_alphasub_b[0] == &COLOR_ALPHA(texel0_color) || combiner_alphaadd[0] == &COLOR_ALPHA(texel0_color) || 
-        combiner_rgbmul_r[0] == &COLOR_ALPHA(texel0_color))
+    if (rdp->combiner_rgbmul_r[0] == &COLOR_RED(rdp->texel0_color) || rdp->combiner_rgbsub_a_r[0] == &COLOR_RED(rdp->texel0_color) || rdp->combiner_rgbsub_b_r[0] == &COLOR_RED(rdp->texel0_color) || rdp->combiner_rgbadd_r[0] == &COLOR_RED(rdp->texel0_color) || 
+        rdp->combiner_alphamul[0] == &COLOR_ALPHA(rdp->texel0_color) || rdp->combiner_alphasub_a[0] == &COLOR_ALPHA(rdp->texel0_color) || rdp->combiner_alphasub_b[0] == &COLOR_ALPHA(rdp->texel0_color) || rdp->combiner_alphaadd[0] == &COLOR_ALPHA(rdp->texel0_color) || 
+        rdp->combiner_rgbmul_r[0] == &COLOR_ALPHA(rdp->texel0_color))
         texel0_used_in_cc0 = 1;
     texels_in_cc0 = texel0_used_in_cc0 || texel1_used_in_cc0;
     texels_in_cc1 = texel0_used_in_cc1 || texel1_used_in_cc1;    
 
     
     if (texel1_used_in_cc1)
-        render_spans_1cycle_ptr = render_spans_1cycle_func[2];
+        rdp->render_spans_1cycle_ptr = render_spans_1cycle_func[2];
     else if (texel0_used_in_cc1 || lod_frac_used_in_cc1)
-        render_spans_1cycle_ptr = render_spans_1cycle_func[1];
+        rdp->render_spans_1cycle_ptr = render_spans_1cycle_func[1];
     else
-        render_spans_1cycle_ptr = render_spans_1cycle_func[0];
+        rdp->render_spans_1cycle_ptr = render_spans_1cycle_func[0];
 
     if (texel1_used_in_cc1)
-        render_spans_2cycle_ptr = render_spans_2cycle_func[3];
+        rdp->render_spans_2cycle_ptr = render_spans_2cycle_func[3];
     else if (texel1_used_in_cc0 || texel0_used_in_cc1)
-        render_spans_2cycle_ptr = render_spans_2cycle_func[2];
+        rdp->render_spans_2cycle_ptr = render_spans_2cycle_func[2];
     else if (texel0_used_in_cc0 || lod_frac_used_in_cc0 || lod_frac_used_in_cc1)
-        render_spans_2cycle_ptr = render_spans_2cycle_func[1];
+        rdp->render_spans_2cycle_ptr = render_spans_2cycle_func[1];
     else
-        render_spans_2cycle_ptr = render_spans_2cycle_func[0];
+        rdp->render_spans_2cycle_ptr = render_spans_2cycle_func[0];
 
-    if ((other_modes.cycle_type == CYCLE_TYPE_2 && (lod_frac_used_in_cc0 || lod_frac_used_in_cc1)) || \
-        (other_modes.cycle_type == CYCLE_TYPE_1 && lod_frac_used_in_cc1))
+    if ((rdp->other_modes.cycle_type == CYCLE_TYPE_2 && (lod_frac_used_in_cc0 || lod_frac_used_in_cc1)) || \
+        (rdp->other_modes.cycle_type == CYCLE_TYPE_1 && lod_frac_used_in_cc1))
         lodfracused = 1;
 
-    if ((other_modes.cycle_type == CYCLE_TYPE_1 && combiner_rgbsub_a_r[1] == &noise) || \
-        (other_modes.cycle_type == CYCLE_TYPE_2 && (combiner_rgbsub_a_r[0] == &noise || combiner_rgbsub_a_r[1] == &noise)) || \
-        other_modes.alpha_dither_sel == 2)
-        get_dither_noise_type = 0;
-    else if (other_modes.f.rgb_alpha_dither != 0xf)
-        get_dither_noise_type= 1;
+    if ((rdp->other_modes.cycle_type == CYCLE_TYPE_1 && rdp->combiner_rgbsub_a_r[1] == &rdp->noise) || \
+        (rdp->other_modes.cycle_type == CYCLE_TYPE_2 && (rdp->combiner_rgbsub_a_r[0] == &rdp->noise || rdp->combiner_rgbsub_a_r[1] == &rdp->noise)) || \
+        rdp->other_modes.alpha_dither_sel == 2)
+        rdp->get_dither_noise_type = 0;
+    else if (rdp->other_modes.f.rgb_alpha_dither != 0xf)
+        rdp->get_dither_noise_type= 1;
     else
-        get_dither_noise_type = 2;
+        rdp->get_dither_noise_type = 2;
 
-    other_modes.f.dolod = other_modes.tex_lod_en || lodfracused;
+    rdp->other_modes.f.dolod = rdp->other_modes.tex_lod_en || lodfracused;
 }
 
-static void render_spans(
-    int yhlimit, int yllimit, int tilenum, int flip)
+static int combiner_reads_combined(struct rdp_state *rdp, int cycle)
 {
-    if (other_modes.f.stalederivs)
+    const int16_t *rgb   = &COLOR_RED(rdp->combined_color);
+    const int16_t *alpha = &COLOR_ALPHA(rdp->combined_color);
+
+    return rdp->combiner_rgbsub_a_r[cycle] == rgb
+        || rdp->combiner_rgbsub_b_r[cycle] == rgb
+        || rdp->combiner_rgbmul_r[cycle] == rgb
+        || rdp->combiner_rgbmul_r[cycle] == alpha
+        || rdp->combiner_rgbadd_r[cycle] == rgb
+        || rdp->combiner_alphasub_a[cycle] == alpha
+        || rdp->combiner_alphasub_b[cycle] == alpha
+        || rdp->combiner_alphamul[cycle] == alpha
+        || rdp->combiner_alphaadd[cycle] == alpha;
+}
+
+/*
+ * Whether the primitive can be split by scanline and still come out as it
+ * would from a single worker.  Of what the pipeline carries from one pixel
+ * to the next, only three things are read at the start of a line before
+ * being written again:  the combined color fed back into the first combiner
+ * cycle, the memory color (and the depth behind the inter-pixel blender
+ * shifters) that the first 2-cycle blender cycle sees one pixel late, and the
+ * dither noise seed.  A primitive relying on the first two, or drawing noise a
+ * data-dependent number of times, is drawn by worker 0 alone.  For the rest,
+ * span_rand is the noise drawn per 1 << span_rand_shift pixels.
+ */
+static int span_lines_split(struct rdp_state *rdp, int flip)
+{
+    int cycle = 1;
+
+    rdp->span_flip = flip;
+    rdp->span_rand = 0;
+    rdp->span_rand_shift = 0;
+
+    switch (rdp->other_modes.cycle_type)
     {
-        deduce_derivatives();
-        other_modes.f.stalederivs = 0;
+       case CYCLE_TYPE_COPY:
+          if (rdp->fb_size == PIXEL_SIZE_8BIT
+           && rdp->other_modes.alpha_compare_en
+           && rdp->other_modes.dither_alpha_en)
+          { /* one threshold per 8-byte copy */
+             rdp->span_rand = 1;
+             rdp->span_rand_shift = 3;
+          }
+          return 1;
+       case CYCLE_TYPE_FILL:
+          return 1;
+       case CYCLE_TYPE_2:
+          if (rdp->blender1a_r[0] == &COLOR_RED(rdp->memory_color)
+           || rdp->blender2a_r[0] == &COLOR_RED(rdp->memory_color)
+           || rdp->other_modes.f.special_bsel0)
+             return 0;
+          if (rdp->other_modes.key_en
+           && rdp->combiner_rgbsub_a_r[1] == &COLOR_RED(rdp->combined_color))
+             return 0;
+          cycle = 0;
+          break;
     }
+    if (combiner_reads_combined(rdp, cycle))
+        return 0;
 
-    fbread1_ptr = fbread_func[fb_size];
-    fbread2_ptr = fbread2_func[fb_size];
-    fbwrite_ptr = fbwrite_func[fb_size];
+    if (rdp->other_modes.alpha_compare_en && rdp->other_modes.dither_alpha_en)
+    { /* only drawn for pixels that pass the depth test */
+        if (rdp->other_modes.z_compare_en)
+            return 0;
+        rdp->span_rand = 1;
+    }
+    if (rdp->get_dither_noise_type == 0)
+        rdp->span_rand++;
+    if ((rdp->other_modes.f.rgb_alpha_dither >> 2) == 2)
+        rdp->span_rand++;
+    return 1;
+}
 
-#ifdef _DEBUG
-    ++render_cycle_mode_counts[other_modes.cycle_type];
-#endif
+static void draw_spans(struct rdp_state *rdp, int start, int end, int tilenum, int flip)
+{
+    int i;
 
-    switch (other_modes.cycle_type)
+    switch (rdp->other_modes.cycle_type)
     {
        case CYCLE_TYPE_1:
-          render_spans_1cycle_ptr(yhlimit, yllimit, tilenum, flip);
+          rdp->render_spans_1cycle_ptr(rdp, start, end, tilenum, flip);
           break;
        case CYCLE_TYPE_2:
-          render_spans_2cycle_ptr(yhlimit, yllimit, tilenum, flip);
+          rdp->render_spans_2cycle_ptr(rdp, start, end, tilenum, flip);
           break;
        case CYCLE_TYPE_COPY:
-          render_spans_copy(yhlimit, yllimit, tilenum, flip);
-          break;
+          render_spans_copy(rdp, start, end, tilenum, flip);
+          return;
        case CYCLE_TYPE_FILL:
-          render_spans_fill(yhlimit, yllimit, flip);
-          break;
+          render_spans_fill(rdp, start, end, flip);
+          return;
     }
+
+/*
+ * Every 1- or 2-cycle pixel overwrites the carries span_lines_split() is
+ * about, so they are now wherever the last line with any pixels was drawn.
+ */
+    for (i = end; i >= start; i--)
+    {
+        if (rdp->span[i].validline && span_line_length(rdp, i) >= 0)
+        {
+            rdp->carry_worker = (uint32_t)i % rdp->worker_num;
+            break;
+        }
+    }
+}
+
+static void render_spans(struct rdp_state *rdp,
+    int yhlimit, int yllimit, int tilenum, int flip)
+{
+    if (rdp->other_modes.f.stalederivs)
+    {
+        deduce_derivatives(rdp);
+        rdp->other_modes.f.stalederivs = 0;
+    }
+
+    rdp->fbread1_ptr = fbread_func[rdp->fb_size];
+    rdp->fbread2_ptr = fbread2_func[rdp->fb_size];
+    rdp->fbwrite_ptr = fbwrite_func[rdp->fb_size];
+
+#ifdef _DEBUG
+    ++render_cycle_mode_counts[rdp->other_modes.cycle_type];
+#endif
+
+    if (!span_lines_split(rdp, flip) && rdp->worker_num > 1)
+    {
+        rdp->deferred         = 1;
+        rdp->deferred_start   = yhlimit;
+        rdp->deferred_end     = yllimit;
+        rdp->deferred_tilenum = tilenum;
+        rdp->deferred_flip    = flip;
+        return;
+    }
+    draw_spans(rdp, yhlimit, yllimit, tilenum, flip);
 }
 
-static NOINLINE void loading_pipeline(
+static NOINLINE void loading_pipeline(struct rdp_state *rdp,
     int start, int end, int tilenum, int coord_quad, int ltlut)
 {
     int localdebugmode = 0, cnt = 0;
@@ -7020,7 +7134,7 @@ static NOINLINE void loading_pipeline(
 
     uint32_t tmemidx0 = 0, tmemidx1 = 0, tmemidx2 = 0, tmemidx3 = 0;
     int dswap = 0;
-    uint16_t* tmem16 = (uint16_t*)__TMEM;
+    uint16_t* tmem16 = (uint16_t*)rdp->__TMEM;
     uint32_t readval0, readval1, readval2, readval3;
     uint32_t readidx32;
     uint64_t loadqword;
@@ -7031,8 +7145,8 @@ static NOINLINE void loading_pipeline(
     int tiadvance = 0, spanadvance = 0;
     unsigned long tiptr;
 
-    dsinc = spans_d_stwz[0];
-    dtinc = spans_d_stwz[1];
+    dsinc = rdp->spans_d_stwz[0];
+    dtinc = rdp->spans_d_stwz[1];
 
     if (end > start && ltlut)
     {
@@ -7040,14 +7154,14 @@ static NOINLINE void loading_pipeline(
         return;
     }
 
-    if (tile[tilenum].format == FORMAT_YUV)
+    if (rdp->tile[tilenum].format == FORMAT_YUV)
         tmem_formatting = 0;
-    else if (tile[tilenum].format == FORMAT_RGBA && tile[tilenum].size == PIXEL_SIZE_32BIT)
+    else if (rdp->tile[tilenum].format == FORMAT_RGBA && rdp->tile[tilenum].size == PIXEL_SIZE_32BIT)
         tmem_formatting = 1;
     else
         tmem_formatting = 2;
 
-    switch (ti_size)
+    switch (rdp->ti_size)
     {
        case PIXEL_SIZE_4BIT:
           rdp_pipeline_crashed = 1;
@@ -7076,14 +7190,14 @@ static NOINLINE void loading_pipeline(
 
     for (i = start; i <= end; i++)
     {
-        xstart = span[i].lx;
-        xend = span[i].unscrx;
-        xendsc = span[i].rx;
-        s = span[i].stwz[0];
-        t = span[i].stwz[1];
+        xstart = rdp->span[i].lx;
+        xend = rdp->span[i].unscrx;
+        xendsc = rdp->span[i].rx;
+        s = rdp->span[i].stwz[0];
+        t = rdp->span[i].stwz[1];
 
-        ti_index = ti_width * i + xend;
-        tiptr = ti_address + PIXELS_TO_BYTES(ti_index, ti_size);
+        ti_index = rdp->ti_width * i + xend;
+        tiptr = rdp->ti_address + PIXELS_TO_BYTES(ti_index, rdp->ti_size);
         tiptr = tiptr & 0x00FFFFFF;
 
         length = (xstart - xend + 1) & 0xfff;
@@ -7096,11 +7210,11 @@ static NOINLINE void loading_pipeline(
             sss = ss & 0xffff;
             sst = st & 0xffff;
 
-            tc_pipeline_load(&sss, &sst, tilenum, coord_quad);
+            tc_pipeline_load(rdp, &sss, &sst, tilenum, coord_quad);
 
             dswap = sst & 1;
 
-            get_tmem_idx(sss, sst, tilenum, &tmemidx0, &tmemidx1, &tmemidx2, &tmemidx3, &bit3fl, &hibit);
+            get_tmem_idx(rdp, sss, sst, tilenum, &tmemidx0, &tmemidx1, &tmemidx2, &tmemidx3, &bit3fl, &hibit);
 
             readidx32 = (tiptr >> 2) & ~1;
             RREADIDX32(readval0, readidx32);
@@ -7250,7 +7364,7 @@ static NOINLINE void loading_pipeline(
     }
 }
 
-static void edgewalker_for_loads(int32_t* lewdata)
+static void edgewalker_for_loads(struct rdp_state *rdp, int32_t* lewdata)
 {
     int j = 0;
     int xleft = 0, xright = 0;
@@ -7286,7 +7400,7 @@ static void edgewalker_for_loads(int32_t* lewdata)
     int32_t yhlimit;
 
     flip = 1;
-    max_level = 0;
+    rdp->max_level = 0;
     tilenum = (lewdata[0] >> 16) & 7;
 
     
@@ -7313,16 +7427,16 @@ static void edgewalker_for_loads(int32_t* lewdata)
     dsdy = 0;
     dtdy = (lewdata[8] & 0xffff) << 16;
 
-    spans_d_stwz[0] = dsdx & ~0x1f;
-    spans_d_stwz[1] = dtdx & ~0x1f;
-    spans_d_stwz[2] = 0;
+    rdp->spans_d_stwz[0] = dsdx & ~0x1f;
+    rdp->spans_d_stwz[1] = dtdx & ~0x1f;
+    rdp->spans_d_stwz[2] = 0;
 
     xright = xh & ~0x1;
     xleft = xm & ~0x1;
 
 #define ADJUST_ATTR_LOAD() {           \
-    span[j].stwz[0] = s & ~0x000003FF; \
-    span[j].stwz[1] = t & ~0x000003FF; \
+    rdp->span[j].stwz[0] = s & ~0x000003FF; \
+    rdp->span[j].stwz[1] = t & ~0x000003FF; \
 }
 
 #define ADDVALUES_LOAD() { \
@@ -7366,14 +7480,14 @@ static void edgewalker_for_loads(int32_t* lewdata)
 
             if (spix == 0)
             {
-                span[j].unscrx = xend;
+                rdp->span[j].unscrx = xend;
                 ADJUST_ATTR_LOAD();
             }
 
             if (spix == 3)
             {
-                span[j].lx = maxxmx;
-                span[j].rx = minxhx;
+                rdp->span[j].lx = maxxmx;
+                rdp->span[j].rx = minxhx;
             }
         }
 
@@ -7383,7 +7497,7 @@ static void edgewalker_for_loads(int32_t* lewdata)
         }
     }
 
-    loading_pipeline(yhlimit >> 2, yllimit >> 2, tilenum, coord_quad, ltlut);
+    loading_pipeline(rdp, yhlimit >> 2, yllimit >> 2, tilenum, coord_quad, ltlut);
 }
 
 
@@ -7391,18 +7505,18 @@ static const char *const image_format[] = { "RGBA", "YUV", "CI", "IA", "I", "???
 static const char *const image_size[] = { "4-bit", "8-bit", "16-bit", "32-bit" };
 
 
-static void tile_tlut_common_cs_decoder(uint32_t w1, uint32_t w2)
+static void tile_tlut_common_cs_decoder(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     int32_t lewdata[10];
     int tilenum = (w2 >> 24) & 0x7;
     int sl, tl, sh, th;
 
-    tile[tilenum].sl = sl = ((w1 >> 12) & 0xfff);
-    tile[tilenum].tl = tl = ((w1 >>  0) & 0xfff);
-    tile[tilenum].sh = sh = ((w2 >> 12) & 0xfff);
-    tile[tilenum].th = th = ((w2 >>  0) & 0xfff);
+    rdp->tile[tilenum].sl = sl = ((w1 >> 12) & 0xfff);
+    rdp->tile[tilenum].tl = tl = ((w1 >>  0) & 0xfff);
+    rdp->tile[tilenum].sh = sh = ((w2 >> 12) & 0xfff);
+    rdp->tile[tilenum].th = th = ((w2 >>  0) & 0xfff);
 
-    calculate_clamp_diffs(tilenum);
+    calculate_clamp_diffs(rdp, tilenum);
 
     lewdata[0] = (w1 & 0xff000000) | (0x10 << 19) | (tilenum << 16) | (th | 3);
     lewdata[1] = ((th | 3) << 16) | (tl);
@@ -7411,18 +7525,35 @@ static void tile_tlut_common_cs_decoder(uint32_t w1, uint32_t w2)
     lewdata[4] = ((sh >> 2) << 16) | ((sh & 3) << 14);
     lewdata[5] = ((sl << 3) << 16) | (tl << 3);
     lewdata[6] = 0;
-    lewdata[7] = (0x200 >> ti_size) << 16;
+    lewdata[7] = (0x200 >> rdp->ti_size) << 16;
     lewdata[8] = 0x20;
     lewdata[9] = 0x20;
 
-    edgewalker_for_loads(lewdata);
+    edgewalker_for_loads(rdp, lewdata);
 }
 
-STRICTINLINE int32_t irand(void)
+static STRICTINLINE int32_t irand(struct rdp_state *rdp)
 {
-    iseed *= 0x343fd;
-    iseed += 0x269ec3;
-    return ((iseed >> 16) & 0x7fff);
+    rdp->iseed *= 0x343fd;
+    rdp->iseed += 0x269ec3;
+    return ((rdp->iseed >> 16) & 0x7fff);
+}
+
+/* advances the seed as `count` calls to irand() would, in O(log(count)) */
+static STRICTINLINE void irand_skip(struct rdp_state *rdp, uint32_t count)
+{
+    uint32_t seed = (uint32_t)rdp->iseed;
+    uint32_t mul = 0x343fd, add = 0x269ec3;
+
+    while (count != 0)
+    {
+        if (count & 1)
+            seed = seed*mul + add;
+        add *= mul + 1;
+        mul *= mul;
+        count >>= 1;
+    }
+    rdp->iseed = (int32_t)seed;
 }
 
 
@@ -7431,9 +7562,10 @@ STRICTINLINE int32_t irand(void)
 
 void rdp_close(void)
 {
+    rdp_fifo_close();
 }
 
-static STRICTINLINE int finalize_spanalpha(
+static STRICTINLINE int finalize_spanalpha(struct rdp_state *rdp,
     uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
     int possibilities[4];
@@ -7447,35 +7579,35 @@ static STRICTINLINE int finalize_spanalpha(
     possibilities[CVG_WRAP] += curpixel_cvg;
     possibilities[CVG_CLAMP] |= -(possibilities[CVG_CLAMP]>>3 & 1);
 
-    return (possibilities[other_modes.cvg_dest] & 7);
+    return (possibilities[rdp->other_modes.cvg_dest] & 7);
 }
 
-static void fbwrite_4(
+static void fbwrite_4(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
-    unsigned long addr  = fb_address + curpixel*1;
+    unsigned long addr  = rdp->fb_address + curpixel*1;
     addr &= 0x00FFFFFF;
 
     RWRITEADDR8(addr, 0x00);
 }
 
-static void fbwrite_8(
+static void fbwrite_8(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
-    unsigned long addr  = fb_address + 1*curpixel;
+    unsigned long addr  = rdp->fb_address + 1*curpixel;
     addr &= 0x00FFFFFF;
     PAIRWRITE8(addr, r, (r & 1) ? 3 : 0);
 }
 
-static void fbwrite_16(
+static void fbwrite_16(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
     uint16_t color;
     unsigned long addr;
-    int coverage = finalize_spanalpha(blend_en, curpixel_cvg, curpixel_memcvg);
+    int coverage = finalize_spanalpha(rdp, blend_en, curpixel_cvg, curpixel_memcvg);
 #undef CVG_DRAW
 #ifdef CVG_DRAW
     const int covdraw = (curpixel_cvg - 1) << 5;
@@ -7484,7 +7616,7 @@ static void fbwrite_16(
     g = covdraw;
     b = covdraw;
 #endif
-    if (fb_format != FORMAT_RGBA)
+    if (rdp->fb_format != FORMAT_RGBA)
     {
         color = (r << 8) | (coverage << 5);
         coverage = 0x00;
@@ -7497,23 +7629,23 @@ static void fbwrite_16(
         color = (r << 8) | (g << 3) | (b >> 2) | (coverage >> 2);
     }
 
-    addr  = fb_address + 2*curpixel;
+    addr  = rdp->fb_address + 2*curpixel;
     addr &= 0x00FFFFFF;
     addr  = addr >> 1;
     PAIRWRITE16(addr, color, coverage & 3);
 }
 
-static void fbwrite_32(
+static void fbwrite_32(struct rdp_state *rdp,
     uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en,
     uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
     uint32_t color;
     int coverage;
-    unsigned long addr  = fb_address + 4*curpixel;
+    unsigned long addr  = rdp->fb_address + 4*curpixel;
     addr &= 0x00FFFFFF;
     addr  = addr >> 2;
 
-    coverage = finalize_spanalpha(blend_en, curpixel_cvg, curpixel_memcvg);
+    coverage = finalize_spanalpha(rdp, blend_en, curpixel_cvg, curpixel_memcvg);
     color  = (r << 24) | (g << 16) | (b <<  8);
     color |= (coverage << 5);
 
@@ -7521,186 +7653,186 @@ static void fbwrite_32(
     PAIRWRITE32(addr, color, g, 0);
 }
 
-static void fbread_4(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static void fbread_4(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
-    COLOR_RED(memory_color)   = 0x00;
-    COLOR_GREEN(memory_color) = 0x00;
-    COLOR_BLUE(memory_color)  = 0x00;
-    COLOR_ALPHA(memory_color) = 0xE0;
+    COLOR_RED(rdp->memory_color)   = 0x00;
+    COLOR_GREEN(rdp->memory_color) = 0x00;
+    COLOR_BLUE(rdp->memory_color)  = 0x00;
+    COLOR_ALPHA(rdp->memory_color) = 0xE0;
     *curpixel_memcvg          = 7;
 }
 
-static void fbread2_4(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static void fbread2_4(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
-   COLOR_RED(pre_memory_color)   = 0x00;
-   COLOR_GREEN(pre_memory_color) = 0x00;
-   COLOR_BLUE(pre_memory_color)  = 0x00;
-   COLOR_ALPHA(pre_memory_color) = 0xE0;
+   COLOR_RED(rdp->pre_memory_color)   = 0x00;
+   COLOR_GREEN(rdp->pre_memory_color) = 0x00;
+   COLOR_BLUE(rdp->pre_memory_color)  = 0x00;
+   COLOR_ALPHA(rdp->pre_memory_color) = 0xE0;
    *curpixel_memcvg              = 7;
 }
 
-static void fbread_8(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static void fbread_8(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
    uint8_t mem;
-   uint32_t addr = fb_address + curpixel;
+   uint32_t addr = rdp->fb_address + curpixel;
    RREADADDR8(mem, addr);
 
-   COLOR_RED(memory_color)   = mem;
-   COLOR_GREEN(memory_color) = mem;
-   COLOR_BLUE(memory_color)  = mem;
-   COLOR_ALPHA(memory_color) = 0xE0;
+   COLOR_RED(rdp->memory_color)   = mem;
+   COLOR_GREEN(rdp->memory_color) = mem;
+   COLOR_BLUE(rdp->memory_color)  = mem;
+   COLOR_ALPHA(rdp->memory_color) = 0xE0;
    *curpixel_memcvg = 7;
 }
 
-static void fbread2_8(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static void fbread2_8(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
    uint8_t mem;
-   uint32_t addr = fb_address + curpixel;
+   uint32_t addr = rdp->fb_address + curpixel;
    RREADADDR8(mem, addr);
 
-   COLOR_RED(pre_memory_color)   = mem;
-   COLOR_GREEN(pre_memory_color) = mem;
-   COLOR_BLUE(pre_memory_color)  = mem;
-   COLOR_ALPHA(pre_memory_color) = 0xE0;
+   COLOR_RED(rdp->pre_memory_color)   = mem;
+   COLOR_GREEN(rdp->pre_memory_color) = mem;
+   COLOR_BLUE(rdp->pre_memory_color)  = mem;
+   COLOR_ALPHA(rdp->pre_memory_color) = 0xE0;
    *curpixel_memcvg = 7;
 }
 
-static INLINE void fbread_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static INLINE void fbread_16(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
 	uint16_t fword;
 	uint8_t hbyte;
-	uint32_t addr = (fb_address >> 1) + curpixel;
+	uint32_t addr = (rdp->fb_address >> 1) + curpixel;
 	
 	uint8_t lowbits;
 
 	
-	if (other_modes.image_read_en)
+	if (rdp->other_modes.image_read_en)
 	{
 		PAIRREAD16(fword, hbyte, addr);
 
-		if (fb_format == FORMAT_RGBA)
+		if (rdp->fb_format == FORMAT_RGBA)
 		{
-			COLOR_RED(memory_color)   = GET_HI(fword);
-			COLOR_GREEN(memory_color) = GET_MED(fword);
-			COLOR_BLUE(memory_color)  = GET_LOW(fword);
+			COLOR_RED(rdp->memory_color)   = GET_HI(fword);
+			COLOR_GREEN(rdp->memory_color) = GET_MED(fword);
+			COLOR_BLUE(rdp->memory_color)  = GET_LOW(fword);
 			lowbits = ((fword & 1) << 2) | hbyte;
 		}
 		else
 		{
-			COLOR_RED(memory_color)   = fword >> 8;
-         COLOR_GREEN(memory_color) = fword >> 8;
-         COLOR_BLUE(memory_color)  = fword >> 8;
+			COLOR_RED(rdp->memory_color)   = fword >> 8;
+         COLOR_GREEN(rdp->memory_color) = fword >> 8;
+         COLOR_BLUE(rdp->memory_color)  = fword >> 8;
 			lowbits = (fword >> 5) & 7;
 		}
 
 		*curpixel_memcvg = lowbits;
-		COLOR_ALPHA(memory_color) = lowbits << 5;
+		COLOR_ALPHA(rdp->memory_color) = lowbits << 5;
 	}
 	else
 	{
 		RREADIDX16(fword, addr);
 
-		if (fb_format == FORMAT_RGBA)
+		if (rdp->fb_format == FORMAT_RGBA)
 		{
-			COLOR_RED(memory_color)   = GET_HI(fword);
-			COLOR_GREEN(memory_color) = GET_MED(fword);
-			COLOR_BLUE(memory_color)  = GET_LOW(fword);
+			COLOR_RED(rdp->memory_color)   = GET_HI(fword);
+			COLOR_GREEN(rdp->memory_color) = GET_MED(fword);
+			COLOR_BLUE(rdp->memory_color)  = GET_LOW(fword);
 		}
 		else
       {
-			COLOR_RED(memory_color)   = fword >> 8;
-         COLOR_GREEN(memory_color) = fword >> 8;
-         COLOR_BLUE(memory_color)  = fword >> 8;
+			COLOR_RED(rdp->memory_color)   = fword >> 8;
+         COLOR_GREEN(rdp->memory_color) = fword >> 8;
+         COLOR_BLUE(rdp->memory_color)  = fword >> 8;
       }
 
 		*curpixel_memcvg = 7;
-		COLOR_ALPHA(memory_color) = 0xe0;
+		COLOR_ALPHA(rdp->memory_color) = 0xe0;
 	}
 }
 
-static INLINE void fbread2_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static INLINE void fbread2_16(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
 	uint16_t fword;
 	uint8_t hbyte;
-	uint32_t addr = (fb_address >> 1) + curpixel;
+	uint32_t addr = (rdp->fb_address >> 1) + curpixel;
 	
 	uint8_t lowbits;
 
-	if (other_modes.image_read_en)
+	if (rdp->other_modes.image_read_en)
 	{
 		PAIRREAD16(fword, hbyte, addr);
 
-		if (fb_format == FORMAT_RGBA)
+		if (rdp->fb_format == FORMAT_RGBA)
 		{
-			COLOR_RED(pre_memory_color)    = GET_HI(fword);
-			COLOR_GREEN(pre_memory_color)  = GET_MED(fword);
-			COLOR_BLUE(pre_memory_color)   = GET_LOW(fword);
+			COLOR_RED(rdp->pre_memory_color)    = GET_HI(fword);
+			COLOR_GREEN(rdp->pre_memory_color)  = GET_MED(fword);
+			COLOR_BLUE(rdp->pre_memory_color)   = GET_LOW(fword);
 			lowbits = ((fword & 1) << 2) | hbyte;
 		}
 		else
 		{
-			COLOR_RED(pre_memory_color)     = fword >> 8;
-         COLOR_GREEN(pre_memory_color)   = fword >> 8;
-         COLOR_BLUE(pre_memory_color)    = fword >> 8;
+			COLOR_RED(rdp->pre_memory_color)     = fword >> 8;
+         COLOR_GREEN(rdp->pre_memory_color)   = fword >> 8;
+         COLOR_BLUE(rdp->pre_memory_color)    = fword >> 8;
 			lowbits = (fword >> 5) & 7;
 		}
 
 		*curpixel_memcvg              = lowbits;
-		COLOR_ALPHA(pre_memory_color) = lowbits << 5;
+		COLOR_ALPHA(rdp->pre_memory_color) = lowbits << 5;
 	}
 	else
 	{
 		RREADIDX16(fword, addr);
 
-		if (fb_format == FORMAT_RGBA)
+		if (rdp->fb_format == FORMAT_RGBA)
 		{
-			COLOR_RED(pre_memory_color)   = GET_HI(fword);
-			COLOR_GREEN(pre_memory_color) = GET_MED(fword);
-			COLOR_BLUE(pre_memory_color)  = GET_LOW(fword);
+			COLOR_RED(rdp->pre_memory_color)   = GET_HI(fword);
+			COLOR_GREEN(rdp->pre_memory_color) = GET_MED(fword);
+			COLOR_BLUE(rdp->pre_memory_color)  = GET_LOW(fword);
 		}
 		else
       {
-			COLOR_RED(pre_memory_color)   = fword >> 8;
-         COLOR_GREEN(pre_memory_color) = fword >> 8;
-         COLOR_BLUE(pre_memory_color)  = fword >> 8;
+			COLOR_RED(rdp->pre_memory_color)   = fword >> 8;
+         COLOR_GREEN(rdp->pre_memory_color) = fword >> 8;
+         COLOR_BLUE(rdp->pre_memory_color)  = fword >> 8;
       }
 
 		*curpixel_memcvg              = 7;
-		COLOR_ALPHA(pre_memory_color) = 0xe0;
+		COLOR_ALPHA(rdp->pre_memory_color) = 0xe0;
 	}
 	
 }
 
-static void fbread_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static void fbread_32(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
-    uint32_t mem, addr = (fb_address >> 2) + curpixel;
+    uint32_t mem, addr = (rdp->fb_address >> 2) + curpixel;
     RREADIDX32(mem, addr);
 
-    COLOR_RED(memory_color)    = (mem >> 24) & 0xFF;
-    COLOR_GREEN(memory_color)  = (mem >> 16) & 0xFF;
-    COLOR_BLUE(memory_color)   = (mem >>  8) & 0xFF;
+    COLOR_RED(rdp->memory_color)    = (mem >> 24) & 0xFF;
+    COLOR_GREEN(rdp->memory_color)  = (mem >> 16) & 0xFF;
+    COLOR_BLUE(rdp->memory_color)   = (mem >>  8) & 0xFF;
 
-    COLOR_ALPHA(memory_color)  = (mem >>  0) & 0xFF;
-    COLOR_ALPHA(memory_color) |= ~(-other_modes.image_read_en);
-    COLOR_ALPHA(memory_color) &= 0xE0;
+    COLOR_ALPHA(rdp->memory_color)  = (mem >>  0) & 0xFF;
+    COLOR_ALPHA(rdp->memory_color) |= ~(-rdp->other_modes.image_read_en);
+    COLOR_ALPHA(rdp->memory_color) &= 0xE0;
 
-    *curpixel_memcvg = (unsigned char)(COLOR_ALPHA(memory_color)) >> 5;
+    *curpixel_memcvg = (unsigned char)(COLOR_ALPHA(rdp->memory_color)) >> 5;
 }
 
-static void fbread2_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
+static void fbread2_32(struct rdp_state *rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
-   uint32_t mem, addr = (fb_address >> 2) + curpixel; 
+   uint32_t mem, addr = (rdp->fb_address >> 2) + curpixel; 
    RREADIDX32(mem, addr);
 
-   COLOR_RED(pre_memory_color)    = (mem >> 24) & 0xFF;
-   COLOR_GREEN(pre_memory_color)  = (mem >> 16) & 0xFF;
-   COLOR_BLUE(pre_memory_color)   = (mem >>  8) & 0xFF;
+   COLOR_RED(rdp->pre_memory_color)    = (mem >> 24) & 0xFF;
+   COLOR_GREEN(rdp->pre_memory_color)  = (mem >> 16) & 0xFF;
+   COLOR_BLUE(rdp->pre_memory_color)   = (mem >>  8) & 0xFF;
 
-   COLOR_ALPHA(pre_memory_color)  = (mem >>  0) & 0xFF;
-   COLOR_ALPHA(pre_memory_color) |= ~(-other_modes.image_read_en);
-   COLOR_ALPHA(pre_memory_color)  &= 0xE0;
+   COLOR_ALPHA(rdp->pre_memory_color)  = (mem >>  0) & 0xFF;
+   COLOR_ALPHA(rdp->pre_memory_color) |= ~(-rdp->other_modes.image_read_en);
+   COLOR_ALPHA(rdp->pre_memory_color)  &= 0xE0;
 
-   *curpixel_memcvg = (unsigned char)(COLOR_ALPHA(pre_memory_color)) >> 5;
+   *curpixel_memcvg = (unsigned char)(COLOR_ALPHA(rdp->pre_memory_color)) >> 5;
 }
 
 
@@ -7739,12 +7871,6 @@ static void fbread2_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
  * ******************
 */
 
-#ifdef HAVE_RDP_DUMP
-#include "../mupen64plus-video-paraLLEl/rdp_dump.h"
-
-static int rdp_dump_active;
-#endif
-
 struct stepwalker_info
 {
 #ifdef USE_SSE_SUPPORT
@@ -7782,44 +7908,80 @@ static int cmd_ptr; /* for 64-bit elements, always <= +0x7FFF */
 /* static DP_FIFO cmd_fifo; */
 static DP_FIFO cmd_data[0x0003FFFF/sizeof(int64_t) + 1];
 
-static void invalid(uint32_t w1, uint32_t w2);
-static void noop(uint32_t w1, uint32_t w2);
-static void tri_noshade(uint32_t w1, uint32_t w2);
-static void tri_noshade_z(uint32_t w1, uint32_t w2);
-
-static void tri_tex(uint32_t w1, uint32_t w2);
-static void tri_tex_z(uint32_t w1, uint32_t w2);
-static void tri_shade(uint32_t w1, uint32_t w2);
-static void tri_shade_z(uint32_t w1, uint32_t w2);
-static void tri_texshade(uint32_t w1, uint32_t w2);
-static void tri_texshade_z(uint32_t w1, uint32_t w2);
-static void tex_rect(uint32_t w1, uint32_t w2);
-static void tex_rect_flip(uint32_t w1, uint32_t w2);
-static void sync_load(uint32_t w1, uint32_t w2);
-static void sync_pipe(uint32_t w1, uint32_t w2);
-static void sync_tile(uint32_t w1, uint32_t w2);
-static void sync_full(uint32_t w1, uint32_t w2);
-static void set_key_gb(uint32_t w1, uint32_t w2);
-static void set_key_r(uint32_t w1, uint32_t w2);
-static void set_convert(uint32_t w1, uint32_t w2);
-static void set_scissor(uint32_t w1, uint32_t w2);
-static void set_prim_depth(uint32_t w1, uint32_t w2);
-static void set_other_modes(uint32_t w1, uint32_t w2);
-static void set_tile_size(uint32_t w1, uint32_t w2);
-static void load_block(uint32_t w1, uint32_t w2);
-static void load_tlut(uint32_t w1, uint32_t w2);
-static void load_tile(uint32_t w1, uint32_t w2);
-static void set_tile(uint32_t w1, uint32_t w2);
-static void fill_rect(uint32_t w1, uint32_t w2);
-static void set_fill_color(uint32_t w1, uint32_t w2);
-static void set_fog_color(uint32_t w1, uint32_t w2);
-static void set_blend_color(uint32_t w1, uint32_t w2);
-static void set_prim_color(uint32_t w1, uint32_t w2);
-static void set_env_color(uint32_t w1, uint32_t w2);
-static void set_combine(uint32_t w1, uint32_t w2);
-static void set_texture_image(uint32_t w1, uint32_t w2);
-static void set_mask_image(uint32_t w1, uint32_t w2);
-static void set_color_image(uint32_t w1, uint32_t w2);
+/*
+ * Complete commands are copied out of cmd_data into rdp_fifo, a single-
+ * producer single-consumer ring drained by the rasterizer thread, so the
+ * emulation thread can go on as soon as a DP list has been parsed.  Commands
+ * never wrap around the end of the ring; the gap is padded with no-ops, so
+ * handlers can index rdp_fifo[rdp->cmd_cur + n] directly.
+ *
+ * rdp_fifo_head is only written by the emulation thread and rdp_fifo_tail
+ * only by the rasterizer.  Words are handed back to the producer through
+ * rdp_fifo_free, which lags the tail until the batch referencing them has
+ * been flushed.
+ */
+#define RDP_FIFO_SIZE   (0x0003FFFF/sizeof(int64_t) + 1)
+#define RDP_FIFO_MASK   (RDP_FIFO_SIZE - 1)
+
+static DP_FIFO rdp_fifo[RDP_FIFO_SIZE];
+static uint32_t rdp_fifo_head;
+static uint32_t rdp_fifo_tail;
+static uint32_t rdp_fifo_free;
+
+static pthread_t rdp_thread;
+static int rdp_thread_running;
+static int rdp_thread_shutdown;
+static pthread_mutex_t rdp_fifo_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rdp_fifo_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rdp_fifo_done = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Color image, Z image and scissor as set by the last commands pushed to the
+ * ring, which the rasterizer may not have reached yet.  Only touched by the
+ * emulation thread, for rdp_get_frame_buffer_info().
+ */
+static uint32_t submitted_color_w1, submitted_color_w2;
+static uint32_t submitted_mask_w2;
+static uint32_t submitted_scissor_w2;
+
+static void invalid(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void noop(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_noshade(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_noshade_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+
+static void tri_tex(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_tex_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_shade(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_shade_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_texshade(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tri_texshade_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tex_rect(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void tex_rect_flip(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void sync_load(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void sync_pipe(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void sync_tile(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void sync_full(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_key_gb(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_key_r(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_convert(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_scissor(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_prim_depth(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_other_modes(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_tile_size(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void load_block(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void load_tlut(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void load_tile(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_tile(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void fill_rect(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_fill_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_fog_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_blend_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_prim_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_env_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_combine(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_texture_image(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_mask_image(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
+static void set_color_image(struct rdp_state *rdp, uint32_t w1, uint32_t w2);
 
 static INLINE uint16_t normalize_dzpix(uint16_t sum)
 {
@@ -7837,7 +7999,7 @@ static INLINE uint16_t normalize_dzpix(uint16_t sum)
     return 0;
 }
 
-static void (*const rdp_command_table[64])(uint32_t, uint32_t) = {
+static void (*const rdp_command_table[64])(struct rdp_state *, uint32_t, uint32_t) = {
     noop              ,invalid           ,invalid           ,invalid           ,
     invalid           ,invalid           ,invalid           ,invalid           ,
     tri_noshade       ,tri_noshade_z     ,tri_tex           ,tri_tex_z         ,
@@ -7970,6 +8132,409 @@ static void count_DP_commands(void)
 }
 #endif
 
+/*
+ * With several workers, commands are queued by their cmd_data index and
+ * replayed by every worker at the next flush.  Flushing is forced wherever a
+ * worker could otherwise observe pixels that a different worker has not
+ * drawn yet:  at the end of each list, at SYNC_FULL, when the color or depth
+ * image moves (changing which worker owns which RDRAM) and when a texture
+ * load reads back from an area the queued primitives may have drawn to.
+ *
+ * Primitives that can touch the same RDRAM from two different scanlines,
+ * because the scissor reaches past the end of the line or because the color
+ * and depth images overlap at different strides, cannot be split by line at
+ * all; those are replayed in a batch of their own, drawn entirely by worker 0.
+ * Primitives whose pixels depend on the last pixel of the line before (see
+ * span_lines_split()) stop the replay instead, and worker 0 draws them alone
+ * before it resumes.
+ */
+static int rdp_batch[0x0003FFFF/sizeof(int64_t) + 1];
+static int rdp_batch_length;
+static int rdp_batch_next;
+static int rdp_batch_serial;
+
+static struct {
+    uint32_t fb_w1, fb_w2, zb_w2;
+    uint32_t ti_address;
+    int ti_size, ti_width;
+    int clip_xl, clip_yl;
+    uint32_t dirty_lo[2], dirty_hi[2]; /* color image, depth image */
+} rdp_batch_view;
+
+static void rdp_replay_batch(uint32_t worker_id)
+{
+    struct rdp_state *rdp = &rdp_states[worker_id];
+    const uint32_t worker_num = rdp->worker_num;
+    int i;
+
+    if (rdp_batch_serial)
+        rdp->worker_num = 1;
+    rdp->deferred = 0;
+    for (i = rdp_batch_next; i < rdp_batch_length && !rdp->deferred; i++)
+    {
+        const uint32_t w1 = rdp_fifo[rdp_batch[i]].UW32[0];
+        const uint32_t w2 = rdp_fifo[rdp_batch[i]].UW32[1];
+
+        rdp->cmd_cur = rdp_batch[i];
+        rdp_command_table[(w1 >> 24) % 64](rdp, w1, w2);
+    }
+    rdp->batch_resume = i;
+    rdp->worker_num = worker_num;
+}
+
+/*
+ * Copies what outlives a scanline from the worker that drew it last to all
+ * the others.  The dither noise seed is already the same everywhere, except
+ * after worker 0 has drawn on its own.
+ */
+static void rdp_gather_carries(uint32_t source)
+{
+    const struct rdp_state *src = &rdp_states[source];
+    uint32_t i;
+
+    for (i = 0; i < rdp_num_workers; i++)
+    {
+        struct rdp_state *rdp = &rdp_states[i];
+
+        if (i != source)
+        {
+            COLOR_ASSIGN(rdp->combined_color, src->combined_color);
+            COLOR_ASSIGN(rdp->memory_color, src->memory_color);
+            rdp->pastrawdzmem = src->pastrawdzmem;
+            rdp->iseed = src->iseed;
+        }
+        rdp->carry_worker = source;
+    }
+}
+
+static void rdp_flush_batch(void)
+{
+    struct rdp_state *rdp = &rdp_states[0];
+
+    if (rdp_batch_length == 0)
+        return;
+    rdp_batch_next = 0;
+    do
+    {
+        parallel_run(rdp_replay_batch);
+        rdp_gather_carries(rdp->carry_worker);
+        if (rdp->deferred)
+        {
+            rdp->worker_num = 1;
+            draw_spans(rdp, rdp->deferred_start, rdp->deferred_end,
+                rdp->deferred_tilenum, rdp->deferred_flip);
+            rdp->worker_num = rdp_num_workers;
+            rdp_gather_carries(0);
+        }
+        rdp_batch_next = rdp->batch_resume;
+    } while (rdp_batch_next < rdp_batch_length);
+    rdp_batch_length = 0;
+    rdp_batch_serial = 0;
+    rdp_batch_view.dirty_lo[0] = rdp_batch_view.dirty_hi[0] = 0;
+    rdp_batch_view.dirty_lo[1] = rdp_batch_view.dirty_hi[1] = 0;
+}
+
+static STRICTINLINE uint32_t batch_bytes(uint32_t pixels, int size)
+{ /* rounds 4-bit pixels up to a byte each, which only over-estimates */
+    return (size == PIXEL_SIZE_4BIT) ? pixels : pixels << (size - 1);
+}
+
+static void batch_range(uint32_t address, uint32_t length, uint32_t *lo, uint32_t *hi)
+{
+    *lo = address & 0x00FFFFFF;
+    *hi = *lo + length;
+    if (*hi > 0x01000000)
+    { /* wraps around the 16-MiB physical limit */
+        *lo = 0x00000000;
+        *hi = 0x01000000;
+    }
+}
+
+static void batch_mark_dirty(int image, uint32_t lo, uint32_t hi)
+{
+    if (rdp_batch_view.dirty_lo[image] == rdp_batch_view.dirty_hi[image])
+    {
+        rdp_batch_view.dirty_lo[image] = lo;
+        rdp_batch_view.dirty_hi[image] = hi;
+        return;
+    }
+    if (lo < rdp_batch_view.dirty_lo[image])
+        rdp_batch_view.dirty_lo[image] = lo;
+    if (hi > rdp_batch_view.dirty_hi[image])
+        rdp_batch_view.dirty_hi[image] = hi;
+}
+
+static int batch_reads_dirty(uint32_t address, uint32_t length)
+{
+    const uint32_t lo = address & 0x00FFFFFF;
+    const uint32_t hi = lo + length;
+    int image;
+
+    for (image = 0; image < 2; image++)
+    {
+        if (rdp_batch_view.dirty_lo[image] == rdp_batch_view.dirty_hi[image])
+            continue;
+        if (hi > 0x01000000)
+            return 1;
+        if (lo < rdp_batch_view.dirty_hi[image] && hi > rdp_batch_view.dirty_lo[image])
+            return 1;
+    }
+    return 0;
+}
+
+static void rdp_queue_command(int command, int index, uint32_t w1, uint32_t w2)
+{
+    const int dirty =
+        rdp_batch_view.dirty_lo[0] != rdp_batch_view.dirty_hi[0]
+     || rdp_batch_view.dirty_lo[1] != rdp_batch_view.dirty_hi[1];
+    const int fb_size  = (rdp_batch_view.fb_w1 & 0x00180000) >> (51 - 32);
+    const int fb_width = (rdp_batch_view.fb_w1 & 0x000003FF) + 1;
+    uint32_t rows, texels;
+    uint32_t lo[2], hi[2];
+
+    if (rdp_command_table[command] == sync_full
+     || rdp_command_table[command] == invalid)
+    { /* no RDP state, and must not be raised more than once */
+        rdp_flush_batch();
+        rdp_command_table[command](&rdp_states[0], w1, w2);
+        return;
+    }
+
+    switch (command)
+    {
+       case 0x08: case 0x09: case 0x0A: case 0x0B:
+       case 0x0C: case 0x0D: case 0x0E: case 0x0F:
+       case 0x24: case 0x25: case 0x36:
+          rows = (rdp_batch_view.clip_yl >> 2) + 1;
+          texels = rows*fb_width + (rdp_batch_view.clip_xl >> 2) + 1;
+          batch_range(rdp_batch_view.fb_w2,
+                batch_bytes(texels, fb_size) + 8, &lo[0], &hi[0]);
+          batch_range(rdp_batch_view.zb_w2,
+                batch_bytes(texels, PIXEL_SIZE_16BIT) + 8, &lo[1], &hi[1]);
+          if ((rdp_batch_view.clip_xl >> 2) >= fb_width
+           || (lo[0] < hi[1] && lo[1] < hi[0]
+            && (fb_size != PIXEL_SIZE_16BIT
+             || ((rdp_batch_view.fb_w2 ^ rdp_batch_view.zb_w2) & 0x00FFFFFF))))
+          {
+             rdp_flush_batch();
+             rdp_batch[rdp_batch_length++] = index;
+             rdp_batch_serial = 1;
+             rdp_flush_batch();
+             return;
+          }
+          batch_mark_dirty(0, lo[0], hi[0]);
+          batch_mark_dirty(1, lo[1], hi[1]);
+          break;
+       case 0x2D: /* Set_Scissor */
+          rdp_batch_view.clip_xl = (w2 & 0x00FFF000) >> (12 -  0);
+          rdp_batch_view.clip_yl = (w2 & 0x00000FFF) >> ( 0 -  0);
+          break;
+       case 0x30: /* Load_TLUT */
+       case 0x34: /* Load_Tile */
+          rows = ((w2 & 0x00000FFF) >> 2) + 1;
+          texels = rows*rdp_batch_view.ti_width + ((w2 & 0x00FFF000) >> 14) + 1;
+          if (batch_reads_dirty(rdp_batch_view.ti_address,
+                  batch_bytes(texels, rdp_batch_view.ti_size) + 16))
+             rdp_flush_batch();
+          break;
+       case 0x33: /* Load_Block */
+          rows = (w1 & 0x00000FFF) + 1;
+          texels = rows*rdp_batch_view.ti_width + ((w2 & 0x00FFF000) >> 12) + 1;
+          if (batch_reads_dirty(rdp_batch_view.ti_address,
+                  batch_bytes(texels, rdp_batch_view.ti_size) + 16))
+             rdp_flush_batch();
+          break;
+       case 0x3D: /* Set_Texture_Image */
+          rdp_batch_view.ti_size    = (w1 & 0x00180000) >> (51 - 32);
+          rdp_batch_view.ti_width   = (w1 & 0x000003FF) + 1;
+          rdp_batch_view.ti_address = w2 & 0x03FFFFFF;
+          break;
+       case 0x3E: /* Set_Mask_Image */
+          if (dirty && w2 != rdp_batch_view.zb_w2)
+             rdp_flush_batch();
+          rdp_batch_view.zb_w2 = w2;
+          break;
+       case 0x3F: /* Set_Color_Image */
+          if (dirty && (w1 != rdp_batch_view.fb_w1 || w2 != rdp_batch_view.fb_w2))
+             rdp_flush_batch();
+          rdp_batch_view.fb_w1 = w1;
+          rdp_batch_view.fb_w2 = w2;
+          break;
+    }
+    rdp_batch[rdp_batch_length++] = index;
+}
+
+static void rdp_fifo_drain(void)
+{
+    const uint32_t head = __atomic_load_n(&rdp_fifo_head, __ATOMIC_ACQUIRE);
+
+    while (rdp_fifo_tail != head)
+    {
+        const int index = rdp_fifo_tail & RDP_FIFO_MASK;
+        const uint32_t w1 = rdp_fifo[index].UW32[0];
+        const uint32_t w2 = rdp_fifo[index].UW32[1];
+        const int command = (w1 >> 24) % 64;
+
+        if (rdp_num_workers > 1)
+            rdp_queue_command(command, index, w1, w2);
+        else
+        {
+            rdp_states[0].cmd_cur = index;
+            rdp_command_table[command](&rdp_states[0], w1, w2);
+        }
+        rdp_fifo_tail += DP_CMD_LEN_W[command];
+        if (rdp_batch_length == 0)
+            __atomic_store_n(&rdp_fifo_free, rdp_fifo_tail, __ATOMIC_RELEASE);
+    }
+    rdp_flush_batch();
+    __atomic_store_n(&rdp_fifo_free, rdp_fifo_tail, __ATOMIC_RELEASE);
+}
+
+static void* rdp_thread_main(void* arg)
+{
+    pthread_mutex_lock(&rdp_fifo_lock);
+    for (;;)
+    {
+        while (rdp_fifo_tail == __atomic_load_n(&rdp_fifo_head, __ATOMIC_ACQUIRE)
+            && !rdp_thread_shutdown)
+            pthread_cond_wait(&rdp_fifo_work, &rdp_fifo_lock);
+        if (rdp_thread_shutdown)
+            break;
+        pthread_mutex_unlock(&rdp_fifo_lock);
+
+        rdp_fifo_drain();
+
+        pthread_mutex_lock(&rdp_fifo_lock);
+        pthread_cond_broadcast(&rdp_fifo_done);
+    }
+    pthread_mutex_unlock(&rdp_fifo_lock);
+    return NULL;
+}
+
+/* Hands everything pushed so far to the rasterizer. */
+static void rdp_fifo_kick(void)
+{
+    if (!rdp_thread_running)
+    {
+        rdp_fifo_drain();
+        return;
+    }
+    pthread_mutex_lock(&rdp_fifo_lock);
+    pthread_cond_signal(&rdp_fifo_work);
+    pthread_mutex_unlock(&rdp_fifo_lock);
+}
+
+/* Waits until every pushed command has been drawn to RDRAM. */
+void rdp_sync(void)
+{
+    if (!rdp_thread_running)
+    {
+        rdp_fifo_drain();
+        return;
+    }
+    if (__atomic_load_n(&rdp_fifo_free, __ATOMIC_ACQUIRE) == rdp_fifo_head)
+        return; /* the core calls in here on CPU accesses to the images */
+    pthread_mutex_lock(&rdp_fifo_lock);
+    pthread_cond_signal(&rdp_fifo_work);
+    while (__atomic_load_n(&rdp_fifo_free, __ATOMIC_ACQUIRE) != rdp_fifo_head)
+        pthread_cond_wait(&rdp_fifo_done, &rdp_fifo_lock);
+    pthread_mutex_unlock(&rdp_fifo_lock);
+}
+
+static void rdp_fifo_reserve(uint32_t length)
+{
+    if (rdp_fifo_head + length - __atomic_load_n(&rdp_fifo_free, __ATOMIC_ACQUIRE) <= RDP_FIFO_SIZE)
+        return;
+    if (!rdp_thread_running)
+    {
+        rdp_fifo_drain();
+        return;
+    }
+    pthread_mutex_lock(&rdp_fifo_lock);
+    pthread_cond_signal(&rdp_fifo_work);
+    while (rdp_fifo_head + length - __atomic_load_n(&rdp_fifo_free, __ATOMIC_ACQUIRE) > RDP_FIFO_SIZE)
+        pthread_cond_wait(&rdp_fifo_done, &rdp_fifo_lock);
+    pthread_mutex_unlock(&rdp_fifo_lock);
+}
+
+static void rdp_fifo_push(const DP_FIFO *words, int length)
+{
+    uint32_t head = rdp_fifo_head;
+    uint32_t pad = 0;
+    int i;
+
+    if ((head & RDP_FIFO_MASK) + length > RDP_FIFO_SIZE)
+        pad = RDP_FIFO_SIZE - (head & RDP_FIFO_MASK);
+    rdp_fifo_reserve(pad + length);
+
+    for (; pad != 0; pad--, head++)
+        rdp_fifo[head & RDP_FIFO_MASK].UW = 0x0000000000000000; /* No_Op */
+    for (i = 0; i < length; i++, head++)
+        rdp_fifo[head & RDP_FIFO_MASK] = words[i];
+    __atomic_store_n(&rdp_fifo_head, head, __ATOMIC_RELEASE);
+}
+
+static void rdp_fifo_open(void)
+{
+    rdp_fifo_head = rdp_fifo_tail = rdp_fifo_free = 0;
+    submitted_color_w1 = submitted_color_w2 = 0;
+    submitted_mask_w2 = submitted_scissor_w2 = 0;
+    rdp_thread_shutdown = 0;
+    rdp_thread_running = rdp_fifo_threaded
+        && pthread_create(&rdp_thread, NULL, rdp_thread_main, NULL) == 0;
+}
+
+static void rdp_fifo_close(void)
+{
+    if (!rdp_thread_running)
+        return;
+    rdp_sync();
+
+    pthread_mutex_lock(&rdp_fifo_lock);
+    rdp_thread_shutdown = 1;
+    pthread_cond_signal(&rdp_fifo_work);
+    pthread_mutex_unlock(&rdp_fifo_lock);
+    pthread_join(rdp_thread, NULL);
+    rdp_thread_running = 0;
+}
+
+void rdp_get_tmem(uint8_t *tmem)
+{
+    rdp_sync();
+    memcpy(tmem, rdp_states[0].__TMEM, sizeof(rdp_states[0].__TMEM));
+}
+
+void rdp_set_tmem(const uint8_t *tmem)
+{
+    uint32_t i;
+
+    rdp_sync();
+    for (i = 0; i < rdp_num_workers; i++)
+        memcpy(rdp_states[i].__TMEM, tmem, sizeof(rdp_states[i].__TMEM));
+}
+
+void rdp_get_frame_buffer_info(void *pinfo)
+{
+    FrameBufferInfo *info = (FrameBufferInfo *)pinfo;
+    const uint32_t fb_size = (submitted_color_w1 & 0x00180000) >> (51 - 32);
+
+    memset(info, 0, 6 * sizeof(*info));
+    if (!rdp_thread_running || submitted_color_w2 == 0)
+        return; /* drawing is synchronous, nothing to wait for */
+
+    info[0].addr   = submitted_color_w2 & 0x00FFFFFF;
+    info[0].size   = (1 << fb_size) >> 1; /* bytes per pixel, none for 4-bit */
+    info[0].width  = (submitted_color_w1 & 0x000003FF) + 1;
+    info[0].height = (submitted_scissor_w2 & 0x00000FFF) >> 2;
+    if (submitted_mask_w2 != 0 && submitted_mask_w2 != submitted_color_w2)
+    {
+        info[1].addr   = submitted_mask_w2 & 0x00FFFFFF;
+        info[1].size   = 2;
+        info[1].width  = info[0].width;
+        info[1].height = info[0].height;
+    }
+}
+
 void process_RDP_list(void)
 {
     int length;
@@ -7989,15 +8554,8 @@ void process_RDP_list(void)
         return;
     }
 
-#ifdef HAVE_RDP_DUMP
-    /* Flush out changes in DRAM if anything has changed. */
-    if (!rdp_dump_active)
-    {
-       rdp_dump_flush_dram(DRAM, 8 * 1024 * 1024);
-       rdp_dump_begin_command_list();
-       rdp_dump_active = 1;
-    }
-#endif
+    if (capture_active)
+        capture_begin_list();
 
     --length; /* filling in cmd data in backwards order for performance */
     offset = (DP_END - sizeof(int64_t)) / sizeof(int64_t);
@@ -8039,18 +8597,39 @@ void process_RDP_list(void)
         if (cmd_ptr - cmd_cur - cmd_length < 0)
             goto exit_b;
 
-#ifdef HAVE_RDP_DUMP
-        rdp_dump_emit_command(command,
-              (const uint32_t*)(cmd_data + cmd_cur), cmd_length * 2);
-#endif
+        if (capture_active)
+            capture_command(&cmd_data[cmd_cur], cmd_length);
 
-        rdp_command_table[command](w1, w2);
+        switch (command)
+        {
+            case 0x2D: /* Set_Scissor */
+                submitted_scissor_w2 = w2;
+                break;
+            case 0x3E: /* Set_Mask_Image */
+                submitted_mask_w2 = w2;
+                break;
+            case 0x3F: /* Set_Color_Image */
+                submitted_color_w1 = w1;
+                submitted_color_w2 = w2;
+                break;
+        }
+
+        if (rdp_command_table[command] == sync_full)
+        { /* raises the DP interrupt, so everything before it must be drawn */
+            rdp_sync();
+            sync_full(&rdp_states[0], w1, w2);
+        }
+        else
+            rdp_fifo_push(&cmd_data[cmd_cur], cmd_length);
         cmd_cur += cmd_length;
     };
 exit_a:
     cmd_ptr = 0;
     cmd_cur = 0;
 exit_b:
+    rdp_fifo_kick();
+    if (capture_active)
+        capture_end_list();
     *GET_GFX_INFO(DPC_START_REG)
   = *GET_GFX_INFO(DPC_CURRENT_REG)
   = *GET_GFX_INFO(DPC_END_REG);
@@ -8058,7 +8637,7 @@ exit_b:
 
 static char invalid_command[] = "00\nDP reserved command.";
 
-static void invalid(uint32_t w1, uint32_t w2)
+static void invalid(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     const unsigned int command = (w1 & 0x3F000000) >> 24;
 
@@ -8067,13 +8646,13 @@ static void invalid(uint32_t w1, uint32_t w2)
     DisplayError(invalid_command);
 }
 
-static void noop(uint32_t w1, uint32_t w2)
+static void noop(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
 }
 
-static INLINE void stepwalker_info_init(struct stepwalker_info *stw_info)
+static INLINE void stepwalker_info_init(struct rdp_state *rdp, struct stepwalker_info *stw_info)
 {
-   stw_info->base = cmd_cur + 0;
+   stw_info->base = rdp->cmd_cur + 0;
 
    setzero_si64(stw_info->rgba_int);
    setzero_si64(stw_info->rgba_frac);
@@ -8094,7 +8673,7 @@ static INLINE void stepwalker_info_init(struct stepwalker_info *stw_info)
 
 }
 
-static NOINLINE void draw_triangle(uint32_t w1, uint32_t w2,
+static NOINLINE void draw_triangle(struct rdp_state *rdp, uint32_t w1, uint32_t w2,
       int shade, int texture, int zbuffer, struct stepwalker_info *stw_info)
 {
     int sign_dxhdy;
@@ -8106,32 +8685,31 @@ static NOINLINE void draw_triangle(uint32_t w1, uint32_t w2,
     int allover, allunder, curover, curunder;
     int allinval;
     int j, k;
-    const int32_t clipxlshift = __clip.xl << 1;
-    const int32_t clipxhshift = __clip.xh << 1;
+    const int32_t clipxlshift = rdp->__clip.xl << 1;
+    const int32_t clipxhshift = rdp->__clip.xh << 1;
 
-    stepwalker_info_init(stw_info);
+    stepwalker_info_init(rdp, stw_info);
 
     /* Edge Coefficients */
     int lft     = (w1 & 0x00800000) >> (55 - 32);
     /* unused  (w1 & 0x00400000) >> (54 - 32) */
     int level   = (w1 & 0x00380000) >> (51 - 32);
-    int tile    = (w1 & 0x00070000) >> (48 - 32);
+    int tilenum = (w1 & 0x00070000) >> (48 - 32);
     int flip    = lft;
-    max_level   = level;
-    int tilenum = tile;
+    rdp->max_level   = level;
 
     /* Triangle edge Y-coordinates */
     int32_t      yl = (w1 & 0x0000FFFF) >> (32 - 32); /* & 0x3FFF */
     int32_t      ym = (w2 & 0xFFFF0000) >> (16 -  0); /* & 0x3FFF */
     int32_t      yh = (w2 & 0x0000FFFF) >> ( 0 -  0); /* & 0x3FFF */
     /* Triangle edge X-coordinates */
-    int32_t      xl = cmd_data[stw_info->base + 1].UW32[0];
-    int32_t      xh = cmd_data[stw_info->base + 2].UW32[0];
-    int32_t      xm = cmd_data[stw_info->base + 3].UW32[0];
+    int32_t      xl = rdp_fifo[stw_info->base + 1].UW32[0];
+    int32_t      xh = rdp_fifo[stw_info->base + 2].UW32[0];
+    int32_t      xm = rdp_fifo[stw_info->base + 3].UW32[0];
     /* Triangle edge inverse-slopes */
-    int32_t   DxLDy = cmd_data[stw_info->base + 1].UW32[1];
-    int32_t   DxHDy = cmd_data[stw_info->base + 2].UW32[1];
-    int32_t   DxMDy = cmd_data[stw_info->base + 3].UW32[1];
+    int32_t   DxLDy = rdp_fifo[stw_info->base + 1].UW32[1];
+    int32_t   DxHDy = rdp_fifo[stw_info->base + 2].UW32[1];
+    int32_t   DxMDy = rdp_fifo[stw_info->base + 3].UW32[1];
 
     yl = SIGN(yl, 14);
     ym = SIGN(ym, 14);
@@ -8144,38 +8722,38 @@ static NOINLINE void draw_triangle(uint32_t w1, uint32_t w2,
     /* Shade Coefficients */
     if (shade == 0) /* branch unlikely */
         goto no_read_shade_coefficients;
-    stw_info->rgba_int[0] = (cmd_data[stw_info->base + 4].UW32[0] >> 16) & 0xFFFF;
-    stw_info->rgba_int[1] = (cmd_data[stw_info->base + 4].UW32[0] >>  0) & 0xFFFF;
-    stw_info->rgba_int[2] = (cmd_data[stw_info->base + 4].UW32[1] >> 16) & 0xFFFF;
-    stw_info->rgba_int[3] = (cmd_data[stw_info->base + 4].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dx_int[0] = (cmd_data[stw_info->base + 5].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dx_int[1] = (cmd_data[stw_info->base + 5].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dx_int[2] = (cmd_data[stw_info->base + 5].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dx_int[3] = (cmd_data[stw_info->base + 5].UW32[1] >>  0) & 0xFFFF;
-    stw_info->rgba_frac[0] = (cmd_data[stw_info->base + 6].UW32[0] >> 16) & 0xFFFF;
-    stw_info->rgba_frac[1] = (cmd_data[stw_info->base + 6].UW32[0] >>  0) & 0xFFFF;
-    stw_info->rgba_frac[2] = (cmd_data[stw_info->base + 6].UW32[1] >> 16) & 0xFFFF;
-    stw_info->rgba_frac[3] = (cmd_data[stw_info->base + 6].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dx_frac[0] = (cmd_data[stw_info->base + 7].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dx_frac[1] = (cmd_data[stw_info->base + 7].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dx_frac[2] = (cmd_data[stw_info->base + 7].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dx_frac[3] = (cmd_data[stw_info->base + 7].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_rgba_de_int[0] = (cmd_data[stw_info->base + 8].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_rgba_de_int[1] = (cmd_data[stw_info->base + 8].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_rgba_de_int[2] = (cmd_data[stw_info->base + 8].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_rgba_de_int[3] = (cmd_data[stw_info->base + 8].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dy_int[0] = (cmd_data[stw_info->base + 9].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dy_int[1] = (cmd_data[stw_info->base + 9].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dy_int[2] = (cmd_data[stw_info->base + 9].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dy_int[3] = (cmd_data[stw_info->base + 9].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_rgba_de_frac[0] = (cmd_data[stw_info->base + 10].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_rgba_de_frac[1] = (cmd_data[stw_info->base + 10].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_rgba_de_frac[2] = (cmd_data[stw_info->base + 10].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_rgba_de_frac[3] = (cmd_data[stw_info->base + 10].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dy_frac[0] = (cmd_data[stw_info->base + 11].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dy_frac[1] = (cmd_data[stw_info->base + 11].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_rgba_dy_frac[2] = (cmd_data[stw_info->base + 11].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_rgba_dy_frac[3] = (cmd_data[stw_info->base + 11].UW32[1] >>  0) & 0xFFFF;
+    stw_info->rgba_int[0] = (rdp_fifo[stw_info->base + 4].UW32[0] >> 16) & 0xFFFF;
+    stw_info->rgba_int[1] = (rdp_fifo[stw_info->base + 4].UW32[0] >>  0) & 0xFFFF;
+    stw_info->rgba_int[2] = (rdp_fifo[stw_info->base + 4].UW32[1] >> 16) & 0xFFFF;
+    stw_info->rgba_int[3] = (rdp_fifo[stw_info->base + 4].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dx_int[0] = (rdp_fifo[stw_info->base + 5].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dx_int[1] = (rdp_fifo[stw_info->base + 5].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dx_int[2] = (rdp_fifo[stw_info->base + 5].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dx_int[3] = (rdp_fifo[stw_info->base + 5].UW32[1] >>  0) & 0xFFFF;
+    stw_info->rgba_frac[0] = (rdp_fifo[stw_info->base + 6].UW32[0] >> 16) & 0xFFFF;
+    stw_info->rgba_frac[1] = (rdp_fifo[stw_info->base + 6].UW32[0] >>  0) & 0xFFFF;
+    stw_info->rgba_frac[2] = (rdp_fifo[stw_info->base + 6].UW32[1] >> 16) & 0xFFFF;
+    stw_info->rgba_frac[3] = (rdp_fifo[stw_info->base + 6].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dx_frac[0] = (rdp_fifo[stw_info->base + 7].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dx_frac[1] = (rdp_fifo[stw_info->base + 7].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dx_frac[2] = (rdp_fifo[stw_info->base + 7].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dx_frac[3] = (rdp_fifo[stw_info->base + 7].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_rgba_de_int[0] = (rdp_fifo[stw_info->base + 8].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_rgba_de_int[1] = (rdp_fifo[stw_info->base + 8].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_rgba_de_int[2] = (rdp_fifo[stw_info->base + 8].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_rgba_de_int[3] = (rdp_fifo[stw_info->base + 8].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dy_int[0] = (rdp_fifo[stw_info->base + 9].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dy_int[1] = (rdp_fifo[stw_info->base + 9].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dy_int[2] = (rdp_fifo[stw_info->base + 9].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dy_int[3] = (rdp_fifo[stw_info->base + 9].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_rgba_de_frac[0] = (rdp_fifo[stw_info->base + 10].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_rgba_de_frac[1] = (rdp_fifo[stw_info->base + 10].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_rgba_de_frac[2] = (rdp_fifo[stw_info->base + 10].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_rgba_de_frac[3] = (rdp_fifo[stw_info->base + 10].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dy_frac[0] = (rdp_fifo[stw_info->base + 11].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dy_frac[1] = (rdp_fifo[stw_info->base + 11].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_rgba_dy_frac[2] = (rdp_fifo[stw_info->base + 11].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_rgba_dy_frac[3] = (rdp_fifo[stw_info->base + 11].UW32[1] >>  0) & 0xFFFF;
     stw_info->base += 8;
 no_read_shade_coefficients:
     stw_info->base -= 8;
@@ -8199,38 +8777,38 @@ no_read_shade_coefficients:
     /* Texture Coefficients */
     if (texture == 0)
         goto no_read_texture_coefficients;
-    stw_info->stwz_int[0]       = (cmd_data[stw_info->base + 12].UW32[0] >> 16) & 0xFFFF;
-    stw_info->stwz_int[1]       = (cmd_data[stw_info->base + 12].UW32[0] >>  0) & 0xFFFF;
-    stw_info->stwz_int[2]       = (cmd_data[stw_info->base + 12].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->stwz_int[3]       = (cmd_data[stw_info->base + 12].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->d_stwz_dx_int[0]  = (cmd_data[stw_info->base + 13].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_dx_int[1]  = (cmd_data[stw_info->base + 13].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_dx_int[2]  = (cmd_data[stw_info->base + 13].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->d_stwz_dx_int[3]  = (cmd_data[stw_info->base + 13].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->stwz_frac[0]      = (cmd_data[stw_info->base + 14].UW32[0] >> 16) & 0xFFFF;
-    stw_info->stwz_frac[1]      = (cmd_data[stw_info->base + 14].UW32[0] >>  0) & 0xFFFF;
-    stw_info->stwz_frac[2]      = (cmd_data[stw_info->base + 14].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->stwz_frac[3]      = (cmd_data[stw_info->base + 14].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->d_stwz_dx_frac[0] = (cmd_data[stw_info->base + 15].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_dx_frac[1] = (cmd_data[stw_info->base + 15].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_dx_frac[2] = (cmd_data[stw_info->base + 15].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->d_stwz_dx_frac[3] = (cmd_data[stw_info->base + 15].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->d_stwz_de_int[0]  = (cmd_data[stw_info->base + 16].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_de_int[1]  = (cmd_data[stw_info->base + 16].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_de_int[2]  = (cmd_data[stw_info->base + 16].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->d_stwz_de_int[3]  = (cmd_data[stw_info->base + 16].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->d_stwz_dy_int[0]  = (cmd_data[stw_info->base + 17].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_dy_int[1]  = (cmd_data[stw_info->base + 17].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_dy_int[2]  = (cmd_data[stw_info->base + 17].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->d_stwz_dy_int[3]  = (cmd_data[stw_info->base + 17].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->d_stwz_de_frac[0] = (cmd_data[stw_info->base + 18].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_de_frac[1] = (cmd_data[stw_info->base + 18].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_de_frac[2] = (cmd_data[stw_info->base + 18].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->d_stwz_de_frac[3] = (cmd_data[stw_info->base + 18].UW32[1] >>  0) & 0xFFFF; */
-    stw_info->d_stwz_dy_frac[0] = (cmd_data[stw_info->base + 19].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_dy_frac[1] = (cmd_data[stw_info->base + 19].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_dy_frac[2] = (cmd_data[stw_info->base + 19].UW32[1] >> 16) & 0xFFFF;
- /* stw_info->d_stwz_dy_frac[3] = (cmd_data[stw_info->base + 19].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->stwz_int[0]       = (rdp_fifo[stw_info->base + 12].UW32[0] >> 16) & 0xFFFF;
+    stw_info->stwz_int[1]       = (rdp_fifo[stw_info->base + 12].UW32[0] >>  0) & 0xFFFF;
+    stw_info->stwz_int[2]       = (rdp_fifo[stw_info->base + 12].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->stwz_int[3]       = (rdp_fifo[stw_info->base + 12].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->d_stwz_dx_int[0]  = (rdp_fifo[stw_info->base + 13].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_dx_int[1]  = (rdp_fifo[stw_info->base + 13].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_dx_int[2]  = (rdp_fifo[stw_info->base + 13].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->d_stwz_dx_int[3]  = (rdp_fifo[stw_info->base + 13].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->stwz_frac[0]      = (rdp_fifo[stw_info->base + 14].UW32[0] >> 16) & 0xFFFF;
+    stw_info->stwz_frac[1]      = (rdp_fifo[stw_info->base + 14].UW32[0] >>  0) & 0xFFFF;
+    stw_info->stwz_frac[2]      = (rdp_fifo[stw_info->base + 14].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->stwz_frac[3]      = (rdp_fifo[stw_info->base + 14].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->d_stwz_dx_frac[0] = (rdp_fifo[stw_info->base + 15].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_dx_frac[1] = (rdp_fifo[stw_info->base + 15].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_dx_frac[2] = (rdp_fifo[stw_info->base + 15].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->d_stwz_dx_frac[3] = (rdp_fifo[stw_info->base + 15].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->d_stwz_de_int[0]  = (rdp_fifo[stw_info->base + 16].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_de_int[1]  = (rdp_fifo[stw_info->base + 16].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_de_int[2]  = (rdp_fifo[stw_info->base + 16].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->d_stwz_de_int[3]  = (rdp_fifo[stw_info->base + 16].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->d_stwz_dy_int[0]  = (rdp_fifo[stw_info->base + 17].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_dy_int[1]  = (rdp_fifo[stw_info->base + 17].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_dy_int[2]  = (rdp_fifo[stw_info->base + 17].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->d_stwz_dy_int[3]  = (rdp_fifo[stw_info->base + 17].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->d_stwz_de_frac[0] = (rdp_fifo[stw_info->base + 18].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_de_frac[1] = (rdp_fifo[stw_info->base + 18].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_de_frac[2] = (rdp_fifo[stw_info->base + 18].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->d_stwz_de_frac[3] = (rdp_fifo[stw_info->base + 18].UW32[1] >>  0) & 0xFFFF; */
+    stw_info->d_stwz_dy_frac[0] = (rdp_fifo[stw_info->base + 19].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_dy_frac[1] = (rdp_fifo[stw_info->base + 19].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_dy_frac[2] = (rdp_fifo[stw_info->base + 19].UW32[1] >> 16) & 0xFFFF;
+ /* stw_info->d_stwz_dy_frac[3] = (rdp_fifo[stw_info->base + 19].UW32[1] >>  0) & 0xFFFF; */
     stw_info->base += 8;
 no_read_texture_coefficients:
     stw_info->base -= 8;
@@ -8238,14 +8816,14 @@ no_read_texture_coefficients:
     /* Z-Buffer Coefficients */
     if (zbuffer == 0) /* branch unlikely */
         goto no_read_zbuffer_coefficients;
-    stw_info->stwz_int[3]       = (cmd_data[stw_info->base + 20].UW32[0] >> 16) & 0xFFFF;
-    stw_info->stwz_frac[3]      = (cmd_data[stw_info->base + 20].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_dx_int[3]  = (cmd_data[stw_info->base + 20].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_stwz_dx_frac[3] = (cmd_data[stw_info->base + 20].UW32[1] >>  0) & 0xFFFF;
-    stw_info->d_stwz_de_int[3]  = (cmd_data[stw_info->base + 21].UW32[0] >> 16) & 0xFFFF;
-    stw_info->d_stwz_de_frac[3] = (cmd_data[stw_info->base + 21].UW32[0] >>  0) & 0xFFFF;
-    stw_info->d_stwz_dy_int[3]  = (cmd_data[stw_info->base + 21].UW32[1] >> 16) & 0xFFFF;
-    stw_info->d_stwz_dy_frac[3] = (cmd_data[stw_info->base + 21].UW32[1] >>  0) & 0xFFFF;
+    stw_info->stwz_int[3]       = (rdp_fifo[stw_info->base + 20].UW32[0] >> 16) & 0xFFFF;
+    stw_info->stwz_frac[3]      = (rdp_fifo[stw_info->base + 20].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_dx_int[3]  = (rdp_fifo[stw_info->base + 20].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_stwz_dx_frac[3] = (rdp_fifo[stw_info->base + 20].UW32[1] >>  0) & 0xFFFF;
+    stw_info->d_stwz_de_int[3]  = (rdp_fifo[stw_info->base + 21].UW32[0] >> 16) & 0xFFFF;
+    stw_info->d_stwz_de_frac[3] = (rdp_fifo[stw_info->base + 21].UW32[0] >>  0) & 0xFFFF;
+    stw_info->d_stwz_dy_int[3]  = (rdp_fifo[stw_info->base + 21].UW32[1] >> 16) & 0xFFFF;
+    stw_info->d_stwz_dy_frac[3] = (rdp_fifo[stw_info->base + 21].UW32[1] >>  0) & 0xFFFF;
     stw_info->base += 8;
 no_read_zbuffer_coefficients:
     stw_info->base -= 8;
@@ -8271,44 +8849,44 @@ no_read_zbuffer_coefficients:
 #endif
 
     /* rest of edgewalker algorithm */
-    spans_d_rgba[0]    = stw_info->d_rgba_dx[0] & ~0x0000001F;
-    spans_d_rgba[1]    = stw_info->d_rgba_dx[1] & ~0x0000001F;
-    spans_d_rgba[2]    = stw_info->d_rgba_dx[2] & ~0x0000001F;
-    spans_d_rgba[3]    = stw_info->d_rgba_dx[3] & ~0x0000001F;
-    spans_d_stwz[0]    = stw_info->d_stwz_dx[0] & ~0x0000001F;
-    spans_d_stwz[1]    = stw_info->d_stwz_dx[1] & ~0x0000001F;
-    spans_d_stwz[2]    = stw_info->d_stwz_dx[2] & ~0x0000001F;
-    spans_d_stwz[3]    = stw_info->d_stwz_dx[3];
-
-    spans_d_rgba_dy[0] = stw_info->d_rgba_dy[0] >> 14;
-    spans_d_rgba_dy[1] = stw_info->d_rgba_dy[1] >> 14;
-    spans_d_rgba_dy[2] = stw_info->d_rgba_dy[2] >> 14;
-    spans_d_rgba_dy[3] = stw_info->d_rgba_dy[3] >> 14;
-    spans_d_rgba_dy[0] = SIGN(spans_d_rgba_dy[0], 13);
-    spans_d_rgba_dy[1] = SIGN(spans_d_rgba_dy[1], 13);
-    spans_d_rgba_dy[2] = SIGN(spans_d_rgba_dy[2], 13);
-    spans_d_rgba_dy[3] = SIGN(spans_d_rgba_dy[3], 13);
-
-    spans_cd_rgba[0]   = spans_d_rgba[0] >> 14;
-    spans_cd_rgba[1]   = spans_d_rgba[1] >> 14;
-    spans_cd_rgba[2]   = spans_d_rgba[2] >> 14;
-    spans_cd_rgba[3]   = spans_d_rgba[3] >> 14;
-    spans_cd_rgba[0]   = SIGN(spans_cd_rgba[0], 13);
-    spans_cd_rgba[1]   = SIGN(spans_cd_rgba[1], 13);
-    spans_cd_rgba[2]   = SIGN(spans_cd_rgba[2], 13);
-    spans_cd_rgba[3]   = SIGN(spans_cd_rgba[3], 13);
-    spans_cdz          = spans_d_stwz[3] >> 10;
-    spans_cdz          = SIGN(spans_cdz, 22);
-
-    spans_d_stwz_dy[0] = stw_info->d_stwz_dy[0] & ~0x00007FFF;
-    spans_d_stwz_dy[1] = stw_info->d_stwz_dy[1] & ~0x00007FFF;
-    spans_d_stwz_dy[2] = stw_info->d_stwz_dy[2] & ~0x00007FFF;
-    spans_d_stwz_dy[3] = stw_info->d_stwz_dy[3] >> 10;
-    spans_d_stwz_dy[3] = SIGN(spans_d_stwz_dy[3], 22);
+    rdp->spans_d_rgba[0]    = stw_info->d_rgba_dx[0] & ~0x0000001F;
+    rdp->spans_d_rgba[1]    = stw_info->d_rgba_dx[1] & ~0x0000001F;
+    rdp->spans_d_rgba[2]    = stw_info->d_rgba_dx[2] & ~0x0000001F;
+    rdp->spans_d_rgba[3]    = stw_info->d_rgba_dx[3] & ~0x0000001F;
+    rdp->spans_d_stwz[0]    = stw_info->d_stwz_dx[0] & ~0x0000001F;
+    rdp->spans_d_stwz[1]    = stw_info->d_stwz_dx[1] & ~0x0000001F;
+    rdp->spans_d_stwz[2]    = stw_info->d_stwz_dx[2] & ~0x0000001F;
+    rdp->spans_d_stwz[3]    = stw_info->d_stwz_dx[3];
+
+    rdp->spans_d_rgba_dy[0] = stw_info->d_rgba_dy[0] >> 14;
+    rdp->spans_d_rgba_dy[1] = stw_info->d_rgba_dy[1] >> 14;
+    rdp->spans_d_rgba_dy[2] = stw_info->d_rgba_dy[2] >> 14;
+    rdp->spans_d_rgba_dy[3] = stw_info->d_rgba_dy[3] >> 14;
+    rdp->spans_d_rgba_dy[0] = SIGN(rdp->spans_d_rgba_dy[0], 13);
+    rdp->spans_d_rgba_dy[1] = SIGN(rdp->spans_d_rgba_dy[1], 13);
+    rdp->spans_d_rgba_dy[2] = SIGN(rdp->spans_d_rgba_dy[2], 13);
+    rdp->spans_d_rgba_dy[3] = SIGN(rdp->spans_d_rgba_dy[3], 13);
+
+    rdp->spans_cd_rgba[0]   = rdp->spans_d_rgba[0] >> 14;
+    rdp->spans_cd_rgba[1]   = rdp->spans_d_rgba[1] >> 14;
+    rdp->spans_cd_rgba[2]   = rdp->spans_d_rgba[2] >> 14;
+    rdp->spans_cd_rgba[3]   = rdp->spans_d_rgba[3] >> 14;
+    rdp->spans_cd_rgba[0]   = SIGN(rdp->spans_cd_rgba[0], 13);
+    rdp->spans_cd_rgba[1]   = SIGN(rdp->spans_cd_rgba[1], 13);
+    rdp->spans_cd_rgba[2]   = SIGN(rdp->spans_cd_rgba[2], 13);
+    rdp->spans_cd_rgba[3]   = SIGN(rdp->spans_cd_rgba[3], 13);
+    rdp->spans_cdz          = rdp->spans_d_stwz[3] >> 10;
+    rdp->spans_cdz          = SIGN(rdp->spans_cdz, 22);
+
+    rdp->spans_d_stwz_dy[0] = stw_info->d_stwz_dy[0] & ~0x00007FFF;
+    rdp->spans_d_stwz_dy[1] = stw_info->d_stwz_dy[1] & ~0x00007FFF;
+    rdp->spans_d_stwz_dy[2] = stw_info->d_stwz_dy[2] & ~0x00007FFF;
+    rdp->spans_d_stwz_dy[3] = stw_info->d_stwz_dy[3] >> 10;
+    rdp->spans_d_stwz_dy[3] = SIGN(rdp->spans_d_stwz_dy[3], 22);
 
     stw_info->d_stwz_dx_int[3] ^= (stw_info->d_stwz_dx_int[3] < 0) ? ~0 : 0;
     stw_info->d_stwz_dy_int[3] ^= (stw_info->d_stwz_dy_int[3] < 0) ? ~0 : 0;
-    spans_dzpix = normalize_dzpix(stw_info->d_stwz_dx_int[3] + stw_info->d_stwz_dy_int[3]);
+    rdp->spans_dzpix = normalize_dzpix(stw_info->d_stwz_dx_int[3] + stw_info->d_stwz_dy_int[3]);
 
     sign_dxhdy = (DxHDy < 0);
     if (sign_dxhdy ^ flip) /* !do_offset */
@@ -8357,7 +8935,7 @@ no_read_zbuffer_coefficients:
         stw_info->d_stwz_diff[3] -= (stw_info->d_stwz_diff[3] >> 2);
     }
 
-    if (other_modes.cycle_type == CYCLE_TYPE_COPY)
+    if (rdp->other_modes.cycle_type == CYCLE_TYPE_COPY)
     {
         setzero_si128(stw_info->d_rgba_dxh);
         setzero_si128(stw_info->d_stwz_dxh);
@@ -8376,16 +8954,16 @@ no_read_zbuffer_coefficients:
 
     ldflag = (sign_dxhdy ^ flip) ? 0 : 3;
     invaly = 1;
-    yllimit = (yl - __clip.yl < 0) ? yl : __clip.yl; /* clip.yl always &= 0xFFF */
+    yllimit = (yl - rdp->__clip.yl < 0) ? yl : rdp->__clip.yl; /* clip.yl always &= 0xFFF */
 
     ycur = yh & ~3;
     ylfar = yllimit | 3;
     if (yl >> 2 > ylfar >> 2)
         ylfar += 4;
     else if (yllimit >> 2 >= 0 && yllimit >> 2 < 1023)
-        span[(yllimit >> 2) + 1].validline = 0;
+        rdp->span[(yllimit >> 2) + 1].validline = 0;
 
-    yhlimit              = (yh - __clip.yh >= 0) ? yh : __clip.yh; /* clip.yh always &= 0xFFF */
+    yhlimit              = (yh - rdp->__clip.yh >= 0) ? yh : rdp->__clip.yh; /* clip.yh always &= 0xFFF */
 
     stw_info->xlr_inc[0] = (DxMDy >> 2) & ~0x00000001;
     stw_info->xlr_inc[1] = (DxHDy >> 2) & ~0x00000001;
@@ -8401,7 +8979,6 @@ no_read_zbuffer_coefficients:
 
     for (k = ycur; k <= ylfar; k++)
     {
-        static int minmax[2];
         int stickybit;
         int xlrsc[2];
         const int spix = k & 3;
@@ -8421,8 +8998,8 @@ no_read_zbuffer_coefficients:
             j = k >> 2;
             if (spix == 0)
             {
-                minmax[1] = 0x000;
-                minmax[0] = 0xFFF;
+                rdp->minmax[1] = 0x000;
+                rdp->minmax[0] = 0xFFF;
                 allover = allunder = 1;
                 allinval = 1;
             }
@@ -8438,7 +9015,7 @@ no_read_zbuffer_coefficients:
             xlrsc[1] = xlrsc[1] & 0x1FFF;
             curover |= (uint32_t)~(xlrsc[1] - clipxlshift) >> 31;
             xlrsc[1] = curover ? clipxlshift : xlrsc[1];
-            span[j].majorx[spix] = xlrsc[1] & 0x1FFF;
+            rdp->span[j].majorx[spix] = xlrsc[1] & 0x1FFF;
             allover &= curover;
             allunder &= curunder;
 
@@ -8452,14 +9029,14 @@ no_read_zbuffer_coefficients:
             xlrsc[0] &= 0x1FFF;
             curover |= (uint32_t)~(xlrsc[0] - clipxlshift) >> 31;
             xlrsc[0] = curover ? clipxlshift : xlrsc[0];
-            span[j].minorx[spix] = xlrsc[0] & 0x1FFF;
+            rdp->span[j].minorx[spix] = xlrsc[0] & 0x1FFF;
             allover &= curover;
             allunder &= curunder;
 
             curcross = ((stw_info->xlr[1 - flip]&0x0FFFC000 ^ 0x08000000)
                      <  (stw_info->xlr[0 + flip]&0x0FFFC000 ^ 0x08000000));
             invaly |= curcross;
-            span[j].invalyscan[spix] = invaly;
+            rdp->span[j].invalyscan[spix] = invaly;
             allinval &= invaly;
             if (invaly != 0)
                 { /* branch */ }
@@ -8467,10 +9044,10 @@ no_read_zbuffer_coefficients:
             {
                 xlrsc[0] = (xlrsc[0] >> 3) & 0xFFF;
                 xlrsc[1] = (xlrsc[1] >> 3) & 0xFFF;
-                minmax[0]
-                  = (xlrsc[flip - 0] < minmax[0]) ? xlrsc[flip - 0] : minmax[0];
-                minmax[1]
-                  = (xlrsc[1 - flip] > minmax[1]) ? xlrsc[1 - flip] : minmax[1];
+                rdp->minmax[0]
+                  = (xlrsc[flip - 0] < rdp->minmax[0]) ? xlrsc[flip - 0] : rdp->minmax[0];
+                rdp->minmax[1]
+                  = (xlrsc[1 - flip] > rdp->minmax[1]) ? xlrsc[1 - flip] : rdp->minmax[1];
             }
 
             if (spix == ldflag)
@@ -8481,7 +9058,7 @@ no_read_zbuffer_coefficients:
                 __m128i prod_hi, prod_lo;
                 __m128i result;
 
-                span[j].unscrx  =  (stw_info->xlr[1]) >> 16;
+                rdp->span[j].unscrx  =  (stw_info->xlr[1]) >> 16;
                 stw_info->xfrac = (stw_info->xlr[1] >> 8) & 0xFF;
                 xmm_frac        = _mm_set1_epi32(stw_info->xfrac);
 
@@ -8501,7 +9078,7 @@ no_read_zbuffer_coefficients:
                 result = _mm_sub_epi32(result, delta_x_high);
                 result = _mm_srli_epi32(result, 10);
                 result = _mm_slli_epi32(result, 10);
-                _mm_store_si128((__m128i *)span[j].rgba, result);
+                _mm_store_si128((__m128i *)rdp->span[j].rgba, result);
 
                 delta_x_high = _mm_load_si128((__m128i *)stw_info->d_stwz_dxh);
                 prod_lo      = _mm_mul_epu32(delta_x_high, xmm_frac);
@@ -8519,45 +9096,45 @@ no_read_zbuffer_coefficients:
                 result = _mm_sub_epi32(result, delta_x_high);
                 result = _mm_srli_epi32(result, 10);
                 result = _mm_slli_epi32(result, 10);
-                _mm_store_si128((__m128i *)span[j].stwz, result);
+                _mm_store_si128((__m128i *)rdp->span[j].stwz, result);
             }
 #else
             {
-                span[j].unscrx  = (stw_info->xlr[1] >> 16);
+                rdp->span[j].unscrx  = (stw_info->xlr[1] >> 16);
                 stw_info->xfrac = (stw_info->xlr[1] >> 8) & 0xFF;
-                span[j].rgba[0]
+                rdp->span[j].rgba[0]
                   = ((stw_info->rgba[0] & ~0x1FF) + stw_info->d_rgba_diff[0] - stw_info->xfrac * stw_info->d_rgba_dxh[0])
                   & ~0x000003FF;
-                span[j].rgba[1]
+                rdp->span[j].rgba[1]
                   = ((stw_info->rgba[1] & ~0x1FF) + stw_info->d_rgba_diff[1] - stw_info->xfrac * stw_info->d_rgba_dxh[1])
                   & ~0x000003FF;
-                span[j].rgba[2]
+                rdp->span[j].rgba[2]
                   = ((stw_info->rgba[2] & ~0x1FF) + stw_info->d_rgba_diff[2] - stw_info->xfrac * stw_info->d_rgba_dxh[2])
                   & ~0x000003FF;
-                span[j].rgba[3]
+                rdp->span[j].rgba[3]
                   = ((stw_info->rgba[3] & ~0x1FF) + stw_info->d_rgba_diff[3] - stw_info->xfrac * stw_info->d_rgba_dxh[3])
                   & ~0x000003FF;
-                span[j].stwz[0]
+                rdp->span[j].stwz[0]
                   = ((stw_info->stwz[0] & ~0x1FF) + stw_info->d_stwz_diff[0] - stw_info->xfrac * stw_info->d_stwz_dxh[0])
                   & ~0x000003FF;
-                span[j].stwz[1]
+                rdp->span[j].stwz[1]
                   = ((stw_info->stwz[1] & ~0x1FF) + stw_info->d_stwz_diff[1] - stw_info->xfrac * stw_info->d_stwz_dxh[1])
                   & ~0x000003FF;
-                span[j].stwz[2]
+                rdp->span[j].stwz[2]
                   = ((stw_info->stwz[2] & ~0x1FF) + stw_info->d_stwz_diff[2] - stw_info->xfrac * stw_info->d_stwz_dxh[2])
                   & ~0x000003FF;
-                span[j].stwz[3]
+                rdp->span[j].stwz[3]
                   = ((stw_info->stwz[3] & ~0x1FF) + stw_info->d_stwz_diff[3] - stw_info->xfrac * stw_info->d_stwz_dxh[3])
                   & ~0x000003FF;
             }
 #endif
             if (spix == 3)
             {
-                const int invalidline = (sckeepodd ^ j) & scfield
+                const int invalidline = (rdp->sckeepodd ^ j) & rdp->scfield
                                       | (allinval | allover | allunder);
-                span[j].lx = minmax[flip - 0];
-                span[j].rx = minmax[1 - flip];
-                span[j].validline = invalidline ^ 1;
+                rdp->span[j].lx = rdp->minmax[flip - 0];
+                rdp->span[j].rx = rdp->minmax[1 - flip];
+                rdp->span[j].validline = invalidline ^ 1;
             }
         }
         if (spix == 3)
@@ -8575,59 +9152,59 @@ no_read_zbuffer_coefficients:
         stw_info->xlr[0] += stw_info->xlr_inc[0];
         stw_info->xlr[1] += stw_info->xlr_inc[1];
     }
-    render_spans(yhlimit >> 2, yllimit >> 2, tilenum, flip);
+    render_spans(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip);
 }
 
-static void tri_noshade(uint32_t w1, uint32_t w2)
+static void tri_noshade(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_NO, TEXTURE_NO, ZBUFFER_NO, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_NO, TEXTURE_NO, ZBUFFER_NO, &stw_info);
 }
 
-static void tri_noshade_z(uint32_t w1, uint32_t w2)
+static void tri_noshade_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_NO, TEXTURE_NO, ZBUFFER_YES, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_NO, TEXTURE_NO, ZBUFFER_YES, &stw_info);
 }
 
-static void tri_tex(uint32_t w1, uint32_t w2)
+static void tri_tex(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_NO, TEXTURE_YES, ZBUFFER_NO, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_NO, TEXTURE_YES, ZBUFFER_NO, &stw_info);
 }
 
-static void tri_tex_z(uint32_t w1, uint32_t w2)
+static void tri_tex_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_NO, TEXTURE_YES, ZBUFFER_YES, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_NO, TEXTURE_YES, ZBUFFER_YES, &stw_info);
 }
 
-static void tri_shade(uint32_t w1, uint32_t w2)
+static void tri_shade(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_YES, TEXTURE_NO, ZBUFFER_NO, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_YES, TEXTURE_NO, ZBUFFER_NO, &stw_info);
 }
 
-static void tri_shade_z(uint32_t w1, uint32_t w2)
+static void tri_shade_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_YES, TEXTURE_NO, ZBUFFER_YES, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_YES, TEXTURE_NO, ZBUFFER_YES, &stw_info);
 }
 
-static void tri_texshade(uint32_t w1, uint32_t w2)
+static void tri_texshade(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_YES, TEXTURE_YES, ZBUFFER_NO, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_YES, TEXTURE_YES, ZBUFFER_NO, &stw_info);
 }
 
-static void tri_texshade_z(uint32_t w1, uint32_t w2)
+static void tri_texshade_z(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    struct stepwalker_info stw_info;
-   draw_triangle(w1, w2, SHADE_YES, TEXTURE_YES, ZBUFFER_YES, &stw_info);
+   draw_triangle(rdp, w1, w2, SHADE_YES, TEXTURE_YES, ZBUFFER_YES, &stw_info);
 }
 
 
-static NOINLINE void draw_texture_rectangle(
+static NOINLINE void draw_texture_rectangle(struct rdp_state *rdp,
     const int rect_flip, int tilenum,
     int32_t xl, int32_t yl, int32_t xh, int32_t yh,
     int32_t s, int32_t t, int16_t dsdx, int16_t dtdy
@@ -8650,10 +9227,10 @@ static NOINLINE void draw_texture_rectangle(
     int ycur, ylfar;
     int invaly;
     int j, k;
-    const int32_t clipxlshift = __clip.xl << 1;
-    const int32_t clipxhshift = __clip.xh << 1;
+    const int32_t clipxlshift = rdp->__clip.xl << 1;
+    const int32_t clipxhshift = rdp->__clip.xh << 1;
 
-    max_level = 0;
+    rdp->max_level = 0;
     maxxmx = 0;
     minxhx = 0;
 
@@ -8681,37 +9258,37 @@ static NOINLINE void draw_texture_rectangle(
         d_stwz_dy[1] = (int32_t)dtdy << 11;
     }
 
-    setzero_si128(spans_d_rgba);
-    setzero_si128(spans_d_stwz);
-    spans_d_stwz[0] = d_stwz_dx[0] & ~0x0000001F;
-    spans_d_stwz[1] = d_stwz_dx[1] & ~0x0000001F;
+    setzero_si128(rdp->spans_d_rgba);
+    setzero_si128(rdp->spans_d_stwz);
+    rdp->spans_d_stwz[0] = d_stwz_dx[0] & ~0x0000001F;
+    rdp->spans_d_stwz[1] = d_stwz_dx[1] & ~0x0000001F;
 
-    setzero_si128(spans_d_rgba_dy);
-    setzero_si128(spans_cd_rgba);
-    spans_cdz = 0;
+    setzero_si128(rdp->spans_d_rgba_dy);
+    setzero_si128(rdp->spans_cd_rgba);
+    rdp->spans_cdz = 0;
 
-    setzero_si128(spans_d_stwz_dy);
-    spans_d_stwz_dy[0] = d_stwz_dy[0] & ~0x00007FFF;
-    spans_d_stwz_dy[1] = d_stwz_dy[1] & ~0x00007FFF;
-    spans_dzpix = normalize_dzpix(0);
+    setzero_si128(rdp->spans_d_stwz_dy);
+    rdp->spans_d_stwz_dy[0] = d_stwz_dy[0] & ~0x00007FFF;
+    rdp->spans_d_stwz_dy[1] = d_stwz_dy[1] & ~0x00007FFF;
+    rdp->spans_dzpix = normalize_dzpix(0);
 
     setzero_si128(d_stwz_dxh);
-    if (other_modes.cycle_type != CYCLE_TYPE_COPY)
+    if (rdp->other_modes.cycle_type != CYCLE_TYPE_COPY)
     {
         d_stwz_dxh[0] = (d_stwz_dx[0] >> 8) & ~0x00000001;
         d_stwz_dxh[1] = (d_stwz_dx[1] >> 8) & ~0x00000001;
     }
 
     invaly = 1;
-    yllimit = (yl <  __clip.yl) ? yl : __clip.yl;
-    yhlimit = (yh >= __clip.yh) ? yh : __clip.yh;
+    yllimit = (yl <  rdp->__clip.yl) ? yl : rdp->__clip.yl;
+    yhlimit = (yh >= rdp->__clip.yh) ? yh : rdp->__clip.yh;
 
     ycur = yh & ~3;
     ylfar = yllimit | 3;
     if ((yl >> 2) > (ylfar >> 2))
         ylfar += 4;
     else if ((yllimit >> 2) >= 0 && (yllimit >> 2) < 1023)
-        span[(yllimit >> 2) + 1].validline = 0;
+        rdp->span[(yllimit >> 2) + 1].validline = 0;
 
     xleft = xm/* & ~0x00000001 // never needed because xm <<= 14 */;
     xright = xh/* & ~0x00000001 // never needed because xh <<= 14 */;
@@ -8752,7 +9329,7 @@ static NOINLINE void draw_texture_rectangle(
             xrsc = xrsc & 0x1FFF;
             curover |= (uint32_t)~(xrsc - clipxlshift) >> 31;
             xrsc = curover ? clipxlshift : xrsc;
-            span[j].majorx[spix] = xrsc & 0x1FFF;
+            rdp->span[j].majorx[spix] = xrsc & 0x1FFF;
             allover &= curover;
             allunder &= curunder;
 
@@ -8766,14 +9343,14 @@ static NOINLINE void draw_texture_rectangle(
             xlsc &= 0x1FFF;
             curover |= (uint32_t)~(xlsc - clipxlshift) >> 31;
             xlsc = curover ? clipxlshift : xlsc;
-            span[j].minorx[spix] = xlsc & 0x1FFF;
+            rdp->span[j].minorx[spix] = xlsc & 0x1FFF;
             allover &= curover;
             allunder &= curunder;
 
             curcross = ((xleft&0x0FFFC000 ^ 0x08000000)
                      < (xright&0x0FFFC000 ^ 0x08000000));
             invaly |= curcross;
-            span[j].invalyscan[spix] = invaly;
+            rdp->span[j].invalyscan[spix] = invaly;
             allinval &= invaly;
             if (invaly != 0)
                 { /* branch */ }
@@ -8787,21 +9364,21 @@ static NOINLINE void draw_texture_rectangle(
 
             if (spix == 0)
             {
-                span[j].unscrx = xright >> 16;
+                rdp->span[j].unscrx = xright >> 16;
              /* xfrac = (xright >> 8) & 0xFF; // xfrac never changes. */
-                setzero_si128(span[j].rgba);
-                span[j].stwz[0] = (stwz[0] - xfrac*d_stwz_dxh[0]) & ~0x000003FF;
-                span[j].stwz[1] = (stwz[1] - xfrac*d_stwz_dxh[1]) & ~0x000003FF;
-                span[j].stwz[2] = 0 & ~0x000003FF;
-                span[j].stwz[3] = 0 & ~0x000003FF;
+                setzero_si128(rdp->span[j].rgba);
+                rdp->span[j].stwz[0] = (stwz[0] - xfrac*d_stwz_dxh[0]) & ~0x000003FF;
+                rdp->span[j].stwz[1] = (stwz[1] - xfrac*d_stwz_dxh[1]) & ~0x000003FF;
+                rdp->span[j].stwz[2] = 0 & ~0x000003FF;
+                rdp->span[j].stwz[3] = 0 & ~0x000003FF;
             }
             if (spix == 3)
             {
-                const int invalidline = (sckeepodd ^ j) & scfield
+                const int invalidline = (rdp->sckeepodd ^ j) & rdp->scfield
                                       | (allinval | allover | allunder);
-                span[j].lx = maxxmx;
-                span[j].rx = minxhx;
-                span[j].validline = invalidline ^ 1;
+                rdp->span[j].lx = maxxmx;
+                rdp->span[j].rx = minxhx;
+                rdp->span[j].validline = invalidline ^ 1;
             }
         }
         if (spix == 3)
@@ -8811,38 +9388,38 @@ static NOINLINE void draw_texture_rectangle(
         }
     }
 
-    if (other_modes.f.stalederivs)
+    if (rdp->other_modes.f.stalederivs)
     {
-        deduce_derivatives();
-        other_modes.f.stalederivs = 0;
+        deduce_derivatives(rdp);
+        rdp->other_modes.f.stalederivs = 0;
     }
-    render_spans(yhlimit >> 2, yllimit >> 2, tilenum, 1);
+    render_spans(rdp, yhlimit >> 2, yllimit >> 2, tilenum, 1);
 }
 
-static void tex_rect(uint32_t w1, uint32_t w2)
+static void tex_rect(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     int tilenum;
     int16_t dsdx, dtdy;
     int32_t xl, yl, xh, yh;
     int32_t s, t;
 
-    xl      = (cmd_data[cmd_cur + 0].UW32[0] & 0x00FFF000) >> 12;
-    yl      = (cmd_data[cmd_cur + 0].UW32[0] & 0x00000FFF) >>  0;
-    tilenum = (cmd_data[cmd_cur + 0].UW32[1] & 0x07000000) >> 24;
-    xh      = (cmd_data[cmd_cur + 0].UW32[1] & 0x00FFF000) >> 12;
-    yh      = (cmd_data[cmd_cur + 0].UW32[1] & 0x00000FFF) >>  0;
+    xl      = (rdp_fifo[rdp->cmd_cur + 0].UW32[0] & 0x00FFF000) >> 12;
+    yl      = (rdp_fifo[rdp->cmd_cur + 0].UW32[0] & 0x00000FFF) >>  0;
+    tilenum = (rdp_fifo[rdp->cmd_cur + 0].UW32[1] & 0x07000000) >> 24;
+    xh      = (rdp_fifo[rdp->cmd_cur + 0].UW32[1] & 0x00FFF000) >> 12;
+    yh      = (rdp_fifo[rdp->cmd_cur + 0].UW32[1] & 0x00000FFF) >>  0;
 
-    yl |= (other_modes.cycle_type & 2) ? 3 : 0; /* FILL OR COPY */
+    yl |= (rdp->other_modes.cycle_type & 2) ? 3 : 0; /* FILL OR COPY */
 
-    s    = (cmd_data[cmd_cur + 1].UW32[0] & 0xFFFF0000) >> 16;
-    t    = (cmd_data[cmd_cur + 1].UW32[0] & 0x0000FFFF) >>  0;
-    dsdx = (cmd_data[cmd_cur + 1].UW32[1] & 0xFFFF0000) >> 16;
-    dtdy = (cmd_data[cmd_cur + 1].UW32[1] & 0x0000FFFF) >>  0;
+    s    = (rdp_fifo[rdp->cmd_cur + 1].UW32[0] & 0xFFFF0000) >> 16;
+    t    = (rdp_fifo[rdp->cmd_cur + 1].UW32[0] & 0x0000FFFF) >>  0;
+    dsdx = (rdp_fifo[rdp->cmd_cur + 1].UW32[1] & 0xFFFF0000) >> 16;
+    dtdy = (rdp_fifo[rdp->cmd_cur + 1].UW32[1] & 0x0000FFFF) >>  0;
     
     dsdx = SIGN16(dsdx);
     dtdy = SIGN16(dtdy);
 
-    draw_texture_rectangle(
+    draw_texture_rectangle(rdp,
         TEXTURE_FLIP_NO, tilenum,
         xl, yl, xh, yh,
         s, t,
@@ -8850,30 +9427,30 @@ static void tex_rect(uint32_t w1, uint32_t w2)
     );
 }
 
-static void tex_rect_flip(uint32_t w1, uint32_t w2)
+static void tex_rect_flip(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     int tilenum;
     int16_t dsdx, dtdy;
     int32_t xl, yl, xh, yh;
     int32_t s, t;
 
-    xl      = (cmd_data[cmd_cur + 0].UW32[0] & 0x00FFF000) >> 12;
-    yl      = (cmd_data[cmd_cur + 0].UW32[0] & 0x00000FFF) >>  0;
-    tilenum = (cmd_data[cmd_cur + 0].UW32[1] & 0x07000000) >> 24;
-    xh      = (cmd_data[cmd_cur + 0].UW32[1] & 0x00FFF000) >> 12;
-    yh      = (cmd_data[cmd_cur + 0].UW32[1] & 0x00000FFF) >>  0;
+    xl      = (rdp_fifo[rdp->cmd_cur + 0].UW32[0] & 0x00FFF000) >> 12;
+    yl      = (rdp_fifo[rdp->cmd_cur + 0].UW32[0] & 0x00000FFF) >>  0;
+    tilenum = (rdp_fifo[rdp->cmd_cur + 0].UW32[1] & 0x07000000) >> 24;
+    xh      = (rdp_fifo[rdp->cmd_cur + 0].UW32[1] & 0x00FFF000) >> 12;
+    yh      = (rdp_fifo[rdp->cmd_cur + 0].UW32[1] & 0x00000FFF) >>  0;
 
-    yl |= (other_modes.cycle_type & 2) ? 3 : 0; /* FILL OR COPY */
+    yl |= (rdp->other_modes.cycle_type & 2) ? 3 : 0; /* FILL OR COPY */
 
-    s    = (cmd_data[cmd_cur + 1].UW32[0] & 0xFFFF0000) >> 16;
-    t    = (cmd_data[cmd_cur + 1].UW32[0] & 0x0000FFFF) >>  0;
-    dsdx = (cmd_data[cmd_cur + 1].UW32[1] & 0xFFFF0000) >> 16;
-    dtdy = (cmd_data[cmd_cur + 1].UW32[1] & 0x0000FFFF) >>  0;
+    s    = (rdp_fifo[rdp->cmd_cur + 1].UW32[0] & 0xFFFF0000) >> 16;
+    t    = (rdp_fifo[rdp->cmd_cur + 1].UW32[0] & 0x0000FFFF) >>  0;
+    dsdx = (rdp_fifo[rdp->cmd_cur + 1].UW32[1] & 0xFFFF0000) >> 16;
+    dtdy = (rdp_fifo[rdp->cmd_cur + 1].UW32[1] & 0x0000FFFF) >>  0;
     
     dsdx = SIGN16(dsdx);
     dtdy = SIGN16(dtdy);
 
-    draw_texture_rectangle(
+    draw_texture_rectangle(rdp,
         TEXTURE_FLIP_YES, tilenum,
         xl, yl, xh, yh,
         s, t,
@@ -8881,19 +9458,19 @@ static void tex_rect_flip(uint32_t w1, uint32_t w2)
     );
 }
 
-static void sync_load(uint32_t w1, uint32_t w2)
+static void sync_load(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
 }
 
-static void sync_pipe(uint32_t w1, uint32_t w2)
+static void sync_pipe(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
 }
 
-static void sync_tile(uint32_t w1, uint32_t w2)
+static void sync_tile(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
 }
 
-static void sync_full(uint32_t w1, uint32_t w2)
+static void sync_full(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
 #ifdef EXTRALOGGING
    fprintf(stderr, "Sync full\n");
@@ -8901,124 +9478,118 @@ static void sync_full(uint32_t w1, uint32_t w2)
 #endif
     *gfx_info.MI_INTR_REG |= DP_INTERRUPT;
     gfx_info.CheckInterrupts();
-
-#ifdef HAVE_RDP_DUMP
-    if (rdp_dump_active)
-       rdp_dump_end_command_list();
-    rdp_dump_active = 0;
-#endif
 }
 
-static void set_key_gb(uint32_t w1, uint32_t w2)
+static void set_key_gb(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    COLOR_GREEN(key_width)  = (w1 & 0x00FFF000) >> 12;
-    COLOR_BLUE(key_width)   = (w1 & 0x00000FFF) >>  0;
-    COLOR_GREEN(key_center) = (w2 & 0xFF000000) >> 24;
-    COLOR_GREEN(key_scale)  = (w2 & 0x00FF0000) >> 16;
-    COLOR_BLUE(key_center)  = (w2 & 0x0000FF00) >>  8;
-    COLOR_BLUE(key_scale)   = (w2 & 0x000000FF) >>  0;
+    COLOR_GREEN(rdp->key_width)  = (w1 & 0x00FFF000) >> 12;
+    COLOR_BLUE(rdp->key_width)   = (w1 & 0x00000FFF) >>  0;
+    COLOR_GREEN(rdp->key_center) = (w2 & 0xFF000000) >> 24;
+    COLOR_GREEN(rdp->key_scale)  = (w2 & 0x00FF0000) >> 16;
+    COLOR_BLUE(rdp->key_center)  = (w2 & 0x0000FF00) >>  8;
+    COLOR_BLUE(rdp->key_scale)   = (w2 & 0x000000FF) >>  0;
 }
 
-static void set_key_r(uint32_t w1, uint32_t w2)
+static void set_key_r(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    COLOR_RED(key_width)  = (w2 & 0x0FFF0000) >> 16;
-    COLOR_RED(key_center) = (w2 & 0x0000FF00) >>  8;
-    COLOR_RED(key_scale)  = (w2 & 0x000000FF) >>  0;
+    COLOR_RED(rdp->key_width)  = (w2 & 0x0FFF0000) >> 16;
+    COLOR_RED(rdp->key_center) = (w2 & 0x0000FF00) >>  8;
+    COLOR_RED(rdp->key_scale)  = (w2 & 0x000000FF) >>  0;
 }
 
-static void set_convert(uint32_t w1, uint32_t w2)
+static void set_convert(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
    int32_t k0 = (w1 >> 13) & 0x1ff;
    int32_t k1 = (w1 >> 4) & 0x1ff;
    int32_t k2 = ((w1 & 0xf) << 5) | ((w2 >> 27) & 0x1f);
    int32_t k3 = (w2 >> 18) & 0x1ff;
-   k0_tf = (SIGN(k0, 9) << 1) + 1;
-   k1_tf = (SIGN(k1, 9) << 1) + 1;
-   k2_tf = (SIGN(k2, 9) << 1) + 1;
-   k3_tf = (SIGN(k3, 9) << 1) + 1;
-   k4 = (w2 >> 9) & 0x1ff;
- 	k5 = w2 & 0x1ff;
+   rdp->k0_tf = (SIGN(k0, 9) << 1) + 1;
+   rdp->k1_tf = (SIGN(k1, 9) << 1) + 1;
+   rdp->k2_tf = (SIGN(k2, 9) << 1) + 1;
+   rdp->k3_tf = (SIGN(k3, 9) << 1) + 1;
+   rdp->k4 = (w2 >> 9) & 0x1ff;
+ 	rdp->k5 = w2 & 0x1ff;
 }
 
-static void set_scissor(uint32_t w1, uint32_t w2)
+static void set_scissor(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    __clip.xh   = (w1 & 0x00FFF000) >> (44 - 32);
-    __clip.yh   = (w1 & 0x00000FFF) >> (32 - 32);
-    scfield     = (w2 & 0x02000000) >> (25 -  0);
-    sckeepodd   = (w2 & 0x01000000) >> (24 -  0);
-    __clip.xl   = (w2 & 0x00FFF000) >> (12 -  0);
-    __clip.yl   = (w2 & 0x00000FFF) >> ( 0 -  0);
+    rdp->__clip.xh   = (w1 & 0x00FFF000) >> (44 - 32);
+    rdp->__clip.yh   = (w1 & 0x00000FFF) >> (32 - 32);
+    rdp->scfield     = (w2 & 0x02000000) >> (25 -  0);
+    rdp->sckeepodd   = (w2 & 0x01000000) >> (24 -  0);
+    rdp->__clip.xl   = (w2 & 0x00FFF000) >> (12 -  0);
+    rdp->__clip.yl   = (w2 & 0x00000FFF) >> ( 0 -  0);
 }
 
-static void set_prim_depth(uint32_t w1, uint32_t w2)
+static void set_prim_depth(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    primitive_z       = (w2 & 0xFFFF0000) >> 16;
-    primitive_delta_z = (w2 & 0x0000FFFF) >>  0;
-    primitive_z = (primitive_z & 0x7FFF) << 16; /* angrylion does this why? */
+    rdp->primitive_z       = (w2 & 0xFFFF0000) >> 16;
+    rdp->primitive_delta_z = (w2 & 0x0000FFFF) >>  0;
+    rdp->primitive_z = (rdp->primitive_z & 0x7FFF) << 16; /* angrylion does this why? */
 }
 
-static void set_other_modes(uint32_t w1, uint32_t w2)
+static void set_other_modes(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    const DP_FIFO cmd_fifo = cmd_data[cmd_cur + 0];
+    const DP_FIFO cmd_fifo = rdp_fifo[rdp->cmd_cur + 0];
 
  /* K:  atomic_prim              = (cmd_fifo.UW & 0x0080000000000000) >> 55; */
  /* j:  reserved for future use -- (cmd_fifo.UW & 0x0040000000000000) >> 54 */
-    other_modes.cycle_type       = (cmd_fifo.UW32[0] & 0x00300000) >> (52 - 32);
-    other_modes.persp_tex_en     = !!(cmd_fifo.UW32[0] & 0x00080000); /* 51 */
-    other_modes.detail_tex_en    = !!(cmd_fifo.UW32[0] & 0x00040000); /* 50 */
-    other_modes.sharpen_tex_en   = !!(cmd_fifo.UW32[0] & 0x00020000); /* 49 */
-    other_modes.tex_lod_en       = !!(cmd_fifo.UW32[0] & 0x00010000); /* 48 */
-    other_modes.en_tlut          = !!(cmd_fifo.UW32[0] & 0x00008000); /* 47 */
-    other_modes.tlut_type        = !!(cmd_fifo.UW32[0] & 0x00004000); /* 46 */
-    other_modes.sample_type      = !!(cmd_fifo.UW32[0] & 0x00002000); /* 45 */
-    other_modes.mid_texel        = !!(cmd_fifo.UW32[0] & 0x00001000); /* 44 */
-    other_modes.bi_lerp0         = !!(cmd_fifo.UW32[0] & 0x00000800); /* 43 */
-    other_modes.bi_lerp1         = !!(cmd_fifo.UW32[0] & 0x00000400); /* 42 */
-    other_modes.convert_one      = !!(cmd_fifo.UW32[0] & 0x00000200); /* 41 */
-    other_modes.key_en           = !!(cmd_fifo.UW32[0] & 0x00000100); /* 40 */
-    other_modes.rgb_dither_sel   = (cmd_fifo.UW32[0] & 0x000000C0) >> (38 - 32);
-    other_modes.alpha_dither_sel = (cmd_fifo.UW32[0] & 0x00000030) >> (36 - 32);
+    rdp->other_modes.cycle_type       = (cmd_fifo.UW32[0] & 0x00300000) >> (52 - 32);
+    rdp->other_modes.persp_tex_en     = !!(cmd_fifo.UW32[0] & 0x00080000); /* 51 */
+    rdp->other_modes.detail_tex_en    = !!(cmd_fifo.UW32[0] & 0x00040000); /* 50 */
+    rdp->other_modes.sharpen_tex_en   = !!(cmd_fifo.UW32[0] & 0x00020000); /* 49 */
+    rdp->other_modes.tex_lod_en       = !!(cmd_fifo.UW32[0] & 0x00010000); /* 48 */
+    rdp->other_modes.en_tlut          = !!(cmd_fifo.UW32[0] & 0x00008000); /* 47 */
+    rdp->other_modes.tlut_type        = !!(cmd_fifo.UW32[0] & 0x00004000); /* 46 */
+    rdp->other_modes.sample_type      = !!(cmd_fifo.UW32[0] & 0x00002000); /* 45 */
+    rdp->other_modes.mid_texel        = !!(cmd_fifo.UW32[0] & 0x00001000); /* 44 */
+    rdp->other_modes.bi_lerp0         = !!(cmd_fifo.UW32[0] & 0x00000800); /* 43 */
+    rdp->other_modes.bi_lerp1         = !!(cmd_fifo.UW32[0] & 0x00000400); /* 42 */
+    rdp->other_modes.convert_one      = !!(cmd_fifo.UW32[0] & 0x00000200); /* 41 */
+    rdp->other_modes.key_en           = !!(cmd_fifo.UW32[0] & 0x00000100); /* 40 */
+    rdp->other_modes.rgb_dither_sel   = (cmd_fifo.UW32[0] & 0x000000C0) >> (38 - 32);
+    rdp->other_modes.alpha_dither_sel = (cmd_fifo.UW32[0] & 0x00000030) >> (36 - 32);
  /* reserved for future, def:15 -- (cmd_fifo.UW & 0x0000000F00000000) >> 32 */
-    other_modes.blend_m1a_0      = (cmd_fifo.UW32[1] & 0xC0000000) >> (30 -  0);
-    other_modes.blend_m1a_1      = (cmd_fifo.UW32[1] & 0x30000000) >> (28 -  0);
-    other_modes.blend_m1b_0      = (cmd_fifo.UW32[1] & 0x0C000000) >> (26 -  0);
-    other_modes.blend_m1b_1      = (cmd_fifo.UW32[1] & 0x03000000) >> (24 -  0);
-    other_modes.blend_m2a_0      = (cmd_fifo.UW32[1] & 0x00C00000) >> (22 -  0);
-    other_modes.blend_m2a_1      = (cmd_fifo.UW32[1] & 0x00300000) >> (20 -  0);
-    other_modes.blend_m2b_0      = (cmd_fifo.UW32[1] & 0x000C0000) >> (18 -  0);
-    other_modes.blend_m2b_1      = (cmd_fifo.UW32[1] & 0x00030000) >> (16 -  0);
+    rdp->other_modes.blend_m1a_0      = (cmd_fifo.UW32[1] & 0xC0000000) >> (30 -  0);
+    rdp->other_modes.blend_m1a_1      = (cmd_fifo.UW32[1] & 0x30000000) >> (28 -  0);
+    rdp->other_modes.blend_m1b_0      = (cmd_fifo.UW32[1] & 0x0C000000) >> (26 -  0);
+    rdp->other_modes.blend_m1b_1      = (cmd_fifo.UW32[1] & 0x03000000) >> (24 -  0);
+    rdp->other_modes.blend_m2a_0      = (cmd_fifo.UW32[1] & 0x00C00000) >> (22 -  0);
+    rdp->other_modes.blend_m2a_1      = (cmd_fifo.UW32[1] & 0x00300000) >> (20 -  0);
+    rdp->other_modes.blend_m2b_0      = (cmd_fifo.UW32[1] & 0x000C0000) >> (18 -  0);
+    rdp->other_modes.blend_m2b_1      = (cmd_fifo.UW32[1] & 0x00030000) >> (16 -  0);
  /* N:  reserved for future use -- (cmd_fifo.UW & 0x0000000000008000) >> 15 */
-    other_modes.force_blend      = !!(cmd_fifo.UW32[1] & 0x00004000); /* 14 */
-    other_modes.alpha_cvg_select = !!(cmd_fifo.UW32[1] & 0x00002000); /* 13 */
-    other_modes.cvg_times_alpha  = !!(cmd_fifo.UW32[1] & 0x00001000); /* 12 */
-    other_modes.z_mode           = (cmd_fifo.UW32[1] & 0x00000C00) >> (10 -  0);
-    other_modes.cvg_dest         = (cmd_fifo.UW32[1] & 0x00000300) >> ( 8 -  0);
-    other_modes.color_on_cvg     = !!(cmd_fifo.UW32[1] & 0x00000080); /*  7 */
-    other_modes.image_read_en    = !!(cmd_fifo.UW32[1] & 0x00000040); /*  6 */
-    other_modes.z_update_en      = !!(cmd_fifo.UW32[1] & 0x00000020); /*  5 */
-    other_modes.z_compare_en     = !!(cmd_fifo.UW32[1] & 0x00000010); /*  4 */
-    other_modes.antialias_en     = !!(cmd_fifo.UW32[1] & 0x00000008); /*  3 */
-    other_modes.z_source_sel     = !!(cmd_fifo.UW32[1] & 0x00000004); /*  2 */
-    other_modes.dither_alpha_en  = !!(cmd_fifo.UW32[1] & 0x00000002); /*  1 */
-    other_modes.alpha_compare_en = !!(cmd_fifo.UW32[1] & 0x00000001); /*  0 */
-
-    SET_BLENDER_INPUT(
-        0, 0, &blender1a_r[0], &blender1a_g[0], &blender1a_b[0],
-        &blender1b_a[0], other_modes.blend_m1a_0, other_modes.blend_m1b_0);
-    SET_BLENDER_INPUT(
-        0, 1, &blender2a_r[0], &blender2a_g[0], &blender2a_b[0],
-        &blender2b_a[0], other_modes.blend_m2a_0, other_modes.blend_m2b_0);
-    SET_BLENDER_INPUT(
-        1, 0, &blender1a_r[1], &blender1a_g[1], &blender1a_b[1],
-        &blender1b_a[1], other_modes.blend_m1a_1, other_modes.blend_m1b_1);
-    SET_BLENDER_INPUT(
-        1, 1, &blender2a_r[1], &blender2a_g[1], &blender2a_b[1],
-        &blender2b_a[1], other_modes.blend_m2a_1, other_modes.blend_m2b_1);
-
-    other_modes.f.stalederivs = 1;
-}
-
-static void set_tile_size(uint32_t w1, uint32_t w2)
+    rdp->other_modes.force_blend      = !!(cmd_fifo.UW32[1] & 0x00004000); /* 14 */
+    rdp->other_modes.alpha_cvg_select = !!(cmd_fifo.UW32[1] & 0x00002000); /* 13 */
+    rdp->other_modes.cvg_times_alpha  = !!(cmd_fifo.UW32[1] & 0x00001000); /* 12 */
+    rdp->other_modes.z_mode           = (cmd_fifo.UW32[1] & 0x00000C00) >> (10 -  0);
+    rdp->other_modes.cvg_dest         = (cmd_fifo.UW32[1] & 0x00000300) >> ( 8 -  0);
+    rdp->other_modes.color_on_cvg     = !!(cmd_fifo.UW32[1] & 0x00000080); /*  7 */
+    rdp->other_modes.image_read_en    = !!(cmd_fifo.UW32[1] & 0x00000040); /*  6 */
+    rdp->other_modes.z_update_en      = !!(cmd_fifo.UW32[1] & 0x00000020); /*  5 */
+    rdp->other_modes.z_compare_en     = !!(cmd_fifo.UW32[1] & 0x00000010); /*  4 */
+    rdp->other_modes.antialias_en     = !!(cmd_fifo.UW32[1] & 0x00000008); /*  3 */
+    rdp->other_modes.z_source_sel     = !!(cmd_fifo.UW32[1] & 0x00000004); /*  2 */
+    rdp->other_modes.dither_alpha_en  = !!(cmd_fifo.UW32[1] & 0x00000002); /*  1 */
+    rdp->other_modes.alpha_compare_en = !!(cmd_fifo.UW32[1] & 0x00000001); /*  0 */
+
+    SET_BLENDER_INPUT(rdp,
+        0, 0, &rdp->blender1a_r[0], &rdp->blender1a_g[0], &rdp->blender1a_b[0],
+        &rdp->blender1b_a[0], rdp->other_modes.blend_m1a_0, rdp->other_modes.blend_m1b_0);
+    SET_BLENDER_INPUT(rdp,
+        0, 1, &rdp->blender2a_r[0], &rdp->blender2a_g[0], &rdp->blender2a_b[0],
+        &rdp->blender2b_a[0], rdp->other_modes.blend_m2a_0, rdp->other_modes.blend_m2b_0);
+    SET_BLENDER_INPUT(rdp,
+        1, 0, &rdp->blender1a_r[1], &rdp->blender1a_g[1], &rdp->blender1a_b[1],
+        &rdp->blender1b_a[1], rdp->other_modes.blend_m1a_1, rdp->other_modes.blend_m1b_1);
+    SET_BLENDER_INPUT(rdp,
+        1, 1, &rdp->blender2a_r[1], &rdp->blender2a_g[1], &rdp->blender2a_b[1],
+        &rdp->blender2b_a[1], rdp->other_modes.blend_m2a_1, rdp->other_modes.blend_m2b_1);
+
+    rdp->other_modes.f.stalederivs = 1;
+}
+
+static void set_tile_size(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     int sl      = (w1 & 0x00FFF000) >> (44 - 32);
     int tl      = (w1 & 0x00000FFF) >> (32 - 32);
@@ -9026,14 +9597,14 @@ static void set_tile_size(uint32_t w1, uint32_t w2)
     int sh      = (w2 & 0x00FFF000) >> (12 -  0);
     int th      = (w2 & 0x00000FFF) >> ( 0 -  0);
 
-    tile[tilenum].sl = sl;
-    tile[tilenum].tl = tl;
-    tile[tilenum].sh = sh;
-    tile[tilenum].th = th;
-    calculate_clamp_diffs(tilenum);
+    rdp->tile[tilenum].sl = sl;
+    rdp->tile[tilenum].tl = tl;
+    rdp->tile[tilenum].sh = sh;
+    rdp->tile[tilenum].th = th;
+    calculate_clamp_diffs(rdp, tilenum);
 }
 
-static void load_block(uint32_t w1, uint32_t w2)
+static void load_block(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     int32_t lewdata[10];
     const int command = (w1 & 0xFF000000) >> (56-32);
@@ -9044,12 +9615,12 @@ static void load_block(uint32_t w1, uint32_t w2)
     const int dxt     = (w2 & 0x00000FFF) >> ( 0- 0);
     const int tlclamped = tl & 0x3FF;
 
-    tile[tilenum].sl = sl;
-    tile[tilenum].tl = tl;
-    tile[tilenum].sh = sh;
-    tile[tilenum].th = dxt;
+    rdp->tile[tilenum].sl = sl;
+    rdp->tile[tilenum].tl = tl;
+    rdp->tile[tilenum].sh = sh;
+    rdp->tile[tilenum].th = dxt;
 
-    calculate_clamp_diffs(tilenum);
+    calculate_clamp_diffs(rdp, tilenum);
 
     lewdata[0] =
         (command << 24)
@@ -9062,58 +9633,58 @@ static void load_block(uint32_t w1, uint32_t w2)
     lewdata[4] = sh << 16;
     lewdata[5] = ((sl << 3) << 16) | (tl << 3);
     lewdata[6] = (dxt & 0xff) << 8;
-    lewdata[7] = ((0x80 >> ti_size) << 16) | (dxt >> 8);
+    lewdata[7] = ((0x80 >> rdp->ti_size) << 16) | (dxt >> 8);
     lewdata[8] = 0x20;
     lewdata[9] = 0x20;
 
-    edgewalker_for_loads(lewdata);
+    edgewalker_for_loads(rdp, lewdata);
 }
 
-static void load_tlut(uint32_t w1, uint32_t w2)
+static void load_tlut(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    tile_tlut_common_cs_decoder(w1, w2);
+    tile_tlut_common_cs_decoder(rdp, w1, w2);
 }
 
-static void load_tile(uint32_t w1, uint32_t w2)
+static void load_tile(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    tile_tlut_common_cs_decoder(w1, w2);
+    tile_tlut_common_cs_decoder(rdp, w1, w2);
 }
 
-static void set_tile(uint32_t w1, uint32_t w2)
+static void set_tile(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     const int tilenum     = (w2 & 0x07000000) >> 24;
     
-    tile[tilenum].format  = (w1 & 0x00E00000) >> (53 - 32);
-    tile[tilenum].size    = (w1 & 0x00180000) >> (51 - 32);
-    tile[tilenum].line    = (w1 & 0x0003FE00) >> (41 - 32);
-    tile[tilenum].tmem    = (w1 & 0x000001FF) >> (32 - 32);
+    rdp->tile[tilenum].format  = (w1 & 0x00E00000) >> (53 - 32);
+    rdp->tile[tilenum].size    = (w1 & 0x00180000) >> (51 - 32);
+    rdp->tile[tilenum].line    = (w1 & 0x0003FE00) >> (41 - 32);
+    rdp->tile[tilenum].tmem    = (w1 & 0x000001FF) >> (32 - 32);
  /* tilenum               = (cmd_fifo.UW & 0x0000000007000000) >> 24; */
-    tile[tilenum].palette = (w2 & 0x00F00000) >> (20 -  0);
+    rdp->tile[tilenum].palette = (w2 & 0x00F00000) >> (20 -  0);
 #ifdef EXTRALOGGING
-    if (tile[tilenum].palette)
-       fprintf(stderr, "Tile %d: Palette: %u\n", tilenum, tile[tilenum].palette);
+    if (rdp->tile[tilenum].palette)
+       fprintf(stderr, "Tile %d: Palette: %u\n", tilenum, rdp->tile[tilenum].palette);
 #endif
-    tile[tilenum].ct      = (w2 & 0x00080000) >> (19 -  0);
-    tile[tilenum].mt      = (w2 & 0x00040000) >> (18 -  0);
-    tile[tilenum].mask_t  = (w2 & 0x0003C000) >> (14 -  0);
-    tile[tilenum].shift_t = (w2 & 0x00003C00) >> (10 -  0);
-    tile[tilenum].cs      = (w2 & 0x00000200) >> ( 9 -  0);
-    tile[tilenum].ms      = (w2 & 0x00000100) >> ( 8 -  0);
-    tile[tilenum].mask_s  = (w2 & 0x000000F0) >> ( 4 -  0);
-    tile[tilenum].shift_s = (w2 & 0x0000000F) >> ( 0 -  0);
-
-    tile[tilenum].mask_s_maskbits = tile[tilenum].mask_s != 0
-       ? ((uint16_t)(0xffff) >> (16 - tile[tilenum].mask_s)) & 0x3ff
+    rdp->tile[tilenum].ct      = (w2 & 0x00080000) >> (19 -  0);
+    rdp->tile[tilenum].mt      = (w2 & 0x00040000) >> (18 -  0);
+    rdp->tile[tilenum].mask_t  = (w2 & 0x0003C000) >> (14 -  0);
+    rdp->tile[tilenum].shift_t = (w2 & 0x00003C00) >> (10 -  0);
+    rdp->tile[tilenum].cs      = (w2 & 0x00000200) >> ( 9 -  0);
+    rdp->tile[tilenum].ms      = (w2 & 0x00000100) >> ( 8 -  0);
+    rdp->tile[tilenum].mask_s  = (w2 & 0x000000F0) >> ( 4 -  0);
+    rdp->tile[tilenum].shift_s = (w2 & 0x0000000F) >> ( 0 -  0);
+
+    rdp->tile[tilenum].mask_s_maskbits = rdp->tile[tilenum].mask_s != 0
+       ? ((uint16_t)(0xffff) >> (16 - rdp->tile[tilenum].mask_s)) & 0x3ff
        : 0x3ff;
 
-    tile[tilenum].mask_t_maskbits = tile[tilenum].mask_t != 0
-       ? ((uint16_t)(0xffff) >> (16 - tile[tilenum].mask_t)) & 0x3ff
+    rdp->tile[tilenum].mask_t_maskbits = rdp->tile[tilenum].mask_t != 0
+       ? ((uint16_t)(0xffff) >> (16 - rdp->tile[tilenum].mask_t)) & 0x3ff
        : 0x3ff;
 
-    calculate_tile_derivs(tilenum);
+    calculate_tile_derivs(rdp, tilenum);
 }
 
-static void fill_rect(uint32_t w1, uint32_t w2)
+static void fill_rect(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
     int xlint, xhint;
 
@@ -9124,46 +9695,46 @@ static void fill_rect(uint32_t w1, uint32_t w2)
     int allover, allunder, curover, curunder;
     int allinval;
     int j, k;
-    const int32_t clipxlshift = __clip.xl << 1;
-    const int32_t clipxhshift = __clip.xh << 1;
+    const int32_t clipxlshift = rdp->__clip.xl << 1;
+    const int32_t clipxhshift = rdp->__clip.xh << 1;
 
     int xl = (w1 & 0x00FFF000) >> (44 - 32); /* Load XL Integer Portion */
     int yl = (w1 & 0x00000FFF) >> (32 - 32); /* Load YL Integer Portion */
     int xh = (w2 & 0x00FFF000) >> (12 -  0); /* Load XH Integer Portion */
     int yh = (w2 & 0x00000FFF) >> ( 0 -  0); /* Load YH Integer Portion */
 
-    yl |= (other_modes.cycle_type & 2) ? 3 : 0; /* FILL or COPY */
+    yl |= (rdp->other_modes.cycle_type & 2) ? 3 : 0; /* FILL or COPY */
 
     xlint = (unsigned)(xl) >> 2;
     xhint = (unsigned)(xh) >> 2;
 
-    max_level = 0;
+    rdp->max_level = 0;
     xl = (xlint << 16) | (xl & 3)<<14;
     xl = SIGN(xl, 30);
     xh = (xhint << 16) | (xh & 3)<<14;
     xh = SIGN(xh, 30);
 
-    setzero_si128(spans_d_rgba);
-    setzero_si128(spans_d_stwz);
+    setzero_si128(rdp->spans_d_rgba);
+    setzero_si128(rdp->spans_d_stwz);
 
-    setzero_si128(spans_d_rgba_dy);
-    setzero_si128(spans_d_stwz_dy);
+    setzero_si128(rdp->spans_d_rgba_dy);
+    setzero_si128(rdp->spans_d_stwz_dy);
 
-    setzero_si128(spans_cd_rgba);
-    spans_cdz = 0;
+    setzero_si128(rdp->spans_cd_rgba);
+    rdp->spans_cdz = 0;
 
-    spans_dzpix = normalize_dzpix(0);
+    rdp->spans_dzpix = normalize_dzpix(0);
 
     invaly = 1;
-    yllimit = (yl < __clip.yl) ? yl : __clip.yl;
+    yllimit = (yl < rdp->__clip.yl) ? yl : rdp->__clip.yl;
 
     ycur = yh & ~3;
     ylfar = yllimit | 3;
     if (yl >> 2 > ylfar >> 2)
         ylfar += 4;
     else if (yllimit >> 2 >= 0 && yllimit>>2 < 1023)
-        span[(yllimit >> 2) + 1].validline = 0;
-    yhlimit = (yh >= __clip.yh) ? yh : __clip.yh;
+        rdp->span[(yllimit >> 2) + 1].validline = 0;
+    yhlimit = (yh >= rdp->__clip.yh) ? yh : rdp->__clip.yh;
 
     allover = 1;
     allunder = 1;
@@ -9172,7 +9743,6 @@ static void fill_rect(uint32_t w1, uint32_t w2)
     allinval = 1;
     for (k = ycur; k <= ylfar; k++)
     {
-        static int maxxmx, minxhx;
         int xrsc, xlsc, stickybit;
         const int32_t xleft = xl & ~0x00000001, xright = xh & ~0x00000001;
         const int yhclose = yhlimit & ~3;
@@ -9184,8 +9754,8 @@ static void fill_rect(uint32_t w1, uint32_t w2)
         j = k >> 2;
         if (spix == 0)
         {
-            maxxmx = 0x000;
-            minxhx = 0xFFF;
+            rdp->maxxmx = 0x000;
+            rdp->minxhx = 0xFFF;
             allover = allunder = 1;
             allinval = 1;
         }
@@ -9200,7 +9770,7 @@ static void fill_rect(uint32_t w1, uint32_t w2)
         xrsc = xrsc & 0x1FFF;
         curover |= (uint32_t)~(xrsc - clipxlshift) >> 31;
         xrsc = curover ? clipxlshift : xrsc;
-        span[j].majorx[spix] = xrsc & 0x1FFF;
+        rdp->span[j].majorx[spix] = xrsc & 0x1FFF;
         allover &= curover;
         allunder &= curunder;
 
@@ -9214,14 +9784,14 @@ static void fill_rect(uint32_t w1, uint32_t w2)
         xlsc &= 0x1FFF;
         curover |= (uint32_t)~(xlsc - clipxlshift) >> 31;
         xlsc = curover ? clipxlshift : xlsc;
-        span[j].minorx[spix] = xlsc & 0x1FFF;
+        rdp->span[j].minorx[spix] = xlsc & 0x1FFF;
         allover &= curover;
         allunder &= curunder;
 
         curcross = ((xleft&0x0FFFC000 ^ 0x08000000)
                  < (xright&0x0FFFC000 ^ 0x08000000));
         invaly |= curcross;
-        span[j].invalyscan[spix] = invaly;
+        rdp->span[j].invalyscan[spix] = invaly;
         allinval &= invaly;
         if (invaly != 0)
             { /* branch */ }
@@ -9229,146 +9799,146 @@ static void fill_rect(uint32_t w1, uint32_t w2)
         {
             xlsc = (xlsc >> 3) & 0xFFF;
             xrsc = (xrsc >> 3) & 0xFFF;
-            maxxmx = (xlsc > maxxmx) ? xlsc : maxxmx;
-            minxhx = (xrsc < minxhx) ? xrsc : minxhx;
+            rdp->maxxmx = (xlsc > rdp->maxxmx) ? xlsc : rdp->maxxmx;
+            rdp->minxhx = (xrsc < rdp->minxhx) ? xrsc : rdp->minxhx;
         }
 
         if (spix == 0)
         {
-            span[j].unscrx = xright >> 16;
-            setzero_si128(span[j].rgba);
-            setzero_si128(span[j].stwz);
+            rdp->span[j].unscrx = xright >> 16;
+            setzero_si128(rdp->span[j].rgba);
+            setzero_si128(rdp->span[j].stwz);
         }
         else if (spix == 3)
         {
-            const int invalidline = (sckeepodd ^ j) & scfield
+            const int invalidline = (rdp->sckeepodd ^ j) & rdp->scfield
                                   | (allinval | allover | allunder);
-            span[j].lx = maxxmx;
-            span[j].rx = minxhx;
-            span[j].validline = invalidline ^ 1;
-        }
+            rdp->span[j].lx = rdp->maxxmx;
+            rdp->span[j].rx = rdp->minxhx;
+            rdp->span[j].validline = invalidline ^ 1;
+        }
     }
-    render_spans(yhlimit >> 2, yllimit >> 2, 0, 1);
-}
-
-static void set_fill_color(uint32_t w1, uint32_t w2)
-{
-    fill_color = w2;
-}
-
-static void set_fog_color(uint32_t w1, uint32_t w2)
-{
-    COLOR_RED(fog_color)   = (w2 & 0xFF000000) >> 24;
-    COLOR_GREEN(fog_color) = (w2 & 0x00FF0000) >> 16;
-    COLOR_BLUE(fog_color)  = (w2 & 0x0000FF00) >>  8;
-    COLOR_ALPHA(fog_color) = (w2 & 0x000000FF) >>  0;
-}
-
-static void set_blend_color(uint32_t w1, uint32_t w2)
-{
-    COLOR_RED(blend_color)   = (w2 & 0xFF000000) >> 24;
-    COLOR_GREEN(blend_color) = (w2 & 0x00FF0000) >> 16;
-    COLOR_BLUE(blend_color)  = (w2 & 0x0000FF00) >>  8;
-    COLOR_ALPHA(blend_color) = (w2 & 0x000000FF) >>  0;
-}
-
-static void set_prim_color(uint32_t w1, uint32_t w2)
-{
-    min_level               = (w1 & 0x00001F00) >>(40-32);
-    primitive_lod_frac      = (w1 & 0x000000FF) >>(32-32);
-    COLOR_RED(prim_color)   = (w2 & 0xFF000000) >> 24;
-    COLOR_GREEN(prim_color) = (w2 & 0x00FF0000) >> 16;
-    COLOR_BLUE(prim_color)  = (w2 & 0x0000FF00) >>  8;
-    COLOR_ALPHA(prim_color) = (w2 & 0x000000FF) >>  0;
-}
-
-static void set_env_color(uint32_t w1, uint32_t w2)
-{
-    COLOR_RED(env_color)   = (w2 & 0xFF000000) >> 24;
-    COLOR_GREEN(env_color) = (w2 & 0x00FF0000) >> 16;
-    COLOR_BLUE(env_color)  = (w2 & 0x0000FF00) >>  8;
-    COLOR_ALPHA(env_color) = (w2 & 0x000000FF) >>  0;
-}
-
-static void set_combine(uint32_t w1, uint32_t w2)
-{
-    combine.sub_a_rgb0 = (w1 & 0x00F00000) >>(52-32);
-    combine.mul_rgb0   = (w1 & 0x000F8000) >>(47-32);
-    combine.sub_a_a0   = (w1 & 0x00007000) >>(44-32);
-    combine.mul_a0     = (w1 & 0x00000E00) >>(41-32);
-    combine.sub_a_rgb1 = (w1 & 0x000001E0) >>(37-32);
-    combine.mul_rgb1   = (w1 & 0x0000001F) >>(32-32);
-    combine.sub_b_rgb0 = (w2 & 0xF0000000) >> 28;
-    combine.sub_b_rgb1 = (w2 & 0x0F000000) >> 24;
-    combine.sub_a_a1   = (w2 & 0x00E00000) >> 21;
-    combine.mul_a1     = (w2 & 0x001C0000) >> 18;
-    combine.add_rgb0   = (w2 & 0x00038000) >> 15;
-    combine.sub_b_a0   = (w2 & 0x00007000) >> 12;
-    combine.add_a0     = (w2 & 0x00000E00) >>  9;
-    combine.add_rgb1   = (w2 & 0x000001C0) >>  6;
-    combine.sub_b_a1   = (w2 & 0x00000038) >>  3;
-    combine.add_a1     = (w2 & 0x00000007) >>  0;
-
-    SET_SUBA_RGB_INPUT(
-        &combiner_rgbsub_a_r[0], &combiner_rgbsub_a_g[0],
-        &combiner_rgbsub_a_b[0], combine.sub_a_rgb0);
-    SET_SUBB_RGB_INPUT(
-        &combiner_rgbsub_b_r[0], &combiner_rgbsub_b_g[0],
-        &combiner_rgbsub_b_b[0], combine.sub_b_rgb0);
-    SET_MUL_RGB_INPUT(
-        &combiner_rgbmul_r[0], &combiner_rgbmul_g[0], &combiner_rgbmul_b[0],
-        combine.mul_rgb0);
-    SET_ADD_RGB_INPUT(
-        &combiner_rgbadd_r[0], &combiner_rgbadd_g[0], &combiner_rgbadd_b[0],
-        combine.add_rgb0);
-    SET_SUB_ALPHA_INPUT(&combiner_alphasub_a[0], combine.sub_a_a0);
-    SET_SUB_ALPHA_INPUT(&combiner_alphasub_b[0], combine.sub_b_a0);
-    SET_MUL_ALPHA_INPUT(&combiner_alphamul[0], combine.mul_a0);
-    SET_SUB_ALPHA_INPUT(&combiner_alphaadd[0], combine.add_a0);
-
-    SET_SUBA_RGB_INPUT(
-        &combiner_rgbsub_a_r[1], &combiner_rgbsub_a_g[1],
-        &combiner_rgbsub_a_b[1], combine.sub_a_rgb1);
-    SET_SUBB_RGB_INPUT(
-        &combiner_rgbsub_b_r[1], &combiner_rgbsub_b_g[1],
-        &combiner_rgbsub_b_b[1], combine.sub_b_rgb1);
-    SET_MUL_RGB_INPUT(
-        &combiner_rgbmul_r[1], &combiner_rgbmul_g[1], &combiner_rgbmul_b[1],
-        combine.mul_rgb1);
-    SET_ADD_RGB_INPUT(
-        &combiner_rgbadd_r[1], &combiner_rgbadd_g[1], &combiner_rgbadd_b[1],
-        combine.add_rgb1);
-    SET_SUB_ALPHA_INPUT(&combiner_alphasub_a[1], combine.sub_a_a1);
-    SET_SUB_ALPHA_INPUT(&combiner_alphasub_b[1], combine.sub_b_a1);
-    SET_MUL_ALPHA_INPUT(&combiner_alphamul[1], combine.mul_a1);
-    SET_SUB_ALPHA_INPUT(&combiner_alphaadd[1], combine.add_a1);
-
-    other_modes.f.stalederivs = 1;
+    render_spans(rdp, yhlimit >> 2, yllimit >> 2, 0, 1);
+}
+
+static void set_fill_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    rdp->fill_color = w2;
+}
+
+static void set_fog_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    COLOR_RED(rdp->fog_color)   = (w2 & 0xFF000000) >> 24;
+    COLOR_GREEN(rdp->fog_color) = (w2 & 0x00FF0000) >> 16;
+    COLOR_BLUE(rdp->fog_color)  = (w2 & 0x0000FF00) >>  8;
+    COLOR_ALPHA(rdp->fog_color) = (w2 & 0x000000FF) >>  0;
+}
+
+static void set_blend_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    COLOR_RED(rdp->blend_color)   = (w2 & 0xFF000000) >> 24;
+    COLOR_GREEN(rdp->blend_color) = (w2 & 0x00FF0000) >> 16;
+    COLOR_BLUE(rdp->blend_color)  = (w2 & 0x0000FF00) >>  8;
+    COLOR_ALPHA(rdp->blend_color) = (w2 & 0x000000FF) >>  0;
+}
+
+static void set_prim_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    rdp->min_level               = (w1 & 0x00001F00) >>(40-32);
+    rdp->primitive_lod_frac      = (w1 & 0x000000FF) >>(32-32);
+    COLOR_RED(rdp->prim_color)   = (w2 & 0xFF000000) >> 24;
+    COLOR_GREEN(rdp->prim_color) = (w2 & 0x00FF0000) >> 16;
+    COLOR_BLUE(rdp->prim_color)  = (w2 & 0x0000FF00) >>  8;
+    COLOR_ALPHA(rdp->prim_color) = (w2 & 0x000000FF) >>  0;
+}
+
+static void set_env_color(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    COLOR_RED(rdp->env_color)   = (w2 & 0xFF000000) >> 24;
+    COLOR_GREEN(rdp->env_color) = (w2 & 0x00FF0000) >> 16;
+    COLOR_BLUE(rdp->env_color)  = (w2 & 0x0000FF00) >>  8;
+    COLOR_ALPHA(rdp->env_color) = (w2 & 0x000000FF) >>  0;
+}
+
+static void set_combine(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    rdp->combine.sub_a_rgb0 = (w1 & 0x00F00000) >>(52-32);
+    rdp->combine.mul_rgb0   = (w1 & 0x000F8000) >>(47-32);
+    rdp->combine.sub_a_a0   = (w1 & 0x00007000) >>(44-32);
+    rdp->combine.mul_a0     = (w1 & 0x00000E00) >>(41-32);
+    rdp->combine.sub_a_rgb1 = (w1 & 0x000001E0) >>(37-32);
+    rdp->combine.mul_rgb1   = (w1 & 0x0000001F) >>(32-32);
+    rdp->combine.sub_b_rgb0 = (w2 & 0xF0000000) >> 28;
+    rdp->combine.sub_b_rgb1 = (w2 & 0x0F000000) >> 24;
+    rdp->combine.sub_a_a1   = (w2 & 0x00E00000) >> 21;
+    rdp->combine.mul_a1     = (w2 & 0x001C0000) >> 18;
+    rdp->combine.add_rgb0   = (w2 & 0x00038000) >> 15;
+    rdp->combine.sub_b_a0   = (w2 & 0x00007000) >> 12;
+    rdp->combine.add_a0     = (w2 & 0x00000E00) >>  9;
+    rdp->combine.add_rgb1   = (w2 & 0x000001C0) >>  6;
+    rdp->combine.sub_b_a1   = (w2 & 0x00000038) >>  3;
+    rdp->combine.add_a1     = (w2 & 0x00000007) >>  0;
+
+    SET_SUBA_RGB_INPUT(rdp,
+        &rdp->combiner_rgbsub_a_r[0], &rdp->combiner_rgbsub_a_g[0],
+        &rdp->combiner_rgbsub_a_b[0], rdp->combine.sub_a_rgb0);
+    SET_SUBB_RGB_INPUT(rdp,
+        &rdp->combiner_rgbsub_b_r[0], &rdp->combiner_rgbsub_b_g[0],
+        &rdp->combiner_rgbsub_b_b[0], rdp->combine.sub_b_rgb0);
+    SET_MUL_RGB_INPUT(rdp,
+        &rdp->combiner_rgbmul_r[0], &rdp->combiner_rgbmul_g[0], &rdp->combiner_rgbmul_b[0],
+        rdp->combine.mul_rgb0);
+    SET_ADD_RGB_INPUT(rdp,
+        &rdp->combiner_rgbadd_r[0], &rdp->combiner_rgbadd_g[0], &rdp->combiner_rgbadd_b[0],
+        rdp->combine.add_rgb0);
+    SET_SUB_ALPHA_INPUT(rdp, &rdp->combiner_alphasub_a[0], rdp->combine.sub_a_a0);
+    SET_SUB_ALPHA_INPUT(rdp, &rdp->combiner_alphasub_b[0], rdp->combine.sub_b_a0);
+    SET_MUL_ALPHA_INPUT(rdp, &rdp->combiner_alphamul[0], rdp->combine.mul_a0);
+    SET_SUB_ALPHA_INPUT(rdp, &rdp->combiner_alphaadd[0], rdp->combine.add_a0);
+
+    SET_SUBA_RGB_INPUT(rdp,
+        &rdp->combiner_rgbsub_a_r[1], &rdp->combiner_rgbsub_a_g[1],
+        &rdp->combiner_rgbsub_a_b[1], rdp->combine.sub_a_rgb1);
+    SET_SUBB_RGB_INPUT(rdp,
+        &rdp->combiner_rgbsub_b_r[1], &rdp->combiner_rgbsub_b_g[1],
+        &rdp->combiner_rgbsub_b_b[1], rdp->combine.sub_b_rgb1);
+    SET_MUL_RGB_INPUT(rdp,
+        &rdp->combiner_rgbmul_r[1], &rdp->combiner_rgbmul_g[1], &rdp->combiner_rgbmul_b[1],
+        rdp->combine.mul_rgb1);
+    SET_ADD_RGB_INPUT(rdp,
+        &rdp->combiner_rgbadd_r[1], &rdp->combiner_rgbadd_g[1], &rdp->combiner_rgbadd_b[1],
+        rdp->combine.add_rgb1);
+    SET_SUB_ALPHA_INPUT(rdp, &rdp->combiner_alphasub_a[1], rdp->combine.sub_a_a1);
+    SET_SUB_ALPHA_INPUT(rdp, &rdp->combiner_alphasub_b[1], rdp->combine.sub_b_a1);
+    SET_MUL_ALPHA_INPUT(rdp, &rdp->combiner_alphamul[1], rdp->combine.mul_a1);
+    SET_SUB_ALPHA_INPUT(rdp, &rdp->combiner_alphaadd[1], rdp->combine.add_a1);
+
+    rdp->other_modes.f.stalederivs = 1;
 }
 
-static void set_texture_image(uint32_t w1, uint32_t w2)
-{
-    ti_format  = (w1 & 0x00E00000) >> (53 - 32);
-    ti_size    = (w1 & 0x00180000) >> (51 - 32);
-    ti_width   = (w1 & 0x000003FF) >> (32 - 32);
-    ti_address = (w2 & 0x03FFFFFF) >> ( 0 -  0);
+static void set_texture_image(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
+{
+    rdp->ti_format  = (w1 & 0x00E00000) >> (53 - 32);
+    rdp->ti_size    = (w1 & 0x00180000) >> (51 - 32);
+    rdp->ti_width   = (w1 & 0x000003FF) >> (32 - 32);
+    rdp->ti_address = (w2 & 0x03FFFFFF) >> ( 0 -  0);
  /* ti_address &= 0x00FFFFFF; // physical memory limit, enforced later */
-    ++ti_width;
+    ++rdp->ti_width;
 }
 
-static void set_mask_image(uint32_t w1, uint32_t w2)
+static void set_mask_image(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    zb_address = w2 & 0x03FFFFFF;
+    rdp->zb_address = w2 & 0x03FFFFFF;
  /* zb_address &= 0x00FFFFFF; */
 }
 
-static void set_color_image(uint32_t w1, uint32_t w2)
+static void set_color_image(struct rdp_state *rdp, uint32_t w1, uint32_t w2)
 {
-    fb_format  = (w1 & 0x00E00000) >> (53 - 32);
-    fb_size    = (w1 & 0x00180000) >> (51 - 32);
-    fb_width   = (w1 & 0x000003FF) >> (32 - 32);
-    fb_address = (w2 & 0x03FFFFFF) >> ( 0 -  0);
-    ++fb_width;
+    rdp->fb_format  = (w1 & 0x00E00000) >> (53 - 32);
+    rdp->fb_size    = (w1 & 0x00180000) >> (51 - 32);
+    rdp->fb_width   = (w1 & 0x000003FF) >> (32 - 32);
+    rdp->fb_address = (w2 & 0x03FFFFFF) >> ( 0 -  0);
+    ++rdp->fb_width;
  /* fb_address &= 0x00FFFFFF; */
 }
 
@@ -0,0 +1,206 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-video-angrylion - n64video_capture.c                      *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This file is part of the angrylion RDP plugin, whose code comes       *
+ *   under the MAME license.  See "MAME License.txt" and CREDITS.txt       *
+ *   in the plugin's src directory for the terms and credits.              *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "z64.h"
+#include "Gfx #1.3.h"
+#include "vi.h"
+#include "rdp.h"
+#include "capture.h"
+
+#define CAPTURE_PAGE_SIZE   0x1000
+
+extern uint32_t *blitter_buf_lock;
+
+int capture_active;
+
+static FILE *capture_file;
+static uint32_t capture_rdram_size;
+static uint8_t *capture_rdram; /* RDRAM as the replay will have it */
+
+static DP_FIFO *capture_list;
+static uint32_t capture_list_length;
+static uint32_t capture_list_size;
+
+static void capture_record(uint32_t type, uint32_t size)
+{
+    const uint32_t header[2] = { type, size };
+
+    fwrite(header, sizeof(header), 1, capture_file);
+}
+
+int capture_open(const char *path)
+{
+    struct capture_header header;
+
+    capture_close();
+
+    capture_file = fopen(path, "wb");
+    if (capture_file == NULL)
+        return 0;
+
+    capture_rdram_size = plim + 1;
+    header.magic = CAPTURE_MAGIC;
+    header.version = CAPTURE_VERSION;
+    header.rdram_size = capture_rdram_size;
+    header.overlay = overlay;
+    header.compact_240p = vi_compact_240p;
+    fwrite(&header, sizeof(header), 1, capture_file);
+
+    capture_active = 1;
+    return 1;
+}
+
+void capture_close(void)
+{
+    if (capture_file != NULL)
+        fclose(capture_file);
+    capture_file = NULL;
+    capture_active = 0;
+
+    free(capture_rdram);
+    capture_rdram = NULL;
+    free(capture_list);
+    capture_list = NULL;
+    capture_list_length = capture_list_size = 0;
+}
+
+/*
+ * Records what the CPU wrote to RDRAM since the last DP list.  The RDP is
+ * idle here: capture_end_list() waited for it before taking its copy.
+ */
+void capture_begin_list(void)
+{
+    const uint8_t *ram = (const uint8_t*)gfx_info.RDRAM;
+    uint8_t tmem[0x1000];
+    uint32_t start, end;
+
+    if (capture_rdram == NULL)
+    {
+        capture_rdram = malloc(capture_rdram_size);
+        if (capture_rdram == NULL)
+        {
+            capture_close();
+            return;
+        }
+        rdp_get_tmem(tmem);
+        memcpy(capture_rdram, ram, capture_rdram_size);
+
+        capture_record(CAPTURE_SNAPSHOT,
+            capture_rdram_size + sizeof(hidden_bits) + sizeof(tmem));
+        fwrite(capture_rdram, capture_rdram_size, 1, capture_file);
+        fwrite(hidden_bits, sizeof(hidden_bits), 1, capture_file);
+        fwrite(tmem, sizeof(tmem), 1, capture_file);
+        return;
+    }
+
+    for (start = 0; start < capture_rdram_size; start = end)
+    {
+        if (!memcmp(&capture_rdram[start], &ram[start], CAPTURE_PAGE_SIZE))
+        {
+            end = start + CAPTURE_PAGE_SIZE;
+            continue;
+        }
+        end = start + CAPTURE_PAGE_SIZE;
+        while (end < capture_rdram_size
+            && memcmp(&capture_rdram[end], &ram[end], CAPTURE_PAGE_SIZE))
+            end += CAPTURE_PAGE_SIZE;
+
+        capture_record(CAPTURE_RDRAM, sizeof(start) + end - start);
+        fwrite(&start, sizeof(start), 1, capture_file);
+        fwrite(&ram[start], end - start, 1, capture_file);
+        memcpy(&capture_rdram[start], &ram[start], end - start);
+    }
+}
+
+void capture_command(const void *words, int length)
+{
+    if (capture_list_length + length > capture_list_size)
+    {
+        uint32_t size = capture_list_size ? capture_list_size : 0x1000;
+        DP_FIFO *list;
+
+        while (capture_list_length + length > size)
+            size <<= 1;
+        list = realloc(capture_list, size * sizeof(DP_FIFO));
+        if (list == NULL)
+        {
+            capture_close();
+            return;
+        }
+        capture_list = list;
+        capture_list_size = size;
+    }
+    memcpy(&capture_list[capture_list_length], words, length * sizeof(DP_FIFO));
+    capture_list_length += length;
+}
+
+void capture_end_list(void)
+{
+    if (capture_list_length != 0)
+    {
+        capture_record(CAPTURE_COMMANDS, capture_list_length * sizeof(DP_FIFO));
+        fwrite(capture_list, sizeof(DP_FIFO), capture_list_length, capture_file);
+        capture_list_length = 0;
+    }
+
+    rdp_sync();
+    if (capture_rdram != NULL)
+        memcpy(capture_rdram, gfx_info.RDRAM, capture_rdram_size);
+}
+
+void capture_vi(void)
+{
+    uint32_t *regs[CAPTURE_VI_REGS];
+    uint32_t record[CAPTURE_VI_REGS + 1];
+    int i;
+
+    capture_vi_registers(regs);
+    for (i = 0; i < CAPTURE_VI_REGS; i++)
+        record[i] = *regs[i];
+    record[CAPTURE_VI_REGS] = capture_hash(blitter_buf_lock,
+        pitchindwords * PRESCALE_HEIGHT * sizeof(uint32_t));
+
+    capture_record(CAPTURE_VI, sizeof(record));
+    fwrite(record, sizeof(record), 1, capture_file);
+    fflush(capture_file);
+}
+
+void capture_vi_registers(uint32_t *regs[CAPTURE_VI_REGS])
+{
+    regs[ 0] = (uint32_t*)gfx_info.VI_STATUS_REG;
+    regs[ 1] = (uint32_t*)gfx_info.VI_ORIGIN_REG;
+    regs[ 2] = (uint32_t*)gfx_info.VI_WIDTH_REG;
+    regs[ 3] = (uint32_t*)gfx_info.VI_INTR_REG;
+    regs[ 4] = (uint32_t*)gfx_info.VI_V_CURRENT_LINE_REG;
+    regs[ 5] = (uint32_t*)gfx_info.VI_TIMING_REG;
+    regs[ 6] = (uint32_t*)gfx_info.VI_V_SYNC_REG;
+    regs[ 7] = (uint32_t*)gfx_info.VI_H_SYNC_REG;
+    regs[ 8] = (uint32_t*)gfx_info.VI_LEAP_REG;
+    regs[ 9] = (uint32_t*)gfx_info.VI_H_START_REG;
+    regs[10] = (uint32_t*)gfx_info.VI_V_START_REG;
+    regs[11] = (uint32_t*)gfx_info.VI_V_BURST_REG;
+    regs[12] = (uint32_t*)gfx_info.VI_X_SCALE_REG;
+    regs[13] = (uint32_t*)gfx_info.VI_Y_SCALE_REG;
+}
+
+/* 32-bit FNV-1a */
+uint32_t capture_hash(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    uint32_t hash = 0x811C9DC5;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x01000193;
+    return hash;
+}
@@ -5,11 +5,10 @@
 #include "Gfx #1.3.h"
 #include "vi.h"
 #include "rdp.h"
+#include "parallel.h"
+#include "capture.h"
 #include "m64p_types.h"
 #include "m64p_config.h"
-#ifdef HAVE_RDP_DUMP
-#include "../mupen64plus-video-paraLLEl/rdp_dump.h"
-#endif
 #include <stdlib.h>
 
 extern unsigned int screen_width, screen_height;
@@ -32,8 +31,30 @@ void CloseDLL (void)
     return;
 }
 
+/* bottom-up RGB, read straight from the surface the VI draws into */
 void angrylionReadScreen2(void *dest, int *width, int *height, int front)
 {
+    extern uint32_t *blitter_buf_lock;
+    uint8_t *line = (uint8_t*)dest;
+    int x, y;
+
+    *width = screen_width;
+    *height = 480;
+    if (dest == NULL || blitter_buf_lock == NULL)
+        return;
+
+    for (y = *height - 1; y >= 0; y--)
+    {
+        const uint32_t *pix =
+            &blitter_buf_lock[pitchindwords * (y * vi_output_height / *height)];
+
+        for (x = 0; x < *width; x++)
+        {
+            *line++ = (uint8_t)(pix[x] >> 16);
+            *line++ = (uint8_t)(pix[x] >>  8);
+            *line++ = (uint8_t)(pix[x] >>  0);
+        }
+    }
 }
 
  
@@ -58,11 +79,6 @@ void angrylionSetRenderingCallback(void (*callback)(int))
 
 int angrylionInitiateGFX (GFX_INFO Gfx_Info)
 {
-#ifdef HAVE_RDP_DUMP
-   const char *env = getenv("RDP_DUMP");
-   if (env)
-      rdp_dump_init(env, 8 * 1024 * 1024);
-#endif
    return true;
 }
 
@@ -89,16 +105,18 @@ void angrylionProcessRDPList(void)
 
 void angrylionRomClosed (void)
 {
+    capture_close();
     rdp_close();
-#ifdef HAVE_RDP_DUMP
-    rdp_dump_end();
-#endif
+    parallel_close();
 }
 
 static m64p_handle l_ConfigAngrylion;
  
 int angrylionRomOpen (void)
 {
+   const char *capture_path = getenv("ANGRYLION_CAPTURE");
+   int num_workers;
+
    /* TODO/FIXME: For now just force it to 640x480.
     *
     * Later on we might want a low-res mode (320x240)
@@ -118,8 +136,14 @@ int angrylionRomOpen (void)
    pitchindwords = PRESCALE_WIDTH / 1; /* sizeof(DWORD) == sizeof(pixel) == 4 */
    screen_pitch  = PRESCALE_WIDTH << 2;
 
+   num_workers = ConfigGetParamInt(l_ConfigAngrylion, "NumWorkers");
+   parallel_init(num_workers < 0 ? 0 : num_workers);
+   rdp_fifo_threaded = ConfigGetParamBool(l_ConfigAngrylion, "RDPThread");
    rdp_init();
    overlay = ConfigGetParamBool(l_ConfigAngrylion, "VIOverlay");
+   vi_compact_240p = ConfigGetParamBool(l_ConfigAngrylion, "Compact240p");
+   if (capture_path != NULL)
+      capture_open(capture_path);
    return 1;
 }
 
@@ -133,6 +157,9 @@ void angrylionUpdateScreen(void)
     counter = 0;
 #endif
     rdp_update();
+    if (capture_active)
+        capture_vi();
+    screen_height = vi_output_height;
     retro_return(true);
 #if 0
     if (step != 0)
@@ -159,14 +186,17 @@ void angrylionViWidthChanged (void)
 
 void angrylionFBWrite(unsigned int addr, unsigned int size)
 {
+   rdp_sync();
 }
 
 void angrylionFBRead(unsigned int addr)
 {
+   rdp_sync();
 }
 
 void angrylionFBGetFrameBufferInfo(void *pinfo)
 {
+   rdp_get_frame_buffer_info(pinfo);
 }
 
 m64p_error angrylionPluginGetVersion(m64p_plugin_type *PluginType, int *PluginVersion, int *APIVersion, const char **PluginNamePtr, int *Capabilities)
@@ -0,0 +1,129 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-video-angrylion - n64video_parallel.c                     *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This file is part of the angrylion RDP plugin, whose code comes       *
+ *   under the MAME license.  See "MAME License.txt" and CREDITS.txt       *
+ *   in the plugin's src directory for the terms and credits.              *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stddef.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "parallel.h"
+
+static pthread_t workers[PARALLEL_MAX_WORKERS];
+static uint32_t num_workers = 1;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t task_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t task_done = PTHREAD_COND_INITIALIZER;
+
+static void (*pool_task)(uint32_t);
+static uint32_t task_generation;
+static uint32_t tasks_pending;
+static int pool_shutdown;
+
+static void* worker_main(void* arg)
+{
+    const uint32_t worker_id = (uint32_t)(uintptr_t)arg;
+    uint32_t generation;
+
+    pthread_mutex_lock(&pool_lock);
+    generation = task_generation;
+    for (;;)
+    {
+        void (*task)(uint32_t);
+
+        while (generation == task_generation && !pool_shutdown)
+            pthread_cond_wait(&task_ready, &pool_lock);
+        if (pool_shutdown)
+            break;
+        generation = task_generation;
+        task = pool_task;
+        pthread_mutex_unlock(&pool_lock);
+
+        task(worker_id);
+
+        pthread_mutex_lock(&pool_lock);
+        if (--tasks_pending == 0)
+            pthread_cond_signal(&task_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+void parallel_init(uint32_t num)
+{
+    uint32_t i;
+
+    parallel_close();
+
+    if (num == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num = (cpus > 0) ? (uint32_t)cpus : 1;
+    }
+    if (num > PARALLEL_MAX_WORKERS)
+        num = PARALLEL_MAX_WORKERS;
+
+/*
+ * Workers sample task_generation under the lock before waiting, and
+ * parallel_run() cannot bump it until we release the lock below, so no
+ * thread can miss the first task no matter how late it gets scheduled.
+ */
+    pthread_mutex_lock(&pool_lock);
+    for (i = 1; i < num; i++)
+        if (pthread_create(&workers[i], NULL, worker_main, (void*)(uintptr_t)i))
+            break;
+    num_workers = i;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void parallel_close(void)
+{
+    uint32_t i;
+
+    if (num_workers == 1)
+        return;
+
+    pthread_mutex_lock(&pool_lock);
+    pool_shutdown = 1;
+    pthread_cond_broadcast(&task_ready);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (i = 1; i < num_workers; i++)
+        pthread_join(workers[i], NULL);
+
+    pool_shutdown = 0;
+    num_workers = 1;
+}
+
+uint32_t parallel_num_workers(void)
+{
+    return num_workers;
+}
+
+void parallel_run(void (*task)(uint32_t))
+{
+    if (num_workers == 1)
+    {
+        task(0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    pool_task = task;
+    tasks_pending = num_workers - 1;
+    ++task_generation;
+    pthread_cond_broadcast(&task_ready);
+    pthread_mutex_unlock(&pool_lock);
+
+    task(0);
+
+    pthread_mutex_lock(&pool_lock);
+    while (tasks_pending != 0)
+        pthread_cond_wait(&task_done, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+}
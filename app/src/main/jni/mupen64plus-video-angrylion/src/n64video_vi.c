@@ -3,6 +3,7 @@
 #include "z64.h"
 #include "rdp.h"
 #include "vi.h"
+#include "parallel.h"
 #include "api/libretro.h"
 
 typedef struct {
@@ -93,7 +94,9 @@ uint16_t* rdram_16;
 uint32_t plim;
 uint32_t idxlim16;
 uint32_t idxlim32;
-uint8_t hidden_bits[0x400000];
+uint8_t hidden_bits[0x100000];
+int vi_output_height = 480;
+int vi_compact_240p = 0;
 
 uint32_t gamma_table[0x100];
 uint32_t gamma_dither_table[0x4000];
@@ -107,6 +110,18 @@ extern uint32_t *blitter_buf_lock;
 static uint32_t tvfadeoutstate[625];
 static uint32_t brightness = 0;
 static uint32_t prevwasblank = 0;
+static uint32_t vi_frame_count = 0;
+
+/*
+ * Output lines are filtered in contiguous blocks, one per worker.  Nothing
+ * carries from one output line to the next except memoized fetches, so each
+ * block just starts with cold caches, and the dither noise is drawn from a
+ * per-line seed rather than one shared stream.
+ */
+static struct {
+    uint32_t prescale_ptr;
+    int hres, vres, x_start, vitype, linecount;
+} vi_frame;
 
 STRICTINLINE static void video_filter16(
     int* r, int* g, int* b, uint32_t fboffset, uint32_t num, uint32_t hres,
@@ -120,7 +135,7 @@ STRICTINLINE static void restore_filter16(
     int* r, int* g, int* b, uint32_t fboffset, uint32_t num, uint32_t hres);
 STRICTINLINE static void restore_filter32(
     int* r, int* g, int* b, uint32_t fboffset, uint32_t num, uint32_t hres);
-static void gamma_filters(unsigned char* argb, int gamma_and_dither);
+static void gamma_filters(unsigned char* argb, int gamma_and_dither, uint32_t* seed);
 static void adjust_brightness(unsigned char* argb, int brightcoeff);
 STRICTINLINE static void vi_vl_lerp(CCVG* up, CCVG down, uint32_t frac);
 STRICTINLINE static void video_max_optimized(uint32_t* Pixels, uint32_t* penumin, uint32_t* penumax, int numofels);
@@ -132,14 +147,41 @@ STRICTINLINE static void vi_fetch_filter32(
 
 static void do_frame_buffer_proper(
     uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
-    int linecount);
+    int linecount, int first_line, int end_line);
 static void do_frame_buffer_raw(
     uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
-    int linecount);
-static void (*do_frame_buffer[2])(uint32_t, int, int, int, int, int) = {
+    int linecount, int first_line, int end_line);
+static void (*do_frame_buffer[2])(uint32_t, int, int, int, int, int, int, int) = {
     do_frame_buffer_raw, do_frame_buffer_proper
 };
 
+static void do_frame_buffer_lines(uint32_t worker_id)
+{
+    const uint32_t num = parallel_num_workers();
+
+    do_frame_buffer[overlay](
+        vi_frame.prescale_ptr, vi_frame.hres, vi_frame.vres, vi_frame.x_start,
+        vi_frame.vitype, vi_frame.linecount,
+        vi_frame.vres * worker_id / num, vi_frame.vres * (worker_id + 1) / num);
+}
+
+static STRICTINLINE uint32_t vi_line_seed(int line)
+{
+    uint32_t seed = (vi_frame_count << 10) + (uint32_t)line;
+
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6B;
+    seed ^= seed >> 13;
+    return seed;
+}
+
+static STRICTINLINE int vi_irand(uint32_t* seed)
+{
+    *seed *= 0x343fd;
+    *seed += 0x269ec3;
+    return ((*seed >> 16) & 0x7fff);
+}
+
 static void (*vi_fetch_filter_ptr)(
     CCVG*, uint32_t, uint32_t, uint32_t, uint32_t);
 static void (*vi_fetch_filter_func[2])(
@@ -197,6 +239,28 @@ void lookup_cvmask_derivatives(uint32_t mask, uint8_t* offx, uint8_t* offy, uint
     *offy = temp.yoff;
 }
 
+/* spreads rows 0..lines-1 of the VI output over twice as many rows */
+static void double_lines(int lines)
+{
+    register signed int cur_line;
+
+    cur_line = lines - 1;
+    while (cur_line >= 0)
+    {
+        memcpy(
+            &blitter_buf_lock[2*PRESCALE_WIDTH*cur_line + PRESCALE_WIDTH],
+            &blitter_buf_lock[1*PRESCALE_WIDTH*cur_line],
+            4 * PRESCALE_WIDTH
+        );
+        memcpy(
+            &blitter_buf_lock[2*PRESCALE_WIDTH*cur_line + 0],
+            &blitter_buf_lock[1*PRESCALE_WIDTH*cur_line],
+            4 * PRESCALE_WIDTH
+        );
+        --cur_line;
+    }
+}
+
 void rdp_update(void)
 {
     uint32_t prescale_ptr;
@@ -228,6 +292,8 @@ void rdp_update(void)
     const int vitype = *GET_GFX_INFO(VI_STATUS_REG) & 0x00000003;
     const int pixel_size = sizeof(int32_t);
 
+    rdp_sync(); /* scanout reads RDRAM and hidden_bits the RDP may still be drawing */
+
 #if 0
     fb.width        = PRESCALE_WIDTH;
     fb.height       = PRESCALE_HEIGHT;
@@ -255,6 +321,18 @@ void rdp_update(void)
     line_count = pitchindwords << serration_pulses;
     line_shifter = serration_pulses ^ 1;
 
+    /*
+     * rdp_update() keeps rows of the previous frame (the other interlaced
+     * field, the TV fade-out) and returns early on some frames.  Leaving
+     * compacted 240p output, the rows are doubled right away as they would
+     * have been at the end of the previous frame.
+     */
+    if (line_shifter == 0 && vi_output_height != 480)
+    {
+        double_lines(vi_output_height);
+        vi_output_height = 480;
+    }
+
     hres = delta_x;
     vres = delta_y;
     h_start = x1 - (ispal ? 128 : 108);
@@ -359,40 +437,40 @@ void rdp_update(void)
 
     prescale_ptr =
         (v_start * line_count) + h_start + (lowerfield ? pitchindwords : 0);
-    do_frame_buffer[overlay](
-        prescale_ptr, hres, vres, x_start, vitype, line_count);
+    vi_frame.prescale_ptr = prescale_ptr;
+    vi_frame.hres = hres;
+    vi_frame.vres = vres;
+    vi_frame.x_start = x_start;
+    vi_frame.vitype = vitype;
+    vi_frame.linecount = line_count;
+    parallel_run(do_frame_buffer_lines);
+    ++vi_frame_count;
 no_frame_buffer:
 
     __src.bottom = (ispal ? 576 : 480) >> line_shifter; /* visible lines */
 
     if (line_shifter != 0) /* 240p non-interlaced VI DAC mode */
     {
-        register signed int cur_line;
-
-        cur_line = 240 - 1;
-        while (cur_line >= 0)
+        if (vi_compact_240p)
         {
-            memcpy(
-                &blitter_buf_lock[2*PRESCALE_WIDTH*cur_line + PRESCALE_WIDTH],
-                &blitter_buf_lock[1*PRESCALE_WIDTH*cur_line],
-                4 * PRESCALE_WIDTH
-            );
-            memcpy(
-                &blitter_buf_lock[2*PRESCALE_WIDTH*cur_line + 0],
-                &blitter_buf_lock[1*PRESCALE_WIDTH*cur_line],
-                4 * PRESCALE_WIDTH
-            );
-            --cur_line;
+            /*
+             * The frontend doubles the lines.  Rows kept from the previous
+             * 240p frame stay as they were drawn here, where the doubled
+             * output shows line y/2 of that frame in row y instead.
+             */
+            vi_output_height = 240;
         }
+        else
+            double_lines(240);
     }
 }
 
 static void do_frame_buffer_proper(
     uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
-    int linecount)
+    int linecount, int first_line, int end_line)
 {
-    CCVG viaa_array[2048];
-    CCVG divot_array[2048];
+    CCVG viaa_array[2][1 + 1024]; /* [0] is read, never written, at x = -1 */
+    CCVG divot_array[2][1 + 1024];
     CCVG *viaa_cache, *viaa_cache_next, *divot_cache, *divot_cache_next;
     CCVG *tempccvgptr;
     CCVG color, nextcolor, scancolor, scannextcolor;
@@ -422,21 +500,24 @@ static void do_frame_buffer_proper(
     const int dither_filter    = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00010000);
     const int gamma_and_dither = (gamma << 1) | gamma_dither;
     const int lerp_en          = fsaa | extralines;
+    uint32_t seed;
 
     if (frame_buffer == 0)
         return;
 
-    if (clock_enable)
+    if (clock_enable && first_line == 0)
         DisplayError(
             "rdp_update: vbus_clock_enable bit set in VI_CONTROL_REG "\
             "register. Never run this code on your N64! It's rumored that "\
             "turning this bit on will result in permanent damage to the "\
             "hardware! Emulation will now continue.");
 
-    viaa_cache = &viaa_array[0];
-    viaa_cache_next = &viaa_array[1024];
-    divot_cache = &divot_array[0];
-    divot_cache_next = &divot_array[1024];
+    memset(viaa_array, 0, sizeof(viaa_array));
+    memset(divot_array, 0, sizeof(divot_array));
+    viaa_cache = &viaa_array[0][1];
+    viaa_cache_next = &viaa_array[1][1];
+    divot_cache = &divot_array[0][1];
+    divot_cache_next = &divot_array[1][1];
 
     cache_marker_init  = (x_start >> 10) - 2;
     cache_marker_init |= -(cache_marker_init < 0);
@@ -448,12 +529,15 @@ static void do_frame_buffer_proper(
     slowbright = brightness >> 1;
 #endif
     pixels = 0;
+    y_start += y_add * first_line;
+    prescale_ptr += linecount * first_line;
 
-    for (j = 0; j < vres; j++)
+    for (j = first_line; j < end_line; j++)
     {
         x_start = (vi_x_scale >> 16) & 0x0FFF;
+        seed = vi_line_seed(j);
 
-        if ((y_start >> 10) == (prevy + 1) && j)
+        if ((y_start >> 10) == (prevy + 1) && j != first_line)
         {
             cache_marker = cache_next_marker;
             cache_next_marker = cache_marker_init;
@@ -472,7 +556,7 @@ static void do_frame_buffer_proper(
                 divot_cache_next = tempccvgptr;
             }
         }
-        else if ((y_start >> 10) != prevy || !j)
+        else if ((y_start >> 10) != prevy || j == first_line)
         {
             cache_marker = cache_next_marker = cache_marker_init;
             if (divot == 0)
@@ -662,11 +746,12 @@ static void do_frame_buffer_proper(
                 else
                     vi_vl_lerp(&color, nextcolor, xfrac);
             }
+            argb[0 ^ BYTE_ADDR_XOR] = 0x00;
             argb[1 ^ BYTE_ADDR_XOR] = color.r;
             argb[2 ^ BYTE_ADDR_XOR] = color.g;
             argb[3 ^ BYTE_ADDR_XOR] = color.b;
 
-            gamma_filters(argb, gamma_and_dither);
+            gamma_filters(argb, gamma_and_dither, &seed);
 #ifdef BW_ZBUFFER
             uint32_t tempz = RREADIDX16((frame_buffer >> 1) + cur_x);
 
@@ -707,7 +792,7 @@ static void do_frame_buffer_proper(
 }
 static void do_frame_buffer_raw(
     uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
-    int linecount)
+    int linecount, int first_line, int end_line)
 {
     uint32_t * scanline;
     int pixels;
@@ -722,6 +807,9 @@ static void do_frame_buffer_raw(
     if (frame_buffer == 0)
         return;
     y_start = *GET_GFX_INFO(VI_Y_SCALE_REG)>>16 & 0x0FFF;
+    y_start += y_add * first_line;
+    prescale_ptr += linecount * first_line;
+    vres = end_line - first_line;
 
     if (vitype & 1) /* 32-bit RGBA (branch unlikely) */
     {
@@ -1124,7 +1212,7 @@ STRICTINLINE static void restore_filter32(
     *b = bend;
 }
 
-static void gamma_filters(unsigned char* argb, int gamma_and_dither)
+static void gamma_filters(unsigned char* argb, int gamma_and_dither, uint32_t* seed)
 {
     int cdith, dith;
     int r, g, b;
@@ -1139,7 +1227,7 @@ static void gamma_filters(unsigned char* argb, int gamma_and_dither)
     switch(gamma_and_dither)
     {
         case 1:
-            cdith = irand();
+            cdith = vi_irand(seed);
             dith = cdith & 1;
             if (r < 255)
                 r += dith;
@@ -1156,7 +1244,7 @@ static void gamma_filters(unsigned char* argb, int gamma_and_dither)
             b = gamma_table[b];
             break;
         case 3:
-            cdith = irand();
+            cdith = vi_irand(seed);
             dith = cdith & 0x3f;
             r = gamma_dither_table[(r << 6) | dith];
             dith = (cdith >> 6) & 0x3f;
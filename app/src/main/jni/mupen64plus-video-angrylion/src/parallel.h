@@ -0,0 +1,31 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-video-angrylion - parallel.h                              *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This file is part of the angrylion RDP plugin, whose code comes       *
+ *   under the MAME license.  See "MAME License.txt" and CREDITS.txt       *
+ *   in the plugin's src directory for the terms and credits.              *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <stdint.h>
+
+#define PARALLEL_MAX_WORKERS    8
+
+/*
+ * A small fixed pool of rasterizer threads.  The calling thread always acts
+ * as worker 0, so with a single worker no threads are created and
+ * parallel_run() is a plain function call.
+ *
+ * `num` == 0 selects one worker per online CPU.
+ */
+extern void parallel_init(uint32_t num);
+extern void parallel_close(void);
+extern uint32_t parallel_num_workers(void);
+
+/* Runs task(worker_id) on every worker and returns once all have finished. */
+extern void parallel_run(void (*task)(uint32_t));
+
+#endif
@@ -32,6 +32,11 @@ INLINE extern __m128i mm_mullo_epi32_seh(__m128i dest, __m128i src);
     { ((int64_t *)buf)[0] = ((int64_t *)buf)[1] = 0x0000000000000000; }
 #endif
 
+#if !defined(USE_SSE_SUPPORT) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define USE_NEON_SUPPORT
+#include <arm_neon.h>
+#endif
+
 #define setzero_si64(buffer) { \
     *(int64_t *)(buffer) = 0x0000000000000000; \
 }
@@ -181,6 +186,22 @@ enum {
 
 extern void process_RDP_list(void);
 
+/*
+ * When set before rdp_init(), DP lists are drawn on a dedicated thread and
+ * rdp_sync() blocks until everything submitted so far has reached RDRAM.
+ */
+extern int rdp_fifo_threaded;
+extern void rdp_sync(void);
+
+/*
+ * Fills the core's FrameBufferInfo[6] with the color and Z images of the
+ * submitted commands, so CPU accesses to them can wait on rdp_sync().
+ */
+extern void rdp_get_frame_buffer_info(void *pinfo);
+
+extern void rdp_get_tmem(uint8_t *tmem);
+extern void rdp_set_tmem(const uint8_t *tmem);
+
 extern uint32_t internal_vi_v_current_line;
 
 #endif
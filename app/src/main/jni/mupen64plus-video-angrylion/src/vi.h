@@ -40,7 +40,14 @@ extern uint16_t* rdram_16;
 extern uint32_t plim;
 extern uint32_t idxlim16;
 extern uint32_t idxlim32;
-extern uint8_t hidden_bits[0x400000];
+extern uint8_t hidden_bits[0x100000];
+
+/*
+ * rows of blitter_buf_lock holding the picture:  480, or 240 for 240p frames
+ * when vi_compact_240p is set and the frontend doubles their lines itself
+ */
+extern int vi_output_height;
+extern int vi_compact_240p;
 
 extern int overlay;
 
@@ -132,11 +132,18 @@
 #define RWRITEIDX16(in, val)	{(in) &= (RDRAM_MASK >> 1); if ((in) <= idxlim16) rdram_16[(in) ^ WORD_ADDR_XOR] = (val);}
 #define RWRITEIDX32(in, val)	{(in) &= (RDRAM_MASK >> 2); if ((in) <= idxlim32) rdram[(in)] = (val);}
 
+/*
+ * The two hidden bits of RDRAM halfword in are packed four to a byte, so a
+ * 64-bit RDRAM word has one byte of hidden_bits.
+ */
+#define HIDDEN_BITS_SHIFT(in)   (((in) & 3) << 1)
+
 #define PAIRREAD16(rdst, hdst, in) {             \
    (in) &= (RDRAM_MASK >> 1);			             \
     if ((in) <= idxlim16) {                      \
         (rdst) = rdram_16[(in) ^ WORD_ADDR_XOR]; \
-        (hdst) = hidden_bits[(in)];              \
+        (hdst) = __atomic_load_n(&hidden_bits[(in) >> 2], __ATOMIC_RELAXED) \
+            >> HIDDEN_BITS_SHIFT(in) & 3;        \
     } else                                       \
         (rdst) = (hdst) = 0;                     \
 }
@@ -0,0 +1,262 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus-video-angrylion - angrylion-replay.c                      *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This file is part of the angrylion RDP plugin, whose code comes       *
+ *   under the MAME license.  See "MAME License.txt" and CREDITS.txt       *
+ *   in the plugin's src directory for the terms and credits.              *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * angrylion-replay: re-runs an RDP capture headless, times it and checks
+ * every frame against the hash recorded while capturing.
+ *
+ * Captures are written by the plugin when ANGRYLION_CAPTURE names a file at
+ * ROM open.  Build on the host from mupen64plus-video-angrylion/ with:
+ *
+ *   cc -O2 -o angrylion-replay tools/angrylion-replay.c src/n64video.c \
+ *      src/n64video_capture.c src/n64video_parallel.c src/n64video_vi.c \
+ *      -Isrc -I../libretro/libretro-common/include -I../libretro \
+ *      -I../mupen64plus-core/src/api -DM64P_PLUGIN_API -lpthread
+ *
+ * (add -DUSE_SSE_SUPPORT to time the SSE paths)
+ *
+ * usage: angrylion-replay [-w workers] [-s] [-v] capture
+ *   -w N   rasterizer workers, 0 = one per CPU (default 1)
+ *   -s     draw on the calling thread instead of the RDP thread
+ *   -v     print the time and hash of every frame
+ *
+ * Exits with 1 if any frame differs from the capture.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "z64.h"
+#include "Gfx #1.3.h"
+#include "vi.h"
+#include "rdp.h"
+#include "parallel.h"
+#include "capture.h"
+#include "api/libretro.h"
+
+GFX_INFO gfx_info;
+RECT __src, __dst;
+int32_t pitchindwords = PRESCALE_WIDTH;
+uint32_t *blitter_buf_lock;
+retro_log_printf_t log_cb;
+
+static unsigned int mi_intr_reg;
+static unsigned int dpc_regs[8];
+static unsigned int vi_regs[CAPTURE_VI_REGS];
+static uint8_t dmem[0x1000];
+static uint8_t imem[0x1000];
+static uint8_t header[0x40];
+
+static void check_interrupts(void)
+{
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint8_t* load_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *data = NULL;
+    long length;
+
+    if (file == NULL)
+        return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0)
+    {
+        rewind(file);
+        data = malloc(length);
+        if (data != NULL && fread(data, length, 1, file) != 1)
+        {
+            free(data);
+            data = NULL;
+        }
+        *size = length;
+    }
+    fclose(file);
+    return data;
+}
+
+/* Feeds one DP list through process_RDP_list() from DMEM, 4 KiB at a time. */
+static void run_commands(const uint8_t *words, uint32_t size)
+{
+    while (size != 0)
+    {
+        const uint32_t chunk = size < sizeof(dmem) ? size : sizeof(dmem);
+
+        memcpy(dmem, words, chunk);
+        *gfx_info.DPC_STATUS_REG |= DP_STATUS_XBUS_DMA;
+        *gfx_info.DPC_START_REG = *gfx_info.DPC_CURRENT_REG = 0;
+        *gfx_info.DPC_END_REG = chunk;
+        process_RDP_list();
+
+        words += chunk;
+        size -= chunk;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const struct capture_header *file_header;
+    uint32_t *regs[CAPTURE_VI_REGS];
+    uint8_t *data, *ram;
+    size_t size, pos;
+    const char *path = NULL;
+    int workers = 1, threaded = 1, verbose = 0;
+    unsigned int frames = 0, mismatches = 0;
+    double start, frame_start, total = 0.0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-w") && i + 1 < argc)
+            workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s"))
+            threaded = 0;
+        else if (!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else if (argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+            break;
+    }
+    if (path == NULL || i < argc)
+    {
+        fprintf(stderr, "usage: %s [-w workers] [-s] [-v] capture\n", argv[0]);
+        return 2;
+    }
+
+    data = load_file(path, &size);
+    file_header = (const struct capture_header*)data;
+    if (data == NULL || size < sizeof(*file_header)
+     || file_header->magic != CAPTURE_MAGIC
+     || file_header->version != CAPTURE_VERSION)
+    {
+        fprintf(stderr, "%s: not an angrylion capture\n", path);
+        return 2;
+    }
+
+    ram = calloc(1, file_header->rdram_size);
+    blitter_buf_lock = calloc(pitchindwords * PRESCALE_HEIGHT, sizeof(uint32_t));
+    if (ram == NULL || blitter_buf_lock == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    gfx_info.HEADER = header;
+    gfx_info.RDRAM = ram;
+    gfx_info.DMEM = dmem;
+    gfx_info.IMEM = imem;
+    gfx_info.MI_INTR_REG = &mi_intr_reg;
+    gfx_info.DPC_START_REG = &dpc_regs[0];
+    gfx_info.DPC_END_REG = &dpc_regs[1];
+    gfx_info.DPC_CURRENT_REG = &dpc_regs[2];
+    gfx_info.DPC_STATUS_REG = &dpc_regs[3];
+    gfx_info.DPC_CLOCK_REG = &dpc_regs[4];
+    gfx_info.DPC_BUFBUSY_REG = &dpc_regs[5];
+    gfx_info.DPC_PIPEBUSY_REG = &dpc_regs[6];
+    gfx_info.DPC_TMEM_REG = &dpc_regs[7];
+    gfx_info.VI_STATUS_REG = &vi_regs[0];
+    gfx_info.VI_ORIGIN_REG = &vi_regs[1];
+    gfx_info.VI_WIDTH_REG = &vi_regs[2];
+    gfx_info.VI_INTR_REG = &vi_regs[3];
+    gfx_info.VI_V_CURRENT_LINE_REG = &vi_regs[4];
+    gfx_info.VI_TIMING_REG = &vi_regs[5];
+    gfx_info.VI_V_SYNC_REG = &vi_regs[6];
+    gfx_info.VI_H_SYNC_REG = &vi_regs[7];
+    gfx_info.VI_LEAP_REG = &vi_regs[8];
+    gfx_info.VI_H_START_REG = &vi_regs[9];
+    gfx_info.VI_V_START_REG = &vi_regs[10];
+    gfx_info.VI_V_BURST_REG = &vi_regs[11];
+    gfx_info.VI_X_SCALE_REG = &vi_regs[12];
+    gfx_info.VI_Y_SCALE_REG = &vi_regs[13];
+    gfx_info.CheckInterrupts = check_interrupts;
+    capture_vi_registers(regs);
+
+    parallel_init(workers < 0 ? 0 : workers);
+    rdp_fifo_threaded = threaded;
+    rdp_init();
+    overlay = file_header->overlay;
+    vi_compact_240p = file_header->compact_240p;
+
+    pos = sizeof(*file_header);
+    start = frame_start = now();
+    while (pos + 2 * sizeof(uint32_t) <= size)
+    {
+        const uint32_t type = ((const uint32_t*)&data[pos])[0];
+        const uint32_t length = ((const uint32_t*)&data[pos])[1];
+        const uint8_t *payload = &data[pos + 2 * sizeof(uint32_t)];
+        const uint32_t rdram_size = file_header->rdram_size;
+        uint32_t offset, hash, output;
+
+        pos += 2 * sizeof(uint32_t) + length;
+        if (pos > size)
+            break;
+
+        switch (type)
+        {
+        case CAPTURE_SNAPSHOT:
+            if (length != rdram_size + sizeof(hidden_bits) + 0x1000)
+                break;
+            rdp_sync();
+            memcpy(ram, payload, rdram_size);
+            memcpy(hidden_bits, payload + rdram_size, sizeof(hidden_bits));
+            rdp_set_tmem(payload + rdram_size + sizeof(hidden_bits));
+            break;
+        case CAPTURE_RDRAM:
+            memcpy(&offset, payload, sizeof(offset));
+            if (offset > rdram_size || length - sizeof(offset) > rdram_size - offset)
+                break;
+            rdp_sync();
+            memcpy(&ram[offset], payload + sizeof(offset), length - sizeof(offset));
+            break;
+        case CAPTURE_COMMANDS:
+            run_commands(payload, length);
+            break;
+        case CAPTURE_VI:
+            if (length != (CAPTURE_VI_REGS + 1) * sizeof(uint32_t))
+                break;
+            for (i = 0; i < CAPTURE_VI_REGS; i++)
+                memcpy(regs[i], payload + i * sizeof(uint32_t), sizeof(uint32_t));
+            memcpy(&hash, payload + CAPTURE_VI_REGS * sizeof(uint32_t), sizeof(hash));
+            rdp_update();
+
+            output = capture_hash(blitter_buf_lock,
+                pitchindwords * PRESCALE_HEIGHT * sizeof(uint32_t));
+            if (output != hash)
+            {
+                printf("frame %u: hash %08X, captured %08X\n",
+                    frames, output, hash);
+                ++mismatches;
+            }
+            else if (verbose)
+                printf("frame %u: %.3f ms, hash %08X\n", frames,
+                    (now() - frame_start) * 1e3, hash);
+            ++frames;
+            frame_start = now();
+            break;
+        }
+    }
+    rdp_sync();
+    total = now() - start;
+
+    rdp_close();
+    parallel_close();
+
+    printf("%u frames in %.3f s (%.3f ms/frame), %u mismatched\n",
+        frames, total, frames ? total * 1e3 / frames : 0.0, mismatches);
+    return mismatches != 0;
+}
@@ -4,12 +4,14 @@
 #include "Graphics/Context.h"
 #include "DisplayWindow.h"
 
-void DisplayWindow::start()
+bool DisplayWindow::start()
 {
-	_start(); // TODO: process initialization error
+	if (!_start())
+		return false;
 	gfxContext.init();
 	m_drawer._initData();
 	m_buffersSwapCount = 0;
+	return true;
 }
 
 void DisplayWindow::stop()
@@ -1,5 +1,9 @@
 #include "Context.h"
+#ifdef NULL_GRAPHICS
+#include "NullContext/null_ContextImpl.h"
+#else
 #include "OpenGLContext/opengl_ContextImpl.h"
+#endif
 
 using namespace graphics;
 
@@ -17,7 +21,11 @@ Context::~Context() {
 
 void Context::init()
 {
+#ifdef NULL_GRAPHICS
+	m_impl.reset(new NullContextImpl);
+#else
 	m_impl.reset(new opengl::ContextImpl);
+#endif
 	m_impl->init();
 	m_fbTexFormats.reset(m_impl->getFramebufferTextureFormats());
 	imageTextures = isSupported(SpecialFeatures::ImageTextures);
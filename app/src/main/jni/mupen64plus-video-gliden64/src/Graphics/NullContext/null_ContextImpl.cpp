@@ -0,0 +1,526 @@
+#include <vector>
+#include <Log.h>
+#include <Config.h>
+#include <GBI.h>
+#include <Combiner.h>
+#include <Textures.h>
+#include <Graphics/Parameters.h>
+#include <Graphics/ColorBufferReader.h>
+#include "null_ContextImpl.h"
+
+using namespace graphics;
+
+/*---------------Buffers-------------*/
+
+class NullWriteBuffer : public PixelWriteBuffer
+{
+public:
+	NullWriteBuffer(size_t _size) : m_data(_size) {}
+
+	void * getWriteBuffer(size_t _size) override
+	{
+		if (_size > m_data.size())
+			m_data.resize(_size);
+		return m_data.data();
+	}
+
+	void closeWriteBuffer() override {}
+
+	void * getData() override { return m_data.data(); }
+
+	void bind() override {}
+
+	void unbind() override {}
+
+private:
+	std::vector<u8> m_data;
+};
+
+class NullReadBuffer : public PixelReadBuffer
+{
+public:
+	NullReadBuffer(size_t _size) : m_data(_size) {}
+
+	void readPixels(s32 _x, s32 _y, u32 _width, u32 _height, Parameter _format, Parameter _type) override {}
+
+	void * getDataRange(u32 _offset, u32 _range) override
+	{
+		if (_offset + _range > m_data.size())
+			m_data.resize(_offset + _range);
+		return m_data.data() + _offset;
+	}
+
+	void closeReadBuffer() override {}
+
+	void bind() override {}
+
+	void unbind() override {}
+
+private:
+	std::vector<u8> m_data;
+};
+
+class NullColorBufferReader : public ColorBufferReader
+{
+public:
+	NullColorBufferReader(CachedTexture * _pTexture, u32 & _reads)
+		: ColorBufferReader(_pTexture)
+		, m_reads(_reads)
+	{
+	}
+
+	void cleanUp() override {}
+
+private:
+	const u8 * _readPixels(const ReadColorBufferParams & _params, u32 & _heightOffset, u32 & _stride) override
+	{
+		++m_reads;
+		_heightOffset = 0;
+		_stride = m_pTexture->realWidth;
+		return m_tempPixelData.data();
+	}
+
+	u32 & m_reads;
+};
+
+struct NullFramebufferTextureFormats : public FramebufferTextureFormats
+{
+	NullFramebufferTextureFormats()
+	{
+		init();
+	}
+
+protected:
+	void init() override
+	{
+		colorInternalFormat = internalcolorFormat::RGBA8;
+		colorFormat = colorFormat::RGBA;
+		colorType = datatype::UNSIGNED_BYTE;
+		colorFormatBytes = 4;
+
+		monochromeInternalFormat = internalcolorFormat::RED;
+		monochromeFormat = colorFormat::RED;
+		monochromeType = datatype::UNSIGNED_BYTE;
+		monochromeFormatBytes = 1;
+
+		depthInternalFormat = internalcolorFormat::DEPTH;
+		depthFormat = colorFormat::DEPTH;
+		depthType = datatype::FLOAT;
+		depthFormatBytes = 4;
+
+		depthImageInternalFormat = internalcolorFormat::RED;
+		depthImageFormat = colorFormat::RED;
+		depthImageType = datatype::FLOAT;
+		depthImageFormatBytes = 4;
+
+		lutInternalFormat = internalcolorFormat::RED;
+		lutFormat = colorFormat::RED;
+		lutType = datatype::UNSIGNED_INT;
+		lutFormatBytes = 4;
+
+		noiseInternalFormat = internalcolorFormat::RED;
+		noiseFormat = colorFormat::RED;
+		noiseType = datatype::UNSIGNED_BYTE;
+		noiseFormatBytes = 1;
+	}
+};
+
+/*---------------Shaders-------------*/
+
+// Tracks which combiner inputs are read, the same way the GLSL builder does,
+// so texture loading takes the same paths as with a real context.
+class NullCombinerProgram : public CombinerProgram
+{
+public:
+	NullCombinerProgram(Combiner & _color, Combiner & _alpha, const CombinerKey & _key)
+		: m_key(_key)
+		, m_inputs(0)
+	{
+		const bool twoCycle = _key.getCycleType() == G_CYC_2CYCLE;
+		_addInputs(_alpha.stage[0], twoCycle ? 0 : 1);
+		_addInputs(_color.stage[0], twoCycle ? 0 : 1);
+		if (twoCycle) {
+			if (_alpha.numStages == 2)
+				_addInputs(_alpha.stage[1], 2);
+			if (_color.numStages == 2)
+				_addInputs(_color.stage[1], 2);
+		}
+
+		if (!_key.isRectKey() &&
+			config.generalEmulation.enableHWLighting != 0 &&
+			GBI.isHWLSupported() &&
+			(m_inputs & (1 << G_GCI_SHADE)) != 0)
+			m_inputs |= 1 << G_GCI_HW_LIGHT;
+	}
+
+	void activate() override {}
+
+	void update(bool _force) override {}
+
+	CombinerKey getKey() const override { return m_key; }
+
+	bool usesTexture() const override { return usesTile(0) || usesTile(1); }
+
+	bool usesTile(u32 _t) const override
+	{
+		if (_t == 0)
+			return (m_inputs & ((1 << G_GCI_TEXEL0) | (1 << G_GCI_TEXEL0_ALPHA))) != 0;
+		return (m_inputs & ((1 << G_GCI_TEXEL1) | (1 << G_GCI_TEXEL1_ALPHA))) != 0;
+	}
+
+	bool usesShade() const override { return (m_inputs & ((1 << G_GCI_SHADE) | (1 << G_GCI_SHADE_ALPHA))) != 0; }
+
+	bool usesLOD() const override { return (m_inputs & (1 << G_GCI_LOD_FRACTION)) != 0; }
+
+	bool usesHwLighting() const override { return (m_inputs & (1 << G_GCI_HW_LIGHT)) != 0; }
+
+	bool getBinaryForm(std::vector<char> & _buffer) override { return false; }
+
+private:
+	// _stage: 1 - first stage of a one cycle combiner, which only sees texel 0;
+	//         2 - second stage of a two cycle combiner, where the texels are swapped
+	void _addInput(int _param, int _stage)
+	{
+		if (_stage == 1) {
+			if (_param == G_GCI_TEXEL1)
+				_param = G_GCI_TEXEL0;
+			else if (_param == G_GCI_TEXEL1_ALPHA)
+				_param = G_GCI_TEXEL0_ALPHA;
+		} else if (_stage == 2) {
+			switch (_param) {
+			case G_GCI_TEXEL0: _param = G_GCI_TEXEL1; break;
+			case G_GCI_TEXEL1: _param = G_GCI_TEXEL0; break;
+			case G_GCI_TEXEL0_ALPHA: _param = G_GCI_TEXEL1_ALPHA; break;
+			case G_GCI_TEXEL1_ALPHA: _param = G_GCI_TEXEL0_ALPHA; break;
+			}
+		}
+		m_inputs |= 1 << _param;
+	}
+
+	void _addInputs(const CombinerStage & _stage, int _stageType)
+	{
+		for (int i = 0; i < _stage.numOps; ++i) {
+			_addInput(_stage.op[i].param1, _stageType);
+			if (_stage.op[i].op == INTER) {
+				_addInput(_stage.op[i].param2, _stageType);
+				_addInput(_stage.op[i].param3, _stageType);
+			}
+		}
+	}
+
+	CombinerKey m_key;
+	u32 m_inputs;
+};
+
+class NullShaderProgram : public ShaderProgram
+{
+public:
+	void activate() override {}
+};
+
+class NullTexrectDrawerShaderProgram : public TexrectDrawerShaderProgram
+{
+public:
+	void activate() override {}
+	void setTextureSize(u32 _width, u32 _height) override {}
+	void setTextureBounds(float _texBounds[4]) override {}
+	void setEnableAlphaTest(int _enable) override {}
+};
+
+/*---------------NullContextImpl-------------*/
+
+NullContextImpl::NullContextImpl()
+	: m_lastHandle(0)
+	, m_unpackAlignment(4)
+{
+}
+
+NullContextImpl::~NullContextImpl()
+{
+}
+
+void NullContextImpl::init()
+{
+	m_fbTexFormats.reset(new NullFramebufferTextureFormats);
+	m_statistics = Statistics();
+}
+
+void NullContextImpl::destroy()
+{
+	LOG(LOG_VERBOSE, "[GLideN64]: null context: %u triangle draws (%u vertices), %u rect draws, %u line draws\n",
+		m_statistics.triangleDraws, m_statistics.triangleVertices, m_statistics.rectDraws, m_statistics.lineDraws);
+	LOG(LOG_VERBOSE, "[GLideN64]: null context: %u texture uploads (%u texels), %u framebuffer reads, %u combiners\n",
+		m_statistics.textureUploads, m_statistics.textureUploadTexels, m_statistics.framebufferReads,
+		m_statistics.combinerPrograms);
+}
+
+ObjectHandle NullContextImpl::_createHandle()
+{
+	return ObjectHandle(++m_lastHandle);
+}
+
+void NullContextImpl::enable(EnableParam _parameter, bool _enable)
+{
+}
+
+void NullContextImpl::cullFace(CullModeParam _mode)
+{
+}
+
+void NullContextImpl::enableDepthWrite(bool _enable)
+{
+}
+
+void NullContextImpl::setDepthCompare(CompareParam _mode)
+{
+}
+
+void NullContextImpl::setViewport(s32 _x, s32 _y, s32 _width, s32 _height)
+{
+}
+
+void NullContextImpl::setScissor(s32 _x, s32 _y, s32 _width, s32 _height)
+{
+}
+
+void NullContextImpl::setBlending(BlendParam _sfactor, BlendParam _dfactor)
+{
+}
+
+void NullContextImpl::setBlendColor(f32 _red, f32 _green, f32 _blue, f32 _alpha)
+{
+}
+
+void NullContextImpl::clearColorBuffer(f32 _red, f32 _green, f32 _blue, f32 _alpha)
+{
+}
+
+void NullContextImpl::clearDepthBuffer()
+{
+}
+
+void NullContextImpl::setPolygonOffset(f32 _factor, f32 _units)
+{
+}
+
+/*---------------Texture-------------*/
+
+ObjectHandle NullContextImpl::createTexture(Parameter _target)
+{
+	return _createHandle();
+}
+
+void NullContextImpl::deleteTexture(ObjectHandle _name)
+{
+}
+
+void NullContextImpl::init2DTexture(const Context::InitTextureParams & _params)
+{
+	if (_params.data == nullptr)
+		return;
+	++m_statistics.textureUploads;
+	m_statistics.textureUploadTexels += _params.width * _params.height;
+}
+
+void NullContextImpl::update2DTexture(const Context::UpdateTextureDataParams & _params)
+{
+	++m_statistics.textureUploads;
+	m_statistics.textureUploadTexels += _params.width * _params.height;
+}
+
+void NullContextImpl::setTextureParameters(const Context::TexParameters & _parameters)
+{
+}
+
+void NullContextImpl::bindTexture(const Context::BindTextureParameters & _params)
+{
+}
+
+void NullContextImpl::setTextureUnpackAlignment(s32 _param)
+{
+	m_unpackAlignment = _param;
+}
+
+s32 NullContextImpl::getTextureUnpackAlignment() const
+{
+	return m_unpackAlignment;
+}
+
+s32 NullContextImpl::getMaxTextureSize() const
+{
+	return 4096;
+}
+
+void NullContextImpl::bindImageTexture(const Context::BindImageTextureParameters & _params)
+{
+}
+
+u32 NullContextImpl::convertInternalTextureFormat(u32 _format) const
+{
+	return _format;
+}
+
+/*---------------Framebuffer-------------*/
+
+FramebufferTextureFormats * NullContextImpl::getFramebufferTextureFormats()
+{
+	return m_fbTexFormats.release();
+}
+
+ObjectHandle NullContextImpl::createFramebuffer()
+{
+	return _createHandle();
+}
+
+void NullContextImpl::deleteFramebuffer(ObjectHandle _name)
+{
+}
+
+void NullContextImpl::bindFramebuffer(BufferTargetParam _target, ObjectHandle _name)
+{
+}
+
+ObjectHandle NullContextImpl::createRenderbuffer()
+{
+	return _createHandle();
+}
+
+void NullContextImpl::initRenderbuffer(const Context::InitRenderbufferParams & _params)
+{
+}
+
+void NullContextImpl::addFrameBufferRenderTarget(const Context::FrameBufferRenderTarget & _params)
+{
+}
+
+bool NullContextImpl::blitFramebuffers(const Context::BlitFramebuffersParams & _params)
+{
+	return true;
+}
+
+/*---------------Pixelbuffer-------------*/
+
+PixelWriteBuffer * NullContextImpl::createPixelWriteBuffer(size_t _sizeInBytes)
+{
+	return new NullWriteBuffer(_sizeInBytes);
+}
+
+PixelReadBuffer * NullContextImpl::createPixelReadBuffer(size_t _sizeInBytes)
+{
+	return new NullReadBuffer(_sizeInBytes);
+}
+
+ColorBufferReader * NullContextImpl::createColorBufferReader(CachedTexture * _pTexture)
+{
+	return new NullColorBufferReader(_pTexture, m_statistics.framebufferReads);
+}
+
+/*---------------Shaders-------------*/
+
+CombinerProgram * NullContextImpl::createCombinerProgram(Combiner & _color, Combiner & _alpha, const CombinerKey & _key)
+{
+	++m_statistics.combinerPrograms;
+	return new NullCombinerProgram(_color, _alpha, _key);
+}
+
+bool NullContextImpl::saveShadersStorage(const Combiners & _combiners)
+{
+	return false;
+}
+
+bool NullContextImpl::loadShadersStorage(Combiners & _combiners)
+{
+	return false;
+}
+
+ShaderProgram * NullContextImpl::createDepthFogShader()
+{
+	return new NullShaderProgram;
+}
+
+ShaderProgram * NullContextImpl::createMonochromeShader()
+{
+	return new NullShaderProgram;
+}
+
+TexrectDrawerShaderProgram * NullContextImpl::createTexrectDrawerDrawShader()
+{
+	return new NullTexrectDrawerShaderProgram;
+}
+
+ShaderProgram * NullContextImpl::createTexrectDrawerClearShader()
+{
+	return new NullShaderProgram;
+}
+
+ShaderProgram * NullContextImpl::createTexrectCopyShader()
+{
+	return new NullShaderProgram;
+}
+
+ShaderProgram * NullContextImpl::createGammaCorrectionShader()
+{
+	return new NullShaderProgram;
+}
+
+ShaderProgram * NullContextImpl::createOrientationCorrectionShader()
+{
+	return new NullShaderProgram;
+}
+
+ShaderProgram * NullContextImpl::createTextDrawerShader()
+{
+	return new NullShaderProgram;
+}
+
+void NullContextImpl::resetShaderProgram()
+{
+}
+
+void NullContextImpl::drawTriangles(const Context::DrawTriangleParameters & _params)
+{
+	++m_statistics.triangleDraws;
+	m_statistics.triangleVertices += _params.elements != nullptr ? _params.elementsCount : _params.verticesCount;
+}
+
+void NullContextImpl::drawRects(const Context::DrawRectParameters & _params)
+{
+	++m_statistics.rectDraws;
+}
+
+void NullContextImpl::drawLine(f32 _width, SPVertex * _vertices)
+{
+	++m_statistics.lineDraws;
+}
+
+f32 NullContextImpl::getMaxLineWidth()
+{
+	return 1.0f;
+}
+
+bool NullContextImpl::isSupported(SpecialFeatures _feature) const
+{
+	switch (_feature) {
+	case SpecialFeatures::BlitFramebuffer:
+	case SpecialFeatures::FragmentDepthWrite:
+	case SpecialFeatures::NearPlaneClipping:
+	case SpecialFeatures::DepthFramebufferTextures:
+		return true;
+	case SpecialFeatures::WeakBlitFramebuffer:
+	case SpecialFeatures::Multisampling:
+	case SpecialFeatures::ImageTextures:
+	case SpecialFeatures::ShaderProgramBinary:
+		return false;
+	}
+	return false;
+}
+
+bool NullContextImpl::isError() const
+{
+	return false;
+}
+
+bool NullContextImpl::isFramebufferError() const
+{
+	return false;
+}
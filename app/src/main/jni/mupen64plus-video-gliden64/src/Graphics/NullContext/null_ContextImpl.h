@@ -0,0 +1,155 @@
+#pragma once
+#include <memory>
+#include <Graphics/ContextImpl.h>
+
+namespace graphics {
+
+	// GPU-less context for running and profiling the CPU side of the plugin headless.
+	// Textures, buffers and programs are handles only, draws are counted but not executed,
+	// and framebuffer reads return zeros.
+	class NullContextImpl : public ContextImpl
+	{
+	public:
+		struct Statistics
+		{
+			u32 triangleDraws = 0;
+			u32 triangleVertices = 0;
+			u32 rectDraws = 0;
+			u32 lineDraws = 0;
+			u32 textureUploads = 0;
+			u32 textureUploadTexels = 0;
+			u32 framebufferReads = 0;
+			u32 combinerPrograms = 0;
+		};
+
+		NullContextImpl();
+		~NullContextImpl();
+
+		void init() override;
+
+		void destroy() override;
+
+		void enable(EnableParam _parameter, bool _enable) override;
+
+		void cullFace(CullModeParam _mode) override;
+
+		void enableDepthWrite(bool _enable) override;
+
+		void setDepthCompare(CompareParam _mode) override;
+
+		void setViewport(s32 _x, s32 _y, s32 _width, s32 _height) override;
+
+		void setScissor(s32 _x, s32 _y, s32 _width, s32 _height) override;
+
+		void setBlending(BlendParam _sfactor, BlendParam _dfactor) override;
+
+		void setBlendColor(f32 _red, f32 _green, f32 _blue, f32 _alpha) override;
+
+		void clearColorBuffer(f32 _red, f32 _green, f32 _blue, f32 _alpha) override;
+
+		void clearDepthBuffer() override;
+
+		void setPolygonOffset(f32 _factor, f32 _units) override;
+
+		/*---------------Texture-------------*/
+
+		ObjectHandle createTexture(Parameter _target) override;
+
+		void deleteTexture(ObjectHandle _name) override;
+
+		void init2DTexture(const Context::InitTextureParams & _params) override;
+
+		void update2DTexture(const Context::UpdateTextureDataParams & _params) override;
+
+		void setTextureParameters(const Context::TexParameters & _parameters) override;
+
+		void bindTexture(const Context::BindTextureParameters & _params) override;
+
+		void setTextureUnpackAlignment(s32 _param) override;
+
+		s32 getTextureUnpackAlignment() const override;
+
+		s32 getMaxTextureSize() const override;
+
+		void bindImageTexture(const Context::BindImageTextureParameters & _params) override;
+
+		u32 convertInternalTextureFormat(u32 _format) const override;
+
+		/*---------------Framebuffer-------------*/
+
+		FramebufferTextureFormats * getFramebufferTextureFormats() override;
+
+		ObjectHandle createFramebuffer() override;
+
+		void deleteFramebuffer(ObjectHandle _name) override;
+
+		void bindFramebuffer(BufferTargetParam _target, ObjectHandle _name) override;
+
+		ObjectHandle createRenderbuffer() override;
+
+		void initRenderbuffer(const Context::InitRenderbufferParams & _params) override;
+
+		void addFrameBufferRenderTarget(const Context::FrameBufferRenderTarget & _params) override;
+
+		bool blitFramebuffers(const Context::BlitFramebuffersParams & _params) override;
+
+		/*---------------Pixelbuffer-------------*/
+
+		PixelWriteBuffer * createPixelWriteBuffer(size_t _sizeInBytes) override;
+
+		PixelReadBuffer * createPixelReadBuffer(size_t _sizeInBytes) override;
+
+		ColorBufferReader * createColorBufferReader(CachedTexture * _pTexture) override;
+
+		/*---------------Shaders-------------*/
+
+		CombinerProgram * createCombinerProgram(Combiner & _color, Combiner & _alpha, const CombinerKey & _key) override;
+
+		bool saveShadersStorage(const Combiners & _combiners) override;
+
+		bool loadShadersStorage(Combiners & _combiners) override;
+
+		ShaderProgram * createDepthFogShader() override;
+
+		ShaderProgram * createMonochromeShader() override;
+
+		TexrectDrawerShaderProgram * createTexrectDrawerDrawShader() override;
+
+		ShaderProgram * createTexrectDrawerClearShader() override;
+
+		ShaderProgram * createTexrectCopyShader() override;
+
+		ShaderProgram * createGammaCorrectionShader() override;
+
+		ShaderProgram * createOrientationCorrectionShader() override;
+
+		ShaderProgram * createTextDrawerShader() override;
+
+		void resetShaderProgram() override;
+
+		void drawTriangles(const Context::DrawTriangleParameters & _params) override;
+
+		void drawRects(const Context::DrawRectParameters & _params) override;
+
+		void drawLine(f32 _width, SPVertex * _vertices) override;
+
+		f32 getMaxLineWidth() override;
+
+		bool isSupported(SpecialFeatures _feature) const override;
+
+		bool isError() const override;
+
+		bool isFramebufferError() const override;
+
+		const Statistics & getStatistics() const { return m_statistics; }
+
+	private:
+		ObjectHandle _createHandle();
+
+		u32 m_lastHandle;
+		s32 m_unpackAlignment;
+		Statistics m_statistics;
+		std::unique_ptr<FramebufferTextureFormats> m_fbTexFormats;
+	};
+
+}
@@ -0,0 +1,59 @@
+#include <string.h>
+#include <Config.h>
+#include <Log.h>
+#include <DisplayWindow.h>
+
+// Headless window for the null graphics context: no video mode is set through the
+// frontend's video extension, so no GL context is ever created.
+class DisplayWindowNull : public DisplayWindow
+{
+public:
+	DisplayWindowNull() {}
+
+private:
+	bool _start() override;
+	void _stop() override {}
+	void _swapBuffers() override {}
+	void _saveScreenshot() override {}
+	bool _resizeWindow() override;
+	void _changeWindow() override {}
+	void _readScreen(void **_pDest, long *_pWidth, long *_pHeight) override {}
+	void _readScreen2(void * _dest, int * _width, int * _height, int _front) override;
+};
+
+DisplayWindow & DisplayWindow::get()
+{
+	static DisplayWindowNull video;
+	return video;
+}
+
+bool DisplayWindowNull::_start()
+{
+	m_bFullscreen = false;
+	m_screenWidth = config.video.windowedWidth;
+	m_screenHeight = config.video.windowedHeight;
+	_setBufferSize();
+	LOG(LOG_VERBOSE, "[GLideN64]: Null display window %dx%d\n", m_screenWidth, m_screenHeight);
+	return true;
+}
+
+bool DisplayWindowNull::_resizeWindow()
+{
+	m_bFullscreen = false;
+	m_width = m_screenWidth = m_resizeWidth;
+	m_height = m_screenHeight = m_resizeHeight;
+	_setBufferSize();
+	return true;
+}
+
+void DisplayWindowNull::_readScreen2(void * _dest, int * _width, int * _height, int _front)
+{
+	if (_width == nullptr || _height == nullptr)
+		return;
+
+	*_width = m_screenWidth;
+	*_height = m_screenHeight;
+
+	if (_dest != nullptr)
+		memset(_dest, 0, (*_width) * (*_height) * 3);
+}
@@ -194,7 +194,7 @@ void PluginAPI::RomClosed()
 #endif
 }
 
-void PluginAPI::RomOpen()
+bool PluginAPI::RomOpen()
 {
 	LOG(LOG_APIFUNC, "RomOpen\n");
 #ifdef RSPTHREAD
@@ -207,12 +207,14 @@ void PluginAPI::RomOpen()
 	RSP_Init();
 	GBI.init();
 	Config_LoadConfig();
-	dwnd().start();
+	if (!dwnd().start())
+		return false;
 #endif
 
 #ifdef DEBUG
 	OpenDebugDlg();
 #endif
+	return true;
 }
 
 void PluginAPI::ShowCFB()